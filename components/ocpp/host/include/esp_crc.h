@@ -0,0 +1,11 @@
+#ifndef HOST_ESP_CRC_H
+#define HOST_ESP_CRC_H
+
+#include <stdint.h>
+
+/**
+ * @brief CRC32 with the same initial and final inversion as the ROM function
+ */
+uint32_t esp_crc32_le(uint32_t crc, const uint8_t * buf, uint32_t len);
+
+#endif /* HOST_ESP_CRC_H */
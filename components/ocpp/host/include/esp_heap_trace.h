@@ -0,0 +1,22 @@
+#ifndef HOST_ESP_HEAP_TRACE_H
+#define HOST_ESP_HEAP_TRACE_H
+
+#include "esp_err.h"
+
+/** @file
+ * @brief Heap tracing is not available on the host. Use the sanitizers of the host build instead.
+ */
+
+typedef enum{
+	HEAP_TRACE_ALL,
+	HEAP_TRACE_LEAKS,
+} heap_trace_mode_t;
+
+typedef struct heap_trace_record_t heap_trace_record_t;
+
+#define heap_trace_init_standalone(buffer, num_records) ESP_ERR_NOT_SUPPORTED
+#define heap_trace_start(mode) ESP_ERR_NOT_SUPPORTED
+#define heap_trace_stop() ESP_ERR_NOT_SUPPORTED
+#define heap_trace_dump()
+
+#endif /* HOST_ESP_HEAP_TRACE_H */
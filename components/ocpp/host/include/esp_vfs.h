@@ -0,0 +1,22 @@
+#ifndef HOST_ESP_VFS_H
+#define HOST_ESP_VFS_H
+
+/** @file
+ * @brief The host build uses the POSIX file system directly. Files are stored below OCPP_HOST_FILE_PATH, see host_storage_enter.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_err.h"
+
+#endif /* HOST_ESP_VFS_H */
@@ -0,0 +1,6 @@
+#ifndef HOST_ESP_VFS_FAT_H
+#define HOST_ESP_VFS_FAT_H
+
+#include "esp_vfs.h"
+
+#endif /* HOST_ESP_VFS_FAT_H */
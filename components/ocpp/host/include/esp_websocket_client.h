@@ -0,0 +1,88 @@
+#ifndef HOST_ESP_WEBSOCKET_CLIENT_H
+#define HOST_ESP_WEBSOCKET_CLIENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+#include "esp_event.h"
+#include "freertos/FreeRTOS.h"
+
+/** @file
+ * @brief Stand-in for esp_websocket_client using POSIX sockets.
+ *
+ * Only unencrypted ws:// uris are supported. Frames larger than buffer_size are delivered in several
+ * WEBSOCKET_EVENT_DATA events with increasing payload_offset, like the ESP-IDF client does.
+ */
+
+typedef struct esp_websocket_client * esp_websocket_client_handle_t;
+
+ESP_EVENT_DECLARE_BASE(WEBSOCKET_EVENTS);
+
+typedef enum{
+	WS_TRANSPORT_OPCODES_CONT = 0x00,
+	WS_TRANSPORT_OPCODES_TEXT = 0x01,
+	WS_TRANSPORT_OPCODES_BINARY = 0x02,
+	WS_TRANSPORT_OPCODES_CLOSE = 0x08,
+	WS_TRANSPORT_OPCODES_PING = 0x09,
+	WS_TRANSPORT_OPCODES_PONG = 0x0a,
+	WS_TRANSPORT_OPCODES_FIN = 0x80,
+	WS_TRANSPORT_OPCODES_NONE = 0x100,
+} ws_transport_opcodes_t;
+
+typedef enum{
+	WEBSOCKET_EVENT_ANY = -1,
+	WEBSOCKET_EVENT_ERROR = 0,
+	WEBSOCKET_EVENT_CONNECTED,
+	WEBSOCKET_EVENT_DISCONNECTED,
+	WEBSOCKET_EVENT_DATA,
+	WEBSOCKET_EVENT_CLOSED,
+	WEBSOCKET_EVENT_BEFORE_CONNECT,
+	WEBSOCKET_EVENT_MAX
+} esp_websocket_event_id_t;
+
+typedef struct{
+	const char * data_ptr; ///< Data of this event
+	int data_len; ///< Length of data_ptr
+	bool fin; ///< True if this is the last frame of a message
+	uint8_t op_code; ///< Opcode of the frame
+	esp_websocket_client_handle_t client;
+	void * user_context;
+	int payload_len; ///< Length of the complete frame
+	int payload_offset; ///< Offset of data_ptr in the complete frame
+} esp_websocket_event_data_t;
+
+typedef struct{
+	const char * uri; ///< ws://host[:port]/path
+	const char * host;
+	int port;
+	const char * username;
+	const char * password;
+	const char * path;
+	bool disable_auto_reconnect;
+	void * user_context;
+	int task_prio;
+	int task_stack;
+	int buffer_size; ///< Receive buffer size, larger frames are delivered in parts
+	const char * subprotocol;
+	const char * user_agent;
+	const char * headers;
+	int pingpong_timeout_sec;
+	bool disable_pingpong_discon;
+	int ping_interval_sec;
+	int reconnect_timeout_ms;
+	int network_timeout_ms;
+} esp_websocket_client_config_t;
+
+esp_websocket_client_handle_t esp_websocket_client_init(const esp_websocket_client_config_t * config);
+esp_err_t esp_websocket_register_events(esp_websocket_client_handle_t client, esp_websocket_event_id_t event,
+					esp_event_handler_t event_handler, void * event_handler_arg);
+esp_err_t esp_websocket_client_start(esp_websocket_client_handle_t client);
+esp_err_t esp_websocket_client_stop(esp_websocket_client_handle_t client);
+esp_err_t esp_websocket_client_close(esp_websocket_client_handle_t client, TickType_t timeout);
+esp_err_t esp_websocket_client_destroy(esp_websocket_client_handle_t client);
+int esp_websocket_client_send_text(esp_websocket_client_handle_t client, const char * data, int len, TickType_t timeout);
+bool esp_websocket_client_is_connected(esp_websocket_client_handle_t client);
+esp_err_t esp_websocket_client_set_ping_interval_sec(esp_websocket_client_handle_t client, size_t ping_interval_sec);
+
+#endif /* HOST_ESP_WEBSOCKET_CLIENT_H */
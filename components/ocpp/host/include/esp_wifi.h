@@ -0,0 +1,7 @@
+#ifndef HOST_ESP_WIFI_H
+#define HOST_ESP_WIFI_H
+
+#include "esp_err.h"
+#include "esp_event.h"
+
+#endif /* HOST_ESP_WIFI_H */
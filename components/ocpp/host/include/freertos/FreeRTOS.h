@@ -0,0 +1,68 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "sdkconfig.h"
+
+/** @file
+ * @brief Subset of the FreeRTOS API implemented with POSIX threads for the host build of the ocpp component.
+ *
+ * Ticks are milliseconds. Tasks are detached threads, queues and semaphores are ring buffers guarded by a mutex and
+ * timers are run by a single timer service thread like the FreeRTOS timer daemon.
+ */
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdTRUE ((BaseType_t)1)
+#define pdFALSE ((BaseType_t)0)
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define errQUEUE_FULL pdFAIL
+#define errQUEUE_EMPTY pdFAIL
+
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS ((TickType_t)(1000 / configTICK_RATE_HZ))
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define pdTICKS_TO_MS(ticks) ((uint32_t)(((uint64_t)(ticks) * 1000) / configTICK_RATE_HZ))
+
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+typedef void (*TaskFunction_t)(void *);
+
+typedef struct host_task * TaskHandle_t;
+typedef struct host_queue * QueueHandle_t;
+typedef struct host_queue * SemaphoreHandle_t;
+typedef struct host_timer * TimerHandle_t;
+
+typedef enum{
+	eNoAction = 0,
+	eSetBits,
+	eIncrement,
+	eSetValueWithOverwrite,
+	eSetValueWithoutOverwrite,
+} eNotifyAction;
+
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) host_enter_critical()
+#define portEXIT_CRITICAL(mux) host_exit_critical()
+
+void host_enter_critical(void);
+void host_exit_critical(void);
+
+TickType_t xTaskGetTickCount(void);
+
+#endif /* HOST_FREERTOS_H */
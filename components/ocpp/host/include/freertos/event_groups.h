@@ -0,0 +1,7 @@
+#ifndef HOST_FREERTOS_EVENT_GROUPS_H
+#define HOST_FREERTOS_EVENT_GROUPS_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/timers.h"
+
+#endif /* HOST_FREERTOS_EVENT_GROUPS_H */
@@ -0,0 +1,21 @@
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void * item, TickType_t ticks_to_wait);
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void * item, TickType_t ticks_to_wait);
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void * item);
+BaseType_t xQueueReceive(QueueHandle_t queue, void * item_out, TickType_t ticks_to_wait);
+BaseType_t xQueuePeek(QueueHandle_t queue, void * item_out, TickType_t ticks_to_wait);
+BaseType_t xQueueReset(QueueHandle_t queue);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+
+#define xQueueSend(queue, item, ticks_to_wait) xQueueSendToBack(queue, item, ticks_to_wait)
+#define xQueueSendFromISR(queue, item, woken) xQueueSendToBack(queue, item, 0)
+
+#endif /* HOST_FREERTOS_QUEUE_H */
@@ -0,0 +1,28 @@
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+BaseType_t xTaskCreate(TaskFunction_t task_function, const char * name, uint32_t stack_depth, void * parameters,
+		UBaseType_t priority, TaskHandle_t * task_out);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task_function, const char * name, uint32_t stack_depth, void * parameters,
+				UBaseType_t priority, TaskHandle_t * task_out, BaseType_t core_id);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+const char * pcTaskGetName(TaskHandle_t task);
+
+/**
+ * @brief Stack usage is not tracked on the host. Returns the requested stack depth.
+ */
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t * value_out, TickType_t ticks_to_wait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait);
+
+#define xTaskNotifyFromISR(task, value, action, woken) xTaskNotify(task, value, action)
+#define portYIELD_FROM_ISR(...)
+
+#endif /* HOST_FREERTOS_TASK_H */
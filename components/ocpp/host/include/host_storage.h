@@ -0,0 +1,20 @@
+#ifndef HOST_STORAGE_H
+#define HOST_STORAGE_H
+
+/** @file
+ * @brief Per instance storage for the host build.
+ *
+ * The ocpp component stores files relative to CONFIG_OCPP_FILE_PATH, which is "." on the host. Each process
+ * running the component should therefore enter its own directory before calling start_ocpp.
+ */
+
+/**
+ * @brief creates OCPP_HOST_FILE_PATH/<cbid> if needed and makes it the working directory.
+ *
+ * @param cbid charge box identity of the instance
+ *
+ * @return 0 on success, -1 with errno set on failure.
+ */
+int host_storage_enter(const char * cbid);
+
+#endif /* HOST_STORAGE_H */
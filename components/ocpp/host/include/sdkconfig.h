@@ -0,0 +1,52 @@
+#ifndef HOST_SDKCONFIG_H
+#define HOST_SDKCONFIG_H
+
+/** @file
+ * @brief Kconfig defaults of the ocpp component used by the host build.
+ *
+ * CONFIG_OCPP_FILE_PATH is relative so that each charge point instance can use its own directory.
+ * See host_storage_enter.
+ */
+
+#define CONFIG_OCPP_TIMER_MAX_SEC 4294967
+#define CONFIG_OCPP_DEFAULT_BOOT_NOTIFICATION_INTERVAL_SEC 120
+#define CONFIG_OCPP_VENDOR_ID "zaptec"
+#define CONFIG_OCPP_URL_MAX_LENGTH 2048
+#define CONFIG_OCPP_MAX_TRANSACTION_QUEUE_SIZE 20
+#define CONFIG_OCPP_MAX_TRANSACTION_FILES 100
+#define CONFIG_OCPP_MAX_TRANSACTION_FILE_SIZE 65536
+#define CONFIG_OCPP_TRANSACTION_METER_VALUES_COALESCE_MAX_SIZE 2048
+#define CONFIG_OCPP_METER_VALUE_COMPACT_STORAGE 1
+#define CONFIG_OCPP_METER_VALUE_RETENTION 1
+#define CONFIG_OCPP_METER_VALUE_RETENTION_HIGH_WATER_PERCENT 90
+#define CONFIG_OCPP_METER_VALUE_RETENTION_LOW_WATER_PERCENT 75
+#define CONFIG_OCPP_METER_VALUE_RETENTION_FULL_RESOLUTION_SEC 3600
+#define CONFIG_OCPP_METER_VALUE_RETENTION_BOUNDARY_SEC 900
+#define CONFIG_OCPP_AUTH_CACHE_MAX_LENGTH 128
+#define CONFIG_OCPP_AUTH_FILTER_BITS_PER_ENTRY 10
+#define CONFIG_OCPP_FILE_PATH "."
+#define CONFIG_OCPP_CONNECTOR_PHASE_ROTATION_MAX_LENGTH 2
+#define CONFIG_OCPP_GET_CONFIGURATION_MAX_KEYS 62
+#define CONFIG_OCPP_MESSAGE_TIMEOUT_DEFAULT 10
+#define CONFIG_OCPP_MESSAGE_TIMEOUT_MINIMUM 10
+#define CONFIG_OCPP_ADAPTIVE_MESSAGE_TIMEOUT 1
+#define CONFIG_OCPP_ADAPTIVE_MESSAGE_TIMEOUT_MIN_MS 3000
+#define CONFIG_OCPP_METER_VALUES_ALIGNED_DATA_MAX_LENGTH 6
+#define CONFIG_OCPP_METER_VALUES_SAMPLED_DATA_MAX_LENGTH 6
+#define CONFIG_OCPP_NUMBER_OF_CONNECTORS 1
+#define CONFIG_OCPP_STOP_TRANSACTION_MAX_METER_VALUES 512
+#define CONFIG_OCPP_STOP_TXN_ALIGNED_DATA_MAX_LENGTH 6
+#define CONFIG_OCPP_STOP_TXN_SAMPLED_DATA_MAX_LENGTH 6
+#define CONFIG_OCPP_SUPPORTED_FEATURE_PROFILES "Core,Firmware Management,Local Auth List Management,Reservation,Smart Charging,Remote Trigger"
+#define CONFIG_OCPP_SUPPORTED_FILE_TRANSFER_PROTOCOLS "HTTP,HTTPS"
+#define CONFIG_OCPP_LOCAL_AUTH_LIST_MAX_LENGTH 1024
+#define CONFIG_OCPP_SEND_LOCAL_LIST_MAX_LENGTH 255
+#define CONFIG_OCPP_RESERVE_CONNECTOR_ZERO_SUPPORTED 1
+#define CONFIG_OCPP_CHARGE_PROFILE_MAX_STACK_LEVEL 8
+#define CONFIG_OCPP_CHARGING_SCHEDULE_ALLOWED_CHARGING_RATE_UNIT "Current"
+#define CONFIG_OCPP_CHARGING_SCHEDULE_MAX_PERIODS 32
+#define CONFIG_OCPP_MAX_CHARGING_PROFILES_INSTALLED 24
+#define CONFIG_OCPP_SMART_CHARGING_TIMELINE_HORIZON 86400
+#define CONFIG_OCPP_SMART_CHARGING_TIMELINE_MAX_ENTRIES 48
+
+#endif /* HOST_SDKCONFIG_H */
@@ -0,0 +1,16 @@
+#ifndef HOST_BASE64_H
+#define HOST_BASE64_H
+
+#include <stddef.h>
+
+/**
+ * @brief Base64 encode like wpa_supplicant, with a line feed after every 72 characters and at the end
+ */
+char * base64_encode(const void * src, size_t len, size_t * out_len);
+
+/**
+ * @brief Base64 decode like wpa_supplicant, ignoring characters outside the base64 alphabet
+ */
+unsigned char * base64_decode(const char * src, size_t len, size_t * out_len);
+
+#endif /* HOST_BASE64_H */
@@ -0,0 +1,689 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+
+#include "cJSON.h"
+
+#include "host_storage.h"
+
+#include "ocpp_task.h"
+#include "ocpp_listener.h"
+#include "ocpp_transaction.h"
+#include "ocpp_json/ocppj_validation.h"
+#include "messages/call_messages/ocpp_call_request.h"
+#include "types/ocpp_meter_value.h"
+#include "types/ocpp_reason.h"
+#include "types/ocpp_charge_point_error_code.h"
+#include "types/ocpp_charge_point_status.h"
+
+/*
+ * Virtual charger fleet for load testing a central system with the firmware's ocpp stack.
+ *
+ * The ocpp component keeps its state (queues, websocket, transaction files) in file scope, so each virtual
+ * charger runs in its own forked process and working directory. The parent only starts the instances,
+ * collects a report from each of them over a pipe and prints per instance and aggregate results.
+ *
+ * Each instance runs the same enqueue/handle_ocpp_call loop as main/ocpp.c and simulates repeated charge
+ * sessions: Authorize.req, StartTransaction.req, periodic MeterValues.req with an increasing energy register
+ * and StopTransaction.req, with status notifications in between.
+ */
+
+static const char * TAG = "OCPP FLEET     ";
+
+#define MAIN_EVENT_OFFSET 0
+#define MAIN_EVENT_MASK 0xf
+#define WEBSOCKET_EVENT_OFFSET 4
+#define WEBSOCKET_EVENT_MASK 0xf0
+#define TASK_EVENT_OFFSET 8
+#define TASK_EVENT_MASK 0xf00
+
+#define SIM_EVENT_AUTHORIZED 1<<0
+#define SIM_EVENT_AUTHORIZE_FAILED 1<<1
+
+#define SIM_ID_TAG "fleet-tag"
+
+struct fleet_config{
+	const char * url;
+	const char * cbid_prefix;
+	size_t instance_count;
+	uint32_t duration_sec;
+	uint32_t ramp_per_sec;
+	uint32_t session_sec;
+	uint32_t idle_sec;
+	uint32_t meter_interval_sec;
+	uint32_t power_w;
+	bool clean;
+};
+
+/* Sent once from each instance to the parent. Must be smaller than PIPE_BUF to be written atomically */
+struct fleet_report{
+	size_t index;
+	bool registered;
+	bool closed;
+	int64_t boot_us;
+	int64_t run_us;
+	uint32_t calls_sent;
+	uint32_t calls_timed_out;
+	uint32_t calls_failed;
+	uint32_t sessions_started;
+	uint32_t sessions_completed;
+	int64_t rtt_total_us;
+	int64_t rtt_max_us;
+	int64_t cpu_us;
+	size_t heap_peak;
+	long rss_peak_kb;
+};
+
+static volatile sig_atomic_t should_stop = 0;
+
+static void on_stop_signal(int signal){
+	should_stop = 1;
+}
+
+enum sim_state{
+	eSIM_IDLE,
+	eSIM_AUTHORIZING,
+	eSIM_CHARGING,
+};
+
+static TaskHandle_t sim_task = NULL;
+
+/* Updated by StartTransaction.conf on the listener task */
+static pthread_mutex_t transaction_lock = PTHREAD_MUTEX_INITIALIZER;
+static int transaction_entry = -1;
+static int transaction_id = -1;
+static bool transaction_id_is_valid = false;
+
+static void authorize_result_cb(const char * unique_id, cJSON * payload, void * cb_data){
+	cJSON * id_tag_info = cJSON_GetObjectItem(payload, "idTagInfo");
+	cJSON * status = cJSON_GetObjectItem(id_tag_info, "status");
+
+	bool accepted = cJSON_IsString(status) && strcmp(status->valuestring, "Accepted") == 0;
+	xTaskNotify(sim_task, (accepted ? SIM_EVENT_AUTHORIZED : SIM_EVENT_AUTHORIZE_FAILED) << MAIN_EVENT_OFFSET, eSetBits);
+}
+
+static void authorize_error_cb(const char * unique_id, const char * error_code, const char * error_description, cJSON * error_details, void * cb_data){
+	xTaskNotify(sim_task, SIM_EVENT_AUTHORIZE_FAILED << MAIN_EVENT_OFFSET, eSetBits);
+}
+
+static void start_transaction_result_cb(const char * unique_id, cJSON * payload, void * cb_data){
+	struct ocpp_transaction_start_stop_cb_data * data = cb_data;
+	if(data == NULL)
+		return;
+
+	int received_id;
+	char err_str[64];
+	if(ocppj_get_int_field(payload, "transactionId", true, &received_id, err_str, sizeof(err_str)) != eOCPPJ_NO_ERROR){
+		ESP_LOGE(TAG, "Invalid StartTransaction.conf: %s", err_str);
+		return;
+	}
+
+	pthread_mutex_lock(&transaction_lock);
+	if(data->transaction_entry == transaction_entry){
+		transaction_id = received_id;
+		transaction_id_is_valid = true;
+	}
+	pthread_mutex_unlock(&transaction_lock);
+
+	if(ocpp_transaction_set_real_id(data->transaction_entry, received_id) != ESP_OK)
+		ESP_LOGE(TAG, "Failed to set valid id for stored transaction");
+}
+
+static void start_transaction_error_cb(const char * unique_id, const char * error_code, const char * error_description, cJSON * error_details, void * cb_data){
+	struct ocpp_transaction_start_stop_cb_data * data = cb_data;
+
+	pthread_mutex_lock(&transaction_lock);
+	if(data != NULL && data->transaction_entry == transaction_entry){
+		transaction_id = -1;
+		transaction_id_is_valid = true;
+	}
+	pthread_mutex_unlock(&transaction_lock);
+}
+
+static void send_status(const char * status){
+	cJSON * request = ocpp_create_status_notification_request(1, OCPP_CP_ERROR_NO_ERROR, NULL, status, time(NULL), NULL, NULL);
+	if(request == NULL || enqueue_call(request, NULL, NULL, NULL, eOCPP_CALL_GENERIC) != 0){
+		ESP_LOGE(TAG, "Unable to enqueue status notification");
+		cJSON_Delete(request);
+	}
+}
+
+static struct ocpp_meter_value_list * create_meter_values(uint32_t energy_wh, uint32_t power_w){
+	struct ocpp_sampled_value energy = {
+		.context = eOCPP_CONTEXT_SAMPLE_PERIODIC,
+		.format = eOCPP_FORMAT_RAW,
+		.measurand = eOCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER,
+		.location = eOCPP_LOCATION_OUTLET,
+		.unit = eOCPP_UNIT_WH,
+	};
+	snprintf(energy.value, sizeof(energy.value), "%" PRIu32, energy_wh);
+
+	struct ocpp_sampled_value power = {
+		.context = eOCPP_CONTEXT_SAMPLE_PERIODIC,
+		.format = eOCPP_FORMAT_RAW,
+		.measurand = eOCPP_MEASURAND_POWER_ACTIVE_IMPORT,
+		.location = eOCPP_LOCATION_OUTLET,
+		.unit = eOCPP_UNIT_W,
+	};
+	snprintf(power.value, sizeof(power.value), "%" PRIu32, power_w);
+
+	struct ocpp_meter_value meter_value = {
+		.timestamp = time(NULL),
+		.sampled_value = ocpp_create_sampled_list(),
+	};
+
+	struct ocpp_meter_value_list * meter_list = ocpp_create_meter_list();
+
+	/* ocpp_meter_list_add copies the sampled values */
+	if(meter_value.sampled_value == NULL || meter_list == NULL
+		|| ocpp_sampled_list_add(meter_value.sampled_value, energy) == NULL
+		|| ocpp_sampled_list_add(meter_value.sampled_value, power) == NULL
+		|| ocpp_meter_list_add(meter_list, meter_value) == NULL){
+
+		ocpp_meter_list_delete(meter_list);
+		meter_list = NULL;
+	}
+
+	ocpp_sampled_list_delete(meter_value.sampled_value);
+	return meter_list;
+}
+
+static void sample_heap(struct fleet_report * report){
+	struct mallinfo2 info = mallinfo2();
+	if(info.uordblks > report->heap_peak)
+		report->heap_peak = info.uordblks;
+}
+
+/* ru_maxrss is not reset by fork, so the peak is read from VmHWM instead */
+static long read_rss_peak_kb(void){
+	FILE * status = fopen("/proc/self/status", "r");
+	if(status == NULL)
+		return -1;
+
+	char line[128];
+	long rss_peak_kb = -1;
+
+	while(fgets(line, sizeof(line), status) != NULL){
+		if(sscanf(line, "VmHWM: %ld kB", &rss_peak_kb) == 1)
+			break;
+	}
+
+	fclose(status);
+	return rss_peak_kb;
+}
+
+static void run_instance(const struct fleet_config * fleet, size_t index, int report_fd){
+	struct fleet_report report = {.index = index};
+	int64_t start_us = esp_timer_get_time();
+
+	char cbid[64];
+	snprintf(cbid, sizeof(cbid), "%s%06zu", fleet->cbid_prefix, index);
+
+	if(host_storage_enter(cbid) != 0){
+		ESP_LOGE(TAG, "[%s] Unable to enter instance directory: %s", cbid, strerror(errno));
+		goto report;
+	}
+
+	struct ocpp_client_config config = {
+		.url = fleet->url,
+		.cbid = cbid,
+		.authorization_key = NULL,
+		.heartbeat_interval = 300,
+		.transaction_message_attempts = 3,
+		.transaction_message_retry_interval = 60,
+		.websocket_ping_interval = 60,
+		.security_profile = 0,
+	};
+
+	sim_task = xTaskGetCurrentTaskHandle();
+
+	ocpp_transaction_set_callbacks(start_transaction_result_cb, start_transaction_error_cb, NULL, NULL, NULL, NULL);
+
+	if(start_ocpp(&config) != ESP_OK){
+		ESP_LOGE(TAG, "[%s] Unable to start ocpp", cbid);
+		goto report;
+	}
+
+	ocpp_configure_task_notification(sim_task, TASK_EVENT_OFFSET);
+	ocpp_configure_websocket_notification(sim_task, WEBSOCKET_EVENT_OFFSET);
+
+	if(fleet->clean)
+		ocpp_transaction_clear_all();
+
+	uint32_t notification = complete_boot_notification_process(NULL, "Virtual charger", cbid, "Zaptec", "host",
+								NULL, NULL, NULL, NULL, eOCPP_WEBSOCKET_CLOSED << WEBSOCKET_EVENT_OFFSET);
+
+	report.boot_us = esp_timer_get_time() - start_us;
+
+	if(notification & (eOCPP_WEBSOCKET_CLOSED << WEBSOCKET_EVENT_OFFSET) || get_registration_status() != eOCPP_REGISTRATION_ACCEPTED){
+		ESP_LOGE(TAG, "[%s] Boot notification was not accepted", cbid);
+		goto stop;
+	}
+
+	report.registered = true;
+	send_status(OCPP_CP_STATUS_AVAILABLE);
+
+	enum sim_state state = eSIM_IDLE;
+	int enqueued_calls = 1;
+	bool awaiting_response = false;
+	int64_t sent_us = 0;
+
+	uint32_t energy_wh = esp_random() % 100000;
+	int64_t now_us = esp_timer_get_time();
+	int64_t next_action_us = now_us + (int64_t)(esp_random() % (fleet->idle_sec * 1000 + 1)) * 1000;
+	int64_t session_end_us = 0;
+	int64_t last_meter_us = 0;
+
+	while(!should_stop){
+		int64_t wait_ms = (next_action_us - esp_timer_get_time()) / 1000;
+		if(wait_ms < 0)
+			wait_ms = 0;
+		if(wait_ms > 1000)
+			wait_ms = 1000;
+
+		uint32_t data = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms));
+		sample_heap(&report);
+
+		const uint main_event = (data & MAIN_EVENT_MASK) >> MAIN_EVENT_OFFSET;
+		const uint websocket_event = (data & WEBSOCKET_EVENT_MASK) >> WEBSOCKET_EVENT_OFFSET;
+		const uint task_event = (data & TASK_EVENT_MASK) >> TASK_EVENT_OFFSET;
+
+		now_us = esp_timer_get_time();
+
+		if(websocket_event & eOCPP_WEBSOCKET_CLOSED){
+			ESP_LOGE(TAG, "[%s] Websocket closed by central system", cbid);
+			report.closed = true;
+			break;
+		}
+
+		if(websocket_event & eOCPP_WEBSOCKET_RECEIVED_MATCHING && awaiting_response){
+			int64_t rtt = now_us - sent_us;
+			report.rtt_total_us += rtt;
+			if(rtt > report.rtt_max_us)
+				report.rtt_max_us = rtt;
+
+			awaiting_response = false;
+		}
+
+		if(task_event & eOCPP_TASK_CALL_TIMEOUT){
+			timeout_active_call();
+			report.calls_timed_out++;
+			awaiting_response = false;
+		}
+
+		if(main_event & SIM_EVENT_AUTHORIZE_FAILED && state == eSIM_AUTHORIZING){
+			state = eSIM_IDLE;
+			next_action_us = now_us + (int64_t)fleet->idle_sec * 1000000;
+		}
+
+		if(main_event & SIM_EVENT_AUTHORIZED && state == eSIM_AUTHORIZING && ocpp_transaction_is_ready()){
+			send_status(OCPP_CP_STATUS_PREPARING);
+
+			int entry = -1;
+			if(ocpp_transaction_enqueue_start(1, SIM_ID_TAG, energy_wh, NULL, time(NULL), &entry) != 0){
+				ESP_LOGE(TAG, "[%s] Unable to enqueue start transaction", cbid);
+				state = eSIM_IDLE;
+				next_action_us = now_us + (int64_t)fleet->idle_sec * 1000000;
+			}else{
+				pthread_mutex_lock(&transaction_lock);
+				transaction_entry = entry;
+				transaction_id = entry;
+				transaction_id_is_valid = false;
+				pthread_mutex_unlock(&transaction_lock);
+
+				send_status(OCPP_CP_STATUS_CHARGING);
+				report.sessions_started++;
+
+				state = eSIM_CHARGING;
+				session_end_us = now_us + (int64_t)fleet->session_sec * 1000000;
+				last_meter_us = now_us;
+				next_action_us = now_us + (int64_t)fleet->meter_interval_sec * 1000000;
+			}
+		}
+
+		if(state == eSIM_IDLE && now_us >= next_action_us){
+			cJSON * request = ocpp_create_authorize_request(SIM_ID_TAG);
+			if(request != NULL && enqueue_call(request, authorize_result_cb, authorize_error_cb, NULL, eOCPP_CALL_GENERIC) == 0){
+				state = eSIM_AUTHORIZING;
+				next_action_us = now_us + 1000000;
+			}else{
+				cJSON_Delete(request);
+				next_action_us = now_us + (int64_t)fleet->idle_sec * 1000000;
+			}
+
+		}else if(state == eSIM_CHARGING && now_us >= next_action_us){
+			energy_wh += (uint32_t)((uint64_t)fleet->power_w * (now_us - last_meter_us) / 3600000000);
+			last_meter_us = now_us;
+
+			if(now_us >= session_end_us){
+				if(ocpp_transaction_enqueue_stop(SIM_ID_TAG, energy_wh, time(NULL), eOCPP_REASON_LOCAL, NULL) != 0)
+					ESP_LOGE(TAG, "[%s] Unable to enqueue stop transaction", cbid);
+
+				pthread_mutex_lock(&transaction_lock);
+				transaction_entry = -1;
+				pthread_mutex_unlock(&transaction_lock);
+
+				send_status(OCPP_CP_STATUS_FINISHING);
+				send_status(OCPP_CP_STATUS_AVAILABLE);
+				report.sessions_completed++;
+
+				state = eSIM_IDLE;
+				next_action_us = now_us + (int64_t)fleet->idle_sec * 1000000;
+
+			}else{
+				struct ocpp_meter_value_list * meter_values = create_meter_values(energy_wh, fleet->power_w);
+				if(meter_values != NULL){
+					pthread_mutex_lock(&transaction_lock);
+					int id = transaction_id;
+					bool valid = transaction_id_is_valid;
+					pthread_mutex_unlock(&transaction_lock);
+
+					if(ocpp_transaction_enqueue_meter_value(1, valid ? &id : NULL, meter_values) != 0)
+						ESP_LOGE(TAG, "[%s] Unable to enqueue meter values", cbid);
+
+					ocpp_meter_list_delete(meter_values);
+				}
+
+				next_action_us = now_us + (int64_t)fleet->meter_interval_sec * 1000000;
+				if(next_action_us > session_end_us)
+					next_action_us = session_end_us;
+			}
+		}else if(state == eSIM_AUTHORIZING && now_us >= next_action_us){
+			next_action_us = now_us + 1000000;
+		}
+
+		if((enqueued_calls > 0 || task_event & eOCPP_TASK_CALL_ENQUEUED) && awaiting_response == false && ocpp_is_connected()){
+			int64_t handle_us = esp_timer_get_time();
+
+			switch(handle_ocpp_call(&enqueued_calls)){
+			case ESP_OK:
+				report.calls_sent++;
+				sent_us = handle_us;
+				enqueued_calls = 1;
+				awaiting_response = true;
+				break;
+
+			case ESP_ERR_NOT_FOUND:
+				enqueued_calls = 0;
+				break;
+
+			case ESP_FAIL:
+				report.calls_failed++;
+				enqueued_calls = 1;
+				break;
+			}
+		}
+	}
+
+stop:
+	stop_ocpp();
+
+report:
+	report.run_us = esp_timer_get_time() - start_us;
+
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) == 0){
+		report.cpu_us = (int64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+			+ usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+	}
+
+	report.rss_peak_kb = read_rss_peak_kb();
+
+	if(write(report_fd, &report, sizeof(report)) != sizeof(report))
+		ESP_LOGE(TAG, "[%s] Unable to write report", cbid);
+}
+
+static int compare_int64(const void * a, const void * b){
+	int64_t lhs = *(const int64_t *)a;
+	int64_t rhs = *(const int64_t *)b;
+
+	return (lhs > rhs) - (lhs < rhs);
+}
+
+static void print_distribution(const char * name, const char * unit, int64_t * samples, size_t count){
+	if(count == 0){
+		printf("%-14s no samples\n", name);
+		return;
+	}
+
+	qsort(samples, count, sizeof(int64_t), compare_int64);
+
+	int64_t sum = 0;
+	for(size_t i = 0; i < count; i++)
+		sum += samples[i];
+
+	printf("%-14s min %" PRId64 " mean %" PRId64 " p50 %" PRId64 " p99 %" PRId64 " max %" PRId64 " %s\n", name,
+		samples[0], sum / (int64_t)count, samples[count * 50 / 100], samples[count * 99 / 100], samples[count - 1], unit);
+}
+
+static void print_fleet_report(struct fleet_report * reports, size_t report_count, size_t instance_count, int64_t elapsed_us){
+	int64_t * boot = malloc(sizeof(int64_t) * (report_count + 1));
+	int64_t * heap = malloc(sizeof(int64_t) * (report_count + 1));
+	int64_t * rss = malloc(sizeof(int64_t) * (report_count + 1));
+	int64_t * cpu_per_call = malloc(sizeof(int64_t) * (report_count + 1));
+
+	if(boot == NULL || heap == NULL || rss == NULL || cpu_per_call == NULL){
+		ESP_LOGE(TAG, "Unable to allocate for report");
+		goto cleanup;
+	}
+
+	size_t registered = 0, closed = 0, cpu_count = 0;
+	uint64_t calls_sent = 0, calls_timed_out = 0, calls_failed = 0, sessions_started = 0, sessions_completed = 0;
+	int64_t cpu_total = 0, rtt_total = 0, rtt_max = 0;
+
+	for(size_t i = 0; i < report_count; i++){
+		struct fleet_report * report = &reports[i];
+
+		heap[i] = report->heap_peak / 1024;
+		rss[i] = report->rss_peak_kb;
+		cpu_total += report->cpu_us;
+
+		if(report->closed)
+			closed++;
+
+		if(!report->registered)
+			continue;
+
+		boot[registered++] = report->boot_us / 1000;
+
+		calls_sent += report->calls_sent;
+		calls_timed_out += report->calls_timed_out;
+		calls_failed += report->calls_failed;
+		sessions_started += report->sessions_started;
+		sessions_completed += report->sessions_completed;
+		rtt_total += report->rtt_total_us;
+		if(report->rtt_max_us > rtt_max)
+			rtt_max = report->rtt_max_us;
+
+		if(report->calls_sent > 0)
+			cpu_per_call[cpu_count++] = report->cpu_us / report->calls_sent;
+	}
+
+	double elapsed = elapsed_us / 1000000.0;
+	uint64_t calls_answered = calls_sent - calls_timed_out;
+
+	printf("\ninstances      %zu started, %zu reported, %zu registered, %zu closed by CS\n",
+		instance_count, report_count, registered, closed);
+	printf("elapsed        %.3f s\n", elapsed);
+	printf("calls          sent %" PRIu64 " timeout %" PRIu64 " send failed %" PRIu64 "\n", calls_sent, calls_timed_out, calls_failed);
+	printf("throughput     %.1f msg/s\n", elapsed > 0 ? calls_sent / elapsed : 0.0);
+	printf("sessions       started %" PRIu64 " completed %" PRIu64 "\n", sessions_started, sessions_completed);
+	printf("rtt            mean %.3f max %.3f ms\n", calls_answered > 0 ? rtt_total / (double)calls_answered / 1000.0 : 0.0, rtt_max / 1000.0);
+	printf("cpu            total %.3f s, %.1f us/msg\n", cpu_total / 1000000.0, calls_sent > 0 ? cpu_total / (double)calls_sent : 0.0);
+
+	print_distribution("boot", "ms", boot, registered);
+	print_distribution("cpu/msg", "us", cpu_per_call, cpu_count);
+	print_distribution("heap peak", "kB", heap, report_count);
+	print_distribution("rss peak", "kB", rss, report_count);
+
+cleanup:
+	free(boot);
+	free(heap);
+	free(rss);
+	free(cpu_per_call);
+}
+
+static void usage(const char * program){
+	fprintf(stderr, "Usage: %s [-u url] [-p cbid prefix] [-n instances] [-d duration] [-r ramp] [-s session] [-g idle] [-i interval] [-w power] [-c] [-v log level]\n"
+		"  -u  central system url. Default ws://127.0.0.1:9000\n"
+		"  -p  charge box identity prefix, followed by the instance number. Default SIM\n"
+		"  -n  number of virtual chargers. Default 10\n"
+		"  -d  seconds to run after all instances are started. Default 60\n"
+		"  -r  instances started per second. Default 50\n"
+		"  -s  seconds per charge session. Default 30\n"
+		"  -g  seconds between charge sessions. Default 10\n"
+		"  -i  seconds between MeterValues.req. Default 10\n"
+		"  -w  simulated charging power in W. Default 11000\n"
+		"  -c  clear stored transactions instead of replaying them\n"
+		"  -v  esp_log level 0-5. Default 1 (error)\n", program);
+}
+
+int main(int argc, char ** argv){
+	struct fleet_config fleet = {
+		.url = "ws://127.0.0.1:9000",
+		.cbid_prefix = "SIM",
+		.instance_count = 10,
+		.duration_sec = 60,
+		.ramp_per_sec = 50,
+		.session_sec = 30,
+		.idle_sec = 10,
+		.meter_interval_sec = 10,
+		.power_w = 11000,
+		.clean = false,
+	};
+
+	esp_log_level_set("*", ESP_LOG_ERROR);
+
+	int option;
+	while((option = getopt(argc, argv, "u:p:n:d:r:s:g:i:w:cv:h")) != -1){
+		switch(option){
+		case 'u':
+			fleet.url = optarg;
+			break;
+		case 'p':
+			fleet.cbid_prefix = optarg;
+			break;
+		case 'n':
+			fleet.instance_count = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			fleet.duration_sec = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			fleet.ramp_per_sec = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			fleet.session_sec = strtoul(optarg, NULL, 0);
+			break;
+		case 'g':
+			fleet.idle_sec = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			fleet.meter_interval_sec = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			fleet.power_w = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			fleet.clean = true;
+			break;
+		case 'v':
+			esp_log_level_set("*", atoi(optarg));
+			break;
+		default:
+			usage(argv[0]);
+			return option == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	if(fleet.instance_count == 0 || fleet.ramp_per_sec == 0 || fleet.meter_interval_sec == 0){
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	pid_t * pids = calloc(fleet.instance_count, sizeof(pid_t));
+	struct fleet_report * reports = calloc(fleet.instance_count, sizeof(struct fleet_report));
+	if(pids == NULL || reports == NULL){
+		ESP_LOGE(TAG, "Unable to allocate for %zu instances", fleet.instance_count);
+		return EXIT_FAILURE;
+	}
+
+	int report_pipe[2];
+	if(pipe(report_pipe) != 0){
+		ESP_LOGE(TAG, "Unable to create report pipe: %s", strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	struct sigaction stop_action = {.sa_handler = on_stop_signal};
+	sigemptyset(&stop_action.sa_mask);
+	sigaction(SIGTERM, &stop_action, NULL);
+	sigaction(SIGINT, &stop_action, NULL);
+
+	/* No threads may exist in the parent before fork; the shims create them lazily in each instance */
+	int64_t start_us = esp_timer_get_time();
+	size_t started = 0;
+
+	for(; started < fleet.instance_count && !should_stop; started++){
+		pid_t pid = fork();
+		if(pid < 0){
+			ESP_LOGE(TAG, "Unable to fork instance %zu: %s", started, strerror(errno));
+			break;
+
+		}else if(pid == 0){
+			close(report_pipe[0]);
+			run_instance(&fleet, started, report_pipe[1]);
+			_exit(EXIT_SUCCESS);
+		}
+
+		pids[started] = pid;
+		usleep(1000000 / fleet.ramp_per_sec);
+	}
+
+	fprintf(stderr, "Started %zu instances, running for %" PRIu32 " sec\n", started, fleet.duration_sec);
+
+	for(uint32_t i = 0; i < fleet.duration_sec * 10 && !should_stop; i++)
+		usleep(100000);
+
+	int64_t elapsed_us = esp_timer_get_time() - start_us;
+
+	for(size_t i = 0; i < started; i++)
+		kill(pids[i], SIGTERM);
+
+	close(report_pipe[1]);
+
+	size_t report_count = 0;
+	while(report_count < started){
+		ssize_t read_length = read(report_pipe[0], &reports[report_count], sizeof(struct fleet_report));
+		if(read_length == sizeof(struct fleet_report)){
+			report_count++;
+		}else if(read_length < 0 && errno == EINTR){
+			continue;
+		}else{
+			break;
+		}
+	}
+
+	for(size_t i = 0; i < started; i++)
+		waitpid(pids[i], NULL, 0);
+
+	print_fleet_report(reports, report_count, started, elapsed_us);
+
+	free(pids);
+	free(reports);
+
+	return report_count == started ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,461 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "cJSON.h"
+
+#include "host_storage.h"
+
+#include "ocpp_task.h"
+#include "ocpp_listener.h"
+#include "messages/call_messages/ocpp_call_request.h"
+#include "types/ocpp_meter_value.h"
+#include "types/ocpp_charge_point_error_code.h"
+#include "types/ocpp_charge_point_status.h"
+
+/*
+ * Load harness for the host build of the ocpp component.
+ *
+ * Connects to a central system (ocpp_server/server.py by default), completes the boot notification
+ * process and then drives the same enqueue_call/handle_ocpp_call loop as main/ocpp.c with a configurable
+ * message mix. Reports message rate, latencies and memory use when all calls have completed.
+ */
+
+static const char * TAG = "OCPP LOAD      ";
+
+#define WEBSOCKET_EVENT_OFFSET 4
+#define WEBSOCKET_EVENT_MASK 0xf0
+#define TASK_EVENT_OFFSET 8
+#define TASK_EVENT_MASK 0xf00
+
+/* ocpp_task queues at most 5 calls; one slot is left for calls created by the component itself */
+#define LOAD_MAX_WINDOW 4
+
+enum load_message{
+	eLOAD_HEARTBEAT,
+	eLOAD_AUTHORIZE,
+	eLOAD_STATUS,
+	eLOAD_METER,
+	eLOAD_MESSAGE_COUNT
+};
+
+static const char * load_message_names[eLOAD_MESSAGE_COUNT] = {"heartbeat", "authorize", "status", "meter"};
+
+enum load_result{
+	eLOAD_PENDING,
+	eLOAD_OK,
+	eLOAD_ERROR,
+	eLOAD_TIMEOUT,
+};
+
+struct load_call{
+	enum load_message message;
+	enum load_result result;
+	int64_t enqueued_us;
+	int64_t sent_us;
+	int64_t completed_us;
+};
+
+static struct load_call * calls = NULL;
+static size_t call_count = 100;
+static size_t calls_enqueued = 0;
+static size_t calls_sent = 0;
+static size_t calls_completed = 0;
+static pthread_mutex_t calls_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static enum load_message mix[64];
+static size_t mix_length = 0;
+
+static void complete_call(struct load_call * call, enum load_result result){
+	pthread_mutex_lock(&calls_lock);
+
+	if(call->result == eLOAD_PENDING){
+		call->completed_us = esp_timer_get_time();
+		call->result = result;
+		calls_completed++;
+	}
+
+	pthread_mutex_unlock(&calls_lock);
+}
+
+static void load_result_cb(const char * unique_id, cJSON * payload, void * cb_data){
+	complete_call(cb_data, eLOAD_OK);
+}
+
+static void load_error_cb(const char * unique_id, const char * error_code, const char * error_description, cJSON * error_details, void * cb_data){
+	if(error_description != NULL && strcmp(error_description, "CP timeout") == 0){
+		complete_call(cb_data, eLOAD_TIMEOUT);
+	}else{
+		ESP_LOGW(TAG, "Call %s failed: [%s] '%s'", unique_id, error_code, error_description);
+		complete_call(cb_data, eLOAD_ERROR);
+	}
+}
+
+static cJSON * create_meter_values(void){
+	struct ocpp_sampled_value sampled_value = {
+		.context = eOCPP_CONTEXT_SAMPLE_PERIODIC,
+		.format = eOCPP_FORMAT_RAW,
+		.measurand = eOCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER,
+		.location = eOCPP_LOCATION_OUTLET,
+		.unit = eOCPP_UNIT_WH,
+	};
+	snprintf(sampled_value.value, sizeof(sampled_value.value), "%zu", calls_enqueued * 10);
+
+	struct ocpp_meter_value meter_value = {
+		.timestamp = time(NULL),
+		.sampled_value = ocpp_create_sampled_list(),
+	};
+
+	struct ocpp_meter_value_list * meter_list = ocpp_create_meter_list();
+	cJSON * call = NULL;
+
+	/* ocpp_meter_list_add copies the sampled values */
+	if(meter_value.sampled_value != NULL && meter_list != NULL
+		&& ocpp_sampled_list_add(meter_value.sampled_value, sampled_value) != NULL
+		&& ocpp_meter_list_add(meter_list, meter_value) != NULL){
+
+		call = ocpp_create_meter_values_request(1, NULL, meter_list);
+	}
+
+	ocpp_sampled_list_delete(meter_value.sampled_value);
+	ocpp_meter_list_delete(meter_list);
+
+	return call;
+}
+
+static cJSON * create_call(enum load_message message){
+	switch(message){
+	case eLOAD_HEARTBEAT:
+		return ocpp_create_heartbeat_request();
+	case eLOAD_AUTHORIZE:
+		return ocpp_create_authorize_request("load-test-tag");
+	case eLOAD_STATUS:
+		return ocpp_create_status_notification_request(1, OCPP_CP_ERROR_NO_ERROR, NULL, OCPP_CP_STATUS_AVAILABLE,
+							time(NULL), NULL, NULL);
+	case eLOAD_METER:
+		return create_meter_values();
+	default:
+		return NULL;
+	}
+}
+
+/* Keeps up to window calls in the ocpp_task queue. Returns the number of calls enqueued. */
+static size_t fill_window(size_t window){
+	size_t enqueued = 0;
+
+	while(calls_enqueued < call_count && calls_enqueued - calls_sent < window){
+		struct load_call * call = &calls[calls_enqueued];
+		call->message = mix[calls_enqueued % mix_length];
+
+		cJSON * request = create_call(call->message);
+		if(request == NULL){
+			ESP_LOGE(TAG, "Unable to create %s request", load_message_names[call->message]);
+			break;
+		}
+
+		call->enqueued_us = esp_timer_get_time();
+		if(enqueue_call(request, load_result_cb, load_error_cb, call, eOCPP_CALL_GENERIC) != 0){
+			ESP_LOGW(TAG, "Unable to enqueue call, retrying later");
+			cJSON_Delete(request);
+			break;
+		}
+
+		calls_enqueued++;
+		enqueued++;
+	}
+
+	return enqueued;
+}
+
+static int compare_int64(const void * a, const void * b){
+	int64_t lhs = *(const int64_t *)a;
+	int64_t rhs = *(const int64_t *)b;
+
+	return (lhs > rhs) - (lhs < rhs);
+}
+
+static void print_latency(const char * name, int64_t * samples, size_t count){
+	if(count == 0){
+		printf("%-12s no samples\n", name);
+		return;
+	}
+
+	qsort(samples, count, sizeof(int64_t), compare_int64);
+
+	int64_t sum = 0;
+	for(size_t i = 0; i < count; i++)
+		sum += samples[i];
+
+	printf("%-12s min %.3f mean %.3f p50 %.3f p90 %.3f p99 %.3f max %.3f ms\n", name,
+		samples[0] / 1000.0, sum / (double)count / 1000.0,
+		samples[count * 50 / 100] / 1000.0, samples[count * 90 / 100] / 1000.0,
+		samples[count * 99 / 100] / 1000.0, samples[count - 1] / 1000.0);
+}
+
+static void print_report(int64_t start_us, int64_t end_us){
+	size_t result_count[eLOAD_TIMEOUT + 1] = {0};
+	size_t message_count[eLOAD_MESSAGE_COUNT] = {0};
+
+	int64_t * rtt = malloc(sizeof(int64_t) * (call_count + 1));
+	int64_t * end_to_end = malloc(sizeof(int64_t) * (call_count + 1));
+	if(rtt == NULL || end_to_end == NULL){
+		ESP_LOGE(TAG, "Unable to allocate latency samples");
+		free(rtt);
+		free(end_to_end);
+		return;
+	}
+
+	size_t sample_count = 0;
+	for(size_t i = 0; i < calls_enqueued; i++){
+		result_count[calls[i].result]++;
+		message_count[calls[i].message]++;
+
+		if(calls[i].result == eLOAD_OK){
+			rtt[sample_count] = calls[i].completed_us - calls[i].sent_us;
+			end_to_end[sample_count] = calls[i].completed_us - calls[i].enqueued_us;
+			sample_count++;
+		}
+	}
+
+	double elapsed = (end_us - start_us) / 1000000.0;
+
+	printf("\ncalls        %zu (", calls_enqueued);
+	for(size_t i = 0; i < eLOAD_MESSAGE_COUNT; i++)
+		printf("%s%s %zu", i == 0 ? "" : ", ", load_message_names[i], message_count[i]);
+	printf(")\n");
+
+	printf("results      ok %zu error %zu timeout %zu pending %zu\n",
+		result_count[eLOAD_OK], result_count[eLOAD_ERROR], result_count[eLOAD_TIMEOUT], result_count[eLOAD_PENDING]);
+	printf("elapsed      %.3f s\n", elapsed);
+	printf("rate         %.1f msg/s\n", elapsed > 0 ? calls_completed / elapsed : 0.0);
+
+	print_latency("rtt", rtt, sample_count);
+	print_latency("end-to-end", end_to_end, sample_count);
+
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) == 0)
+		printf("peak rss     %ld kB\n", usage.ru_maxrss);
+
+	cJSON * diagnostics = ocpp_task_get_diagnostics();
+	if(diagnostics != NULL){
+		char * diagnostics_str = cJSON_Print(diagnostics);
+		if(diagnostics_str != NULL)
+			printf("diagnostics  %s\n", diagnostics_str);
+
+		free(diagnostics_str);
+		cJSON_Delete(diagnostics);
+	}
+
+	free(rtt);
+	free(end_to_end);
+}
+
+static int parse_mix(const char * mix_str){
+	char buffer[256];
+	strncpy(buffer, mix_str, sizeof(buffer) -1);
+	buffer[sizeof(buffer) -1] = '\0';
+
+	char * save_ptr = NULL;
+	for(char * name = strtok_r(buffer, ",", &save_ptr); name != NULL; name = strtok_r(NULL, ",", &save_ptr)){
+		if(mix_length >= sizeof(mix) / sizeof(mix[0]))
+			return -1;
+
+		size_t i;
+		for(i = 0; i < eLOAD_MESSAGE_COUNT; i++){
+			if(strcmp(name, load_message_names[i]) == 0)
+				break;
+		}
+
+		if(i == eLOAD_MESSAGE_COUNT){
+			fprintf(stderr, "Unknown message '%s'\n", name);
+			return -1;
+		}
+
+		mix[mix_length++] = i;
+	}
+
+	return mix_length > 0 ? 0 : -1;
+}
+
+static void usage(const char * program){
+	fprintf(stderr, "Usage: %s [-u url] [-i cbid] [-k authorization key] [-n calls] [-m mix] [-w window] [-v log level]\n"
+		"  -u  central system url. Default ws://127.0.0.1:9000\n"
+		"  -i  charge box identity appended to url. Default ZAP000001\n"
+		"  -n  number of calls to send. Default 100\n"
+		"  -m  comma separated message mix from heartbeat,authorize,status,meter. Default heartbeat\n"
+		"  -w  calls kept enqueued ahead of the active call (1-%d). Default %d\n"
+		"  -v  esp_log level 0-5. Default 2 (warning)\n", program, LOAD_MAX_WINDOW, LOAD_MAX_WINDOW);
+}
+
+int main(int argc, char ** argv){
+	struct ocpp_client_config config = {
+		.url = "ws://127.0.0.1:9000",
+		.cbid = "ZAP000001",
+		.authorization_key = NULL,
+		.heartbeat_interval = 86400,
+		.transaction_message_attempts = 3,
+		.transaction_message_retry_interval = 60,
+		.websocket_ping_interval = 10,
+		.security_profile = 0,
+	};
+
+	size_t window = LOAD_MAX_WINDOW;
+	esp_log_level_set("*", ESP_LOG_WARN);
+
+	int option;
+	while((option = getopt(argc, argv, "u:i:k:n:m:w:v:h")) != -1){
+		switch(option){
+		case 'u':
+			config.url = optarg;
+			break;
+		case 'i':
+			config.cbid = optarg;
+			break;
+		case 'k':
+			config.authorization_key = optarg;
+			config.security_profile = 1;
+			break;
+		case 'n':
+			call_count = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			if(parse_mix(optarg) != 0){
+				usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'w':
+			window = strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			esp_log_level_set("*", atoi(optarg));
+			break;
+		default:
+			usage(argv[0]);
+			return option == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	if(window < 1 || window > LOAD_MAX_WINDOW || call_count == 0){
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if(mix_length == 0)
+		mix[mix_length++] = eLOAD_HEARTBEAT;
+
+	calls = calloc(call_count, sizeof(struct load_call));
+	if(calls == NULL){
+		ESP_LOGE(TAG, "Unable to allocate %zu calls", call_count);
+		return EXIT_FAILURE;
+	}
+
+	if(host_storage_enter(config.cbid) != 0){
+		ESP_LOGE(TAG, "Unable to enter storage directory for '%s': %s", config.cbid, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	TaskHandle_t task = xTaskGetCurrentTaskHandle();
+
+	esp_err_t err = start_ocpp(&config);
+	if(err != ESP_OK){
+		ESP_LOGE(TAG, "Unable to start ocpp: %s", esp_err_to_name(err));
+		return EXIT_FAILURE;
+	}
+
+	ocpp_configure_task_notification(task, TASK_EVENT_OFFSET);
+	ocpp_configure_websocket_notification(task, WEBSOCKET_EVENT_OFFSET);
+
+	complete_boot_notification_process(NULL, "Host load test", config.cbid, "Zaptec", "host", NULL, NULL, NULL, NULL,
+					eOCPP_WEBSOCKET_CLOSED << WEBSOCKET_EVENT_OFFSET);
+
+	if(get_registration_status() != eOCPP_REGISTRATION_ACCEPTED){
+		ESP_LOGE(TAG, "Boot notification was not accepted");
+		stop_ocpp();
+		return EXIT_FAILURE;
+	}
+
+	stop_ocpp_heartbeat();
+
+	ESP_LOGW(TAG, "Registered, sending %zu calls with window %zu", call_count, window);
+
+	int enqueued_calls = 0;
+	bool awaiting_response = false;
+	int exit_status = EXIT_SUCCESS;
+
+	int64_t start_us = esp_timer_get_time();
+	enqueued_calls += fill_window(window);
+
+	while(true){
+		pthread_mutex_lock(&calls_lock);
+		bool done = calls_completed == call_count;
+		pthread_mutex_unlock(&calls_lock);
+
+		if(done)
+			break;
+
+		uint32_t data = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+
+		const uint websocket_event = (data & WEBSOCKET_EVENT_MASK) >> WEBSOCKET_EVENT_OFFSET;
+		const uint task_event = (data & TASK_EVENT_MASK) >> TASK_EVENT_OFFSET;
+
+		if(websocket_event & eOCPP_WEBSOCKET_RECEIVED_MATCHING)
+			awaiting_response = false;
+
+		if(websocket_event & eOCPP_WEBSOCKET_CLOSED){
+			ESP_LOGE(TAG, "Websocket closed by central system");
+			exit_status = EXIT_FAILURE;
+			break;
+		}
+
+		if(task_event & eOCPP_TASK_CALL_TIMEOUT){
+			timeout_active_call();
+			awaiting_response = false;
+		}
+
+		if((enqueued_calls > 0 || task_event & eOCPP_TASK_CALL_ENQUEUED) && awaiting_response == false && ocpp_is_connected()){
+			int64_t sent_us = esp_timer_get_time();
+
+			switch(handle_ocpp_call(&enqueued_calls)){
+			case ESP_OK:
+				/* Calls share the generic queue and are sent in the order they were enqueued */
+				if(calls_sent < calls_enqueued)
+					calls[calls_sent++].sent_us = sent_us;
+
+				enqueued_calls = 1;
+				awaiting_response = true;
+				break;
+
+			case ESP_ERR_NOT_FOUND:
+				enqueued_calls = 0;
+				break;
+
+			case ESP_FAIL:
+				ESP_LOGE(TAG, "Unable to handle ocpp call");
+				enqueued_calls = 1;
+				break;
+			}
+		}
+
+		if(fill_window(window) > 0)
+			enqueued_calls = 1;
+	}
+
+	int64_t end_us = esp_timer_get_time();
+
+	print_report(start_us, end_us);
+
+	stop_ocpp();
+	free(calls);
+
+	return exit_status;
+}
@@ -0,0 +1,357 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_crc.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#include "wpa_supplicant/base64.h"
+#include "host_storage.h"
+
+/*
+ * Host implementations of the small ESP-IDF functions used by the ocpp component.
+ */
+
+#define MAX_TAG_LEVELS 16
+
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static esp_log_level_t default_level = ESP_LOG_INFO;
+static bool default_level_read = false;
+static vprintf_like_t log_vprintf = vprintf;
+
+static struct{
+	char tag[24];
+	esp_log_level_t level;
+} tag_levels[MAX_TAG_LEVELS];
+static size_t tag_level_count = 0;
+
+static uint64_t start_us = 0;
+
+static uint64_t monotonic_us(void){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+int64_t esp_timer_get_time(void){
+	if(start_us == 0)
+		start_us = monotonic_us();
+
+	return monotonic_us() - start_us;
+}
+
+uint32_t esp_log_timestamp(void){
+	return esp_timer_get_time() / 1000;
+}
+
+void esp_log_level_set(const char * tag, esp_log_level_t level){
+	pthread_mutex_lock(&log_lock);
+
+	if(strcmp(tag, "*") == 0){
+		default_level = level;
+		default_level_read = true;
+		tag_level_count = 0;
+
+	}else{
+		size_t i;
+		for(i = 0; i < tag_level_count; i++){
+			if(strcmp(tag_levels[i].tag, tag) == 0)
+				break;
+		}
+
+		if(i < MAX_TAG_LEVELS){
+			strncpy(tag_levels[i].tag, tag, sizeof(tag_levels[i].tag) - 1);
+			tag_levels[i].level = level;
+
+			if(i == tag_level_count)
+				tag_level_count++;
+		}
+	}
+
+	pthread_mutex_unlock(&log_lock);
+}
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func){
+	pthread_mutex_lock(&log_lock);
+	vprintf_like_t previous = log_vprintf;
+	log_vprintf = func;
+	pthread_mutex_unlock(&log_lock);
+
+	return previous;
+}
+
+static esp_log_level_t level_for_tag(const char * tag){
+	if(!default_level_read){
+		const char * env = getenv("OCPP_HOST_LOG_LEVEL");
+		if(env != NULL)
+			default_level = (esp_log_level_t)atoi(env);
+
+		default_level_read = true;
+	}
+
+	for(size_t i = 0; i < tag_level_count; i++){
+		if(strcmp(tag_levels[i].tag, tag) == 0)
+			return tag_levels[i].level;
+	}
+
+	return default_level;
+}
+
+void esp_log_write(esp_log_level_t level, const char * tag, const char * format, ...){
+	pthread_mutex_lock(&log_lock);
+
+	if(level <= level_for_tag(tag)){
+		va_list args;
+		va_start(args, format);
+		log_vprintf(format, args);
+		va_end(args);
+	}
+
+	pthread_mutex_unlock(&log_lock);
+}
+
+void esp_log_buffer_hex_internal(const char * tag, const void * buffer, uint16_t buff_len, esp_log_level_t level){
+	const uint8_t * bytes = buffer;
+	char line[16 * 3 + 1];
+
+	for(uint16_t offset = 0; offset < buff_len; offset += 16){
+		size_t written = 0;
+		for(uint16_t i = offset; i < buff_len && i < offset + 16; i++)
+			written += snprintf(line + written, sizeof(line) - written, "%02x ", bytes[i]);
+
+		ESP_LOG_LEVEL(level, tag, "%s", line);
+	}
+}
+
+const char * esp_err_to_name(esp_err_t code){
+	switch(code){
+	case ESP_OK:
+		return "ESP_OK";
+	case ESP_FAIL:
+		return "ESP_FAIL";
+	case ESP_ERR_NO_MEM:
+		return "ESP_ERR_NO_MEM";
+	case ESP_ERR_INVALID_ARG:
+		return "ESP_ERR_INVALID_ARG";
+	case ESP_ERR_INVALID_STATE:
+		return "ESP_ERR_INVALID_STATE";
+	case ESP_ERR_INVALID_SIZE:
+		return "ESP_ERR_INVALID_SIZE";
+	case ESP_ERR_NOT_FOUND:
+		return "ESP_ERR_NOT_FOUND";
+	case ESP_ERR_NOT_SUPPORTED:
+		return "ESP_ERR_NOT_SUPPORTED";
+	case ESP_ERR_TIMEOUT:
+		return "ESP_ERR_TIMEOUT";
+	case ESP_ERR_INVALID_RESPONSE:
+		return "ESP_ERR_INVALID_RESPONSE";
+	case ESP_ERR_INVALID_CRC:
+		return "ESP_ERR_INVALID_CRC";
+	case ESP_ERR_INVALID_VERSION:
+		return "ESP_ERR_INVALID_VERSION";
+	case ESP_ERR_INVALID_MAC:
+		return "ESP_ERR_INVALID_MAC";
+	case ESP_ERR_NOT_FINISHED:
+		return "ESP_ERR_NOT_FINISHED";
+	case ESP_ERR_NOT_ALLOWED:
+		return "ESP_ERR_NOT_ALLOWED";
+	default:
+		return "UNKNOWN ERROR";
+	}
+}
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_table_once = PTHREAD_ONCE_INIT;
+
+static void create_crc_table(void){
+	for(uint32_t i = 0; i < 256; i++){
+		uint32_t value = i;
+		for(int bit = 0; bit < 8; bit++)
+			value = (value & 1) ? (value >> 1) ^ 0xEDB88320 : value >> 1;
+
+		crc_table[i] = value;
+	}
+}
+
+uint32_t esp_crc32_le(uint32_t crc, const uint8_t * buf, uint32_t len){
+	pthread_once(&crc_table_once, create_crc_table);
+
+	crc = ~crc;
+	for(uint32_t i = 0; i < len; i++)
+		crc = crc_table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+uint32_t esp_random(void){
+	uint32_t value;
+	esp_fill_random(&value, sizeof(value));
+
+	return value;
+}
+
+void esp_fill_random(void * buf, size_t len){
+	uint8_t * bytes = buf;
+	while(len > 0){
+		ssize_t read = getrandom(bytes, len, 0);
+		if(read <= 0)
+			abort();
+
+		bytes += read;
+		len -= read;
+	}
+}
+
+void esp_restart(void){
+	fprintf(stderr, "esp_restart called, exiting\n");
+	exit(EXIT_FAILURE);
+}
+
+uint32_t esp_get_free_heap_size(void){
+	return UINT32_MAX;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void){
+	return UINT32_MAX;
+}
+
+static const char base64_table[65] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+char * base64_encode(const void * src, size_t len, size_t * out_len){
+	const unsigned char * in = src;
+	size_t olen = len * 4 / 3 + 4;
+	olen += olen / 72; // line feeds
+	olen++; // null termination
+
+	if(olen < len)
+		return NULL;
+
+	char * out = malloc(olen);
+	if(out == NULL)
+		return NULL;
+
+	const unsigned char * end = in + len;
+	char * pos = out;
+	int line_len = 0;
+
+	while(end - in >= 3){
+		*pos++ = base64_table[in[0] >> 2];
+		*pos++ = base64_table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+		*pos++ = base64_table[((in[1] & 0x0f) << 2) | (in[2] >> 6)];
+		*pos++ = base64_table[in[2] & 0x3f];
+		in += 3;
+		line_len += 4;
+		if(line_len >= 72){
+			*pos++ = '\n';
+			line_len = 0;
+		}
+	}
+
+	if(end - in){
+		*pos++ = base64_table[in[0] >> 2];
+		if(end - in == 1){
+			*pos++ = base64_table[(in[0] & 0x03) << 4];
+			*pos++ = '=';
+		}else{
+			*pos++ = base64_table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+			*pos++ = base64_table[(in[1] & 0x0f) << 2];
+		}
+		*pos++ = '=';
+		line_len += 4;
+	}
+
+	if(line_len)
+		*pos++ = '\n';
+
+	*pos = '\0';
+	if(out_len)
+		*out_len = pos - out;
+
+	return out;
+}
+
+unsigned char * base64_decode(const char * src, size_t len, size_t * out_len){
+	unsigned char dtable[256];
+	memset(dtable, 0x80, 256);
+	for(size_t i = 0; i < sizeof(base64_table) - 1; i++)
+		dtable[(unsigned char)base64_table[i]] = (unsigned char)i;
+	dtable['='] = 0;
+
+	size_t count = 0;
+	for(size_t i = 0; i < len; i++){
+		if(dtable[(unsigned char)src[i]] != 0x80)
+			count++;
+	}
+
+	if(count == 0 || count % 4)
+		return NULL;
+
+	size_t olen = count / 4 * 3;
+	unsigned char * out = malloc(olen);
+	if(out == NULL)
+		return NULL;
+
+	unsigned char * pos = out;
+	unsigned char block[4];
+	int pad = 0;
+	count = 0;
+
+	for(size_t i = 0; i < len; i++){
+		unsigned char tmp = dtable[(unsigned char)src[i]];
+		if(tmp == 0x80)
+			continue;
+
+		if(src[i] == '=')
+			pad++;
+
+		block[count] = tmp;
+		count++;
+		if(count == 4){
+			*pos++ = (block[0] << 2) | (block[1] >> 4);
+			*pos++ = (block[1] << 4) | (block[2] >> 2);
+			*pos++ = (block[2] << 6) | block[3];
+			count = 0;
+			if(pad){
+				if(pad == 1){
+					pos--;
+				}else if(pad == 2){
+					pos -= 2;
+				}else{
+					free(out);
+					return NULL;
+				}
+				break;
+			}
+		}
+	}
+
+	*out_len = pos - out;
+	return out;
+}
+
+int host_storage_enter(const char * cbid){
+	char path[256];
+
+	if(mkdir(OCPP_HOST_FILE_PATH, 0755) != 0 && errno != EEXIST)
+		return -1;
+
+	if(snprintf(path, sizeof(path), "%s/%s", OCPP_HOST_FILE_PATH, cbid) >= sizeof(path)){
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+
+	if(mkdir(path, 0755) != 0 && errno != EEXIST)
+		return -1;
+
+	return chdir(path);
+}
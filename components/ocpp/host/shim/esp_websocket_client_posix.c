@@ -0,0 +1,685 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_websocket_client.h"
+#include "wpa_supplicant/base64.h"
+
+static const char * TAG = "WEBSOCKET HOST ";
+
+ESP_EVENT_DEFINE_BASE(WEBSOCKET_EVENTS);
+
+#define DEFAULT_BUFFER_SIZE 1024
+#define DEFAULT_RECONNECT_TIMEOUT_MS 10000
+#define DEFAULT_NETWORK_TIMEOUT_MS 10000
+#define MAX_HANDSHAKE_RESPONSE 2048
+#define MAX_CONTROL_PAYLOAD 125
+
+/*
+ * A single thread per client connects, reads frames and dispatches events, like the task of esp_websocket_client.
+ * Writes are done by the calling thread and serialized with write_lock. The Sec-WebSocket-Accept header of the
+ * handshake is not verified, the client is only meant for test servers.
+ */
+struct esp_websocket_client{
+	char * host;
+	char * port;
+	char * path;
+	char * subprotocol;
+	char * username;
+	char * password;
+	int buffer_size;
+	int reconnect_timeout_ms;
+	int network_timeout_ms;
+	size_t ping_interval_sec;
+	bool disable_auto_reconnect;
+	void * user_context;
+
+	esp_event_handler_t handler;
+	void * handler_args;
+
+	pthread_t thread;
+	bool thread_started;
+	pthread_mutex_t state_lock;
+	pthread_cond_t state_changed;
+	pthread_mutex_t write_lock;
+	int fd;
+	bool run;
+	bool connected;
+	bool close_sent;
+	char * rx_buffer;
+};
+
+static char * strdup_or_null(const char * str){
+	return str != NULL ? strdup(str) : NULL;
+}
+
+static void dispatch(esp_websocket_client_handle_t client, esp_websocket_event_id_t event_id, const char * data, int data_len,
+		uint8_t op_code, bool fin, int payload_len, int payload_offset){
+
+	if(client->handler == NULL)
+		return;
+
+	esp_websocket_event_data_t event_data = {
+		.data_ptr = data,
+		.data_len = data_len,
+		.fin = fin,
+		.op_code = op_code,
+		.client = client,
+		.user_context = client->user_context,
+		.payload_len = payload_len,
+		.payload_offset = payload_offset,
+	};
+
+	client->handler(client->handler_args, WEBSOCKET_EVENTS, event_id, &event_data);
+}
+
+static esp_err_t parse_uri(esp_websocket_client_handle_t client, const char * uri){
+	if(strncmp(uri, "ws://", 5) != 0){
+		ESP_LOGE(TAG, "Only ws:// uris are supported: '%s'", uri);
+		return ESP_ERR_NOT_SUPPORTED;
+	}
+
+	const char * host = uri + 5;
+	const char * path = strchr(host, '/');
+	if(path == NULL)
+		path = host + strlen(host);
+
+	const char * port = memchr(host, ':', path - host);
+	const char * host_end = port != NULL ? port : path;
+
+	client->host = strndup(host, host_end - host);
+	client->port = port != NULL ? strndup(port + 1, path - port - 1) : strdup("80");
+	client->path = strdup(*path != '\0' ? path : "/");
+
+	if(client->host == NULL || client->port == NULL || client->path == NULL)
+		return ESP_ERR_NO_MEM;
+
+	return ESP_OK;
+}
+
+esp_websocket_client_handle_t esp_websocket_client_init(const esp_websocket_client_config_t * config){
+	struct esp_websocket_client * client = calloc(1, sizeof(struct esp_websocket_client));
+	if(client == NULL)
+		return NULL;
+
+	if(parse_uri(client, config->uri) != ESP_OK)
+		goto error;
+
+	client->subprotocol = strdup_or_null(config->subprotocol);
+	client->username = strdup_or_null(config->username);
+	client->password = strdup_or_null(config->password);
+	client->buffer_size = config->buffer_size > 0 ? config->buffer_size : DEFAULT_BUFFER_SIZE;
+	client->reconnect_timeout_ms = config->reconnect_timeout_ms > 0 ? config->reconnect_timeout_ms : DEFAULT_RECONNECT_TIMEOUT_MS;
+	client->network_timeout_ms = config->network_timeout_ms > 0 ? config->network_timeout_ms : DEFAULT_NETWORK_TIMEOUT_MS;
+	client->ping_interval_sec = config->ping_interval_sec;
+	client->disable_auto_reconnect = config->disable_auto_reconnect;
+	client->user_context = config->user_context;
+	client->fd = -1;
+
+	client->rx_buffer = malloc(client->buffer_size);
+	if(client->rx_buffer == NULL)
+		goto error;
+
+	pthread_mutex_init(&client->state_lock, NULL);
+	pthread_cond_init(&client->state_changed, NULL);
+	pthread_mutex_init(&client->write_lock, NULL);
+
+	return client;
+
+error:
+	free(client->host);
+	free(client->port);
+	free(client->path);
+	free(client->subprotocol);
+	free(client->username);
+	free(client->password);
+	free(client);
+	return NULL;
+}
+
+esp_err_t esp_websocket_register_events(esp_websocket_client_handle_t client, esp_websocket_event_id_t event,
+					esp_event_handler_t event_handler, void * event_handler_arg){
+	if(client == NULL || event != WEBSOCKET_EVENT_ANY)
+		return ESP_ERR_INVALID_ARG;
+
+	client->handler = event_handler;
+	client->handler_args = event_handler_arg;
+
+	return ESP_OK;
+}
+
+static esp_err_t write_all(int fd, const void * data, size_t length){
+	const uint8_t * bytes = data;
+
+	while(length > 0){
+		ssize_t written = send(fd, bytes, length, MSG_NOSIGNAL);
+		if(written < 0){
+			if(errno == EINTR)
+				continue;
+
+			return ESP_FAIL;
+		}
+
+		bytes += written;
+		length -= written;
+	}
+
+	return ESP_OK;
+}
+
+static esp_err_t read_all(int fd, void * data, size_t length){
+	uint8_t * bytes = data;
+
+	while(length > 0){
+		ssize_t read_length = recv(fd, bytes, length, 0);
+		if(read_length < 0 && errno == EINTR)
+			continue;
+
+		if(read_length <= 0)
+			return ESP_FAIL;
+
+		bytes += read_length;
+		length -= read_length;
+	}
+
+	return ESP_OK;
+}
+
+static int write_frame(esp_websocket_client_handle_t client, uint8_t op_code, const char * data, size_t length){
+	uint8_t header[14];
+	size_t header_length = 2;
+
+	header[0] = 0x80 | op_code; // Fragmentation is not used when sending
+	if(length < 126){
+		header[1] = 0x80 | length;
+	}else if(length <= 0xffff){
+		header[1] = 0x80 | 126;
+		header[2] = length >> 8;
+		header[3] = length;
+		header_length = 4;
+	}else{
+		header[1] = 0x80 | 127;
+		for(int i = 0; i < 8; i++)
+			header[2 + i] = (uint64_t)length >> (56 - 8 * i);
+		header_length = 10;
+	}
+
+	uint8_t * mask = header + header_length;
+	esp_fill_random(mask, 4);
+	header_length += 4;
+
+	uint8_t * frame = malloc(header_length + length);
+	if(frame == NULL)
+		return -1;
+
+	memcpy(frame, header, header_length);
+	for(size_t i = 0; i < length; i++)
+		frame[header_length + i] = data[i] ^ mask[i % 4];
+
+	pthread_mutex_lock(&client->write_lock);
+	esp_err_t err = client->fd >= 0 ? write_all(client->fd, frame, header_length + length) : ESP_FAIL;
+	pthread_mutex_unlock(&client->write_lock);
+
+	free(frame);
+	return err == ESP_OK ? (int)length : -1;
+}
+
+static char * base64_line(const char * data, size_t length){
+	size_t encoded_length;
+	char * encoded = base64_encode(data, length, &encoded_length);
+	if(encoded == NULL)
+		return NULL;
+
+	size_t written = 0;
+	for(size_t i = 0; i < encoded_length; i++){
+		if(encoded[i] != '\n')
+			encoded[written++] = encoded[i];
+	}
+	encoded[written] = '\0';
+
+	return encoded;
+}
+
+static esp_err_t handshake(esp_websocket_client_handle_t client, int fd){
+	char key_bytes[16];
+	esp_fill_random(key_bytes, sizeof(key_bytes));
+
+	char * key = base64_line(key_bytes, sizeof(key_bytes));
+	char * authorization = NULL;
+
+	if(client->username != NULL){
+		char credentials[256];
+		int length = snprintf(credentials, sizeof(credentials), "%s:%s", client->username,
+				client->password != NULL ? client->password : "");
+		if(length < 0 || length >= sizeof(credentials)){
+			free(key);
+			return ESP_ERR_INVALID_SIZE;
+		}
+
+		authorization = base64_line(credentials, length);
+	}
+
+	char request[1024];
+	int length = snprintf(request, sizeof(request),
+			"GET %s HTTP/1.1\r\n"
+			"Host: %s:%s\r\n"
+			"Upgrade: websocket\r\n"
+			"Connection: Upgrade\r\n"
+			"Sec-WebSocket-Key: %s\r\n"
+			"Sec-WebSocket-Version: 13\r\n"
+			"%s%s%s"
+			"%s%s%s"
+			"\r\n",
+			client->path, client->host, client->port, key != NULL ? key : "",
+			client->subprotocol != NULL ? "Sec-WebSocket-Protocol: " : "",
+			client->subprotocol != NULL ? client->subprotocol : "",
+			client->subprotocol != NULL ? "\r\n" : "",
+			authorization != NULL ? "Authorization: Basic " : "",
+			authorization != NULL ? authorization : "",
+			authorization != NULL ? "\r\n" : "");
+
+	free(key);
+	free(authorization);
+
+	if(length < 0 || length >= sizeof(request))
+		return ESP_ERR_INVALID_SIZE;
+
+	if(write_all(fd, request, length) != ESP_OK)
+		return ESP_FAIL;
+
+	// Read byte by byte to not consume any frame sent right after the response
+	char response[MAX_HANDSHAKE_RESPONSE];
+	size_t response_length = 0;
+
+	while(response_length < sizeof(response) - 1){
+		if(read_all(fd, &response[response_length], 1) != ESP_OK)
+			return ESP_FAIL;
+
+		response_length++;
+		if(response_length >= 4 && memcmp(&response[response_length - 4], "\r\n\r\n", 4) == 0)
+			break;
+	}
+	response[response_length] = '\0';
+
+	if(strncmp(response, "HTTP/1.1 101", 12) != 0){
+		ESP_LOGE(TAG, "Handshake rejected: %.*s", (int)strcspn(response, "\r\n"), response);
+		return ESP_FAIL;
+	}
+
+	return ESP_OK;
+}
+
+static int connect_to_server(esp_websocket_client_handle_t client){
+	struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+	struct addrinfo * addresses;
+
+	if(getaddrinfo(client->host, client->port, &hints, &addresses) != 0){
+		ESP_LOGE(TAG, "Unable to resolve %s", client->host);
+		return -1;
+	}
+
+	int fd = -1;
+	for(struct addrinfo * address = addresses; address != NULL; address = address->ai_next){
+		fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		if(fd < 0)
+			continue;
+
+		struct timeval timeout = {
+			.tv_sec = client->network_timeout_ms / 1000,
+			.tv_usec = (client->network_timeout_ms % 1000) * 1000
+		};
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+		int no_delay = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+		if(connect(fd, address->ai_addr, address->ai_addrlen) == 0)
+			break;
+
+		close(fd);
+		fd = -1;
+	}
+
+	freeaddrinfo(addresses);
+
+	if(fd < 0){
+		ESP_LOGE(TAG, "Unable to connect to %s:%s", client->host, client->port);
+		return -1;
+	}
+
+	if(handshake(client, fd) != ESP_OK){
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+/*
+ * Reads one frame and dispatches it in parts of at most buffer_size. Returns ESP_ERR_INVALID_STATE when the connection
+ * was closed by a close frame.
+ */
+static esp_err_t read_frame(esp_websocket_client_handle_t client){
+	uint8_t header[2];
+	if(read_all(client->fd, header, sizeof(header)) != ESP_OK)
+		return ESP_FAIL;
+
+	bool fin = header[0] & 0x80;
+	uint8_t op_code = header[0] & 0x0f;
+	bool masked = header[1] & 0x80;
+	uint64_t payload_len = header[1] & 0x7f;
+
+	if(payload_len == 126){
+		uint8_t extended[2];
+		if(read_all(client->fd, extended, sizeof(extended)) != ESP_OK)
+			return ESP_FAIL;
+		payload_len = ((uint64_t)extended[0] << 8) | extended[1];
+
+	}else if(payload_len == 127){
+		uint8_t extended[8];
+		if(read_all(client->fd, extended, sizeof(extended)) != ESP_OK)
+			return ESP_FAIL;
+
+		payload_len = 0;
+		for(int i = 0; i < 8; i++)
+			payload_len = (payload_len << 8) | extended[i];
+	}
+
+	uint8_t mask[4] = {0};
+	if(masked && read_all(client->fd, mask, sizeof(mask)) != ESP_OK)
+		return ESP_FAIL;
+
+	if(payload_len > INT32_MAX){
+		ESP_LOGE(TAG, "Frame too large");
+		return ESP_FAIL;
+	}
+
+	if(op_code >= WS_TRANSPORT_OPCODES_CLOSE && payload_len > MAX_CONTROL_PAYLOAD){
+		ESP_LOGE(TAG, "Control frame too large");
+		return ESP_FAIL;
+	}
+
+	size_t offset = 0;
+	do{
+		size_t part = payload_len - offset;
+		if(part > client->buffer_size)
+			part = client->buffer_size;
+
+		if(read_all(client->fd, client->rx_buffer, part) != ESP_OK)
+			return ESP_FAIL;
+
+		if(masked){
+			for(size_t i = 0; i < part; i++)
+				client->rx_buffer[i] ^= mask[(offset + i) % 4];
+		}
+
+		dispatch(client, WEBSOCKET_EVENT_DATA, client->rx_buffer, part, op_code, fin && offset + part == payload_len,
+			payload_len, offset);
+
+		offset += part;
+	}while(offset < payload_len);
+
+	switch(op_code){
+	case WS_TRANSPORT_OPCODES_PING:
+		write_frame(client, WS_TRANSPORT_OPCODES_PONG, client->rx_buffer, payload_len);
+		break;
+
+	case WS_TRANSPORT_OPCODES_CLOSE:
+		if(!client->close_sent){
+			client->close_sent = true;
+			write_frame(client, WS_TRANSPORT_OPCODES_CLOSE, client->rx_buffer, payload_len >= 2 ? 2 : 0);
+		}
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	return ESP_OK;
+}
+
+static bool should_run(esp_websocket_client_handle_t client){
+	pthread_mutex_lock(&client->state_lock);
+	bool run = client->run;
+	pthread_mutex_unlock(&client->state_lock);
+
+	return run;
+}
+
+static void set_connection(esp_websocket_client_handle_t client, int fd){
+	pthread_mutex_lock(&client->state_lock);
+	pthread_mutex_lock(&client->write_lock);
+
+	if(fd < 0 && client->fd >= 0)
+		close(client->fd);
+
+	client->fd = fd;
+	client->connected = fd >= 0;
+	client->close_sent = false;
+
+	pthread_mutex_unlock(&client->write_lock);
+	pthread_cond_broadcast(&client->state_changed);
+	pthread_mutex_unlock(&client->state_lock);
+}
+
+static void wait_for_reconnect(esp_websocket_client_handle_t client){
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += client->reconnect_timeout_ms / 1000;
+	deadline.tv_nsec += (client->reconnect_timeout_ms % 1000) * 1000000;
+	if(deadline.tv_nsec >= 1000000000){
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&client->state_lock);
+	while(client->run){
+		if(pthread_cond_timedwait(&client->state_changed, &client->state_lock, &deadline) == ETIMEDOUT)
+			break;
+	}
+	pthread_mutex_unlock(&client->state_lock);
+}
+
+static void * client_thread(void * arg){
+	esp_websocket_client_handle_t client = arg;
+
+	while(should_run(client)){
+		dispatch(client, WEBSOCKET_EVENT_BEFORE_CONNECT, NULL, 0, 0, false, 0, 0);
+
+		int fd = connect_to_server(client);
+		if(fd < 0){
+			dispatch(client, WEBSOCKET_EVENT_ERROR, NULL, 0, 0, false, 0, 0);
+
+			if(client->disable_auto_reconnect)
+				break;
+
+			wait_for_reconnect(client);
+			continue;
+		}
+
+		set_connection(client, fd);
+		dispatch(client, WEBSOCKET_EVENT_CONNECTED, NULL, 0, 0, false, 0, 0);
+
+		time_t last_ping = time(NULL);
+		esp_err_t err = ESP_OK;
+
+		while(should_run(client)){
+			struct pollfd poll_fd = {.fd = fd, .events = POLLIN};
+			int ready = poll(&poll_fd, 1, 1000);
+
+			if(ready < 0 && errno != EINTR){
+				err = ESP_FAIL;
+				break;
+			}
+
+			if(ready > 0){
+				err = read_frame(client);
+				if(err != ESP_OK)
+					break;
+			}
+
+			if(client->ping_interval_sec > 0 && time(NULL) - last_ping >= client->ping_interval_sec){
+				write_frame(client, WS_TRANSPORT_OPCODES_PING, NULL, 0);
+				last_ping = time(NULL);
+			}
+		}
+
+		set_connection(client, -1);
+
+		if(err == ESP_ERR_INVALID_STATE){
+			// Closed with close frames, the client does not reconnect
+			dispatch(client, WEBSOCKET_EVENT_CLOSED, NULL, 0, 0, false, 0, 0);
+			break;
+		}
+
+		dispatch(client, WEBSOCKET_EVENT_DISCONNECTED, NULL, 0, 0, false, 0, 0);
+
+		if(client->disable_auto_reconnect)
+			break;
+
+		if(should_run(client))
+			wait_for_reconnect(client);
+	}
+
+	pthread_mutex_lock(&client->state_lock);
+	client->run = false;
+	pthread_cond_broadcast(&client->state_changed);
+	pthread_mutex_unlock(&client->state_lock);
+
+	return NULL;
+}
+
+esp_err_t esp_websocket_client_start(esp_websocket_client_handle_t client){
+	if(client == NULL)
+		return ESP_ERR_INVALID_ARG;
+
+	if(client->thread_started){
+		ESP_LOGE(TAG, "Client already started");
+		return ESP_FAIL;
+	}
+
+	client->run = true;
+	if(pthread_create(&client->thread, NULL, client_thread, client) != 0){
+		client->run = false;
+		return ESP_FAIL;
+	}
+
+	client->thread_started = true;
+	return ESP_OK;
+}
+
+esp_err_t esp_websocket_client_stop(esp_websocket_client_handle_t client){
+	if(client == NULL)
+		return ESP_ERR_INVALID_ARG;
+
+	if(!client->thread_started)
+		return ESP_FAIL;
+
+	if(pthread_equal(pthread_self(), client->thread)){
+		ESP_LOGE(TAG, "Client can not be stopped from its own event handler");
+		return ESP_FAIL;
+	}
+
+	pthread_mutex_lock(&client->state_lock);
+	client->run = false;
+	if(client->fd >= 0)
+		shutdown(client->fd, SHUT_RDWR);
+	pthread_cond_broadcast(&client->state_changed);
+	pthread_mutex_unlock(&client->state_lock);
+
+	pthread_join(client->thread, NULL);
+	client->thread_started = false;
+
+	return ESP_OK;
+}
+
+esp_err_t esp_websocket_client_close(esp_websocket_client_handle_t client, TickType_t timeout){
+	if(client == NULL)
+		return ESP_ERR_INVALID_ARG;
+
+	if(esp_websocket_client_is_connected(client)){
+		const char normal_closure[2] = {0x03, (char)0xe8}; // 1000
+		client->close_sent = true;
+		write_frame(client, WS_TRANSPORT_OPCODES_CLOSE, normal_closure, sizeof(normal_closure));
+
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += pdTICKS_TO_MS(timeout) / 1000;
+		deadline.tv_nsec += (pdTICKS_TO_MS(timeout) % 1000) * 1000000;
+		if(deadline.tv_nsec >= 1000000000){
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+
+		pthread_mutex_lock(&client->state_lock);
+		while(client->connected){
+			if(pthread_cond_timedwait(&client->state_changed, &client->state_lock, &deadline) == ETIMEDOUT)
+				break;
+		}
+		pthread_mutex_unlock(&client->state_lock);
+	}
+
+	return esp_websocket_client_stop(client);
+}
+
+esp_err_t esp_websocket_client_destroy(esp_websocket_client_handle_t client){
+	if(client == NULL)
+		return ESP_ERR_INVALID_ARG;
+
+	if(client->thread_started)
+		esp_websocket_client_stop(client);
+
+	pthread_mutex_destroy(&client->state_lock);
+	pthread_cond_destroy(&client->state_changed);
+	pthread_mutex_destroy(&client->write_lock);
+
+	free(client->rx_buffer);
+	free(client->host);
+	free(client->port);
+	free(client->path);
+	free(client->subprotocol);
+	free(client->username);
+	free(client->password);
+	free(client);
+
+	return ESP_OK;
+}
+
+int esp_websocket_client_send_text(esp_websocket_client_handle_t client, const char * data, int len, TickType_t timeout){
+	if(client == NULL || data == NULL || len < 0)
+		return -1;
+
+	if(!esp_websocket_client_is_connected(client)){
+		ESP_LOGE(TAG, "Websocket client is not connected");
+		return -1;
+	}
+
+	return write_frame(client, WS_TRANSPORT_OPCODES_TEXT, data, len);
+}
+
+bool esp_websocket_client_is_connected(esp_websocket_client_handle_t client){
+	if(client == NULL)
+		return false;
+
+	pthread_mutex_lock(&client->state_lock);
+	bool connected = client->connected;
+	pthread_mutex_unlock(&client->state_lock);
+
+	return connected;
+}
+
+esp_err_t esp_websocket_client_set_ping_interval_sec(esp_websocket_client_handle_t client, size_t ping_interval_sec){
+	if(client == NULL)
+		return ESP_ERR_INVALID_ARG;
+
+	client->ping_interval_sec = ping_interval_sec;
+	return ESP_OK;
+}
@@ -0,0 +1,744 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+
+/*
+ * All blocking calls wait on condition variables using CLOCK_MONOTONIC. A tick is one millisecond, so timeouts given
+ * with pdMS_TO_TICKS behave like on the charger. Priorities are ignored.
+ */
+
+struct host_task{
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t notified;
+	uint32_t notify_value;
+	bool notify_pending;
+	TaskFunction_t function;
+	void * parameters;
+	uint32_t stack_depth;
+	char name[16];
+};
+
+enum host_queue_type{
+	eHOST_QUEUE,
+	eHOST_SEMAPHORE,
+	eHOST_MUTEX,
+	eHOST_RECURSIVE_MUTEX,
+};
+
+struct host_queue{
+	enum host_queue_type type;
+	pthread_mutex_t lock;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+	UBaseType_t length;
+	UBaseType_t item_size;
+	UBaseType_t count;
+	UBaseType_t head;
+	uint8_t * items;
+	TaskHandle_t holder; ///< Task holding a mutex
+	UBaseType_t recursion; ///< Number of times a recursive mutex is taken by the holder
+};
+
+struct host_timer{
+	struct host_timer * next;
+	char name[16];
+	TickType_t period;
+	TickType_t expiry;
+	bool auto_reload;
+	bool active;
+	bool deleted; ///< Deleted by its own callback, freed when the callback returns
+	void * timer_id;
+	TimerCallbackFunction_t callback;
+};
+
+static pthread_mutex_t critical_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread TaskHandle_t current_task = NULL;
+
+static pthread_once_t timer_service_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_changed;
+static struct host_timer * timers = NULL;
+static struct host_timer * running_timer = NULL;
+
+void host_enter_critical(void){
+	pthread_mutex_lock(&critical_lock);
+}
+
+void host_exit_critical(void){
+	pthread_mutex_unlock(&critical_lock);
+}
+
+static uint64_t monotonic_ms(void){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+TickType_t xTaskGetTickCount(void){
+	static uint64_t start = 0;
+	if(start == 0)
+		start = monotonic_ms();
+
+	return (TickType_t)(monotonic_ms() - start);
+}
+
+static void cond_init(pthread_cond_t * cond){
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(cond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+static void deadline_from_ticks(struct timespec * deadline, TickType_t ticks){
+	clock_gettime(CLOCK_MONOTONIC, deadline);
+	uint64_t ms = pdTICKS_TO_MS(ticks);
+
+	deadline->tv_sec += ms / 1000;
+	deadline->tv_nsec += (ms % 1000) * 1000000;
+	if(deadline->tv_nsec >= 1000000000){
+		deadline->tv_sec++;
+		deadline->tv_nsec -= 1000000000;
+	}
+}
+
+/*
+ * Waits on cond until signalled or the deadline has passed. Returns false on timeout. Spurious wake ups must be handled
+ * by the caller rechecking its condition.
+ */
+static bool cond_wait_until(pthread_cond_t * cond, pthread_mutex_t * lock, TickType_t ticks, const struct timespec * deadline){
+	if(ticks == portMAX_DELAY){
+		pthread_cond_wait(cond, lock);
+		return true;
+	}
+
+	return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
+
+static struct host_task * task_create_struct(const char * name, uint32_t stack_depth){
+	struct host_task * task = calloc(1, sizeof(struct host_task));
+	if(task == NULL)
+		return NULL;
+
+	pthread_mutex_init(&task->lock, NULL);
+	cond_init(&task->notified);
+	strncpy(task->name, name, sizeof(task->name) - 1);
+	task->stack_depth = stack_depth;
+
+	return task;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void){
+	// Threads not created with xTaskCreate, like main, become tasks when first needed
+	if(current_task == NULL){
+		current_task = task_create_struct("host", 0);
+		if(current_task != NULL)
+			current_task->thread = pthread_self();
+	}
+
+	return current_task;
+}
+
+static void * task_entry(void * arg){
+	struct host_task * task = arg;
+	current_task = task;
+
+	task->function(task->parameters);
+
+	return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task_function, const char * name, uint32_t stack_depth, void * parameters,
+		UBaseType_t priority, TaskHandle_t * task_out){
+
+	struct host_task * task = task_create_struct(name != NULL ? name : "", stack_depth);
+	if(task == NULL)
+		return pdFAIL;
+
+	task->function = task_function;
+	task->parameters = parameters;
+
+	if(task_out != NULL)
+		*task_out = task;
+
+	if(pthread_create(&task->thread, NULL, task_entry, task) != 0){
+		if(task_out != NULL)
+			*task_out = NULL;
+		free(task);
+		return pdFAIL;
+	}
+
+	pthread_detach(task->thread);
+	return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task_function, const char * name, uint32_t stack_depth, void * parameters,
+				UBaseType_t priority, TaskHandle_t * task_out, BaseType_t core_id){
+	return xTaskCreate(task_function, name, stack_depth, parameters, priority, task_out);
+}
+
+void vTaskDelete(TaskHandle_t task){
+	if(task == NULL || task == current_task){
+		/*
+		 * The task struct is not freed as other threads may still hold the handle and notify it, like on the
+		 * charger where the handle of a deleted task must not be used either.
+		 */
+		pthread_exit(NULL);
+	}
+
+	// Threads can not be safely killed. Only tasks deleting themselves are supported.
+	abort();
+}
+
+void vTaskDelay(TickType_t ticks){
+	uint64_t ms = pdTICKS_TO_MS(ticks);
+	struct timespec delay = {.tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000};
+
+	while(nanosleep(&delay, &delay) != 0 && errno == EINTR);
+}
+
+const char * pcTaskGetName(TaskHandle_t task){
+	if(task == NULL)
+		task = xTaskGetCurrentTaskHandle();
+
+	return task->name;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task){
+	if(task == NULL)
+		task = xTaskGetCurrentTaskHandle();
+
+	return task->stack_depth;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action){
+	BaseType_t result = pdPASS;
+
+	pthread_mutex_lock(&task->lock);
+
+	switch(action){
+	case eNoAction:
+		break;
+	case eSetBits:
+		task->notify_value |= value;
+		break;
+	case eIncrement:
+		task->notify_value++;
+		break;
+	case eSetValueWithOverwrite:
+		task->notify_value = value;
+		break;
+	case eSetValueWithoutOverwrite:
+		if(task->notify_pending){
+			result = pdFAIL;
+		}else{
+			task->notify_value = value;
+		}
+		break;
+	}
+
+	task->notify_pending = true;
+	pthread_cond_broadcast(&task->notified);
+	pthread_mutex_unlock(&task->lock);
+
+	return result;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task){
+	return xTaskNotify(task, 0, eIncrement);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t * value_out, TickType_t ticks_to_wait){
+	struct host_task * task = xTaskGetCurrentTaskHandle();
+	struct timespec deadline;
+	deadline_from_ticks(&deadline, ticks_to_wait);
+
+	pthread_mutex_lock(&task->lock);
+
+	if(!task->notify_pending)
+		task->notify_value &= ~clear_on_entry;
+
+	while(!task->notify_pending && ticks_to_wait != 0){
+		if(!cond_wait_until(&task->notified, &task->lock, ticks_to_wait, &deadline))
+			break;
+	}
+
+	if(value_out != NULL)
+		*value_out = task->notify_value;
+
+	BaseType_t result = pdFALSE;
+	if(task->notify_pending){
+		task->notify_value &= ~clear_on_exit;
+		result = pdTRUE;
+	}
+
+	task->notify_pending = false;
+	pthread_mutex_unlock(&task->lock);
+
+	return result;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait){
+	struct host_task * task = xTaskGetCurrentTaskHandle();
+	struct timespec deadline;
+	deadline_from_ticks(&deadline, ticks_to_wait);
+
+	pthread_mutex_lock(&task->lock);
+
+	while(task->notify_value == 0 && ticks_to_wait != 0){
+		if(!cond_wait_until(&task->notified, &task->lock, ticks_to_wait, &deadline))
+			break;
+	}
+
+	uint32_t value = task->notify_value;
+	if(value != 0){
+		if(clear_on_exit){
+			task->notify_value = 0;
+		}else{
+			task->notify_value--;
+		}
+	}
+
+	task->notify_pending = false;
+	pthread_mutex_unlock(&task->lock);
+
+	return value;
+}
+
+static struct host_queue * queue_create(enum host_queue_type type, UBaseType_t length, UBaseType_t item_size){
+	struct host_queue * queue = calloc(1, sizeof(struct host_queue));
+	if(queue == NULL)
+		return NULL;
+
+	if(item_size > 0){
+		queue->items = malloc((size_t)length * item_size);
+		if(queue->items == NULL){
+			free(queue);
+			return NULL;
+		}
+	}
+
+	queue->type = type;
+	queue->length = length;
+	queue->item_size = item_size;
+	pthread_mutex_init(&queue->lock, NULL);
+	cond_init(&queue->not_empty);
+	cond_init(&queue->not_full);
+
+	return queue;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size){
+	if(length == 0)
+		return NULL;
+
+	return queue_create(eHOST_QUEUE, length, item_size);
+}
+
+void vQueueDelete(QueueHandle_t queue){
+	if(queue == NULL)
+		return;
+
+	pthread_mutex_destroy(&queue->lock);
+	pthread_cond_destroy(&queue->not_empty);
+	pthread_cond_destroy(&queue->not_full);
+	free(queue->items);
+	free(queue);
+}
+
+static BaseType_t queue_send(QueueHandle_t queue, const void * item, TickType_t ticks_to_wait, bool to_front, bool overwrite){
+	struct timespec deadline;
+	deadline_from_ticks(&deadline, ticks_to_wait);
+
+	pthread_mutex_lock(&queue->lock);
+
+	while(queue->count == queue->length && !overwrite){
+		if(ticks_to_wait == 0 || !cond_wait_until(&queue->not_full, &queue->lock, ticks_to_wait, &deadline)){
+			if(queue->count == queue->length){
+				pthread_mutex_unlock(&queue->lock);
+				return errQUEUE_FULL;
+			}
+		}
+	}
+
+	if(queue->item_size > 0){
+		UBaseType_t index;
+		if(overwrite && queue->count == queue->length){
+			index = queue->head;
+			queue->count--;
+		}else if(to_front){
+			queue->head = (queue->head + queue->length - 1) % queue->length;
+			index = queue->head;
+		}else{
+			index = (queue->head + queue->count) % queue->length;
+		}
+
+		memcpy(queue->items + (size_t)index * queue->item_size, item, queue->item_size);
+	}else if(overwrite && queue->count == queue->length){
+		queue->count--;
+	}
+
+	queue->count++;
+	pthread_cond_signal(&queue->not_empty);
+	pthread_mutex_unlock(&queue->lock);
+
+	return pdPASS;
+}
+
+static BaseType_t queue_receive(QueueHandle_t queue, void * item_out, TickType_t ticks_to_wait, bool peek){
+	struct timespec deadline;
+	deadline_from_ticks(&deadline, ticks_to_wait);
+
+	pthread_mutex_lock(&queue->lock);
+
+	while(queue->count == 0){
+		if(ticks_to_wait == 0 || !cond_wait_until(&queue->not_empty, &queue->lock, ticks_to_wait, &deadline)){
+			if(queue->count == 0){
+				pthread_mutex_unlock(&queue->lock);
+				return errQUEUE_EMPTY;
+			}
+		}
+	}
+
+	if(queue->item_size > 0)
+		memcpy(item_out, queue->items + (size_t)queue->head * queue->item_size, queue->item_size);
+
+	if(!peek){
+		queue->head = (queue->head + 1) % queue->length;
+		queue->count--;
+		pthread_cond_signal(&queue->not_full);
+	}else{
+		pthread_cond_signal(&queue->not_empty); // Let other waiting receivers see the item
+	}
+
+	pthread_mutex_unlock(&queue->lock);
+
+	return pdPASS;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void * item, TickType_t ticks_to_wait){
+	return queue_send(queue, item, ticks_to_wait, false, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void * item, TickType_t ticks_to_wait){
+	return queue_send(queue, item, ticks_to_wait, true, false);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void * item){
+	return queue_send(queue, item, 0, false, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void * item_out, TickType_t ticks_to_wait){
+	return queue_receive(queue, item_out, ticks_to_wait, false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void * item_out, TickType_t ticks_to_wait){
+	return queue_receive(queue, item_out, ticks_to_wait, true);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue){
+	pthread_mutex_lock(&queue->lock);
+	queue->count = 0;
+	queue->head = 0;
+	pthread_cond_broadcast(&queue->not_full);
+	pthread_mutex_unlock(&queue->lock);
+
+	return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue){
+	pthread_mutex_lock(&queue->lock);
+	UBaseType_t count = queue->count;
+	pthread_mutex_unlock(&queue->lock);
+
+	return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue){
+	pthread_mutex_lock(&queue->lock);
+	UBaseType_t spaces = queue->length - queue->count;
+	pthread_mutex_unlock(&queue->lock);
+
+	return spaces;
+}
+
+/*
+ * Semaphores are queues with an item size of 0 where count is the number of available tokens, like in FreeRTOS.
+ */
+SemaphoreHandle_t xSemaphoreCreateMutex(void){
+	struct host_queue * mutex = queue_create(eHOST_MUTEX, 1, 0);
+	if(mutex != NULL)
+		mutex->count = 1;
+
+	return mutex;
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void){
+	struct host_queue * mutex = queue_create(eHOST_RECURSIVE_MUTEX, 1, 0);
+	if(mutex != NULL)
+		mutex->count = 1;
+
+	return mutex;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void){
+	return queue_create(eHOST_SEMAPHORE, 1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count){
+	struct host_queue * semaphore = queue_create(eHOST_SEMAPHORE, max_count, 0);
+	if(semaphore != NULL)
+		semaphore->count = initial_count;
+
+	return semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait){
+	BaseType_t result = queue_receive(semaphore, NULL, ticks_to_wait, false);
+
+	if(result == pdPASS && semaphore->type != eHOST_SEMAPHORE){
+		pthread_mutex_lock(&semaphore->lock);
+		semaphore->holder = xTaskGetCurrentTaskHandle();
+		pthread_mutex_unlock(&semaphore->lock);
+	}
+
+	return result;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore){
+	if(semaphore->type != eHOST_SEMAPHORE){
+		pthread_mutex_lock(&semaphore->lock);
+		bool is_holder = semaphore->holder == xTaskGetCurrentTaskHandle();
+		if(is_holder)
+			semaphore->holder = NULL;
+		pthread_mutex_unlock(&semaphore->lock);
+
+		// Giving a mutex not held by the calling task fails in FreeRTOS
+		if(!is_holder)
+			return pdFAIL;
+	}
+
+	return queue_send(semaphore, NULL, 0, false, false);
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait){
+	pthread_mutex_lock(&semaphore->lock);
+	if(semaphore->holder == xTaskGetCurrentTaskHandle()){
+		semaphore->recursion++;
+		pthread_mutex_unlock(&semaphore->lock);
+		return pdPASS;
+	}
+	pthread_mutex_unlock(&semaphore->lock);
+
+	BaseType_t result = xSemaphoreTake(semaphore, ticks_to_wait);
+	if(result == pdPASS)
+		semaphore->recursion = 1;
+
+	return result;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore){
+	pthread_mutex_lock(&semaphore->lock);
+	if(semaphore->holder != xTaskGetCurrentTaskHandle()){
+		pthread_mutex_unlock(&semaphore->lock);
+		return pdFAIL;
+	}
+
+	if(--semaphore->recursion > 0){
+		pthread_mutex_unlock(&semaphore->lock);
+		return pdPASS;
+	}
+	pthread_mutex_unlock(&semaphore->lock);
+
+	return xSemaphoreGive(semaphore);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore){
+	return uxQueueMessagesWaiting(semaphore);
+}
+
+/*
+ * Timer callbacks run on a single service thread with timer_lock released, so callbacks may start, stop or change
+ * timers like they can from the FreeRTOS timer daemon task.
+ */
+static void * timer_service(void * arg){
+	current_task = task_create_struct("Tmr Svc", 0);
+
+	pthread_mutex_lock(&timer_lock);
+
+	while(true){
+		TickType_t now = xTaskGetTickCount();
+		struct host_timer * next = NULL;
+
+		for(struct host_timer * timer = timers; timer != NULL; timer = timer->next){
+			if(timer->active && (next == NULL || (int32_t)(timer->expiry - next->expiry) < 0))
+				next = timer;
+		}
+
+		if(next == NULL){
+			pthread_cond_wait(&timer_changed, &timer_lock);
+			continue;
+		}
+
+		if((int32_t)(next->expiry - now) > 0){
+			struct timespec deadline;
+			deadline_from_ticks(&deadline, next->expiry - now);
+			pthread_cond_timedwait(&timer_changed, &timer_lock, &deadline);
+			continue;
+		}
+
+		if(next->auto_reload){
+			next->expiry += next->period;
+		}else{
+			next->active = false;
+		}
+
+		TimerCallbackFunction_t callback = next->callback;
+		running_timer = next;
+
+		pthread_mutex_unlock(&timer_lock);
+		callback(next);
+		pthread_mutex_lock(&timer_lock);
+
+		running_timer = NULL;
+		if(next->deleted)
+			free(next);
+	}
+
+	return NULL;
+}
+
+static void timer_service_start(void){
+	cond_init(&timer_changed);
+
+	pthread_t thread;
+	if(pthread_create(&thread, NULL, timer_service, NULL) != 0)
+		abort();
+
+	pthread_detach(thread);
+}
+
+TimerHandle_t xTimerCreate(const char * name, TickType_t period, UBaseType_t auto_reload, void * timer_id,
+			TimerCallbackFunction_t callback){
+
+	if(period == 0 || callback == NULL)
+		return NULL;
+
+	pthread_once(&timer_service_once, timer_service_start);
+
+	struct host_timer * timer = calloc(1, sizeof(struct host_timer));
+	if(timer == NULL)
+		return NULL;
+
+	if(name != NULL)
+		strncpy(timer->name, name, sizeof(timer->name) - 1);
+
+	timer->period = period;
+	timer->auto_reload = auto_reload;
+	timer->timer_id = timer_id;
+	timer->callback = callback;
+
+	pthread_mutex_lock(&timer_lock);
+	timer->next = timers;
+	timers = timer;
+	pthread_mutex_unlock(&timer_lock);
+
+	return timer;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks_to_wait){
+	pthread_mutex_lock(&timer_lock);
+	timer->expiry = xTaskGetTickCount() + timer->period;
+	timer->active = true;
+	pthread_cond_signal(&timer_changed);
+	pthread_mutex_unlock(&timer_lock);
+
+	return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticks_to_wait){
+	return xTimerStart(timer, ticks_to_wait);
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks_to_wait){
+	pthread_mutex_lock(&timer_lock);
+	timer->active = false;
+	pthread_cond_signal(&timer_changed);
+	pthread_mutex_unlock(&timer_lock);
+
+	return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticks_to_wait){
+	if(period == 0)
+		return pdFAIL;
+
+	pthread_mutex_lock(&timer_lock);
+	timer->period = period;
+	timer->expiry = xTaskGetTickCount() + period;
+	timer->active = true; // Changing the period starts a dormant timer in FreeRTOS
+	pthread_cond_signal(&timer_changed);
+	pthread_mutex_unlock(&timer_lock);
+
+	return pdPASS;
+}
+
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t ticks_to_wait){
+	pthread_mutex_lock(&timer_lock);
+
+	for(struct host_timer ** link = &timers; *link != NULL; link = &(*link)->next){
+		if(*link == timer){
+			*link = timer->next;
+			break;
+		}
+	}
+
+	bool running = timer == running_timer;
+	if(running)
+		timer->deleted = true;
+
+	pthread_cond_signal(&timer_changed);
+	pthread_mutex_unlock(&timer_lock);
+
+	if(!running)
+		free(timer);
+
+	return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer){
+	pthread_mutex_lock(&timer_lock);
+	BaseType_t active = timer->active ? pdTRUE : pdFALSE;
+	pthread_mutex_unlock(&timer_lock);
+
+	return active;
+}
+
+TickType_t xTimerGetPeriod(TimerHandle_t timer){
+	return timer->period;
+}
+
+TickType_t xTimerGetExpiryTime(TimerHandle_t timer){
+	return timer->expiry;
+}
+
+void * pvTimerGetTimerID(TimerHandle_t timer){
+	return timer->timer_id;
+}
+
+void vTimerSetTimerID(TimerHandle_t timer, void * timer_id){
+	timer->timer_id = timer_id;
+}
+
+const char * pcTimerGetName(TimerHandle_t timer){
+	return timer->name;
+}
@@ -0,0 +1,116 @@
+#ifndef OCPP_AUTH_FILTER_H
+#define OCPP_AUTH_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+/** @file
+ * @brief Contains a bloom filter used to answer lookups for tokens that are not in the authorization list or cache
+ *
+ * @details The filter is kept in RAM and may report tokens that are not in the file (false positive) but never the
+ * opposite. Tokens that the filter reports as absent can therefore skip the file lookup. Removed tokens can not be
+ * removed from a bloom filter, the filter should instead be rebuilt when ocpp_auth_filter_should_rebuild returns true.
+ *
+ * The filter can be saved next to the file it describes. Like the auth index it records the crc of the auth header it
+ * was saved for, so that a filter that does not match the file is not loaded. The header crc does not change when a
+ * token replaces another, so the saved filter is also removed before tokens are written and saved again after.
+ */
+
+/**
+ * @brief A bloom filter for the tokens of an authorization file
+ */
+struct ocpp_auth_filter{
+	uint8_t * bits; ///< The filter bits or NULL if filter is disabled
+	size_t bit_count; ///< Number of bits in the filter
+	uint8_t hash_count; ///< Number of bits set per token
+	bool valid; ///< True if all tokens in the file are in the filter
+	uint32_t inserted; ///< Number of tokens added since last clear
+	uint32_t removed; ///< Number of tokens removed from file since last clear
+	uint32_t hits; ///< Lookups where the token may be present
+	uint32_t misses; ///< Lookups where the token is known to be absent
+	uint32_t false_positives; ///< Hits where the token was not present
+};
+
+/**
+ * @brief Allocate the filter bits
+ *
+ * @param filter the filter to initialize
+ * @param max_entries the maximum number of tokens expected in the filter
+ * @param bits_per_entry the number of bits per token. If 0 the filter is disabled and never valid
+ */
+esp_err_t ocpp_auth_filter_init(struct ocpp_auth_filter * filter, size_t max_entries, size_t bits_per_entry);
+
+/**
+ * @brief Free the filter bits
+ *
+ * @param filter the filter to free
+ */
+void ocpp_auth_filter_deinit(struct ocpp_auth_filter * filter);
+
+/**
+ * @brief Remove all tokens from the filter.
+ *
+ * @param filter the filter to clear
+ * @param valid the validity of the filter after clear. Should be true if the file is empty or all tokens in the file
+ * will be added.
+ */
+void ocpp_auth_filter_clear(struct ocpp_auth_filter * filter, bool valid);
+
+/**
+ * @brief Add a token to the filter
+ *
+ * @param filter the filter to add to
+ * @param id_tag the token to add
+ */
+void ocpp_auth_filter_add(struct ocpp_auth_filter * filter, const char * id_tag);
+
+/**
+ * @brief Record that a token has been removed from the file.
+ *
+ * @param filter the filter with the removed token
+ * @param count number of tokens removed
+ */
+void ocpp_auth_filter_on_removed(struct ocpp_auth_filter * filter, size_t count);
+
+/**
+ * @brief Check if the removed tokens are likely to give a significant amount of false positives
+ *
+ * @param filter the filter to check
+ */
+bool ocpp_auth_filter_should_rebuild(struct ocpp_auth_filter * filter);
+
+/**
+ * @brief Check if the token may be in the file. Updates the hits and misses counters.
+ *
+ * @param filter the filter to check with
+ * @param id_tag the token to check
+ *
+ * @return false if the filter is valid and the token is not in the file, else true
+ */
+bool ocpp_auth_filter_may_contain(struct ocpp_auth_filter * filter, const char * id_tag);
+
+/**
+ * @brief Write the filter to file
+ *
+ * @param filter the filter to write
+ * @param path the path of the filter file
+ * @param header_crc crc of the auth header the filter is valid for
+ */
+esp_err_t ocpp_auth_filter_save(struct ocpp_auth_filter * filter, const char * path, uint32_t header_crc);
+
+/**
+ * @brief Read the filter from file
+ *
+ * @param filter an initialized filter to read into
+ * @param path the path of the filter file
+ * @param header_crc crc of the current auth header
+ *
+ * @return ESP_OK if loaded, ESP_ERR_NOT_FOUND if missing and ESP_ERR_INVALID_STATE if the filter on file does not
+ * match the current auth header or filter size
+ */
+esp_err_t ocpp_auth_filter_load(struct ocpp_auth_filter * filter, const char * path, uint32_t header_crc);
+
+#endif /* OCPP_AUTH_FILTER_H */
@@ -0,0 +1,144 @@
+#ifndef OCPP_AUTH_INDEX_H
+#define OCPP_AUTH_INDEX_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+/** @file
+ * @brief Contains an on file hash index for the token list of the authorization list and authorization cache
+ *
+ * @details The index is an open addressing hash table with linear probing that maps id tokens to their entry number in
+ * the token list. It is written to its own region of the auth file so that lookups and differential updates only
+ * need to read or write the buckets affected instead of scanning the token list. A bitmap of occupied entries is stored
+ * with the index to allow vacant entries to be found without scanning.
+ *
+ * The index records the crc of the auth header it was written for. If the header crc does not match, the index is
+ * considered invalid and should be rebuilt from the token list. Writers must therefore call ocpp_auth_index_begin
+ * before and ocpp_auth_index_commit after modifying the token list, and write the auth header after the commit.
+ */
+
+/**
+ * @brief Handle for an index on an open auth file
+ */
+struct ocpp_auth_index{
+	FILE * fp; ///< The auth file containing the token list and index
+	long token_list_offset; ///< Offset of the first id token in the token list
+	long index_offset; ///< Offset of the index region
+	size_t max_entries; ///< Number of entries in the token list
+	size_t bucket_count; ///< Number of buckets in the hash table. Always a power of two
+	uint32_t used; ///< Number of buckets referencing an entry
+	uint32_t tombstones; ///< Number of buckets marked as deleted
+	uint8_t * bitmap; ///< Occupied entries, only loaded between begin and commit
+	bool bitmap_changed; ///< True if the bitmap needs to be written during commit
+};
+
+/**
+ * @brief Get the number of bytes on file required by an index for a token list
+ *
+ * @param max_entries the number of entries in the token list
+ */
+size_t ocpp_auth_index_size(size_t max_entries);
+
+/**
+ * @brief Open an existing index for lookups
+ *
+ * @param index the index handle to initialize
+ * @param fp the auth file opened for reading
+ * @param token_list_offset offset of the token list
+ * @param index_offset offset of the index region
+ * @param max_entries number of entries in the token list
+ * @param header_crc crc of the current auth header
+ *
+ * @return ESP_OK if the index is valid for the given header, ESP_ERR_INVALID_STATE if it is stale or missing
+ * or ESP_FAIL if the index could not be read.
+ */
+esp_err_t ocpp_auth_index_open(struct ocpp_auth_index * index, FILE * fp, long token_list_offset, long index_offset,
+			size_t max_entries, uint32_t header_crc);
+
+/**
+ * @brief Find the token list entry of a token
+ *
+ * @param index an index that has been opened or begun
+ * @param id_tag the token to find
+ * @param entry_out the entry number of the token if found
+ *
+ * @return ESP_OK if found, ESP_ERR_NOT_FOUND if the token is not in the index or ESP_FAIL on read error
+ */
+esp_err_t ocpp_auth_index_find(struct ocpp_auth_index * index, const char * id_tag, size_t * entry_out);
+
+/**
+ * @brief Prepare the index for modification.
+ *
+ * @details Opens the index, rebuilds it from the token list if it is not valid for the given header and marks it as
+ * dirty until ocpp_auth_index_commit is called. If create is true, an empty index is written instead.
+ *
+ * @param index the index handle to initialize
+ * @param fp the auth file opened for reading and writing
+ * @param token_list_offset offset of the token list
+ * @param index_offset offset of the index region
+ * @param max_entries number of entries in the token list
+ * @param header_crc crc of the current auth header
+ * @param token_count the number of tokens in the token list according to the auth header
+ * @param create if true any existing index and token list is ignored
+ */
+esp_err_t ocpp_auth_index_begin(struct ocpp_auth_index * index, FILE * fp, long token_list_offset, long index_offset,
+				size_t max_entries, uint32_t header_crc, size_t token_count, bool create);
+
+/**
+ * @brief Find a vacant entry in the token list and mark it as occupied
+ *
+ * @param index an index that has begun modification
+ * @param entry_out the allocated entry
+ *
+ * @return ESP_OK on success or ESP_ERR_NO_MEM if all entries are occupied
+ */
+esp_err_t ocpp_auth_index_allocate_entry(struct ocpp_auth_index * index, size_t * entry_out);
+
+/**
+ * @brief Check if an entry is occupied according to the index
+ *
+ * @param index an index that has begun modification
+ * @param entry the entry to check
+ */
+bool ocpp_auth_index_entry_is_occupied(struct ocpp_auth_index * index, size_t entry);
+
+/**
+ * @brief Add a token to the index
+ *
+ * @note The caller is responsible for ensuring that the token is not already indexed
+ *
+ * @param index an index that has begun modification
+ * @param id_tag the token written to the entry
+ * @param entry the entry the token is written to. It is marked as occupied
+ */
+esp_err_t ocpp_auth_index_insert(struct ocpp_auth_index * index, const char * id_tag, size_t entry);
+
+/**
+ * @brief Remove a token from the index and mark its entry as vacant
+ *
+ * @param index an index that has begun modification
+ * @param id_tag the token to remove
+ * @param entry the entry the token was written to
+ */
+esp_err_t ocpp_auth_index_remove(struct ocpp_auth_index * index, const char * id_tag, size_t entry);
+
+/**
+ * @brief Write the index state and mark the index as valid for the new auth header
+ *
+ * @param index an index that has begun modification
+ * @param header_crc the crc of the auth header that will be written after commit
+ */
+esp_err_t ocpp_auth_index_commit(struct ocpp_auth_index * index, uint32_t header_crc);
+
+/**
+ * @brief Free resources held by the index handle without committing changes
+ *
+ * @param index the index handle
+ */
+void ocpp_auth_index_close(struct ocpp_auth_index * index);
+
+#endif /* OCPP_AUTH_INDEX_H */
@@ -0,0 +1,115 @@
+#ifndef OCPP_CHARGING_TIMELINE_H
+#define OCPP_CHARGING_TIMELINE_H
+
+#include <stddef.h>
+#include <time.h>
+
+#include "esp_err.h"
+
+#include "types/ocpp_charging_profile.h"
+#include "ocpp_json/ocppj_schema_types.h"
+
+/** @file
+ * @brief Contains a precomputed composite limit timeline used by smart charging
+ *
+ * @details The timeline contains the combined charging limits of the tx/tx default profiles and the charge point max
+ * profiles from a start time to a horizon. Each entry is the limit from its start until the start of the next entry or
+ * the end of the timeline. Once built, the limit at any time within the timeline can be found without evaluating the
+ * profiles again. The timeline must be rebuilt if any of the profiles it was built from change, the active
+ * transaction changes or when the end of the timeline is reached.
+ */
+
+/**
+ * @brief A section of the composite schedule where the charging limits do not change
+ */
+struct ocpp_charging_timeline_entry{
+	time_t start; ///< Absolute time when the entry becomes active
+	float limit; ///< Lowest limit of the active tx and max profile
+	float min_charging_rate; ///< Lowest minChargingRate of the active tx and max profile
+	int number_phases; ///< Lowest number of phases of the active tx and max profile
+};
+
+/**
+ * @brief Composite limits from a start time until end
+ */
+struct ocpp_charging_timeline{
+	struct ocpp_charging_timeline_entry * entries; ///< Preallocated entries
+	size_t max_entries; ///< Number of allocated entries
+	size_t count; ///< Number of entries in use
+	size_t position; ///< Entry returned by the last call to ocpp_charging_timeline_at
+	time_t end; ///< Time when the timeline is no longer valid
+};
+
+/**
+ * @brief Allocate entries for a timeline
+ *
+ * @param timeline the timeline to initialize
+ * @param max_entries number of entries to allocate. If more entries are needed, the timeline will end early.
+ */
+esp_err_t ocpp_charging_timeline_init(struct ocpp_charging_timeline * timeline, size_t max_entries);
+
+/**
+ * @brief Free the entries of the timeline
+ *
+ * @param timeline the timeline to free
+ */
+void ocpp_charging_timeline_deinit(struct ocpp_charging_timeline * timeline);
+
+/**
+ * @brief Compute the composite limits from the given profiles.
+ *
+ * The profiles of each purpose must be ordered by precedence with the highest precedence first. For tx this means tx
+ * profiles followed by tx default profiles, each by descending stack level. The last profile should be a profile that
+ * is always active, like the default profile given by ocpp_get_default_charging_profile.
+ *
+ * @param timeline the timeline to write to
+ * @param tx_profiles tx and tx default profiles in order of precedence
+ * @param tx_count number of tx_profiles
+ * @param max_profiles charge point max profiles in order of precedence
+ * @param max_count number of max_profiles
+ * @param relative_start start of the transaction used by relative profiles
+ * @param transaction_id id of the active transaction or NULL if unknown
+ * @param from the time from which to compute the timeline
+ * @param to the time until which the timeline should be computed
+ *
+ * The timeline is built in a single sweep over the period boundaries of all profiles, so the cost grows linearly with
+ * the number of boundaries within the range rather than with the product of profiles and periods.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if no profile of a purpose is active at some point within the range,
+ * ESP_ERR_NO_MEM if the sweep state could not be allocated
+ */
+esp_err_t ocpp_charging_timeline_build(struct ocpp_charging_timeline * timeline,
+				const struct ocpp_charging_profile * const * tx_profiles, size_t tx_count,
+				const struct ocpp_charging_profile * const * max_profiles, size_t max_count,
+				time_t relative_start, const int * transaction_id, time_t from, time_t to);
+
+/**
+ * @brief Get the entry active at the given time.
+ *
+ * Lookups are expected to be for increasing time and continue from the last returned entry.
+ *
+ * @param timeline the timeline to search
+ * @param when the time to get the entry for
+ * @param next_change_out output parameter for when the next entry starts or the timeline ends
+ *
+ * @return the active entry or NULL if when is outside the timeline
+ */
+const struct ocpp_charging_timeline_entry * ocpp_charging_timeline_at(struct ocpp_charging_timeline * timeline, time_t when,
+								time_t * next_change_out);
+
+/**
+ * @brief Write the timeline as the charging schedule of a GetCompositeSchedule.conf
+ *
+ * Each entry becomes a period relative to schedule_start. The duration is the length of the timeline from schedule_start
+ * and minChargingRate is the lowest of all entries. The schedule has no startSchedule, as required by errata v4.0.
+ *
+ * @param timeline the timeline to convert, must contain at least one entry
+ * @param schedule_start the time the periods are relative to, normally the time the timeline was built from
+ * @param schedule_out the schedule to write. Its period array is allocated and must be freed by the caller.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the timeline is empty or ESP_ERR_NO_MEM
+ */
+esp_err_t ocpp_charging_timeline_to_schedule(const struct ocpp_charging_timeline * timeline, time_t schedule_start,
+					struct ocppj_charging_schedule * schedule_out);
+
+#endif /* OCPP_CHARGING_TIMELINE_H */
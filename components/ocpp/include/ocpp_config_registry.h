@@ -0,0 +1,160 @@
+#ifndef OCPP_CONFIG_REGISTRY_H
+#define OCPP_CONFIG_REGISTRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "cJSON.h"
+
+/** @file
+ * @brief Contains a table driven registry of configuration keys used for GetConfiguration.req and ChangeConfiguration.req
+ *
+ * @details Each configuration key is described by a static entry with its type, access and the functions used to read,
+ * validate and write its value. Entries are found by a perfect hash created when the registry is initialized, so a
+ * lookup hashes the requested key once and compares it with a single entry. GetConfiguration.conf is written directly
+ * as text into a single buffer instead of building a cJSON tree of all the keys.
+ */
+
+/**
+ * @brief Size of the buffer given to getters when the value needs to be formatted
+ */
+#define OCPP_CONFIG_VALUE_BUFFER_SIZE 128
+
+/**
+ * @brief Type of a configuration value. Decides which member of get, set and validate is used.
+ */
+enum ocpp_config_type{
+	eOCPP_CONFIG_TYPE_CONSTANT, ///< Read only value given by constant
+	eOCPP_CONFIG_TYPE_BOOL, ///< "true" or "false"
+	eOCPP_CONFIG_TYPE_U8, ///< Unsigned integer in the range of uint8_t
+	eOCPP_CONFIG_TYPE_U16, ///< Unsigned integer in the range of uint16_t
+	eOCPP_CONFIG_TYPE_U32, ///< Unsigned integer in the range of uint32_t
+	eOCPP_CONFIG_TYPE_STRING, ///< String value stored as is
+	eOCPP_CONFIG_TYPE_CUSTOM, ///< Value is read by get.custom and parsed, validated and written by set.custom
+};
+
+/**
+ * @brief Description of a single configuration key
+ */
+struct ocpp_config_key{
+	const char * key; ///< Name of the configuration key
+	enum ocpp_config_type type; ///< How the value is read and written
+	bool read_only; ///< True if ChangeConfiguration.req should be rejected
+	bool cloud_setting; ///< True if the value is part of the settings reported to the cloud
+	const char * constant; ///< Value of eOCPP_CONFIG_TYPE_CONSTANT keys
+	union{
+		bool (*boolean)(void);
+		uint8_t (*u8)(void);
+		uint16_t (*u16)(void);
+		uint32_t (*u32)(void);
+		const char * (*string)(void);
+		/// Writes the value to buffer or returns a pointer to a stored value. NULL if the value can not be given.
+		const char * (*custom)(char * buffer, size_t buffer_size);
+	} get; ///< Reads the current value. May be NULL for custom keys that can only be written.
+	union{
+		void (*boolean)(bool);
+		void (*u8)(uint8_t);
+		void (*u16)(uint16_t);
+		void (*u32)(uint32_t);
+		void (*string)(const char *);
+		/// Parses, validates and writes the value. Returns 0 on success.
+		int (*custom)(const char * value);
+	} set; ///< Writes a parsed value. Not used for read only keys.
+	union{
+		bool (*boolean)(bool);
+		bool (*u8)(uint8_t);
+		bool (*u16)(uint16_t);
+		bool (*u32)(uint32_t);
+		bool (*string)(const char *);
+	} validate; ///< Optional additional validation of a parsed value before it is written
+	void (*on_change)(void); ///< Optional function called after a new value has been written
+};
+
+/**
+ * @brief Configuration keys with a perfect hash for lookups
+ */
+struct ocpp_config_registry{
+	const struct ocpp_config_key * keys; ///< The registered keys in the order they are reported
+	size_t key_count; ///< Number of keys
+	uint8_t * slots; ///< Index of the key for each hash slot or NULL if lookups use linear search
+	size_t slot_mask; ///< Number of slots - 1
+	uint32_t seed; ///< Seed giving each key its own slot
+	size_t buffer_size; ///< Initial size of response buffers. Grows to fit the largest response written
+};
+
+/**
+ * @brief Create the perfect hash for the given keys
+ *
+ * @param registry the registry to initialize
+ * @param keys the configuration keys. Must remain valid until ocpp_config_registry_deinit.
+ * @param key_count number of keys. Must be less than 255.
+ * @param buffer_size initial size of buffers used for responses
+ */
+esp_err_t ocpp_config_registry_init(struct ocpp_config_registry * registry, const struct ocpp_config_key * keys, size_t key_count,
+				size_t buffer_size);
+
+/**
+ * @brief Free the hash slots of the registry
+ *
+ * @param registry the registry to free
+ */
+void ocpp_config_registry_deinit(struct ocpp_config_registry * registry);
+
+/**
+ * @brief Find a key. The comparison is case insensitive as configuration keys are CiString50Type.
+ *
+ * @param registry the registry to search
+ * @param key name of the configuration key
+ *
+ * @return the entry or NULL if the key is not registered
+ */
+const struct ocpp_config_key * ocpp_config_registry_find(const struct ocpp_config_registry * registry, const char * key);
+
+/**
+ * @brief Get the current value of a key as text
+ *
+ * @param entry the key to read
+ * @param buffer buffer for values that need to be formatted
+ * @param buffer_size size of buffer. Should be at least OCPP_CONFIG_VALUE_BUFFER_SIZE.
+ *
+ * @return the value or NULL if the key can not be read
+ */
+const char * ocpp_config_registry_get_value(const struct ocpp_config_key * entry, char * buffer, size_t buffer_size);
+
+/**
+ * @brief Parse, validate and write a new value to a key. on_change is called if the value was written.
+ *
+ * @param entry the key to write
+ * @param value the new value as given in ChangeConfiguration.req
+ *
+ * @return ESP_OK if written, ESP_ERR_NOT_SUPPORTED if the key can not be written and ESP_ERR_INVALID_ARG if the value
+ * was invalid
+ */
+esp_err_t ocpp_config_registry_set_value(const struct ocpp_config_key * entry, const char * value);
+
+/**
+ * @brief Write a complete GetConfiguration.conf message.
+ *
+ * Requested keys that are not registered or can not be read are given as unknownKey.
+ *
+ * @param registry the registry with the keys
+ * @param unique_id unique id of the GetConfiguration.req
+ * @param requested_keys keys given in the request
+ * @param requested_count number of requested keys. If 0, all readable keys are written.
+ * @param message_out output parameter for the message. Must be freed by the caller.
+ * @param length_out output parameter for the length of the message
+ */
+esp_err_t ocpp_config_registry_write_configuration(struct ocpp_config_registry * registry, const char * unique_id,
+						const char * const * requested_keys, size_t requested_count,
+						char ** message_out, size_t * length_out);
+
+/**
+ * @brief Create a cJSON array of KeyValue objects for all readable keys. Intended for diagnostics.
+ *
+ * @param registry the registry with the keys
+ */
+cJSON * ocpp_config_registry_to_json(const struct ocpp_config_registry * registry);
+
+#endif /* OCPP_CONFIG_REGISTRY_H */
@@ -0,0 +1,127 @@
+#ifndef OCPPJ_SCHEMA_H
+#define OCPPJ_SCHEMA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "cJSON.h"
+
+#include "ocppj_message_structure.h"
+
+/** @file
+ * @brief Reads and writes OCPP payloads using descriptors generated from the OCPP 1.6 JSON schemas.
+ *
+ * @details The descriptors and the structs they describe are generated by ocpp_json/generate_schema_types.py and found
+ * in ocppj_schema_types.h. A payload is validated and read into its struct while walking each cJSON object's child
+ * list once, instead of searching the object for each field. Structs are written directly as JSON text without
+ * creating a cJSON tree.
+ *
+ * Every generated struct starts with a uint32_t bit mask with one bit per field in the order of the schema. When
+ * reading, the bit is set for each field present in the payload. When writing, required fields are always written and
+ * optional fields only if their bit is set.
+ */
+
+/**
+ * @brief Type of a field and the C type used to store it
+ */
+enum ocppj_schema_type{
+	eOCPPJ_SCHEMA_INTEGER, ///< int
+	eOCPPJ_SCHEMA_DECIMAL, ///< double
+	eOCPPJ_SCHEMA_BOOLEAN, ///< bool
+	eOCPPJ_SCHEMA_STRING, ///< const char *, pointing into the payload when read
+	eOCPPJ_SCHEMA_ENUM, ///< const char *, pointing to one of the field's values when read
+	eOCPPJ_SCHEMA_DATE_TIME, ///< time_t
+	eOCPPJ_SCHEMA_OBJECT, ///< Struct described by the field's object
+	eOCPPJ_SCHEMA_ARRAY, ///< size_t item count at count_offset and a pointer to the items at offset
+};
+
+struct ocppj_schema_object;
+
+/**
+ * @brief Description of a single property in a JSON object or of the items in an array
+ */
+struct ocppj_schema_field{
+	const char * name; ///< Name of the property
+	enum ocppj_schema_type type; ///< How the value is validated and stored
+	bool required; ///< True if the payload is invalid without the property
+	bool one_decimal; ///< True for decimals with "multipleOf" 0.1
+	uint16_t max_length; ///< Max length of strings or 0 if not limited
+	uint16_t offset; ///< Offset of the value in the struct
+	uint16_t count_offset; ///< Offset of the item count for arrays
+	uint8_t value_count; ///< Number of allowed enum values
+	const char * const * values; ///< Allowed enum values
+	const struct ocppj_schema_object * object; ///< Object of eOCPPJ_SCHEMA_OBJECT fields and object items
+	const struct ocppj_schema_field * items; ///< Description of array items. Their offset is 0
+};
+
+/**
+ * @brief Description of a JSON object and the struct it is read into
+ */
+struct ocppj_schema_object{
+	const char * name; ///< Name used in log messages
+	const struct ocppj_schema_field * fields; ///< The properties of the object
+	uint8_t field_count; ///< Number of fields, at most 32
+	uint16_t size; ///< Size of the struct
+};
+
+/**
+ * @brief Validates a payload and reads it into the struct described by the schema
+ *
+ * @details Properties not in the schema are ignored like they were by the hand written handlers. A property given more
+ * than once is an OccurenceConstraintViolation. On success the struct may contain allocated arrays that must be freed
+ * with ocppj_schema_free. On failure nothing needs to be freed.
+ *
+ * @param schema descriptor of the payload
+ * @param payload JSON object to read. Strings in the result point into it, so it must outlive the struct.
+ * @param value_out struct of the type described by schema
+ * @param error_description_out string to write error message to if payload is invalid
+ * @param error_description_length buffer size of error description
+ */
+enum ocppj_err_t ocppj_schema_read(const struct ocppj_schema_object * schema, const cJSON * payload, void * value_out,
+				char * error_description_out, size_t error_description_length);
+
+/**
+ * @brief Frees the arrays allocated by ocppj_schema_read
+ *
+ * @param schema descriptor used to read the value
+ * @param value struct to free arrays in. The struct itself is not freed.
+ */
+void ocppj_schema_free(const struct ocppj_schema_object * schema, void * value);
+
+/**
+ * @brief Writes a struct as JSON text
+ *
+ * @param schema descriptor of the payload
+ * @param value struct to write
+ * @param buffer buffer to write to. The text is always null terminated if buffer_size is not 0.
+ * @param buffer_size size of buffer
+ *
+ * @return length of the text that would have been written if the buffer was large enough, or -1 if the value does not
+ * conform to the schema.
+ */
+int ocppj_schema_write(const struct ocppj_schema_object * schema, const void * value, char * buffer, size_t buffer_size);
+
+/**
+ * @brief Creates the text of a CallResult with the struct as payload
+ *
+ * @param unique_id id given in the matching .req
+ * @param schema descriptor of the payload
+ * @param value struct to write
+ * @param message_out allocated null terminated message, to be freed by the caller.
+ * @param length_out length of the message
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the value does not conform to the schema or ESP_ERR_NO_MEM
+ */
+esp_err_t ocppj_schema_create_call_result_text(const char * unique_id, const struct ocppj_schema_object * schema,
+					const void * value, char ** message_out, size_t * length_out);
+
+/**
+ * @brief Creates a cJSON object from a struct for messages that are queued as cJSON
+ *
+ * @return the object or NULL if the value does not conform to the schema or on failure
+ */
+cJSON * ocppj_schema_to_json(const struct ocppj_schema_object * schema, const void * value);
+
+#endif /*OCPPJ_SCHEMA_H*/
@@ -0,0 +1,980 @@
+/* Generated by ocpp_json/generate_schema_types.py from the OCPP 1.6 JSON schemas. Do not edit. */
+#ifndef OCPPJ_SCHEMA_TYPES_H
+#define OCPPJ_SCHEMA_TYPES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "ocpp_json/ocppj_schema.h"
+
+/** @file
+ * @brief Structs and schema descriptors for the payload of each OCPP 1.6 message.
+ *
+ * @details Each struct starts with a bit mask of the fields present in the payload, see the OCPPJ_*_HAS_* defines.
+ * Strings point into the parsed cJSON payload and enum values point to constant strings in the schema.
+ */
+
+/**
+ * @brief Authorize.req payload
+ */
+struct ocppj_authorize_req{
+	uint32_t present; ///< Bit mask of fields present
+	const char * id_tag; ///< Required. At most 20 characters.
+};
+
+#define OCPPJ_AUTHORIZE_REQ_HAS_ID_TAG (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_authorize_req_schema; ///< Descriptor of struct ocppj_authorize_req
+
+/**
+ * @brief IdTagInfo
+ */
+struct ocppj_id_tag_info{
+	uint32_t present; ///< Bit mask of fields present
+	time_t expiry_date; ///< Optional. dateTime.
+	const char * parent_id_tag; ///< Optional. At most 20 characters.
+	const char * status; ///< Required. One of "Accepted", "Blocked", "Expired", "Invalid", "ConcurrentTx".
+};
+
+#define OCPPJ_ID_TAG_INFO_HAS_EXPIRY_DATE (1u << 0)
+#define OCPPJ_ID_TAG_INFO_HAS_PARENT_ID_TAG (1u << 1)
+#define OCPPJ_ID_TAG_INFO_HAS_STATUS (1u << 2)
+
+extern const struct ocppj_schema_object ocppj_id_tag_info_schema; ///< Descriptor of struct ocppj_id_tag_info
+
+/**
+ * @brief Authorize.conf payload
+ */
+struct ocppj_authorize_conf{
+	uint32_t present; ///< Bit mask of fields present
+	struct ocppj_id_tag_info id_tag_info; ///< Required.
+};
+
+#define OCPPJ_AUTHORIZE_CONF_HAS_ID_TAG_INFO (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_authorize_conf_schema; ///< Descriptor of struct ocppj_authorize_conf
+
+/**
+ * @brief BootNotification.req payload
+ */
+struct ocppj_boot_notification_req{
+	uint32_t present; ///< Bit mask of fields present
+	const char * charge_point_vendor; ///< Required. At most 20 characters.
+	const char * charge_point_model; ///< Required. At most 20 characters.
+	const char * charge_point_serial_number; ///< Optional. At most 25 characters.
+	const char * charge_box_serial_number; ///< Optional. At most 25 characters.
+	const char * firmware_version; ///< Optional. At most 50 characters.
+	const char * iccid; ///< Optional. At most 20 characters.
+	const char * imsi; ///< Optional. At most 20 characters.
+	const char * meter_type; ///< Optional. At most 25 characters.
+	const char * meter_serial_number; ///< Optional. At most 25 characters.
+};
+
+#define OCPPJ_BOOT_NOTIFICATION_REQ_HAS_CHARGE_POINT_VENDOR (1u << 0)
+#define OCPPJ_BOOT_NOTIFICATION_REQ_HAS_CHARGE_POINT_MODEL (1u << 1)
+#define OCPPJ_BOOT_NOTIFICATION_REQ_HAS_CHARGE_POINT_SERIAL_NUMBER (1u << 2)
+#define OCPPJ_BOOT_NOTIFICATION_REQ_HAS_CHARGE_BOX_SERIAL_NUMBER (1u << 3)
+#define OCPPJ_BOOT_NOTIFICATION_REQ_HAS_FIRMWARE_VERSION (1u << 4)
+#define OCPPJ_BOOT_NOTIFICATION_REQ_HAS_ICCID (1u << 5)
+#define OCPPJ_BOOT_NOTIFICATION_REQ_HAS_IMSI (1u << 6)
+#define OCPPJ_BOOT_NOTIFICATION_REQ_HAS_METER_TYPE (1u << 7)
+#define OCPPJ_BOOT_NOTIFICATION_REQ_HAS_METER_SERIAL_NUMBER (1u << 8)
+
+extern const struct ocppj_schema_object ocppj_boot_notification_req_schema; ///< Descriptor of struct ocppj_boot_notification_req
+
+/**
+ * @brief BootNotification.conf payload
+ */
+struct ocppj_boot_notification_conf{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Accepted", "Pending", "Rejected".
+	time_t current_time; ///< Required. dateTime.
+	int interval; ///< Required.
+};
+
+#define OCPPJ_BOOT_NOTIFICATION_CONF_HAS_STATUS (1u << 0)
+#define OCPPJ_BOOT_NOTIFICATION_CONF_HAS_CURRENT_TIME (1u << 1)
+#define OCPPJ_BOOT_NOTIFICATION_CONF_HAS_INTERVAL (1u << 2)
+
+extern const struct ocppj_schema_object ocppj_boot_notification_conf_schema; ///< Descriptor of struct ocppj_boot_notification_conf
+
+/**
+ * @brief CancelReservation.req payload
+ */
+struct ocppj_cancel_reservation_req{
+	uint32_t present; ///< Bit mask of fields present
+	int reservation_id; ///< Required.
+};
+
+#define OCPPJ_CANCEL_RESERVATION_REQ_HAS_RESERVATION_ID (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_cancel_reservation_req_schema; ///< Descriptor of struct ocppj_cancel_reservation_req
+
+/**
+ * @brief CancelReservation.conf payload
+ */
+struct ocppj_cancel_reservation_conf{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Accepted", "Rejected".
+};
+
+#define OCPPJ_CANCEL_RESERVATION_CONF_HAS_STATUS (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_cancel_reservation_conf_schema; ///< Descriptor of struct ocppj_cancel_reservation_conf
+
+/**
+ * @brief ChangeAvailability.req payload
+ */
+struct ocppj_change_availability_req{
+	uint32_t present; ///< Bit mask of fields present
+	int connector_id; ///< Required.
+	const char * type; ///< Required. One of "Inoperative", "Operative".
+};
+
+#define OCPPJ_CHANGE_AVAILABILITY_REQ_HAS_CONNECTOR_ID (1u << 0)
+#define OCPPJ_CHANGE_AVAILABILITY_REQ_HAS_TYPE (1u << 1)
+
+extern const struct ocppj_schema_object ocppj_change_availability_req_schema; ///< Descriptor of struct ocppj_change_availability_req
+
+/**
+ * @brief ChangeAvailability.conf payload
+ */
+struct ocppj_change_availability_conf{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Accepted", "Rejected", "Scheduled".
+};
+
+#define OCPPJ_CHANGE_AVAILABILITY_CONF_HAS_STATUS (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_change_availability_conf_schema; ///< Descriptor of struct ocppj_change_availability_conf
+
+/**
+ * @brief ChangeConfiguration.req payload
+ */
+struct ocppj_change_configuration_req{
+	uint32_t present; ///< Bit mask of fields present
+	const char * key; ///< Required. At most 50 characters.
+	const char * value; ///< Required. At most 500 characters.
+};
+
+#define OCPPJ_CHANGE_CONFIGURATION_REQ_HAS_KEY (1u << 0)
+#define OCPPJ_CHANGE_CONFIGURATION_REQ_HAS_VALUE (1u << 1)
+
+extern const struct ocppj_schema_object ocppj_change_configuration_req_schema; ///< Descriptor of struct ocppj_change_configuration_req
+
+/**
+ * @brief ChangeConfiguration.conf payload
+ */
+struct ocppj_change_configuration_conf{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Accepted", "Rejected", "RebootRequired", "NotSupported".
+};
+
+#define OCPPJ_CHANGE_CONFIGURATION_CONF_HAS_STATUS (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_change_configuration_conf_schema; ///< Descriptor of struct ocppj_change_configuration_conf
+
+/**
+ * @brief ClearCache.req payload
+ */
+struct ocppj_clear_cache_req{
+	uint32_t present; ///< Bit mask of fields present
+};
+
+extern const struct ocppj_schema_object ocppj_clear_cache_req_schema; ///< Descriptor of struct ocppj_clear_cache_req
+
+/**
+ * @brief ClearCache.conf payload
+ */
+struct ocppj_clear_cache_conf{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Accepted", "Rejected".
+};
+
+#define OCPPJ_CLEAR_CACHE_CONF_HAS_STATUS (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_clear_cache_conf_schema; ///< Descriptor of struct ocppj_clear_cache_conf
+
+/**
+ * @brief ClearChargingProfile.req payload
+ */
+struct ocppj_clear_charging_profile_req{
+	uint32_t present; ///< Bit mask of fields present
+	int id; ///< Optional.
+	int connector_id; ///< Optional.
+	const char * charging_profile_purpose; ///< Optional. One of "ChargePointMaxProfile", "TxDefaultProfile", "TxProfile".
+	int stack_level; ///< Optional.
+};
+
+#define OCPPJ_CLEAR_CHARGING_PROFILE_REQ_HAS_ID (1u << 0)
+#define OCPPJ_CLEAR_CHARGING_PROFILE_REQ_HAS_CONNECTOR_ID (1u << 1)
+#define OCPPJ_CLEAR_CHARGING_PROFILE_REQ_HAS_CHARGING_PROFILE_PURPOSE (1u << 2)
+#define OCPPJ_CLEAR_CHARGING_PROFILE_REQ_HAS_STACK_LEVEL (1u << 3)
+
+extern const struct ocppj_schema_object ocppj_clear_charging_profile_req_schema; ///< Descriptor of struct ocppj_clear_charging_profile_req
+
+/**
+ * @brief ClearChargingProfile.conf payload
+ */
+struct ocppj_clear_charging_profile_conf{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Accepted", "Unknown".
+};
+
+#define OCPPJ_CLEAR_CHARGING_PROFILE_CONF_HAS_STATUS (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_clear_charging_profile_conf_schema; ///< Descriptor of struct ocppj_clear_charging_profile_conf
+
+/**
+ * @brief DataTransfer.req payload
+ */
+struct ocppj_data_transfer_req{
+	uint32_t present; ///< Bit mask of fields present
+	const char * vendor_id; ///< Required. At most 255 characters.
+	const char * message_id; ///< Optional. At most 50 characters.
+	const char * data; ///< Optional.
+};
+
+#define OCPPJ_DATA_TRANSFER_REQ_HAS_VENDOR_ID (1u << 0)
+#define OCPPJ_DATA_TRANSFER_REQ_HAS_MESSAGE_ID (1u << 1)
+#define OCPPJ_DATA_TRANSFER_REQ_HAS_DATA (1u << 2)
+
+extern const struct ocppj_schema_object ocppj_data_transfer_req_schema; ///< Descriptor of struct ocppj_data_transfer_req
+
+/**
+ * @brief DataTransfer.conf payload
+ */
+struct ocppj_data_transfer_conf{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Accepted", "Rejected", "UnknownMessageId", "UnknownVendorId".
+	const char * data; ///< Optional.
+};
+
+#define OCPPJ_DATA_TRANSFER_CONF_HAS_STATUS (1u << 0)
+#define OCPPJ_DATA_TRANSFER_CONF_HAS_DATA (1u << 1)
+
+extern const struct ocppj_schema_object ocppj_data_transfer_conf_schema; ///< Descriptor of struct ocppj_data_transfer_conf
+
+/**
+ * @brief DiagnosticsStatusNotification.req payload
+ */
+struct ocppj_diagnostics_status_notification_req{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Idle", "Uploaded", "UploadFailed", "Uploading".
+};
+
+#define OCPPJ_DIAGNOSTICS_STATUS_NOTIFICATION_REQ_HAS_STATUS (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_diagnostics_status_notification_req_schema; ///< Descriptor of struct ocppj_diagnostics_status_notification_req
+
+/**
+ * @brief DiagnosticsStatusNotification.conf payload
+ */
+struct ocppj_diagnostics_status_notification_conf{
+	uint32_t present; ///< Bit mask of fields present
+};
+
+extern const struct ocppj_schema_object ocppj_diagnostics_status_notification_conf_schema; ///< Descriptor of struct ocppj_diagnostics_status_notification_conf
+
+/**
+ * @brief FirmwareStatusNotification.req payload
+ */
+struct ocppj_firmware_status_notification_req{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Downloaded", "DownloadFailed", "Downloading", "Idle", "InstallationFailed", "Installing", "Installed".
+};
+
+#define OCPPJ_FIRMWARE_STATUS_NOTIFICATION_REQ_HAS_STATUS (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_firmware_status_notification_req_schema; ///< Descriptor of struct ocppj_firmware_status_notification_req
+
+/**
+ * @brief FirmwareStatusNotification.conf payload
+ */
+struct ocppj_firmware_status_notification_conf{
+	uint32_t present; ///< Bit mask of fields present
+};
+
+extern const struct ocppj_schema_object ocppj_firmware_status_notification_conf_schema; ///< Descriptor of struct ocppj_firmware_status_notification_conf
+
+/**
+ * @brief GetCompositeSchedule.req payload
+ */
+struct ocppj_get_composite_schedule_req{
+	uint32_t present; ///< Bit mask of fields present
+	int connector_id; ///< Required.
+	int duration; ///< Required.
+	const char * charging_rate_unit; ///< Optional. One of "A", "W".
+};
+
+#define OCPPJ_GET_COMPOSITE_SCHEDULE_REQ_HAS_CONNECTOR_ID (1u << 0)
+#define OCPPJ_GET_COMPOSITE_SCHEDULE_REQ_HAS_DURATION (1u << 1)
+#define OCPPJ_GET_COMPOSITE_SCHEDULE_REQ_HAS_CHARGING_RATE_UNIT (1u << 2)
+
+extern const struct ocppj_schema_object ocppj_get_composite_schedule_req_schema; ///< Descriptor of struct ocppj_get_composite_schedule_req
+
+/**
+ * @brief ChargingSchedulePeriod
+ */
+struct ocppj_charging_schedule_period{
+	uint32_t present; ///< Bit mask of fields present
+	int start_period; ///< Required.
+	double limit; ///< Required. At most one digit fraction.
+	int number_phases; ///< Optional.
+};
+
+#define OCPPJ_CHARGING_SCHEDULE_PERIOD_HAS_START_PERIOD (1u << 0)
+#define OCPPJ_CHARGING_SCHEDULE_PERIOD_HAS_LIMIT (1u << 1)
+#define OCPPJ_CHARGING_SCHEDULE_PERIOD_HAS_NUMBER_PHASES (1u << 2)
+
+extern const struct ocppj_schema_object ocppj_charging_schedule_period_schema; ///< Descriptor of struct ocppj_charging_schedule_period
+
+/**
+ * @brief ChargingSchedule
+ */
+struct ocppj_charging_schedule{
+	uint32_t present; ///< Bit mask of fields present
+	int duration; ///< Optional.
+	time_t start_schedule; ///< Optional. dateTime.
+	const char * charging_rate_unit; ///< Required. One of "A", "W".
+	size_t charging_schedule_period_count; ///< Number of items in charging_schedule_period
+	struct ocppj_charging_schedule_period * charging_schedule_period; ///< Required.
+	double min_charging_rate; ///< Optional. At most one digit fraction.
+};
+
+#define OCPPJ_CHARGING_SCHEDULE_HAS_DURATION (1u << 0)
+#define OCPPJ_CHARGING_SCHEDULE_HAS_START_SCHEDULE (1u << 1)
+#define OCPPJ_CHARGING_SCHEDULE_HAS_CHARGING_RATE_UNIT (1u << 2)
+#define OCPPJ_CHARGING_SCHEDULE_HAS_CHARGING_SCHEDULE_PERIOD (1u << 3)
+#define OCPPJ_CHARGING_SCHEDULE_HAS_MIN_CHARGING_RATE (1u << 4)
+
+extern const struct ocppj_schema_object ocppj_charging_schedule_schema; ///< Descriptor of struct ocppj_charging_schedule
+
+/**
+ * @brief GetCompositeSchedule.conf payload
+ */
+struct ocppj_get_composite_schedule_conf{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Accepted", "Rejected".
+	int connector_id; ///< Optional.
+	time_t schedule_start; ///< Optional. dateTime.
+	struct ocppj_charging_schedule charging_schedule; ///< Optional.
+};
+
+#define OCPPJ_GET_COMPOSITE_SCHEDULE_CONF_HAS_STATUS (1u << 0)
+#define OCPPJ_GET_COMPOSITE_SCHEDULE_CONF_HAS_CONNECTOR_ID (1u << 1)
+#define OCPPJ_GET_COMPOSITE_SCHEDULE_CONF_HAS_SCHEDULE_START (1u << 2)
+#define OCPPJ_GET_COMPOSITE_SCHEDULE_CONF_HAS_CHARGING_SCHEDULE (1u << 3)
+
+extern const struct ocppj_schema_object ocppj_get_composite_schedule_conf_schema; ///< Descriptor of struct ocppj_get_composite_schedule_conf
+
+/**
+ * @brief GetConfiguration.req payload
+ */
+struct ocppj_get_configuration_req{
+	uint32_t present; ///< Bit mask of fields present
+	size_t key_count; ///< Number of items in key
+	const char * * key; ///< Optional. At most 50 characters.
+};
+
+#define OCPPJ_GET_CONFIGURATION_REQ_HAS_KEY (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_get_configuration_req_schema; ///< Descriptor of struct ocppj_get_configuration_req
+
+/**
+ * @brief KeyValue
+ */
+struct ocppj_key_value{
+	uint32_t present; ///< Bit mask of fields present
+	const char * key; ///< Required. At most 50 characters.
+	bool readonly; ///< Required.
+	const char * value; ///< Optional. At most 500 characters.
+};
+
+#define OCPPJ_KEY_VALUE_HAS_KEY (1u << 0)
+#define OCPPJ_KEY_VALUE_HAS_READONLY (1u << 1)
+#define OCPPJ_KEY_VALUE_HAS_VALUE (1u << 2)
+
+extern const struct ocppj_schema_object ocppj_key_value_schema; ///< Descriptor of struct ocppj_key_value
+
+/**
+ * @brief GetConfiguration.conf payload
+ */
+struct ocppj_get_configuration_conf{
+	uint32_t present; ///< Bit mask of fields present
+	size_t configuration_key_count; ///< Number of items in configuration_key
+	struct ocppj_key_value * configuration_key; ///< Optional.
+	size_t unknown_key_count; ///< Number of items in unknown_key
+	const char * * unknown_key; ///< Optional. At most 50 characters.
+};
+
+#define OCPPJ_GET_CONFIGURATION_CONF_HAS_CONFIGURATION_KEY (1u << 0)
+#define OCPPJ_GET_CONFIGURATION_CONF_HAS_UNKNOWN_KEY (1u << 1)
+
+extern const struct ocppj_schema_object ocppj_get_configuration_conf_schema; ///< Descriptor of struct ocppj_get_configuration_conf
+
+/**
+ * @brief GetDiagnostics.req payload
+ */
+struct ocppj_get_diagnostics_req{
+	uint32_t present; ///< Bit mask of fields present
+	const char * location; ///< Required.
+	int retries; ///< Optional.
+	int retry_interval; ///< Optional.
+	time_t start_time; ///< Optional. dateTime.
+	time_t stop_time; ///< Optional. dateTime.
+};
+
+#define OCPPJ_GET_DIAGNOSTICS_REQ_HAS_LOCATION (1u << 0)
+#define OCPPJ_GET_DIAGNOSTICS_REQ_HAS_RETRIES (1u << 1)
+#define OCPPJ_GET_DIAGNOSTICS_REQ_HAS_RETRY_INTERVAL (1u << 2)
+#define OCPPJ_GET_DIAGNOSTICS_REQ_HAS_START_TIME (1u << 3)
+#define OCPPJ_GET_DIAGNOSTICS_REQ_HAS_STOP_TIME (1u << 4)
+
+extern const struct ocppj_schema_object ocppj_get_diagnostics_req_schema; ///< Descriptor of struct ocppj_get_diagnostics_req
+
+/**
+ * @brief GetDiagnostics.conf payload
+ */
+struct ocppj_get_diagnostics_conf{
+	uint32_t present; ///< Bit mask of fields present
+	const char * file_name; ///< Optional. At most 255 characters.
+};
+
+#define OCPPJ_GET_DIAGNOSTICS_CONF_HAS_FILE_NAME (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_get_diagnostics_conf_schema; ///< Descriptor of struct ocppj_get_diagnostics_conf
+
+/**
+ * @brief GetLocalListVersion.req payload
+ */
+struct ocppj_get_local_list_version_req{
+	uint32_t present; ///< Bit mask of fields present
+};
+
+extern const struct ocppj_schema_object ocppj_get_local_list_version_req_schema; ///< Descriptor of struct ocppj_get_local_list_version_req
+
+/**
+ * @brief GetLocalListVersion.conf payload
+ */
+struct ocppj_get_local_list_version_conf{
+	uint32_t present; ///< Bit mask of fields present
+	int list_version; ///< Required.
+};
+
+#define OCPPJ_GET_LOCAL_LIST_VERSION_CONF_HAS_LIST_VERSION (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_get_local_list_version_conf_schema; ///< Descriptor of struct ocppj_get_local_list_version_conf
+
+/**
+ * @brief Heartbeat.req payload
+ */
+struct ocppj_heartbeat_req{
+	uint32_t present; ///< Bit mask of fields present
+};
+
+extern const struct ocppj_schema_object ocppj_heartbeat_req_schema; ///< Descriptor of struct ocppj_heartbeat_req
+
+/**
+ * @brief Heartbeat.conf payload
+ */
+struct ocppj_heartbeat_conf{
+	uint32_t present; ///< Bit mask of fields present
+	time_t current_time; ///< Required. dateTime.
+};
+
+#define OCPPJ_HEARTBEAT_CONF_HAS_CURRENT_TIME (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_heartbeat_conf_schema; ///< Descriptor of struct ocppj_heartbeat_conf
+
+/**
+ * @brief SampledValue
+ */
+struct ocppj_sampled_value{
+	uint32_t present; ///< Bit mask of fields present
+	const char * value; ///< Required.
+	const char * context; ///< Optional. One of "Interruption.Begin", "Interruption.End", "Sample.Clock", "Sample.Periodic", "Transaction.Begin", "Transaction.End", "Trigger", "Other".
+	const char * format; ///< Optional. One of "Raw", "SignedData".
+	const char * measurand; ///< Optional. One of "Energy.Active.Export.Register", "Energy.Active.Import.Register", "Energy.Reactive.Export.Register", "Energy.Reactive.Import.Register", "Energy.Active.Export.Interval", "Energy.Active.Import.Interval", "Energy.Reactive.Export.Interval", "Energy.Reactive.Import.Interval", "Power.Active.Export", "Power.Active.Import", "Power.Offered", "Power.Reactive.Export", "Power.Reactive.Import", "Power.Factor", "Current.Import", "Current.Export", "Current.Offered", "Voltage", "Frequency", "Temperature", "SoC", "RPM".
+	const char * phase; ///< Optional. One of "L1", "L2", "L3", "N", "L1-N", "L2-N", "L3-N", "L1-L2", "L2-L3", "L3-L1".
+	const char * location; ///< Optional. One of "Cable", "EV", "Inlet", "Outlet", "Body".
+	const char * unit; ///< Optional. One of "Wh", "kWh", "varh", "kvarh", "W", "kW", "VA", "kVA", "var", "kvar", "A", "V", "K", "Celcius", "Celsius", "Fahrenheit", "Percent".
+};
+
+#define OCPPJ_SAMPLED_VALUE_HAS_VALUE (1u << 0)
+#define OCPPJ_SAMPLED_VALUE_HAS_CONTEXT (1u << 1)
+#define OCPPJ_SAMPLED_VALUE_HAS_FORMAT (1u << 2)
+#define OCPPJ_SAMPLED_VALUE_HAS_MEASURAND (1u << 3)
+#define OCPPJ_SAMPLED_VALUE_HAS_PHASE (1u << 4)
+#define OCPPJ_SAMPLED_VALUE_HAS_LOCATION (1u << 5)
+#define OCPPJ_SAMPLED_VALUE_HAS_UNIT (1u << 6)
+
+extern const struct ocppj_schema_object ocppj_sampled_value_schema; ///< Descriptor of struct ocppj_sampled_value
+
+/**
+ * @brief MeterValue
+ */
+struct ocppj_meter_value{
+	uint32_t present; ///< Bit mask of fields present
+	time_t timestamp; ///< Required. dateTime.
+	size_t sampled_value_count; ///< Number of items in sampled_value
+	struct ocppj_sampled_value * sampled_value; ///< Required.
+};
+
+#define OCPPJ_METER_VALUE_HAS_TIMESTAMP (1u << 0)
+#define OCPPJ_METER_VALUE_HAS_SAMPLED_VALUE (1u << 1)
+
+extern const struct ocppj_schema_object ocppj_meter_value_schema; ///< Descriptor of struct ocppj_meter_value
+
+/**
+ * @brief MeterValues.req payload
+ */
+struct ocppj_meter_values_req{
+	uint32_t present; ///< Bit mask of fields present
+	int connector_id; ///< Required.
+	int transaction_id; ///< Optional.
+	size_t meter_value_count; ///< Number of items in meter_value
+	struct ocppj_meter_value * meter_value; ///< Required.
+};
+
+#define OCPPJ_METER_VALUES_REQ_HAS_CONNECTOR_ID (1u << 0)
+#define OCPPJ_METER_VALUES_REQ_HAS_TRANSACTION_ID (1u << 1)
+#define OCPPJ_METER_VALUES_REQ_HAS_METER_VALUE (1u << 2)
+
+extern const struct ocppj_schema_object ocppj_meter_values_req_schema; ///< Descriptor of struct ocppj_meter_values_req
+
+/**
+ * @brief MeterValues.conf payload
+ */
+struct ocppj_meter_values_conf{
+	uint32_t present; ///< Bit mask of fields present
+};
+
+extern const struct ocppj_schema_object ocppj_meter_values_conf_schema; ///< Descriptor of struct ocppj_meter_values_conf
+
+/**
+ * @brief ChargingProfile
+ */
+struct ocppj_charging_profile{
+	uint32_t present; ///< Bit mask of fields present
+	int charging_profile_id; ///< Required.
+	int transaction_id; ///< Optional.
+	int stack_level; ///< Required.
+	const char * charging_profile_purpose; ///< Required. One of "ChargePointMaxProfile", "TxDefaultProfile", "TxProfile".
+	const char * charging_profile_kind; ///< Required. One of "Absolute", "Recurring", "Relative".
+	const char * recurrency_kind; ///< Optional. One of "Daily", "Weekly".
+	time_t valid_from; ///< Optional. dateTime.
+	time_t valid_to; ///< Optional. dateTime.
+	struct ocppj_charging_schedule charging_schedule; ///< Required.
+};
+
+#define OCPPJ_CHARGING_PROFILE_HAS_CHARGING_PROFILE_ID (1u << 0)
+#define OCPPJ_CHARGING_PROFILE_HAS_TRANSACTION_ID (1u << 1)
+#define OCPPJ_CHARGING_PROFILE_HAS_STACK_LEVEL (1u << 2)
+#define OCPPJ_CHARGING_PROFILE_HAS_CHARGING_PROFILE_PURPOSE (1u << 3)
+#define OCPPJ_CHARGING_PROFILE_HAS_CHARGING_PROFILE_KIND (1u << 4)
+#define OCPPJ_CHARGING_PROFILE_HAS_RECURRENCY_KIND (1u << 5)
+#define OCPPJ_CHARGING_PROFILE_HAS_VALID_FROM (1u << 6)
+#define OCPPJ_CHARGING_PROFILE_HAS_VALID_TO (1u << 7)
+#define OCPPJ_CHARGING_PROFILE_HAS_CHARGING_SCHEDULE (1u << 8)
+
+extern const struct ocppj_schema_object ocppj_charging_profile_schema; ///< Descriptor of struct ocppj_charging_profile
+
+/**
+ * @brief RemoteStartTransaction.req payload
+ */
+struct ocppj_remote_start_transaction_req{
+	uint32_t present; ///< Bit mask of fields present
+	int connector_id; ///< Optional.
+	const char * id_tag; ///< Required. At most 20 characters.
+	struct ocppj_charging_profile charging_profile; ///< Optional.
+};
+
+#define OCPPJ_REMOTE_START_TRANSACTION_REQ_HAS_CONNECTOR_ID (1u << 0)
+#define OCPPJ_REMOTE_START_TRANSACTION_REQ_HAS_ID_TAG (1u << 1)
+#define OCPPJ_REMOTE_START_TRANSACTION_REQ_HAS_CHARGING_PROFILE (1u << 2)
+
+extern const struct ocppj_schema_object ocppj_remote_start_transaction_req_schema; ///< Descriptor of struct ocppj_remote_start_transaction_req
+
+/**
+ * @brief RemoteStartTransaction.conf payload
+ */
+struct ocppj_remote_start_transaction_conf{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Accepted", "Rejected".
+};
+
+#define OCPPJ_REMOTE_START_TRANSACTION_CONF_HAS_STATUS (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_remote_start_transaction_conf_schema; ///< Descriptor of struct ocppj_remote_start_transaction_conf
+
+/**
+ * @brief RemoteStopTransaction.req payload
+ */
+struct ocppj_remote_stop_transaction_req{
+	uint32_t present; ///< Bit mask of fields present
+	int transaction_id; ///< Required.
+};
+
+#define OCPPJ_REMOTE_STOP_TRANSACTION_REQ_HAS_TRANSACTION_ID (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_remote_stop_transaction_req_schema; ///< Descriptor of struct ocppj_remote_stop_transaction_req
+
+/**
+ * @brief RemoteStopTransaction.conf payload
+ */
+struct ocppj_remote_stop_transaction_conf{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Accepted", "Rejected".
+};
+
+#define OCPPJ_REMOTE_STOP_TRANSACTION_CONF_HAS_STATUS (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_remote_stop_transaction_conf_schema; ///< Descriptor of struct ocppj_remote_stop_transaction_conf
+
+/**
+ * @brief ReserveNow.req payload
+ */
+struct ocppj_reserve_now_req{
+	uint32_t present; ///< Bit mask of fields present
+	int connector_id; ///< Required.
+	time_t expiry_date; ///< Required. dateTime.
+	const char * id_tag; ///< Required. At most 20 characters.
+	const char * parent_id_tag; ///< Optional. At most 20 characters.
+	int reservation_id; ///< Required.
+};
+
+#define OCPPJ_RESERVE_NOW_REQ_HAS_CONNECTOR_ID (1u << 0)
+#define OCPPJ_RESERVE_NOW_REQ_HAS_EXPIRY_DATE (1u << 1)
+#define OCPPJ_RESERVE_NOW_REQ_HAS_ID_TAG (1u << 2)
+#define OCPPJ_RESERVE_NOW_REQ_HAS_PARENT_ID_TAG (1u << 3)
+#define OCPPJ_RESERVE_NOW_REQ_HAS_RESERVATION_ID (1u << 4)
+
+extern const struct ocppj_schema_object ocppj_reserve_now_req_schema; ///< Descriptor of struct ocppj_reserve_now_req
+
+/**
+ * @brief ReserveNow.conf payload
+ */
+struct ocppj_reserve_now_conf{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Accepted", "Faulted", "Occupied", "Rejected", "Unavailable".
+};
+
+#define OCPPJ_RESERVE_NOW_CONF_HAS_STATUS (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_reserve_now_conf_schema; ///< Descriptor of struct ocppj_reserve_now_conf
+
+/**
+ * @brief Reset.req payload
+ */
+struct ocppj_reset_req{
+	uint32_t present; ///< Bit mask of fields present
+	const char * type; ///< Required. One of "Hard", "Soft".
+};
+
+#define OCPPJ_RESET_REQ_HAS_TYPE (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_reset_req_schema; ///< Descriptor of struct ocppj_reset_req
+
+/**
+ * @brief Reset.conf payload
+ */
+struct ocppj_reset_conf{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Accepted", "Rejected".
+};
+
+#define OCPPJ_RESET_CONF_HAS_STATUS (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_reset_conf_schema; ///< Descriptor of struct ocppj_reset_conf
+
+/**
+ * @brief AuthorizationData
+ */
+struct ocppj_authorization_data{
+	uint32_t present; ///< Bit mask of fields present
+	const char * id_tag; ///< Required. At most 20 characters.
+	struct ocppj_id_tag_info id_tag_info; ///< Optional.
+};
+
+#define OCPPJ_AUTHORIZATION_DATA_HAS_ID_TAG (1u << 0)
+#define OCPPJ_AUTHORIZATION_DATA_HAS_ID_TAG_INFO (1u << 1)
+
+extern const struct ocppj_schema_object ocppj_authorization_data_schema; ///< Descriptor of struct ocppj_authorization_data
+
+/**
+ * @brief SendLocalList.req payload
+ */
+struct ocppj_send_local_list_req{
+	uint32_t present; ///< Bit mask of fields present
+	int list_version; ///< Required.
+	size_t local_authorization_list_count; ///< Number of items in local_authorization_list
+	struct ocppj_authorization_data * local_authorization_list; ///< Optional.
+	const char * update_type; ///< Required. One of "Differential", "Full".
+};
+
+#define OCPPJ_SEND_LOCAL_LIST_REQ_HAS_LIST_VERSION (1u << 0)
+#define OCPPJ_SEND_LOCAL_LIST_REQ_HAS_LOCAL_AUTHORIZATION_LIST (1u << 1)
+#define OCPPJ_SEND_LOCAL_LIST_REQ_HAS_UPDATE_TYPE (1u << 2)
+
+extern const struct ocppj_schema_object ocppj_send_local_list_req_schema; ///< Descriptor of struct ocppj_send_local_list_req
+
+/**
+ * @brief SendLocalList.conf payload
+ */
+struct ocppj_send_local_list_conf{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Accepted", "Failed", "NotSupported", "VersionMismatch".
+};
+
+#define OCPPJ_SEND_LOCAL_LIST_CONF_HAS_STATUS (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_send_local_list_conf_schema; ///< Descriptor of struct ocppj_send_local_list_conf
+
+/**
+ * @brief SetChargingProfile.req payload
+ */
+struct ocppj_set_charging_profile_req{
+	uint32_t present; ///< Bit mask of fields present
+	int connector_id; ///< Required.
+	struct ocppj_charging_profile cs_charging_profiles; ///< Required.
+};
+
+#define OCPPJ_SET_CHARGING_PROFILE_REQ_HAS_CONNECTOR_ID (1u << 0)
+#define OCPPJ_SET_CHARGING_PROFILE_REQ_HAS_CS_CHARGING_PROFILES (1u << 1)
+
+extern const struct ocppj_schema_object ocppj_set_charging_profile_req_schema; ///< Descriptor of struct ocppj_set_charging_profile_req
+
+/**
+ * @brief SetChargingProfile.conf payload
+ */
+struct ocppj_set_charging_profile_conf{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Accepted", "Rejected", "NotSupported".
+};
+
+#define OCPPJ_SET_CHARGING_PROFILE_CONF_HAS_STATUS (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_set_charging_profile_conf_schema; ///< Descriptor of struct ocppj_set_charging_profile_conf
+
+/**
+ * @brief StartTransaction.req payload
+ */
+struct ocppj_start_transaction_req{
+	uint32_t present; ///< Bit mask of fields present
+	int connector_id; ///< Required.
+	const char * id_tag; ///< Required. At most 20 characters.
+	int meter_start; ///< Required.
+	int reservation_id; ///< Optional.
+	time_t timestamp; ///< Required. dateTime.
+};
+
+#define OCPPJ_START_TRANSACTION_REQ_HAS_CONNECTOR_ID (1u << 0)
+#define OCPPJ_START_TRANSACTION_REQ_HAS_ID_TAG (1u << 1)
+#define OCPPJ_START_TRANSACTION_REQ_HAS_METER_START (1u << 2)
+#define OCPPJ_START_TRANSACTION_REQ_HAS_RESERVATION_ID (1u << 3)
+#define OCPPJ_START_TRANSACTION_REQ_HAS_TIMESTAMP (1u << 4)
+
+extern const struct ocppj_schema_object ocppj_start_transaction_req_schema; ///< Descriptor of struct ocppj_start_transaction_req
+
+/**
+ * @brief StartTransaction.conf payload
+ */
+struct ocppj_start_transaction_conf{
+	uint32_t present; ///< Bit mask of fields present
+	struct ocppj_id_tag_info id_tag_info; ///< Required.
+	int transaction_id; ///< Required.
+};
+
+#define OCPPJ_START_TRANSACTION_CONF_HAS_ID_TAG_INFO (1u << 0)
+#define OCPPJ_START_TRANSACTION_CONF_HAS_TRANSACTION_ID (1u << 1)
+
+extern const struct ocppj_schema_object ocppj_start_transaction_conf_schema; ///< Descriptor of struct ocppj_start_transaction_conf
+
+/**
+ * @brief StatusNotification.req payload
+ */
+struct ocppj_status_notification_req{
+	uint32_t present; ///< Bit mask of fields present
+	int connector_id; ///< Required.
+	const char * error_code; ///< Required. One of "ConnectorLockFailure", "EVCommunicationError", "GroundFailure", "HighTemperature", "InternalError", "LocalListConflict", "NoError", "OtherError", "OverCurrentFailure", "PowerMeterFailure", "PowerSwitchFailure", "ReaderFailure", "ResetFailure", "UnderVoltage", "OverVoltage", "WeakSignal".
+	const char * info; ///< Optional. At most 50 characters.
+	const char * status; ///< Required. One of "Available", "Preparing", "Charging", "SuspendedEVSE", "SuspendedEV", "Finishing", "Reserved", "Unavailable", "Faulted".
+	time_t timestamp; ///< Optional. dateTime.
+	const char * vendor_id; ///< Optional. At most 255 characters.
+	const char * vendor_error_code; ///< Optional. At most 50 characters.
+};
+
+#define OCPPJ_STATUS_NOTIFICATION_REQ_HAS_CONNECTOR_ID (1u << 0)
+#define OCPPJ_STATUS_NOTIFICATION_REQ_HAS_ERROR_CODE (1u << 1)
+#define OCPPJ_STATUS_NOTIFICATION_REQ_HAS_INFO (1u << 2)
+#define OCPPJ_STATUS_NOTIFICATION_REQ_HAS_STATUS (1u << 3)
+#define OCPPJ_STATUS_NOTIFICATION_REQ_HAS_TIMESTAMP (1u << 4)
+#define OCPPJ_STATUS_NOTIFICATION_REQ_HAS_VENDOR_ID (1u << 5)
+#define OCPPJ_STATUS_NOTIFICATION_REQ_HAS_VENDOR_ERROR_CODE (1u << 6)
+
+extern const struct ocppj_schema_object ocppj_status_notification_req_schema; ///< Descriptor of struct ocppj_status_notification_req
+
+/**
+ * @brief StatusNotification.conf payload
+ */
+struct ocppj_status_notification_conf{
+	uint32_t present; ///< Bit mask of fields present
+};
+
+extern const struct ocppj_schema_object ocppj_status_notification_conf_schema; ///< Descriptor of struct ocppj_status_notification_conf
+
+/**
+ * @brief SampledValue
+ */
+struct ocppj_stop_transaction_sampled_value{
+	uint32_t present; ///< Bit mask of fields present
+	const char * value; ///< Required.
+	const char * context; ///< Optional. One of "Interruption.Begin", "Interruption.End", "Sample.Clock", "Sample.Periodic", "Transaction.Begin", "Transaction.End", "Trigger", "Other".
+	const char * format; ///< Optional. One of "Raw", "SignedData".
+	const char * measurand; ///< Optional. One of "Energy.Active.Export.Register", "Energy.Active.Import.Register", "Energy.Reactive.Export.Register", "Energy.Reactive.Import.Register", "Energy.Active.Export.Interval", "Energy.Active.Import.Interval", "Energy.Reactive.Export.Interval", "Energy.Reactive.Import.Interval", "Power.Active.Export", "Power.Active.Import", "Power.Offered", "Power.Reactive.Export", "Power.Reactive.Import", "Power.Factor", "Current.Import", "Current.Export", "Current.Offered", "Voltage", "Frequency", "Temperature", "SoC", "RPM".
+	const char * phase; ///< Optional. One of "L1", "L2", "L3", "N", "L1-N", "L2-N", "L3-N", "L1-L2", "L2-L3", "L3-L1".
+	const char * location; ///< Optional. One of "Cable", "EV", "Inlet", "Outlet", "Body".
+	const char * unit; ///< Optional. One of "Wh", "kWh", "varh", "kvarh", "W", "kW", "VA", "kVA", "var", "kvar", "A", "V", "K", "Celcius", "Fahrenheit", "Percent".
+};
+
+#define OCPPJ_STOP_TRANSACTION_SAMPLED_VALUE_HAS_VALUE (1u << 0)
+#define OCPPJ_STOP_TRANSACTION_SAMPLED_VALUE_HAS_CONTEXT (1u << 1)
+#define OCPPJ_STOP_TRANSACTION_SAMPLED_VALUE_HAS_FORMAT (1u << 2)
+#define OCPPJ_STOP_TRANSACTION_SAMPLED_VALUE_HAS_MEASURAND (1u << 3)
+#define OCPPJ_STOP_TRANSACTION_SAMPLED_VALUE_HAS_PHASE (1u << 4)
+#define OCPPJ_STOP_TRANSACTION_SAMPLED_VALUE_HAS_LOCATION (1u << 5)
+#define OCPPJ_STOP_TRANSACTION_SAMPLED_VALUE_HAS_UNIT (1u << 6)
+
+extern const struct ocppj_schema_object ocppj_stop_transaction_sampled_value_schema; ///< Descriptor of struct ocppj_stop_transaction_sampled_value
+
+/**
+ * @brief MeterValue
+ */
+struct ocppj_stop_transaction_meter_value{
+	uint32_t present; ///< Bit mask of fields present
+	time_t timestamp; ///< Required. dateTime.
+	size_t sampled_value_count; ///< Number of items in sampled_value
+	struct ocppj_stop_transaction_sampled_value * sampled_value; ///< Required.
+};
+
+#define OCPPJ_STOP_TRANSACTION_METER_VALUE_HAS_TIMESTAMP (1u << 0)
+#define OCPPJ_STOP_TRANSACTION_METER_VALUE_HAS_SAMPLED_VALUE (1u << 1)
+
+extern const struct ocppj_schema_object ocppj_stop_transaction_meter_value_schema; ///< Descriptor of struct ocppj_stop_transaction_meter_value
+
+/**
+ * @brief StopTransaction.req payload
+ */
+struct ocppj_stop_transaction_req{
+	uint32_t present; ///< Bit mask of fields present
+	const char * id_tag; ///< Optional. At most 20 characters.
+	int meter_stop; ///< Required.
+	time_t timestamp; ///< Required. dateTime.
+	int transaction_id; ///< Required.
+	const char * reason; ///< Optional. One of "EmergencyStop", "EVDisconnected", "HardReset", "Local", "Other", "PowerLoss", "Reboot", "Remote", "SoftReset", "UnlockCommand", "DeAuthorized".
+	size_t transaction_data_count; ///< Number of items in transaction_data
+	struct ocppj_stop_transaction_meter_value * transaction_data; ///< Optional.
+};
+
+#define OCPPJ_STOP_TRANSACTION_REQ_HAS_ID_TAG (1u << 0)
+#define OCPPJ_STOP_TRANSACTION_REQ_HAS_METER_STOP (1u << 1)
+#define OCPPJ_STOP_TRANSACTION_REQ_HAS_TIMESTAMP (1u << 2)
+#define OCPPJ_STOP_TRANSACTION_REQ_HAS_TRANSACTION_ID (1u << 3)
+#define OCPPJ_STOP_TRANSACTION_REQ_HAS_REASON (1u << 4)
+#define OCPPJ_STOP_TRANSACTION_REQ_HAS_TRANSACTION_DATA (1u << 5)
+
+extern const struct ocppj_schema_object ocppj_stop_transaction_req_schema; ///< Descriptor of struct ocppj_stop_transaction_req
+
+/**
+ * @brief StopTransaction.conf payload
+ */
+struct ocppj_stop_transaction_conf{
+	uint32_t present; ///< Bit mask of fields present
+	struct ocppj_id_tag_info id_tag_info; ///< Optional.
+};
+
+#define OCPPJ_STOP_TRANSACTION_CONF_HAS_ID_TAG_INFO (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_stop_transaction_conf_schema; ///< Descriptor of struct ocppj_stop_transaction_conf
+
+/**
+ * @brief TriggerMessage.req payload
+ */
+struct ocppj_trigger_message_req{
+	uint32_t present; ///< Bit mask of fields present
+	const char * requested_message; ///< Required. One of "BootNotification", "DiagnosticsStatusNotification", "FirmwareStatusNotification", "Heartbeat", "MeterValues", "StatusNotification".
+	int connector_id; ///< Optional.
+};
+
+#define OCPPJ_TRIGGER_MESSAGE_REQ_HAS_REQUESTED_MESSAGE (1u << 0)
+#define OCPPJ_TRIGGER_MESSAGE_REQ_HAS_CONNECTOR_ID (1u << 1)
+
+extern const struct ocppj_schema_object ocppj_trigger_message_req_schema; ///< Descriptor of struct ocppj_trigger_message_req
+
+/**
+ * @brief TriggerMessage.conf payload
+ */
+struct ocppj_trigger_message_conf{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Accepted", "Rejected", "NotImplemented".
+};
+
+#define OCPPJ_TRIGGER_MESSAGE_CONF_HAS_STATUS (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_trigger_message_conf_schema; ///< Descriptor of struct ocppj_trigger_message_conf
+
+/**
+ * @brief UnlockConnector.req payload
+ */
+struct ocppj_unlock_connector_req{
+	uint32_t present; ///< Bit mask of fields present
+	int connector_id; ///< Required.
+};
+
+#define OCPPJ_UNLOCK_CONNECTOR_REQ_HAS_CONNECTOR_ID (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_unlock_connector_req_schema; ///< Descriptor of struct ocppj_unlock_connector_req
+
+/**
+ * @brief UnlockConnector.conf payload
+ */
+struct ocppj_unlock_connector_conf{
+	uint32_t present; ///< Bit mask of fields present
+	const char * status; ///< Required. One of "Unlocked", "UnlockFailed", "NotSupported".
+};
+
+#define OCPPJ_UNLOCK_CONNECTOR_CONF_HAS_STATUS (1u << 0)
+
+extern const struct ocppj_schema_object ocppj_unlock_connector_conf_schema; ///< Descriptor of struct ocppj_unlock_connector_conf
+
+/**
+ * @brief UpdateFirmware.req payload
+ */
+struct ocppj_update_firmware_req{
+	uint32_t present; ///< Bit mask of fields present
+	const char * location; ///< Required.
+	int retries; ///< Optional.
+	time_t retrieve_date; ///< Required. dateTime.
+	int retry_interval; ///< Optional.
+};
+
+#define OCPPJ_UPDATE_FIRMWARE_REQ_HAS_LOCATION (1u << 0)
+#define OCPPJ_UPDATE_FIRMWARE_REQ_HAS_RETRIES (1u << 1)
+#define OCPPJ_UPDATE_FIRMWARE_REQ_HAS_RETRIEVE_DATE (1u << 2)
+#define OCPPJ_UPDATE_FIRMWARE_REQ_HAS_RETRY_INTERVAL (1u << 3)
+
+extern const struct ocppj_schema_object ocppj_update_firmware_req_schema; ///< Descriptor of struct ocppj_update_firmware_req
+
+/**
+ * @brief UpdateFirmware.conf payload
+ */
+struct ocppj_update_firmware_conf{
+	uint32_t present; ///< Bit mask of fields present
+};
+
+extern const struct ocppj_schema_object ocppj_update_firmware_conf_schema; ///< Descriptor of struct ocppj_update_firmware_conf
+
+#endif /*OCPPJ_SCHEMA_TYPES_H*/
@@ -0,0 +1,175 @@
+#ifndef OCPP_JSON_STREAM_H
+#define OCPP_JSON_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "cJSON.h"
+
+/** @file
+ * @brief Contains an incremental JSON parser used for websocket frames that arrive in several fragments
+ *
+ * @details Data is consumed as it is received, so the frame does not need to be copied into a single buffer before it
+ * is parsed. The parser builds a cJSON tree like cJSON_Parse, except for a single array that may be selected while
+ * parsing. Elements of the selected array are given to a callback when complete and deleted when the callback returns,
+ * so the memory needed for a large array is bounded by the largest element instead of the whole array.
+ */
+
+/**
+ * @brief Maximum depth of nested arrays and objects
+ */
+#define OCPP_JSON_STREAM_MAX_DEPTH 16
+
+/**
+ * @brief Maximum number of keys or array indexes leading to a streamed array
+ */
+#define OCPP_JSON_STREAM_MAX_PATH_LENGTH 6
+
+/**
+ * @brief Default maximum length of a single string, number or literal
+ */
+#define OCPP_JSON_STREAM_DEFAULT_MAX_TOKEN_LENGTH 4096
+
+struct ocpp_json_stream;
+
+/**
+ * @brief Called when a direct child of the root container is complete. May select a streamed array with
+ * ocpp_json_stream_set_array_path.
+ *
+ * @param stream the parser
+ * @param root the root container
+ * @param index index of the child in the root container
+ * @param cb_data data given to ocpp_json_stream_init
+ */
+typedef void (*ocpp_json_stream_child_callback)(struct ocpp_json_stream * stream, cJSON * root, size_t index, void * cb_data);
+
+/**
+ * @brief Called with each element of the streamed array. The element is deleted when the callback returns.
+ *
+ * @param element the complete element
+ * @param index index of the element in the streamed array
+ * @param cb_data data given to ocpp_json_stream_init
+ *
+ * @return 0 to continue or non zero to stop parsing with an error
+ */
+typedef int (*ocpp_json_stream_element_callback)(cJSON * element, size_t index, void * cb_data);
+
+enum ocpp_json_stream_state{
+	eOCPP_JSON_STREAM_VALUE, ///< Expecting a value
+	eOCPP_JSON_STREAM_VALUE_OR_END, ///< Expecting the first value of an array or ']'
+	eOCPP_JSON_STREAM_KEY, ///< Expecting a key
+	eOCPP_JSON_STREAM_KEY_OR_END, ///< Expecting the first key of an object or '}'
+	eOCPP_JSON_STREAM_COLON, ///< Expecting ':' after a key
+	eOCPP_JSON_STREAM_COMMA_OR_END, ///< Expecting ',' or the end of the current container
+	eOCPP_JSON_STREAM_STRING, ///< In a string value
+	eOCPP_JSON_STREAM_KEY_STRING, ///< In a key
+	eOCPP_JSON_STREAM_ESCAPE, ///< After '\' in a string or key
+	eOCPP_JSON_STREAM_UNICODE, ///< In the hex digits of a \u escape sequence
+	eOCPP_JSON_STREAM_NUMBER, ///< In a number
+	eOCPP_JSON_STREAM_LITERAL, ///< In true, false or null
+	eOCPP_JSON_STREAM_DONE, ///< Root value is complete
+	eOCPP_JSON_STREAM_ERROR, ///< Parsing failed
+};
+
+/**
+ * @brief An array or object being parsed
+ */
+struct ocpp_json_stream_frame{
+	cJSON * container; ///< The container. Not attached to its parent if the parent is streamed.
+	char * key; ///< Key of the member being parsed if the container is an object
+	size_t index; ///< Number of completed children
+	bool on_path; ///< True if the keys leading to the container match the start of the streamed path
+	bool streamed; ///< True if the children are given to the element callback instead of added to the container
+};
+
+/**
+ * @brief Parser state
+ */
+struct ocpp_json_stream{
+	enum ocpp_json_stream_state state;
+	enum ocpp_json_stream_state string_state; ///< String state to return to after an escape sequence
+	struct ocpp_json_stream_frame frames[OCPP_JSON_STREAM_MAX_DEPTH];
+	size_t depth; ///< Number of open containers
+	cJSON * root; ///< Complete root value when state is eOCPP_JSON_STREAM_DONE
+	char * token; ///< Buffer for the current string, number or literal
+	size_t token_length;
+	size_t token_size;
+	size_t max_token_length;
+	uint32_t unicode; ///< Code point of the current \u escape sequence
+	uint32_t high_surrogate; ///< High surrogate waiting for its low surrogate
+	uint8_t unicode_digits; ///< Number of hex digits read of the current \u escape sequence
+	const char * path[OCPP_JSON_STREAM_MAX_PATH_LENGTH]; ///< Keys or decimal array indexes leading to the streamed array
+	size_t path_length; ///< Number of entries in path or 0 if no array is streamed
+	ocpp_json_stream_child_callback child_cb;
+	ocpp_json_stream_element_callback element_cb;
+	void * cb_data;
+	size_t streamed_count; ///< Number of elements given to the element callback
+	size_t consumed; ///< Number of bytes consumed, used to locate errors
+};
+
+/**
+ * @brief Initialize a parser
+ *
+ * @param stream the parser to initialize
+ * @param max_token_length maximum length of a single string, number or literal
+ * @param child_cb optional callback for complete children of the root container
+ * @param element_cb optional callback for elements of the streamed array
+ * @param cb_data data given to the callbacks
+ */
+void ocpp_json_stream_init(struct ocpp_json_stream * stream, size_t max_token_length, ocpp_json_stream_child_callback child_cb,
+			ocpp_json_stream_element_callback element_cb, void * cb_data);
+
+/**
+ * @brief Free the partial tree and prepare the parser for a new value. Callbacks and max token length are kept, the
+ * streamed path is cleared.
+ *
+ * @param stream the parser to reset
+ */
+void ocpp_json_stream_reset(struct ocpp_json_stream * stream);
+
+/**
+ * @brief Free all memory held by the parser
+ *
+ * @param stream the parser to free
+ */
+void ocpp_json_stream_deinit(struct ocpp_json_stream * stream);
+
+/**
+ * @brief Select the array whose elements should be given to the element callback. Only affects containers that have
+ * not been opened yet.
+ *
+ * @param stream the parser
+ * @param path keys of objects or decimal indexes of arrays leading from the root to the array. The strings must remain
+ * valid until the parser is reset.
+ * @param path_length number of entries in path
+ *
+ * @return ESP_OK or ESP_ERR_INVALID_ARG if the path is too long
+ */
+esp_err_t ocpp_json_stream_set_array_path(struct ocpp_json_stream * stream, const char * const * path, size_t path_length);
+
+/**
+ * @brief Parse the next part of the value
+ *
+ * @param stream the parser
+ * @param data the next bytes of the value
+ * @param length number of bytes in data
+ *
+ * @return ESP_OK if the data was valid so far, ESP_ERR_INVALID_ARG if the data is not valid JSON, ESP_ERR_INVALID_SIZE if a
+ * token or the depth exceeds the limits, ESP_ERR_NO_MEM on allocation failure or ESP_FAIL if the element callback
+ * stopped parsing
+ */
+esp_err_t ocpp_json_stream_feed(struct ocpp_json_stream * stream, const char * data, size_t length);
+
+/**
+ * @brief End the value and take the parsed tree
+ *
+ * @param stream the parser
+ * @param root_out output parameter for the root value. Must be deleted by the caller.
+ *
+ * @return ESP_OK if a complete value was parsed, else ESP_ERR_INVALID_STATE
+ */
+esp_err_t ocpp_json_stream_finish(struct ocpp_json_stream * stream, cJSON ** root_out);
+
+#endif /* OCPP_JSON_STREAM_H */
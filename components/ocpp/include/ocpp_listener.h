@@ -20,6 +20,26 @@
  */
 int attach_call_cb(enum ocpp_call_action_id action_id, ocpp_call_callback call_cb, void * cb_data);
 
+/**
+ * @brief Callbacks for receiving the elements of a large array in a request one at a time while the frame is parsed.
+ *
+ * The array is left empty in the payload given to the call callback.
+ */
+struct ocpp_call_element_stream{
+	const char * const * path; ///< Keys or decimal array indexes leading from the payload to the array
+	size_t path_length; ///< Number of entries in path
+	void (*begin)(void * cb_data); ///< Called when a request with the action is received, before any element
+	int (*element)(cJSON * element, size_t index, void * cb_data); ///< Called with each element. Non zero drops the request
+};
+
+/**
+ * @brief set callbacks for streaming an array in a given ocpp request sent by the central system.
+ *
+ * @param action_id id of the action containing the array. Only used if a call callback is attached for the action.
+ * @param stream the callbacks, must remain valid while attached. Callbacks get the cb_data given to attach_call_cb.
+ */
+int attach_call_element_stream(enum ocpp_call_action_id action_id, const struct ocpp_call_element_stream * stream);
+
 /**
  * @brief Sets a task to be notified of with ocpp_websocket_event using eSetBits.
  *
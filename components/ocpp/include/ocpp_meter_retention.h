@@ -0,0 +1,76 @@
+#ifndef OCPP_METER_RETENTION_H
+#define OCPP_METER_RETENTION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "types/ocpp_meter_value.h"
+
+/** @file
+ * @brief Retention policy for meter values stored on transaction files while offline.
+ *
+ * @details When a transaction file fills up, stored meter values are thinned instead of rejecting new values. Values
+ * are dropped one at a time, choosing the value that would leave the smallest gap relative to its age. Older values
+ * are therefore thinned before newer values, and the retained resolution degrades gradually with age.
+ *
+ * Clock aligned values are weighted higher than periodic values, and more so if they are on a larger multiple of the
+ * boundary interval, so that aligned boundaries remain when the surrounding values are dropped. A value is never
+ * dropped if it is the first or last value, newer than the full resolution window, protected, or a local extreme of
+ * Energy.Active.Import.Register compared to the values around it.
+ */
+
+#define OCPP_RETENTION_RECORD_CLOCK_ALIGNED (1u << 0) ///< Contains a value with context Sample.Clock
+#define OCPP_RETENTION_RECORD_HAS_ENERGY (1u << 1) ///< energy_wh contains Energy.Active.Import.Register
+#define OCPP_RETENTION_RECORD_PROTECTED (1u << 2) ///< Must be kept, e.g. transaction data for StopTransaction.req
+#define OCPP_RETENTION_RECORD_DROPPED (1u << 3) ///< Set by ocpp_meter_retention_thin for records to remove
+
+/**
+ * @brief Maximum number of records that can be considered by ocpp_meter_retention_thin
+ */
+#define OCPP_RETENTION_MAX_RECORDS (UINT16_MAX - 1)
+
+/**
+ * @brief Summary of a stored meter value used to decide if it should be kept
+ */
+struct ocpp_retention_record{
+	time_t timestamp; ///< Timestamp of the first meter value in the record
+	float energy_wh; ///< Energy.Active.Import.Register in Wh if OCPP_RETENTION_RECORD_HAS_ENERGY is set
+	uint16_t size; ///< Bytes freed if the record is dropped
+	uint8_t flags; ///< OCPP_RETENTION_RECORD_ flags
+};
+
+/**
+ * @brief Parameters of the retention policy
+ */
+struct ocpp_retention_policy{
+	uint32_t full_resolution_sec; ///< Records this close to the newest record are never dropped
+	uint32_t boundary_sec; ///< Interval of aligned boundaries that should be kept longer, 0 to not prefer boundaries
+};
+
+/**
+ * @brief creates the record summary for a stored meter value
+ *
+ * @param list meter values stored as one record
+ * @param is_stop_txn_data true if the list is transaction data for StopTransaction.req. The record is then protected.
+ * @param size bytes used to store the list
+ * @param record_out the summary
+ */
+void ocpp_meter_retention_record_from_list(struct ocpp_meter_value_list * list, bool is_stop_txn_data, size_t size,
+					struct ocpp_retention_record * record_out);
+
+/**
+ * @brief marks records to drop until the requested number of bytes are freed or no more records can be dropped
+ *
+ * @param policy the retention policy
+ * @param records records in chronological order. Records to drop get OCPP_RETENTION_RECORD_DROPPED.
+ * @param record_count number of records, at most OCPP_RETENTION_MAX_RECORDS are considered
+ * @param bytes_to_free number of bytes requested
+ *
+ * @return the number of bytes freed by the dropped records. May be less than requested or 0 on allocation failure.
+ */
+size_t ocpp_meter_retention_thin(const struct ocpp_retention_policy * policy, struct ocpp_retention_record * records,
+				size_t record_count, size_t bytes_to_free);
+
+#endif /*OCPP_METER_RETENTION_H*/
@@ -0,0 +1,116 @@
+#ifndef OCPP_RTT_H
+#define OCPP_RTT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cJSON.h"
+
+/** @file
+ * @brief Round trip time statistics for calls sent to the CS and the message timeout derived from them.
+ *
+ * @details Each set of statistics keeps a smoothed round trip time and round trip time variation (EWMA as used for
+ * TCP retransmission timers in RFC 6298) and a histogram with logarithmic buckets. The histogram is halved when it
+ * reaches OCPP_RTT_HISTOGRAM_DECAY_COUNT samples so that percentiles follow changes in the connection. The message
+ * timeout is the largest of the smoothed estimate and the 99th percentile, doubled for each consecutive timeout and
+ * limited by the given bounds.
+ */
+
+/**
+ * @brief Number of buckets in the round trip time histogram
+ */
+#define OCPP_RTT_HISTOGRAM_BUCKETS 20
+
+/**
+ * @brief Number of samples before the histogram counts are halved
+ */
+#define OCPP_RTT_HISTOGRAM_DECAY_COUNT 256
+
+/**
+ * @brief Number of samples needed before the statistics are used to decide the message timeout
+ */
+#define OCPP_RTT_MIN_SAMPLES 4
+
+/**
+ * @brief Maximum number of times the timeout is doubled due to consecutive timeouts
+ */
+#define OCPP_RTT_MAX_BACKOFF 4
+
+/**
+ * @brief Round trip time statistics
+ */
+struct ocpp_rtt_stats{
+	uint32_t srtt_x8; ///< Smoothed round trip time in ms multiplied by 8
+	uint32_t rttvar_x4; ///< Round trip time variation in ms multiplied by 4
+	uint32_t min_ms; ///< Lowest round trip time
+	uint32_t max_ms; ///< Highest round trip time
+	uint32_t sample_count; ///< Number of round trip times added
+	uint32_t timeout_count; ///< Number of calls that timed out
+	uint8_t backoff; ///< Consecutive timeouts since last sample, limited by OCPP_RTT_MAX_BACKOFF
+	uint16_t histogram_count; ///< Sum of histogram buckets
+	uint16_t histogram[OCPP_RTT_HISTOGRAM_BUCKETS]; ///< Samples per bucket, see ocpp_rtt_bucket_limit
+};
+
+/**
+ * @brief clears all statistics
+ */
+void ocpp_rtt_reset(struct ocpp_rtt_stats * stats);
+
+/**
+ * @brief adds the round trip time of a call that got a CallResult or CallError
+ *
+ * @param stats statistics to update
+ * @param rtt_ms time from the call was sent until the response was received
+ */
+void ocpp_rtt_add_sample(struct ocpp_rtt_stats * stats, uint32_t rtt_ms);
+
+/**
+ * @brief registers a call that did not get a response before the message timeout
+ */
+void ocpp_rtt_add_timeout(struct ocpp_rtt_stats * stats);
+
+/**
+ * @brief gets the upper limit in ms of a histogram bucket. The last bucket has no limit and returns UINT32_MAX.
+ */
+uint32_t ocpp_rtt_bucket_limit(size_t bucket);
+
+/**
+ * @brief gets the round trip time that the given percent of recent samples were below
+ *
+ * @details The result is the upper limit of the bucket containing the percentile, or max_ms if lower.
+ *
+ * @param stats statistics to read
+ * @param percent percentile to get, 1 to 100
+ *
+ * @return the percentile in ms or 0 if no samples have been added
+ */
+uint32_t ocpp_rtt_percentile(const struct ocpp_rtt_stats * stats, uint8_t percent);
+
+/**
+ * @brief gets the smoothed round trip time in ms
+ */
+uint32_t ocpp_rtt_smoothed(const struct ocpp_rtt_stats * stats);
+
+/**
+ * @brief gets the message timeout in ms derived from the statistics
+ *
+ * @param stats statistics to use
+ * @param min_ms lower bound of the timeout
+ * @param max_ms upper bound of the timeout. Returned if there are less than OCPP_RTT_MIN_SAMPLES samples
+ */
+uint32_t ocpp_rtt_timeout(const struct ocpp_rtt_stats * stats, uint32_t min_ms, uint32_t max_ms);
+
+/**
+ * @brief gets true if the statistics have enough samples to be used for the message timeout
+ */
+bool ocpp_rtt_is_usable(const struct ocpp_rtt_stats * stats);
+
+/**
+ * @brief creates a JSON object with the statistics for diagnostics
+ *
+ * @return the object or NULL on failure
+ */
+cJSON * ocpp_rtt_to_json(const struct ocpp_rtt_stats * stats);
+
+#endif /* OCPP_RTT_H */
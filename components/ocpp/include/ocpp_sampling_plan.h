@@ -0,0 +1,134 @@
+#ifndef OCPP_SAMPLING_PLAN_H
+#define OCPP_SAMPLING_PLAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "esp_err.h"
+#include "types/ocpp_meter_value.h"
+
+/** @file
+ * @brief Contains sampling plans compiled from the measurand comma separated lists used for MeterValues.req and
+ * StopTransaction.req
+ *
+ * @details A plan is compiled when the configured measurands change. It contains one group per item in the configured
+ * list and one item for each sampled value the group creates, with the measurand, phase, location, unit and source of
+ * the value already decided. Sampling a group does not parse the configuration and only formats values read from a
+ * single snapshot, so that all values in a MeterValues.req are taken at the same time.
+ */
+
+/**
+ * @brief Maximum number of groups in a plan. Each group is one item of the measurand list.
+ */
+#define OCPP_SAMPLING_PLAN_MAX_GROUPS 10
+
+/**
+ * @brief Maximum number of sampled values created by a single group. One per phase.
+ */
+#define OCPP_SAMPLING_PLAN_MAX_GROUP_ITEMS 3
+
+/**
+ * @brief Maximum number of sampled values in a plan
+ */
+#define OCPP_SAMPLING_PLAN_MAX_ITEMS (OCPP_SAMPLING_PLAN_MAX_GROUPS * OCPP_SAMPLING_PLAN_MAX_GROUP_ITEMS)
+
+/**
+ * @brief Readings that sampled values can be created from
+ */
+enum ocpp_sample_source{
+	eOCPP_SAMPLE_SOURCE_CURRENT_L1, ///< Current on L1 in A
+	eOCPP_SAMPLE_SOURCE_CURRENT_L2, ///< Current on L2 in A
+	eOCPP_SAMPLE_SOURCE_CURRENT_L3, ///< Current on L3 in A
+	eOCPP_SAMPLE_SOURCE_CURRENT_OFFERED, ///< Current offered to the EV in A
+	eOCPP_SAMPLE_SOURCE_ENERGY_REGISTER, ///< Accumulated active energy in Wh
+	eOCPP_SAMPLE_SOURCE_ENERGY_INTERVAL, ///< Active energy since the start of the interval in kWh
+	eOCPP_SAMPLE_SOURCE_POWER, ///< Active power in W
+	eOCPP_SAMPLE_SOURCE_TEMPERATURE_BODY_1, ///< First power board temperature in Celsius
+	eOCPP_SAMPLE_SOURCE_TEMPERATURE_BODY_2, ///< Second power board temperature in Celsius
+	eOCPP_SAMPLE_SOURCE_TEMPERATURE_L1, ///< Outlet temperature on L1 in Celsius
+	eOCPP_SAMPLE_SOURCE_TEMPERATURE_L2, ///< Outlet temperature on L2 in Celsius
+	eOCPP_SAMPLE_SOURCE_TEMPERATURE_L3, ///< Outlet temperature on L3 in Celsius
+	eOCPP_SAMPLE_SOURCE_VOLTAGE_L1, ///< Voltage on L1 in V
+	eOCPP_SAMPLE_SOURCE_VOLTAGE_L2, ///< Voltage on L2 in V
+	eOCPP_SAMPLE_SOURCE_VOLTAGE_L3, ///< Voltage on L3 in V
+	eOCPP_SAMPLE_SOURCE_COUNT
+};
+
+/**
+ * @brief Readings taken at the same time. Sources not part of the plan's source_mask need not be read.
+ */
+struct ocpp_sample_snapshot{
+	float value[eOCPP_SAMPLE_SOURCE_COUNT]; ///< Reading of each source. NAN if the reading is not available.
+	time_t timestamp; ///< Time the readings were taken
+	time_t interval_timestamp; ///< End of the interval used for interval measurands
+};
+
+/**
+ * @brief A single sampled value created by a plan
+ */
+struct ocpp_sampling_plan_item{
+	uint8_t measurand; ///< enum ocpp_measurand_id
+	uint8_t phase; ///< enum ocpp_phase_id or 0 if omitted
+	uint8_t location; ///< enum ocpp_location_id or 0 if omitted
+	uint8_t unit; ///< enum ocpp_unit_id
+	uint8_t source; ///< enum ocpp_sample_source
+	uint8_t decimals; ///< Number of decimals in the formatted value
+};
+
+/**
+ * @brief The sampled values created for one item in the measurand list. Each group becomes one MeterValue.
+ */
+struct ocpp_sampling_plan_group{
+	uint8_t measurand; ///< enum ocpp_measurand_id
+	uint8_t phase; ///< Phase given in the list item or 0 if all phases were requested
+	uint8_t first_item; ///< Index of the first item of the group
+	uint8_t item_count; ///< Number of items in the group
+	bool interval; ///< True if the measurand is an interval measurand and uses interval_timestamp
+};
+
+/**
+ * @brief Sampled values to create for a measurand list on a connector
+ */
+struct ocpp_sampling_plan{
+	struct ocpp_sampling_plan_group groups[OCPP_SAMPLING_PLAN_MAX_GROUPS];
+	size_t group_count;
+	struct ocpp_sampling_plan_item items[OCPP_SAMPLING_PLAN_MAX_ITEMS];
+	size_t item_count;
+	uint32_t source_mask; ///< Bit (1 << source) is set for each source used by the plan
+};
+
+/**
+ * @brief Compile a measurand list into a plan
+ *
+ * Items of the list that are not supported on the connector do not create a group.
+ *
+ * @param plan the plan to write
+ * @param measurand_csl comma separated list of measurands, each optionally followed by ".L1", ".L2" or ".L3"
+ * @param connector_id the connector the values will be sampled for
+ * @param single_phase true if only L1 should be sampled when the list item does not give a phase
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE if the list exceeds the size of the plan
+ */
+esp_err_t ocpp_sampling_plan_compile(struct ocpp_sampling_plan * plan, const char * measurand_csl, unsigned int connector_id,
+				bool single_phase);
+
+/**
+ * @brief Create the sampled values of a group
+ *
+ * Items whose source is NAN in the snapshot are skipped.
+ *
+ * @param plan the compiled plan
+ * @param group_index index of the group to sample
+ * @param snapshot readings to create the values from
+ * @param context reading context of the created values
+ * @param values_out array of at least OCPP_SAMPLING_PLAN_MAX_GROUP_ITEMS values to write
+ *
+ * @return number of values written
+ */
+size_t ocpp_sampling_plan_sample_group(const struct ocpp_sampling_plan * plan, size_t group_index,
+				const struct ocpp_sample_snapshot * snapshot, enum ocpp_reading_context_id context,
+				struct ocpp_sampled_value * values_out);
+
+#endif /* OCPP_SAMPLING_PLAN_H */
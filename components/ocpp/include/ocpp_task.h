@@ -73,6 +73,14 @@ enum call_type{
  */
 int send_call_reply(cJSON * call);
 
+/**
+ * @brief Reply to central service originated action call with an already serialized message.
+ *
+ * @param message complete OCPP-J message to send to CS. Ownership is not taken.
+ * @param length length of message
+ */
+int send_call_reply_text(const char * message, size_t length);
+
 /**
  * @brief send a status notification to CS
  *
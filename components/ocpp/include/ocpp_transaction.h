@@ -138,6 +138,9 @@ esp_err_t ocpp_transaction_load_cb_data(struct ocpp_transaction_start_stop_cb_da
 
 /**
  * @brief Updates the transaction state to indicate that a .conf or error response has been received.
+ *
+ * @note If the last message was a MeterValues.req created from multiple meter values stored on file (see
+ * CONFIG_OCPP_TRANSACTION_METER_VALUES_COALESCE_MAX_SIZE), then all meter values in the request are confirmed.
  */
 esp_err_t ocpp_transaction_confirm_last();
 
@@ -8,6 +8,7 @@
 #include "cJSON.h"
 
 #include "ocpp_json/ocppj_message_structure.h"
+#include "ocpp_json/ocppj_schema_types.h"
 
 /** @file
 * @brief Contains the OCPP types related to ChargingProfile
@@ -233,6 +234,17 @@ enum ocppj_err_t ocpp_charging_profile_from_json(cJSON * csChargingProfiles, int
 					int max_periods, struct ocpp_charging_profile * charging_profile_out,
 					char * error_description_out, size_t error_description_length);
 
+/**
+ * @brief Creates a charging profile from a ChargingProfile read with ocppj_charging_profile_schema
+ *
+ * @details Checks the constraints that are not part of the schema, like the allowed stack levels and which fields
+ * depend on the purpose and kind of the profile. The parameters are the same as for ocpp_charging_profile_from_json.
+ */
+enum ocppj_err_t ocpp_charging_profile_from_schema(const struct ocppj_charging_profile * profile, int max_stack_level,
+						const char * allowed_charging_rate_units, int max_periods,
+						struct ocpp_charging_profile * charging_profile_out,
+						char * error_description_out, size_t error_description_length);
+
 /**
  * @brief allocates a buffer and copies the period_list into the new buffer
  * @note Caller is responsible for freeing the returned pointer.
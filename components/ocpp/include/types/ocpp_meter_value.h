@@ -469,18 +469,43 @@ struct ocpp_meter_value_list * ocpp_meter_list_get_last(struct ocpp_meter_value_
  */
 size_t ocpp_meter_list_get_length(struct ocpp_meter_value_list * list);
 
+/**
+ * @brief Identifies the encoding used for contiguous meter list buffers
+ */
+enum ocpp_meter_buffer_version{
+	eOCPP_METER_BUFFER_V1 = 1, ///< Sampled values written as value strings with one byte per meta data field
+	eOCPP_METER_BUFFER_V2, ///< Compact encoding with packed meta data, delta timestamps and fixed point values
+};
+
 /**
  * @brief write the list as a short writable string for storage
  *
+ * @note The version used is v2 if CONFIG_OCPP_METER_VALUE_COMPACT_STORAGE is set else v1.
+ *
  * @param list the list to write as string
  * @param is_stop_txn_data if true then list should be for a StopTransaction.req else it is for MeterValues.req
  * @param buffer_length_out length of the written string
  */
 unsigned char * ocpp_meter_list_to_contiguous_buffer(struct ocpp_meter_value_list * list, bool is_stop_txn_data, size_t * buffer_length_out);
 
+/**
+ * @brief write the list as a short writable string for storage using a specific encoding
+ *
+ * @note If v2 is requested but the list can not be written as v2, then v1 is written.
+ *
+ * @param list the list to write as string
+ * @param is_stop_txn_data if true then list should be for a StopTransaction.req else it is for MeterValues.req
+ * @param version the encoding to use
+ * @param buffer_length_out length of the written string
+ */
+unsigned char * ocpp_meter_list_to_contiguous_buffer_version(struct ocpp_meter_value_list * list, bool is_stop_txn_data,
+							enum ocpp_meter_buffer_version version, size_t * buffer_length_out);
+
 /**
  * @brief converts a short string representing a meter value list to its list representation
  *
+ * @note Both v1 and v2 encoded buffers can be converted.
+ *
  * @param buffer the short string representing the list
  * @param buffer_length the length of the short string
  * @param is_stop_txn_data if true then list should be for a StopTransaction.req else it is for MeterValues.req
@@ -12,6 +12,8 @@
 #include "ocpp_task.h"
 #include "ocpp_listener.h"
 #include "ocpp_auth.h"
+#include "ocpp_auth_index.h"
+#include "ocpp_auth_filter.h"
 #include "messages/call_messages/ocpp_call_request.h"
 #include "types/ocpp_charge_point_error_code.h"
 #include "sdkconfig.h"
@@ -49,6 +51,8 @@ struct auth_tag_entry{
 static const char * auth_list_path = DIRECTORY_PATH "/auth_lst.bin";
 static const char * auth_list_tmp_path = DIRECTORY_PATH "/auth_lst.tmp";
 static const char * auth_cache_path = DIRECTORY_PATH "/auth_cah.bin";
+static const char * auth_list_filter_path = DIRECTORY_PATH "/auth_lst.flt";
+static const char * auth_cache_filter_path = DIRECTORY_PATH "/auth_cah.flt";
 
 #define OFFSET_HEADER 0
 #define OFFSET_TOKEN_LIST OFFSET_HEADER + sizeof(struct auth_header) + sizeof(uint32_t)
@@ -56,8 +60,15 @@ static const char * auth_cache_path = DIRECTORY_PATH "/auth_cah.bin";
 #define OFFSET_TAG_LIST_AUTH_LIST OFFSET_TOKEN_LIST + (sizeof(ocpp_id_token) * CONFIG_OCPP_LOCAL_AUTH_LIST_MAX_LENGTH)
 #define OFFSET_TAG_LIST_AUTH_CACHE OFFSET_TOKEN_LIST + (sizeof(ocpp_id_token) * CONFIG_OCPP_AUTH_CACHE_MAX_LENGTH)
 
+#define OFFSET_INDEX_AUTH_LIST OFFSET_TAG_LIST_AUTH_LIST + (sizeof(struct auth_tag_entry) * CONFIG_OCPP_LOCAL_AUTH_LIST_MAX_LENGTH)
+#define OFFSET_INDEX_AUTH_CACHE OFFSET_TAG_LIST_AUTH_CACHE + (sizeof(struct auth_tag_entry) * CONFIG_OCPP_AUTH_CACHE_MAX_LENGTH)
+
 static SemaphoreHandle_t file_lock = NULL;
 
+// Filters for tokens known to not be in the authorization list or cache. Protected by file_lock
+static struct ocpp_auth_filter list_filter = {0};
+static struct ocpp_auth_filter cache_filter = {0};
+
 bool local_pre_authorize = true;
 bool authorize_offline = true;
 bool auth_list_enabled = true;
@@ -96,6 +107,7 @@ void ocpp_change_allow_offline_for_unknown(bool new_value){
  * <header>: at OFFSET_HEADER
  * <token_list>: at OFFSET_TOKEN_LIST
  * <tag_info_list>: at OFFSET_TAG_LIST_AUTH_LIST or OFFSET_TAG_LIST_AUTH_CACHE
+ * <index>: at OFFSET_INDEX_AUTH_LIST or OFFSET_INDEX_AUTH_CACHE
  *
  * <header>: {<file_version><list_version><token_count>}<crc_header>
  * <token_list>: <id_token_0>...<id_token_MAX>
@@ -116,6 +128,9 @@ void ocpp_change_allow_offline_for_unknown(bool new_value){
  * containing the token and tag info with parent id.
  * list_version is only relevant for authorization list and not authorization cache. The
  * authorization cache should have version INT_MAX.
+ * The <index> is a hash index of the token list described in ocpp_auth_index.c. It is only
+ * valid for the header crc it was committed with. If it is not valid then the token list is
+ * scanned during reads and the index is rebuilt before the next write.
  */
 
 static bool filesystem_is_ready(){
@@ -133,6 +148,125 @@ static bool filesystem_is_ready(){
 	return true;
 }
 
+/*
+ * Adds all tokens in the token list to the filter. Expects file_lock to be held.
+ */
+static esp_err_t fill_auth_filter(struct ocpp_auth_filter * filter, FILE * fp, size_t token_count, size_t max_entries){
+	ocpp_auth_filter_clear(filter, true);
+
+	if(fseek(fp, OFFSET_TOKEN_LIST, SEEK_SET) != 0){
+		ESP_LOGE(TAG, "Unable to seek to token list to fill filter: %s", strerror(errno));
+		goto error;
+	}
+
+	ocpp_id_token id_tags[16];
+	size_t read_count = 0;
+
+	for(size_t entry = 0; read_count < token_count && entry < max_entries; entry += 16){
+		size_t count = max_entries - entry;
+		if(count > 16)
+			count = 16;
+
+		if(fread(id_tags, sizeof(ocpp_id_token), count, fp) != count){
+			ESP_LOGE(TAG, "Unable to read token list to fill filter: %s", strerror(errno));
+			goto error;
+		}
+
+		for(size_t i = 0; i < count && read_count < token_count; i++){
+			if(id_tags[i][0] == '\0')
+				continue;
+
+			id_tags[i][sizeof(ocpp_id_token) -1] = '\0';
+			ocpp_auth_filter_add(filter, id_tags[i]);
+			read_count++;
+		}
+	}
+
+	return ESP_OK;
+
+error:
+	ocpp_auth_filter_clear(filter, false);
+	return ESP_FAIL;
+}
+
+/*
+ * Recreates the filter from the authorization file and saves it. If it fails the filter becomes invalid and all
+ * lookups will use the file. Expects file_lock to be held.
+ */
+static void rebuild_auth_filter(bool is_list){
+	struct ocpp_auth_filter * filter = is_list ? &list_filter : &cache_filter;
+	const char * file_path = is_list ? auth_list_path : auth_cache_path;
+	const char * filter_path = is_list ? auth_list_filter_path : auth_cache_filter_path;
+
+	if(filter->bits == NULL)
+		return;
+
+	ESP_LOGI(TAG, "Rebuilding filter for '%s'", file_path);
+
+	struct stat st;
+	if(stat(file_path, &st) != 0){
+		ocpp_auth_filter_clear(filter, true);
+		remove(filter_path);
+		return;
+	}
+
+	FILE * fp = fopen(file_path, "rb");
+	if(fp == NULL){
+		ESP_LOGE(TAG, "Unable to open '%s' to rebuild filter: %s", file_path, strerror(errno));
+		ocpp_auth_filter_clear(filter, false);
+		return;
+	}
+
+	struct auth_header header;
+	uint32_t crc;
+	if(fread(&header, sizeof(struct auth_header), 1, fp) != 1 || fread(&crc, sizeof(uint32_t), 1, fp) != 1
+		|| esp_crc32_le(0, (uint8_t *)&header, sizeof(struct auth_header)) != crc){
+
+		ESP_LOGE(TAG, "Unable to read valid header to rebuild filter");
+		ocpp_auth_filter_clear(filter, false);
+		goto cleanup;
+	}
+
+	if(fill_auth_filter(filter, fp, header.token_count,
+				is_list ? CONFIG_OCPP_LOCAL_AUTH_LIST_MAX_LENGTH : CONFIG_OCPP_AUTH_CACHE_MAX_LENGTH) == ESP_OK){
+		ocpp_auth_filter_save(filter, filter_path, crc);
+	}
+
+cleanup:
+	fclose(fp);
+}
+
+/*
+ * Removes the saved filter before tokens are written to the authorization file. The filter is saved again after the
+ * write, so a reset in between leaves no filter on file and it is rebuilt by prepare_auth_file instead of loading a
+ * filter that is missing the new tokens. Expects file_lock to be held.
+ */
+static esp_err_t invalidate_saved_auth_filter(bool is_list){
+	const char * filter_path = is_list ? auth_list_filter_path : auth_cache_filter_path;
+
+	if(remove(filter_path) != 0 && errno != ENOENT){
+		ESP_LOGE(TAG, "Unable to remove '%s' before update: %s", filter_path, strerror(errno));
+		return ESP_FAIL;
+	}
+
+	return ESP_OK;
+}
+
+/*
+ * Updates the filter after tokens have been removed from the authorization file. Expects file_lock to be held.
+ */
+static void update_auth_filter(bool is_list, size_t removed_count, uint32_t header_crc){
+	struct ocpp_auth_filter * filter = is_list ? &list_filter : &cache_filter;
+
+	ocpp_auth_filter_on_removed(filter, removed_count);
+
+	if(ocpp_auth_filter_should_rebuild(filter)){
+		rebuild_auth_filter(is_list);
+	}else if(filter->valid){
+		ocpp_auth_filter_save(filter, is_list ? auth_list_filter_path : auth_cache_filter_path, header_crc);
+	}
+}
+
 struct auth_cb_data{
 	char id_token[21];
 	authorize_cb on_accept;
@@ -146,8 +280,8 @@ esp_err_t read_auth_data(struct ocpp_authorization_data * authorization_data, bo
 		return ESP_ERR_INVALID_ARG;
 	}
 
-	if(!filesystem_is_ready()){
-		ESP_LOGE(TAG, "File system is not ready for auth read");
+	if(file_lock == NULL){
+		ESP_LOGE(TAG, "File lock was not initialized for auth read");
 		return ESP_ERR_INVALID_STATE;
 	}
 
@@ -161,6 +295,23 @@ esp_err_t read_auth_data(struct ocpp_authorization_data * authorization_data, bo
 	esp_err_t err = ESP_FAIL;
 	FILE * fp = NULL;
 
+	struct ocpp_auth_filter * filter = is_list ? &list_filter : &cache_filter;
+	bool filter_hit = false;
+
+	// Tokens that are known to be absent skip the file system
+	if(!ocpp_auth_filter_may_contain(filter, authorization_data->id_tag)){
+		ESP_LOGI(TAG, "Token is not in '%s' according to filter", file_path);
+		err = ESP_ERR_NOT_FOUND;
+		goto cleanup;
+	}
+	filter_hit = filter->valid;
+
+	if(!filesystem_is_ready()){
+		ESP_LOGE(TAG, "File system is not ready for auth read");
+		err = ESP_ERR_INVALID_STATE;
+		goto cleanup;
+	}
+
 	struct stat st;
 	if(stat(file_path, &st) != 0){
 		ESP_LOGW(TAG, "No authorization data at '%s'", file_path);
@@ -197,23 +348,49 @@ esp_err_t read_auth_data(struct ocpp_authorization_data * authorization_data, bo
 	bool found = false;
 	size_t read_count = 0;
 
-	for(;read_count < header.token_count; entry_nr++){
+	struct ocpp_auth_index index;
+	if(ocpp_auth_index_open(&index, fp, OFFSET_TOKEN_LIST, is_list ? OFFSET_INDEX_AUTH_LIST : OFFSET_INDEX_AUTH_CACHE,
+					is_list ? CONFIG_OCPP_LOCAL_AUTH_LIST_MAX_LENGTH : CONFIG_OCPP_AUTH_CACHE_MAX_LENGTH, crc) == ESP_OK){
 
-		if(fread(&id_tag, sizeof(ocpp_id_token), 1, fp) != 1){
-			ESP_LOGE(TAG, "Unable to read id token during auth read: %s", strerror(errno));
+		err = ocpp_auth_index_find(&index, authorization_data->id_tag, &entry_nr);
+		if(err == ESP_OK){
+			ESP_LOGI(TAG, "Found requested token in index for auth read");
+			strcpy(id_tag, authorization_data->id_tag);
+			found = true;
+
+		}else if(err != ESP_ERR_NOT_FOUND){
+			ESP_LOGE(TAG, "Unable to read index during auth read");
 			goto cleanup;
 		}
 
-		if(id_tag[0] == '\0'){
-			continue;
+		err = ESP_FAIL;
 
-		}else{
-			read_count++;
+	}else{
+		ESP_LOGW(TAG, "Index is not valid for '%s', scanning token list", file_path);
 
-			if(strcmp(id_tag, authorization_data->id_tag) == 0){
-				ESP_LOGI(TAG, "Found requested token for auth read");
-				found = true;
-				break;
+		if(fseek(fp, OFFSET_TOKEN_LIST, SEEK_SET) != 0){
+			ESP_LOGE(TAG, "Unable to seek to token list during auth read: %s", strerror(errno));
+			goto cleanup;
+		}
+
+		for(;read_count < header.token_count; entry_nr++){
+
+			if(fread(&id_tag, sizeof(ocpp_id_token), 1, fp) != 1){
+				ESP_LOGE(TAG, "Unable to read id token during auth read: %s", strerror(errno));
+				goto cleanup;
+			}
+
+			if(id_tag[0] == '\0'){
+				continue;
+
+			}else{
+				read_count++;
+
+				if(strcmp(id_tag, authorization_data->id_tag) == 0){
+					ESP_LOGI(TAG, "Found requested token for auth read");
+					found = true;
+					break;
+				}
 			}
 		}
 	}
@@ -221,6 +398,10 @@ esp_err_t read_auth_data(struct ocpp_authorization_data * authorization_data, bo
 	if(!found){
 		ESP_LOGW(TAG, "No id token on file matches requested token");
 		err = ESP_ERR_NOT_FOUND;
+
+		if(filter_hit)
+			filter->false_positives++;
+
 		goto cleanup;
 	}
 
@@ -674,11 +855,12 @@ enum ocpp_update_status_id update_auth_full(int version, struct ocpp_authorizati
 			}
 		}
 
+		rebuild_auth_filter(true);
 		xSemaphoreGive(file_lock);
 		return result;
 	}
 
-	FILE * fp = fopen(auth_list_tmp_path, "wb");
+	FILE * fp = fopen(auth_list_tmp_path, "w+b");
 	if(fp == NULL){
 		ESP_LOGE(TAG, "Unable to create temporary path for full list update");
 		goto error;
@@ -726,6 +908,31 @@ enum ocpp_update_status_id update_auth_full(int version, struct ocpp_authorizati
 			goto error;
 	}
 
+	struct ocpp_auth_index index;
+	if(ocpp_auth_index_begin(&index, fp, OFFSET_TOKEN_LIST, OFFSET_INDEX_AUTH_LIST, CONFIG_OCPP_LOCAL_AUTH_LIST_MAX_LENGTH, crc, 0, true) != ESP_OK){
+		ESP_LOGE(TAG, "Unable to create index during full update");
+		goto error;
+	}
+
+	for(size_t i = 0; i < list_length; i++){
+		if(ocpp_auth_index_insert(&index, auth_data[i].id_tag, i) != ESP_OK){
+			ESP_LOGE(TAG, "Unable to index id_tag nr %zu during full update", i);
+			ocpp_auth_index_close(&index);
+			goto error;
+		}
+	}
+
+	esp_err_t err = ocpp_auth_index_commit(&index, crc);
+	ocpp_auth_index_close(&index);
+
+	if(err != ESP_OK){
+		ESP_LOGE(TAG, "Unable to write index during full update");
+		goto error;
+	}
+
+	if(invalidate_saved_auth_filter(true) != ESP_OK)
+		goto error;
+
 	struct stat st;
 	if(stat(auth_list_path, &st) == 0)
 		remove(auth_list_path);
@@ -735,9 +942,18 @@ enum ocpp_update_status_id update_auth_full(int version, struct ocpp_authorizati
 
 	if(rename(auth_list_tmp_path, auth_list_path) != 0){
 		ESP_LOGE(TAG, "Unable to rename temporary file during full update: %s", strerror(errno));
+		rebuild_auth_filter(true);
 		goto error;
 	}
 
+	if(list_filter.bits != NULL){
+		ocpp_auth_filter_clear(&list_filter, true);
+		for(size_t i = 0; i < list_length; i++)
+			ocpp_auth_filter_add(&list_filter, auth_data[i].id_tag);
+
+		ocpp_auth_filter_save(&list_filter, auth_list_filter_path, crc);
+	}
+
 	xSemaphoreGive(file_lock);
 
 	return eOCPP_UPDATE_STATUS_ACCEPTED;
@@ -771,9 +987,16 @@ enum ocpp_update_status_id update_auth_differential(int version, struct ocpp_aut
 	const size_t max_entries = is_list ? CONFIG_OCPP_LOCAL_AUTH_LIST_MAX_LENGTH : CONFIG_OCPP_AUTH_CACHE_MAX_LENGTH;
 
 	long * output_entry = NULL; // Array where at a given index will contain the auth file entry index for the same auth_data index
-	FILE * fp;
+	FILE * fp = NULL;
+
+	struct ocpp_auth_index index = {0};
+	bool create = false;
+
+	size_t missing_count = 0; // Tokens to add that are not on file
+	size_t deleted_count = 0; // Tokens to delete that are on file
 
 	struct auth_header header;
+	uint32_t crc = 0;
 	struct stat st;
 	if(stat(auth_path, &st) != 0){
 		ESP_LOGW(TAG, "Differential update requested for empty auth at '%s', creating new auth file", auth_path);
@@ -787,11 +1010,7 @@ enum ocpp_update_status_id update_auth_differential(int version, struct ocpp_aut
 		header.file_version = 1;
 		header.list_version = is_list ? 0 : INT_MAX;
 		header.token_count = 0;
-
-		if(fseek(fp, OFFSET_TOKEN_LIST, SEEK_SET) != 0){
-			ESP_LOGE(TAG, "Unable to seek to token list during differential update: %s", strerror(errno));
-			goto cleanup;
-		}
+		create = true;
 
 	}else{
 		fp = fopen(auth_path, "r+b");
@@ -805,7 +1024,6 @@ enum ocpp_update_status_id update_auth_differential(int version, struct ocpp_aut
 			goto cleanup;
 		}
 
-		uint32_t crc;
 		if(fread(&crc, sizeof(uint32_t), 1, fp) != 1){
 			ESP_LOGE(TAG, "Unable to read header crc during differential update: %s", strerror(errno));
 			goto cleanup;
@@ -826,6 +1044,12 @@ enum ocpp_update_status_id update_auth_differential(int version, struct ocpp_aut
 		goto cleanup;
 	}
 
+	const long index_offset = is_list ? OFFSET_INDEX_AUTH_LIST : OFFSET_INDEX_AUTH_CACHE;
+	if(ocpp_auth_index_begin(&index, fp, OFFSET_TOKEN_LIST, index_offset, max_entries, crc, header.token_count, create) != ESP_OK){
+		ESP_LOGE(TAG, "Unable to prepare index during differential update");
+		goto cleanup;
+	}
+
 	header.list_version = version;
 
 	output_entry = malloc(sizeof(long) * list_length);
@@ -834,94 +1058,89 @@ enum ocpp_update_status_id update_auth_differential(int version, struct ocpp_aut
 		goto cleanup;
 	}
 
+	// Find all entries that have an existing entry on file
 	for(size_t i = 0; i < list_length; i++){
-		output_entry[i] = -1; // Set to invalid offset to indicate 'not set'
-	}
-	size_t match_count = 0;
+		size_t entry;
+		esp_err_t err = ocpp_auth_index_find(&index, auth_data[i].id_tag, &entry);
 
-	size_t * known_vacant_entries = malloc(sizeof(size_t) * list_length);
-	size_t known_vacant_count = 0;
+		if(err == ESP_OK){
+			ESP_LOGI(TAG, "Differential update entry is on file: %s", auth_data[i].id_tag);
+			output_entry[i] = entry;
 
-	ocpp_id_token id_tag;
-
-	size_t local_entry_nr = 0;
-	size_t read_count = 0;
+			if(auth_data[i].id_tag_info == NULL)
+				deleted_count++;
 
-	// Find all entries that have an existing entry on file and vacant entries
-	for(;read_count < header.token_count && match_count < list_length; local_entry_nr++){
+		}else if(err == ESP_ERR_NOT_FOUND){
+			if(auth_data[i].id_tag_info == NULL){ // if requested to delete an entry that does not exist
+				output_entry[i] = -2; // indicate 'should not do anything'
+			}else{
+				output_entry[i] = -1; // Set to invalid offset to indicate 'not set'
+				missing_count++;
+			}
 
-		if(fread(&id_tag, sizeof(ocpp_id_token), 1, fp) != 1){
-			ESP_LOGE(TAG, "Unable to read id tag at %zu during differential update: %s", local_entry_nr, strerror(errno));
-			free(known_vacant_entries);
+		}else{
+			ESP_LOGE(TAG, "Unable to look up id tag nr %zu during differential update", i);
 			goto cleanup;
 		}
+	}
 
-		if(id_tag[0] == '\0'){
-			if(known_vacant_count < list_length){
-				known_vacant_entries[known_vacant_count++] = local_entry_nr;
-			}
+	// Entries deleted by this update are reused for new tokens, the remaining new tokens need vacant entries
+	if(missing_count > deleted_count && header.token_count + (missing_count - deleted_count) > max_entries){
+		ESP_LOGE(TAG, "Unable to find vacant entries for all tags during differential update");
+		*length_out = header.token_count + (missing_count - deleted_count);
+
+		// Nothing has been changed, so the index is still valid for the current header
+		ocpp_auth_index_commit(&index, crc);
+		goto cleanup;
+	}
+
+	size_t j = 0;
+	for(size_t i = 0; i < list_length; i++){
+		if(output_entry[i] != -1)
 			continue;
-		}else{
-			read_count++;
-			for(size_t i = 0; i < list_length; i++){
-				if(strcmp(id_tag, auth_data[i].id_tag) == 0){
-					ESP_LOGI(TAG, "Differential update entry is on file: %s", id_tag);
-					output_entry[i] = local_entry_nr;
-					match_count++;
-					break;
-				}
-			}
+
+		// If an other entry will be deleted, use that entry istead of new entry
+		for(; j < list_length; j++){
+			if(output_entry[j] >= 0 && auth_data[j].id_tag_info == NULL)
+				break;
 		}
-	}
 
-	if(match_count < list_length){ // If a tag is not on file, then it needs to be allocated an entry on file
+		size_t entry;
+		if(j < list_length){
+			entry = output_entry[j];
+			output_entry[j] = -2;
 
-		size_t known_vacant_index = 0;
-		size_t i = 0;
-		for(size_t missing_entry_count = list_length - match_count; missing_entry_count > 0; missing_entry_count--){
-			for(; i < list_length; i++){
-				if(output_entry[i] == -1)
-					break;
+			if(ocpp_auth_index_remove(&index, auth_data[j].id_tag, entry) != ESP_OK){
+				ESP_LOGE(TAG, "Unable to remove replaced token from index during differential update");
+				goto cleanup;
 			}
 
-			if(auth_data[i].id_tag_info == NULL){ // if requested to delete an entry that does not exist
+		}else{ // Else we use a vacant entry
+			if(ocpp_auth_index_allocate_entry(&index, &entry) != ESP_OK){
+				ESP_LOGE(TAG, "Index has no vacant entry during differential update");
+				goto cleanup;
+			}
 
-				output_entry[i] = -2; // indicate 'should not do anything'
-				match_count++; // We matched NULL tag with no entry on file
-			}else{
-				bool found = false;
-				for(size_t j = 0; j < list_length; j++){ // If an other entry will be deleted, use that entry istead of new entry
-					if(output_entry[j] > 0 && auth_data[j].id_tag_info == NULL){
-						output_entry[i] = output_entry[j];
-						output_entry[j] = -2;
-
-						match_count++; // We matched new entry with recently vacant entry
-						found = true;
-						break;
-					}
-				}
+			header.token_count++;
+		}
 
-				// If an entry on file has been deleted by previous update request, use that entry to prevent large gaps on file
-				if(!found && known_vacant_index < known_vacant_count){
-					output_entry[i] = known_vacant_entries[known_vacant_index++];
-					match_count++;
-					header.token_count++;
-
-				}else if(local_entry_nr < max_entries){ // Else we use a new enty at the end of the list
-					output_entry[i] = local_entry_nr;
-					local_entry_nr++;
-					match_count++;
-					header.token_count++;
-				}
-			}
+		if(ocpp_auth_index_insert(&index, auth_data[i].id_tag, entry) != ESP_OK){
+			ESP_LOGE(TAG, "Unable to add token to index during differential update");
+			goto cleanup;
 		}
+
+		output_entry[i] = entry;
 	}
-	free(known_vacant_entries);
 
-	if(match_count < list_length){
-		ESP_LOGE(TAG, "Unable to find vacant entries for all tags during differential update");
-		*length_out = header.token_count + match_count + list_length;
+	if(invalidate_saved_auth_filter(is_list) != ESP_OK)
 		goto cleanup;
+
+	// Tokens are added to the filter before written so that the filter contains all tokens on file even on failure
+	struct ocpp_auth_filter * filter = is_list ? &list_filter : &cache_filter;
+
+	for(size_t i = 0; i < list_length; i++){
+		if(auth_data[i].id_tag_info != NULL)
+			ocpp_auth_filter_add(filter, auth_data[i].id_tag);
 	}
 
 	ocpp_id_token delete_token = {0};
@@ -939,7 +1158,14 @@ enum ocpp_update_status_id update_auth_differential(int version, struct ocpp_aut
 			if(fwrite(delete_token, sizeof(ocpp_id_token), 1, fp) != 1){
 				ESP_LOGE(TAG, "Unable to delete token during differential update");
 			}
-			header.token_count--;
+
+			if(ocpp_auth_index_entry_is_occupied(&index, output_entry[i])){
+				if(ocpp_auth_index_remove(&index, auth_data[i].id_tag, output_entry[i]) != ESP_OK){
+					ESP_LOGE(TAG, "Unable to remove deleted token from index during differential update");
+					goto cleanup;
+				}
+				header.token_count--;
+			}
 		}else{
 			if(fwrite(&auth_data[i].id_tag, sizeof(ocpp_id_token), 1, fp) != 1){
 				ESP_LOGE(TAG, "Unable to write id_tag nr %zu to file during differential update", i);
@@ -967,6 +1193,13 @@ enum ocpp_update_status_id update_auth_differential(int version, struct ocpp_aut
 
 	*length_out = header.token_count;
 
+	crc = esp_crc32_le(0, (uint8_t *)&header, sizeof(struct auth_header));
+
+	if(ocpp_auth_index_commit(&index, crc) != ESP_OK){
+		ESP_LOGE(TAG, "Unable to write index during differential update");
+		goto cleanup;
+	}
+
 	if(fseek(fp, OFFSET_HEADER, SEEK_SET) != 0){
 		ESP_LOGE(TAG, "Unable to seek back to replacing header during differential update");
 		goto cleanup;
@@ -977,7 +1210,6 @@ enum ocpp_update_status_id update_auth_differential(int version, struct ocpp_aut
 		goto cleanup;
 	}
 
-	uint32_t crc = esp_crc32_le(0, (uint8_t *)&header, sizeof(struct auth_header));
 	if(fwrite(&crc, sizeof(uint32_t), 1, fp) != 1){
 		ESP_LOGE(TAG, "Unable to write header crc during differential update");
 		goto cleanup;
@@ -987,6 +1219,7 @@ enum ocpp_update_status_id update_auth_differential(int version, struct ocpp_aut
 
 cleanup:
 	free(output_entry);
+	ocpp_auth_index_close(&index);
 
 	if(fp != NULL){
 		if(ferror(fp)){
@@ -994,6 +1227,10 @@ cleanup:
 		}
 		fclose(fp);
 	}
+
+	if(ret == eOCPP_UPDATE_STATUS_ACCEPTED)
+		update_auth_filter(is_list, deleted_count, crc);
+
 	xSemaphoreGive(file_lock);
 
 	return ret;
@@ -1053,11 +1290,20 @@ size_t auth_cache_remove(int requested_remove_count){
 	struct stat st;
 	if(stat(auth_cache_path, &st) != 0){
 		ESP_LOGW(TAG, "No authorization cache");
-		xSemaphoreGive(ret);
+		xSemaphoreGive(file_lock);
 
 		return 0;
 	}
 
+	struct ocpp_auth_index index = {0};
+	uint32_t crc = 0;
+	size_t * remove_index = NULL;
+	size_t remove_count = 0;
+	struct timestamped_entry{
+		size_t entry;
+		time_t timestamp;
+	} * oldest_entries = NULL;
+
 	FILE * fp = fopen(auth_cache_path, "r+b");
 	if(fp == NULL){
 		ESP_LOGE(TAG, "Authorization cache exists but could not be opened for removing tokens: %s", strerror(errno));
@@ -1070,7 +1316,6 @@ size_t auth_cache_remove(int requested_remove_count){
 		goto cleanup;
 	}
 
-	uint32_t crc;
 	if(fread(&crc, sizeof(uint32_t), 1, fp) != 1){
 		ESP_LOGE(TAG, "Unable to read header crc during removal of tokens from auth cache: %s", strerror(errno));
 		goto cleanup;
@@ -1081,147 +1326,138 @@ size_t auth_cache_remove(int requested_remove_count){
 		goto cleanup;
 	}
 
-	if(fseek(fp, OFFSET_TAG_LIST_AUTH_CACHE, SEEK_SET) != 0){
-		ESP_LOGE(TAG, "Unable to seek to tag list during removal of tokens from auth cache: %s", strerror(errno));
+	if(ocpp_auth_index_begin(&index, fp, OFFSET_TOKEN_LIST, OFFSET_INDEX_AUTH_CACHE, CONFIG_OCPP_AUTH_CACHE_MAX_LENGTH,
+					crc, header.token_count, false) != ESP_OK){
+		ESP_LOGE(TAG, "Unable to prepare index during removal of tokens from auth cache");
 		goto cleanup;
 	}
 
-	size_t * remove_index = malloc(sizeof(size_t) * header.token_count);
-	size_t remove_count = 0;
-
+	remove_index = malloc(sizeof(size_t) * (header.token_count + requested_remove_count));
 	if(remove_index == NULL){
 		ESP_LOGE(TAG, "Unable to allocate memory for removed indexes");
 		goto cleanup;
 	}
 
-	struct auth_tag_entry entry;
-	size_t read_count = 0;
-
-	time_t now = time(NULL);
-
-	struct auth_tag_entry null_entry = {0};
-	for(size_t local_entry_nr = 0; read_count < header.token_count; local_entry_nr++){
-		if(fread(&entry, sizeof(struct auth_tag_entry), 1, fp) != 1){
-			ESP_LOGE(TAG, "Unable to read id tag at %ul during differential update: %s", local_entry_nr, strerror(errno));
-			free(remove_index);
+	// Tracks the oldest valid entries in ascending order in case invalid entries are not enough
+	size_t oldest_count = 0;
+	if(requested_remove_count > 0){
+		oldest_entries = malloc(sizeof(struct timestamped_entry) * requested_remove_count);
+		if(oldest_entries == NULL){
+			ESP_LOGE(TAG, "Unable to allocate buffer to track oldes entries");
 			goto cleanup;
 		}
-
-		if(memcmp(&entry, &null_entry, sizeof(struct auth_tag_entry)) == 0)
-			continue;
-
-		read_count++;
-
-		if(entry.id_tag_info.expiry_date < now
-			|| entry.id_tag_info.status != (uint8_t)eOCPP_AUTHORIZATION_STATUS_ACCEPTED
-			){
-			ESP_LOGI(TAG, "Marking index for deletion due to invalidity %ul", local_entry_nr);
-			remove_index[remove_count++] = local_entry_nr;
-		}
 	}
 
-	struct timestamped_entry{
-		size_t entry;
-		time_t timestamp;
-	};
+	if(fseek(fp, OFFSET_TAG_LIST_AUTH_CACHE, SEEK_SET) != 0){
+		ESP_LOGE(TAG, "Unable to seek to tag list during removal of tokens from auth cache: %s", strerror(errno));
+		goto cleanup;
+	}
 
-	if(remove_count < requested_remove_count){
-		size_t remaining = requested_remove_count - remove_count;
+	struct auth_tag_entry entries[8];
+	size_t read_count = 0;
 
-		struct timestamped_entry * oldest_entries = malloc(sizeof(struct timestamped_entry) * remaining);
-		if(oldest_entries == NULL){
-			ESP_LOGE(TAG, "Unable to allocate buffer to track oldes entries");
-			free(remove_index);
-			goto cleanup;
-		}
+	time_t now = time(NULL);
 
-		for(size_t i = 0; i < remaining; i++){
-			oldest_entries[i].timestamp = LONG_MAX;
-		}
+	for(size_t chunk_start = 0; read_count < header.token_count && chunk_start < CONFIG_OCPP_AUTH_CACHE_MAX_LENGTH; chunk_start += 8){
+		size_t chunk_length = CONFIG_OCPP_AUTH_CACHE_MAX_LENGTH - chunk_start;
+		if(chunk_length > 8)
+			chunk_length = 8;
 
-		if(fseek(fp, OFFSET_TAG_LIST_AUTH_CACHE, SEEK_SET) != 0){
-			ESP_LOGE(TAG, "Unable to seek back to tag list to check timestamp during removal of tokens from auth cache: %s", strerror(errno));
+		if(fread(entries, sizeof(struct auth_tag_entry), chunk_length, fp) != chunk_length){
+			ESP_LOGE(TAG, "Unable to read tag info at %zu during removal of tokens from auth cache: %s", chunk_start, strerror(errno));
 			goto cleanup;
 		}
-		read_count = 0;
 
-		size_t skip_check_index = 0;
-		for(size_t local_entry_nr = 0; read_count < header.token_count; local_entry_nr++){
+		for(size_t i = 0; i < chunk_length && read_count < header.token_count; i++){
+			size_t local_entry_nr = chunk_start + i;
 
-			if(fread(&entry, sizeof(struct auth_tag_entry), 1, fp) != 1){
-				ESP_LOGE(TAG, "Unable to read id tag at %ul during differential update: %s", local_entry_nr, strerror(errno));
-				free(remove_index);
-				goto cleanup;
-			}
-
-			if(skip_check_index < remove_count && remove_index[skip_check_index] == local_entry_nr){
-				skip_check_index++;
-				continue;
-			}
-
-			if(memcmp(&entry, &null_entry, sizeof(struct auth_tag_entry)) == 0)
+			if(!ocpp_auth_index_entry_is_occupied(&index, local_entry_nr))
 				continue;
 
 			read_count++;
 
-			time_t new_time = entry.written_timestamp;
-			size_t new_entry = local_entry_nr;
+			if(entries[i].id_tag_info.expiry_date < now
+				|| entries[i].id_tag_info.status != (uint8_t)eOCPP_AUTHORIZATION_STATUS_ACCEPTED
+				){
+				ESP_LOGI(TAG, "Marking index for deletion due to invalidity %zu", local_entry_nr);
+				remove_index[remove_count++] = local_entry_nr;
+				continue;
+			}
 
-			for(size_t i = 0; i < remaining; i++){
-				if(new_time < oldest_entries[i].timestamp){
+			// Insert into the sorted list of oldest entries
+			size_t position = oldest_count;
+			while(position > 0 && oldest_entries[position -1].timestamp > entries[i].written_timestamp)
+				position--;
 
-					time_t tmp_time = oldest_entries[i].timestamp;
-					size_t tmp_entry = oldest_entries[i].entry;
+			if(position < (size_t)requested_remove_count){
+				if(oldest_count < (size_t)requested_remove_count)
+					oldest_count++;
 
-					oldest_entries[i].timestamp = new_time;
-					oldest_entries[i].entry = new_entry;
+				memmove(&oldest_entries[position + 1], &oldest_entries[position],
+					sizeof(struct timestamped_entry) * (oldest_count - position - 1));
 
-					new_time = tmp_time;
-					new_entry = tmp_entry;
-				}
+				oldest_entries[position].entry = local_entry_nr;
+				oldest_entries[position].timestamp = entries[i].written_timestamp;
 			}
 		}
+	}
 
-		for(size_t i = 0; i < remaining; i++){
-			ESP_LOGI(TAG, "Marking oldest for deletion: %ul", oldest_entries[i].entry);
-			remove_index[remove_count++] = oldest_entries[i].entry;
-		}
+	for(size_t i = 0; i < oldest_count && remove_count < (size_t)requested_remove_count; i++){
+		ESP_LOGI(TAG, "Marking oldest for deletion: %zu", oldest_entries[i].entry);
+		remove_index[remove_count++] = oldest_entries[i].entry;
 	}
 
 	ocpp_id_token delete_token = {0};
+	struct auth_tag_entry null_entry = {0};
+
 	for(size_t i = 0; i < remove_count; i++){
+		ocpp_id_token id_tag;
+
 		if(fseek(fp, OFFSET_TOKEN_LIST + sizeof(ocpp_id_token) * remove_index[i], SEEK_SET) != 0){
 			ESP_LOGE(TAG, "Unable to seek to token for deletion during removal of tokens from auth cache: %s", strerror(errno));
-			free(remove_index);
 			goto cleanup;
 		}
 
+		if(fread(&id_tag, sizeof(ocpp_id_token), 1, fp) != 1){
+			ESP_LOGE(TAG, "Unable to read token at %zu during removal of tokens from auth cache: %s", remove_index[i], strerror(errno));
+			goto cleanup;
+		}
+		id_tag[sizeof(ocpp_id_token) -1] = '\0';
 
-		if(fwrite(&delete_token, sizeof(ocpp_id_token), 1, fp) != 1){
-			ESP_LOGE(TAG, "Unable to delete token at %d during removal of tokens from auth cache: %s", remove_index[i], strerror(errno));
-			free(remove_index);
+		if(ocpp_auth_index_remove(&index, id_tag, remove_index[i]) != ESP_OK){
+			ESP_LOGE(TAG, "Unable to remove token at %zu from index during removal of tokens from auth cache", remove_index[i]);
 			goto cleanup;
 		}
 
-		header.token_count--;
-	}
+		if(fseek(fp, OFFSET_TOKEN_LIST + sizeof(ocpp_id_token) * remove_index[i], SEEK_SET) != 0){
+			ESP_LOGE(TAG, "Unable to seek to token for deletion during removal of tokens from auth cache: %s", strerror(errno));
+			goto cleanup;
+		}
+
+		if(fwrite(&delete_token, sizeof(ocpp_id_token), 1, fp) != 1){
+			ESP_LOGE(TAG, "Unable to delete token at %zu during removal of tokens from auth cache: %s", remove_index[i], strerror(errno));
+			goto cleanup;
+		}
 
-	for(size_t i = 0; i < remove_count; i++){
 		if(fseek(fp, OFFSET_TAG_LIST_AUTH_CACHE + sizeof(struct auth_tag_entry) * remove_index[i], SEEK_SET) != 0){
 			ESP_LOGE(TAG, "Unable to seek to tag info for deletion during removal of tokens from auth cache: %s", strerror(errno));
-			free(remove_index);
 			goto cleanup;
 		}
 
-
 		if(fwrite(&null_entry, sizeof(struct auth_tag_entry), 1, fp) != 1){
-			ESP_LOGE(TAG, "Unable to delete tag info at %d during removal of tokens from auth cache: %s", remove_index[i], strerror(errno));
-			free(remove_index);
+			ESP_LOGE(TAG, "Unable to delete tag info at %zu during removal of tokens from auth cache: %s", remove_index[i], strerror(errno));
 			goto cleanup;
 		}
+
+		header.token_count--;
 	}
 
-	free(remove_index);
+	crc = esp_crc32_le(0, (uint8_t *)&header, sizeof(struct auth_header));
+
+	if(ocpp_auth_index_commit(&index, crc) != ESP_OK){
+		ESP_LOGE(TAG, "Unable to write index during removal of tokens from auth cache");
+		goto cleanup;
+	}
 
 	if(fseek(fp, OFFSET_HEADER, SEEK_SET) != 0){
 		ESP_LOGE(TAG, "Unable to seek back to header to update with new count during removal of tokens from auth cache: %s", strerror(errno));
@@ -1233,7 +1469,6 @@ size_t auth_cache_remove(int requested_remove_count){
 		goto cleanup;
 	}
 
-	crc = esp_crc32_le(0, (uint8_t *)&header, sizeof(struct auth_header));
 	if(fwrite(&crc, sizeof(uint32_t), 1, fp) != 1){
 		ESP_LOGE(TAG, "Unable to write header crc during removal of tokens from auth cache: %s", strerror(errno));
 		goto cleanup;
@@ -1242,8 +1477,17 @@ size_t auth_cache_remove(int requested_remove_count){
 	ret = header.token_count;
 
 cleanup:
+	free(oldest_entries);
+	free(remove_index);
+	ocpp_auth_index_close(&index);
+
+	if(fp != NULL)
+		fclose(fp);
+
+	if(ret != (size_t)-1)
+		update_auth_filter(false, remove_count, crc);
+
 	xSemaphoreGive(file_lock);
-	fclose(fp);
 
 	return ret;
 }
@@ -1318,13 +1562,24 @@ int ocpp_auth_clear_cache(){
 		return -1;
 	}
 
+	if(xSemaphoreTake(file_lock, pdMS_TO_TICKS(2000)) != pdTRUE){
+		ESP_LOGE(TAG, "Failed to aquire lock to clear auth cache");
+		return -1;
+	}
+
+	int ret = 0;
+
 	struct stat st;
 	if(stat(auth_cache_path, &st) != 0){
 		ESP_LOGW(TAG, "No cache found when clearing cache");
-		return 0;
+	}else{
+		ret = remove(auth_cache_path);
 	}
 
-	return remove(auth_cache_path);
+	rebuild_auth_filter(false);
+
+	xSemaphoreGive(file_lock);
+	return ret;
 }
 
 // NOTE: this will return -1 on error which ocpp will interpret as "not supported"
@@ -1398,9 +1653,87 @@ cJSON * ocpp_auth_get_diagnostics(){
 	cJSON_AddBoolToObject(res, "cache_exists", stat(auth_list_path, &st) != 0);
 	cJSON_AddBoolToObject(res, "list_exists", stat(auth_cache_path, &st) != 0);
 
+	const char * filter_names[] = {"list_filter", "cache_filter"};
+	struct ocpp_auth_filter * filters[] = {&list_filter, &cache_filter};
+
+	for(size_t i = 0; i < 2; i++){
+		cJSON * filter_json = cJSON_CreateObject();
+		if(filter_json == NULL){
+			ESP_LOGE(TAG, "Unable to create ocpp diagnostics for auth filter");
+			break;
+		}
+
+		cJSON_AddBoolToObject(filter_json, "valid", filters[i]->valid);
+		cJSON_AddNumberToObject(filter_json, "bits", filters[i]->bit_count);
+		cJSON_AddNumberToObject(filter_json, "hits", filters[i]->hits);
+		cJSON_AddNumberToObject(filter_json, "misses", filters[i]->misses);
+		cJSON_AddNumberToObject(filter_json, "false_positives", filters[i]->false_positives);
+
+		cJSON_AddItemToObject(res, filter_names[i], filter_json);
+	}
+
 	return res;
 }
 
+/*
+ * Rebuilds the index of an auth file if it is missing or stale and loads or rebuilds its filter. Files written
+ * before the index was introduced will get an index the first time this is called.
+ */
+static void prepare_auth_file(bool is_list){
+	const char * file_path = is_list ? auth_list_path : auth_cache_path;
+	struct ocpp_auth_filter * filter = is_list ? &list_filter : &cache_filter;
+	const char * filter_path = is_list ? auth_list_filter_path : auth_cache_filter_path;
+
+	struct stat st;
+	if(stat(file_path, &st) != 0){
+		ocpp_auth_filter_clear(filter, true);
+		remove(filter_path);
+		return;
+	}
+
+	FILE * fp = fopen(file_path, "r+b");
+	if(fp == NULL){
+		ESP_LOGE(TAG, "Unable to open '%s' to check index: %s", file_path, strerror(errno));
+		return;
+	}
+
+	struct auth_header header;
+	uint32_t crc;
+	if(fread(&header, sizeof(struct auth_header), 1, fp) != 1 || fread(&crc, sizeof(uint32_t), 1, fp) != 1){
+		ESP_LOGE(TAG, "Unable to read header to check index: %s", strerror(errno));
+		goto cleanup;
+	}
+
+	if(esp_crc32_le(0, (uint8_t *)&header, sizeof(struct auth_header)) != crc){
+		ESP_LOGE(TAG, "CRC mismatch for header when checking index");
+		goto cleanup;
+	}
+
+	struct ocpp_auth_index index;
+	if(ocpp_auth_index_begin(&index, fp, OFFSET_TOKEN_LIST, is_list ? OFFSET_INDEX_AUTH_LIST : OFFSET_INDEX_AUTH_CACHE,
+					is_list ? CONFIG_OCPP_LOCAL_AUTH_LIST_MAX_LENGTH : CONFIG_OCPP_AUTH_CACHE_MAX_LENGTH,
+					crc, header.token_count, false) != ESP_OK){
+
+		ESP_LOGE(TAG, "Unable to prepare index for '%s'", file_path);
+		goto cleanup;
+	}
+
+	if(ocpp_auth_index_commit(&index, crc) != ESP_OK)
+		ESP_LOGE(TAG, "Unable to write index for '%s'", file_path);
+
+	ocpp_auth_index_close(&index);
+
+	if(filter->bits != NULL && ocpp_auth_filter_load(filter, filter_path, crc) != ESP_OK){
+		if(fill_auth_filter(filter, fp, header.token_count,
+					is_list ? CONFIG_OCPP_LOCAL_AUTH_LIST_MAX_LENGTH : CONFIG_OCPP_AUTH_CACHE_MAX_LENGTH) == ESP_OK){
+			ocpp_auth_filter_save(filter, filter_path, crc);
+		}
+	}
+
+cleanup:
+	fclose(fp);
+}
+
 int ocpp_auth_init(){
 	ESP_LOGI(TAG, "Initializing ocpp authorization");
 
@@ -1428,11 +1761,22 @@ int ocpp_auth_init(){
 		ESP_LOGI(TAG, "Directory path '%s' exists", DIRECTORY_PATH);
 	}
 
+	if(ocpp_auth_filter_init(&list_filter, CONFIG_OCPP_LOCAL_AUTH_LIST_MAX_LENGTH, CONFIG_OCPP_AUTH_FILTER_BITS_PER_ENTRY) != ESP_OK
+		|| ocpp_auth_filter_init(&cache_filter, CONFIG_OCPP_AUTH_CACHE_MAX_LENGTH, CONFIG_OCPP_AUTH_FILTER_BITS_PER_ENTRY) != ESP_OK){
+		ESP_LOGW(TAG, "Unable to create authorization filters. All lookups will use file");
+	}
+
+	prepare_auth_file(true);
+	prepare_auth_file(false);
+
 	xSemaphoreGive(file_lock);
 	return 0;
 }
 
 void ocpp_auth_deinit(){
+	ocpp_auth_filter_deinit(&list_filter);
+	ocpp_auth_filter_deinit(&cache_filter);
+
 	if(file_lock != NULL){
 		vSemaphoreDelete(file_lock);
 		file_lock = NULL;
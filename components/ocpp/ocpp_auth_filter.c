@@ -0,0 +1,225 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "esp_log.h"
+#include "esp_crc.h"
+
+#include "ocpp_auth_filter.h"
+#include "types/ocpp_id_token.h"
+
+static const char * TAG = "OCPP AUTH FLTR ";
+
+/* Filter file format:
+ * {<magic><bit_count><hash_count><auth_header_crc><inserted><removed>}<crc_filter_header><bits>
+ *
+ * All header fields are uint32_t. <bits> is bit_count / 8 bytes.
+ */
+
+#define FILTER_MAGIC 0x52544C46 // "FLTR"
+
+struct filter_header{
+	uint32_t magic;
+	uint32_t bit_count;
+	uint32_t hash_count;
+	uint32_t auth_header_crc;
+	uint32_t inserted;
+	uint32_t removed;
+};
+
+esp_err_t ocpp_auth_filter_init(struct ocpp_auth_filter * filter, size_t max_entries, size_t bits_per_entry){
+	memset(filter, 0, sizeof(struct ocpp_auth_filter));
+
+	if(bits_per_entry == 0 || max_entries == 0)
+		return ESP_OK;
+
+	filter->bit_count = ((max_entries * bits_per_entry + 31) / 32) * 32;
+
+	// Optimal number of hashes is bits per entry * ln(2)
+	filter->hash_count = (bits_per_entry * 693 + 500) / 1000;
+	if(filter->hash_count == 0)
+		filter->hash_count = 1;
+
+	filter->bits = calloc(1, filter->bit_count / 8);
+	if(filter->bits == NULL){
+		ESP_LOGE(TAG, "Unable to allocate filter of %zu bits", filter->bit_count);
+		filter->bit_count = 0;
+		return ESP_ERR_NO_MEM;
+	}
+
+	return ESP_OK;
+}
+
+void ocpp_auth_filter_deinit(struct ocpp_auth_filter * filter){
+	free(filter->bits);
+	memset(filter, 0, sizeof(struct ocpp_auth_filter));
+}
+
+void ocpp_auth_filter_clear(struct ocpp_auth_filter * filter, bool valid){
+	if(filter->bits == NULL)
+		return;
+
+	memset(filter->bits, 0, filter->bit_count / 8);
+	filter->valid = valid;
+	filter->inserted = 0;
+	filter->removed = 0;
+}
+
+/*
+ * Uses double hashing to get hash_count bit positions from two hashes of the token. The second hash is forced to be
+ * odd so that it does not repeat the same bit.
+ */
+static void token_hashes(const char * id_tag, uint32_t * hash_1, uint32_t * hash_2){
+	uint32_t fnv = 2166136261u;
+	uint32_t djb = 5381;
+
+	for(size_t i = 0; i < sizeof(ocpp_id_token) && id_tag[i] != '\0'; i++){
+		fnv = (fnv ^ (uint8_t)id_tag[i]) * 16777619u;
+		djb = djb * 33 + (uint8_t)id_tag[i];
+	}
+
+	*hash_1 = fnv;
+	*hash_2 = (djb ^ (djb >> 15)) | 1;
+}
+
+void ocpp_auth_filter_add(struct ocpp_auth_filter * filter, const char * id_tag){
+	if(filter->bits == NULL)
+		return;
+
+	uint32_t hash_1, hash_2;
+	token_hashes(id_tag, &hash_1, &hash_2);
+
+	for(size_t i = 0; i < filter->hash_count; i++){
+		size_t bit = (hash_1 + i * hash_2) % filter->bit_count;
+		filter->bits[bit / 8] |= 1 << (bit % 8);
+	}
+
+	filter->inserted++;
+}
+
+void ocpp_auth_filter_on_removed(struct ocpp_auth_filter * filter, size_t count){
+	filter->removed += count;
+}
+
+bool ocpp_auth_filter_should_rebuild(struct ocpp_auth_filter * filter){
+	return filter->bits != NULL && (!filter->valid || filter->removed > filter->inserted / 4);
+}
+
+bool ocpp_auth_filter_may_contain(struct ocpp_auth_filter * filter, const char * id_tag){
+	if(filter->bits == NULL || !filter->valid)
+		return true;
+
+	uint32_t hash_1, hash_2;
+	token_hashes(id_tag, &hash_1, &hash_2);
+
+	for(size_t i = 0; i < filter->hash_count; i++){
+		size_t bit = (hash_1 + i * hash_2) % filter->bit_count;
+		if((filter->bits[bit / 8] & (1 << (bit % 8))) == 0){
+			filter->misses++;
+			return false;
+		}
+	}
+
+	filter->hits++;
+	return true;
+}
+
+esp_err_t ocpp_auth_filter_save(struct ocpp_auth_filter * filter, const char * path, uint32_t header_crc){
+	if(filter->bits == NULL || !filter->valid)
+		return ESP_ERR_INVALID_STATE;
+
+	FILE * fp = fopen(path, "wb");
+	if(fp == NULL){
+		ESP_LOGE(TAG, "Unable to open '%s' to save filter: %s", path, strerror(errno));
+		return ESP_FAIL;
+	}
+
+	struct filter_header header = {
+		.magic = FILTER_MAGIC,
+		.bit_count = filter->bit_count,
+		.hash_count = filter->hash_count,
+		.auth_header_crc = header_crc,
+		.inserted = filter->inserted,
+		.removed = filter->removed,
+	};
+
+	uint32_t crc = esp_crc32_le(0, (uint8_t *)&header, sizeof(struct filter_header));
+	crc = esp_crc32_le(crc, filter->bits, filter->bit_count / 8);
+
+	esp_err_t err = ESP_OK;
+	if(fwrite(&header, sizeof(struct filter_header), 1, fp) != 1
+		|| fwrite(&crc, sizeof(uint32_t), 1, fp) != 1
+		|| fwrite(filter->bits, filter->bit_count / 8, 1, fp) != 1){
+
+		ESP_LOGE(TAG, "Unable to write filter to '%s': %s", path, strerror(errno));
+		err = ESP_FAIL;
+	}
+
+	fclose(fp);
+
+	if(err != ESP_OK)
+		remove(path);
+
+	return err;
+}
+
+esp_err_t ocpp_auth_filter_load(struct ocpp_auth_filter * filter, const char * path, uint32_t header_crc){
+	if(filter->bits == NULL)
+		return ESP_ERR_INVALID_STATE;
+
+	struct stat st;
+	if(stat(path, &st) != 0)
+		return ESP_ERR_NOT_FOUND;
+
+	FILE * fp = fopen(path, "rb");
+	if(fp == NULL){
+		ESP_LOGE(TAG, "Unable to open '%s' to load filter: %s", path, strerror(errno));
+		return ESP_FAIL;
+	}
+
+	esp_err_t err = ESP_ERR_INVALID_STATE;
+
+	struct filter_header header;
+	uint32_t crc;
+	if(fread(&header, sizeof(struct filter_header), 1, fp) != 1 || fread(&crc, sizeof(uint32_t), 1, fp) != 1){
+		ESP_LOGE(TAG, "Unable to read filter header from '%s'", path);
+		goto cleanup;
+	}
+
+	if(header.magic != FILTER_MAGIC || header.bit_count != filter->bit_count || header.hash_count != filter->hash_count
+		|| header.auth_header_crc != header_crc){
+
+		ESP_LOGW(TAG, "Filter at '%s' does not match current authorization data", path);
+		goto cleanup;
+	}
+
+	if(fread(filter->bits, filter->bit_count / 8, 1, fp) != 1){
+		ESP_LOGE(TAG, "Unable to read filter bits from '%s'", path);
+		goto cleanup;
+	}
+
+	uint32_t crc_calc = esp_crc32_le(0, (uint8_t *)&header, sizeof(struct filter_header));
+	crc_calc = esp_crc32_le(crc_calc, filter->bits, filter->bit_count / 8);
+
+	if(crc_calc != crc){
+		ESP_LOGE(TAG, "CRC mismatch for filter at '%s'", path);
+		goto cleanup;
+	}
+
+	filter->inserted = header.inserted;
+	filter->removed = header.removed;
+	err = ESP_OK;
+
+cleanup:
+	fclose(fp);
+
+	if(err != ESP_OK){
+		ocpp_auth_filter_clear(filter, false);
+	}else{
+		filter->valid = true;
+	}
+
+	return err;
+}
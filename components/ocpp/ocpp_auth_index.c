@@ -0,0 +1,489 @@
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+#include "esp_crc.h"
+
+#include "ocpp_auth_index.h"
+#include "types/ocpp_id_token.h"
+
+static const char * TAG = "OCPP AUTH INDEX";
+
+/* Index region format written after the tag info list of the auth file:
+ * <index>: {<magic><bucket_count><max_entries><used><tombstones><auth_header_crc><flags>}<crc_index_header><bitmap><buckets>
+ *
+ * <magic>, <bucket_count>, <max_entries>, <used>, <tombstones>, <auth_header_crc>, <flags>: <uint32_t>
+ * <bitmap>: <uint8_t[(max_entries + 7) / 8]> padded to a multiple of 4 bytes. Bit n is set if entry n is occupied
+ * <buckets>: <bucket_0>...<bucket_count-1>
+ * <bucket_*>: <uint32_t> with entry number + 1 in the lower 24 bits and a fingerprint of the token hash in the upper 8
+ *
+ * A bucket with entry 0 is empty. A bucket with entry BUCKET_TOMBSTONE has been removed and must be skipped during
+ * probing. The home bucket of a token is the lower bits of its FNV-1a hash.
+ */
+
+#define INDEX_MAGIC 0x58444941 // "AIDX"
+#define INDEX_FLAG_DIRTY 0x01
+
+#define BUCKET_ENTRY_MASK 0x00FFFFFF
+#define BUCKET_EMPTY 0
+#define BUCKET_TOMBSTONE BUCKET_ENTRY_MASK
+#define BUCKET_MAX_ENTRIES (BUCKET_TOMBSTONE - 1)
+
+#define BUCKET_ENTRY(bucket) ((bucket) & BUCKET_ENTRY_MASK)
+#define BUCKET_FINGERPRINT(bucket) ((bucket) >> 24)
+#define BUCKET_CREATE(entry, hash) ((((entry) + 1) & BUCKET_ENTRY_MASK) | ((hash) & 0xFF000000))
+
+#define PROBE_CHUNK_LENGTH 8 // Buckets read per fread while probing
+#define TOKEN_CHUNK_LENGTH 16 // Tokens read per fread while rebuilding
+
+struct index_header{
+	uint32_t magic;
+	uint32_t bucket_count;
+	uint32_t max_entries;
+	uint32_t used;
+	uint32_t tombstones;
+	uint32_t auth_header_crc;
+	uint32_t flags;
+};
+
+static size_t bucket_count_for(size_t max_entries){
+	size_t bucket_count = 8;
+	while(bucket_count < max_entries * 2)
+		bucket_count <<= 1;
+
+	return bucket_count;
+}
+
+static size_t bitmap_size(size_t max_entries){
+	return (((max_entries + 7) / 8) + 3) & ~((size_t)3);
+}
+
+static long bucket_offset(struct ocpp_auth_index * index, size_t position){
+	return index->index_offset + sizeof(struct index_header) + sizeof(uint32_t) + bitmap_size(index->max_entries)
+		+ position * sizeof(uint32_t);
+}
+
+size_t ocpp_auth_index_size(size_t max_entries){
+	return sizeof(struct index_header) + sizeof(uint32_t) + bitmap_size(max_entries) + bucket_count_for(max_entries) * sizeof(uint32_t);
+}
+
+static uint32_t token_hash(const char * id_tag){
+	uint32_t hash = 2166136261u;
+
+	for(size_t i = 0; i < sizeof(ocpp_id_token) && id_tag[i] != '\0'; i++){
+		hash ^= (uint8_t)id_tag[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static void handle_init(struct ocpp_auth_index * index, FILE * fp, long token_list_offset, long index_offset, size_t max_entries){
+	memset(index, 0, sizeof(struct ocpp_auth_index));
+
+	index->fp = fp;
+	index->token_list_offset = token_list_offset;
+	index->index_offset = index_offset;
+	index->max_entries = max_entries;
+	index->bucket_count = bucket_count_for(max_entries);
+}
+
+/*
+ * Reads the index header. Returns ESP_ERR_INVALID_STATE if the header is missing or does not describe an index for
+ * the token list of the handle.
+ */
+static esp_err_t read_index_header(struct ocpp_auth_index * index, struct index_header * header){
+	if(fseek(index->fp, index->index_offset, SEEK_SET) != 0){
+		ESP_LOGE(TAG, "Unable to seek to index header: %s", strerror(errno));
+		return ESP_FAIL;
+	}
+
+	uint32_t crc;
+	if(fread(header, sizeof(struct index_header), 1, index->fp) != 1 || fread(&crc, sizeof(uint32_t), 1, index->fp) != 1){
+		if(feof(index->fp)){
+			clearerr(index->fp);
+			return ESP_ERR_INVALID_STATE;
+		}
+
+		ESP_LOGE(TAG, "Unable to read index header: %s", strerror(errno));
+		return ESP_FAIL;
+	}
+
+	if(esp_crc32_le(0, (uint8_t *)header, sizeof(struct index_header)) != crc
+		|| header->magic != INDEX_MAGIC
+		|| header->bucket_count != index->bucket_count
+		|| header->max_entries != index->max_entries
+		|| header->used + header->tombstones > index->bucket_count){
+
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	return ESP_OK;
+}
+
+static esp_err_t write_index_header(struct ocpp_auth_index * index, uint32_t auth_header_crc, uint32_t flags){
+	struct index_header header = {
+		.magic = INDEX_MAGIC,
+		.bucket_count = index->bucket_count,
+		.max_entries = index->max_entries,
+		.used = index->used,
+		.tombstones = index->tombstones,
+		.auth_header_crc = auth_header_crc,
+		.flags = flags
+	};
+
+	uint32_t crc = esp_crc32_le(0, (uint8_t *)&header, sizeof(struct index_header));
+
+	if(fseek(index->fp, index->index_offset, SEEK_SET) != 0){
+		ESP_LOGE(TAG, "Unable to seek to index header for writing: %s", strerror(errno));
+		return ESP_FAIL;
+	}
+
+	if(fwrite(&header, sizeof(struct index_header), 1, index->fp) != 1 || fwrite(&crc, sizeof(uint32_t), 1, index->fp) != 1){
+		ESP_LOGE(TAG, "Unable to write index header: %s", strerror(errno));
+		return ESP_FAIL;
+	}
+
+	return ESP_OK;
+}
+
+static esp_err_t write_bucket(struct ocpp_auth_index * index, size_t position, uint32_t bucket){
+	if(fseek(index->fp, bucket_offset(index, position), SEEK_SET) != 0){
+		ESP_LOGE(TAG, "Unable to seek to bucket %zu: %s", position, strerror(errno));
+		return ESP_FAIL;
+	}
+
+	if(fwrite(&bucket, sizeof(uint32_t), 1, index->fp) != 1){
+		ESP_LOGE(TAG, "Unable to write bucket %zu: %s", position, strerror(errno));
+		return ESP_FAIL;
+	}
+
+	return ESP_OK;
+}
+
+static void bitmap_set(struct ocpp_auth_index * index, size_t entry, bool occupied){
+	if(occupied){
+		index->bitmap[entry / 8] |= 1 << (entry % 8);
+	}else{
+		index->bitmap[entry / 8] &= ~(1 << (entry % 8));
+	}
+
+	index->bitmap_changed = true;
+}
+
+enum probe_action{
+	eINDEX_PROBE_FIND,
+	eINDEX_PROBE_INSERT,
+	eINDEX_PROBE_REMOVE,
+};
+
+/*
+ * Walks the probe sequence of the token starting at its home bucket. The buckets are read in chunks to reduce the
+ * number of reads for clustered buckets.
+ *
+ * For eINDEX_PROBE_FIND the entry of the token is written to entry_inout.
+ * For eINDEX_PROBE_INSERT the first empty or removed bucket is given entry_inout.
+ * For eINDEX_PROBE_REMOVE the bucket with entry_inout is marked as removed.
+ */
+static esp_err_t probe(struct ocpp_auth_index * index, const char * id_tag, enum probe_action action, size_t * entry_inout){
+	uint32_t buckets[PROBE_CHUNK_LENGTH];
+
+	const uint32_t hash = token_hash(id_tag);
+	size_t position = hash & (index->bucket_count - 1);
+	size_t probed = 0;
+
+	while(probed < index->bucket_count){
+		size_t count = index->bucket_count - position;
+		if(count > PROBE_CHUNK_LENGTH)
+			count = PROBE_CHUNK_LENGTH;
+
+		if(fseek(index->fp, bucket_offset(index, position), SEEK_SET) != 0){
+			ESP_LOGE(TAG, "Unable to seek to bucket %zu: %s", position, strerror(errno));
+			return ESP_FAIL;
+		}
+
+		if(fread(buckets, sizeof(uint32_t), count, index->fp) != count){
+			ESP_LOGE(TAG, "Unable to read buckets at %zu: %s", position, strerror(errno));
+			return ESP_FAIL;
+		}
+
+		for(size_t i = 0; i < count && probed < index->bucket_count; i++, probed++){
+			const uint32_t entry = BUCKET_ENTRY(buckets[i]);
+
+			switch(action){
+			case eINDEX_PROBE_INSERT:
+				if(entry == BUCKET_EMPTY || entry == BUCKET_TOMBSTONE){
+					if(write_bucket(index, position + i, BUCKET_CREATE(*entry_inout, hash)) != ESP_OK)
+						return ESP_FAIL;
+
+					if(entry == BUCKET_TOMBSTONE)
+						index->tombstones--;
+
+					index->used++;
+					return ESP_OK;
+				}
+				break;
+
+			case eINDEX_PROBE_REMOVE:
+				if(entry == BUCKET_EMPTY)
+					return ESP_ERR_NOT_FOUND;
+
+				if(entry == *entry_inout + 1){
+					if(write_bucket(index, position + i, BUCKET_TOMBSTONE) != ESP_OK)
+						return ESP_FAIL;
+
+					index->used--;
+					index->tombstones++;
+					return ESP_OK;
+				}
+				break;
+
+			case eINDEX_PROBE_FIND:
+				if(entry == BUCKET_EMPTY)
+					return ESP_ERR_NOT_FOUND;
+
+				if(entry == BUCKET_TOMBSTONE || BUCKET_FINGERPRINT(buckets[i]) != (hash >> 24) || entry > index->max_entries)
+					break;
+
+				ocpp_id_token found_tag;
+				if(fseek(index->fp, index->token_list_offset + sizeof(ocpp_id_token) * (entry - 1), SEEK_SET) != 0
+					|| fread(found_tag, sizeof(ocpp_id_token), 1, index->fp) != 1){
+					ESP_LOGE(TAG, "Unable to read indexed token at %" PRIu32 ": %s", entry - 1, strerror(errno));
+					return ESP_FAIL;
+				}
+				found_tag[sizeof(ocpp_id_token) -1] = '\0';
+
+				if(strcmp(found_tag, id_tag) == 0){
+					*entry_inout = entry - 1;
+					return ESP_OK;
+				}
+				break;
+			}
+		}
+
+		position = (position + count) & (index->bucket_count - 1);
+	}
+
+	return action == eINDEX_PROBE_INSERT ? ESP_ERR_NO_MEM : ESP_ERR_NOT_FOUND;
+}
+
+/*
+ * Writes empty buckets and inserts all tokens found in the token list. Used when the index is missing, stale or
+ * contains too many removed buckets.
+ */
+static esp_err_t rebuild(struct ocpp_auth_index * index, size_t token_count){
+	ESP_LOGI(TAG, "Rebuilding index for %zu tokens", token_count);
+
+	memset(index->bitmap, 0, bitmap_size(index->max_entries));
+	index->bitmap_changed = true;
+	index->used = 0;
+	index->tombstones = 0;
+
+	uint32_t empty_buckets[PROBE_CHUNK_LENGTH] = {0};
+
+	if(fseek(index->fp, bucket_offset(index, 0), SEEK_SET) != 0){
+		ESP_LOGE(TAG, "Unable to seek to buckets during rebuild: %s", strerror(errno));
+		return ESP_FAIL;
+	}
+
+	for(size_t i = 0; i < index->bucket_count; i += PROBE_CHUNK_LENGTH){
+		if(fwrite(empty_buckets, sizeof(empty_buckets), 1, index->fp) != 1){
+			ESP_LOGE(TAG, "Unable to clear buckets during rebuild: %s", strerror(errno));
+			return ESP_FAIL;
+		}
+	}
+
+	ocpp_id_token tokens[TOKEN_CHUNK_LENGTH];
+	size_t read_count = 0;
+
+	for(size_t entry = 0; read_count < token_count && entry < index->max_entries; entry += TOKEN_CHUNK_LENGTH){
+		size_t count = index->max_entries - entry;
+		if(count > TOKEN_CHUNK_LENGTH)
+			count = TOKEN_CHUNK_LENGTH;
+
+		if(fseek(index->fp, index->token_list_offset + sizeof(ocpp_id_token) * entry, SEEK_SET) != 0){
+			ESP_LOGE(TAG, "Unable to seek to token list during rebuild: %s", strerror(errno));
+			return ESP_FAIL;
+		}
+
+		if(fread(tokens, sizeof(ocpp_id_token), count, index->fp) != count){
+			ESP_LOGE(TAG, "Unable to read token list at %zu during rebuild: %s", entry, strerror(errno));
+			return ESP_FAIL;
+		}
+
+		for(size_t i = 0; i < count && read_count < token_count; i++){
+			if(tokens[i][0] == '\0')
+				continue;
+
+			tokens[i][sizeof(ocpp_id_token) -1] = '\0';
+			read_count++;
+
+			if(ocpp_auth_index_insert(index, tokens[i], entry + i) != ESP_OK){
+				ESP_LOGE(TAG, "Unable to insert token at %zu during rebuild", entry + i);
+				return ESP_FAIL;
+			}
+		}
+	}
+
+	return ESP_OK;
+}
+
+esp_err_t ocpp_auth_index_open(struct ocpp_auth_index * index, FILE * fp, long token_list_offset, long index_offset,
+			size_t max_entries, uint32_t header_crc){
+
+	handle_init(index, fp, token_list_offset, index_offset, max_entries);
+
+	if(max_entries > BUCKET_MAX_ENTRIES)
+		return ESP_ERR_INVALID_STATE;
+
+	struct index_header header;
+	esp_err_t err = read_index_header(index, &header);
+	if(err != ESP_OK)
+		return err;
+
+	if((header.flags & INDEX_FLAG_DIRTY) || header.auth_header_crc != header_crc)
+		return ESP_ERR_INVALID_STATE;
+
+	index->used = header.used;
+	index->tombstones = header.tombstones;
+
+	return ESP_OK;
+}
+
+esp_err_t ocpp_auth_index_find(struct ocpp_auth_index * index, const char * id_tag, size_t * entry_out){
+	if(id_tag[0] == '\0')
+		return ESP_ERR_NOT_FOUND;
+
+	return probe(index, id_tag, eINDEX_PROBE_FIND, entry_out);
+}
+
+esp_err_t ocpp_auth_index_begin(struct ocpp_auth_index * index, FILE * fp, long token_list_offset, long index_offset,
+				size_t max_entries, uint32_t header_crc, size_t token_count, bool create){
+
+	handle_init(index, fp, token_list_offset, index_offset, max_entries);
+
+	if(max_entries > BUCKET_MAX_ENTRIES){
+		ESP_LOGE(TAG, "Too many entries for index: %zu", max_entries);
+		return ESP_ERR_INVALID_SIZE;
+	}
+
+	index->bitmap = calloc(1, bitmap_size(max_entries));
+	if(index->bitmap == NULL){
+		ESP_LOGE(TAG, "Unable to allocate entry bitmap");
+		return ESP_ERR_NO_MEM;
+	}
+
+	struct index_header header;
+	esp_err_t err = create ? ESP_ERR_INVALID_STATE : read_index_header(index, &header);
+
+	if(err == ESP_OK && !(header.flags & INDEX_FLAG_DIRTY) && header.auth_header_crc == header_crc
+		&& header.tombstones <= index->bucket_count / 4){
+
+		index->used = header.used;
+		index->tombstones = header.tombstones;
+
+		if(fread(index->bitmap, bitmap_size(max_entries), 1, fp) != 1){
+			ESP_LOGE(TAG, "Unable to read entry bitmap: %s", strerror(errno));
+			err = ESP_FAIL;
+			goto error;
+		}
+
+	}else if(err == ESP_OK || err == ESP_ERR_INVALID_STATE){
+		err = rebuild(index, create ? 0 : token_count);
+		if(err != ESP_OK)
+			goto error;
+
+	}else{
+		goto error;
+	}
+
+	err = write_index_header(index, header_crc, INDEX_FLAG_DIRTY);
+	if(err != ESP_OK)
+		goto error;
+
+	return ESP_OK;
+
+error:
+	ocpp_auth_index_close(index);
+	return err;
+}
+
+esp_err_t ocpp_auth_index_allocate_entry(struct ocpp_auth_index * index, size_t * entry_out){
+	for(size_t i = 0; i < (index->max_entries + 7) / 8; i++){
+		if(index->bitmap[i] == 0xFF)
+			continue;
+
+		for(size_t j = 0; j < 8; j++){
+			size_t entry = i * 8 + j;
+			if(entry >= index->max_entries)
+				break;
+
+			if(!ocpp_auth_index_entry_is_occupied(index, entry)){
+				bitmap_set(index, entry, true);
+				*entry_out = entry;
+				return ESP_OK;
+			}
+		}
+	}
+
+	return ESP_ERR_NO_MEM;
+}
+
+bool ocpp_auth_index_entry_is_occupied(struct ocpp_auth_index * index, size_t entry){
+	return (index->bitmap[entry / 8] & (1 << (entry % 8))) != 0;
+}
+
+esp_err_t ocpp_auth_index_insert(struct ocpp_auth_index * index, const char * id_tag, size_t entry){
+	if(entry >= index->max_entries){
+		ESP_LOGE(TAG, "Entry %zu is outside token list", entry);
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	esp_err_t err = probe(index, id_tag, eINDEX_PROBE_INSERT, &entry);
+	if(err == ESP_OK)
+		bitmap_set(index, entry, true);
+
+	return err;
+}
+
+esp_err_t ocpp_auth_index_remove(struct ocpp_auth_index * index, const char * id_tag, size_t entry){
+	if(entry >= index->max_entries){
+		ESP_LOGE(TAG, "Entry %zu is outside token list", entry);
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	bitmap_set(index, entry, false);
+
+	esp_err_t err = probe(index, id_tag, eINDEX_PROBE_REMOVE, &entry);
+	if(err == ESP_ERR_NOT_FOUND){
+		ESP_LOGW(TAG, "Removed token was not indexed");
+		err = ESP_OK;
+	}
+
+	return err;
+}
+
+esp_err_t ocpp_auth_index_commit(struct ocpp_auth_index * index, uint32_t header_crc){
+	if(index->bitmap_changed){
+		if(fseek(index->fp, index->index_offset + sizeof(struct index_header) + sizeof(uint32_t), SEEK_SET) != 0){
+			ESP_LOGE(TAG, "Unable to seek to entry bitmap: %s", strerror(errno));
+			return ESP_FAIL;
+		}
+
+		if(fwrite(index->bitmap, bitmap_size(index->max_entries), 1, index->fp) != 1){
+			ESP_LOGE(TAG, "Unable to write entry bitmap: %s", strerror(errno));
+			return ESP_FAIL;
+		}
+
+		index->bitmap_changed = false;
+	}
+
+	return write_index_header(index, header_crc, 0);
+}
+
+void ocpp_auth_index_close(struct ocpp_auth_index * index){
+	free(index->bitmap);
+	index->bitmap = NULL;
+}
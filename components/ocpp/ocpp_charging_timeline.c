@@ -0,0 +1,316 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "esp_log.h"
+
+#include "ocpp_charging_timeline.h"
+
+static const char * TAG = "OCPP TIMELINE  ";
+
+esp_err_t ocpp_charging_timeline_init(struct ocpp_charging_timeline * timeline, size_t max_entries){
+	memset(timeline, 0, sizeof(struct ocpp_charging_timeline));
+
+	if(max_entries == 0)
+		return ESP_ERR_INVALID_ARG;
+
+	timeline->entries = malloc(sizeof(struct ocpp_charging_timeline_entry) * max_entries);
+	if(timeline->entries == NULL){
+		ESP_LOGE(TAG, "Unable to allocate %zu timeline entries", max_entries);
+		return ESP_ERR_NO_MEM;
+	}
+
+	timeline->max_entries = max_entries;
+
+	return ESP_OK;
+}
+
+void ocpp_charging_timeline_deinit(struct ocpp_charging_timeline * timeline){
+	free(timeline->entries);
+	memset(timeline, 0, sizeof(struct ocpp_charging_timeline));
+}
+
+static time_t earliest(time_t t1, time_t t2){
+	return (t1 < t2) ? t1 : t2;
+}
+
+/*
+ * Position of the sweep within a single profile. The period found by the last update is kept so that the next update
+ * within the same schedule continues from it instead of from the first period.
+ */
+struct profile_cursor{
+	const struct ocpp_charging_profile * profile;
+	const struct ocpp_charging_schedule_period_list * period; // Active period or NULL if the profile is not active
+	time_t schedule_start; // Start of the schedule the period belongs to
+	time_t next_event; // Next time the profile may start, stop or change period
+};
+
+/*
+ * Updates the cursor to the state of its profile at the given time. next_event is set to when the period ends if active
+ * or when the profile may become active if not. It is set to LONG_MAX if the profile will not change or never become
+ * active.
+ */
+static void cursor_update(struct profile_cursor * cursor, time_t relative_start, const int * transaction_id, time_t when){
+	const struct ocpp_charging_profile * profile = cursor->profile;
+
+	const struct ocpp_charging_schedule_period_list * previous_period = cursor->period;
+	time_t previous_schedule_start = cursor->schedule_start;
+
+	cursor->period = NULL;
+	cursor->next_event = LONG_MAX;
+
+	if(profile->transaction_id != NULL && transaction_id != NULL && *profile->transaction_id != *transaction_id)
+		return;
+
+	if(when >= profile->valid_to)
+		return;
+
+	if(when < profile->valid_from){
+		cursor->next_event = profile->valid_from;
+		return;
+	}
+
+	const struct ocpp_charging_schedule * schedule = &profile->charging_schedule;
+
+	time_t schedule_start;
+	time_t recurrency_interval = 0;
+
+	switch(profile->profile_kind){
+	case eOCPP_CHARGING_PROFILE_KIND_ABSOLUTE:
+		if(schedule->start_schedule == NULL)
+			return;
+
+		schedule_start = *schedule->start_schedule;
+		break;
+
+	case eOCPP_CHARGING_PROFILE_KIND_RECURRING:
+		if(schedule->start_schedule == NULL || profile->recurrency_kind == NULL)
+			return;
+
+		switch(*profile->recurrency_kind){
+		case eOCPP_RECURRENCY_KIND_DAILY:
+			recurrency_interval = 86400; // 86400 = 1 day in second
+			break;
+		case eOCPP_RECURRENCY_KIND_WEEKLY:
+			recurrency_interval = 604800; // 604800 = 1 week in seconds
+			break;
+		default:
+			return;
+		}
+
+		schedule_start = *schedule->start_schedule;
+		if(when > schedule_start)
+			schedule_start = when - ((when - schedule_start) % recurrency_interval);
+		break;
+
+	case eOCPP_CHARGING_PROFILE_KIND_RELATIVE:
+		schedule_start = relative_start;
+		break;
+
+	default:
+		return;
+	}
+
+	if(when < schedule_start){
+		if(schedule_start < profile->valid_to)
+			cursor->next_event = schedule_start;
+
+		return;
+	}
+
+	time_t offset = when - schedule_start;
+	time_t next_recurrence = (recurrency_interval > 0) ? schedule_start + recurrency_interval : LONG_MAX;
+
+	if(schedule->duration != NULL && offset >= *schedule->duration){
+		if(next_recurrence < profile->valid_to)
+			cursor->next_event = next_recurrence;
+
+		return;
+	}
+
+	const struct ocpp_charging_schedule_period_list * period = &schedule->schedule_period;
+	if(period->value.start_period > offset){ // Only expected if first period does not start at 0
+		if(schedule_start + period->value.start_period < profile->valid_to)
+			cursor->next_event = schedule_start + period->value.start_period;
+
+		return;
+	}
+
+	// Continue from the previous period if still within the same schedule, making a sweep linear in the period count
+	if(previous_period != NULL && previous_schedule_start == schedule_start && previous_period->value.start_period <= offset)
+		period = previous_period;
+
+	while(period->next != NULL && period->next->value.start_period <= offset)
+		period = period->next;
+
+	time_t next_event = earliest(next_recurrence, profile->valid_to);
+
+	if(period->next != NULL)
+		next_event = earliest(next_event, schedule_start + period->next->value.start_period);
+
+	if(schedule->duration != NULL)
+		next_event = earliest(next_event, schedule_start + *schedule->duration);
+
+	cursor->period = period;
+	cursor->schedule_start = schedule_start;
+	cursor->next_event = next_event;
+}
+
+/*
+ * Finds the first active cursor in order of precedence. Cursors are only updated when reached, so profiles hidden by a
+ * profile with higher precedence do not add boundaries to the sweep. next_out is lowered to the earliest boundary of
+ * the cursors checked.
+ */
+static const struct profile_cursor * prevailing_cursor(struct profile_cursor * cursors, size_t count, time_t relative_start,
+						const int * transaction_id, time_t when, time_t * next_out){
+	for(size_t i = 0; i < count; i++){
+		if(cursors[i].next_event <= when)
+			cursor_update(&cursors[i], relative_start, transaction_id, when);
+
+		*next_out = earliest(*next_out, cursors[i].next_event);
+
+		if(cursors[i].period != NULL)
+			return &cursors[i];
+	}
+
+	return NULL;
+}
+
+static bool entry_is_equal(const struct ocpp_charging_timeline_entry * e1, const struct ocpp_charging_timeline_entry * e2){
+	return e1->limit == e2->limit && e1->number_phases == e2->number_phases && e1->min_charging_rate == e2->min_charging_rate;
+}
+
+/*
+ * Sweeps over the profile boundaries in time order. Each profile has a cursor with the time of its next boundary and
+ * only cursors whose boundary is reached are updated. At each boundary the prevailing profile of each purpose is the
+ * first active cursor in precedence order, and the minimum of their periods is appended to the timeline if it differs
+ * from the previous entry.
+ */
+esp_err_t ocpp_charging_timeline_build(struct ocpp_charging_timeline * timeline,
+				const struct ocpp_charging_profile * const * tx_profiles, size_t tx_count,
+				const struct ocpp_charging_profile * const * max_profiles, size_t max_count,
+				time_t relative_start, const int * transaction_id, time_t from, time_t to){
+
+	timeline->count = 0;
+	timeline->position = 0;
+	timeline->end = from;
+
+	if(timeline->entries == NULL)
+		return ESP_ERR_INVALID_STATE;
+
+	size_t cursor_count = tx_count + max_count;
+	struct profile_cursor * cursors = malloc(sizeof(struct profile_cursor) * (cursor_count > 0 ? cursor_count : 1));
+	if(cursors == NULL){
+		ESP_LOGE(TAG, "Unable to allocate %zu profile cursors", cursor_count);
+		return ESP_ERR_NO_MEM;
+	}
+
+	for(size_t i = 0; i < cursor_count; i++){
+		cursors[i].profile = (i < tx_count) ? tx_profiles[i] : max_profiles[i - tx_count];
+		cursors[i].period = NULL;
+		cursors[i].schedule_start = 0;
+		cursors[i].next_event = from;
+	}
+
+	esp_err_t err = ESP_OK;
+	time_t when = from;
+
+	while(when < to){
+		time_t next = LONG_MAX;
+
+		const struct profile_cursor * tx = prevailing_cursor(cursors, tx_count, relative_start, transaction_id, when, &next);
+		const struct profile_cursor * max = prevailing_cursor(cursors + tx_count, max_count, relative_start, transaction_id,
+								when, &next);
+
+		if(tx == NULL || max == NULL){
+			ESP_LOGE(TAG, "No active %s profile at %lld", (tx == NULL) ? "tx" : "max", (long long)when);
+			timeline->count = 0;
+			err = ESP_ERR_NOT_FOUND;
+			goto cleanup;
+		}
+
+		const struct ocpp_charging_schedule_period * tx_period = &tx->period->value;
+		const struct ocpp_charging_schedule_period * max_period = &max->period->value;
+		float tx_min_rate = tx->profile->charging_schedule.min_charging_rate;
+		float max_min_rate = max->profile->charging_schedule.min_charging_rate;
+
+		struct ocpp_charging_timeline_entry entry = {
+			.start = when,
+			.limit = (tx_period->limit < max_period->limit) ? tx_period->limit : max_period->limit,
+			.number_phases = (tx_period->number_phases < max_period->number_phases) ? tx_period->number_phases : max_period->number_phases,
+			.min_charging_rate = (tx_min_rate < max_min_rate) ? tx_min_rate : max_min_rate,
+		};
+
+		if(timeline->count == 0 || !entry_is_equal(&timeline->entries[timeline->count -1], &entry)){
+			if(timeline->count == timeline->max_entries){
+				ESP_LOGW(TAG, "Timeline entries exhausted; timeline ends early");
+				break;
+			}
+
+			timeline->entries[timeline->count++] = entry;
+		}
+
+		when = (next > when) ? next : when + 1;
+	}
+
+	timeline->end = earliest(when, to);
+
+	ESP_LOGI(TAG, "Timeline with %zu entries created for %lld -> %lld", timeline->count, (long long)from, (long long)timeline->end);
+
+cleanup:
+	free(cursors);
+	return err;
+}
+
+const struct ocpp_charging_timeline_entry * ocpp_charging_timeline_at(struct ocpp_charging_timeline * timeline, time_t when,
+								time_t * next_change_out){
+
+	if(timeline->count == 0 || when < timeline->entries[0].start || when >= timeline->end)
+		return NULL;
+
+	if(timeline->position >= timeline->count || when < timeline->entries[timeline->position].start)
+		timeline->position = 0; // Time has moved backwards
+
+	while(timeline->position + 1 < timeline->count && timeline->entries[timeline->position + 1].start <= when)
+		timeline->position++;
+
+	*next_change_out = (timeline->position + 1 < timeline->count) ? timeline->entries[timeline->position + 1].start : timeline->end;
+
+	return &timeline->entries[timeline->position];
+}
+
+esp_err_t ocpp_charging_timeline_to_schedule(const struct ocpp_charging_timeline * timeline, time_t schedule_start,
+					struct ocppj_charging_schedule * schedule_out){
+
+	memset(schedule_out, 0, sizeof(struct ocppj_charging_schedule));
+
+	if(timeline->count == 0)
+		return ESP_ERR_INVALID_ARG;
+
+	struct ocppj_charging_schedule_period * periods = malloc(sizeof(struct ocppj_charging_schedule_period) * timeline->count);
+	if(periods == NULL){
+		ESP_LOGE(TAG, "Unable to allocate %zu schedule periods", timeline->count);
+		return ESP_ERR_NO_MEM;
+	}
+
+	schedule_out->present = OCPPJ_CHARGING_SCHEDULE_HAS_DURATION | OCPPJ_CHARGING_SCHEDULE_HAS_MIN_CHARGING_RATE;
+	schedule_out->duration = timeline->end - schedule_start;
+	schedule_out->charging_rate_unit = OCPP_CHARGING_RATE_A;
+	schedule_out->charging_schedule_period_count = timeline->count;
+	schedule_out->charging_schedule_period = periods;
+	schedule_out->min_charging_rate = timeline->entries[0].min_charging_rate;
+
+	for(size_t i = 0; i < timeline->count; i++){
+		periods[i] = (struct ocppj_charging_schedule_period){
+			.present = OCPPJ_CHARGING_SCHEDULE_PERIOD_HAS_NUMBER_PHASES,
+			.start_period = timeline->entries[i].start - schedule_start,
+			.limit = timeline->entries[i].limit,
+			.number_phases = timeline->entries[i].number_phases,
+		};
+
+		if(timeline->entries[i].min_charging_rate < schedule_out->min_charging_rate)
+			schedule_out->min_charging_rate = timeline->entries[i].min_charging_rate;
+	}
+
+	return ESP_OK;
+}
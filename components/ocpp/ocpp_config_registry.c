@@ -0,0 +1,426 @@
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+
+#include "ocpp_config_registry.h"
+#include "ocpp_json/ocppj_message_structure.h"
+
+static const char * TAG = "OCPP CONFIG REG";
+
+#define SLOT_EMPTY UINT8_MAX
+
+/*
+ * Number of hash slots per key. With 8 slots per key, about 1 in 20 seeds give each key its own slot for the ~50 keys
+ * of OCPP 1.6, so a seed is found quickly on init while the slots only use one byte each.
+ */
+#define SLOTS_PER_KEY 8
+#define MAX_SEED_ATTEMPTS 4096
+
+static uint32_t key_hash(const char * key, uint32_t seed){
+	uint32_t hash = 2166136261u ^ (seed * 16777619u);
+
+	for(; *key != '\0'; key++)
+		hash = (hash ^ (uint8_t)tolower((unsigned char)*key)) * 16777619u;
+
+	// Mix the high bits into the low bits used for the slot
+	hash ^= hash >> 15;
+	hash *= 0x2c1b3c6du;
+	hash ^= hash >> 12;
+
+	return hash;
+}
+
+esp_err_t ocpp_config_registry_init(struct ocpp_config_registry * registry, const struct ocpp_config_key * keys, size_t key_count,
+				size_t buffer_size){
+	memset(registry, 0, sizeof(struct ocpp_config_registry));
+
+	if(keys == NULL || key_count == 0 || key_count >= SLOT_EMPTY || buffer_size == 0)
+		return ESP_ERR_INVALID_ARG;
+
+	registry->keys = keys;
+	registry->key_count = key_count;
+	registry->buffer_size = buffer_size;
+
+	size_t slot_count = 1;
+	while(slot_count < key_count * SLOTS_PER_KEY)
+		slot_count <<= 1;
+
+	registry->slots = malloc(slot_count);
+	if(registry->slots == NULL){
+		ESP_LOGW(TAG, "Unable to allocate hash slots; using linear search");
+		return ESP_OK;
+	}
+
+	for(uint32_t seed = 0; seed < MAX_SEED_ATTEMPTS; seed++){
+		memset(registry->slots, SLOT_EMPTY, slot_count);
+
+		size_t i = 0;
+		for(; i < key_count; i++){
+			size_t slot = key_hash(keys[i].key, seed) & (slot_count - 1);
+			if(registry->slots[slot] != SLOT_EMPTY)
+				break;
+
+			registry->slots[slot] = i;
+		}
+
+		if(i == key_count){
+			registry->slot_mask = slot_count - 1;
+			registry->seed = seed;
+
+			ESP_LOGI(TAG, "Created perfect hash for %zu keys in %zu slots with seed %" PRIu32, key_count, slot_count, seed);
+			return ESP_OK;
+		}
+	}
+
+	// Only expected if keys are duplicated
+	ESP_LOGW(TAG, "Unable to create perfect hash for %zu keys; using linear search", key_count);
+	free(registry->slots);
+	registry->slots = NULL;
+
+	return ESP_OK;
+}
+
+void ocpp_config_registry_deinit(struct ocpp_config_registry * registry){
+	free(registry->slots);
+	memset(registry, 0, sizeof(struct ocpp_config_registry));
+}
+
+const struct ocpp_config_key * ocpp_config_registry_find(const struct ocpp_config_registry * registry, const char * key){
+	if(registry->slots != NULL){
+		uint8_t index = registry->slots[key_hash(key, registry->seed) & registry->slot_mask];
+
+		if(index != SLOT_EMPTY && strcasecmp(registry->keys[index].key, key) == 0)
+			return &registry->keys[index];
+
+		return NULL;
+	}
+
+	for(size_t i = 0; i < registry->key_count; i++){
+		if(strcasecmp(registry->keys[i].key, key) == 0)
+			return &registry->keys[i];
+	}
+
+	return NULL;
+}
+
+const char * ocpp_config_registry_get_value(const struct ocpp_config_key * entry, char * buffer, size_t buffer_size){
+	switch(entry->type){
+	case eOCPP_CONFIG_TYPE_CONSTANT:
+		return entry->constant;
+
+	case eOCPP_CONFIG_TYPE_BOOL:
+		return entry->get.boolean() ? "true" : "false";
+
+	case eOCPP_CONFIG_TYPE_U8:
+		snprintf(buffer, buffer_size, "%" PRIu8, entry->get.u8());
+		return buffer;
+
+	case eOCPP_CONFIG_TYPE_U16:
+		snprintf(buffer, buffer_size, "%" PRIu16, entry->get.u16());
+		return buffer;
+
+	case eOCPP_CONFIG_TYPE_U32:
+		snprintf(buffer, buffer_size, "%" PRIu32, entry->get.u32());
+		return buffer;
+
+	case eOCPP_CONFIG_TYPE_STRING:
+		return entry->get.string();
+
+	case eOCPP_CONFIG_TYPE_CUSTOM:
+		return (entry->get.custom != NULL) ? entry->get.custom(buffer, buffer_size) : NULL;
+	}
+
+	return NULL;
+}
+
+static bool parse_unsigned(const char * value, uint32_t upper_bounds, uint32_t * value_out){
+	char * endptr;
+
+	errno = 0;
+	long long value_long = strtoll(value, &endptr, 0);
+	if(errno != 0 || endptr == value || endptr[0] != '\0'){
+		ESP_LOGW(TAG, "Not a valid unsigned integer: '%s'", value);
+		return false;
+	}
+
+	if(value_long < 0 || value_long > upper_bounds){
+		ESP_LOGW(TAG, "%lld exceeds %" PRIu32, value_long, upper_bounds);
+		return false;
+	}
+
+	*value_out = (uint32_t)value_long;
+	return true;
+}
+
+esp_err_t ocpp_config_registry_set_value(const struct ocpp_config_key * entry, const char * value){
+	if(entry->read_only)
+		return ESP_ERR_NOT_SUPPORTED;
+
+	uint32_t value_u;
+
+	switch(entry->type){
+	case eOCPP_CONFIG_TYPE_BOOL:{
+		bool value_bool;
+		if(strcasecmp(value, "true") == 0){
+			value_bool = true;
+		}else if(strcasecmp(value, "false") == 0){
+			value_bool = false;
+		}else{
+			return ESP_ERR_INVALID_ARG;
+		}
+
+		if(entry->validate.boolean != NULL && !entry->validate.boolean(value_bool))
+			return ESP_ERR_INVALID_ARG;
+
+		entry->set.boolean(value_bool);
+		break;
+	}
+	case eOCPP_CONFIG_TYPE_U8:
+		if(!parse_unsigned(value, UINT8_MAX, &value_u) || (entry->validate.u8 != NULL && !entry->validate.u8(value_u)))
+			return ESP_ERR_INVALID_ARG;
+
+		entry->set.u8(value_u);
+		break;
+
+	case eOCPP_CONFIG_TYPE_U16:
+		if(!parse_unsigned(value, UINT16_MAX, &value_u) || (entry->validate.u16 != NULL && !entry->validate.u16(value_u)))
+			return ESP_ERR_INVALID_ARG;
+
+		entry->set.u16(value_u);
+		break;
+
+	case eOCPP_CONFIG_TYPE_U32:
+		if(!parse_unsigned(value, UINT32_MAX, &value_u) || (entry->validate.u32 != NULL && !entry->validate.u32(value_u)))
+			return ESP_ERR_INVALID_ARG;
+
+		entry->set.u32(value_u);
+		break;
+
+	case eOCPP_CONFIG_TYPE_STRING:
+		if(entry->validate.string != NULL && !entry->validate.string(value))
+			return ESP_ERR_INVALID_ARG;
+
+		entry->set.string(value);
+		break;
+
+	case eOCPP_CONFIG_TYPE_CUSTOM:
+		if(entry->set.custom == NULL)
+			return ESP_ERR_NOT_SUPPORTED;
+
+		if(entry->set.custom(value) != 0)
+			return ESP_ERR_INVALID_ARG;
+
+		break;
+
+	default:
+		return ESP_ERR_NOT_SUPPORTED;
+	}
+
+	if(entry->on_change != NULL)
+		entry->on_change();
+
+	return ESP_OK;
+}
+
+/*
+ * Appends text to a single growing buffer. After a failed allocation all further writes are ignored and the message is
+ * discarded by the caller.
+ */
+struct response_writer{
+	char * buffer;
+	size_t length;
+	size_t size;
+	bool failed;
+};
+
+static void writer_append(struct response_writer * writer, const char * data, size_t length){
+	if(writer->failed)
+		return;
+
+	if(writer->length + length + 1 > writer->size){
+		size_t new_size = writer->size;
+		while(writer->length + length + 1 > new_size)
+			new_size *= 2;
+
+		char * new_buffer = realloc(writer->buffer, new_size);
+		if(new_buffer == NULL){
+			ESP_LOGE(TAG, "Unable to grow response buffer to %zu bytes", new_size);
+			writer->failed = true;
+			return;
+		}
+
+		writer->buffer = new_buffer;
+		writer->size = new_size;
+	}
+
+	memcpy(writer->buffer + writer->length, data, length);
+	writer->length += length;
+	writer->buffer[writer->length] = '\0';
+}
+
+static void writer_append_text(struct response_writer * writer, const char * text){
+	writer_append(writer, text, strlen(text));
+}
+
+static void writer_append_json_string(struct response_writer * writer, const char * value){
+	writer_append(writer, "\"", 1);
+
+	const char * run_start = value;
+	for(const char * c = value; *c != '\0'; c++){
+		unsigned char character = *c;
+		if(character != '"' && character != '\\' && character >= 0x20)
+			continue;
+
+		writer_append(writer, run_start, c - run_start);
+		run_start = c + 1;
+
+		char escaped[8];
+		switch(character){
+		case '"':
+			writer_append(writer, "\\\"", 2);
+			break;
+		case '\\':
+			writer_append(writer, "\\\\", 2);
+			break;
+		case '\n':
+			writer_append(writer, "\\n", 2);
+			break;
+		case '\r':
+			writer_append(writer, "\\r", 2);
+			break;
+		case '\t':
+			writer_append(writer, "\\t", 2);
+			break;
+		default:
+			snprintf(escaped, sizeof(escaped), "\\u%04x", character);
+			writer_append(writer, escaped, 6);
+		}
+	}
+
+	writer_append(writer, run_start, strlen(run_start));
+	writer_append(writer, "\"", 1);
+}
+
+static void writer_append_key_value(struct response_writer * writer, const struct ocpp_config_key * entry, const char * value,
+				bool first){
+	writer_append_text(writer, first ? "{\"key\":" : ",{\"key\":");
+	writer_append_json_string(writer, entry->key);
+	writer_append_text(writer, entry->read_only ? ",\"readonly\":true,\"value\":" : ",\"readonly\":false,\"value\":");
+	writer_append_json_string(writer, value);
+	writer_append(writer, "}", 1);
+}
+
+esp_err_t ocpp_config_registry_write_configuration(struct ocpp_config_registry * registry, const char * unique_id,
+						const char * const * requested_keys, size_t requested_count,
+						char ** message_out, size_t * length_out){
+	struct response_writer writer = {
+		.buffer = malloc(registry->buffer_size),
+		.size = registry->buffer_size,
+	};
+
+	if(writer.buffer == NULL){
+		ESP_LOGE(TAG, "Unable to allocate response buffer of %zu bytes", registry->buffer_size);
+		return ESP_ERR_NO_MEM;
+	}
+
+	char value_buffer[OCPP_CONFIG_VALUE_BUFFER_SIZE];
+	char message_type[8];
+	snprintf(message_type, sizeof(message_type), "[%d,", eOCPPJ_MESSAGE_ID_RESULT);
+
+	writer_append_text(&writer, message_type);
+	writer_append_json_string(&writer, unique_id);
+	writer_append_text(&writer, ",{\"configurationKey\":[");
+
+	bool first = true;
+	size_t unknown_count = 0;
+
+	if(requested_count == 0){
+		for(size_t i = 0; i < registry->key_count; i++){
+			const char * value = ocpp_config_registry_get_value(&registry->keys[i], value_buffer, sizeof(value_buffer));
+			if(value != NULL){
+				writer_append_key_value(&writer, &registry->keys[i], value, first);
+				first = false;
+			}
+		}
+	}else{
+		for(size_t i = 0; i < requested_count; i++){
+			const struct ocpp_config_key * entry = ocpp_config_registry_find(registry, requested_keys[i]);
+			const char * value = (entry != NULL) ? ocpp_config_registry_get_value(entry, value_buffer, sizeof(value_buffer)) : NULL;
+
+			if(value != NULL){
+				writer_append_key_value(&writer, entry, value, first);
+				first = false;
+			}else{
+				unknown_count++;
+			}
+		}
+	}
+
+	writer_append(&writer, "]", 1);
+
+	if(unknown_count > 0){
+		writer_append_text(&writer, ",\"unknownKey\":[");
+
+		first = true;
+		for(size_t i = 0; i < requested_count; i++){
+			const struct ocpp_config_key * entry = ocpp_config_registry_find(registry, requested_keys[i]);
+			if(entry != NULL && ocpp_config_registry_get_value(entry, value_buffer, sizeof(value_buffer)) != NULL)
+				continue;
+
+			if(!first)
+				writer_append(&writer, ",", 1);
+
+			writer_append_json_string(&writer, requested_keys[i]);
+			first = false;
+		}
+
+		writer_append(&writer, "]", 1);
+	}
+
+	writer_append_text(&writer, "}]");
+
+	if(writer.failed){
+		free(writer.buffer);
+		return ESP_ERR_NO_MEM;
+	}
+
+	// Start with a buffer large enough for the largest response so far to avoid growing it again
+	if(writer.size > registry->buffer_size)
+		registry->buffer_size = writer.size;
+
+	*message_out = writer.buffer;
+	*length_out = writer.length;
+
+	return ESP_OK;
+}
+
+cJSON * ocpp_config_registry_to_json(const struct ocpp_config_registry * registry){
+	cJSON * key_list = cJSON_CreateArray();
+	if(key_list == NULL)
+		return NULL;
+
+	char value_buffer[OCPP_CONFIG_VALUE_BUFFER_SIZE];
+
+	for(size_t i = 0; i < registry->key_count; i++){
+		const char * value = ocpp_config_registry_get_value(&registry->keys[i], value_buffer, sizeof(value_buffer));
+		if(value == NULL)
+			continue;
+
+		cJSON * key_value = cJSON_CreateObject();
+		if(key_value == NULL)
+			break;
+
+		cJSON_AddStringToObject(key_value, "key", registry->keys[i].key);
+		cJSON_AddBoolToObject(key_value, "readonly", registry->keys[i].read_only);
+		cJSON_AddStringToObject(key_value, "value", value);
+		cJSON_AddItemToArray(key_list, key_value);
+	}
+
+	return key_list;
+}
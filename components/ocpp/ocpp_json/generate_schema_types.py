@@ -0,0 +1,342 @@
+#!/usr/bin/env python3
+"""
+Generates C structs and schema descriptors for the OCPP 1.6 JSON schemas.
+
+The output is used by ocppj_schema.c to validate and read payloads into the structs in a single walk of the cJSON tree,
+and to write the structs directly as JSON text. The generated files are committed so that the firmware build does not
+depend on this script. Run it again if the schemas or the type names below change:
+
+    python3 components/ocpp/ocpp_json/generate_schema_types.py
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+COMPONENT_DIR = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+DEFAULT_SCHEMA_DIR = os.path.normpath(os.path.join(COMPONENT_DIR, '..', '..', 'docs', 'ocpp', 'schemas', 'json'))
+DEFAULT_HEADER = os.path.join(COMPONENT_DIR, 'include', 'ocpp_json', 'ocppj_schema_types.h')
+DEFAULT_SOURCE = os.path.join(COMPONENT_DIR, 'ocpp_json', 'ocppj_schema_types.c')
+
+# Nested objects that are OCPP types used by several messages are named after the type in the specification instead of
+# the property. Objects with the same name and structure share a single struct and descriptor.
+TYPE_NAMES = {
+    'csChargingProfiles': 'charging_profile',
+    'chargingProfile': 'charging_profile',
+    'chargingSchedule': 'charging_schedule',
+    'chargingSchedulePeriod': 'charging_schedule_period',
+    'idTagInfo': 'id_tag_info',
+    'meterValue': 'meter_value',
+    'transactionData': 'meter_value',
+    'sampledValue': 'sampled_value',
+    'configurationKey': 'key_value',
+    'localAuthorizationList': 'authorization_data',
+}
+
+MAX_FIELDS = 32 # Limited by the presence bits in uint32_t present
+
+def snake_case(name):
+    name = re.sub(r'([a-z0-9])([A-Z])', r'\1_\2', name)
+    name = re.sub(r'([A-Z]+)([A-Z][a-z])', r'\1_\2', name)
+    return name.lower()
+
+def signature(schema):
+    return json.dumps(schema, sort_keys=True)
+
+class Field:
+    def __init__(self, name, kind, required, schema):
+        self.name = name
+        self.member = snake_case(name)
+        self.kind = kind
+        self.required = required
+        self.max_length = schema.get('maxLength', 0)
+        self.one_decimal = schema.get('multipleOf') == 0.1
+        self.values = schema.get('enum')
+        self.object = None # Object for object fields and for arrays of objects
+        self.items = None # Field describing the items of an array
+
+class Object:
+    def __init__(self, name, description):
+        self.name = name
+        self.description = description
+        self.fields = []
+
+class Generator:
+    def __init__(self):
+        self.objects = [] # In dependency order
+        self.by_name = {}
+        self.enums = {} # tuple of values -> C name
+
+    def object_name(self, message, property_name):
+        return TYPE_NAMES.get(property_name, message + '_' + snake_case(property_name))
+
+    def add_object(self, name, schema, message, message_title, description):
+        sig = signature(schema)
+        if name in self.by_name:
+            existing, existing_sig = self.by_name[name]
+            if existing_sig == sig:
+                return existing
+            name = message + '_' + name
+            if name in self.by_name:
+                return self.by_name[name][0]
+
+        obj = Object(name, description)
+        required = schema.get('required', [])
+
+        for property_name, property_schema in schema.get('properties', {}).items():
+            obj.fields.append(self.make_field(property_name, property_schema, property_name in required, message, message_title))
+
+        if len(obj.fields) > MAX_FIELDS:
+            sys.exit('Object %s has more than %d fields' % (name, MAX_FIELDS))
+
+        self.by_name[name] = (obj, sig)
+        self.objects.append(obj)
+        return obj
+
+    def make_field(self, name, schema, required, message, message_title, item_of = None):
+        kind = schema['type']
+        field = None
+
+        if kind == 'integer':
+            field = Field(name, 'INTEGER', required, schema)
+        elif kind == 'number':
+            field = Field(name, 'DECIMAL', required, schema)
+        elif kind == 'boolean':
+            field = Field(name, 'BOOLEAN', required, schema)
+        elif kind == 'string':
+            if 'enum' in schema:
+                field = Field(name, 'ENUM', required, schema)
+                self.add_enum(field, message)
+            elif schema.get('format') == 'date-time':
+                field = Field(name, 'DATE_TIME', required, schema)
+            else:
+                field = Field(name, 'STRING', required, schema)
+        elif kind == 'object':
+            field = Field(name, 'OBJECT', required, schema)
+            property_name = item_of or name
+            if property_name in TYPE_NAMES:
+                description = ''.join(part.capitalize() for part in TYPE_NAMES[property_name].split('_'))
+            else:
+                description = '%s of %s' % (property_name, message_title)
+            field.object = self.add_object(self.object_name(message, property_name), schema, message, message_title, description)
+        elif kind == 'array':
+            field = Field(name, 'ARRAY', required, schema)
+            field.items = self.make_field(name, schema['items'], True, message, message_title, item_of = name)
+            if field.items.kind == 'ARRAY':
+                sys.exit('Nested arrays are not supported: %s' % name)
+        else:
+            sys.exit('Unsupported type %s for %s' % (kind, name))
+
+        return field
+
+    def add_enum(self, field, message):
+        key = tuple(field.values)
+        if key not in self.enums:
+            # Value lists shared by several messages, like Accepted and Rejected, are named after their values
+            c_name = '%s_values' % snake_case(field.name)
+            if c_name in self.enums.values():
+                by_values = '_'.join(re.sub(r'[^a-z0-9]+', '_', snake_case(v)) for v in field.values)
+                if len(by_values) <= 40:
+                    c_name = '%s_values' % by_values
+                else:
+                    c_name = '%s_%s_values' % (message, snake_case(field.name))
+            self.enums[key] = c_name
+
+        field.enum_name = self.enums[key]
+
+C_TYPES = {
+    'INTEGER': 'int',
+    'DECIMAL': 'double',
+    'BOOLEAN': 'bool',
+    'STRING': 'const char *',
+    'ENUM': 'const char *',
+    'DATE_TIME': 'time_t',
+}
+
+def element_type(field):
+    if field.kind == 'OBJECT':
+        return 'struct ocppj_%s' % field.object.name
+    return C_TYPES[field.kind]
+
+def member(c_type, name):
+    return '%s %s' % (c_type, name)
+
+def field_comment(field):
+    text = 'Required.' if field.required else 'Optional.'
+    item = field.items if field.kind == 'ARRAY' else field
+
+    if item.kind == 'STRING' and item.max_length:
+        text += ' At most %d characters.' % item.max_length
+    elif item.kind == 'ENUM':
+        text += ' One of ' + ', '.join('"%s"' % v for v in item.values) + '.'
+    elif item.kind == 'DATE_TIME':
+        text += ' dateTime.'
+
+    if item.one_decimal:
+        text += ' At most one digit fraction.'
+
+    return text
+
+def write_header(generator, path):
+    out = []
+    out.append('/* Generated by ocpp_json/generate_schema_types.py from the OCPP 1.6 JSON schemas. Do not edit. */')
+    out.append('#ifndef OCPPJ_SCHEMA_TYPES_H')
+    out.append('#define OCPPJ_SCHEMA_TYPES_H')
+    out.append('')
+    out.append('#include <stdint.h>')
+    out.append('#include <stdbool.h>')
+    out.append('#include <stddef.h>')
+    out.append('#include <time.h>')
+    out.append('')
+    out.append('#include "ocpp_json/ocppj_schema.h"')
+    out.append('')
+    out.append('/** @file')
+    out.append(' * @brief Structs and schema descriptors for the payload of each OCPP 1.6 message.')
+    out.append(' *')
+    out.append(' * @details Each struct starts with a bit mask of the fields present in the payload, see the OCPPJ_*_HAS_* defines.')
+    out.append(' * Strings point into the parsed cJSON payload and enum values point to constant strings in the schema.')
+    out.append(' */')
+    out.append('')
+
+    for obj in generator.objects:
+        macro_prefix = 'OCPPJ_%s_HAS_' % obj.name.upper()
+
+        out.append('/**')
+        out.append(' * @brief %s' % obj.description)
+        out.append(' */')
+        out.append('struct ocppj_%s{' % obj.name)
+        out.append('\tuint32_t present; ///< Bit mask of fields present')
+
+        for field in obj.fields:
+            if field.kind == 'ARRAY':
+                out.append('\tsize_t %s_count; ///< Number of items in %s' % (field.member, field.member))
+                out.append('\t%s; ///< %s' % (member(element_type(field.items) + ' *', field.member), field_comment(field)))
+            else:
+                out.append('\t%s; ///< %s' % (member(element_type(field), field.member), field_comment(field)))
+
+        out.append('};')
+        out.append('')
+
+        if obj.fields:
+            for index, field in enumerate(obj.fields):
+                out.append('#define %s%s (1u << %d)' % (macro_prefix, field.member.upper(), index))
+            out.append('')
+
+        out.append('extern const struct ocppj_schema_object ocppj_%s_schema; ///< Descriptor of struct ocppj_%s' % (obj.name, obj.name))
+        out.append('')
+
+    out.append('#endif /*OCPPJ_SCHEMA_TYPES_H*/')
+    out.append('')
+
+    with open(path, 'w') as f:
+        f.write('\n'.join(out))
+
+def field_initializer(obj_name, field, indent, is_item = False):
+    struct = 'struct ocppj_%s' % obj_name
+    lines = []
+    lines.append('%s.name = "%s",' % (indent, field.name))
+    lines.append('%s.type = eOCPPJ_SCHEMA_%s,' % (indent, field.kind))
+
+    if field.required and not is_item:
+        lines.append('%s.required = true,' % indent)
+
+    if not is_item:
+        lines.append('%s.offset = offsetof(%s, %s),' % (indent, struct, field.member))
+
+    if field.max_length:
+        lines.append('%s.max_length = %d,' % (indent, field.max_length))
+
+    if field.one_decimal:
+        lines.append('%s.one_decimal = true,' % indent)
+
+    if field.kind == 'ENUM':
+        lines.append('%s.values = %s,' % (indent, field.enum_name))
+        lines.append('%s.value_count = %d,' % (indent, len(field.values)))
+
+    if field.kind == 'OBJECT':
+        lines.append('%s.object = &ocppj_%s_schema,' % (indent, field.object.name))
+
+    if field.kind == 'ARRAY':
+        lines.append('%s.count_offset = offsetof(%s, %s_count),' % (indent, struct, field.member))
+        lines.append('%s.items = &%s_%s_items,' % (indent, obj_name, field.member))
+
+    return lines
+
+def write_source(generator, path):
+    out = []
+    out.append('/* Generated by ocpp_json/generate_schema_types.py from the OCPP 1.6 JSON schemas. Do not edit. */')
+    out.append('#include <stddef.h>')
+    out.append('')
+    out.append('#include "ocpp_json/ocppj_schema_types.h"')
+    out.append('')
+
+    for values, name in generator.enums.items():
+        out.append('static const char * const %s[] = {%s};' % (name, ', '.join('"%s"' % v for v in values)))
+    out.append('')
+
+    for obj in generator.objects:
+        for field in obj.fields:
+            if field.kind != 'ARRAY':
+                continue
+
+            out.append('static const struct ocppj_schema_field %s_%s_items = {' % (obj.name, field.member))
+            out.extend(field_initializer(obj.name, field.items, '\t', is_item = True))
+            out.append('};')
+            out.append('')
+
+        if obj.fields:
+            out.append('static const struct ocppj_schema_field %s_fields[] = {' % obj.name)
+            for field in obj.fields:
+                out.append('\t{')
+                out.extend(field_initializer(obj.name, field, '\t\t'))
+                out.append('\t},')
+            out.append('};')
+            out.append('')
+
+        out.append('const struct ocppj_schema_object ocppj_%s_schema = {' % obj.name)
+        out.append('\t.name = "%s",' % obj.description)
+        if obj.fields:
+            out.append('\t.fields = %s_fields,' % obj.name)
+        out.append('\t.field_count = %d,' % len(obj.fields))
+        out.append('\t.size = sizeof(struct ocppj_%s),' % obj.name)
+        out.append('};')
+        out.append('')
+
+    with open(path, 'w') as f:
+        f.write('\n'.join(out))
+
+def main():
+    parser = argparse.ArgumentParser(description = __doc__, formatter_class = argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--schemas', default = DEFAULT_SCHEMA_DIR, help = 'directory with the OCPP 1.6 JSON schemas')
+    parser.add_argument('--header', default = DEFAULT_HEADER)
+    parser.add_argument('--source', default = DEFAULT_SOURCE)
+    args = parser.parse_args()
+
+    generator = Generator()
+
+    for file_name in sorted(os.listdir(args.schemas)):
+        if not file_name.endswith('.json'):
+            continue
+
+        with open(os.path.join(args.schemas, file_name)) as f:
+            schema = json.load(f)
+
+        title = schema['title']
+        if title.endswith('Request'):
+            action, suffix = title[:-len('Request')], 'req'
+        elif title.endswith('Response'):
+            action, suffix = title[:-len('Response')], 'conf'
+        else:
+            sys.exit('Unexpected schema title: ' + title)
+
+        name = '%s_%s' % (snake_case(action), suffix)
+        message_title = '%s.%s' % (action, suffix)
+        generator.add_object(name, schema, snake_case(action), message_title, message_title + ' payload')
+
+    write_header(generator, args.header)
+    write_source(generator, args.source)
+
+if __name__ == '__main__':
+    main()
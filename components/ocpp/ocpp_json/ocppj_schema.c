@@ -0,0 +1,633 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+
+#include "esp_log.h"
+
+#include "ocpp_json/ocppj_schema.h"
+#include "types/ocpp_date_time.h"
+
+static const char * TAG = "OCPPJ_SCHEMA";
+
+#define PRESENT(value) (*(uint32_t *)(value))
+#define MEMBER(value, offset) ((void *)((char *)(value) + (offset)))
+#define CONST_MEMBER(value, offset) ((const void *)((const char *)(value) + (offset)))
+
+static size_t item_size(const struct ocppj_schema_field * field){
+	switch(field->type){
+	case eOCPPJ_SCHEMA_INTEGER:
+		return sizeof(int);
+	case eOCPPJ_SCHEMA_DECIMAL:
+		return sizeof(double);
+	case eOCPPJ_SCHEMA_BOOLEAN:
+		return sizeof(bool);
+	case eOCPPJ_SCHEMA_STRING:
+	case eOCPPJ_SCHEMA_ENUM:
+		return sizeof(const char *);
+	case eOCPPJ_SCHEMA_DATE_TIME:
+		return sizeof(time_t);
+	case eOCPPJ_SCHEMA_OBJECT:
+		return field->object->size;
+	default:
+		return 0;
+	}
+}
+
+static int find_field(const struct ocppj_schema_object * schema, const char * name){
+	if(name == NULL)
+		return -1;
+
+	for(int i = 0; i < schema->field_count; i++){
+		if(schema->fields[i].name[0] == name[0] && strcmp(schema->fields[i].name, name) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+static bool is_one_decimal(double value){
+	double tenths = value * 10;
+	return fabs(tenths - round(tenths)) < 1e-6;
+}
+
+static enum ocppj_err_t read_object(const struct ocppj_schema_object * schema, const cJSON * json, void * value_out,
+				const char * name, char * error_description_out, size_t error_description_length);
+
+static enum ocppj_err_t read_value(const struct ocppj_schema_field * field, const cJSON * json, void * value_out,
+				char * error_description_out, size_t error_description_length){
+	switch(field->type){
+	case eOCPPJ_SCHEMA_INTEGER:
+		// cJSON stores numbers as both integer and double. The double is checked to reject decimals and overflow
+		if(!cJSON_IsNumber(json) || json->valuedouble < INT_MIN || json->valuedouble > INT_MAX
+			|| json->valuedouble != round(json->valuedouble)){
+
+			snprintf(error_description_out, error_description_length, "Expected '%s' to be integer", field->name);
+			return eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
+		}
+
+		*(int *)value_out = (int)json->valuedouble;
+		return eOCPPJ_NO_ERROR;
+
+	case eOCPPJ_SCHEMA_DECIMAL:
+		if(!cJSON_IsNumber(json)){
+			snprintf(error_description_out, error_description_length, "Expected '%s' to be decimal", field->name);
+			return eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
+		}
+
+		if(field->one_decimal && !is_one_decimal(json->valuedouble)){
+			snprintf(error_description_out, error_description_length, "Expected '%s' to have at most one digit fraction", field->name);
+			return eOCPPJ_ERROR_PROPERTY_CONSTRAINT_VIOLATION;
+		}
+
+		*(double *)value_out = json->valuedouble;
+		return eOCPPJ_NO_ERROR;
+
+	case eOCPPJ_SCHEMA_BOOLEAN:
+		if(!cJSON_IsBool(json)){
+			snprintf(error_description_out, error_description_length, "Expected '%s' to be boolean", field->name);
+			return eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
+		}
+
+		*(bool *)value_out = cJSON_IsTrue(json);
+		return eOCPPJ_NO_ERROR;
+
+	case eOCPPJ_SCHEMA_STRING:
+		if(!cJSON_IsString(json) || json->valuestring == NULL){
+			snprintf(error_description_out, error_description_length, "Expected '%s' to be string type", field->name);
+			return eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
+		}
+
+		if(field->max_length != 0 && strnlen(json->valuestring, field->max_length + 1) > field->max_length){
+			snprintf(error_description_out, error_description_length, "Expected '%s' to be CiString%dType", field->name, field->max_length);
+			return eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
+		}
+
+		*(const char **)value_out = json->valuestring;
+		return eOCPPJ_NO_ERROR;
+
+	case eOCPPJ_SCHEMA_ENUM:
+		if(cJSON_IsString(json) && json->valuestring != NULL){
+			for(size_t i = 0; i < field->value_count; i++){
+				if(strcmp(field->values[i], json->valuestring) == 0){
+					*(const char **)value_out = field->values[i];
+					return eOCPPJ_NO_ERROR;
+				}
+			}
+		}
+
+		snprintf(error_description_out, error_description_length, "Expected '%s' to be a valid enum value", field->name);
+		return eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
+
+	case eOCPPJ_SCHEMA_DATE_TIME:
+		if(!cJSON_IsString(json) || json->valuestring == NULL){
+			snprintf(error_description_out, error_description_length, "Expected '%s' to be dateTime", field->name);
+			return eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
+		}
+
+		*(time_t *)value_out = ocpp_parse_date_time(json->valuestring);
+		if(*(time_t *)value_out == (time_t)-1){
+			snprintf(error_description_out, error_description_length, "'%s' is not a recognised dateTime", field->name);
+			return eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
+		}
+
+		return eOCPPJ_NO_ERROR;
+
+	case eOCPPJ_SCHEMA_OBJECT:
+		return read_object(field->object, json, value_out, field->name, error_description_out, error_description_length);
+
+	case eOCPPJ_SCHEMA_ARRAY:
+	default:
+		snprintf(error_description_out, error_description_length, "Unsupported schema type for '%s'", field->name);
+		return eOCPPJ_ERROR_INTERNAL;
+	}
+}
+
+static enum ocppj_err_t read_array(const struct ocppj_schema_field * field, const cJSON * json, void * value_out,
+				char * error_description_out, size_t error_description_length){
+	if(!cJSON_IsArray(json)){
+		snprintf(error_description_out, error_description_length, "Expected '%s' to be array type", field->name);
+		return eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
+	}
+
+	size_t size = item_size(field->items);
+	size_t count = cJSON_GetArraySize(json);
+
+	if(size == 0){
+		snprintf(error_description_out, error_description_length, "Unsupported schema type for '%s' items", field->name);
+		return eOCPPJ_ERROR_INTERNAL;
+	}
+
+	if(count == 0)
+		return eOCPPJ_NO_ERROR;
+
+	/*
+	 * The items are stored before they are read so that ocppj_schema_free can release them and anything allocated by
+	 * nested arrays if a later item is invalid.
+	 */
+	char * items = calloc(count, size);
+	if(items == NULL){
+		snprintf(error_description_out, error_description_length, "Unable to allocate memory for '%s'", field->name);
+		return eOCPPJ_ERROR_INTERNAL;
+	}
+
+	*(void **)MEMBER(value_out, field->offset) = items;
+	*(size_t *)MEMBER(value_out, field->count_offset) = count;
+
+	const cJSON * item_json = json->child;
+	for(size_t i = 0; i < count && item_json != NULL; i++, item_json = item_json->next){
+		enum ocppj_err_t err = read_value(field->items, item_json, items + i * size, error_description_out, error_description_length);
+		if(err != eOCPPJ_NO_ERROR)
+			return err;
+	}
+
+	return eOCPPJ_NO_ERROR;
+}
+
+static enum ocppj_err_t read_object(const struct ocppj_schema_object * schema, const cJSON * json, void * value_out,
+				const char * name, char * error_description_out, size_t error_description_length){
+	if(!cJSON_IsObject(json)){
+		snprintf(error_description_out, error_description_length, "Expected '%s' to be object type", name);
+		return eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
+	}
+
+	uint32_t present = 0;
+
+	for(const cJSON * property = json->child; property != NULL; property = property->next){
+		int index = find_field(schema, property->string);
+		if(index < 0)
+			continue;
+
+		const struct ocppj_schema_field * field = &schema->fields[index];
+
+		if(present & (1u << index)){
+			snprintf(error_description_out, error_description_length, "Expected '%s' only once", field->name);
+			return eOCPPJ_ERROR_OCCURENCE_CONSTRAINT_VIOLATION;
+		}
+
+		enum ocppj_err_t err;
+		if(field->type == eOCPPJ_SCHEMA_ARRAY){
+			err = read_array(field, property, value_out, error_description_out, error_description_length);
+		}else{
+			err = read_value(field, property, MEMBER(value_out, field->offset), error_description_out, error_description_length);
+		}
+
+		if(err != eOCPPJ_NO_ERROR)
+			return err;
+
+		present |= (1u << index);
+		PRESENT(value_out) = present;
+	}
+
+	for(int i = 0; i < schema->field_count; i++){
+		if(schema->fields[i].required && !(present & (1u << i))){
+			snprintf(error_description_out, error_description_length, "Expected '%s' field", schema->fields[i].name);
+			return eOCPPJ_ERROR_FORMATION_VIOLATION;
+		}
+	}
+
+	return eOCPPJ_NO_ERROR;
+}
+
+enum ocppj_err_t ocppj_schema_read(const struct ocppj_schema_object * schema, const cJSON * payload, void * value_out,
+				char * error_description_out, size_t error_description_length){
+
+	memset(value_out, 0, schema->size);
+
+	enum ocppj_err_t err = read_object(schema, payload, value_out, schema->name, error_description_out, error_description_length);
+	if(err != eOCPPJ_NO_ERROR)
+		ocppj_schema_free(schema, value_out);
+
+	return err;
+}
+
+void ocppj_schema_free(const struct ocppj_schema_object * schema, void * value){
+	if(value == NULL)
+		return;
+
+	for(size_t i = 0; i < schema->field_count; i++){
+		const struct ocppj_schema_field * field = &schema->fields[i];
+
+		if(field->type == eOCPPJ_SCHEMA_OBJECT){
+			ocppj_schema_free(field->object, MEMBER(value, field->offset));
+
+		}else if(field->type == eOCPPJ_SCHEMA_ARRAY){
+			char ** items = MEMBER(value, field->offset);
+			size_t * count = MEMBER(value, field->count_offset);
+
+			if(*items != NULL && field->items->type == eOCPPJ_SCHEMA_OBJECT){
+				for(size_t j = 0; j < *count; j++)
+					ocppj_schema_free(field->items->object, *items + j * field->items->object->size);
+			}
+
+			free(*items);
+			*items = NULL;
+			*count = 0;
+		}
+	}
+}
+
+/*
+ * Writes as much of the text as fits in the buffer and counts the full length, like snprintf. A value that does not
+ * conform to the schema marks the writer as invalid.
+ */
+struct schema_writer{
+	char * buffer;
+	size_t size;
+	size_t length;
+	bool invalid;
+};
+
+static void writer_append(struct schema_writer * writer, const char * data, size_t length){
+	if(writer->length < writer->size){
+		size_t available = writer->size - writer->length - 1;
+		memcpy(writer->buffer + writer->length, data, length < available ? length : available);
+	}
+
+	writer->length += length;
+}
+
+static void writer_append_text(struct schema_writer * writer, const char * text){
+	writer_append(writer, text, strlen(text));
+}
+
+static void writer_append_json_string(struct schema_writer * writer, const char * value){
+	writer_append(writer, "\"", 1);
+
+	const char * run_start = value;
+	for(const char * c = value; *c != '\0'; c++){
+		unsigned char character = *c;
+		if(character != '"' && character != '\\' && character >= 0x20)
+			continue;
+
+		writer_append(writer, run_start, c - run_start);
+		run_start = c + 1;
+
+		char escaped[8];
+		switch(character){
+		case '"':
+			writer_append(writer, "\\\"", 2);
+			break;
+		case '\\':
+			writer_append(writer, "\\\\", 2);
+			break;
+		case '\n':
+			writer_append(writer, "\\n", 2);
+			break;
+		case '\r':
+			writer_append(writer, "\\r", 2);
+			break;
+		case '\t':
+			writer_append(writer, "\\t", 2);
+			break;
+		default:
+			snprintf(escaped, sizeof(escaped), "\\u%04x", character);
+			writer_append(writer, escaped, 6);
+		}
+	}
+
+	writer_append(writer, run_start, strlen(run_start));
+	writer_append(writer, "\"", 1);
+}
+
+static bool enum_contains(const struct ocppj_schema_field * field, const char * value){
+	for(size_t i = 0; i < field->value_count; i++){
+		if(field->values[i] == value || strcmp(field->values[i], value) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+static int format_decimal(const struct ocppj_schema_field * field, double value, char * buffer, size_t buffer_size){
+	if(!isfinite(value))
+		return -1;
+
+	if(field->one_decimal)
+		return snprintf(buffer, buffer_size, "%.1f", value);
+
+	// Same as cJSON: use the shortest of 15 or 17 significant digits that gives the same value when parsed
+	int length = snprintf(buffer, buffer_size, "%1.15g", value);
+	if(strtod(buffer, NULL) != value)
+		length = snprintf(buffer, buffer_size, "%1.17g", value);
+
+	return length;
+}
+
+static void write_object(struct schema_writer * writer, const struct ocppj_schema_object * schema, const void * value);
+
+static void write_value(struct schema_writer * writer, const struct ocppj_schema_field * field, const void * value){
+	char buffer[32];
+	const char * text;
+	int length;
+
+	switch(field->type){
+	case eOCPPJ_SCHEMA_INTEGER:
+		length = snprintf(buffer, sizeof(buffer), "%d", *(const int *)value);
+		writer_append(writer, buffer, length);
+		break;
+
+	case eOCPPJ_SCHEMA_DECIMAL:
+		length = format_decimal(field, *(const double *)value, buffer, sizeof(buffer));
+		if(length < 0 || (size_t)length >= sizeof(buffer)){
+			writer->invalid = true;
+		}else{
+			writer_append(writer, buffer, length);
+		}
+		break;
+
+	case eOCPPJ_SCHEMA_BOOLEAN:
+		writer_append_text(writer, *(const bool *)value ? "true" : "false");
+		break;
+
+	case eOCPPJ_SCHEMA_STRING:
+	case eOCPPJ_SCHEMA_ENUM:
+		text = *(const char * const *)value;
+		if(text == NULL
+			|| (field->type == eOCPPJ_SCHEMA_STRING && field->max_length != 0 && strlen(text) > field->max_length)
+			|| (field->type == eOCPPJ_SCHEMA_ENUM && !enum_contains(field, text))){
+
+			writer->invalid = true;
+		}else{
+			writer_append_json_string(writer, text);
+		}
+		break;
+
+	case eOCPPJ_SCHEMA_DATE_TIME:
+		length = ocpp_print_date_time(*(const time_t *)value, buffer, sizeof(buffer));
+		if(length <= 0 || (size_t)length >= sizeof(buffer)){
+			writer->invalid = true;
+		}else{
+			writer_append(writer, "\"", 1);
+			writer_append(writer, buffer, length);
+			writer_append(writer, "\"", 1);
+		}
+		break;
+
+	case eOCPPJ_SCHEMA_OBJECT:
+		write_object(writer, field->object, value);
+		break;
+
+	case eOCPPJ_SCHEMA_ARRAY:
+	default:
+		writer->invalid = true;
+	}
+}
+
+static void write_object(struct schema_writer * writer, const struct ocppj_schema_object * schema, const void * value){
+	uint32_t present = *(const uint32_t *)value;
+	bool first = true;
+
+	writer_append(writer, "{", 1);
+
+	for(int i = 0; i < schema->field_count && !writer->invalid; i++){
+		const struct ocppj_schema_field * field = &schema->fields[i];
+		if(!field->required && !(present & (1u << i)))
+			continue;
+
+		if(!first)
+			writer_append(writer, ",", 1);
+
+		writer_append_json_string(writer, field->name);
+		writer_append(writer, ":", 1);
+		first = false;
+
+		if(field->type == eOCPPJ_SCHEMA_ARRAY){
+			const char * items = *(const char * const *)CONST_MEMBER(value, field->offset);
+			size_t count = *(const size_t *)CONST_MEMBER(value, field->count_offset);
+			size_t size = item_size(field->items);
+
+			if(count > 0 && (items == NULL || size == 0)){
+				writer->invalid = true;
+				break;
+			}
+
+			writer_append(writer, "[", 1);
+			for(size_t j = 0; j < count && !writer->invalid; j++){
+				if(j > 0)
+					writer_append(writer, ",", 1);
+
+				write_value(writer, field->items, items + j * size);
+			}
+			writer_append(writer, "]", 1);
+
+		}else{
+			write_value(writer, field, CONST_MEMBER(value, field->offset));
+		}
+	}
+
+	writer_append(writer, "}", 1);
+}
+
+int ocppj_schema_write(const struct ocppj_schema_object * schema, const void * value, char * buffer, size_t buffer_size){
+	struct schema_writer writer = {
+		.buffer = buffer,
+		.size = buffer_size,
+	};
+
+	write_object(&writer, schema, value);
+
+	if(buffer_size > 0)
+		buffer[writer.length < buffer_size ? writer.length : buffer_size -1] = '\0';
+
+	if(writer.invalid){
+		ESP_LOGE(TAG, "Value does not conform to '%s'", schema->name);
+		return -1;
+	}
+
+	return writer.length;
+}
+
+static void write_call_result(struct schema_writer * writer, const char * unique_id, const struct ocppj_schema_object * schema,
+			const void * value){
+	char message_type[8];
+	snprintf(message_type, sizeof(message_type), "[%d,", eOCPPJ_MESSAGE_ID_RESULT);
+
+	writer_append_text(writer, message_type);
+	writer_append_json_string(writer, unique_id);
+	writer_append(writer, ",", 1);
+	write_object(writer, schema, value);
+	writer_append(writer, "]", 1);
+}
+
+esp_err_t ocppj_schema_create_call_result_text(const char * unique_id, const struct ocppj_schema_object * schema,
+					const void * value, char ** message_out, size_t * length_out){
+	if(unique_id == NULL)
+		return ESP_ERR_INVALID_ARG;
+
+	// The first pass only measures the message so that it can be written to a buffer of the exact size
+	struct schema_writer writer = {0};
+	write_call_result(&writer, unique_id, schema, value);
+
+	if(writer.invalid){
+		ESP_LOGE(TAG, "Value does not conform to '%s'", schema->name);
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	size_t length = writer.length;
+	char * message = malloc(length + 1);
+	if(message == NULL){
+		ESP_LOGE(TAG, "Unable to allocate %zu bytes for '%s'", length + 1, schema->name);
+		return ESP_ERR_NO_MEM;
+	}
+
+	writer = (struct schema_writer){
+		.buffer = message,
+		.size = length + 1,
+	};
+
+	write_call_result(&writer, unique_id, schema, value);
+	message[length] = '\0';
+
+	*message_out = message;
+	*length_out = length;
+
+	return ESP_OK;
+}
+
+static cJSON * object_to_json(const struct ocppj_schema_object * schema, const void * value);
+
+static cJSON * value_to_json(const struct ocppj_schema_field * field, const void * value){
+	char buffer[32];
+	const char * text;
+
+	switch(field->type){
+	case eOCPPJ_SCHEMA_INTEGER:
+		return cJSON_CreateNumber(*(const int *)value);
+
+	case eOCPPJ_SCHEMA_DECIMAL:
+		if(!isfinite(*(const double *)value))
+			return NULL;
+
+		// Decimals with one digit fraction are rounded when written as text. The same is done for cJSON.
+		return cJSON_CreateNumber(field->one_decimal ? round(*(const double *)value * 10) / 10 : *(const double *)value);
+
+	case eOCPPJ_SCHEMA_BOOLEAN:
+		return cJSON_CreateBool(*(const bool *)value);
+
+	case eOCPPJ_SCHEMA_STRING:
+	case eOCPPJ_SCHEMA_ENUM:
+		text = *(const char * const *)value;
+		if(text == NULL
+			|| (field->type == eOCPPJ_SCHEMA_STRING && field->max_length != 0 && strlen(text) > field->max_length)
+			|| (field->type == eOCPPJ_SCHEMA_ENUM && !enum_contains(field, text))){
+			return NULL;
+		}
+
+		return cJSON_CreateString(text);
+
+	case eOCPPJ_SCHEMA_DATE_TIME:
+		if(ocpp_print_date_time(*(const time_t *)value, buffer, sizeof(buffer)) <= 0)
+			return NULL;
+
+		return cJSON_CreateString(buffer);
+
+	case eOCPPJ_SCHEMA_OBJECT:
+		return object_to_json(field->object, value);
+
+	case eOCPPJ_SCHEMA_ARRAY:
+	default:
+		return NULL;
+	}
+}
+
+static cJSON * object_to_json(const struct ocppj_schema_object * schema, const void * value){
+	uint32_t present = *(const uint32_t *)value;
+
+	cJSON * result = cJSON_CreateObject();
+	if(result == NULL)
+		return NULL;
+
+	for(int i = 0; i < schema->field_count; i++){
+		const struct ocppj_schema_field * field = &schema->fields[i];
+		if(!field->required && !(present & (1u << i)))
+			continue;
+
+		cJSON * field_json;
+		if(field->type == eOCPPJ_SCHEMA_ARRAY){
+			const char * items = *(const char * const *)CONST_MEMBER(value, field->offset);
+			size_t count = *(const size_t *)CONST_MEMBER(value, field->count_offset);
+			size_t size = item_size(field->items);
+
+			if(count > 0 && (items == NULL || size == 0))
+				goto error;
+
+			field_json = cJSON_CreateArray();
+			if(field_json == NULL)
+				goto error;
+
+			cJSON_AddItemToObject(result, field->name, field_json);
+
+			for(size_t j = 0; j < count; j++){
+				cJSON * item_json = value_to_json(field->items, items + j * size);
+				if(item_json == NULL)
+					goto error;
+
+				cJSON_AddItemToArray(field_json, item_json);
+			}
+
+		}else{
+			field_json = value_to_json(field, CONST_MEMBER(value, field->offset));
+			if(field_json == NULL)
+				goto error;
+
+			cJSON_AddItemToObject(result, field->name, field_json);
+		}
+	}
+
+	return result;
+
+error:
+	cJSON_Delete(result);
+	return NULL;
+}
+
+cJSON * ocppj_schema_to_json(const struct ocppj_schema_object * schema, const void * value){
+	cJSON * result = object_to_json(schema, value);
+	if(result == NULL)
+		ESP_LOGE(TAG, "Unable to create JSON for '%s'", schema->name);
+
+	return result;
+}
@@ -0,0 +1,1695 @@
+/* Generated by ocpp_json/generate_schema_types.py from the OCPP 1.6 JSON schemas. Do not edit. */
+#include <stddef.h>
+
+#include "ocpp_json/ocppj_schema_types.h"
+
+static const char * const status_values[] = {"Accepted", "Blocked", "Expired", "Invalid", "ConcurrentTx"};
+static const char * const accepted_pending_rejected_values[] = {"Accepted", "Pending", "Rejected"};
+static const char * const accepted_rejected_values[] = {"Accepted", "Rejected"};
+static const char * const type_values[] = {"Inoperative", "Operative"};
+static const char * const accepted_rejected_scheduled_values[] = {"Accepted", "Rejected", "Scheduled"};
+static const char * const change_configuration_status_values[] = {"Accepted", "Rejected", "RebootRequired", "NotSupported"};
+static const char * const charging_profile_purpose_values[] = {"ChargePointMaxProfile", "TxDefaultProfile", "TxProfile"};
+static const char * const accepted_unknown_values[] = {"Accepted", "Unknown"};
+static const char * const data_transfer_status_values[] = {"Accepted", "Rejected", "UnknownMessageId", "UnknownVendorId"};
+static const char * const idle_uploaded_upload_failed_uploading_values[] = {"Idle", "Uploaded", "UploadFailed", "Uploading"};
+static const char * const firmware_status_notification_status_values[] = {"Downloaded", "DownloadFailed", "Downloading", "Idle", "InstallationFailed", "Installing", "Installed"};
+static const char * const charging_rate_unit_values[] = {"A", "W"};
+static const char * const context_values[] = {"Interruption.Begin", "Interruption.End", "Sample.Clock", "Sample.Periodic", "Transaction.Begin", "Transaction.End", "Trigger", "Other"};
+static const char * const format_values[] = {"Raw", "SignedData"};
+static const char * const measurand_values[] = {"Energy.Active.Export.Register", "Energy.Active.Import.Register", "Energy.Reactive.Export.Register", "Energy.Reactive.Import.Register", "Energy.Active.Export.Interval", "Energy.Active.Import.Interval", "Energy.Reactive.Export.Interval", "Energy.Reactive.Import.Interval", "Power.Active.Export", "Power.Active.Import", "Power.Offered", "Power.Reactive.Export", "Power.Reactive.Import", "Power.Factor", "Current.Import", "Current.Export", "Current.Offered", "Voltage", "Frequency", "Temperature", "SoC", "RPM"};
+static const char * const phase_values[] = {"L1", "L2", "L3", "N", "L1-N", "L2-N", "L3-N", "L1-L2", "L2-L3", "L3-L1"};
+static const char * const location_values[] = {"Cable", "EV", "Inlet", "Outlet", "Body"};
+static const char * const unit_values[] = {"Wh", "kWh", "varh", "kvarh", "W", "kW", "VA", "kVA", "var", "kvar", "A", "V", "K", "Celcius", "Celsius", "Fahrenheit", "Percent"};
+static const char * const charging_profile_kind_values[] = {"Absolute", "Recurring", "Relative"};
+static const char * const recurrency_kind_values[] = {"Daily", "Weekly"};
+static const char * const reserve_now_status_values[] = {"Accepted", "Faulted", "Occupied", "Rejected", "Unavailable"};
+static const char * const hard_soft_values[] = {"Hard", "Soft"};
+static const char * const update_type_values[] = {"Differential", "Full"};
+static const char * const send_local_list_status_values[] = {"Accepted", "Failed", "NotSupported", "VersionMismatch"};
+static const char * const accepted_rejected_not_supported_values[] = {"Accepted", "Rejected", "NotSupported"};
+static const char * const error_code_values[] = {"ConnectorLockFailure", "EVCommunicationError", "GroundFailure", "HighTemperature", "InternalError", "LocalListConflict", "NoError", "OtherError", "OverCurrentFailure", "PowerMeterFailure", "PowerSwitchFailure", "ReaderFailure", "ResetFailure", "UnderVoltage", "OverVoltage", "WeakSignal"};
+static const char * const status_notification_status_values[] = {"Available", "Preparing", "Charging", "SuspendedEVSE", "SuspendedEV", "Finishing", "Reserved", "Unavailable", "Faulted"};
+static const char * const reason_values[] = {"EmergencyStop", "EVDisconnected", "HardReset", "Local", "Other", "PowerLoss", "Reboot", "Remote", "SoftReset", "UnlockCommand", "DeAuthorized"};
+static const char * const stop_transaction_unit_values[] = {"Wh", "kWh", "varh", "kvarh", "W", "kW", "VA", "kVA", "var", "kvar", "A", "V", "K", "Celcius", "Fahrenheit", "Percent"};
+static const char * const requested_message_values[] = {"BootNotification", "DiagnosticsStatusNotification", "FirmwareStatusNotification", "Heartbeat", "MeterValues", "StatusNotification"};
+static const char * const accepted_rejected_not_implemented_values[] = {"Accepted", "Rejected", "NotImplemented"};
+static const char * const unlocked_unlock_failed_not_supported_values[] = {"Unlocked", "UnlockFailed", "NotSupported"};
+
+static const struct ocppj_schema_field authorize_req_fields[] = {
+	{
+		.name = "idTag",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.required = true,
+		.offset = offsetof(struct ocppj_authorize_req, id_tag),
+		.max_length = 20,
+	},
+};
+
+const struct ocppj_schema_object ocppj_authorize_req_schema = {
+	.name = "Authorize.req payload",
+	.fields = authorize_req_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_authorize_req),
+};
+
+static const struct ocppj_schema_field id_tag_info_fields[] = {
+	{
+		.name = "expiryDate",
+		.type = eOCPPJ_SCHEMA_DATE_TIME,
+		.offset = offsetof(struct ocppj_id_tag_info, expiry_date),
+	},
+	{
+		.name = "parentIdTag",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_id_tag_info, parent_id_tag),
+		.max_length = 20,
+	},
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_id_tag_info, status),
+		.values = status_values,
+		.value_count = 5,
+	},
+};
+
+const struct ocppj_schema_object ocppj_id_tag_info_schema = {
+	.name = "IdTagInfo",
+	.fields = id_tag_info_fields,
+	.field_count = 3,
+	.size = sizeof(struct ocppj_id_tag_info),
+};
+
+static const struct ocppj_schema_field authorize_conf_fields[] = {
+	{
+		.name = "idTagInfo",
+		.type = eOCPPJ_SCHEMA_OBJECT,
+		.required = true,
+		.offset = offsetof(struct ocppj_authorize_conf, id_tag_info),
+		.object = &ocppj_id_tag_info_schema,
+	},
+};
+
+const struct ocppj_schema_object ocppj_authorize_conf_schema = {
+	.name = "Authorize.conf payload",
+	.fields = authorize_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_authorize_conf),
+};
+
+static const struct ocppj_schema_field boot_notification_req_fields[] = {
+	{
+		.name = "chargePointVendor",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.required = true,
+		.offset = offsetof(struct ocppj_boot_notification_req, charge_point_vendor),
+		.max_length = 20,
+	},
+	{
+		.name = "chargePointModel",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.required = true,
+		.offset = offsetof(struct ocppj_boot_notification_req, charge_point_model),
+		.max_length = 20,
+	},
+	{
+		.name = "chargePointSerialNumber",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_boot_notification_req, charge_point_serial_number),
+		.max_length = 25,
+	},
+	{
+		.name = "chargeBoxSerialNumber",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_boot_notification_req, charge_box_serial_number),
+		.max_length = 25,
+	},
+	{
+		.name = "firmwareVersion",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_boot_notification_req, firmware_version),
+		.max_length = 50,
+	},
+	{
+		.name = "iccid",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_boot_notification_req, iccid),
+		.max_length = 20,
+	},
+	{
+		.name = "imsi",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_boot_notification_req, imsi),
+		.max_length = 20,
+	},
+	{
+		.name = "meterType",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_boot_notification_req, meter_type),
+		.max_length = 25,
+	},
+	{
+		.name = "meterSerialNumber",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_boot_notification_req, meter_serial_number),
+		.max_length = 25,
+	},
+};
+
+const struct ocppj_schema_object ocppj_boot_notification_req_schema = {
+	.name = "BootNotification.req payload",
+	.fields = boot_notification_req_fields,
+	.field_count = 9,
+	.size = sizeof(struct ocppj_boot_notification_req),
+};
+
+static const struct ocppj_schema_field boot_notification_conf_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_boot_notification_conf, status),
+		.values = accepted_pending_rejected_values,
+		.value_count = 3,
+	},
+	{
+		.name = "currentTime",
+		.type = eOCPPJ_SCHEMA_DATE_TIME,
+		.required = true,
+		.offset = offsetof(struct ocppj_boot_notification_conf, current_time),
+	},
+	{
+		.name = "interval",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_boot_notification_conf, interval),
+	},
+};
+
+const struct ocppj_schema_object ocppj_boot_notification_conf_schema = {
+	.name = "BootNotification.conf payload",
+	.fields = boot_notification_conf_fields,
+	.field_count = 3,
+	.size = sizeof(struct ocppj_boot_notification_conf),
+};
+
+static const struct ocppj_schema_field cancel_reservation_req_fields[] = {
+	{
+		.name = "reservationId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_cancel_reservation_req, reservation_id),
+	},
+};
+
+const struct ocppj_schema_object ocppj_cancel_reservation_req_schema = {
+	.name = "CancelReservation.req payload",
+	.fields = cancel_reservation_req_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_cancel_reservation_req),
+};
+
+static const struct ocppj_schema_field cancel_reservation_conf_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_cancel_reservation_conf, status),
+		.values = accepted_rejected_values,
+		.value_count = 2,
+	},
+};
+
+const struct ocppj_schema_object ocppj_cancel_reservation_conf_schema = {
+	.name = "CancelReservation.conf payload",
+	.fields = cancel_reservation_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_cancel_reservation_conf),
+};
+
+static const struct ocppj_schema_field change_availability_req_fields[] = {
+	{
+		.name = "connectorId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_change_availability_req, connector_id),
+	},
+	{
+		.name = "type",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_change_availability_req, type),
+		.values = type_values,
+		.value_count = 2,
+	},
+};
+
+const struct ocppj_schema_object ocppj_change_availability_req_schema = {
+	.name = "ChangeAvailability.req payload",
+	.fields = change_availability_req_fields,
+	.field_count = 2,
+	.size = sizeof(struct ocppj_change_availability_req),
+};
+
+static const struct ocppj_schema_field change_availability_conf_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_change_availability_conf, status),
+		.values = accepted_rejected_scheduled_values,
+		.value_count = 3,
+	},
+};
+
+const struct ocppj_schema_object ocppj_change_availability_conf_schema = {
+	.name = "ChangeAvailability.conf payload",
+	.fields = change_availability_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_change_availability_conf),
+};
+
+static const struct ocppj_schema_field change_configuration_req_fields[] = {
+	{
+		.name = "key",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.required = true,
+		.offset = offsetof(struct ocppj_change_configuration_req, key),
+		.max_length = 50,
+	},
+	{
+		.name = "value",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.required = true,
+		.offset = offsetof(struct ocppj_change_configuration_req, value),
+		.max_length = 500,
+	},
+};
+
+const struct ocppj_schema_object ocppj_change_configuration_req_schema = {
+	.name = "ChangeConfiguration.req payload",
+	.fields = change_configuration_req_fields,
+	.field_count = 2,
+	.size = sizeof(struct ocppj_change_configuration_req),
+};
+
+static const struct ocppj_schema_field change_configuration_conf_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_change_configuration_conf, status),
+		.values = change_configuration_status_values,
+		.value_count = 4,
+	},
+};
+
+const struct ocppj_schema_object ocppj_change_configuration_conf_schema = {
+	.name = "ChangeConfiguration.conf payload",
+	.fields = change_configuration_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_change_configuration_conf),
+};
+
+const struct ocppj_schema_object ocppj_clear_cache_req_schema = {
+	.name = "ClearCache.req payload",
+	.field_count = 0,
+	.size = sizeof(struct ocppj_clear_cache_req),
+};
+
+static const struct ocppj_schema_field clear_cache_conf_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_clear_cache_conf, status),
+		.values = accepted_rejected_values,
+		.value_count = 2,
+	},
+};
+
+const struct ocppj_schema_object ocppj_clear_cache_conf_schema = {
+	.name = "ClearCache.conf payload",
+	.fields = clear_cache_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_clear_cache_conf),
+};
+
+static const struct ocppj_schema_field clear_charging_profile_req_fields[] = {
+	{
+		.name = "id",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.offset = offsetof(struct ocppj_clear_charging_profile_req, id),
+	},
+	{
+		.name = "connectorId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.offset = offsetof(struct ocppj_clear_charging_profile_req, connector_id),
+	},
+	{
+		.name = "chargingProfilePurpose",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.offset = offsetof(struct ocppj_clear_charging_profile_req, charging_profile_purpose),
+		.values = charging_profile_purpose_values,
+		.value_count = 3,
+	},
+	{
+		.name = "stackLevel",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.offset = offsetof(struct ocppj_clear_charging_profile_req, stack_level),
+	},
+};
+
+const struct ocppj_schema_object ocppj_clear_charging_profile_req_schema = {
+	.name = "ClearChargingProfile.req payload",
+	.fields = clear_charging_profile_req_fields,
+	.field_count = 4,
+	.size = sizeof(struct ocppj_clear_charging_profile_req),
+};
+
+static const struct ocppj_schema_field clear_charging_profile_conf_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_clear_charging_profile_conf, status),
+		.values = accepted_unknown_values,
+		.value_count = 2,
+	},
+};
+
+const struct ocppj_schema_object ocppj_clear_charging_profile_conf_schema = {
+	.name = "ClearChargingProfile.conf payload",
+	.fields = clear_charging_profile_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_clear_charging_profile_conf),
+};
+
+static const struct ocppj_schema_field data_transfer_req_fields[] = {
+	{
+		.name = "vendorId",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.required = true,
+		.offset = offsetof(struct ocppj_data_transfer_req, vendor_id),
+		.max_length = 255,
+	},
+	{
+		.name = "messageId",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_data_transfer_req, message_id),
+		.max_length = 50,
+	},
+	{
+		.name = "data",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_data_transfer_req, data),
+	},
+};
+
+const struct ocppj_schema_object ocppj_data_transfer_req_schema = {
+	.name = "DataTransfer.req payload",
+	.fields = data_transfer_req_fields,
+	.field_count = 3,
+	.size = sizeof(struct ocppj_data_transfer_req),
+};
+
+static const struct ocppj_schema_field data_transfer_conf_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_data_transfer_conf, status),
+		.values = data_transfer_status_values,
+		.value_count = 4,
+	},
+	{
+		.name = "data",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_data_transfer_conf, data),
+	},
+};
+
+const struct ocppj_schema_object ocppj_data_transfer_conf_schema = {
+	.name = "DataTransfer.conf payload",
+	.fields = data_transfer_conf_fields,
+	.field_count = 2,
+	.size = sizeof(struct ocppj_data_transfer_conf),
+};
+
+static const struct ocppj_schema_field diagnostics_status_notification_req_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_diagnostics_status_notification_req, status),
+		.values = idle_uploaded_upload_failed_uploading_values,
+		.value_count = 4,
+	},
+};
+
+const struct ocppj_schema_object ocppj_diagnostics_status_notification_req_schema = {
+	.name = "DiagnosticsStatusNotification.req payload",
+	.fields = diagnostics_status_notification_req_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_diagnostics_status_notification_req),
+};
+
+const struct ocppj_schema_object ocppj_diagnostics_status_notification_conf_schema = {
+	.name = "DiagnosticsStatusNotification.conf payload",
+	.field_count = 0,
+	.size = sizeof(struct ocppj_diagnostics_status_notification_conf),
+};
+
+static const struct ocppj_schema_field firmware_status_notification_req_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_firmware_status_notification_req, status),
+		.values = firmware_status_notification_status_values,
+		.value_count = 7,
+	},
+};
+
+const struct ocppj_schema_object ocppj_firmware_status_notification_req_schema = {
+	.name = "FirmwareStatusNotification.req payload",
+	.fields = firmware_status_notification_req_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_firmware_status_notification_req),
+};
+
+const struct ocppj_schema_object ocppj_firmware_status_notification_conf_schema = {
+	.name = "FirmwareStatusNotification.conf payload",
+	.field_count = 0,
+	.size = sizeof(struct ocppj_firmware_status_notification_conf),
+};
+
+static const struct ocppj_schema_field get_composite_schedule_req_fields[] = {
+	{
+		.name = "connectorId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_get_composite_schedule_req, connector_id),
+	},
+	{
+		.name = "duration",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_get_composite_schedule_req, duration),
+	},
+	{
+		.name = "chargingRateUnit",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.offset = offsetof(struct ocppj_get_composite_schedule_req, charging_rate_unit),
+		.values = charging_rate_unit_values,
+		.value_count = 2,
+	},
+};
+
+const struct ocppj_schema_object ocppj_get_composite_schedule_req_schema = {
+	.name = "GetCompositeSchedule.req payload",
+	.fields = get_composite_schedule_req_fields,
+	.field_count = 3,
+	.size = sizeof(struct ocppj_get_composite_schedule_req),
+};
+
+static const struct ocppj_schema_field charging_schedule_period_fields[] = {
+	{
+		.name = "startPeriod",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_charging_schedule_period, start_period),
+	},
+	{
+		.name = "limit",
+		.type = eOCPPJ_SCHEMA_DECIMAL,
+		.required = true,
+		.offset = offsetof(struct ocppj_charging_schedule_period, limit),
+		.one_decimal = true,
+	},
+	{
+		.name = "numberPhases",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.offset = offsetof(struct ocppj_charging_schedule_period, number_phases),
+	},
+};
+
+const struct ocppj_schema_object ocppj_charging_schedule_period_schema = {
+	.name = "ChargingSchedulePeriod",
+	.fields = charging_schedule_period_fields,
+	.field_count = 3,
+	.size = sizeof(struct ocppj_charging_schedule_period),
+};
+
+static const struct ocppj_schema_field charging_schedule_charging_schedule_period_items = {
+	.name = "chargingSchedulePeriod",
+	.type = eOCPPJ_SCHEMA_OBJECT,
+	.object = &ocppj_charging_schedule_period_schema,
+};
+
+static const struct ocppj_schema_field charging_schedule_fields[] = {
+	{
+		.name = "duration",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.offset = offsetof(struct ocppj_charging_schedule, duration),
+	},
+	{
+		.name = "startSchedule",
+		.type = eOCPPJ_SCHEMA_DATE_TIME,
+		.offset = offsetof(struct ocppj_charging_schedule, start_schedule),
+	},
+	{
+		.name = "chargingRateUnit",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_charging_schedule, charging_rate_unit),
+		.values = charging_rate_unit_values,
+		.value_count = 2,
+	},
+	{
+		.name = "chargingSchedulePeriod",
+		.type = eOCPPJ_SCHEMA_ARRAY,
+		.required = true,
+		.offset = offsetof(struct ocppj_charging_schedule, charging_schedule_period),
+		.count_offset = offsetof(struct ocppj_charging_schedule, charging_schedule_period_count),
+		.items = &charging_schedule_charging_schedule_period_items,
+	},
+	{
+		.name = "minChargingRate",
+		.type = eOCPPJ_SCHEMA_DECIMAL,
+		.offset = offsetof(struct ocppj_charging_schedule, min_charging_rate),
+		.one_decimal = true,
+	},
+};
+
+const struct ocppj_schema_object ocppj_charging_schedule_schema = {
+	.name = "ChargingSchedule",
+	.fields = charging_schedule_fields,
+	.field_count = 5,
+	.size = sizeof(struct ocppj_charging_schedule),
+};
+
+static const struct ocppj_schema_field get_composite_schedule_conf_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_get_composite_schedule_conf, status),
+		.values = accepted_rejected_values,
+		.value_count = 2,
+	},
+	{
+		.name = "connectorId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.offset = offsetof(struct ocppj_get_composite_schedule_conf, connector_id),
+	},
+	{
+		.name = "scheduleStart",
+		.type = eOCPPJ_SCHEMA_DATE_TIME,
+		.offset = offsetof(struct ocppj_get_composite_schedule_conf, schedule_start),
+	},
+	{
+		.name = "chargingSchedule",
+		.type = eOCPPJ_SCHEMA_OBJECT,
+		.offset = offsetof(struct ocppj_get_composite_schedule_conf, charging_schedule),
+		.object = &ocppj_charging_schedule_schema,
+	},
+};
+
+const struct ocppj_schema_object ocppj_get_composite_schedule_conf_schema = {
+	.name = "GetCompositeSchedule.conf payload",
+	.fields = get_composite_schedule_conf_fields,
+	.field_count = 4,
+	.size = sizeof(struct ocppj_get_composite_schedule_conf),
+};
+
+static const struct ocppj_schema_field get_configuration_req_key_items = {
+	.name = "key",
+	.type = eOCPPJ_SCHEMA_STRING,
+	.max_length = 50,
+};
+
+static const struct ocppj_schema_field get_configuration_req_fields[] = {
+	{
+		.name = "key",
+		.type = eOCPPJ_SCHEMA_ARRAY,
+		.offset = offsetof(struct ocppj_get_configuration_req, key),
+		.count_offset = offsetof(struct ocppj_get_configuration_req, key_count),
+		.items = &get_configuration_req_key_items,
+	},
+};
+
+const struct ocppj_schema_object ocppj_get_configuration_req_schema = {
+	.name = "GetConfiguration.req payload",
+	.fields = get_configuration_req_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_get_configuration_req),
+};
+
+static const struct ocppj_schema_field key_value_fields[] = {
+	{
+		.name = "key",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.required = true,
+		.offset = offsetof(struct ocppj_key_value, key),
+		.max_length = 50,
+	},
+	{
+		.name = "readonly",
+		.type = eOCPPJ_SCHEMA_BOOLEAN,
+		.required = true,
+		.offset = offsetof(struct ocppj_key_value, readonly),
+	},
+	{
+		.name = "value",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_key_value, value),
+		.max_length = 500,
+	},
+};
+
+const struct ocppj_schema_object ocppj_key_value_schema = {
+	.name = "KeyValue",
+	.fields = key_value_fields,
+	.field_count = 3,
+	.size = sizeof(struct ocppj_key_value),
+};
+
+static const struct ocppj_schema_field get_configuration_conf_configuration_key_items = {
+	.name = "configurationKey",
+	.type = eOCPPJ_SCHEMA_OBJECT,
+	.object = &ocppj_key_value_schema,
+};
+
+static const struct ocppj_schema_field get_configuration_conf_unknown_key_items = {
+	.name = "unknownKey",
+	.type = eOCPPJ_SCHEMA_STRING,
+	.max_length = 50,
+};
+
+static const struct ocppj_schema_field get_configuration_conf_fields[] = {
+	{
+		.name = "configurationKey",
+		.type = eOCPPJ_SCHEMA_ARRAY,
+		.offset = offsetof(struct ocppj_get_configuration_conf, configuration_key),
+		.count_offset = offsetof(struct ocppj_get_configuration_conf, configuration_key_count),
+		.items = &get_configuration_conf_configuration_key_items,
+	},
+	{
+		.name = "unknownKey",
+		.type = eOCPPJ_SCHEMA_ARRAY,
+		.offset = offsetof(struct ocppj_get_configuration_conf, unknown_key),
+		.count_offset = offsetof(struct ocppj_get_configuration_conf, unknown_key_count),
+		.items = &get_configuration_conf_unknown_key_items,
+	},
+};
+
+const struct ocppj_schema_object ocppj_get_configuration_conf_schema = {
+	.name = "GetConfiguration.conf payload",
+	.fields = get_configuration_conf_fields,
+	.field_count = 2,
+	.size = sizeof(struct ocppj_get_configuration_conf),
+};
+
+static const struct ocppj_schema_field get_diagnostics_req_fields[] = {
+	{
+		.name = "location",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.required = true,
+		.offset = offsetof(struct ocppj_get_diagnostics_req, location),
+	},
+	{
+		.name = "retries",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.offset = offsetof(struct ocppj_get_diagnostics_req, retries),
+	},
+	{
+		.name = "retryInterval",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.offset = offsetof(struct ocppj_get_diagnostics_req, retry_interval),
+	},
+	{
+		.name = "startTime",
+		.type = eOCPPJ_SCHEMA_DATE_TIME,
+		.offset = offsetof(struct ocppj_get_diagnostics_req, start_time),
+	},
+	{
+		.name = "stopTime",
+		.type = eOCPPJ_SCHEMA_DATE_TIME,
+		.offset = offsetof(struct ocppj_get_diagnostics_req, stop_time),
+	},
+};
+
+const struct ocppj_schema_object ocppj_get_diagnostics_req_schema = {
+	.name = "GetDiagnostics.req payload",
+	.fields = get_diagnostics_req_fields,
+	.field_count = 5,
+	.size = sizeof(struct ocppj_get_diagnostics_req),
+};
+
+static const struct ocppj_schema_field get_diagnostics_conf_fields[] = {
+	{
+		.name = "fileName",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_get_diagnostics_conf, file_name),
+		.max_length = 255,
+	},
+};
+
+const struct ocppj_schema_object ocppj_get_diagnostics_conf_schema = {
+	.name = "GetDiagnostics.conf payload",
+	.fields = get_diagnostics_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_get_diagnostics_conf),
+};
+
+const struct ocppj_schema_object ocppj_get_local_list_version_req_schema = {
+	.name = "GetLocalListVersion.req payload",
+	.field_count = 0,
+	.size = sizeof(struct ocppj_get_local_list_version_req),
+};
+
+static const struct ocppj_schema_field get_local_list_version_conf_fields[] = {
+	{
+		.name = "listVersion",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_get_local_list_version_conf, list_version),
+	},
+};
+
+const struct ocppj_schema_object ocppj_get_local_list_version_conf_schema = {
+	.name = "GetLocalListVersion.conf payload",
+	.fields = get_local_list_version_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_get_local_list_version_conf),
+};
+
+const struct ocppj_schema_object ocppj_heartbeat_req_schema = {
+	.name = "Heartbeat.req payload",
+	.field_count = 0,
+	.size = sizeof(struct ocppj_heartbeat_req),
+};
+
+static const struct ocppj_schema_field heartbeat_conf_fields[] = {
+	{
+		.name = "currentTime",
+		.type = eOCPPJ_SCHEMA_DATE_TIME,
+		.required = true,
+		.offset = offsetof(struct ocppj_heartbeat_conf, current_time),
+	},
+};
+
+const struct ocppj_schema_object ocppj_heartbeat_conf_schema = {
+	.name = "Heartbeat.conf payload",
+	.fields = heartbeat_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_heartbeat_conf),
+};
+
+static const struct ocppj_schema_field sampled_value_fields[] = {
+	{
+		.name = "value",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.required = true,
+		.offset = offsetof(struct ocppj_sampled_value, value),
+	},
+	{
+		.name = "context",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.offset = offsetof(struct ocppj_sampled_value, context),
+		.values = context_values,
+		.value_count = 8,
+	},
+	{
+		.name = "format",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.offset = offsetof(struct ocppj_sampled_value, format),
+		.values = format_values,
+		.value_count = 2,
+	},
+	{
+		.name = "measurand",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.offset = offsetof(struct ocppj_sampled_value, measurand),
+		.values = measurand_values,
+		.value_count = 22,
+	},
+	{
+		.name = "phase",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.offset = offsetof(struct ocppj_sampled_value, phase),
+		.values = phase_values,
+		.value_count = 10,
+	},
+	{
+		.name = "location",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.offset = offsetof(struct ocppj_sampled_value, location),
+		.values = location_values,
+		.value_count = 5,
+	},
+	{
+		.name = "unit",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.offset = offsetof(struct ocppj_sampled_value, unit),
+		.values = unit_values,
+		.value_count = 17,
+	},
+};
+
+const struct ocppj_schema_object ocppj_sampled_value_schema = {
+	.name = "SampledValue",
+	.fields = sampled_value_fields,
+	.field_count = 7,
+	.size = sizeof(struct ocppj_sampled_value),
+};
+
+static const struct ocppj_schema_field meter_value_sampled_value_items = {
+	.name = "sampledValue",
+	.type = eOCPPJ_SCHEMA_OBJECT,
+	.object = &ocppj_sampled_value_schema,
+};
+
+static const struct ocppj_schema_field meter_value_fields[] = {
+	{
+		.name = "timestamp",
+		.type = eOCPPJ_SCHEMA_DATE_TIME,
+		.required = true,
+		.offset = offsetof(struct ocppj_meter_value, timestamp),
+	},
+	{
+		.name = "sampledValue",
+		.type = eOCPPJ_SCHEMA_ARRAY,
+		.required = true,
+		.offset = offsetof(struct ocppj_meter_value, sampled_value),
+		.count_offset = offsetof(struct ocppj_meter_value, sampled_value_count),
+		.items = &meter_value_sampled_value_items,
+	},
+};
+
+const struct ocppj_schema_object ocppj_meter_value_schema = {
+	.name = "MeterValue",
+	.fields = meter_value_fields,
+	.field_count = 2,
+	.size = sizeof(struct ocppj_meter_value),
+};
+
+static const struct ocppj_schema_field meter_values_req_meter_value_items = {
+	.name = "meterValue",
+	.type = eOCPPJ_SCHEMA_OBJECT,
+	.object = &ocppj_meter_value_schema,
+};
+
+static const struct ocppj_schema_field meter_values_req_fields[] = {
+	{
+		.name = "connectorId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_meter_values_req, connector_id),
+	},
+	{
+		.name = "transactionId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.offset = offsetof(struct ocppj_meter_values_req, transaction_id),
+	},
+	{
+		.name = "meterValue",
+		.type = eOCPPJ_SCHEMA_ARRAY,
+		.required = true,
+		.offset = offsetof(struct ocppj_meter_values_req, meter_value),
+		.count_offset = offsetof(struct ocppj_meter_values_req, meter_value_count),
+		.items = &meter_values_req_meter_value_items,
+	},
+};
+
+const struct ocppj_schema_object ocppj_meter_values_req_schema = {
+	.name = "MeterValues.req payload",
+	.fields = meter_values_req_fields,
+	.field_count = 3,
+	.size = sizeof(struct ocppj_meter_values_req),
+};
+
+const struct ocppj_schema_object ocppj_meter_values_conf_schema = {
+	.name = "MeterValues.conf payload",
+	.field_count = 0,
+	.size = sizeof(struct ocppj_meter_values_conf),
+};
+
+static const struct ocppj_schema_field charging_profile_fields[] = {
+	{
+		.name = "chargingProfileId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_charging_profile, charging_profile_id),
+	},
+	{
+		.name = "transactionId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.offset = offsetof(struct ocppj_charging_profile, transaction_id),
+	},
+	{
+		.name = "stackLevel",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_charging_profile, stack_level),
+	},
+	{
+		.name = "chargingProfilePurpose",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_charging_profile, charging_profile_purpose),
+		.values = charging_profile_purpose_values,
+		.value_count = 3,
+	},
+	{
+		.name = "chargingProfileKind",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_charging_profile, charging_profile_kind),
+		.values = charging_profile_kind_values,
+		.value_count = 3,
+	},
+	{
+		.name = "recurrencyKind",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.offset = offsetof(struct ocppj_charging_profile, recurrency_kind),
+		.values = recurrency_kind_values,
+		.value_count = 2,
+	},
+	{
+		.name = "validFrom",
+		.type = eOCPPJ_SCHEMA_DATE_TIME,
+		.offset = offsetof(struct ocppj_charging_profile, valid_from),
+	},
+	{
+		.name = "validTo",
+		.type = eOCPPJ_SCHEMA_DATE_TIME,
+		.offset = offsetof(struct ocppj_charging_profile, valid_to),
+	},
+	{
+		.name = "chargingSchedule",
+		.type = eOCPPJ_SCHEMA_OBJECT,
+		.required = true,
+		.offset = offsetof(struct ocppj_charging_profile, charging_schedule),
+		.object = &ocppj_charging_schedule_schema,
+	},
+};
+
+const struct ocppj_schema_object ocppj_charging_profile_schema = {
+	.name = "ChargingProfile",
+	.fields = charging_profile_fields,
+	.field_count = 9,
+	.size = sizeof(struct ocppj_charging_profile),
+};
+
+static const struct ocppj_schema_field remote_start_transaction_req_fields[] = {
+	{
+		.name = "connectorId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.offset = offsetof(struct ocppj_remote_start_transaction_req, connector_id),
+	},
+	{
+		.name = "idTag",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.required = true,
+		.offset = offsetof(struct ocppj_remote_start_transaction_req, id_tag),
+		.max_length = 20,
+	},
+	{
+		.name = "chargingProfile",
+		.type = eOCPPJ_SCHEMA_OBJECT,
+		.offset = offsetof(struct ocppj_remote_start_transaction_req, charging_profile),
+		.object = &ocppj_charging_profile_schema,
+	},
+};
+
+const struct ocppj_schema_object ocppj_remote_start_transaction_req_schema = {
+	.name = "RemoteStartTransaction.req payload",
+	.fields = remote_start_transaction_req_fields,
+	.field_count = 3,
+	.size = sizeof(struct ocppj_remote_start_transaction_req),
+};
+
+static const struct ocppj_schema_field remote_start_transaction_conf_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_remote_start_transaction_conf, status),
+		.values = accepted_rejected_values,
+		.value_count = 2,
+	},
+};
+
+const struct ocppj_schema_object ocppj_remote_start_transaction_conf_schema = {
+	.name = "RemoteStartTransaction.conf payload",
+	.fields = remote_start_transaction_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_remote_start_transaction_conf),
+};
+
+static const struct ocppj_schema_field remote_stop_transaction_req_fields[] = {
+	{
+		.name = "transactionId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_remote_stop_transaction_req, transaction_id),
+	},
+};
+
+const struct ocppj_schema_object ocppj_remote_stop_transaction_req_schema = {
+	.name = "RemoteStopTransaction.req payload",
+	.fields = remote_stop_transaction_req_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_remote_stop_transaction_req),
+};
+
+static const struct ocppj_schema_field remote_stop_transaction_conf_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_remote_stop_transaction_conf, status),
+		.values = accepted_rejected_values,
+		.value_count = 2,
+	},
+};
+
+const struct ocppj_schema_object ocppj_remote_stop_transaction_conf_schema = {
+	.name = "RemoteStopTransaction.conf payload",
+	.fields = remote_stop_transaction_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_remote_stop_transaction_conf),
+};
+
+static const struct ocppj_schema_field reserve_now_req_fields[] = {
+	{
+		.name = "connectorId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_reserve_now_req, connector_id),
+	},
+	{
+		.name = "expiryDate",
+		.type = eOCPPJ_SCHEMA_DATE_TIME,
+		.required = true,
+		.offset = offsetof(struct ocppj_reserve_now_req, expiry_date),
+	},
+	{
+		.name = "idTag",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.required = true,
+		.offset = offsetof(struct ocppj_reserve_now_req, id_tag),
+		.max_length = 20,
+	},
+	{
+		.name = "parentIdTag",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_reserve_now_req, parent_id_tag),
+		.max_length = 20,
+	},
+	{
+		.name = "reservationId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_reserve_now_req, reservation_id),
+	},
+};
+
+const struct ocppj_schema_object ocppj_reserve_now_req_schema = {
+	.name = "ReserveNow.req payload",
+	.fields = reserve_now_req_fields,
+	.field_count = 5,
+	.size = sizeof(struct ocppj_reserve_now_req),
+};
+
+static const struct ocppj_schema_field reserve_now_conf_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_reserve_now_conf, status),
+		.values = reserve_now_status_values,
+		.value_count = 5,
+	},
+};
+
+const struct ocppj_schema_object ocppj_reserve_now_conf_schema = {
+	.name = "ReserveNow.conf payload",
+	.fields = reserve_now_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_reserve_now_conf),
+};
+
+static const struct ocppj_schema_field reset_req_fields[] = {
+	{
+		.name = "type",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_reset_req, type),
+		.values = hard_soft_values,
+		.value_count = 2,
+	},
+};
+
+const struct ocppj_schema_object ocppj_reset_req_schema = {
+	.name = "Reset.req payload",
+	.fields = reset_req_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_reset_req),
+};
+
+static const struct ocppj_schema_field reset_conf_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_reset_conf, status),
+		.values = accepted_rejected_values,
+		.value_count = 2,
+	},
+};
+
+const struct ocppj_schema_object ocppj_reset_conf_schema = {
+	.name = "Reset.conf payload",
+	.fields = reset_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_reset_conf),
+};
+
+static const struct ocppj_schema_field authorization_data_fields[] = {
+	{
+		.name = "idTag",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.required = true,
+		.offset = offsetof(struct ocppj_authorization_data, id_tag),
+		.max_length = 20,
+	},
+	{
+		.name = "idTagInfo",
+		.type = eOCPPJ_SCHEMA_OBJECT,
+		.offset = offsetof(struct ocppj_authorization_data, id_tag_info),
+		.object = &ocppj_id_tag_info_schema,
+	},
+};
+
+const struct ocppj_schema_object ocppj_authorization_data_schema = {
+	.name = "AuthorizationData",
+	.fields = authorization_data_fields,
+	.field_count = 2,
+	.size = sizeof(struct ocppj_authorization_data),
+};
+
+static const struct ocppj_schema_field send_local_list_req_local_authorization_list_items = {
+	.name = "localAuthorizationList",
+	.type = eOCPPJ_SCHEMA_OBJECT,
+	.object = &ocppj_authorization_data_schema,
+};
+
+static const struct ocppj_schema_field send_local_list_req_fields[] = {
+	{
+		.name = "listVersion",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_send_local_list_req, list_version),
+	},
+	{
+		.name = "localAuthorizationList",
+		.type = eOCPPJ_SCHEMA_ARRAY,
+		.offset = offsetof(struct ocppj_send_local_list_req, local_authorization_list),
+		.count_offset = offsetof(struct ocppj_send_local_list_req, local_authorization_list_count),
+		.items = &send_local_list_req_local_authorization_list_items,
+	},
+	{
+		.name = "updateType",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_send_local_list_req, update_type),
+		.values = update_type_values,
+		.value_count = 2,
+	},
+};
+
+const struct ocppj_schema_object ocppj_send_local_list_req_schema = {
+	.name = "SendLocalList.req payload",
+	.fields = send_local_list_req_fields,
+	.field_count = 3,
+	.size = sizeof(struct ocppj_send_local_list_req),
+};
+
+static const struct ocppj_schema_field send_local_list_conf_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_send_local_list_conf, status),
+		.values = send_local_list_status_values,
+		.value_count = 4,
+	},
+};
+
+const struct ocppj_schema_object ocppj_send_local_list_conf_schema = {
+	.name = "SendLocalList.conf payload",
+	.fields = send_local_list_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_send_local_list_conf),
+};
+
+static const struct ocppj_schema_field set_charging_profile_req_fields[] = {
+	{
+		.name = "connectorId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_set_charging_profile_req, connector_id),
+	},
+	{
+		.name = "csChargingProfiles",
+		.type = eOCPPJ_SCHEMA_OBJECT,
+		.required = true,
+		.offset = offsetof(struct ocppj_set_charging_profile_req, cs_charging_profiles),
+		.object = &ocppj_charging_profile_schema,
+	},
+};
+
+const struct ocppj_schema_object ocppj_set_charging_profile_req_schema = {
+	.name = "SetChargingProfile.req payload",
+	.fields = set_charging_profile_req_fields,
+	.field_count = 2,
+	.size = sizeof(struct ocppj_set_charging_profile_req),
+};
+
+static const struct ocppj_schema_field set_charging_profile_conf_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_set_charging_profile_conf, status),
+		.values = accepted_rejected_not_supported_values,
+		.value_count = 3,
+	},
+};
+
+const struct ocppj_schema_object ocppj_set_charging_profile_conf_schema = {
+	.name = "SetChargingProfile.conf payload",
+	.fields = set_charging_profile_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_set_charging_profile_conf),
+};
+
+static const struct ocppj_schema_field start_transaction_req_fields[] = {
+	{
+		.name = "connectorId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_start_transaction_req, connector_id),
+	},
+	{
+		.name = "idTag",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.required = true,
+		.offset = offsetof(struct ocppj_start_transaction_req, id_tag),
+		.max_length = 20,
+	},
+	{
+		.name = "meterStart",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_start_transaction_req, meter_start),
+	},
+	{
+		.name = "reservationId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.offset = offsetof(struct ocppj_start_transaction_req, reservation_id),
+	},
+	{
+		.name = "timestamp",
+		.type = eOCPPJ_SCHEMA_DATE_TIME,
+		.required = true,
+		.offset = offsetof(struct ocppj_start_transaction_req, timestamp),
+	},
+};
+
+const struct ocppj_schema_object ocppj_start_transaction_req_schema = {
+	.name = "StartTransaction.req payload",
+	.fields = start_transaction_req_fields,
+	.field_count = 5,
+	.size = sizeof(struct ocppj_start_transaction_req),
+};
+
+static const struct ocppj_schema_field start_transaction_conf_fields[] = {
+	{
+		.name = "idTagInfo",
+		.type = eOCPPJ_SCHEMA_OBJECT,
+		.required = true,
+		.offset = offsetof(struct ocppj_start_transaction_conf, id_tag_info),
+		.object = &ocppj_id_tag_info_schema,
+	},
+	{
+		.name = "transactionId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_start_transaction_conf, transaction_id),
+	},
+};
+
+const struct ocppj_schema_object ocppj_start_transaction_conf_schema = {
+	.name = "StartTransaction.conf payload",
+	.fields = start_transaction_conf_fields,
+	.field_count = 2,
+	.size = sizeof(struct ocppj_start_transaction_conf),
+};
+
+static const struct ocppj_schema_field status_notification_req_fields[] = {
+	{
+		.name = "connectorId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_status_notification_req, connector_id),
+	},
+	{
+		.name = "errorCode",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_status_notification_req, error_code),
+		.values = error_code_values,
+		.value_count = 16,
+	},
+	{
+		.name = "info",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_status_notification_req, info),
+		.max_length = 50,
+	},
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_status_notification_req, status),
+		.values = status_notification_status_values,
+		.value_count = 9,
+	},
+	{
+		.name = "timestamp",
+		.type = eOCPPJ_SCHEMA_DATE_TIME,
+		.offset = offsetof(struct ocppj_status_notification_req, timestamp),
+	},
+	{
+		.name = "vendorId",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_status_notification_req, vendor_id),
+		.max_length = 255,
+	},
+	{
+		.name = "vendorErrorCode",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_status_notification_req, vendor_error_code),
+		.max_length = 50,
+	},
+};
+
+const struct ocppj_schema_object ocppj_status_notification_req_schema = {
+	.name = "StatusNotification.req payload",
+	.fields = status_notification_req_fields,
+	.field_count = 7,
+	.size = sizeof(struct ocppj_status_notification_req),
+};
+
+const struct ocppj_schema_object ocppj_status_notification_conf_schema = {
+	.name = "StatusNotification.conf payload",
+	.field_count = 0,
+	.size = sizeof(struct ocppj_status_notification_conf),
+};
+
+static const struct ocppj_schema_field stop_transaction_sampled_value_fields[] = {
+	{
+		.name = "value",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.required = true,
+		.offset = offsetof(struct ocppj_stop_transaction_sampled_value, value),
+	},
+	{
+		.name = "context",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.offset = offsetof(struct ocppj_stop_transaction_sampled_value, context),
+		.values = context_values,
+		.value_count = 8,
+	},
+	{
+		.name = "format",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.offset = offsetof(struct ocppj_stop_transaction_sampled_value, format),
+		.values = format_values,
+		.value_count = 2,
+	},
+	{
+		.name = "measurand",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.offset = offsetof(struct ocppj_stop_transaction_sampled_value, measurand),
+		.values = measurand_values,
+		.value_count = 22,
+	},
+	{
+		.name = "phase",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.offset = offsetof(struct ocppj_stop_transaction_sampled_value, phase),
+		.values = phase_values,
+		.value_count = 10,
+	},
+	{
+		.name = "location",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.offset = offsetof(struct ocppj_stop_transaction_sampled_value, location),
+		.values = location_values,
+		.value_count = 5,
+	},
+	{
+		.name = "unit",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.offset = offsetof(struct ocppj_stop_transaction_sampled_value, unit),
+		.values = stop_transaction_unit_values,
+		.value_count = 16,
+	},
+};
+
+const struct ocppj_schema_object ocppj_stop_transaction_sampled_value_schema = {
+	.name = "SampledValue",
+	.fields = stop_transaction_sampled_value_fields,
+	.field_count = 7,
+	.size = sizeof(struct ocppj_stop_transaction_sampled_value),
+};
+
+static const struct ocppj_schema_field stop_transaction_meter_value_sampled_value_items = {
+	.name = "sampledValue",
+	.type = eOCPPJ_SCHEMA_OBJECT,
+	.object = &ocppj_stop_transaction_sampled_value_schema,
+};
+
+static const struct ocppj_schema_field stop_transaction_meter_value_fields[] = {
+	{
+		.name = "timestamp",
+		.type = eOCPPJ_SCHEMA_DATE_TIME,
+		.required = true,
+		.offset = offsetof(struct ocppj_stop_transaction_meter_value, timestamp),
+	},
+	{
+		.name = "sampledValue",
+		.type = eOCPPJ_SCHEMA_ARRAY,
+		.required = true,
+		.offset = offsetof(struct ocppj_stop_transaction_meter_value, sampled_value),
+		.count_offset = offsetof(struct ocppj_stop_transaction_meter_value, sampled_value_count),
+		.items = &stop_transaction_meter_value_sampled_value_items,
+	},
+};
+
+const struct ocppj_schema_object ocppj_stop_transaction_meter_value_schema = {
+	.name = "MeterValue",
+	.fields = stop_transaction_meter_value_fields,
+	.field_count = 2,
+	.size = sizeof(struct ocppj_stop_transaction_meter_value),
+};
+
+static const struct ocppj_schema_field stop_transaction_req_transaction_data_items = {
+	.name = "transactionData",
+	.type = eOCPPJ_SCHEMA_OBJECT,
+	.object = &ocppj_stop_transaction_meter_value_schema,
+};
+
+static const struct ocppj_schema_field stop_transaction_req_fields[] = {
+	{
+		.name = "idTag",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.offset = offsetof(struct ocppj_stop_transaction_req, id_tag),
+		.max_length = 20,
+	},
+	{
+		.name = "meterStop",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_stop_transaction_req, meter_stop),
+	},
+	{
+		.name = "timestamp",
+		.type = eOCPPJ_SCHEMA_DATE_TIME,
+		.required = true,
+		.offset = offsetof(struct ocppj_stop_transaction_req, timestamp),
+	},
+	{
+		.name = "transactionId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_stop_transaction_req, transaction_id),
+	},
+	{
+		.name = "reason",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.offset = offsetof(struct ocppj_stop_transaction_req, reason),
+		.values = reason_values,
+		.value_count = 11,
+	},
+	{
+		.name = "transactionData",
+		.type = eOCPPJ_SCHEMA_ARRAY,
+		.offset = offsetof(struct ocppj_stop_transaction_req, transaction_data),
+		.count_offset = offsetof(struct ocppj_stop_transaction_req, transaction_data_count),
+		.items = &stop_transaction_req_transaction_data_items,
+	},
+};
+
+const struct ocppj_schema_object ocppj_stop_transaction_req_schema = {
+	.name = "StopTransaction.req payload",
+	.fields = stop_transaction_req_fields,
+	.field_count = 6,
+	.size = sizeof(struct ocppj_stop_transaction_req),
+};
+
+static const struct ocppj_schema_field stop_transaction_conf_fields[] = {
+	{
+		.name = "idTagInfo",
+		.type = eOCPPJ_SCHEMA_OBJECT,
+		.offset = offsetof(struct ocppj_stop_transaction_conf, id_tag_info),
+		.object = &ocppj_id_tag_info_schema,
+	},
+};
+
+const struct ocppj_schema_object ocppj_stop_transaction_conf_schema = {
+	.name = "StopTransaction.conf payload",
+	.fields = stop_transaction_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_stop_transaction_conf),
+};
+
+static const struct ocppj_schema_field trigger_message_req_fields[] = {
+	{
+		.name = "requestedMessage",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_trigger_message_req, requested_message),
+		.values = requested_message_values,
+		.value_count = 6,
+	},
+	{
+		.name = "connectorId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.offset = offsetof(struct ocppj_trigger_message_req, connector_id),
+	},
+};
+
+const struct ocppj_schema_object ocppj_trigger_message_req_schema = {
+	.name = "TriggerMessage.req payload",
+	.fields = trigger_message_req_fields,
+	.field_count = 2,
+	.size = sizeof(struct ocppj_trigger_message_req),
+};
+
+static const struct ocppj_schema_field trigger_message_conf_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_trigger_message_conf, status),
+		.values = accepted_rejected_not_implemented_values,
+		.value_count = 3,
+	},
+};
+
+const struct ocppj_schema_object ocppj_trigger_message_conf_schema = {
+	.name = "TriggerMessage.conf payload",
+	.fields = trigger_message_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_trigger_message_conf),
+};
+
+static const struct ocppj_schema_field unlock_connector_req_fields[] = {
+	{
+		.name = "connectorId",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.required = true,
+		.offset = offsetof(struct ocppj_unlock_connector_req, connector_id),
+	},
+};
+
+const struct ocppj_schema_object ocppj_unlock_connector_req_schema = {
+	.name = "UnlockConnector.req payload",
+	.fields = unlock_connector_req_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_unlock_connector_req),
+};
+
+static const struct ocppj_schema_field unlock_connector_conf_fields[] = {
+	{
+		.name = "status",
+		.type = eOCPPJ_SCHEMA_ENUM,
+		.required = true,
+		.offset = offsetof(struct ocppj_unlock_connector_conf, status),
+		.values = unlocked_unlock_failed_not_supported_values,
+		.value_count = 3,
+	},
+};
+
+const struct ocppj_schema_object ocppj_unlock_connector_conf_schema = {
+	.name = "UnlockConnector.conf payload",
+	.fields = unlock_connector_conf_fields,
+	.field_count = 1,
+	.size = sizeof(struct ocppj_unlock_connector_conf),
+};
+
+static const struct ocppj_schema_field update_firmware_req_fields[] = {
+	{
+		.name = "location",
+		.type = eOCPPJ_SCHEMA_STRING,
+		.required = true,
+		.offset = offsetof(struct ocppj_update_firmware_req, location),
+	},
+	{
+		.name = "retries",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.offset = offsetof(struct ocppj_update_firmware_req, retries),
+	},
+	{
+		.name = "retrieveDate",
+		.type = eOCPPJ_SCHEMA_DATE_TIME,
+		.required = true,
+		.offset = offsetof(struct ocppj_update_firmware_req, retrieve_date),
+	},
+	{
+		.name = "retryInterval",
+		.type = eOCPPJ_SCHEMA_INTEGER,
+		.offset = offsetof(struct ocppj_update_firmware_req, retry_interval),
+	},
+};
+
+const struct ocppj_schema_object ocppj_update_firmware_req_schema = {
+	.name = "UpdateFirmware.req payload",
+	.fields = update_firmware_req_fields,
+	.field_count = 4,
+	.size = sizeof(struct ocppj_update_firmware_req),
+};
+
+const struct ocppj_schema_object ocppj_update_firmware_conf_schema = {
+	.name = "UpdateFirmware.conf payload",
+	.field_count = 0,
+	.size = sizeof(struct ocppj_update_firmware_conf),
+};
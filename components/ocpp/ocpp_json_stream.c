@@ -0,0 +1,581 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "ocpp_json_stream.h"
+
+static const char * TAG = "OCPP JSON STRM ";
+
+#define TOKEN_INITIAL_SIZE 64
+
+void ocpp_json_stream_init(struct ocpp_json_stream * stream, size_t max_token_length, ocpp_json_stream_child_callback child_cb,
+			ocpp_json_stream_element_callback element_cb, void * cb_data){
+
+	memset(stream, 0, sizeof(struct ocpp_json_stream));
+
+	stream->state = eOCPP_JSON_STREAM_VALUE;
+	stream->max_token_length = max_token_length;
+	stream->child_cb = child_cb;
+	stream->element_cb = element_cb;
+	stream->cb_data = cb_data;
+}
+
+void ocpp_json_stream_reset(struct ocpp_json_stream * stream){
+	/*
+	 * Containers opened inside a streamed array are not attached to the tree and must be deleted on their own before
+	 * the root deletes everything else.
+	 */
+	for(size_t i = stream->depth; i > 1; i--){
+		if(stream->frames[i-2].streamed)
+			cJSON_Delete(stream->frames[i-1].container);
+	}
+
+	for(size_t i = 0; i < stream->depth; i++)
+		free(stream->frames[i].key);
+
+	if(stream->depth > 0)
+		cJSON_Delete(stream->frames[0].container);
+
+	cJSON_Delete(stream->root);
+
+	memset(stream->frames, 0, sizeof(stream->frames));
+	stream->depth = 0;
+	stream->root = NULL;
+	stream->state = eOCPP_JSON_STREAM_VALUE;
+	stream->token_length = 0;
+	stream->high_surrogate = 0;
+	stream->path_length = 0;
+	stream->streamed_count = 0;
+	stream->consumed = 0;
+}
+
+void ocpp_json_stream_deinit(struct ocpp_json_stream * stream){
+	ocpp_json_stream_reset(stream);
+
+	free(stream->token);
+	stream->token = NULL;
+	stream->token_size = 0;
+}
+
+esp_err_t ocpp_json_stream_set_array_path(struct ocpp_json_stream * stream, const char * const * path, size_t path_length){
+	if(path_length > OCPP_JSON_STREAM_MAX_PATH_LENGTH)
+		return ESP_ERR_INVALID_ARG;
+
+	for(size_t i = 0; i < path_length; i++)
+		stream->path[i] = path[i];
+
+	stream->path_length = path_length;
+
+	return ESP_OK;
+}
+
+static esp_err_t fail(struct ocpp_json_stream * stream, esp_err_t err, const char * reason){
+	ESP_LOGW(TAG, "Parsing failed at byte %zu: %s", stream->consumed, reason);
+	stream->state = eOCPP_JSON_STREAM_ERROR;
+
+	return err;
+}
+
+static esp_err_t token_append(struct ocpp_json_stream * stream, char c){
+	if(stream->token_length + 1 >= stream->token_size){
+		if(stream->token_length >= stream->max_token_length)
+			return fail(stream, ESP_ERR_INVALID_SIZE, "Token too long");
+
+		size_t new_size = (stream->token_size == 0) ? TOKEN_INITIAL_SIZE : stream->token_size * 2;
+		if(new_size > stream->max_token_length + 1)
+			new_size = stream->max_token_length + 1;
+
+		char * new_token = realloc(stream->token, new_size);
+		if(new_token == NULL)
+			return fail(stream, ESP_ERR_NO_MEM, "Unable to grow token buffer");
+
+		stream->token = new_token;
+		stream->token_size = new_size;
+	}
+
+	stream->token[stream->token_length++] = c;
+	return ESP_OK;
+}
+
+static esp_err_t token_append_utf8(struct ocpp_json_stream * stream, uint32_t code_point){
+	char encoded[4];
+	size_t length;
+
+	if(code_point < 0x80){
+		encoded[0] = code_point;
+		length = 1;
+	}else if(code_point < 0x800){
+		encoded[0] = 0xC0 | (code_point >> 6);
+		encoded[1] = 0x80 | (code_point & 0x3F);
+		length = 2;
+	}else if(code_point < 0x10000){
+		encoded[0] = 0xE0 | (code_point >> 12);
+		encoded[1] = 0x80 | ((code_point >> 6) & 0x3F);
+		encoded[2] = 0x80 | (code_point & 0x3F);
+		length = 3;
+	}else{
+		encoded[0] = 0xF0 | (code_point >> 18);
+		encoded[1] = 0x80 | ((code_point >> 12) & 0x3F);
+		encoded[2] = 0x80 | ((code_point >> 6) & 0x3F);
+		encoded[3] = 0x80 | (code_point & 0x3F);
+		length = 4;
+	}
+
+	for(size_t i = 0; i < length; i++){
+		esp_err_t err = token_append(stream, encoded[i]);
+		if(err != ESP_OK)
+			return err;
+	}
+
+	return ESP_OK;
+}
+
+static const char * token_terminate(struct ocpp_json_stream * stream){
+	if(stream->token == NULL)
+		return "";
+
+	stream->token[stream->token_length] = '\0';
+	return stream->token;
+}
+
+static bool path_matches(const struct ocpp_json_stream * stream, const struct ocpp_json_stream_frame * parent, size_t path_index){
+	if(!parent->on_path || path_index >= stream->path_length)
+		return false;
+
+	if(cJSON_IsObject(parent->container)){
+		return parent->key != NULL && strcmp(parent->key, stream->path[path_index]) == 0;
+
+	}else{
+		char * end;
+		unsigned long index = strtoul(stream->path[path_index], &end, 10);
+		return *end == '\0' && index == parent->index;
+	}
+}
+
+/*
+ * Handles a complete value that is a child of the current container or the root. Containers are attached to their
+ * parent when opened, so attached is true when they are closed.
+ */
+static esp_err_t child_complete(struct ocpp_json_stream * stream, cJSON * value, bool attached){
+	if(stream->depth == 0){
+		stream->root = value;
+		stream->state = eOCPP_JSON_STREAM_DONE;
+		return ESP_OK;
+	}
+
+	struct ocpp_json_stream_frame * parent = &stream->frames[stream->depth - 1];
+
+	if(parent->streamed){
+		int result = 0;
+		if(stream->element_cb != NULL)
+			result = stream->element_cb(value, parent->index, stream->cb_data);
+
+		cJSON_Delete(value);
+		stream->streamed_count++;
+
+		if(result != 0)
+			return fail(stream, ESP_FAIL, "Stopped by element callback");
+
+	}else if(!attached){
+		if(cJSON_IsObject(parent->container)){
+			cJSON_AddItemToObject(parent->container, parent->key, value);
+			free(parent->key);
+			parent->key = NULL;
+		}else{
+			cJSON_AddItemToArray(parent->container, value);
+		}
+	}
+
+	parent->index++;
+	stream->state = eOCPP_JSON_STREAM_COMMA_OR_END;
+
+	if(stream->depth == 1 && !parent->streamed && stream->child_cb != NULL)
+		stream->child_cb(stream, parent->container, parent->index - 1, stream->cb_data);
+
+	return ESP_OK;
+}
+
+static esp_err_t open_container(struct ocpp_json_stream * stream, bool is_array){
+	if(stream->depth >= OCPP_JSON_STREAM_MAX_DEPTH)
+		return fail(stream, ESP_ERR_INVALID_SIZE, "Nested too deep");
+
+	cJSON * container = is_array ? cJSON_CreateArray() : cJSON_CreateObject();
+	if(container == NULL)
+		return fail(stream, ESP_ERR_NO_MEM, "Unable to create container");
+
+	struct ocpp_json_stream_frame * frame = &stream->frames[stream->depth];
+	memset(frame, 0, sizeof(struct ocpp_json_stream_frame));
+	frame->container = container;
+
+	if(stream->depth == 0){
+		frame->on_path = true;
+
+	}else{
+		struct ocpp_json_stream_frame * parent = &stream->frames[stream->depth - 1];
+
+		frame->on_path = path_matches(stream, parent, stream->depth - 1);
+		frame->streamed = is_array && frame->on_path && stream->depth == stream->path_length;
+
+		if(!parent->streamed){
+			if(cJSON_IsObject(parent->container)){
+				cJSON_AddItemToObject(parent->container, parent->key, container);
+				free(parent->key);
+				parent->key = NULL;
+			}else{
+				cJSON_AddItemToArray(parent->container, container);
+			}
+		}
+	}
+
+	stream->depth++;
+	stream->state = is_array ? eOCPP_JSON_STREAM_VALUE_OR_END : eOCPP_JSON_STREAM_KEY_OR_END;
+
+	return ESP_OK;
+}
+
+static esp_err_t close_container(struct ocpp_json_stream * stream){
+	stream->depth--;
+	cJSON * container = stream->frames[stream->depth].container;
+	stream->frames[stream->depth].container = NULL;
+
+	return child_complete(stream, container, true);
+}
+
+static esp_err_t complete_string(struct ocpp_json_stream * stream){
+	if(stream->high_surrogate != 0)
+		return fail(stream, ESP_ERR_INVALID_ARG, "Unpaired surrogate");
+
+	const char * token = token_terminate(stream);
+
+	if(stream->state == eOCPP_JSON_STREAM_KEY_STRING){
+		struct ocpp_json_stream_frame * frame = &stream->frames[stream->depth - 1];
+		frame->key = strdup(token);
+		if(frame->key == NULL)
+			return fail(stream, ESP_ERR_NO_MEM, "Unable to duplicate key");
+
+		stream->state = eOCPP_JSON_STREAM_COLON;
+		return ESP_OK;
+	}
+
+	cJSON * value = cJSON_CreateString(token);
+	if(value == NULL)
+		return fail(stream, ESP_ERR_NO_MEM, "Unable to create string");
+
+	return child_complete(stream, value, false);
+}
+
+static esp_err_t complete_number(struct ocpp_json_stream * stream){
+	const char * token = token_terminate(stream);
+	char * end;
+	double number = strtod(token, &end);
+
+	if(end == token || *end != '\0')
+		return fail(stream, ESP_ERR_INVALID_ARG, "Invalid number");
+
+	cJSON * value = cJSON_CreateNumber(number);
+	if(value == NULL)
+		return fail(stream, ESP_ERR_NO_MEM, "Unable to create number");
+
+	return child_complete(stream, value, false);
+}
+
+static esp_err_t complete_literal(struct ocpp_json_stream * stream){
+	const char * token = token_terminate(stream);
+	cJSON * value;
+
+	if(strcmp(token, "true") == 0){
+		value = cJSON_CreateTrue();
+	}else if(strcmp(token, "false") == 0){
+		value = cJSON_CreateFalse();
+	}else if(strcmp(token, "null") == 0){
+		value = cJSON_CreateNull();
+	}else{
+		return fail(stream, ESP_ERR_INVALID_ARG, "Invalid literal");
+	}
+
+	if(value == NULL)
+		return fail(stream, ESP_ERR_NO_MEM, "Unable to create literal");
+
+	return child_complete(stream, value, false);
+}
+
+static esp_err_t complete_unicode(struct ocpp_json_stream * stream){
+	uint32_t code_point = stream->unicode;
+
+	if(code_point >= 0xD800 && code_point <= 0xDBFF){
+		if(stream->high_surrogate != 0)
+			return fail(stream, ESP_ERR_INVALID_ARG, "Unpaired surrogate");
+
+		stream->high_surrogate = code_point;
+		return ESP_OK;
+
+	}else if(code_point >= 0xDC00 && code_point <= 0xDFFF){
+		if(stream->high_surrogate == 0)
+			return fail(stream, ESP_ERR_INVALID_ARG, "Unpaired surrogate");
+
+		code_point = 0x10000 + ((stream->high_surrogate - 0xD800) << 10) + (code_point - 0xDC00);
+		stream->high_surrogate = 0;
+
+	}else if(stream->high_surrogate != 0){
+		return fail(stream, ESP_ERR_INVALID_ARG, "Unpaired surrogate");
+	}
+
+	return token_append_utf8(stream, code_point);
+}
+
+static bool is_whitespace(char c){
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int hex_value(char c){
+	if(c >= '0' && c <= '9')
+		return c - '0';
+	if(c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if(c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+
+	return -1;
+}
+
+/*
+ * Starts the value beginning with c. Returns ESP_OK if c was consumed.
+ */
+static esp_err_t start_value(struct ocpp_json_stream * stream, char c){
+	stream->token_length = 0;
+
+	if(c == '{'){
+		return open_container(stream, false);
+
+	}else if(c == '['){
+		return open_container(stream, true);
+
+	}else if(c == '"'){
+		stream->state = eOCPP_JSON_STREAM_STRING;
+		return ESP_OK;
+
+	}else if(c == '-' || (c >= '0' && c <= '9')){
+		stream->state = eOCPP_JSON_STREAM_NUMBER;
+		return token_append(stream, c);
+
+	}else if(c == 't' || c == 'f' || c == 'n'){
+		stream->state = eOCPP_JSON_STREAM_LITERAL;
+		return token_append(stream, c);
+
+	}else{
+		return fail(stream, ESP_ERR_INVALID_ARG, "Expected value");
+	}
+}
+
+static esp_err_t consume_string_char(struct ocpp_json_stream * stream, char c){
+	if(c == '"'){
+		return complete_string(stream);
+
+	}else if(c == '\\'){
+		stream->string_state = stream->state;
+		stream->state = eOCPP_JSON_STREAM_ESCAPE;
+		return ESP_OK;
+
+	}else if((unsigned char)c < 0x20){
+		return fail(stream, ESP_ERR_INVALID_ARG, "Control character in string");
+
+	}else if(stream->high_surrogate != 0){
+		return fail(stream, ESP_ERR_INVALID_ARG, "Unpaired surrogate");
+
+	}else{
+		return token_append(stream, c);
+	}
+}
+
+static esp_err_t consume_escape(struct ocpp_json_stream * stream, char c){
+	char unescaped;
+
+	switch(c){
+	case '"':
+	case '\\':
+	case '/':
+		unescaped = c;
+		break;
+	case 'b':
+		unescaped = '\b';
+		break;
+	case 'f':
+		unescaped = '\f';
+		break;
+	case 'n':
+		unescaped = '\n';
+		break;
+	case 'r':
+		unescaped = '\r';
+		break;
+	case 't':
+		unescaped = '\t';
+		break;
+	case 'u':
+		stream->unicode = 0;
+		stream->unicode_digits = 0;
+		stream->state = eOCPP_JSON_STREAM_UNICODE;
+		return ESP_OK;
+	default:
+		return fail(stream, ESP_ERR_INVALID_ARG, "Invalid escape sequence");
+	}
+
+	if(stream->high_surrogate != 0)
+		return fail(stream, ESP_ERR_INVALID_ARG, "Unpaired surrogate");
+
+	stream->state = stream->string_state;
+	return token_append(stream, unescaped);
+}
+
+static esp_err_t consume_unicode(struct ocpp_json_stream * stream, char c){
+	int digit = hex_value(c);
+	if(digit < 0)
+		return fail(stream, ESP_ERR_INVALID_ARG, "Invalid unicode escape");
+
+	stream->unicode = (stream->unicode << 4) | digit;
+	stream->unicode_digits++;
+
+	if(stream->unicode_digits < 4)
+		return ESP_OK;
+
+	stream->state = stream->string_state;
+	return complete_unicode(stream);
+}
+
+static esp_err_t consume_structural(struct ocpp_json_stream * stream, char c){
+	if(is_whitespace(c))
+		return ESP_OK;
+
+	struct ocpp_json_stream_frame * frame = (stream->depth > 0) ? &stream->frames[stream->depth - 1] : NULL;
+
+	switch(stream->state){
+	case eOCPP_JSON_STREAM_VALUE_OR_END:
+		if(c == ']')
+			return close_container(stream);
+
+		return start_value(stream, c);
+
+	case eOCPP_JSON_STREAM_VALUE:
+		return start_value(stream, c);
+
+	case eOCPP_JSON_STREAM_KEY_OR_END:
+		if(c == '}')
+			return close_container(stream);
+		// fall through
+	case eOCPP_JSON_STREAM_KEY:
+		if(c != '"')
+			return fail(stream, ESP_ERR_INVALID_ARG, "Expected key");
+
+		stream->token_length = 0;
+		stream->state = eOCPP_JSON_STREAM_KEY_STRING;
+		return ESP_OK;
+
+	case eOCPP_JSON_STREAM_COLON:
+		if(c != ':')
+			return fail(stream, ESP_ERR_INVALID_ARG, "Expected ':'");
+
+		stream->state = eOCPP_JSON_STREAM_VALUE;
+		return ESP_OK;
+
+	case eOCPP_JSON_STREAM_COMMA_OR_END:
+		if(c == ','){
+			stream->state = cJSON_IsObject(frame->container) ? eOCPP_JSON_STREAM_KEY : eOCPP_JSON_STREAM_VALUE;
+			return ESP_OK;
+
+		}else if((c == '}' && cJSON_IsObject(frame->container)) || (c == ']' && cJSON_IsArray(frame->container))){
+			return close_container(stream);
+
+		}else{
+			return fail(stream, ESP_ERR_INVALID_ARG, "Expected ',' or end of container");
+		}
+
+	case eOCPP_JSON_STREAM_DONE:
+		return fail(stream, ESP_ERR_INVALID_ARG, "Data after end of value");
+
+	default:
+		return fail(stream, ESP_ERR_INVALID_STATE, "Unexpected state");
+	}
+}
+
+esp_err_t ocpp_json_stream_feed(struct ocpp_json_stream * stream, const char * data, size_t length){
+	esp_err_t err = ESP_OK;
+	size_t i = 0;
+
+	while(i < length){
+		char c = data[i];
+
+		switch(stream->state){
+		case eOCPP_JSON_STREAM_ERROR:
+			return ESP_ERR_INVALID_STATE;
+
+		case eOCPP_JSON_STREAM_STRING:
+		case eOCPP_JSON_STREAM_KEY_STRING:
+			err = consume_string_char(stream, c);
+			break;
+
+		case eOCPP_JSON_STREAM_ESCAPE:
+			err = consume_escape(stream, c);
+			break;
+
+		case eOCPP_JSON_STREAM_UNICODE:
+			err = consume_unicode(stream, c);
+			break;
+
+		case eOCPP_JSON_STREAM_NUMBER:
+			if((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-'){
+				err = token_append(stream, c);
+			}else{
+				// The character ending the number is handled in the next iteration
+				err = complete_number(stream);
+				if(err != ESP_OK)
+					return err;
+				continue;
+			}
+			break;
+
+		case eOCPP_JSON_STREAM_LITERAL:
+			if(c >= 'a' && c <= 'z'){
+				err = token_append(stream, c);
+			}else{
+				err = complete_literal(stream);
+				if(err != ESP_OK)
+					return err;
+				continue;
+			}
+			break;
+
+		default:
+			err = consume_structural(stream, c);
+		}
+
+		if(err != ESP_OK)
+			return err;
+
+		i++;
+		stream->consumed++;
+	}
+
+	return ESP_OK;
+}
+
+esp_err_t ocpp_json_stream_finish(struct ocpp_json_stream * stream, cJSON ** root_out){
+	*root_out = NULL;
+
+	// A number or literal as root value is only ended by the end of the data
+	if(stream->depth == 0 && stream->state == eOCPP_JSON_STREAM_NUMBER){
+		complete_number(stream);
+	}else if(stream->depth == 0 && stream->state == eOCPP_JSON_STREAM_LITERAL){
+		complete_literal(stream);
+	}
+
+	if(stream->state != eOCPP_JSON_STREAM_DONE){
+		ESP_LOGW(TAG, "Value incomplete after %zu bytes", stream->consumed);
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	*root_out = stream->root;
+	stream->root = NULL;
+
+	return ESP_OK;
+}
@@ -8,6 +8,7 @@
 #endif
 
 #include "ocpp_listener.h"
+#include "ocpp_json_stream.h"
 #include "ocpp_task.h"
 #include "ocpp_call_with_cb.h"
 #include "messages/error_messages/ocpp_call_error.h"
@@ -16,9 +17,15 @@ static const char * TAG = "OCPP_LISTENER";
 static TaskHandle_t task_to_notify = NULL;
 static uint notify_offset = 0;
 
-static const size_t MAX_DYNAMIC_BUFFER_SIZE = 32768;
-static char * dynamic_buffer = NULL; // Used if payload is larger than websocket rx_buffer
-static bool dynamic_failed = false;
+/*
+ * Frames are parsed as they arrive instead of being copied into a buffer first. Payloads exceeding the websocket
+ * rx_buffer are therefore not limited in size, but no single string may exceed the size frames were limited to before.
+ */
+static const size_t MAX_TOKEN_LENGTH = 32768;
+static struct ocpp_json_stream frame_stream;
+static bool frame_stream_initialized = false;
+static bool frame_failed = false;
+static size_t largest_frame = 0;
 
 struct ocpp_call_callback_with_data{
 	ocpp_call_callback cb;
@@ -26,16 +33,22 @@ struct ocpp_call_callback_with_data{
 };
 
 static struct ocpp_call_callback_with_data callbacks[OCPP_CALL_ACTION_ID_COUNT] = {0};
+static const struct ocpp_call_element_stream * element_streams[OCPP_CALL_ACTION_ID_COUNT] = {0};
+
+static int streamed_action_id = -1;
+static const char * streamed_path[OCPP_JSON_STREAM_MAX_PATH_LENGTH];
 
 void clean_listener(){
 	task_to_notify = NULL;
 	notify_offset = 0;
 
-	if(dynamic_buffer != NULL){
-		free(dynamic_buffer);
-		dynamic_buffer = NULL;
-		dynamic_failed = true;
+	if(frame_stream_initialized){
+		ocpp_json_stream_deinit(&frame_stream);
+		frame_stream_initialized = false;
+		frame_failed = true;
 	}
+
+	streamed_action_id = -1;
 }
 
 void ocpp_configure_websocket_notification(TaskHandle_t task, uint offset){
@@ -56,6 +69,17 @@ int attach_call_cb(enum ocpp_call_action_id action_id, ocpp_call_callback call_c
 	return 0;
 }
 
+int attach_call_element_stream(enum ocpp_call_action_id action_id, const struct ocpp_call_element_stream * stream){
+	if(stream != NULL && stream->path_length + 1 > OCPP_JSON_STREAM_MAX_PATH_LENGTH){
+		ESP_LOGE(TAG, "Unable to attach element stream, path too long");
+		return -1;
+	}
+
+	element_streams[action_id] = stream;
+
+	return 0;
+}
+
 static int ocpp_parse_message(cJSON * ocpp_call, int * message_type_id_out, char ** unique_id_out, char ** action_out, cJSON ** payload, char ** error_code_out, char ** error_description_out, cJSON ** error_details){
 	if(cJSON_IsArray(ocpp_call)){
 		*message_type_id_out = cJSON_GetArrayItem(ocpp_call, 0)->valueint;
@@ -196,14 +220,7 @@ int call_handler(esp_websocket_client_handle_t client, const char * unique_id, c
 extern bool request_trace_match;
 #endif
 
-void text_frame_handler(esp_websocket_client_handle_t client, const char * data){
-	cJSON * ocpp_request = cJSON_Parse(data);
-
-	if(ocpp_request == NULL){
-		ESP_LOGE(TAG, "Unable to parse text frame");
-		return;
-	}
-
+static void message_handler(esp_websocket_client_handle_t client, cJSON * ocpp_request){
 	int message_type_id;
 	char * unique_id;
 	char * action;
@@ -247,6 +264,105 @@ void text_frame_handler(esp_websocket_client_handle_t client, const char * data)
 #endif /* CONFIG_OCPP_TRACE_MEMORY_FOR_REQ_SEND */
 }
 
+/*
+ * Selects the array to stream once the action of a call is known. The action is the third element of the frame and is
+ * always complete before the payload starts.
+ */
+static void frame_child_cb(struct ocpp_json_stream * stream, cJSON * root, size_t index, void * cb_data){
+	if(index != 2)
+		return;
+
+	cJSON * message_type_id = cJSON_GetArrayItem(root, 0);
+	cJSON * action = cJSON_GetArrayItem(root, 2);
+
+	if(!cJSON_IsNumber(message_type_id) || message_type_id->valueint != eOCPPJ_MESSAGE_ID_CALL || !cJSON_IsString(action))
+		return;
+
+	enum ocpp_call_action_id action_id = action_id_from_action(action->valuestring);
+	if(action_id == -1 || element_streams[action_id] == NULL || callbacks[action_id].cb == NULL)
+		return;
+
+	if(check_call_validity(action->valuestring))
+		return;
+
+	const struct ocpp_call_element_stream * element_stream = element_streams[action_id];
+
+	streamed_path[0] = "3"; // Index of the payload in a call
+	for(size_t i = 0; i < element_stream->path_length; i++)
+		streamed_path[i + 1] = element_stream->path[i];
+
+	if(ocpp_json_stream_set_array_path(stream, streamed_path, element_stream->path_length + 1) != ESP_OK){
+		ESP_LOGE(TAG, "Unable to stream elements of '%s'", action->valuestring);
+		return;
+	}
+
+	streamed_action_id = action_id;
+	element_stream->begin(callbacks[action_id].cb_data);
+}
+
+static int frame_element_cb(cJSON * element, size_t index, void * cb_data){
+	if(streamed_action_id == -1)
+		return -1;
+
+	return element_streams[streamed_action_id]->element(element, index, callbacks[streamed_action_id].cb_data);
+}
+
+static void text_frame_begin(){
+	if(!frame_stream_initialized){
+		ocpp_json_stream_init(&frame_stream, MAX_TOKEN_LENGTH, frame_child_cb, frame_element_cb, NULL);
+		frame_stream_initialized = true;
+	}
+
+	ocpp_json_stream_reset(&frame_stream);
+	streamed_action_id = -1;
+	frame_failed = false;
+}
+
+static void text_frame_end(){
+	ocpp_json_stream_reset(&frame_stream);
+	streamed_action_id = -1;
+}
+
+static void text_frame_handler(esp_websocket_client_handle_t client, esp_websocket_event_data_t * data){
+	if(data->payload_offset == 0){
+		text_frame_begin();
+
+		if(data->payload_len > data->data_len)
+			ESP_LOGI(TAG, "Parsing fragmented websocket request. Size %d", data->payload_len);
+
+		if(data->payload_len > largest_frame)
+			largest_frame = data->payload_len;
+
+	}else if(!frame_stream_initialized){
+		ESP_LOGE(TAG, "Got fragment of frame without start");
+		return;
+	}
+
+	if(frame_failed) // Remaining fragments of a frame that could not be parsed
+		return;
+
+	if(ocpp_json_stream_feed(&frame_stream, data->data_ptr, data->data_len) != ESP_OK){
+		ESP_LOGE(TAG, "Unable to parse text frame");
+		frame_failed = true;
+		text_frame_end();
+		return;
+	}
+
+	if(data->payload_offset + data->data_len < data->payload_len)
+		return;
+
+	cJSON * ocpp_request;
+	if(ocpp_json_stream_finish(&frame_stream, &ocpp_request) != ESP_OK){
+		ESP_LOGE(TAG, "Unable to parse text frame");
+		frame_failed = true;
+		text_frame_end();
+		return;
+	}
+
+	text_frame_end();
+	message_handler(client, ocpp_request);
+}
+
 cJSON * ocpp_listener_get_diagnostics(){
 	cJSON * res = cJSON_CreateObject();
 	if(res == NULL){
@@ -254,8 +370,9 @@ cJSON * ocpp_listener_get_diagnostics(){
 		return res;
 	}
 
-	cJSON_AddBoolToObject(res, "dynamic_buffer exists", dynamic_buffer != NULL);
-	cJSON_AddBoolToObject(res, "dynamic_failed", dynamic_failed);
+	cJSON_AddBoolToObject(res, "partial frame", frame_stream_initialized && frame_stream.depth > 0);
+	cJSON_AddBoolToObject(res, "frame_failed", frame_failed);
+	cJSON_AddNumberToObject(res, "largest frame", largest_frame);
 	return res;
 }
 
@@ -281,48 +398,7 @@ void websocket_event_handler(void *handler_args, esp_event_base_t base, int32_t
 			break;
 		case WS_TRANSPORT_OPCODES_TEXT:
 			ESP_LOGD(TAG, "Handle text frame");
-
-			if(data->payload_len > data->data_len){ // If payload exceed websocket rx_buffer
-				if(data->payload_len > MAX_DYNAMIC_BUFFER_SIZE){
-					ESP_LOGE(TAG, "Unable to handle websocket request: request size too large: %d", data->payload_len);
-					break;
-				}
-
-				if(data->payload_offset == 0){
-					ESP_LOGW(TAG, "Allocating buffer for unusually large websocket request. Size %d", data->payload_len);
-					if(dynamic_buffer != NULL)
-						free(dynamic_buffer);
-
-					dynamic_buffer = malloc(sizeof(char) * (data->payload_len + 1));
-					if(dynamic_buffer == NULL){
-						ESP_LOGE(TAG, "Unable to allocate additional websocket buffer");
-						dynamic_failed = true;
-						break;
-					}
-
-					ESP_LOGI(TAG, "Allocation successfull");
-					dynamic_failed = false;
-				}
-
-				if(!dynamic_failed){
-					ESP_LOGI(TAG, "Copying to allocated buffer | from %d to %d | size: %d", data->payload_offset, data->payload_offset + data->data_len, data->payload_len);
-					memcpy(dynamic_buffer + data->payload_offset, data->data_ptr, data->data_len);
-
-					if(data->payload_offset + data->data_len == data->payload_len){
-						dynamic_buffer[data->payload_len] = '\0';
-
-						ESP_LOGI(TAG, "Completed buffer, executing request");
-						text_frame_handler(client, dynamic_buffer);
-
-						free(dynamic_buffer);
-						dynamic_buffer = NULL;
-						dynamic_failed = true;
-					}
-				}
-				break;
-			}
-
-			text_frame_handler(client, data->data_ptr);
+			text_frame_handler(client, data);
 			break;
 		case WS_TRANSPORT_OPCODES_BINARY:
 			ESP_LOGE(TAG, "Got unexpected binary frame");
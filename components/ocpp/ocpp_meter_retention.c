@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "ocpp_meter_retention.h"
+
+static const char * TAG = "OCPP RETENTION ";
+
+#define NO_RECORD UINT16_MAX
+
+/* Limits the weight of values on large multiples of the boundary interval */
+#define MAX_ALIGNMENT_DOUBLINGS 6
+
+void ocpp_meter_retention_record_from_list(struct ocpp_meter_value_list * list, bool is_stop_txn_data, size_t size,
+					struct ocpp_retention_record * record_out){
+
+	memset(record_out, 0, sizeof(struct ocpp_retention_record));
+	record_out->size = (size > UINT16_MAX) ? UINT16_MAX : size;
+
+	if(is_stop_txn_data)
+		record_out->flags |= OCPP_RETENTION_RECORD_PROTECTED;
+
+	bool has_overall_energy = false;
+	for(; list != NULL; list = list->next){
+		if(list->value == NULL)
+			continue;
+
+		if(record_out->timestamp == 0)
+			record_out->timestamp = list->value->timestamp;
+
+		for(struct ocpp_sampled_value_list * sampled = list->value->sampled_value; sampled != NULL; sampled = sampled->next){
+			struct ocpp_sampled_value * value = sampled->value;
+			if(value == NULL)
+				continue;
+
+			if(value->context == eOCPP_CONTEXT_SAMPLE_CLOCK)
+				record_out->flags |= OCPP_RETENTION_RECORD_CLOCK_ALIGNED;
+
+			// Measurand and unit default to Energy.Active.Import.Register and Wh when absent
+			if((value->measurand != 0 && value->measurand != eOCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER)
+				|| has_overall_energy)
+				continue;
+
+			char * end;
+			float energy = strtof(value->value, &end);
+			if(end == value->value)
+				continue;
+
+			if(value->unit == eOCPP_UNIT_KWH)
+				energy *= 1000.0f;
+
+			// Prefer the overall register over the register of a single phase
+			if(!(record_out->flags & OCPP_RETENTION_RECORD_HAS_ENERGY) || value->phase == 0){
+				record_out->energy_wh = energy;
+				record_out->flags |= OCPP_RETENTION_RECORD_HAS_ENERGY;
+				has_overall_energy = (value->phase == 0);
+			}
+		}
+	}
+}
+
+/*
+ * Kept records are linked with prev and next. Records that can be dropped are in a binary min heap ordered by score,
+ * with heap_position giving each record's position so that the score can be updated when a neighbour is dropped.
+ */
+struct thin_state{
+	const struct ocpp_retention_policy * policy;
+	struct ocpp_retention_record * records;
+	time_t newest;
+	uint16_t * prev;
+	uint16_t * next;
+	uint16_t * heap;
+	uint16_t * heap_position;
+	float * score;
+	size_t heap_length;
+};
+
+static float alignment_weight(const struct ocpp_retention_policy * policy, const struct ocpp_retention_record * record){
+	if(!(record->flags & OCPP_RETENTION_RECORD_CLOCK_ALIGNED))
+		return 1.0f;
+
+	float weight = 2.0f;
+	if(policy->boundary_sec == 0 || record->timestamp % policy->boundary_sec != 0)
+		return weight;
+
+	time_t multiple = record->timestamp / policy->boundary_sec;
+	weight *= 2.0f;
+
+	for(size_t i = 0; i < MAX_ALIGNMENT_DOUBLINGS && multiple != 0 && multiple % 2 == 0; i++){
+		weight *= 2.0f;
+		multiple /= 2;
+	}
+
+	return weight;
+}
+
+static bool is_energy_extreme(const struct ocpp_retention_record * before, const struct ocpp_retention_record * record,
+			const struct ocpp_retention_record * after){
+
+	if(!(record->flags & OCPP_RETENTION_RECORD_HAS_ENERGY))
+		return false;
+
+	if(!(before->flags & OCPP_RETENTION_RECORD_HAS_ENERGY) || !(after->flags & OCPP_RETENTION_RECORD_HAS_ENERGY))
+		return false;
+
+	return (record->energy_wh > before->energy_wh && record->energy_wh > after->energy_wh)
+		|| (record->energy_wh < before->energy_wh && record->energy_wh < after->energy_wh);
+}
+
+/*
+ * The score is the gap left by dropping the record relative to its age. Dropping the lowest score first keeps the
+ * resolution roughly proportional to age.
+ */
+static bool score_record(struct thin_state * state, uint16_t index, float * score_out){
+	const struct ocpp_retention_record * record = &state->records[index];
+
+	if(record->flags & (OCPP_RETENTION_RECORD_PROTECTED | OCPP_RETENTION_RECORD_DROPPED))
+		return false;
+
+	uint16_t before = state->prev[index];
+	uint16_t after = state->next[index];
+	if(before == NO_RECORD || after == NO_RECORD)
+		return false;
+
+	time_t age = state->newest - record->timestamp;
+	if(age < 0)
+		age = 0;
+
+	if(age < state->policy->full_resolution_sec)
+		return false;
+
+	if(is_energy_extreme(&state->records[before], record, &state->records[after]))
+		return false;
+
+	time_t gap = state->records[after].timestamp - state->records[before].timestamp;
+	if(gap < 0)
+		gap = 0;
+
+	*score_out = (float)(gap + 1) * alignment_weight(state->policy, record)
+		/ (float)(age + state->policy->full_resolution_sec + 1);
+
+	return true;
+}
+
+static void heap_swap(struct thin_state * state, size_t a, size_t b){
+	uint16_t tmp = state->heap[a];
+	state->heap[a] = state->heap[b];
+	state->heap[b] = tmp;
+
+	state->heap_position[state->heap[a]] = a;
+	state->heap_position[state->heap[b]] = b;
+}
+
+static void heap_sift_up(struct thin_state * state, size_t position){
+	while(position > 0){
+		size_t parent = (position - 1) / 2;
+		if(state->score[state->heap[parent]] <= state->score[state->heap[position]])
+			break;
+
+		heap_swap(state, parent, position);
+		position = parent;
+	}
+}
+
+static void heap_sift_down(struct thin_state * state, size_t position){
+	while(true){
+		size_t smallest = position;
+		size_t left = position * 2 + 1;
+		size_t right = left + 1;
+
+		if(left < state->heap_length && state->score[state->heap[left]] < state->score[state->heap[smallest]])
+			smallest = left;
+
+		if(right < state->heap_length && state->score[state->heap[right]] < state->score[state->heap[smallest]])
+			smallest = right;
+
+		if(smallest == position)
+			break;
+
+		heap_swap(state, smallest, position);
+		position = smallest;
+	}
+}
+
+static void heap_remove(struct thin_state * state, uint16_t index){
+	size_t position = state->heap_position[index];
+	if(position == NO_RECORD)
+		return;
+
+	state->heap_length--;
+	if(position != state->heap_length){
+		heap_swap(state, position, state->heap_length);
+		heap_sift_up(state, position);
+		heap_sift_down(state, position);
+	}
+
+	state->heap_position[index] = NO_RECORD;
+}
+
+static void heap_update(struct thin_state * state, uint16_t index){
+	if(index == NO_RECORD)
+		return;
+
+	float score;
+	if(!score_record(state, index, &score)){
+		heap_remove(state, index);
+		return;
+	}
+
+	state->score[index] = score;
+
+	size_t position = state->heap_position[index];
+	if(position == NO_RECORD){
+		position = state->heap_length++;
+		state->heap[position] = index;
+		state->heap_position[index] = position;
+	}
+
+	heap_sift_up(state, position);
+	heap_sift_down(state, state->heap_position[index]);
+}
+
+size_t ocpp_meter_retention_thin(const struct ocpp_retention_policy * policy, struct ocpp_retention_record * records,
+				size_t record_count, size_t bytes_to_free){
+
+	if(record_count > OCPP_RETENTION_MAX_RECORDS){
+		ESP_LOGW(TAG, "Only the first %d of %zu records will be considered", OCPP_RETENTION_MAX_RECORDS, record_count);
+		record_count = OCPP_RETENTION_MAX_RECORDS;
+	}
+
+	if(record_count < 3 || bytes_to_free == 0)
+		return 0;
+
+	struct thin_state state = {
+		.policy = policy,
+		.records = records,
+		.newest = records[0].timestamp,
+	};
+
+	uint16_t * buffer = malloc(record_count * (sizeof(uint16_t) * 4 + sizeof(float)));
+	if(buffer == NULL){
+		ESP_LOGE(TAG, "Unable to allocate buffer to thin %zu records", record_count);
+		return 0;
+	}
+
+	state.prev = buffer;
+	state.next = state.prev + record_count;
+	state.heap = state.next + record_count;
+	state.heap_position = state.heap + record_count;
+	state.score = (float *)(state.heap_position + record_count);
+
+	for(size_t i = 0; i < record_count; i++){
+		state.prev[i] = (i == 0) ? NO_RECORD : i - 1;
+		state.next[i] = (i == record_count - 1) ? NO_RECORD : i + 1;
+		state.heap_position[i] = NO_RECORD;
+
+		if(records[i].timestamp > state.newest)
+			state.newest = records[i].timestamp;
+	}
+
+	for(size_t i = 0; i < record_count; i++){
+		float score;
+		if(score_record(&state, i, &score)){
+			state.score[i] = score;
+			state.heap[state.heap_length] = i;
+			state.heap_position[i] = state.heap_length++;
+		}
+	}
+
+	for(size_t i = state.heap_length / 2; i > 0; i--)
+		heap_sift_down(&state, i - 1);
+
+	size_t freed = 0;
+	size_t dropped = 0;
+
+	while(freed < bytes_to_free && state.heap_length > 0){
+		uint16_t index = state.heap[0];
+		heap_remove(&state, index);
+
+		records[index].flags |= OCPP_RETENTION_RECORD_DROPPED;
+		freed += records[index].size;
+		dropped++;
+
+		uint16_t before = state.prev[index];
+		uint16_t after = state.next[index];
+		state.next[before] = after;
+		state.prev[after] = before;
+
+		heap_update(&state, before);
+		heap_update(&state, after);
+	}
+
+	free(buffer);
+
+	ESP_LOGI(TAG, "Dropped %zu of %zu records, freeing %zu of %zu requested bytes", dropped, record_count, freed, bytes_to_free);
+	return freed;
+}
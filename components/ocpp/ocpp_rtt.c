@@ -0,0 +1,186 @@
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "ocpp_rtt.h"
+
+static const char * TAG = "OCPP RTT       ";
+
+/*
+ * Roughly logarithmic buckets from LAN round trips to the largest MessageTimeout we expect to be configured. Samples
+ * above the second to last limit are counted in the last bucket.
+ */
+static const uint32_t bucket_limits[OCPP_RTT_HISTOGRAM_BUCKETS -1] = {
+	25, 50, 100, 150, 200, 300, 400, 600, 800, 1200, 1600, 2400, 3200, 4800, 6400, 9600, 12800, 19200, 25600
+};
+
+/* Limits samples so that the scaled estimates can not overflow */
+#define RTT_SAMPLE_MAX_MS (10 * 60 * 1000)
+
+void ocpp_rtt_reset(struct ocpp_rtt_stats * stats){
+	memset(stats, 0, sizeof(struct ocpp_rtt_stats));
+}
+
+uint32_t ocpp_rtt_bucket_limit(size_t bucket){
+	if(bucket >= OCPP_RTT_HISTOGRAM_BUCKETS -1)
+		return UINT32_MAX;
+
+	return bucket_limits[bucket];
+}
+
+static size_t bucket_from_rtt(uint32_t rtt_ms){
+	size_t bucket = 0;
+	while(bucket < OCPP_RTT_HISTOGRAM_BUCKETS -1 && rtt_ms >= bucket_limits[bucket])
+		bucket++;
+
+	return bucket;
+}
+
+void ocpp_rtt_add_sample(struct ocpp_rtt_stats * stats, uint32_t rtt_ms){
+	if(rtt_ms > RTT_SAMPLE_MAX_MS)
+		rtt_ms = RTT_SAMPLE_MAX_MS;
+
+	if(stats->sample_count == 0){
+		stats->srtt_x8 = rtt_ms << 3;
+		stats->rttvar_x4 = rtt_ms << 1;
+		stats->min_ms = rtt_ms;
+		stats->max_ms = rtt_ms;
+
+	}else{
+		/* RFC 6298 with alpha 1/8 and beta 1/4 on scaled values */
+		int64_t delta = (int64_t)rtt_ms - (stats->srtt_x8 >> 3);
+		stats->srtt_x8 = (uint32_t)((int64_t)stats->srtt_x8 + delta);
+
+		if(delta < 0)
+			delta = -delta;
+
+		stats->rttvar_x4 = (uint32_t)((int64_t)stats->rttvar_x4 + delta - (stats->rttvar_x4 >> 2));
+
+		if(rtt_ms < stats->min_ms)
+			stats->min_ms = rtt_ms;
+
+		if(rtt_ms > stats->max_ms)
+			stats->max_ms = rtt_ms;
+	}
+
+	if(stats->sample_count < UINT32_MAX)
+		stats->sample_count++;
+
+	stats->backoff = 0;
+
+	if(stats->histogram_count >= OCPP_RTT_HISTOGRAM_DECAY_COUNT){
+		stats->histogram_count = 0;
+
+		for(size_t i = 0; i < OCPP_RTT_HISTOGRAM_BUCKETS; i++){
+			stats->histogram[i] >>= 1;
+			stats->histogram_count += stats->histogram[i];
+		}
+	}
+
+	stats->histogram[bucket_from_rtt(rtt_ms)]++;
+	stats->histogram_count++;
+}
+
+void ocpp_rtt_add_timeout(struct ocpp_rtt_stats * stats){
+	if(stats->timeout_count < UINT32_MAX)
+		stats->timeout_count++;
+
+	if(stats->backoff < OCPP_RTT_MAX_BACKOFF)
+		stats->backoff++;
+}
+
+uint32_t ocpp_rtt_percentile(const struct ocpp_rtt_stats * stats, uint8_t percent){
+	if(stats->histogram_count == 0)
+		return 0;
+
+	if(percent > 100)
+		percent = 100;
+
+	uint32_t target = ((uint32_t)stats->histogram_count * percent + 99) / 100;
+	if(target == 0)
+		target = 1;
+
+	uint32_t count = 0;
+	for(size_t i = 0; i < OCPP_RTT_HISTOGRAM_BUCKETS; i++){
+		count += stats->histogram[i];
+
+		if(count >= target){
+			uint32_t limit = ocpp_rtt_bucket_limit(i);
+			return limit < stats->max_ms ? limit : stats->max_ms;
+		}
+	}
+
+	return stats->max_ms;
+}
+
+uint32_t ocpp_rtt_smoothed(const struct ocpp_rtt_stats * stats){
+	return stats->srtt_x8 >> 3;
+}
+
+bool ocpp_rtt_is_usable(const struct ocpp_rtt_stats * stats){
+	return stats->sample_count >= OCPP_RTT_MIN_SAMPLES;
+}
+
+uint32_t ocpp_rtt_timeout(const struct ocpp_rtt_stats * stats, uint32_t min_ms, uint32_t max_ms){
+	if(!ocpp_rtt_is_usable(stats))
+		return max_ms;
+
+	/* RTO = SRTT + 4 * RTTVAR, but not lower than the recent tail of the distribution */
+	uint64_t timeout = (stats->srtt_x8 >> 3) + stats->rttvar_x4;
+
+	uint32_t tail = ocpp_rtt_percentile(stats, 99);
+	if(tail > timeout)
+		timeout = tail;
+
+	timeout <<= stats->backoff;
+
+	if(timeout < min_ms)
+		timeout = min_ms;
+
+	if(timeout > max_ms)
+		timeout = max_ms;
+
+	return timeout;
+}
+
+cJSON * ocpp_rtt_to_json(const struct ocpp_rtt_stats * stats){
+	cJSON * res = cJSON_CreateObject();
+	if(res == NULL){
+		ESP_LOGE(TAG, "Unable to create rtt diagnostics");
+		return NULL;
+	}
+
+	cJSON_AddNumberToObject(res, "samples", stats->sample_count);
+	cJSON_AddNumberToObject(res, "timeouts", stats->timeout_count);
+	cJSON_AddNumberToObject(res, "srtt", ocpp_rtt_smoothed(stats));
+	cJSON_AddNumberToObject(res, "rttvar", stats->rttvar_x4 >> 2);
+	cJSON_AddNumberToObject(res, "min", stats->min_ms);
+	cJSON_AddNumberToObject(res, "max", stats->max_ms);
+	cJSON_AddNumberToObject(res, "p50", ocpp_rtt_percentile(stats, 50));
+	cJSON_AddNumberToObject(res, "p90", ocpp_rtt_percentile(stats, 90));
+	cJSON_AddNumberToObject(res, "p99", ocpp_rtt_percentile(stats, 99));
+	cJSON_AddNumberToObject(res, "backoff", stats->backoff);
+
+	/* Trailing empty buckets are omitted */
+	size_t used_buckets = OCPP_RTT_HISTOGRAM_BUCKETS;
+	while(used_buckets > 0 && stats->histogram[used_buckets -1] == 0)
+		used_buckets--;
+
+	cJSON * histogram = cJSON_AddArrayToObject(res, "histogram");
+	if(histogram == NULL){
+		cJSON_Delete(res);
+		return NULL;
+	}
+
+	for(size_t i = 0; i < used_buckets; i++){
+		cJSON * count = cJSON_CreateNumber(stats->histogram[i]);
+		if(count == NULL){
+			cJSON_Delete(res);
+			return NULL;
+		}
+
+		cJSON_AddItemToArray(histogram, count);
+	}
+
+	return res;
+}
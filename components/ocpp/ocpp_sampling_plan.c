@@ -0,0 +1,228 @@
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "esp_log.h"
+
+#include "ocpp_sampling_plan.h"
+
+static const char * TAG = "OCPP SAMPLING  ";
+
+/*
+ * Longest measurand is 31 characters and may be followed by a phase. Longer items can not be valid.
+ */
+#define CSL_ITEM_MAX_LENGTH 48
+
+static esp_err_t add_item(struct ocpp_sampling_plan * plan, struct ocpp_sampling_plan_group * group, enum ocpp_phase_id phase,
+			enum ocpp_location_id location, enum ocpp_unit_id unit, enum ocpp_sample_source source, uint8_t decimals){
+
+	if(plan->item_count >= OCPP_SAMPLING_PLAN_MAX_ITEMS)
+		return ESP_ERR_INVALID_SIZE;
+
+	struct ocpp_sampling_plan_item * item = &plan->items[plan->item_count++];
+
+	item->measurand = group->measurand;
+	item->phase = phase;
+	item->location = location;
+	item->unit = unit;
+	item->source = source;
+	item->decimals = decimals;
+
+	plan->source_mask |= (1u << source);
+	group->item_count++;
+
+	return ESP_OK;
+}
+
+/*
+ * Adds one item per phase matching the requested phase. The sources for L1 to L3 are expected to be consecutive.
+ */
+static esp_err_t add_phase_items(struct ocpp_sampling_plan * plan, struct ocpp_sampling_plan_group * group, enum ocpp_phase_id phase,
+				enum ocpp_location_id location, enum ocpp_unit_id unit, enum ocpp_sample_source l1_source, uint8_t decimals){
+
+	for(enum ocpp_phase_id current = eOCPP_PHASE_L1; current <= eOCPP_PHASE_L3; current++){
+		if(phase != 0 && phase != current)
+			continue;
+
+		esp_err_t err = add_item(plan, group, current, location, unit, l1_source + (current - eOCPP_PHASE_L1), decimals);
+		if(err != ESP_OK)
+			return err;
+	}
+
+	return ESP_OK;
+}
+
+static enum ocpp_phase_id item_split_phase(char * item){
+	char * phase_index = rindex(item, '.');
+	if(phase_index == NULL)
+		return 0;
+
+	enum ocpp_phase_id phase;
+	if(strcasecmp(phase_index + 1, OCPP_PHASE_L1) == 0){
+		phase = eOCPP_PHASE_L1;
+	}else if(strcasecmp(phase_index + 1, OCPP_PHASE_L2) == 0){
+		phase = eOCPP_PHASE_L2;
+	}else if(strcasecmp(phase_index + 1, OCPP_PHASE_L3) == 0){
+		phase = eOCPP_PHASE_L3;
+	}else{
+		return 0;
+	}
+
+	*phase_index = '\0';
+	return phase;
+}
+
+static esp_err_t compile_group(struct ocpp_sampling_plan * plan, struct ocpp_sampling_plan_group * group, enum ocpp_phase_id phase,
+			unsigned int connector_id, bool single_phase){
+
+	/*
+	 * Default to only report on active phases on measurands that are only reported on phases
+	 */
+	if(phase == 0 && single_phase && group->measurand != eOCPP_MEASURAND_TEMPERATURE)
+		phase = eOCPP_PHASE_L1;
+
+	switch(group->measurand){
+	case eOCPP_MEASURAND_CURRENT_IMPORT:
+		return add_phase_items(plan, group, phase, eOCPP_LOCATION_OUTLET, eOCPP_UNIT_A, eOCPP_SAMPLE_SOURCE_CURRENT_L1, 1);
+
+	case eOCPP_MEASURAND_CURRENT_OFFERED:
+		return add_item(plan, group, 0, 0, eOCPP_UNIT_A, eOCPP_SAMPLE_SOURCE_CURRENT_OFFERED, 1);
+
+	case eOCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER:
+		return add_item(plan, group, 0, 0, eOCPP_UNIT_WH, eOCPP_SAMPLE_SOURCE_ENERGY_REGISTER, 0);
+
+	case eOCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_INTERVAL:
+		group->interval = true;
+		return add_item(plan, group, 0, 0, eOCPP_UNIT_KWH, eOCPP_SAMPLE_SOURCE_ENERGY_INTERVAL, 2);
+
+	case eOCPP_MEASURAND_POWER_ACTIVE_IMPORT:
+		return add_item(plan, group, 0, eOCPP_LOCATION_OUTLET, eOCPP_UNIT_W, eOCPP_SAMPLE_SOURCE_POWER, 1);
+
+	case eOCPP_MEASURAND_TEMPERATURE:
+		if(connector_id == 0 && phase == 0){
+			esp_err_t err = add_item(plan, group, 0, eOCPP_LOCATION_BODY, eOCPP_UNIT_CELSIUS,
+						eOCPP_SAMPLE_SOURCE_TEMPERATURE_BODY_1, 1);
+			if(err != ESP_OK)
+				return err;
+
+			return add_item(plan, group, 0, eOCPP_LOCATION_BODY, eOCPP_UNIT_CELSIUS,
+					eOCPP_SAMPLE_SOURCE_TEMPERATURE_BODY_2, 1);
+
+		}else if(connector_id == 1){
+			if(phase == 0 && single_phase)
+				phase = eOCPP_PHASE_L1;
+
+			return add_phase_items(plan, group, phase, eOCPP_LOCATION_OUTLET, eOCPP_UNIT_CELSIUS,
+					eOCPP_SAMPLE_SOURCE_TEMPERATURE_L1, 1);
+		}
+		return ESP_OK;
+
+	case eOCPP_MEASURAND_VOLTAGE:
+		return add_phase_items(plan, group, phase, eOCPP_LOCATION_OUTLET, eOCPP_UNIT_V, eOCPP_SAMPLE_SOURCE_VOLTAGE_L1, 1);
+
+	default:
+		ESP_LOGE(TAG, "Invalid measurand '%s'!!", ocpp_measurand_from_id(group->measurand));
+		return ESP_OK;
+	}
+}
+
+esp_err_t ocpp_sampling_plan_compile(struct ocpp_sampling_plan * plan, const char * measurand_csl, unsigned int connector_id,
+				bool single_phase){
+
+	memset(plan, 0, sizeof(struct ocpp_sampling_plan));
+
+	if(measurand_csl == NULL)
+		return ESP_OK;
+
+	const char * item_start = measurand_csl;
+	while(*item_start != '\0'){
+		const char * item_end = strchr(item_start, ',');
+		if(item_end == NULL)
+			item_end = item_start + strlen(item_start);
+
+		size_t item_length = item_end - item_start;
+		const char * next = (*item_end == ',') ? item_end + 1 : item_end;
+
+		if(item_length == 0){
+			item_start = next;
+			continue;
+		}
+
+		if(item_length >= CSL_ITEM_MAX_LENGTH){
+			ESP_LOGW(TAG, "Ignoring measurand list item of length %zu", item_length);
+			item_start = next;
+			continue;
+		}
+
+		if(plan->group_count >= OCPP_SAMPLING_PLAN_MAX_GROUPS){
+			ESP_LOGE(TAG, "Measurand list has more than %d items", OCPP_SAMPLING_PLAN_MAX_GROUPS);
+			return ESP_ERR_INVALID_SIZE;
+		}
+
+		char item[CSL_ITEM_MAX_LENGTH];
+		memcpy(item, item_start, item_length);
+		item[item_length] = '\0';
+
+		enum ocpp_phase_id phase = item_split_phase(item);
+
+		struct ocpp_sampling_plan_group * group = &plan->groups[plan->group_count];
+		memset(group, 0, sizeof(struct ocpp_sampling_plan_group));
+
+		group->measurand = ocpp_measurand_to_id(item);
+		group->phase = phase;
+		group->first_item = plan->item_count;
+
+		if(group->measurand == 0){
+			ESP_LOGW(TAG, "Unknown measurand '%s'", item);
+
+		}else{
+			esp_err_t err = compile_group(plan, group, phase, connector_id, single_phase);
+			if(err != ESP_OK){
+				ESP_LOGE(TAG, "Sampling plan has more than %d values", OCPP_SAMPLING_PLAN_MAX_ITEMS);
+				plan->item_count = group->first_item;
+				return err;
+			}
+
+			// Measurands not supported on the connector are left out instead of creating empty meter values
+			if(group->item_count > 0)
+				plan->group_count++;
+		}
+
+		item_start = next;
+	}
+
+	return ESP_OK;
+}
+
+size_t ocpp_sampling_plan_sample_group(const struct ocpp_sampling_plan * plan, size_t group_index,
+				const struct ocpp_sample_snapshot * snapshot, enum ocpp_reading_context_id context,
+				struct ocpp_sampled_value * values_out){
+
+	if(group_index >= plan->group_count)
+		return 0;
+
+	const struct ocpp_sampling_plan_group * group = &plan->groups[group_index];
+	size_t count = 0;
+
+	for(size_t i = group->first_item; i < group->first_item + group->item_count; i++){
+		const struct ocpp_sampling_plan_item * item = &plan->items[i];
+		float reading = snapshot->value[item->source];
+
+		if(isnan(reading))
+			continue;
+
+		struct ocpp_sampled_value * value = &values_out[count++];
+
+		value->context = context;
+		value->format = eOCPP_FORMAT_RAW;
+		value->measurand = item->measurand;
+		value->phase = item->phase;
+		value->location = item->location;
+		value->unit = item->unit;
+
+		snprintf(value->value, sizeof(value->value), "%.*f", item->decimals, reading);
+	}
+
+	return count;
+}
@@ -6,6 +6,7 @@
 #include "esp_system.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #ifdef CONFIG_OCPP_TRACE_MEMORY
 #include "esp_heap_trace.h"
@@ -21,6 +22,7 @@
 #include "ocpp_task.h"
 #include "ocpp_transaction.h"
 #include "ocpp_listener.h"
+#include "ocpp_rtt.h"
 #include "messages/call_messages/ocpp_call_request.h"
 #include "ocpp_json/ocppj_message_structure.h"
 #include "ocpp_json/ocppj_validation.h"
@@ -76,6 +78,34 @@ static uint32_t ocpp_minimum_status_duration = 3;
 
 TimerHandle_t message_timeout_handle = NULL;
 
+/*
+ * Round trip times are tracked for each action the CP can send and for the connection as a whole. The timeout of a call
+ * is derived from the statistics of its action when they have enough samples, else from the connection statistics.
+ * The configured MessageTimeout is used as upper bound as the specification requires the call to be considered timed
+ * out at that point.
+ */
+static const char * rtt_actions[] = {
+	OCPPJ_ACTION_AUTORIZE,
+	OCPPJ_ACTION_BOOT_NOTIFICATION,
+	OCPPJ_ACTION_DATA_TRANSFER,
+	OCPPJ_ACTION_DIAGNOSTICS_STATUS_NOTIFICATION,
+	OCPPJ_ACTION_FIRMWARE_STATUS_NOTIFICATION,
+	OCPPJ_ACTION_HEARTBEAT,
+	OCPPJ_ACTION_METER_VALUES,
+	OCPPJ_ACTION_START_TRANSACTION,
+	OCPPJ_ACTION_STATUS_NOTIFICATION,
+	OCPPJ_ACTION_STOP_TRANSACTION,
+};
+
+#define RTT_ACTION_COUNT (sizeof(rtt_actions) / sizeof(rtt_actions[0]))
+
+static portMUX_TYPE rtt_lock = portMUX_INITIALIZER_UNLOCKED;
+static struct ocpp_rtt_stats rtt_connection;
+static struct ocpp_rtt_stats rtt_action[RTT_ACTION_COUNT];
+static int rtt_active_index = -1; // Index in rtt_actions of the active call or -1 if not tracked
+static int64_t rtt_active_sent_us = 0;
+static uint32_t rtt_active_timeout_ms = 0;
+
 struct ocpp_active_call * failed_transaction_call = NULL; // Transaction message that should be attempted again
 struct ocpp_active_call * awaiting_failed = NULL; // Transaction message that was attempted to be sent, but blocked by failed transaction.
 
@@ -272,12 +302,97 @@ void message_timeout(){
 		xTaskNotify(task_to_notify, eOCPP_TASK_CALL_TIMEOUT << task_notify_offset, eSetBits);
 }
 
-static void reset_message_timeout(){
+static int rtt_index_from_action(const char * action){
+	if(action == NULL)
+		return -1;
+
+	for(size_t i = 0; i < RTT_ACTION_COUNT; i++){
+		if(strcmp(rtt_actions[i], action) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+static uint32_t message_timeout_for_index(int index){
+	uint32_t max_ms = ocpp_call_timeout * 1000;
+
+#ifdef CONFIG_OCPP_ADAPTIVE_MESSAGE_TIMEOUT
+	uint32_t min_ms = CONFIG_OCPP_ADAPTIVE_MESSAGE_TIMEOUT_MIN_MS;
+	if(min_ms > max_ms)
+		min_ms = max_ms;
+
+	const struct ocpp_rtt_stats * stats = &rtt_connection;
+	if(index >= 0 && ocpp_rtt_is_usable(&rtt_action[index]))
+		stats = &rtt_action[index];
+
+	return ocpp_rtt_timeout(stats, min_ms, max_ms);
+#else
+	return max_ms;
+#endif /* CONFIG_OCPP_ADAPTIVE_MESSAGE_TIMEOUT */
+}
+
+/* Should be called before the call is sent, as the response may be handled before the send returns */
+static uint32_t rtt_call_sending(const char * action){
+	int index = rtt_index_from_action(action);
+
+	portENTER_CRITICAL(&rtt_lock);
+	rtt_active_index = index;
+	rtt_active_sent_us = esp_timer_get_time();
+	rtt_active_timeout_ms = message_timeout_for_index(index);
+	uint32_t timeout_ms = rtt_active_timeout_ms;
+	portEXIT_CRITICAL(&rtt_lock);
+
+	return timeout_ms;
+}
+
+static void rtt_call_answered(void){
+	int64_t now_us = esp_timer_get_time();
+
+	portENTER_CRITICAL(&rtt_lock);
+	if(rtt_active_sent_us != 0){
+		uint32_t rtt_ms = (now_us - rtt_active_sent_us) / 1000;
+
+		ocpp_rtt_add_sample(&rtt_connection, rtt_ms);
+		if(rtt_active_index >= 0)
+			ocpp_rtt_add_sample(&rtt_action[rtt_active_index], rtt_ms);
+
+		rtt_active_sent_us = 0;
+	}
+	portEXIT_CRITICAL(&rtt_lock);
+}
+
+static void rtt_call_timed_out(void){
+	portENTER_CRITICAL(&rtt_lock);
+	if(rtt_active_sent_us != 0){
+		ocpp_rtt_add_timeout(&rtt_connection);
+		if(rtt_active_index >= 0)
+			ocpp_rtt_add_timeout(&rtt_action[rtt_active_index]);
+
+		rtt_active_sent_us = 0;
+	}
+	portEXIT_CRITICAL(&rtt_lock);
+}
+
+static void rtt_reset(void){
+	portENTER_CRITICAL(&rtt_lock);
+	ocpp_rtt_reset(&rtt_connection);
+	for(size_t i = 0; i < RTT_ACTION_COUNT; i++)
+		ocpp_rtt_reset(&rtt_action[i]);
+
+	rtt_active_index = -1;
+	rtt_active_sent_us = 0;
+	rtt_active_timeout_ms = 0;
+	portEXIT_CRITICAL(&rtt_lock);
+}
+
+static void reset_message_timeout(uint32_t timeout_ms){
 	if(message_timeout_handle != NULL){
-		xTimerReset(message_timeout_handle, pdMS_TO_TICKS(100));
+		// Also starts the timer
+		xTimerChangePeriod(message_timeout_handle, pdMS_TO_TICKS(timeout_ms), pdMS_TO_TICKS(100));
 	}else{
 		message_timeout_handle = xTimerCreate("Ocpp message timeout",
-						pdMS_TO_TICKS(ocpp_call_timeout * 1000),
+						pdMS_TO_TICKS(timeout_ms),
 						pdFALSE, NULL, message_timeout);
 
 		if(message_timeout_handle == NULL){
@@ -303,9 +418,20 @@ int send_call_reply(cJSON * call){
 
 	cJSON_Delete(call);
 
-	int err = esp_websocket_client_send_text(client, message, strlen(message), pdMS_TO_TICKS(WEBSOCKET_WRITE_TIMEOUT));
+	int err = send_call_reply_text(message, strlen(message));
 	free(message);
 
+	return err;
+}
+
+int send_call_reply_text(const char * message, size_t length){
+	if(message == NULL){
+		ESP_LOGE(TAG, "Invalid call reply text: NULL");
+		return -1;
+	}
+
+	int err = esp_websocket_client_send_text(client, message, length, pdMS_TO_TICKS(WEBSOCKET_WRITE_TIMEOUT));
+
 	if(err == -1){
 		ESP_LOGE(TAG, "Error sending with websocket");
 		return -1;
@@ -511,6 +637,7 @@ BaseType_t handle_active_call_if_match(const char * unique_id, enum ocpp_message
 			}else{
 				//Call matches, remove it from the queue
 				xQueueReset(ocpp_active_call_queue); // Use reset as it cannot fail and recieve would not give more info
+				rtt_call_answered();
 #ifdef CONFIG_OCPP_TRACE_MEMORY_FOR_REQ_SEND
 				 // Checking pointer and not strcmp as cJSON should return same pointer and if it times out the pointer could be invalid
 				if(request_trace != NULL && active_id == request_trace){
@@ -570,6 +697,7 @@ void timeout_active_call(){
 	ESP_LOGE(TAG, "Unable to send to ocpp_active_call_queue: active timed out");
 	struct ocpp_active_call timed_out_call;
 	if(xQueueReceive(ocpp_active_call_queue, &timed_out_call, 0) == pdTRUE){
+		rtt_call_timed_out();
 		fail_active_call(&timed_out_call, OCPPJ_ERROR_INTERNAL, "CP timeout", NULL);
 	}else{
 		ESP_LOGE(TAG, "Unable to take timed out call, Did listener just receive it?");
@@ -802,6 +930,8 @@ esp_err_t send_next_call(int * remaining_call_count_out){
 	const char * active_call_id = ocppj_get_unique_id_from_call(call.call->call_message);
 	ESP_LOGI(TAG, "Sending next call (%s) [%s]", action, active_call_id != NULL ? active_call_id : "NULL");
 
+	uint32_t timeout_ms = rtt_call_sending(action);
+
 	ESP_LOGD(TAG, "websocket sending with client: %p, message (%p size %ul): '%s', wait: %d", client, message_string, (message_string != NULL) ? strlen(message_string) : 0, (message_string != NULL) ? message_string : "", WEBSOCKET_WRITE_TIMEOUT);
 	err = esp_websocket_client_send_text(client, message_string, strlen(message_string), pdMS_TO_TICKS(WEBSOCKET_WRITE_TIMEOUT));
 	free(message_string);
@@ -818,7 +948,7 @@ esp_err_t send_next_call(int * remaining_call_count_out){
 	last_call_timestamp = time(NULL);
 
 	reset_heartbeat_timer();
-	reset_message_timeout();
+	reset_message_timeout(timeout_ms);
 
 	return ESP_OK;
 }
@@ -965,6 +1095,7 @@ esp_err_t start_ocpp(struct ocpp_client_config * ocpp_config){
 
 	boot_retry_interval = CONFIG_OCPP_DEFAULT_BOOT_NOTIFICATION_INTERVAL_SEC;
 	last_call_timestamp = 0;
+	rtt_reset();
 
 	char uri[256];
 	int written_length = snprintf(uri, sizeof(uri), "%s/%s", current_config.url, current_config.cbid);
@@ -1375,6 +1506,29 @@ cJSON * ocpp_task_get_diagnostics(){
 	cJSON_AddBoolToObject(res, "active_call", (ocpp_active_call_queue != NULL && !uxQueueSpacesAvailable(ocpp_active_call_queue)));
 	cJSON_AddNumberToObject(res, "last_call_time", last_call_timestamp);
 
+	struct ocpp_rtt_stats stats;
+
+	portENTER_CRITICAL(&rtt_lock);
+	uint32_t timeout_ms = rtt_active_timeout_ms;
+	memcpy(&stats, &rtt_connection, sizeof(stats));
+	portEXIT_CRITICAL(&rtt_lock);
+
+	cJSON_AddNumberToObject(res, "message_timeout", timeout_ms);
+
+	cJSON * rtt = cJSON_AddObjectToObject(res, "rtt");
+	if(rtt != NULL){
+		cJSON_AddItemToObject(rtt, "connection", ocpp_rtt_to_json(&stats));
+
+		for(size_t i = 0; i < RTT_ACTION_COUNT; i++){
+			portENTER_CRITICAL(&rtt_lock);
+			memcpy(&stats, &rtt_action[i], sizeof(stats));
+			portEXIT_CRITICAL(&rtt_lock);
+
+			if(stats.sample_count > 0 || stats.timeout_count > 0)
+				cJSON_AddItemToObject(rtt, rtt_actions[i], ocpp_rtt_to_json(&stats));
+		}
+	}
+
 	return res;
 }
 
@@ -1,5 +1,6 @@
 #include <dirent.h>
 #include <math.h>
+#include <unistd.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
@@ -14,6 +15,10 @@
 #include "types/ocpp_id_token.h"
 #include "types/ocpp_charge_point_error_code.h"
 
+#ifdef CONFIG_OCPP_METER_VALUE_RETENTION
+#include "ocpp_meter_retention.h"
+#endif
+
 static const char * TAG = "OCPP OFFLINETXN";
 
 static SemaphoreHandle_t file_lock = NULL;
@@ -930,6 +935,8 @@ unsigned char * loaded_transaction_stop_meter_data = NULL;
 size_t loaded_transaction_size;
 int loaded_transaction_entry = -1;
 long loaded_transaction_on_confirmed_offset;
+long loaded_transaction_meter_end_offset; // End of the first loaded meter value
+size_t loaded_transaction_meter_count = 1; // Number of stored meter values covered by loaded message
 enum transaction_message_type_id loaded_transaction_type;
 
 void loaded_transaction_reset(){
@@ -939,6 +946,7 @@ void loaded_transaction_reset(){
 	loaded_transaction_entry = -1;
 	free(loaded_transaction_stop_meter_data);
 	loaded_transaction_stop_meter_data = NULL;
+	loaded_transaction_meter_count = 1;
 }
 
 /*
@@ -1297,6 +1305,8 @@ esp_err_t load_next_transaction_message(){
 			loaded_transaction_type = eTRANSACTION_TYPE_METER;
 			loaded_transaction_timestamp = timestamp;
 			loaded_transaction_on_confirmed_offset = ftell(fp);
+			loaded_transaction_meter_end_offset = loaded_transaction_on_confirmed_offset;
+			loaded_transaction_meter_count = 1;
 
 			bool is_stop_related;
 			if(ocpp_is_stop_txn_data_from_contiguous_buffer((unsigned char *)loaded_transaction_data, loaded_transaction_size, &is_stop_related) == ESP_OK && is_stop_related){
@@ -1488,6 +1498,98 @@ esp_err_t ocpp_transaction_load_cb_data(struct ocpp_transaction_start_stop_cb_da
 	return ESP_FAIL;
 }
 
+#if CONFIG_OCPP_TRANSACTION_METER_VALUES_COALESCE_MAX_SIZE > 0
+/*
+ * After a long offline period a transaction file may contain a large number of meter values. Sending one MeterValues.req
+ * per stored value would require one round trip per value. To drain the file faster, the meter values stored directly
+ * after the loaded meter value are appended to the same request until the size limit is reached, a stop transaction
+ * related value is found or no more meter values can be read. Any value that fails to be read is left on file to be
+ * handled when it is loaded on its own.
+ *
+ * The loaded confirmed offset and meter count are moved past the appended values so that ocpp_transaction_confirm_last
+ * confirms all values of the request as a group.
+ */
+static void coalesce_loaded_meter_values(struct ocpp_meter_value_list * value_list){
+	if(loaded_transaction_entry == -1 || value_list == NULL)
+		return;
+
+	// Message may be recreated from the same loaded meter value. Coalesce from the first loaded value each time.
+	loaded_transaction_on_confirmed_offset = loaded_transaction_meter_end_offset;
+	loaded_transaction_meter_count = 1;
+
+	// Awaiting count includes the StopTransaction.req if written. Start is confirmed as meter values are loaded.
+	size_t max_meter_count = loaded_transaction_header.awaiting_message_count;
+	if(!loaded_transaction_header.is_active && max_meter_count > 0)
+		max_meter_count--;
+
+	if(loaded_transaction_meter_count >= max_meter_count)
+		return;
+
+	char file_path[32];
+	sprintf(file_path, "%s/%d.bin", DIRECTORY_PATH, loaded_transaction_entry % CONFIG_OCPP_MAX_TRANSACTION_FILES);
+
+	FILE * fp = fopen(file_path, "rb");
+	if(fp == NULL){
+		ESP_LOGE(TAG, "Unable to open file to coalesce meter values: %s", strerror(errno));
+		return;
+	}
+
+	if(fseek(fp, loaded_transaction_on_confirmed_offset, SEEK_SET) != 0){
+		ESP_LOGE(TAG, "Unable to seek to meter value following loaded meter value");
+		fclose(fp);
+		return;
+	}
+
+	size_t coalesced_size = loaded_transaction_size;
+	struct ocpp_meter_value_list * last = ocpp_meter_list_get_last(value_list);
+
+	while(loaded_transaction_meter_count < max_meter_count){
+		unsigned char * meter_data = NULL;
+		size_t meter_length;
+		time_t timestamp;
+
+		if(read_meter_value_string(fp, &meter_data, &meter_length, &timestamp) != ESP_OK)
+			break;
+
+		bool is_stop_related;
+		if(coalesced_size + meter_length > CONFIG_OCPP_TRANSACTION_METER_VALUES_COALESCE_MAX_SIZE
+			|| ocpp_is_stop_txn_data_from_contiguous_buffer(meter_data, meter_length, &is_stop_related) != ESP_OK
+			|| is_stop_related){
+
+			free(meter_data);
+			break;
+		}
+
+		struct ocpp_meter_value_list * next_list = ocpp_meter_list_from_contiguous_buffer(meter_data, meter_length, &is_stop_related);
+		free(meter_data);
+
+		if(next_list == NULL){
+			ESP_LOGW(TAG, "Unable to create value list from following meter data. Will not be coalesced");
+			break;
+		}
+
+		long next_offset = ftell(fp);
+		if(next_offset == -1){
+			ESP_LOGE(TAG, "Unable to get position after following meter value");
+			ocpp_meter_list_delete(next_list);
+			break;
+		}
+
+		last->next = next_list;
+		last = ocpp_meter_list_get_last(next_list);
+
+		coalesced_size += meter_length;
+		loaded_transaction_on_confirmed_offset = next_offset;
+		loaded_transaction_meter_count++;
+	}
+
+	fclose(fp);
+
+	if(loaded_transaction_meter_count > 1)
+		ESP_LOGI(TAG, "Coalesced %zu stored meter values (%zu bytes) into one request", loaded_transaction_meter_count, coalesced_size);
+}
+#endif /* CONFIG_OCPP_TRANSACTION_METER_VALUES_COALESCE_MAX_SIZE > 0 */
+
 cJSON * read_next_message(){
 
 	ESP_LOGI(TAG, "Attempting to read next transaction message");
@@ -1537,6 +1639,9 @@ cJSON * read_next_message(){
 			ESP_LOGE(TAG, "Unable to create value list from meter data");
 			fail_loaded_transaction();
 		}else{
+#if CONFIG_OCPP_TRANSACTION_METER_VALUES_COALESCE_MAX_SIZE > 0
+			coalesce_loaded_meter_values(value_list);
+#endif
 			message = ocpp_create_meter_values_request(1, &loaded_transaction_header.transaction_id, value_list);
 
 			if(message == NULL){
@@ -1590,7 +1695,7 @@ BaseType_t ocpp_transaction_get_next_message(struct ocpp_active_call * call){
 	if(ocpp_transaction_get_oldest_timestamp() < peek_txn_enqueue_timestamp()){
 		ESP_LOGI(TAG, "Getting message from storage");
 
-		call_with_cb = malloc(sizeof(struct ocpp_call_with_cb));
+		call_with_cb = calloc(sizeof(struct ocpp_call_with_cb), 1);
 		if(call_with_cb == NULL){
 			ESP_LOGE(TAG, "Unable to allocate call for transaction message on file");
 			return pdFALSE;
@@ -1680,15 +1785,17 @@ esp_err_t ocpp_transaction_confirm_last(){
 	esp_err_t ret = ESP_FAIL;
 
 	char file_path[32];
-	sprintf(file_path, "%s/%d.bin", DIRECTORY_PATH, loaded_transaction_entry);
+	sprintf(file_path, "%s/%d.bin", DIRECTORY_PATH, loaded_transaction_entry % CONFIG_OCPP_MAX_TRANSACTION_FILES);
 
 	long new_offset = -1;
+	size_t confirmed_count = 1;
 
 	if(loaded_transaction_type == eTRANSACTION_TYPE_START){
 		new_offset = OFFSET_METER_VALUES;
 
 	}else if(loaded_transaction_type == eTRANSACTION_TYPE_METER){
 		new_offset = loaded_transaction_on_confirmed_offset;
+		confirmed_count = loaded_transaction_meter_count;
 
 	}else{// eTRANSACTION_TYPE_STOP
 		if(remove(file_path) != 0){
@@ -1710,7 +1817,7 @@ esp_err_t ocpp_transaction_confirm_last(){
 		goto cleanup;
 	}
 
-	ret = write_header(fp, NULL, NULL, NULL, &new_offset, -1, false);
+	ret = write_header(fp, NULL, NULL, NULL, &new_offset, -(int)confirmed_count, false);
 	fclose(fp);
 
 	if(ret != ESP_OK){
@@ -1881,6 +1988,326 @@ esp_err_t ocpp_transaction_write_stop_no_lock(const char * id_tag, int meter_sto
 	return err;
 }
 
+#ifdef CONFIG_OCPP_METER_VALUE_RETENTION
+
+#define METER_VALUE_STORED_SIZE(meter_data_length) (sizeof(size_t) + (meter_data_length) + sizeof(time_t) + sizeof(uint32_t))
+
+static const struct ocpp_retention_policy retention_policy = {
+	.full_resolution_sec = CONFIG_OCPP_METER_VALUE_RETENTION_FULL_RESOLUTION_SEC,
+	.boundary_sec = CONFIG_OCPP_METER_VALUE_RETENTION_BOUNDARY_SEC,
+};
+
+/*
+ * Thinned files are written here before replacing the transaction file. It is kept outside DIRECTORY_PATH as every
+ * file in that directory is treated as a transaction file.
+ */
+#define THINNED_FILE_PATH_FORMAT CONFIG_OCPP_FILE_PATH "/txn%d.tmp"
+
+/*
+ * File size and confirmed offset of the last pass that could not free any space. Thinning is not attempted again
+ * until the file has used half of the space remaining above the high water mark or meter values have been sent.
+ */
+static struct{
+	long file_size;
+	long confirmed_offset;
+}thin_backoff[CONFIG_OCPP_MAX_TRANSACTION_FILES];
+
+/* Appends data read from one file at the current position of another */
+static esp_err_t copy_file_data(FILE * src_fp, long from, FILE * dst_fp, long length){
+	unsigned char buffer[512];
+
+	if(fseek(src_fp, from, SEEK_SET) != 0){
+		ESP_LOGE(TAG, "Unable to seek to data to copy: %s", strerror(errno));
+		return ESP_FAIL;
+	}
+
+	while(length > 0){
+		size_t chunk_length = (length > sizeof(buffer)) ? sizeof(buffer) : length;
+
+		if(fread(buffer, chunk_length, 1, src_fp) != 1){
+			ESP_LOGE(TAG, "Unable to read data to copy: %s", strerror(errno));
+			return ESP_FAIL;
+		}
+
+		if(fwrite(buffer, chunk_length, 1, dst_fp) != 1){
+			ESP_LOGE(TAG, "Unable to write copied data: %s", strerror(errno));
+			return ESP_FAIL;
+		}
+
+		length -= chunk_length;
+	}
+
+	return ESP_OK;
+}
+
+/*
+ * Completes or discards a thinned file left by an interrupted thinning. The transaction file is only removed after the
+ * thinned file has been synced, so a thinned file without a transaction file is complete.
+ */
+static void recover_thinned_files(void){
+	char thinned_path[32];
+	char file_path[32];
+	struct stat st;
+
+	for(int i = 0; i < CONFIG_OCPP_MAX_TRANSACTION_FILES; i++){
+		sprintf(thinned_path, THINNED_FILE_PATH_FORMAT, i);
+		if(stat(thinned_path, &st) != 0)
+			continue;
+
+		sprintf(file_path, "%s/%d.bin", DIRECTORY_PATH, i);
+		if(stat(file_path, &st) != 0){
+			ESP_LOGW(TAG, "Completing interrupted thinning of '%s'", file_path);
+			if(rename(thinned_path, file_path) != 0)
+				ESP_LOGE(TAG, "Unable to rename thinned transaction file: %s", strerror(errno));
+		}else{
+			ESP_LOGW(TAG, "Discarding incomplete thinning of '%s'", file_path);
+			remove(thinned_path);
+		}
+	}
+}
+
+/*
+ * Thins the stored meter values if writing a new meter value would take the file above the high water mark. Meter
+ * values are dropped according to the retention policy until the file is below the low water mark.
+ *
+ * Meter values before the confirmed offset have been sent, and meter values in a loaded request may be awaiting a .conf.
+ * Neither are considered for thinning. If no request is loaded from the file, the space used by sent meter values is
+ * reclaimed by moving the remaining values to the start of the meter value section.
+ *
+ * The kept values and the updated header are written to a separate file which is synced before it replaces the
+ * transaction file. If interrupted, either the original or the thinned file is used by recover_thinned_files.
+ */
+static void thin_meter_values(const char * file_path, int entry, size_t meter_data_length){
+	struct stat st;
+	if(stat(file_path, &st) != 0){
+		ESP_LOGE(TAG, "Unable to get size of transaction file to check fill");
+		return;
+	}
+
+	const long high_water = (long)CONFIG_OCPP_MAX_TRANSACTION_FILE_SIZE * CONFIG_OCPP_METER_VALUE_RETENTION_HIGH_WATER_PERCENT / 100;
+	const long low_water = (long)CONFIG_OCPP_MAX_TRANSACTION_FILE_SIZE * CONFIG_OCPP_METER_VALUE_RETENTION_LOW_WATER_PERCENT / 100;
+	const long new_size = METER_VALUE_STORED_SIZE(meter_data_length);
+	const int slot = entry % CONFIG_OCPP_MAX_TRANSACTION_FILES;
+
+	if(st.st_size + new_size <= high_water){
+		thin_backoff[slot].file_size = 0;
+		return;
+	}
+
+	if(thin_backoff[slot].file_size != 0 && st.st_size >= thin_backoff[slot].file_size
+		&& st.st_size < thin_backoff[slot].file_size + ((long)CONFIG_OCPP_MAX_TRANSACTION_FILE_SIZE - high_water) / 2){
+
+		// Header is only read once the size is known to be in the backoff range to find if values have been sent
+		FILE * fp = fopen(file_path, "rb");
+		if(fp == NULL)
+			return;
+
+		struct transaction_header header;
+		esp_err_t err = read_header(fp, &header);
+		fclose(fp);
+
+		if(err != ESP_OK || header.confirmed_offset <= thin_backoff[slot].confirmed_offset)
+			return;
+	}
+
+	struct ocpp_retention_record * records = NULL;
+	long * offsets = NULL;
+	size_t record_count = 0;
+	size_t record_capacity = 0;
+
+	char thinned_path[32];
+	sprintf(thinned_path, THINNED_FILE_PATH_FORMAT, slot);
+	FILE * thinned_fp = NULL;
+
+	FILE * fp = fopen(file_path, "rb");
+	if(fp == NULL){
+		ESP_LOGE(TAG, "Unable to open transaction file to thin meter values: %s", strerror(errno));
+		return;
+	}
+
+	struct transaction_header header;
+	if(read_header(fp, &header) != ESP_OK){
+		ESP_LOGE(TAG, "Unable to read header to thin meter values");
+		goto cleanup;
+	}
+
+	long read_offset = (header.confirmed_offset > (long)OFFSET_METER_VALUES) ? header.confirmed_offset : (long)OFFSET_METER_VALUES;
+	long write_offset = read_offset;
+
+	if(loaded_transaction_data != NULL && loaded_transaction_entry != -1
+		&& loaded_transaction_entry % CONFIG_OCPP_MAX_TRANSACTION_FILES == slot){
+
+		if(loaded_transaction_type == eTRANSACTION_TYPE_METER && loaded_transaction_on_confirmed_offset > read_offset){
+			read_offset = loaded_transaction_on_confirmed_offset;
+			write_offset = read_offset;
+		}
+	}else{
+		write_offset = OFFSET_METER_VALUES;
+	}
+
+	if(fseek(fp, read_offset, SEEK_SET) != 0){
+		ESP_LOGE(TAG, "Unable to seek to first meter value to thin");
+		goto cleanup;
+	}
+
+	long scan_end = read_offset;
+	while(record_count < OCPP_RETENTION_MAX_RECORDS){
+		unsigned char * meter_data = NULL;
+		size_t meter_length;
+		time_t timestamp;
+
+		esp_err_t err = read_meter_value_string(fp, &meter_data, &meter_length, &timestamp);
+		if(err == ESP_ERR_NOT_FOUND)
+			break;
+
+		if(err != ESP_OK){
+			ESP_LOGE(TAG, "Unable to read stored meter value to thin");
+			goto cleanup;
+		}
+
+		if(record_count == record_capacity){
+			record_capacity = (record_capacity == 0) ? 64 : record_capacity * 2;
+
+			struct ocpp_retention_record * new_records = realloc(records, record_capacity * sizeof(struct ocpp_retention_record));
+			if(new_records != NULL)
+				records = new_records;
+
+			long * new_offsets = realloc(offsets, record_capacity * sizeof(long));
+			if(new_offsets != NULL)
+				offsets = new_offsets;
+
+			if(new_records == NULL || new_offsets == NULL){
+				ESP_LOGE(TAG, "Unable to allocate records to thin meter values");
+				free(meter_data);
+				goto cleanup;
+			}
+		}
+
+		bool is_stop_txn_data = false;
+		struct ocpp_meter_value_list * list = ocpp_meter_list_from_contiguous_buffer(meter_data, meter_length, &is_stop_txn_data);
+		free(meter_data);
+
+		struct ocpp_retention_record * record = &records[record_count];
+
+		// Values that can not be converted are kept to be handled when loaded
+		ocpp_meter_retention_record_from_list(list, is_stop_txn_data || list == NULL, METER_VALUE_STORED_SIZE(meter_length), record);
+		ocpp_meter_list_delete(list);
+
+		if(record->timestamp == 0)
+			record->timestamp = timestamp;
+
+		offsets[record_count++] = scan_end;
+		scan_end = ftell(fp);
+	}
+
+	long reclaimed = read_offset - write_offset;
+	long requested = st.st_size + new_size - low_water - reclaimed;
+
+	size_t freed = 0;
+	if(requested > 0)
+		freed = ocpp_meter_retention_thin(&retention_policy, records, record_count, requested);
+
+	if(freed == 0 && reclaimed == 0){
+		ESP_LOGW(TAG, "No stored meter values could be thinned. Waiting for file to grow or values to be sent");
+		thin_backoff[slot].file_size = st.st_size;
+		thin_backoff[slot].confirmed_offset = header.confirmed_offset;
+		goto cleanup;
+	}
+
+	thin_backoff[slot].file_size = 0;
+
+	thinned_fp = fopen(thinned_path, "wb+");
+	if(thinned_fp == NULL){
+		ESP_LOGE(TAG, "Unable to create thinned transaction file: %s", strerror(errno));
+		goto cleanup;
+	}
+
+	if(copy_file_data(fp, 0, thinned_fp, write_offset) != ESP_OK){
+		ESP_LOGE(TAG, "Unable to copy transaction data preceding thinned values");
+		goto cleanup;
+	}
+
+	size_t dropped_count = 0;
+	long position = write_offset;
+
+	for(size_t i = 0; i < record_count; i++){
+		if(records[i].flags & OCPP_RETENTION_RECORD_DROPPED){
+			dropped_count++;
+			continue;
+		}
+
+		long length = ((i + 1 < record_count) ? offsets[i + 1] : scan_end) - offsets[i];
+		if(copy_file_data(fp, offsets[i], thinned_fp, length) != ESP_OK){
+			ESP_LOGE(TAG, "Unable to copy kept meter value");
+			goto cleanup;
+		}
+
+		position += length;
+	}
+
+	// Values not considered due to the record limit are kept as they are
+	if(st.st_size > scan_end){
+		if(copy_file_data(fp, scan_end, thinned_fp, st.st_size - scan_end) != ESP_OK){
+			ESP_LOGE(TAG, "Unable to copy meter values following thinned values");
+			goto cleanup;
+		}
+
+		position += st.st_size - scan_end;
+	}
+
+	fclose(fp);
+	fp = NULL;
+
+	if(write_header(thinned_fp, NULL, NULL, NULL, (reclaimed > 0) ? &write_offset : NULL, -(int)dropped_count, false) != ESP_OK){
+		ESP_LOGE(TAG, "Unable to update header after thinning meter values");
+		goto cleanup;
+	}
+
+	if(fflush(thinned_fp) != 0 || fsync(fileno(thinned_fp)) != 0){
+		ESP_LOGE(TAG, "Unable to sync thinned transaction file: %s", strerror(errno));
+		goto cleanup;
+	}
+
+	fclose(thinned_fp);
+	thinned_fp = NULL;
+
+	// rename does not replace an existing file on FAT
+	if(remove(file_path) != 0){
+		ESP_LOGE(TAG, "Unable to remove transaction file to replace with thinned file: %s", strerror(errno));
+		remove(thinned_path);
+		known_message_count = -1;
+		goto cleanup;
+	}
+
+	// The thinned file is kept on failure as it is now the only copy, and is renamed by recover_thinned_files
+	if(rename(thinned_path, file_path) != 0){
+		ESP_LOGE(TAG, "Unable to rename thinned transaction file: %s", strerror(errno));
+		known_message_count = -1;
+		goto cleanup;
+	}
+
+	ESP_LOGW(TAG, "Thinned '%s' from %ld to %ld bytes. Dropped %zu of %zu unsent meter values and reclaimed %ld bytes of sent values",
+		file_path, (long)st.st_size, position, dropped_count, record_count, reclaimed);
+
+	free(records);
+	free(offsets);
+	return;
+
+cleanup:
+	if(fp != NULL)
+		fclose(fp);
+
+	if(thinned_fp != NULL){
+		fclose(thinned_fp);
+		remove(thinned_path);
+		known_message_count = -1; // write_header may have counted the dropped values
+	}
+
+	free(records);
+	free(offsets);
+}
+#endif /* CONFIG_OCPP_METER_VALUE_RETENTION */
+
 esp_err_t ocpp_transaction_write_meter_value(const unsigned char * meter_buffer, size_t buffer_length, bool stop_related){
 
 	if(!stop_related){
@@ -1906,6 +2333,10 @@ esp_err_t ocpp_transaction_write_meter_value(const unsigned char * meter_buffer,
 	char file_path[32];
 	sprintf(file_path, "%s/%d.bin", DIRECTORY_PATH, entry % CONFIG_OCPP_MAX_TRANSACTION_FILES);
 
+#ifdef CONFIG_OCPP_METER_VALUE_RETENTION
+	thin_meter_values(file_path, entry, buffer_length);
+#endif
+
 	FILE * fp = fopen(file_path, "rb+");
 	if(fp == NULL){
 		ESP_LOGE(TAG, "Unable to open active transaction to write meter value");
@@ -2154,6 +2585,10 @@ int ocpp_transaction_init(){
 		ESP_LOGI(TAG, "Directory path '%s' exists", DIRECTORY_PATH);
 	}
 
+#ifdef CONFIG_OCPP_METER_VALUE_RETENTION
+	recover_thinned_files();
+#endif
+
 	xSemaphoreGive(initial_lock);
 	file_lock = initial_lock;
 
@@ -0,0 +1,519 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "esp_log.h"
+
+#include "legacy_composite_schedule.h"
+
+/*
+ * Copied from ocpp_smart_charging.c as it was before GetCompositeSchedule was computed from the charging timeline.
+ * Only the logging and the profile source have been changed. Do not fix this code, it is the reference for what the
+ * central system used to receive.
+ */
+
+static const char * TAG = "OCPP LEGACY    ";
+
+#define LEGACY_MAX_STACK_LEVEL 16
+
+
+/**
+ * @brief Gets absolute start time of a schedule and time since it last started.
+ *
+ * @param relative_start Time when charging started or GetCompositeSchedule.req was received.
+ * @param sec_since_start Time since relative_start
+ * @param profile Profile containing relevant schedule
+ * @param absolute_start_out Output parameter for when the schedule last started.
+ * @param schedule_offset_out Output parameter for current time since last start
+ *
+ * @return ESP_OK on success. ESP_ERR_INVALID_ARG if invalid profile is detected. ESP_ERR_INVALID_STATE if requested time is outside valid_from -> valid_to range or start_schedule.
+ */
+static esp_err_t get_normalized_time(time_t relative_start, int time_since_start, const struct ocpp_charging_profile * profile, time_t * absolute_start_out, int * schedule_offset_out){
+
+	if(profile == NULL){
+		ESP_LOGE(TAG, "No profile provided");
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	time_t when = relative_start + time_since_start;
+
+	if(when < profile->valid_from
+		|| when > profile->valid_to)
+		return ESP_ERR_INVALID_STATE;
+
+	unsigned int recurrency_interval;
+
+	switch(profile->profile_kind){
+	case eOCPP_CHARGING_PROFILE_KIND_ABSOLUTE:
+
+		if(profile->charging_schedule.start_schedule == NULL)
+			return ESP_ERR_INVALID_ARG;
+
+		if(when < *profile->charging_schedule.start_schedule)
+			return ESP_ERR_INVALID_STATE;
+
+		if(absolute_start_out != NULL)
+			*absolute_start_out = *profile->charging_schedule.start_schedule;
+
+		if(schedule_offset_out != NULL)
+			*schedule_offset_out = when - *profile->charging_schedule.start_schedule;
+
+		break;
+
+	case eOCPP_CHARGING_PROFILE_KIND_RECURRING:
+
+		if(profile->charging_schedule.start_schedule == NULL || profile->recurrency_kind == NULL)
+			return ESP_ERR_INVALID_ARG;
+
+		if(when < *profile->charging_schedule.start_schedule)
+			return ESP_ERR_INVALID_STATE;
+
+		switch(*profile->recurrency_kind){
+		case eOCPP_RECURRENCY_KIND_DAILY:
+			recurrency_interval = 86400; // 86400 = 1 day in second
+			break;
+
+		case eOCPP_RECURRENCY_KIND_WEEKLY:
+			recurrency_interval = 604800; // 604800 = 1 week in seconds
+			break;
+
+		default:
+			ESP_LOGE(TAG, "Invalid recurrency kind");
+			return ESP_ERR_INVALID_ARG;
+		}
+
+		if(absolute_start_out != NULL)
+			*absolute_start_out =  when - ((when - *profile->charging_schedule.start_schedule) % recurrency_interval);
+
+		if(schedule_offset_out != NULL)
+			*schedule_offset_out = (when - *profile->charging_schedule.start_schedule) % recurrency_interval;
+		break;
+
+	case eOCPP_CHARGING_PROFILE_KIND_RELATIVE:
+
+		if(absolute_start_out != NULL)
+			*absolute_start_out = relative_start;
+
+		if(schedule_offset_out != NULL)
+			*schedule_offset_out = time_since_start;
+		break;
+	}
+
+	return ESP_OK;
+}
+
+/**
+ * @brief returns the time when it will become valid starting at relative_start + relative_offset.
+ */
+static time_t get_when_schedule_is_active(time_t relative_start, int relative_offset, struct ocpp_charging_profile * profile, int * transaction_id){
+	if(profile->transaction_id != NULL && (transaction_id != NULL && *transaction_id != *profile->transaction_id)) // Invalid due to transaction id mismatch
+		return LONG_MAX;
+
+	// Find the earliest time it can be active from
+
+	time_t active_from = profile->valid_from;
+
+	if(profile->charging_schedule.start_schedule != NULL && *profile->charging_schedule.start_schedule > active_from)
+		active_from = *profile->charging_schedule.start_schedule;
+
+	// Earliest relevant time is after the transaction start or composite shcedule was requested
+	if(relative_start + relative_offset > active_from)
+		active_from = relative_start + relative_offset;
+
+	int absolute_offset;
+	time_t absolute_start;
+	if(get_normalized_time(relative_start, relative_offset, profile, &absolute_start, &absolute_offset) != ESP_OK)
+		return LONG_MAX;
+
+	if(profile->charging_schedule.duration != NULL && absolute_offset >= *profile->charging_schedule.duration){
+		if(profile->profile_kind != eOCPP_CHARGING_PROFILE_KIND_RECURRING || profile->recurrency_kind == NULL)
+			return LONG_MAX; // Will not become valid since it is not recurring schedule
+
+		switch(*profile->recurrency_kind){
+		case eOCPP_RECURRENCY_KIND_DAILY:
+			active_from = absolute_start + 86400;
+			break;
+
+		case eOCPP_RECURRENCY_KIND_WEEKLY:
+			active_from = absolute_start + 604800;
+			break;
+
+		default: // invalid
+			return LONG_MAX;
+		}
+	}
+
+	// Check if it is still valid
+	return (profile->valid_to > active_from) ? active_from : LONG_MAX;
+}
+
+/**
+ * @brief copy the period list from a profile at an offset into a new list with a relative offset. Its the callers resposibility to free the returned value.
+ *
+ * @param start time Relative start time.
+ * @param offset The initial offset from relative start in the profils period list from witch to start copying.
+ * @param end The last time at witch a period may be copied from.
+ * @param profile Profile to copy from.
+ * @param max_copies Maximum number of period list items in output. Must be a value greater than 0.
+ * @param period_out Period list to extend. Will overwrite its value amd potentially its next pointer.
+ * @param offset_end_out Output parameter to indicate when output list may not be valid.
+ * @param copy_count_out Output parameter with number of elemets copied.
+ *
+ * @return pointer to copied period list.
+ */
+static struct ocpp_charging_schedule_period_list * copy_period_at(time_t start, int offset, time_t end, struct ocpp_charging_profile * profile,
+							size_t max_copies, int * offset_end_out, int * copy_count_out){
+
+	struct ocpp_charging_schedule_period_list * period = &profile->charging_schedule.schedule_period;
+	struct ocpp_charging_schedule_period_list * period_last = NULL;
+
+	time_t abs_start;
+	int abs_offset;
+
+	if(get_normalized_time(start, offset, profile, &abs_start, &abs_offset) != ESP_OK){
+		ESP_LOGE(TAG, "Unable to get normalized time for copying periods");
+		return NULL;
+	}
+
+	struct ocpp_charging_schedule_period_list * copy = calloc(sizeof(struct ocpp_charging_schedule_period_list), 1);
+	if(copy == NULL){
+		ESP_LOGE(TAG, "Unable to create buffer for copying period list");
+		return NULL;
+	}
+
+	struct ocpp_charging_schedule_period_list * ret = copy; // save the head of the copy for return.
+
+	int offset_diff = offset - abs_offset;
+	while(period != NULL && period->value.start_period < abs_offset){ // Move period pointer to first within requested range
+		period_last = period;
+		period = period->next;
+	}
+
+	if(period != NULL && period->value.start_period == abs_offset){
+		copy->value.start_period = offset;
+		copy->value.limit = period->value.limit;
+		copy->value.number_phases = period->value.number_phases;
+
+		period_last = period;
+		period = period->next;
+
+	} else { // requested offset is part of previous list entry
+
+		copy->value.start_period = offset;
+		copy->value.limit = period_last->value.limit;
+		copy->value.number_phases = period_last->value.number_phases;
+	}
+
+	(*copy_count_out)++;
+
+	*offset_end_out = end - start;
+	if(profile->charging_schedule.duration != NULL
+		&& *offset_end_out > (abs_start + *profile->charging_schedule.duration) - start)
+		*offset_end_out = (abs_start + *profile->charging_schedule.duration) - start;
+
+	if(*offset_end_out + start > profile->valid_to)
+		*offset_end_out = profile->valid_to - start;
+
+	while(period != NULL && *copy_count_out < max_copies // Copy while input exist and output not exceeded,
+		&& period->value.start_period < *offset_end_out + offset_diff){ // Valid offset not exceeded
+
+		struct ocpp_charging_schedule_period_list * new_period = ocpp_extend_period_list(copy, &period->value);
+
+		if(new_period == NULL){
+			ESP_LOGE(TAG, "Unable to copy period");
+			break;
+		}else{
+			new_period->value.start_period = period->value.start_period + offset_diff;
+			copy = new_period;
+
+			(*copy_count_out)++;
+
+			period_last = period;
+			period = period->next;
+		}
+	}
+
+
+	if(period != NULL && period->value.start_period + offset_diff < *offset_end_out)
+		*offset_end_out = period->value.start_period + offset_diff;
+
+	return ret;
+}
+
+/**
+ * @brief creates a period list for a given range from transaction start with offset to a given end time.
+ *
+ * @todo Consider caching profiles instead of rereading when same profile is used to compute multiple separate sections.
+ *
+ * @return duration of the created period list.
+ */
+static int compute_range(time_t start, int offset, time_t end, int * transaction_id,
+		struct ocpp_charging_profile * (*next_profile)(struct ocpp_charging_profile *),
+		int max_periods, struct ocpp_charging_schedule_period_list * period_list_out){
+
+	size_t index = 0;
+	struct ocpp_charging_profile * current_profile = next_profile(NULL);
+
+	struct ocpp_charging_profile ** profile_stack = calloc(sizeof(struct ocpp_charging_profile), LEGACY_MAX_STACK_LEVEL);
+	time_t * range_stack = calloc(sizeof(time_t), 2 * LEGACY_MAX_STACK_LEVEL);
+
+	if(profile_stack == NULL || range_stack == NULL){
+		ESP_LOGE(TAG, "Unable to allocate memory for profile stack or range info");
+		goto cleanup;
+	}
+
+	bool empty = true;
+
+	while(max_periods > 0 && (start + offset < end)){
+		time_t active_from = get_when_schedule_is_active(start, offset, current_profile, transaction_id);
+
+		if(active_from != start + offset){ // If current profile is inactive
+			bool should_remove;
+			if(active_from < end // If it will be active later in the range
+				&& (index == 0 || active_from < range_stack[(index -1) * 2])){ // And is not superseeded by another profile active at the same time.
+
+				// save the profile with active_from and end, where end is when a higher priority profile will be active or range is complete.
+				profile_stack[index] = current_profile;
+				should_remove = false;
+
+				range_stack[index * 2] = active_from;
+				range_stack[(index * 2) +1] = end;
+
+				end = active_from;
+
+				index++;
+			}else{
+				should_remove = true;
+			}
+
+			struct ocpp_charging_profile * tmp_profile = current_profile;
+
+			// Set current profile lower priority profile.
+			current_profile = next_profile(current_profile);
+
+			if(should_remove)
+				ocpp_free_charging_profile(tmp_profile);
+
+		}else{ // If current profile is active
+
+			int copy_count = 0;
+			struct ocpp_charging_schedule_period_list * period_section = copy_period_at(start, offset,  end, current_profile, max_periods,
+												&offset, &copy_count);
+			if(period_section == NULL){
+				ESP_LOGE(TAG, "Unable to copy period");
+				goto cleanup;
+			}
+
+			if(empty){
+				period_list_out->value.start_period = period_section->value.start_period;
+				period_list_out->value.limit = period_section->value.limit;
+				period_list_out->value.number_phases = period_section->value.number_phases;
+
+				empty = false;
+			}
+
+			if(ocpp_period_is_equal_charge(&period_list_out->value, &period_section->value)){
+				struct ocpp_charging_schedule_period_list * tmp = period_section;
+				period_section = period_section->next;
+
+				copy_count--;
+
+				free(tmp);
+			}
+
+			max_periods -= copy_count;
+
+			period_list_out->next = period_section;
+
+			while(period_list_out->next != NULL)
+				period_list_out = period_list_out->next;
+
+		}
+
+		while(start + offset >= end && index > 0){ // End for current profile and higher priority profile exist
+			// Clear current profile
+			ocpp_free_charging_profile(current_profile);
+
+			// Replace it with the higher priority profile
+			current_profile = profile_stack[--index];
+			end = range_stack[(index *2)+1];
+
+			profile_stack[index] = NULL;
+			range_stack[(index *2)] = 0;
+			range_stack[(index *2) +1] = 0;
+		}
+	}
+
+cleanup:
+	while(index > 0)
+		ocpp_free_charging_profile(profile_stack[--index]);
+
+	ocpp_free_charging_profile(current_profile);
+
+	free(profile_stack);
+	free(range_stack);
+
+	return offset;
+}
+
+/**
+ * @brief Combines two schedules. It assumes that both schedules have the same schedule_start.
+ */
+static void combine_schedules(struct ocpp_charging_schedule * schedule1, struct ocpp_charging_schedule * schedule2, struct ocpp_charging_schedule * schedule_out){
+	int duration = INT_MAX;
+
+	// Limit the outputs duration to the shortest duration of the inputs
+	if(schedule1->duration != NULL || schedule2->duration != NULL){
+		schedule_out->duration = malloc(sizeof(int));
+		if(schedule_out->duration == NULL){
+			ESP_LOGE(TAG, "Unable to allocate duration for composite schedule");
+			return;
+		}
+
+		*schedule_out->duration = INT_MAX;
+
+		if(schedule1->duration != NULL)
+			*schedule_out->duration = *schedule1->duration;
+
+		if(schedule2->duration != NULL && *schedule2->duration < *schedule_out->duration)
+			*schedule_out->duration = *schedule2->duration;
+
+		duration = *schedule_out->duration;
+	}
+
+	schedule_out->start_schedule = malloc(sizeof(time_t));
+	if(schedule_out->start_schedule == NULL){
+		ESP_LOGE(TAG, "Unable to start schedule for composite schedule");
+		return;
+	}
+	*schedule_out->start_schedule = *schedule1->start_schedule;
+
+	schedule_out->charge_rate_unit = eOCPP_CHARGING_RATE_A;
+	schedule_out->min_charging_rate = (schedule1->min_charging_rate < schedule2->min_charging_rate) ? schedule1->min_charging_rate : schedule2->min_charging_rate;
+
+	struct ocpp_charging_schedule_period_list * list1 = &schedule1->schedule_period;
+	struct ocpp_charging_schedule_period_list * list2 = &schedule2->schedule_period;
+
+	bool empty = true;
+
+	while(true){
+
+		struct ocpp_charging_schedule_period new_period;
+
+		if(list1->value.start_period > list2->value.start_period){ // set start_period out to last latest active start_period
+			new_period.start_period = list1->value.start_period;
+		}else{
+			new_period.start_period = list2->value.start_period;
+		}
+
+		if(new_period.start_period > duration) // End if schedule would no longer be valid
+			return;
+
+		if(list1->value.limit < list2->value.limit){ // Set limit to the minimum of the schedules to combine
+			new_period.limit = list1->value.limit;
+		}else{
+			new_period.limit = list2->value.limit;
+		}
+
+		if(list1->value.number_phases < list2->value.number_phases){ // Set number_phase to minimum
+			new_period.number_phases = list1->value.number_phases;
+		}else{
+			new_period.number_phases = list2->value.number_phases;
+		}
+
+		if(empty){
+			schedule_out->schedule_period.value.start_period = new_period.start_period;
+			schedule_out->schedule_period.value.limit = new_period.limit;
+			schedule_out->schedule_period.value.number_phases = new_period.number_phases;
+
+			empty = false;
+		}else{
+			ocpp_extend_period_list(&schedule_out->schedule_period, &new_period);
+		}
+
+		if(list1->next != NULL && list2->next != NULL){
+			if(list1->next->value.start_period == list2->next->value.start_period){
+				list1 = list1->next;
+				list2 = list2->next;
+
+			}else if(list1->next->value.start_period < list2->next->value.start_period){
+				list1 = list1->next;
+
+			}else{
+				list2 = list2->next;
+			}
+
+		}else if(list1->next == NULL && list2->next == NULL){
+			break;
+		}else{
+			if(list1->next != NULL){
+				list1 = list1->next;
+			}else{
+				list2 = list2->next;
+			}
+		}
+	}
+}
+
+/*
+ * The profiles are read from the arrays given to legacy_composite_schedule like the previous implementation read them
+ * from storage: each call returns a copy of the profile with the next lower stack level, or the default profile.
+ */
+static const struct ocpp_charging_profile * const * source_profiles;
+static size_t source_count;
+
+static struct ocpp_charging_profile * next_source_profile(struct ocpp_charging_profile * current_profile){
+	for(size_t i = 0; i < source_count; i++){
+		if(current_profile == NULL || source_profiles[i]->stack_level < current_profile->stack_level){
+			if(source_profiles[i]->stack_level == -1)
+				return (struct ocpp_charging_profile *)source_profiles[i];
+
+			return ocpp_duplicate_charging_profile(source_profiles[i]);
+		}
+	}
+
+	return (struct ocpp_charging_profile *)source_profiles[source_count -1];
+}
+
+esp_err_t legacy_composite_schedule(const struct ocpp_charging_profile * const * tx_profiles, size_t tx_count,
+				const struct ocpp_charging_profile * const * max_profiles, size_t max_count,
+				time_t start_time, int duration, int max_periods, struct ocpp_charging_schedule * schedule_out){
+
+	struct ocpp_charging_schedule tx_schedule = {0};
+	struct ocpp_charging_schedule max_schedule = {0};
+	esp_err_t err = ESP_ERR_NO_MEM;
+
+	tx_schedule.duration = malloc(sizeof(int));
+	max_schedule.duration = malloc(sizeof(int));
+	tx_schedule.start_schedule = malloc(sizeof(time_t));
+	max_schedule.start_schedule = malloc(sizeof(time_t));
+
+	if(tx_schedule.duration == NULL || max_schedule.duration == NULL
+		|| tx_schedule.start_schedule == NULL || max_schedule.start_schedule == NULL)
+		goto cleanup;
+
+	*tx_schedule.start_schedule = start_time;
+	*max_schedule.start_schedule = start_time;
+
+	source_profiles = tx_profiles;
+	source_count = tx_count;
+	*tx_schedule.duration = compute_range(start_time, 0, start_time+duration, NULL,
+					next_source_profile, max_periods, &tx_schedule.schedule_period);
+
+	source_profiles = max_profiles;
+	source_count = max_count;
+	*max_schedule.duration = compute_range(start_time, 0, start_time+duration, NULL,
+					next_source_profile, max_periods, &max_schedule.schedule_period);
+
+	memset(schedule_out, 0, sizeof(struct ocpp_charging_schedule));
+	combine_schedules(&tx_schedule, &max_schedule, schedule_out);
+
+	err = ESP_OK;
+
+cleanup:
+	ocpp_free_charging_schedule(&tx_schedule, false);
+	ocpp_free_charging_schedule(&max_schedule, false);
+
+	return err;
+}
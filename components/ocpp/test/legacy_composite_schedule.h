@@ -0,0 +1,32 @@
+#ifndef LEGACY_COMPOSITE_SCHEDULE_H
+#define LEGACY_COMPOSITE_SCHEDULE_H
+
+#include <stddef.h>
+#include <time.h>
+
+#include "esp_err.h"
+
+#include "types/ocpp_charging_profile.h"
+
+/** @file
+ * @brief Composite schedule computation used by GetCompositeSchedule before the charging timeline replaced it.
+ *
+ * @details Kept in the test component as a reference for the schedules sent to the central system. The profiles are
+ * given as arrays ordered by precedence instead of being read from the smart charging profile storage.
+ */
+
+/**
+ * @brief Compute the composite schedule as the previous implementation of GetCompositeSchedule.
+ *
+ * @param tx_profiles tx and tx default profiles ordered by precedence, ending with the default tx profile
+ * @param max_profiles charge point max profiles ordered by precedence, ending with the default max profile
+ * @param start_time time the composite schedule is requested from
+ * @param duration requested duration
+ * @param max_periods maximum number of periods computed for each of the tx and max stacks
+ * @param schedule_out composite schedule. Must be freed with ocpp_free_charging_schedule.
+ */
+esp_err_t legacy_composite_schedule(const struct ocpp_charging_profile * const * tx_profiles, size_t tx_count,
+				const struct ocpp_charging_profile * const * max_profiles, size_t max_count,
+				time_t start_time, int duration, int max_periods, struct ocpp_charging_schedule * schedule_out);
+
+#endif /* LEGACY_COMPOSITE_SCHEDULE_H */
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "unity.h"
+#include "esp_log.h"
+
+#include "ocpp_auth_filter.h"
+#include "types/ocpp_id_token.h"
+
+static const char *TAG = "OCPPTEST";
+
+#define TEST_FILTER_PATH "/files/auth_flt.bin"
+
+static void create_token(size_t nr, ocpp_id_token id_tag){
+	snprintf(id_tag, sizeof(ocpp_id_token), "04%06X%zu", (unsigned int)(nr * 40503u) & 0xFFFFFF, nr);
+}
+
+TEST_CASE("Test auth filter has no false negatives", "[ocpp]") {
+	const size_t max_entries = 1024;
+
+	struct ocpp_auth_filter filter;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_filter_init(&filter, max_entries, 10));
+	ocpp_auth_filter_clear(&filter, true);
+
+	ocpp_id_token id_tag;
+	for(size_t i = 0; i < max_entries; i++){
+		create_token(i, id_tag);
+		ocpp_auth_filter_add(&filter, id_tag);
+	}
+
+	for(size_t i = 0; i < max_entries; i++){
+		create_token(i, id_tag);
+		TEST_ASSERT_TRUE(ocpp_auth_filter_may_contain(&filter, id_tag));
+	}
+
+	TEST_ASSERT_EQUAL_UINT32(max_entries, filter.hits);
+
+	const size_t unknown_count = 10000;
+	for(size_t i = max_entries; i < max_entries + unknown_count; i++){
+		create_token(i, id_tag);
+		ocpp_auth_filter_may_contain(&filter, id_tag);
+	}
+
+	uint32_t false_positives = filter.hits - max_entries;
+	ESP_LOGI(TAG, "%" PRIu32 " false positives for %zu unknown tokens with %zu tokens in filter",
+		false_positives, unknown_count, max_entries);
+
+	TEST_ASSERT_EQUAL_UINT32(unknown_count, filter.misses + false_positives);
+	TEST_ASSERT_LESS_THAN(unknown_count / 40, false_positives);
+
+	ocpp_auth_filter_deinit(&filter);
+}
+
+TEST_CASE("Test auth filter validity", "[ocpp]") {
+	struct ocpp_auth_filter filter;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_filter_init(&filter, 16, 10));
+
+	// A filter that is not valid must not reject any token
+	TEST_ASSERT_TRUE(ocpp_auth_filter_may_contain(&filter, "UNKNOWN"));
+	TEST_ASSERT_EQUAL_UINT32(0, filter.misses);
+
+	ocpp_auth_filter_clear(&filter, true);
+	TEST_ASSERT_FALSE(ocpp_auth_filter_may_contain(&filter, "UNKNOWN"));
+	TEST_ASSERT_FALSE(ocpp_auth_filter_should_rebuild(&filter));
+
+	ocpp_auth_filter_add(&filter, "A");
+	ocpp_auth_filter_add(&filter, "B");
+	ocpp_auth_filter_on_removed(&filter, 1);
+	TEST_ASSERT_TRUE(ocpp_auth_filter_should_rebuild(&filter));
+
+	ocpp_auth_filter_deinit(&filter);
+
+	// A disabled filter never rejects
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_filter_init(&filter, 16, 0));
+	ocpp_auth_filter_clear(&filter, true);
+	TEST_ASSERT_TRUE(ocpp_auth_filter_may_contain(&filter, "UNKNOWN"));
+	ocpp_auth_filter_deinit(&filter);
+}
+
+TEST_CASE("Test auth filter save and load", "[ocpp]") {
+	struct ocpp_auth_filter filter;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_filter_init(&filter, 64, 10));
+	ocpp_auth_filter_clear(&filter, true);
+
+	ocpp_id_token id_tag;
+	for(size_t i = 0; i < 32; i++){
+		create_token(i, id_tag);
+		ocpp_auth_filter_add(&filter, id_tag);
+	}
+
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_filter_save(&filter, TEST_FILTER_PATH, 1234));
+	ocpp_auth_filter_deinit(&filter);
+
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_filter_init(&filter, 64, 10));
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_STATE, ocpp_auth_filter_load(&filter, TEST_FILTER_PATH, 4321));
+	TEST_ASSERT_FALSE(filter.valid);
+
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_filter_load(&filter, TEST_FILTER_PATH, 1234));
+	TEST_ASSERT_TRUE(filter.valid);
+	TEST_ASSERT_EQUAL_UINT32(32, filter.inserted);
+
+	for(size_t i = 0; i < 32; i++){
+		create_token(i, id_tag);
+		TEST_ASSERT_TRUE(ocpp_auth_filter_may_contain(&filter, id_tag));
+	}
+
+	ocpp_auth_filter_deinit(&filter);
+
+	// Filter size must match
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_filter_init(&filter, 128, 10));
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_STATE, ocpp_auth_filter_load(&filter, TEST_FILTER_PATH, 1234));
+	ocpp_auth_filter_deinit(&filter);
+
+	remove(TEST_FILTER_PATH);
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_filter_init(&filter, 64, 10));
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_NOT_FOUND, ocpp_auth_filter_load(&filter, TEST_FILTER_PATH, 1234));
+	ocpp_auth_filter_deinit(&filter);
+}
@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "ocpp_auth_index.h"
+#include "types/ocpp_id_token.h"
+
+static const char *TAG = "OCPPTEST";
+
+#define TEST_AUTH_PATH "/files/auth_idx.bin"
+#define TEST_TOKEN_LIST_OFFSET 16
+#define TEST_INDEX_OFFSET(max_entries) (TEST_TOKEN_LIST_OFFSET + sizeof(ocpp_id_token) * (max_entries))
+
+static void create_token(size_t nr, ocpp_id_token id_tag){
+	memset(id_tag, 0, sizeof(ocpp_id_token));
+	snprintf(id_tag, sizeof(ocpp_id_token), "%08X%zu", (unsigned int)(nr * 2654435761u), nr);
+}
+
+static void write_token(FILE * fp, size_t entry, const char * id_tag){
+	ocpp_id_token padded = {0};
+	strncpy(padded, id_tag, sizeof(padded) -1);
+
+	TEST_ASSERT_EQUAL_INT(0, fseek(fp, TEST_TOKEN_LIST_OFFSET + sizeof(ocpp_id_token) * entry, SEEK_SET));
+	TEST_ASSERT_EQUAL_INT(1, fwrite(padded, sizeof(ocpp_id_token), 1, fp));
+}
+
+// Writes token_count tokens to a new token list without creating an index
+static FILE * create_token_list(size_t max_entries, size_t token_count){
+	remove(TEST_AUTH_PATH);
+
+	FILE * fp = fopen(TEST_AUTH_PATH, "w+b");
+	TEST_ASSERT_NOT_NULL(fp);
+
+	ocpp_id_token id_tag;
+	for(size_t i = 0; i < max_entries; i++){
+		if(i < token_count){
+			create_token(i, id_tag);
+		}else{
+			memset(id_tag, 0, sizeof(id_tag));
+		}
+
+		write_token(fp, i, id_tag);
+	}
+
+	return fp;
+}
+
+static void build_index(FILE * fp, size_t max_entries, size_t token_count, uint32_t header_crc){
+	struct ocpp_auth_index index;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_index_begin(&index, fp, TEST_TOKEN_LIST_OFFSET, TEST_INDEX_OFFSET(max_entries),
+								max_entries, header_crc, token_count, false));
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_index_commit(&index, header_crc));
+	ocpp_auth_index_close(&index);
+}
+
+TEST_CASE("Test auth index find after rebuild", "[ocpp]") {
+	const size_t max_entries = 64;
+	FILE * fp = create_token_list(max_entries, 50);
+	build_index(fp, max_entries, 50, 1);
+
+	struct ocpp_auth_index index;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_index_open(&index, fp, TEST_TOKEN_LIST_OFFSET, TEST_INDEX_OFFSET(max_entries), max_entries, 1));
+
+	ocpp_id_token id_tag;
+	size_t entry;
+	for(size_t i = 0; i < 50; i++){
+		create_token(i, id_tag);
+		TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_index_find(&index, id_tag, &entry));
+		TEST_ASSERT_EQUAL_INT(i, entry);
+	}
+
+	for(size_t i = 50; i < 100; i++){
+		create_token(i, id_tag);
+		TEST_ASSERT_EQUAL_INT(ESP_ERR_NOT_FOUND, ocpp_auth_index_find(&index, id_tag, &entry));
+	}
+
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_NOT_FOUND, ocpp_auth_index_find(&index, "", &entry));
+
+	ocpp_auth_index_close(&index);
+
+	// The index is only valid for the header it was committed with
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_STATE,
+			ocpp_auth_index_open(&index, fp, TEST_TOKEN_LIST_OFFSET, TEST_INDEX_OFFSET(max_entries), max_entries, 2));
+
+	fclose(fp);
+	remove(TEST_AUTH_PATH);
+}
+
+TEST_CASE("Test auth index missing for old file", "[ocpp]") {
+	const size_t max_entries = 16;
+	FILE * fp = create_token_list(max_entries, 4);
+
+	struct ocpp_auth_index index;
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_STATE,
+			ocpp_auth_index_open(&index, fp, TEST_TOKEN_LIST_OFFSET, TEST_INDEX_OFFSET(max_entries), max_entries, 0));
+
+	fclose(fp);
+	remove(TEST_AUTH_PATH);
+}
+
+TEST_CASE("Test auth index insert, remove and allocate", "[ocpp]") {
+	const size_t max_entries = 32;
+	FILE * fp = create_token_list(max_entries, 0);
+
+	struct ocpp_auth_index index;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_index_begin(&index, fp, TEST_TOKEN_LIST_OFFSET, TEST_INDEX_OFFSET(max_entries),
+								max_entries, 0, 0, true));
+
+	ocpp_id_token id_tag;
+	size_t entry;
+	for(size_t i = 0; i < max_entries; i++){
+		TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_index_allocate_entry(&index, &entry));
+		TEST_ASSERT_EQUAL_INT(i, entry);
+
+		create_token(i, id_tag);
+		write_token(fp, entry, id_tag);
+		TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_index_insert(&index, id_tag, entry));
+	}
+
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_NO_MEM, ocpp_auth_index_allocate_entry(&index, &entry));
+
+	// Remove every other token and check that the vacant entries are reused
+	for(size_t i = 0; i < max_entries; i += 2){
+		create_token(i, id_tag);
+		TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_index_remove(&index, id_tag, i));
+		write_token(fp, i, "");
+		TEST_ASSERT_FALSE(ocpp_auth_index_entry_is_occupied(&index, i));
+	}
+
+	for(size_t i = 0; i < max_entries; i++){
+		create_token(i, id_tag);
+		esp_err_t err = ocpp_auth_index_find(&index, id_tag, &entry);
+
+		if(i % 2 == 0){
+			TEST_ASSERT_EQUAL_INT(ESP_ERR_NOT_FOUND, err);
+		}else{
+			TEST_ASSERT_EQUAL_INT(ESP_OK, err);
+			TEST_ASSERT_EQUAL_INT(i, entry);
+		}
+	}
+
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_index_allocate_entry(&index, &entry));
+	TEST_ASSERT_EQUAL_INT(0, entry);
+
+	create_token(1000, id_tag);
+	write_token(fp, entry, id_tag);
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_index_insert(&index, id_tag, entry));
+
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_index_commit(&index, 42));
+	ocpp_auth_index_close(&index);
+
+	// State is kept after commit
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_index_begin(&index, fp, TEST_TOKEN_LIST_OFFSET, TEST_INDEX_OFFSET(max_entries),
+								max_entries, 42, max_entries / 2 + 1, false));
+	TEST_ASSERT_TRUE(ocpp_auth_index_entry_is_occupied(&index, 0));
+	TEST_ASSERT_FALSE(ocpp_auth_index_entry_is_occupied(&index, 2));
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_index_find(&index, id_tag, &entry));
+	TEST_ASSERT_EQUAL_INT(0, entry);
+
+	ocpp_auth_index_close(&index);
+
+	// An index that was not committed is rebuilt
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_STATE,
+			ocpp_auth_index_open(&index, fp, TEST_TOKEN_LIST_OFFSET, TEST_INDEX_OFFSET(max_entries), max_entries, 42));
+
+	build_index(fp, max_entries, max_entries / 2 + 1, 43);
+
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_index_open(&index, fp, TEST_TOKEN_LIST_OFFSET, TEST_INDEX_OFFSET(max_entries), max_entries, 43));
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_index_find(&index, id_tag, &entry));
+	TEST_ASSERT_EQUAL_INT(0, entry);
+
+	create_token(3, id_tag);
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_index_find(&index, id_tag, &entry));
+	TEST_ASSERT_EQUAL_INT(3, entry);
+	ocpp_auth_index_close(&index);
+
+	fclose(fp);
+	remove(TEST_AUTH_PATH);
+}
+
+static esp_err_t linear_find(FILE * fp, size_t token_count, const char * id_tag, size_t * entry_out){
+	ocpp_id_token found_tag;
+
+	if(fseek(fp, TEST_TOKEN_LIST_OFFSET, SEEK_SET) != 0)
+		return ESP_FAIL;
+
+	size_t read_count = 0;
+	for(size_t entry = 0; read_count < token_count; entry++){
+		if(fread(found_tag, sizeof(ocpp_id_token), 1, fp) != 1)
+			return ESP_FAIL;
+
+		if(found_tag[0] == '\0')
+			continue;
+
+		read_count++;
+		if(strcmp(found_tag, id_tag) == 0){
+			*entry_out = entry;
+			return ESP_OK;
+		}
+	}
+
+	return ESP_ERR_NOT_FOUND;
+}
+
+TEST_CASE("Test auth index lookup time", "[ocpp]") {
+	const size_t entry_counts[] = {100, 1000, 10000};
+	const size_t lookup_count = 100;
+
+	for(size_t i = 0; i < sizeof(entry_counts) / sizeof(entry_counts[0]); i++){
+		const size_t max_entries = entry_counts[i];
+		FILE * fp = create_token_list(max_entries, max_entries);
+
+		int64_t start = esp_timer_get_time();
+		build_index(fp, max_entries, max_entries, 1);
+		int64_t rebuild_time = esp_timer_get_time() - start;
+
+		struct ocpp_auth_index index;
+		TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_auth_index_open(&index, fp, TEST_TOKEN_LIST_OFFSET, TEST_INDEX_OFFSET(max_entries), max_entries, 1));
+
+		ocpp_id_token id_tag;
+		size_t entry;
+		int64_t index_time = 0;
+		int64_t linear_time = 0;
+
+		for(size_t j = 0; j < lookup_count; j++){
+			// Spread the lookups over the list and include misses
+			size_t nr = (j * 7919) % (max_entries + max_entries / 10);
+			create_token(nr, id_tag);
+
+			start = esp_timer_get_time();
+			esp_err_t index_err = ocpp_auth_index_find(&index, id_tag, &entry);
+			index_time += esp_timer_get_time() - start;
+
+			if(nr < max_entries){
+				TEST_ASSERT_EQUAL_INT(ESP_OK, index_err);
+				TEST_ASSERT_EQUAL_INT(nr, entry);
+			}else{
+				TEST_ASSERT_EQUAL_INT(ESP_ERR_NOT_FOUND, index_err);
+			}
+
+			start = esp_timer_get_time();
+			esp_err_t linear_err = linear_find(fp, max_entries, id_tag, &entry);
+			linear_time += esp_timer_get_time() - start;
+
+			TEST_ASSERT_EQUAL_INT(index_err, linear_err);
+		}
+
+		ocpp_auth_index_close(&index);
+
+		ESP_LOGI(TAG, "%zu entries: index %lld us/lookup, linear scan %lld us/lookup, rebuild %lld ms, index size %zu bytes",
+			max_entries, index_time / lookup_count, linear_time / lookup_count, rebuild_time / 1000,
+			ocpp_auth_index_size(max_entries));
+
+		fclose(fp);
+		remove(TEST_AUTH_PATH);
+	}
+}
@@ -0,0 +1,716 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "ocpp_charging_timeline.h"
+#include "legacy_composite_schedule.h"
+
+static const char *TAG = "OCPPTEST";
+
+#define TEST_MAX_PERIODS 64
+#define TEST_START 1700000000
+
+/*
+ * Profile with storage for the optional fields and periods so that tests do not need to allocate.
+ */
+struct test_profile{
+	struct ocpp_charging_profile profile;
+	struct ocpp_charging_schedule_period_list periods[TEST_MAX_PERIODS];
+	time_t start_schedule;
+	int duration;
+	enum ocpp_recurrency_kind recurrency_kind;
+	int transaction_id;
+};
+
+static void create_profile(struct test_profile * test_profile, int stack_level, enum ocpp_charging_profile_kind kind, time_t start_schedule,
+			size_t period_count, const int * start_periods, const float * limits){
+
+	memset(test_profile, 0, sizeof(struct test_profile));
+
+	struct ocpp_charging_profile * profile = &test_profile->profile;
+	profile->stack_level = stack_level;
+	profile->profile_purpose = eOCPP_CHARGING_PROFILE_PURPOSE_TX_DEFAULT;
+	profile->profile_kind = kind;
+	profile->valid_from = 0;
+	profile->valid_to = LONG_MAX;
+
+	test_profile->start_schedule = start_schedule;
+	if(kind != eOCPP_CHARGING_PROFILE_KIND_RELATIVE)
+		profile->charging_schedule.start_schedule = &test_profile->start_schedule;
+
+	profile->charging_schedule.charge_rate_unit = eOCPP_CHARGING_RATE_A;
+	profile->charging_schedule.min_charging_rate = 6.0f;
+
+	struct ocpp_charging_schedule_period_list * period = &profile->charging_schedule.schedule_period;
+	for(size_t i = 0; i < period_count; i++){
+		if(i > 0){
+			period->next = &test_profile->periods[i];
+			period = period->next;
+		}
+
+		period->value.start_period = start_periods[i];
+		period->value.limit = limits[i];
+		period->value.number_phases = 3;
+	}
+}
+
+static void set_duration(struct test_profile * test_profile, int duration){
+	test_profile->duration = duration;
+	test_profile->profile.charging_schedule.duration = &test_profile->duration;
+}
+
+static void set_recurrency(struct test_profile * test_profile, enum ocpp_recurrency_kind recurrency_kind){
+	test_profile->recurrency_kind = recurrency_kind;
+	test_profile->profile.recurrency_kind = &test_profile->recurrency_kind;
+}
+
+// Always active profile with lowest precedence, like the default profiles used by smart charging
+static const struct ocpp_charging_profile * default_profile(){
+	static struct test_profile profile;
+	static bool created = false;
+
+	if(!created){
+		const int starts[] = {0};
+		const float limits[] = {32.0f};
+		create_profile(&profile, -1, eOCPP_CHARGING_PROFILE_KIND_ABSOLUTE, 0, 1, starts, limits);
+		created = true;
+	}
+
+	return &profile.profile;
+}
+
+static void assert_entry(struct ocpp_charging_timeline * timeline, time_t when, float expected_limit, time_t expected_next_change){
+	time_t next_change;
+	const struct ocpp_charging_timeline_entry * entry = ocpp_charging_timeline_at(timeline, when, &next_change);
+
+	TEST_ASSERT_NOT_NULL(entry);
+	TEST_ASSERT_EQUAL_FLOAT(expected_limit, entry->limit);
+	TEST_ASSERT_EQUAL_INT64(expected_next_change, next_change);
+}
+
+/*
+ * Reference implementation used to verify the sweep. At each change it evaluates the profiles in order of precedence
+ * from their first period, like the timeline was built before profile cursors were introduced.
+ */
+static bool reference_period_at(const struct ocpp_charging_profile * profile, time_t relative_start, const int * transaction_id,
+				time_t when, struct ocpp_charging_schedule_period * period_out, time_t * change_out){
+
+	*change_out = LONG_MAX;
+
+	if(profile->transaction_id != NULL && transaction_id != NULL && *profile->transaction_id != *transaction_id)
+		return false;
+
+	if(when >= profile->valid_to)
+		return false;
+
+	if(when < profile->valid_from){
+		*change_out = profile->valid_from;
+		return false;
+	}
+
+	const struct ocpp_charging_schedule * schedule = &profile->charging_schedule;
+
+	time_t schedule_start;
+	time_t recurrency_interval = 0;
+
+	switch(profile->profile_kind){
+	case eOCPP_CHARGING_PROFILE_KIND_ABSOLUTE:
+		schedule_start = *schedule->start_schedule;
+		break;
+	case eOCPP_CHARGING_PROFILE_KIND_RECURRING:
+		recurrency_interval = (*profile->recurrency_kind == eOCPP_RECURRENCY_KIND_DAILY) ? 86400 : 604800;
+		schedule_start = *schedule->start_schedule;
+		if(when > schedule_start)
+			schedule_start = when - ((when - schedule_start) % recurrency_interval);
+		break;
+	default:
+		schedule_start = relative_start;
+	}
+
+	if(when < schedule_start){
+		if(schedule_start < profile->valid_to)
+			*change_out = schedule_start;
+
+		return false;
+	}
+
+	time_t offset = when - schedule_start;
+	time_t next_recurrence = (recurrency_interval > 0) ? schedule_start + recurrency_interval : LONG_MAX;
+
+	if(schedule->duration != NULL && offset >= *schedule->duration){
+		if(next_recurrence < profile->valid_to)
+			*change_out = next_recurrence;
+
+		return false;
+	}
+
+	const struct ocpp_charging_schedule_period_list * period = &schedule->schedule_period;
+	if(period->value.start_period > offset){
+		if(schedule_start + period->value.start_period < profile->valid_to)
+			*change_out = schedule_start + period->value.start_period;
+
+		return false;
+	}
+
+	while(period->next != NULL && period->next->value.start_period <= offset)
+		period = period->next;
+
+	*period_out = period->value;
+
+	time_t change = (next_recurrence < profile->valid_to) ? next_recurrence : profile->valid_to;
+
+	if(period->next != NULL && schedule_start + period->next->value.start_period < change)
+		change = schedule_start + period->next->value.start_period;
+
+	if(schedule->duration != NULL && schedule_start + *schedule->duration < change)
+		change = schedule_start + *schedule->duration;
+
+	*change_out = change;
+	return true;
+}
+
+static const struct ocpp_charging_profile * reference_prevailing_at(const struct ocpp_charging_profile * const * profiles, size_t count,
+								time_t relative_start, const int * transaction_id, time_t when,
+								struct ocpp_charging_schedule_period * period_out, time_t * change_out){
+	*change_out = LONG_MAX;
+
+	for(size_t i = 0; i < count; i++){
+		time_t change;
+		bool active = reference_period_at(profiles[i], relative_start, transaction_id, when, period_out, &change);
+
+		if(change < *change_out)
+			*change_out = change;
+
+		if(active)
+			return profiles[i];
+	}
+
+	return NULL;
+}
+
+static esp_err_t reference_build(struct ocpp_charging_timeline * timeline,
+				const struct ocpp_charging_profile * const * tx_profiles, size_t tx_count,
+				const struct ocpp_charging_profile * const * max_profiles, size_t max_count,
+				time_t relative_start, const int * transaction_id, time_t from, time_t to){
+	timeline->count = 0;
+	timeline->position = 0;
+
+	time_t when = from;
+	while(when < to){
+		struct ocpp_charging_schedule_period tx_period, max_period;
+		time_t tx_change, max_change;
+
+		const struct ocpp_charging_profile * tx = reference_prevailing_at(tx_profiles, tx_count, relative_start, transaction_id,
+										when, &tx_period, &tx_change);
+		const struct ocpp_charging_profile * max = reference_prevailing_at(max_profiles, max_count, relative_start, transaction_id,
+										when, &max_period, &max_change);
+
+		if(tx == NULL || max == NULL){
+			timeline->count = 0;
+			return ESP_ERR_NOT_FOUND;
+		}
+
+		struct ocpp_charging_timeline_entry entry = {
+			.start = when,
+			.limit = (tx_period.limit < max_period.limit) ? tx_period.limit : max_period.limit,
+			.number_phases = (tx_period.number_phases < max_period.number_phases) ? tx_period.number_phases : max_period.number_phases,
+			.min_charging_rate = (tx->charging_schedule.min_charging_rate < max->charging_schedule.min_charging_rate)
+				? tx->charging_schedule.min_charging_rate : max->charging_schedule.min_charging_rate,
+		};
+
+		struct ocpp_charging_timeline_entry * last = (timeline->count > 0) ? &timeline->entries[timeline->count -1] : NULL;
+		if(last == NULL || last->limit != entry.limit || last->number_phases != entry.number_phases
+			|| last->min_charging_rate != entry.min_charging_rate){
+
+			if(timeline->count == timeline->max_entries)
+				break;
+
+			timeline->entries[timeline->count++] = entry;
+		}
+
+		time_t next = (tx_change < max_change) ? tx_change : max_change;
+		when = (next > when) ? next : when + 1;
+	}
+
+	timeline->end = (when < to) ? when : to;
+	return ESP_OK;
+}
+
+static void assert_timelines_equal(struct ocpp_charging_timeline * expected, struct ocpp_charging_timeline * actual){
+	TEST_ASSERT_EQUAL_INT(expected->count, actual->count);
+	TEST_ASSERT_EQUAL_INT64(expected->end, actual->end);
+
+	for(size_t i = 0; i < expected->count; i++){
+		TEST_ASSERT_EQUAL_INT64(expected->entries[i].start, actual->entries[i].start);
+		TEST_ASSERT_EQUAL_FLOAT(expected->entries[i].limit, actual->entries[i].limit);
+		TEST_ASSERT_EQUAL_FLOAT(expected->entries[i].min_charging_rate, actual->entries[i].min_charging_rate);
+		TEST_ASSERT_EQUAL_INT(expected->entries[i].number_phases, actual->entries[i].number_phases);
+	}
+}
+
+// Deterministic pseudo random numbers to make failures reproducible
+static uint32_t test_random(uint32_t * state, uint32_t max){
+	*state = *state * 1103515245u + 12345u;
+	return (*state >> 8) % max;
+}
+
+static void create_random_profile(struct test_profile * test_profile, int stack_level, uint32_t * state){
+	int starts[TEST_MAX_PERIODS];
+	float limits[TEST_MAX_PERIODS];
+
+	size_t period_count = 1 + test_random(state, 16);
+	starts[0] = (test_random(state, 4) == 0) ? test_random(state, 120) * 60 : 0;
+	limits[0] = 6 + test_random(state, 27);
+
+	for(size_t i = 1; i < period_count; i++){
+		starts[i] = starts[i-1] + (1 + test_random(state, 120)) * 60;
+		limits[i] = 6 + test_random(state, 27);
+	}
+
+	enum ocpp_charging_profile_kind kind = test_random(state, 3);
+	time_t start_schedule = TEST_START - 86400 + test_random(state, 3 * 86400);
+	create_profile(test_profile, stack_level, kind, start_schedule, period_count, starts, limits);
+
+	struct ocpp_charging_profile * profile = &test_profile->profile;
+	profile->charging_schedule.min_charging_rate = 6.0f - test_random(state, 2);
+
+	struct ocpp_charging_schedule_period_list * period = &profile->charging_schedule.schedule_period;
+	for(; period != NULL; period = period->next)
+		period->value.number_phases = (test_random(state, 4) == 0) ? 1 : 3;
+
+	if(kind == eOCPP_CHARGING_PROFILE_KIND_RECURRING)
+		set_recurrency(test_profile, (test_random(state, 4) == 0) ? eOCPP_RECURRENCY_KIND_WEEKLY : eOCPP_RECURRENCY_KIND_DAILY);
+
+	if(test_random(state, 2) == 0)
+		set_duration(test_profile, starts[period_count-1] + test_random(state, 6 * 3600));
+
+	if(test_random(state, 4) == 0)
+		profile->valid_from = TEST_START + test_random(state, 86400);
+
+	if(test_random(state, 4) == 0)
+		profile->valid_to = TEST_START + test_random(state, 2 * 86400);
+
+	if(test_random(state, 4) == 0){
+		test_profile->transaction_id = 1 + test_random(state, 2);
+		profile->transaction_id = &test_profile->transaction_id;
+	}
+}
+
+TEST_CASE("Test charging timeline with default profiles", "[ocpp]") {
+	const struct ocpp_charging_profile * tx[] = {default_profile()};
+	const struct ocpp_charging_profile * max[] = {default_profile()};
+
+	struct ocpp_charging_timeline timeline;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_init(&timeline, 8));
+
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_build(&timeline, tx, 1, max, 1, TEST_START, NULL, TEST_START, TEST_START + 86400));
+	TEST_ASSERT_EQUAL_INT(1, timeline.count);
+	TEST_ASSERT_EQUAL_INT(3, timeline.entries[0].number_phases);
+	TEST_ASSERT_EQUAL_FLOAT(6.0f, timeline.entries[0].min_charging_rate);
+
+	assert_entry(&timeline, TEST_START + 100, 32.0f, TEST_START + 86400);
+
+	time_t next_change;
+	TEST_ASSERT_NULL(ocpp_charging_timeline_at(&timeline, TEST_START - 1, &next_change));
+	TEST_ASSERT_NULL(ocpp_charging_timeline_at(&timeline, TEST_START + 86400, &next_change));
+
+	ocpp_charging_timeline_deinit(&timeline);
+}
+
+TEST_CASE("Test charging timeline with stacked profiles", "[ocpp]") {
+	struct test_profile base, peak, tx_profile, max_profile;
+
+	const int base_starts[] = {0, 3600};
+	const float base_limits[] = {16.0f, 20.0f};
+	create_profile(&base, 0, eOCPP_CHARGING_PROFILE_KIND_ABSOLUTE, TEST_START, 2, base_starts, base_limits);
+
+	const int peak_starts[] = {0};
+	const float peak_limits[] = {10.0f};
+	create_profile(&peak, 1, eOCPP_CHARGING_PROFILE_KIND_ABSOLUTE, TEST_START + 600, 1, peak_starts, peak_limits);
+	set_duration(&peak, 600);
+
+	// Tx profile for another transaction must be ignored
+	const float tx_limits[] = {0.0f};
+	create_profile(&tx_profile, 0, eOCPP_CHARGING_PROFILE_KIND_RELATIVE, 0, 1, peak_starts, tx_limits);
+	tx_profile.profile.profile_purpose = eOCPP_CHARGING_PROFILE_PURPOSE_TX;
+	tx_profile.transaction_id = 2;
+	tx_profile.profile.transaction_id = &tx_profile.transaction_id;
+
+	const int max_starts[] = {0};
+	const float max_limits[] = {12.0f};
+	create_profile(&max_profile, 0, eOCPP_CHARGING_PROFILE_KIND_ABSOLUTE, TEST_START, 1, max_starts, max_limits);
+	max_profile.profile.profile_purpose = eOCPP_CHARGING_PROFILE_PURPOSE_CHARGE_POINT_MAX;
+	max_profile.profile.valid_from = TEST_START + 3000;
+	max_profile.profile.valid_to = TEST_START + 5000;
+
+	const struct ocpp_charging_profile * tx[] = {&tx_profile.profile, &peak.profile, &base.profile,
+						     default_profile()};
+	const struct ocpp_charging_profile * max[] = {&max_profile.profile,
+						      default_profile()};
+
+	struct ocpp_charging_timeline timeline;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_init(&timeline, 8));
+
+	int transaction_id = 1;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_build(&timeline, tx, 4, max, 2, TEST_START, &transaction_id,
+										TEST_START, TEST_START + 86400));
+
+	assert_entry(&timeline, TEST_START, 16.0f, TEST_START + 600);
+	assert_entry(&timeline, TEST_START + 600, 10.0f, TEST_START + 1200);
+	assert_entry(&timeline, TEST_START + 1200, 16.0f, TEST_START + 3000);
+	assert_entry(&timeline, TEST_START + 3000, 12.0f, TEST_START + 5000);
+	assert_entry(&timeline, TEST_START + 5000, 20.0f, TEST_START + 86400);
+	TEST_ASSERT_EQUAL_INT(5, timeline.count);
+
+	// Lookups may also go back in time
+	assert_entry(&timeline, TEST_START + 700, 10.0f, TEST_START + 1200);
+
+	// The tx profile applies to its own transaction
+	transaction_id = 2;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_build(&timeline, tx, 4, max, 2, TEST_START, &transaction_id,
+										TEST_START, TEST_START + 86400));
+	TEST_ASSERT_EQUAL_INT(1, timeline.count);
+	assert_entry(&timeline, TEST_START + 700, 0.0f, TEST_START + 86400);
+
+	ocpp_charging_timeline_deinit(&timeline);
+}
+
+TEST_CASE("Test charging timeline with recurring and relative profiles", "[ocpp]") {
+	struct test_profile daily, relative;
+
+	// Limited to 8A from 22:00 to 02:00 every day
+	const int daily_starts[] = {0};
+	const float daily_limits[] = {8.0f};
+	create_profile(&daily, 1, eOCPP_CHARGING_PROFILE_KIND_RECURRING, TEST_START - 86400 * 3 - 7200, 1, daily_starts, daily_limits);
+	set_duration(&daily, 4 * 3600);
+	set_recurrency(&daily, eOCPP_RECURRENCY_KIND_DAILY);
+
+	// 10A for the first hour of the transaction, then 24A
+	const int relative_starts[] = {0, 3600};
+	const float relative_limits[] = {10.0f, 24.0f};
+	create_profile(&relative, 0, eOCPP_CHARGING_PROFILE_KIND_RELATIVE, 0, 2, relative_starts, relative_limits);
+
+	const struct ocpp_charging_profile * tx[] = {&daily.profile, &relative.profile,
+						     default_profile()};
+	const struct ocpp_charging_profile * max[] = {default_profile()};
+
+	struct ocpp_charging_timeline timeline;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_init(&timeline, 8));
+
+	time_t transaction_start = TEST_START - 1800;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_build(&timeline, tx, 3, max, 1, transaction_start, NULL,
+										TEST_START, TEST_START + 2 * 86400));
+
+	// Daily schedule started 2 hours before TEST_START
+	assert_entry(&timeline, TEST_START, 8.0f, TEST_START + 7200);
+	assert_entry(&timeline, TEST_START + 7200, 24.0f, TEST_START + 86400 - 7200);
+	assert_entry(&timeline, TEST_START + 86400 - 7200, 8.0f, TEST_START + 86400 + 7200);
+	assert_entry(&timeline, TEST_START + 86400 + 7200, 24.0f, TEST_START + 2 * 86400 - 7200);
+	assert_entry(&timeline, TEST_START + 2 * 86400 - 7200, 8.0f, TEST_START + 2 * 86400);
+
+	// Relative profile is active from transaction start
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_build(&timeline, &tx[1], 2, max, 1, transaction_start, NULL,
+										TEST_START, TEST_START + 86400));
+	assert_entry(&timeline, TEST_START, 10.0f, transaction_start + 3600);
+	assert_entry(&timeline, transaction_start + 3600, 24.0f, TEST_START + 86400);
+
+	ocpp_charging_timeline_deinit(&timeline);
+}
+
+TEST_CASE("Test charging timeline ends early when entries are exhausted", "[ocpp]") {
+	struct test_profile profile;
+
+	int starts[TEST_MAX_PERIODS];
+	float limits[TEST_MAX_PERIODS];
+	for(size_t i = 0; i < TEST_MAX_PERIODS; i++){
+		starts[i] = i * 60;
+		limits[i] = 6.0f + i % 2;
+	}
+
+	create_profile(&profile, 0, eOCPP_CHARGING_PROFILE_KIND_ABSOLUTE, TEST_START, TEST_MAX_PERIODS, starts, limits);
+
+	const struct ocpp_charging_profile * tx[] = {&profile.profile};
+	const struct ocpp_charging_profile * max[] = {default_profile()};
+
+	struct ocpp_charging_timeline timeline;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_init(&timeline, 4));
+
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_build(&timeline, tx, 1, max, 1, TEST_START, NULL,
+										TEST_START, TEST_START + 86400));
+	TEST_ASSERT_EQUAL_INT(4, timeline.count);
+	TEST_ASSERT_EQUAL_INT64(TEST_START + 4 * 60, timeline.end);
+
+	assert_entry(&timeline, TEST_START + 3 * 60, 7.0f, TEST_START + 4 * 60);
+
+	time_t next_change;
+	TEST_ASSERT_NULL(ocpp_charging_timeline_at(&timeline, TEST_START + 4 * 60, &next_change));
+
+	// No profile active
+	profile.profile.valid_from = TEST_START + 10;
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_NOT_FOUND, ocpp_charging_timeline_build(&timeline, tx, 1, max, 1, TEST_START, NULL,
+										TEST_START, TEST_START + 86400));
+	TEST_ASSERT_NULL(ocpp_charging_timeline_at(&timeline, TEST_START, &next_change));
+
+	ocpp_charging_timeline_deinit(&timeline);
+}
+
+TEST_CASE("Test charging timeline matches reference for random profiles", "[ocpp]") {
+	const size_t iterations = 200;
+	const size_t max_random_profiles = 8;
+
+	struct test_profile * profiles = malloc(sizeof(struct test_profile) * max_random_profiles);
+	TEST_ASSERT_NOT_NULL(profiles);
+
+	struct ocpp_charging_timeline expected, actual;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_init(&expected, 512));
+
+	uint32_t state = 42;
+	for(size_t i = 0; i < iterations; i++){
+		// Some iterations use few entries to verify that both end early at the same time
+		size_t max_entries = (i % 4 == 0) ? 8 : 512;
+		TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_init(&actual, max_entries));
+		expected.max_entries = max_entries;
+
+		const struct ocpp_charging_profile * tx[max_random_profiles + 1];
+		const struct ocpp_charging_profile * max[max_random_profiles + 1];
+		size_t tx_count = 1 + test_random(&state, max_random_profiles - 2);
+		size_t max_count = test_random(&state, max_random_profiles - tx_count + 1);
+
+		for(size_t j = 0; j < tx_count + max_count; j++){
+			create_random_profile(&profiles[j], max_random_profiles - j, &state);
+
+			if(j < tx_count){
+				tx[j] = &profiles[j].profile;
+			}else{
+				max[j - tx_count] = &profiles[j].profile;
+			}
+		}
+
+		// Without a default profile the stacks may not always be active
+		if(test_random(&state, 8) != 0)
+			tx[tx_count++] = default_profile();
+
+		max[max_count++] = default_profile();
+
+		int transaction_id = 1;
+		const int * active_transaction = (test_random(&state, 2) == 0) ? &transaction_id : NULL;
+		time_t relative_start = TEST_START - test_random(&state, 86400);
+
+		esp_err_t expected_err = reference_build(&expected, tx, tx_count, max, max_count, relative_start, active_transaction,
+							TEST_START, TEST_START + 2 * 86400);
+		esp_err_t actual_err = ocpp_charging_timeline_build(&actual, tx, tx_count, max, max_count, relative_start, active_transaction,
+								TEST_START, TEST_START + 2 * 86400);
+
+		TEST_ASSERT_EQUAL_INT(expected_err, actual_err);
+		if(expected_err == ESP_OK)
+			assert_timelines_equal(&expected, &actual);
+
+		ocpp_charging_timeline_deinit(&actual);
+	}
+
+	expected.max_entries = 512;
+	ocpp_charging_timeline_deinit(&expected);
+	free(profiles);
+}
+
+/*
+ * The previous composite schedule computation did not handle profiles where the first period does not start at 0,
+ * equal periods after each other, recurrences or profiles that become valid after the schedule starts. The profiles
+ * compared against it avoid these, as its output for them was never correct.
+ */
+static void create_random_legacy_profile(struct test_profile * test_profile, int stack_level,
+					enum ocpp_charging_profile_purpose purpose, uint32_t * state){
+	create_random_profile(test_profile, stack_level, state);
+
+	struct ocpp_charging_profile * profile = &test_profile->profile;
+	profile->profile_purpose = purpose;
+	profile->transaction_id = NULL;
+	profile->valid_from = 0;
+	profile->valid_to = LONG_MAX;
+	profile->charging_schedule.schedule_period.value.start_period = 0;
+
+	if(profile->profile_kind == eOCPP_CHARGING_PROFILE_KIND_RECURRING){
+		profile->profile_kind = eOCPP_CHARGING_PROFILE_KIND_ABSOLUTE;
+		profile->recurrency_kind = NULL;
+	}
+
+	if(test_profile->start_schedule > TEST_START)
+		test_profile->start_schedule -= 2 * 86400;
+
+	struct ocpp_charging_schedule_period_list * period = &profile->charging_schedule.schedule_period;
+	for(; period->next != NULL; period = period->next){
+		if(ocpp_period_is_equal_charge(&period->value, &period->next->value))
+			period->next->value.limit += 1.0f;
+	}
+}
+
+TEST_CASE("Test composite schedule matches previous implementation for random profiles", "[ocpp]") {
+	const size_t iterations = 200;
+	const size_t max_random_profiles = 8;
+
+	struct test_profile * profiles = malloc(sizeof(struct test_profile) * max_random_profiles);
+	TEST_ASSERT_NOT_NULL(profiles);
+
+	struct ocpp_charging_timeline timeline, expected;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_init(&timeline, 512));
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_init(&expected, 512));
+
+	uint32_t state = 7;
+	for(size_t i = 0; i < iterations; i++){
+		const struct ocpp_charging_profile * tx[max_random_profiles + 1];
+		const struct ocpp_charging_profile * max[max_random_profiles + 1];
+		size_t tx_count = test_random(&state, 5);
+		size_t max_count = test_random(&state, 4);
+
+		for(size_t j = 0; j < tx_count + max_count; j++){
+			if(j < tx_count){
+				create_random_legacy_profile(&profiles[j], max_random_profiles - j, eOCPP_CHARGING_PROFILE_PURPOSE_TX_DEFAULT, &state);
+				tx[j] = &profiles[j].profile;
+			}else{
+				create_random_legacy_profile(&profiles[j], max_random_profiles - j, eOCPP_CHARGING_PROFILE_PURPOSE_CHARGE_POINT_MAX, &state);
+				max[j - tx_count] = &profiles[j].profile;
+			}
+		}
+
+		tx[tx_count++] = ocpp_get_default_charging_profile(eOCPP_CHARGING_PROFILE_PURPOSE_TX_DEFAULT);
+		max[max_count++] = ocpp_get_default_charging_profile(eOCPP_CHARGING_PROFILE_PURPOSE_CHARGE_POINT_MAX);
+
+		int duration = 3600 + test_random(&state, 2 * 86400);
+
+		struct ocpp_charging_schedule legacy;
+		TEST_ASSERT_EQUAL_INT(ESP_OK, legacy_composite_schedule(tx, tx_count, max, max_count, TEST_START, duration, 512, &legacy));
+
+		TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_build(&timeline, tx, tx_count, max, max_count, TEST_START, NULL,
+										TEST_START, TEST_START + duration));
+
+		struct ocppj_charging_schedule schedule;
+		TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_to_schedule(&timeline, TEST_START, &schedule));
+
+		// The duration is capped at the shorter of the tx and max schedules
+		TEST_ASSERT_NOT_NULL(legacy.duration);
+		TEST_ASSERT_EQUAL_INT(*legacy.duration, schedule.duration);
+
+		/*
+		 * The previous implementation could list equal periods after each other and a period starting at the end of the
+		 * schedule. Periods now also change when only the minChargingRate changes. None of these change the limit the
+		 * charge point may use, so only the periods where the limit or number of phases change are compared.
+		 */
+		size_t index = 0;
+		const struct ocpp_charging_schedule_period * last = NULL;
+		for(struct ocpp_charging_schedule_period_list * period = &legacy.schedule_period; period != NULL; period = period->next){
+			if(period->value.start_period >= *legacy.duration || ocpp_period_is_equal_charge(last, &period->value))
+				continue;
+
+			TEST_ASSERT_LESS_THAN(schedule.charging_schedule_period_count, index);
+			TEST_ASSERT_EQUAL_INT(period->value.start_period, schedule.charging_schedule_period[index].start_period);
+			TEST_ASSERT_EQUAL_FLOAT(period->value.limit, schedule.charging_schedule_period[index].limit);
+			TEST_ASSERT_EQUAL_INT(period->value.number_phases, schedule.charging_schedule_period[index].number_phases);
+
+			last = &period->value;
+			do{
+				index++;
+			}while(index < schedule.charging_schedule_period_count
+				&& schedule.charging_schedule_period[index].limit == last->limit
+				&& schedule.charging_schedule_period[index].number_phases == last->number_phases);
+		}
+		TEST_ASSERT_EQUAL_INT(index, schedule.charging_schedule_period_count);
+
+		/*
+		 * The previous implementation always sent a minChargingRate of 0 as the rate was never copied from the profiles.
+		 * It is now the lowest rate of the profiles prevailing during the schedule.
+		 */
+		TEST_ASSERT_EQUAL_FLOAT(0.0f, legacy.min_charging_rate);
+		TEST_ASSERT_EQUAL_INT(ESP_OK, reference_build(&expected, tx, tx_count, max, max_count, TEST_START, NULL,
+								TEST_START, TEST_START + duration));
+
+		float min_charging_rate = expected.entries[0].min_charging_rate;
+		for(size_t j = 1; j < expected.count; j++){
+			if(expected.entries[j].min_charging_rate < min_charging_rate)
+				min_charging_rate = expected.entries[j].min_charging_rate;
+		}
+		TEST_ASSERT_EQUAL_FLOAT(min_charging_rate, schedule.min_charging_rate);
+
+		free(schedule.charging_schedule_period);
+		ocpp_free_charging_schedule(&legacy, false);
+	}
+
+	ocpp_charging_timeline_deinit(&timeline);
+	ocpp_charging_timeline_deinit(&expected);
+	free(profiles);
+}
+
+TEST_CASE("Test charging timeline build time", "[ocpp]") {
+	const size_t profile_counts[] = {1, 4, 8, 16};
+	const size_t period_counts[] = {1, 8, 32, 64};
+	const size_t build_count = 10;
+
+	struct test_profile * profiles = malloc(sizeof(struct test_profile) * 16);
+	TEST_ASSERT_NOT_NULL(profiles);
+
+	struct ocpp_charging_timeline timeline, expected;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_init(&timeline, 4096));
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_init(&expected, 4096));
+
+	int starts[TEST_MAX_PERIODS];
+	float limits[TEST_MAX_PERIODS];
+
+	for(size_t i = 0; i < sizeof(profile_counts) / sizeof(profile_counts[0]); i++){
+		for(size_t j = 0; j < sizeof(period_counts) / sizeof(period_counts[0]); j++){
+			const struct ocpp_charging_profile * tx[17];
+			size_t tx_count = 0;
+
+			// Daily recurring profiles where profiles with higher precedence are shorter and partly cover the others
+			for(size_t k = 0; k < profile_counts[i]; k++){
+				for(size_t l = 0; l < period_counts[j]; l++){
+					starts[l] = l * (3600 * 12 / period_counts[j]);
+					limits[l] = 6.0f + (k + l) % 26;
+				}
+
+				create_profile(&profiles[k], profile_counts[i] - k, eOCPP_CHARGING_PROFILE_KIND_RECURRING,
+					TEST_START - 86400 + k * 1800, period_counts[j], starts, limits);
+				set_recurrency(&profiles[k], eOCPP_RECURRENCY_KIND_DAILY);
+				set_duration(&profiles[k], 3600 * 12 / (profile_counts[i] - k));
+
+				tx[tx_count++] = &profiles[k].profile;
+			}
+
+			tx[tx_count++] = default_profile();
+			const struct ocpp_charging_profile * max[] = {default_profile()};
+
+			int64_t start = esp_timer_get_time();
+			for(size_t k = 0; k < build_count; k++){
+				TEST_ASSERT_EQUAL_INT(ESP_OK, reference_build(&expected, tx, tx_count, max, 1, TEST_START, NULL,
+										TEST_START, TEST_START + 86400));
+			}
+			int64_t reference_time = (esp_timer_get_time() - start) / build_count;
+
+			start = esp_timer_get_time();
+			for(size_t k = 0; k < build_count; k++){
+				TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_charging_timeline_build(&timeline, tx, tx_count, max, 1, TEST_START, NULL,
+												TEST_START, TEST_START + 86400));
+			}
+			int64_t build_time = (esp_timer_get_time() - start) / build_count;
+
+			assert_timelines_equal(&expected, &timeline);
+
+			// Stepping through the timeline for each second of the horizon
+			start = esp_timer_get_time();
+			time_t next_change;
+			for(time_t when = TEST_START; when < TEST_START + 86400; when++)
+				TEST_ASSERT_NOT_NULL(ocpp_charging_timeline_at(&timeline, when, &next_change));
+			int64_t step_time = esp_timer_get_time() - start;
+
+			ESP_LOGI(TAG, "%zu profiles with %zu periods: %zu entries, build %lld us (reference %lld us), lookup %lld ns",
+				profile_counts[i], period_counts[j], timeline.count, build_time, reference_time, step_time * 1000 / 86400);
+		}
+	}
+
+	ocpp_charging_timeline_deinit(&timeline);
+	ocpp_charging_timeline_deinit(&expected);
+	free(profiles);
+}
@@ -0,0 +1,412 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <inttypes.h>
+
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "cJSON.h"
+
+#include "ocpp_config_registry.h"
+
+static const char *TAG = "OCPPTEST";
+
+/*
+ * Configuration similar to the keys of OCPP 1.6 core, local auth list, reservation and smart charging profiles, used to
+ * test the registry without the storage of the application.
+ */
+static bool test_bool[12];
+static uint8_t test_u8[5];
+static uint16_t test_u16[3];
+static uint32_t test_u32[9];
+static char test_string[4][64];
+static int on_change_count = 0;
+
+#define TEST_BOOL_GETTER(i) static bool get_bool_##i(){ return test_bool[i]; } static void set_bool_##i(bool value){ test_bool[i] = value; }
+#define TEST_U8_GETTER(i) static uint8_t get_u8_##i(){ return test_u8[i]; } static void set_u8_##i(uint8_t value){ test_u8[i] = value; }
+#define TEST_U16_GETTER(i) static uint16_t get_u16_##i(){ return test_u16[i]; } static void set_u16_##i(uint16_t value){ test_u16[i] = value; }
+#define TEST_U32_GETTER(i) static uint32_t get_u32_##i(){ return test_u32[i]; } static void set_u32_##i(uint32_t value){ test_u32[i] = value; }
+#define TEST_STRING_GETTER(i) static const char * get_string_##i(){ return test_string[i]; } \
+	static void set_string_##i(const char * value){ strncpy(test_string[i], value, sizeof(test_string[i]) - 1); }
+
+TEST_BOOL_GETTER(0) TEST_BOOL_GETTER(1) TEST_BOOL_GETTER(2) TEST_BOOL_GETTER(3) TEST_BOOL_GETTER(4) TEST_BOOL_GETTER(5)
+TEST_BOOL_GETTER(6) TEST_BOOL_GETTER(7) TEST_BOOL_GETTER(8) TEST_BOOL_GETTER(9) TEST_BOOL_GETTER(10) TEST_BOOL_GETTER(11)
+TEST_U8_GETTER(0) TEST_U8_GETTER(1) TEST_U8_GETTER(2) TEST_U8_GETTER(3) TEST_U8_GETTER(4)
+TEST_U16_GETTER(0) TEST_U16_GETTER(1) TEST_U16_GETTER(2)
+TEST_U32_GETTER(0) TEST_U32_GETTER(1) TEST_U32_GETTER(2) TEST_U32_GETTER(3) TEST_U32_GETTER(4)
+TEST_U32_GETTER(5) TEST_U32_GETTER(6) TEST_U32_GETTER(7) TEST_U32_GETTER(8)
+TEST_STRING_GETTER(0) TEST_STRING_GETTER(1) TEST_STRING_GETTER(2) TEST_STRING_GETTER(3)
+
+static bool is_valid_interval(uint32_t value){
+	return value <= 86400;
+}
+
+static bool is_short_string(const char * value){
+	return strlen(value) <= 20;
+}
+
+static void count_change(){
+	on_change_count++;
+}
+
+static const char * get_pair(char * buffer, size_t buffer_size){
+	snprintf(buffer, buffer_size, "0.%s,1.%s", test_string[3], test_string[3]);
+	return buffer;
+}
+
+static int set_pair(const char * value){
+	if(strncmp(value, "1.", 2) != 0)
+		return -1;
+
+	set_string_3(value + 2);
+	return 0;
+}
+
+#define BOOL_KEY(name, i) {.key = name, .type = eOCPP_CONFIG_TYPE_BOOL, .get.boolean = get_bool_##i, .set.boolean = set_bool_##i}
+#define U8_KEY(name, i) {.key = name, .type = eOCPP_CONFIG_TYPE_U8, .get.u8 = get_u8_##i, .set.u8 = set_u8_##i}
+#define U16_KEY(name, i) {.key = name, .type = eOCPP_CONFIG_TYPE_U16, .get.u16 = get_u16_##i, .set.u16 = set_u16_##i}
+#define U32_KEY(name, i) {.key = name, .type = eOCPP_CONFIG_TYPE_U32, .get.u32 = get_u32_##i, .set.u32 = set_u32_##i}
+#define CONSTANT_KEY(name, value) {.key = name, .type = eOCPP_CONFIG_TYPE_CONSTANT, .read_only = true, .constant = value}
+
+static const struct ocpp_config_key test_keys[] = {
+	BOOL_KEY("AllowOfflineTxForUnknownId", 0),
+	BOOL_KEY("AuthorizationCacheEnabled", 1),
+	BOOL_KEY("AuthorizeRemoteTxRequests", 2),
+	{.key = "ClockAlignedDataInterval", .type = eOCPP_CONFIG_TYPE_U32, .get.u32 = get_u32_0, .set.u32 = set_u32_0,
+	 .validate.u32 = is_valid_interval, .on_change = count_change},
+	U32_KEY("ConnectionTimeOut", 1),
+	{.key = "ConnectorPhaseRotation", .type = eOCPP_CONFIG_TYPE_CUSTOM, .get.custom = get_pair, .set.custom = set_pair},
+	CONSTANT_KEY("ConnectorPhaseRotationMaxLength", "2"),
+	CONSTANT_KEY("GetConfigurationMaxKeys", "20"),
+	U32_KEY("HeartbeatInterval", 2),
+	U8_KEY("LightIntensity", 0),
+	BOOL_KEY("LocalAuthorizeOffline", 3),
+	BOOL_KEY("LocalPreAuthorize", 4),
+	U16_KEY("MessageTimeout", 0),
+	{.key = "MeterValuesAlignedData", .type = eOCPP_CONFIG_TYPE_STRING, .get.string = get_string_0, .set.string = set_string_0},
+	CONSTANT_KEY("MeterValuesAlignedDataMaxLength", "10"),
+	{.key = "MeterValuesSampledData", .type = eOCPP_CONFIG_TYPE_STRING, .get.string = get_string_1, .set.string = set_string_1},
+	CONSTANT_KEY("MeterValuesSampledDataMaxLength", "10"),
+	U32_KEY("MeterValueSampleInterval", 3),
+	U32_KEY("MinimumStatusDuration", 4),
+	CONSTANT_KEY("NumberOfConnectors", "1"),
+	U8_KEY("ResetRetries", 1),
+	CONSTANT_KEY("StopTransactionMaxMeterValues", "100"),
+	BOOL_KEY("StopTransactionOnEVSideDisconnect", 5),
+	BOOL_KEY("StopTransactionOnInvalidId", 6),
+	U32_KEY("StopTxnAlignedData", 5),
+	CONSTANT_KEY("StopTxnAlignedDataMaxLength", "10"),
+	U32_KEY("StopTxnSampledData", 6),
+	CONSTANT_KEY("StopTxnSampledDataMaxLength", "10"),
+	CONSTANT_KEY("SupportedFeatureProfiles", "Core,FirmwareManagement,LocalAuthListManagement,Reservation,SmartCharging,RemoteTrigger"),
+	CONSTANT_KEY("SupportedFeatureProfilesMaxLength", "6"),
+	U8_KEY("TransactionMessageAttempts", 2),
+	U16_KEY("TransactionMessageRetryInterval", 1),
+	BOOL_KEY("UnlockConnectorOnEVSideDisconnect", 7),
+	U32_KEY("WebSocketPingInterval", 7),
+	CONSTANT_KEY("SupportedFileTransferProtocols", "HTTP,HTTPS,FTP,FTPS"),
+	BOOL_KEY("LocalAuthListEnabled", 8),
+	CONSTANT_KEY("LocalAuthListMaxLength", "1024"),
+	CONSTANT_KEY("SendLocalListMaxLength", "64"),
+	CONSTANT_KEY("ReserveConnectorZeroSupported", "true"),
+	CONSTANT_KEY("ChargeProfileMaxStackLevel", "8"),
+	CONSTANT_KEY("ChargingScheduleAllowedChargingRateUnit", "Current"),
+	CONSTANT_KEY("ChargingScheduleMaxPeriods", "20"),
+	CONSTANT_KEY("ConnectorSwitch3to1PhaseSupported", "false"),
+	CONSTANT_KEY("MaxChargingProfilesInstalled", "16"),
+	U8_KEY("SecurityProfile", 3),
+	{.key = "AuthorizationKey", .type = eOCPP_CONFIG_TYPE_CUSTOM, .set.custom = set_pair},
+	{.key = "DefaultIdToken", .type = eOCPP_CONFIG_TYPE_STRING, .get.string = get_string_2, .set.string = set_string_2,
+	 .validate.string = is_short_string},
+	BOOL_KEY("AuthorizationRequired", 9),
+	BOOL_KEY("ExtraBool1", 10),
+	BOOL_KEY("ExtraBool2", 11),
+	U8_KEY("ExtraU8", 4),
+	U16_KEY("ExtraU16", 2),
+	U32_KEY("ExtraU32", 8),
+	{.key = "ExtraString", .type = eOCPP_CONFIG_TYPE_STRING, .get.string = get_string_3, .set.string = set_string_3},
+};
+
+#define TEST_KEY_COUNT (sizeof(test_keys) / sizeof(test_keys[0]))
+
+static void reset_test_values(){
+	memset(test_bool, 0, sizeof(test_bool));
+	memset(test_u8, 0, sizeof(test_u8));
+	memset(test_u16, 0, sizeof(test_u16));
+	memset(test_u32, 0, sizeof(test_u32));
+	memset(test_string, 0, sizeof(test_string));
+	on_change_count = 0;
+
+	strcpy(test_string[0], "Energy.Active.Import.Register,Current.Import.L1,Voltage.L1");
+	strcpy(test_string[1], "Current.Offered,Power.Active.Import");
+	strcpy(test_string[3], "RST");
+	test_u32[2] = 3600;
+}
+
+static void to_mixed_case(const char * key, char * buffer){
+	size_t i = 0;
+	for(; key[i] != '\0'; i++)
+		buffer[i] = (i % 2 == 0) ? toupper((unsigned char)key[i]) : tolower((unsigned char)key[i]);
+
+	buffer[i] = '\0';
+}
+
+TEST_CASE("Test config registry finds all keys", "[ocpp]") {
+	struct ocpp_config_registry registry;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_config_registry_init(&registry, test_keys, TEST_KEY_COUNT, 256));
+	TEST_ASSERT_NOT_NULL(registry.slots);
+
+	char key[64];
+	for(size_t i = 0; i < TEST_KEY_COUNT; i++){
+		TEST_ASSERT_EQUAL_PTR(&test_keys[i], ocpp_config_registry_find(&registry, test_keys[i].key));
+
+		to_mixed_case(test_keys[i].key, key);
+		TEST_ASSERT_EQUAL_PTR(&test_keys[i], ocpp_config_registry_find(&registry, key));
+	}
+
+	TEST_ASSERT_NULL(ocpp_config_registry_find(&registry, "BlinkRepeat"));
+	TEST_ASSERT_NULL(ocpp_config_registry_find(&registry, "HeartbeatInterva"));
+	TEST_ASSERT_NULL(ocpp_config_registry_find(&registry, ""));
+
+	ocpp_config_registry_deinit(&registry);
+}
+
+TEST_CASE("Test config registry parses and validates values", "[ocpp]") {
+	reset_test_values();
+
+	struct ocpp_config_registry registry;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_config_registry_init(&registry, test_keys, TEST_KEY_COUNT, 256));
+
+	const struct ocpp_config_key * entry = ocpp_config_registry_find(&registry, "AllowOfflineTxForUnknownId");
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_config_registry_set_value(entry, "TRUE"));
+	TEST_ASSERT_TRUE(test_bool[0]);
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_ARG, ocpp_config_registry_set_value(entry, "1"));
+	TEST_ASSERT_TRUE(test_bool[0]);
+
+	entry = ocpp_config_registry_find(&registry, "LightIntensity");
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_config_registry_set_value(entry, "255"));
+	TEST_ASSERT_EQUAL_UINT8(255, test_u8[0]);
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_ARG, ocpp_config_registry_set_value(entry, "256"));
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_ARG, ocpp_config_registry_set_value(entry, "-1"));
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_ARG, ocpp_config_registry_set_value(entry, "12a"));
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_ARG, ocpp_config_registry_set_value(entry, ""));
+	TEST_ASSERT_EQUAL_UINT8(255, test_u8[0]);
+
+	entry = ocpp_config_registry_find(&registry, "ClockAlignedDataInterval");
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_config_registry_set_value(entry, "900"));
+	TEST_ASSERT_EQUAL_UINT32(900, test_u32[0]);
+	TEST_ASSERT_EQUAL_INT(1, on_change_count);
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_ARG, ocpp_config_registry_set_value(entry, "86401"));
+	TEST_ASSERT_EQUAL_UINT32(900, test_u32[0]);
+	TEST_ASSERT_EQUAL_INT(1, on_change_count);
+
+	entry = ocpp_config_registry_find(&registry, "MessageTimeout");
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_config_registry_set_value(entry, "0x10"));
+	TEST_ASSERT_EQUAL_UINT16(16, test_u16[0]);
+
+	entry = ocpp_config_registry_find(&registry, "DefaultIdToken");
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_config_registry_set_value(entry, "DEFAULT"));
+	TEST_ASSERT_EQUAL_STRING("DEFAULT", test_string[2]);
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_ARG, ocpp_config_registry_set_value(entry, "TOKEN_LONGER_THAN_20_CHARACTERS"));
+
+	entry = ocpp_config_registry_find(&registry, "ConnectorPhaseRotation");
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_config_registry_set_value(entry, "1.TSR"));
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_ARG, ocpp_config_registry_set_value(entry, "TSR"));
+
+	char buffer[OCPP_CONFIG_VALUE_BUFFER_SIZE];
+	TEST_ASSERT_EQUAL_STRING("0.TSR,1.TSR", ocpp_config_registry_get_value(entry, buffer, sizeof(buffer)));
+
+	entry = ocpp_config_registry_find(&registry, "NumberOfConnectors");
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_NOT_SUPPORTED, ocpp_config_registry_set_value(entry, "2"));
+	TEST_ASSERT_EQUAL_STRING("1", ocpp_config_registry_get_value(entry, buffer, sizeof(buffer)));
+
+	entry = ocpp_config_registry_find(&registry, "AuthorizationKey");
+	TEST_ASSERT_NULL(ocpp_config_registry_get_value(entry, buffer, sizeof(buffer)));
+
+	ocpp_config_registry_deinit(&registry);
+}
+
+static void assert_key_value(cJSON * key_list, const char * key, bool read_only, const char * value){
+	cJSON * key_value;
+	cJSON_ArrayForEach(key_value, key_list){
+		if(strcmp(cJSON_GetObjectItem(key_value, "key")->valuestring, key) == 0){
+			TEST_ASSERT_EQUAL(read_only, cJSON_IsTrue(cJSON_GetObjectItem(key_value, "readonly")));
+			TEST_ASSERT_EQUAL_STRING(value, cJSON_GetObjectItem(key_value, "value")->valuestring);
+			return;
+		}
+	}
+
+	TEST_FAIL_MESSAGE(key);
+}
+
+TEST_CASE("Test config registry writes GetConfiguration.conf", "[ocpp]") {
+	reset_test_values();
+	strcpy(test_string[3], "\"quoted\"\\\n");
+
+	struct ocpp_config_registry registry;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_config_registry_init(&registry, test_keys, TEST_KEY_COUNT, 16));
+
+	char * message;
+	size_t length;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_config_registry_write_configuration(&registry, "id-1", NULL, 0, &message, &length));
+	TEST_ASSERT_EQUAL(strlen(message), length);
+
+	cJSON * response = cJSON_Parse(message);
+	TEST_ASSERT_NOT_NULL(response);
+	TEST_ASSERT_EQUAL_INT(3, cJSON_GetArrayItem(response, 0)->valueint);
+	TEST_ASSERT_EQUAL_STRING("id-1", cJSON_GetArrayItem(response, 1)->valuestring);
+
+	cJSON * payload = cJSON_GetArrayItem(response, 2);
+	cJSON * key_list = cJSON_GetObjectItem(payload, "configurationKey");
+	TEST_ASSERT_EQUAL_INT(TEST_KEY_COUNT - 1, cJSON_GetArraySize(key_list)); // AuthorizationKey is write only
+	TEST_ASSERT_FALSE(cJSON_HasObjectItem(payload, "unknownKey"));
+
+	assert_key_value(key_list, "HeartbeatInterval", false, "3600");
+	assert_key_value(key_list, "NumberOfConnectors", true, "1");
+	assert_key_value(key_list, "AllowOfflineTxForUnknownId", false, "false");
+	assert_key_value(key_list, "ExtraString", false, "\"quoted\"\\\n");
+	assert_key_value(key_list, "ConnectorPhaseRotation", false, "0.\"quoted\"\\\n,1.\"quoted\"\\\n");
+
+	cJSON_Delete(response);
+	free(message);
+
+	const char * requested_keys[] = {"heartbeatinterval", "BlinkRepeat", "AuthorizationKey", "NumberOfConnectors"};
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_config_registry_write_configuration(&registry, "id-2", requested_keys, 4, &message, &length));
+
+	response = cJSON_Parse(message);
+	TEST_ASSERT_NOT_NULL(response);
+
+	payload = cJSON_GetArrayItem(response, 2);
+	key_list = cJSON_GetObjectItem(payload, "configurationKey");
+	TEST_ASSERT_EQUAL_INT(2, cJSON_GetArraySize(key_list));
+	assert_key_value(key_list, "HeartbeatInterval", false, "3600");
+
+	cJSON * unknown_keys = cJSON_GetObjectItem(payload, "unknownKey");
+	TEST_ASSERT_EQUAL_INT(2, cJSON_GetArraySize(unknown_keys));
+	TEST_ASSERT_EQUAL_STRING("BlinkRepeat", cJSON_GetArrayItem(unknown_keys, 0)->valuestring);
+	TEST_ASSERT_EQUAL_STRING("AuthorizationKey", cJSON_GetArrayItem(unknown_keys, 1)->valuestring);
+
+	cJSON_Delete(response);
+	free(message);
+
+	ocpp_config_registry_deinit(&registry);
+}
+
+/*
+ * Counts the memory held by cJSON to compare the registry with building the response as a cJSON tree, as was done
+ * before the registry.
+ */
+static size_t cjson_heap_in_use = 0;
+static size_t cjson_heap_peak = 0;
+
+static void * counting_malloc(size_t size){
+	size_t * allocation = malloc(sizeof(size_t) + size);
+	if(allocation == NULL)
+		return NULL;
+
+	*allocation = size;
+	cjson_heap_in_use += size;
+	if(cjson_heap_in_use > cjson_heap_peak)
+		cjson_heap_peak = cjson_heap_in_use;
+
+	return allocation + 1;
+}
+
+static void counting_free(void * pointer){
+	if(pointer == NULL)
+		return;
+
+	size_t * allocation = (size_t *)pointer - 1;
+	cjson_heap_in_use -= *allocation;
+	free(allocation);
+}
+
+static char * write_with_cjson(const struct ocpp_config_registry * registry, const char * const * requested_keys, size_t requested_count){
+	char value_buffer[OCPP_CONFIG_VALUE_BUFFER_SIZE];
+
+	cJSON * key_list = cJSON_CreateArray();
+	cJSON * unknown_keys = cJSON_CreateArray();
+
+	for(size_t i = 0; i < (requested_count > 0 ? requested_count : registry->key_count); i++){
+		const struct ocpp_config_key * entry = (requested_count > 0) ? ocpp_config_registry_find(registry, requested_keys[i]) : &registry->keys[i];
+		const char * value = (entry != NULL) ? ocpp_config_registry_get_value(entry, value_buffer, sizeof(value_buffer)) : NULL;
+
+		if(value != NULL){
+			cJSON * key_value = cJSON_CreateObject();
+			cJSON_AddStringToObject(key_value, "key", entry->key);
+			cJSON_AddBoolToObject(key_value, "readonly", entry->read_only);
+			cJSON_AddStringToObject(key_value, "value", value);
+			cJSON_AddItemToArray(key_list, key_value);
+		}else if(requested_count > 0){
+			cJSON_AddItemToArray(unknown_keys, cJSON_CreateString(requested_keys[i]));
+		}
+	}
+
+	cJSON * payload = cJSON_CreateObject();
+	cJSON_AddItemToObject(payload, "configurationKey", key_list);
+	if(cJSON_GetArraySize(unknown_keys) > 0){
+		cJSON_AddItemToObject(payload, "unknownKey", unknown_keys);
+	}else{
+		cJSON_Delete(unknown_keys);
+	}
+
+	cJSON * message = cJSON_CreateArray();
+	cJSON_AddItemToArray(message, cJSON_CreateNumber(3));
+	cJSON_AddItemToArray(message, cJSON_CreateString("id"));
+	cJSON_AddItemToArray(message, payload);
+
+	char * result = cJSON_PrintUnformatted(message);
+	cJSON_Delete(message);
+
+	return result;
+}
+
+TEST_CASE("Test config registry response build time and heap", "[ocpp]") {
+	reset_test_values();
+
+	const char * partial_keys[] = {"HeartbeatInterval", "MeterValuesSampledData", "BlinkRepeat", "LocalAuthListEnabled",
+		"SupportedFeatureProfiles"};
+	const size_t repetitions = 200;
+
+	for(size_t partial = 0; partial < 2; partial++){
+		const char * const * requested_keys = partial ? partial_keys : NULL;
+		size_t requested_count = partial ? sizeof(partial_keys) / sizeof(partial_keys[0]) : 0;
+
+		struct ocpp_config_registry registry;
+		TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_config_registry_init(&registry, test_keys, TEST_KEY_COUNT, 256));
+
+		char * message;
+		size_t length;
+		int64_t start = esp_timer_get_time();
+		for(size_t i = 0; i < repetitions; i++){
+			TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_config_registry_write_configuration(&registry, "id", requested_keys, requested_count,
+												&message, &length));
+			free(message);
+		}
+		int64_t registry_time = (esp_timer_get_time() - start) / repetitions;
+		size_t registry_heap = registry.buffer_size; // The response buffer is the only allocation
+
+		cJSON_Hooks hooks = {.malloc_fn = counting_malloc, .free_fn = counting_free};
+		cJSON_InitHooks(&hooks);
+		cjson_heap_peak = 0;
+
+		start = esp_timer_get_time();
+		for(size_t i = 0; i < repetitions; i++){
+			char * cjson_message = write_with_cjson(&registry, requested_keys, requested_count);
+			TEST_ASSERT_NOT_NULL(cjson_message);
+			counting_free(cjson_message);
+		}
+		int64_t cjson_time = (esp_timer_get_time() - start) / repetitions;
+
+		cJSON_InitHooks(NULL);
+
+		ESP_LOGI(TAG, "%s request (%zu bytes): registry %" PRId64 " us with %zu bytes heap, cJSON tree %" PRId64 " us with %zu bytes heap",
+			partial ? "Partial" : "Full", length, registry_time, registry_heap, cjson_time, cjson_heap_peak);
+
+		TEST_ASSERT_LESS_THAN(cjson_heap_peak, registry_heap);
+
+		ocpp_config_registry_deinit(&registry);
+	}
+}
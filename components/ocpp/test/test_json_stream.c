@@ -0,0 +1,328 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+#include "esp_log.h"
+#include "cJSON.h"
+
+#include "ocpp_json_stream.h"
+
+static const char *TAG = "OCPPTEST";
+
+#define TEST_FRAGMENT_SIZE 1024
+#define TEST_AUTH_ENTRIES 1200
+#define TEST_PERIODS 2500
+
+/*
+ * Counts the heap used by cJSON so that the memory needed for the tree can be compared with cJSON_Parse.
+ */
+static size_t heap_in_use = 0;
+static size_t heap_peak = 0;
+
+static void * counting_malloc(size_t size){
+	size_t * allocation = malloc(sizeof(size_t) + size);
+	if(allocation == NULL)
+		return NULL;
+
+	*allocation = size;
+	heap_in_use += size;
+	if(heap_in_use > heap_peak)
+		heap_peak = heap_in_use;
+
+	return allocation + 1;
+}
+
+static void counting_free(void * pointer){
+	if(pointer == NULL)
+		return;
+
+	size_t * allocation = (size_t *)pointer - 1;
+	heap_in_use -= *allocation;
+	free(allocation);
+}
+
+static void start_counting(){
+	cJSON_Hooks hooks = {.malloc_fn = counting_malloc, .free_fn = counting_free};
+	cJSON_InitHooks(&hooks);
+	heap_in_use = 0;
+	heap_peak = 0;
+}
+
+static void stop_counting(){
+	cJSON_InitHooks(NULL);
+}
+
+static esp_err_t feed_fragmented(struct ocpp_json_stream * stream, const char * data, size_t fragment_size){
+	size_t length = strlen(data);
+
+	for(size_t offset = 0; offset < length; offset += fragment_size){
+		size_t fragment_length = (length - offset < fragment_size) ? length - offset : fragment_size;
+		esp_err_t err = ocpp_json_stream_feed(stream, data + offset, fragment_length);
+		if(err != ESP_OK)
+			return err;
+	}
+
+	return ESP_OK;
+}
+
+/*
+ * Writes an OCPP call with the given action whose payload contains a large array. The array is written by add_element.
+ */
+static char * create_frame(const char * action, const char * payload_start, const char * payload_end, size_t element_count,
+			int (*add_element)(char * buffer, size_t buffer_size, size_t index)){
+	size_t size = 256 + strlen(payload_start) + strlen(payload_end) + element_count * 160;
+	char * frame = malloc(size);
+	TEST_ASSERT_NOT_NULL(frame);
+
+	size_t length = snprintf(frame, size, "[2,\"frame-id\",\"%s\",%s", action, payload_start);
+	for(size_t i = 0; i < element_count; i++){
+		if(i > 0)
+			frame[length++] = ',';
+		length += add_element(frame + length, size - length, i);
+	}
+	length += snprintf(frame + length, size - length, "%s]", payload_end);
+	TEST_ASSERT_LESS_THAN(size, length);
+
+	return frame;
+}
+
+static int add_authorization_data(char * buffer, size_t buffer_size, size_t index){
+	return snprintf(buffer, buffer_size, "{\"idTag\":\"TAG%05zu\",\"idTagInfo\":{\"expiryDate\":\"2030-01-01T00:00:00Z\","
+			"\"parentIdTag\":\"PARENT%05zu\",\"status\":\"Accepted\"}}", index, index % 7);
+}
+
+static int add_period(char * buffer, size_t buffer_size, size_t index){
+	return snprintf(buffer, buffer_size, "{\"startPeriod\":%zu,\"limit\":%zu.5,\"numberPhases\":%d}", index * 60, index % 32, index % 2 ? 1 : 3);
+}
+
+struct stream_test{
+	const char * action;
+	const char * const * path;
+	size_t path_length;
+	size_t element_count;
+	const char * expected_field;
+};
+
+static void select_path(struct ocpp_json_stream * stream, cJSON * root, size_t index, void * cb_data){
+	struct stream_test * test = cb_data;
+
+	if(index == 2 && strcmp(cJSON_GetArrayItem(root, 2)->valuestring, test->action) == 0)
+		TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_json_stream_set_array_path(stream, test->path, test->path_length));
+}
+
+static int check_element(cJSON * element, size_t index, void * cb_data){
+	struct stream_test * test = cb_data;
+
+	TEST_ASSERT_EQUAL_INT(test->element_count, index);
+	TEST_ASSERT_TRUE(cJSON_IsObject(element));
+	TEST_ASSERT_TRUE(cJSON_HasObjectItem(element, test->expected_field));
+
+	if(strcmp(test->expected_field, "idTag") == 0){
+		char expected[16];
+		snprintf(expected, sizeof(expected), "TAG%05zu", index);
+		TEST_ASSERT_EQUAL_STRING(expected, cJSON_GetObjectItem(element, "idTag")->valuestring);
+	}else{
+		TEST_ASSERT_EQUAL_INT(index * 60, cJSON_GetObjectItem(element, "startPeriod")->valueint);
+	}
+
+	test->element_count++;
+	return 0;
+}
+
+TEST_CASE("Test json stream gives same tree as cJSON_Parse", "[ocpp]") {
+	const char * documents[] = {
+		"[2,\"id\",\"Heartbeat\",{}]",
+		"[3, \"id\", {\"currentTime\": \"2024-01-01T00:00:00.000Z\"}]",
+		" {\"a\":[1,-2.5,3e2,true,false,null,[],{}],\"b\":{\"c\":\"d\\\"\\\\\\/\\b\\f\\n\\r\\t\"}} ",
+		"[\"\\u00e6\\u00f8\\u00e5\",\"\\ud83d\\ude00\",\"\\u0041\"]",
+		"\"text\"",
+		"42",
+		"[[[[[[]]]]]]",
+	};
+
+	const size_t fragment_sizes[] = {1, 3, 7, 1024};
+
+	for(size_t i = 0; i < sizeof(documents) / sizeof(documents[0]); i++){
+		cJSON * expected = cJSON_Parse(documents[i]);
+		TEST_ASSERT_NOT_NULL(expected);
+		char * expected_text = cJSON_PrintUnformatted(expected);
+
+		for(size_t j = 0; j < sizeof(fragment_sizes) / sizeof(fragment_sizes[0]); j++){
+			struct ocpp_json_stream stream;
+			ocpp_json_stream_init(&stream, OCPP_JSON_STREAM_DEFAULT_MAX_TOKEN_LENGTH, NULL, NULL, NULL);
+
+			TEST_ASSERT_EQUAL_INT(ESP_OK, feed_fragmented(&stream, documents[i], fragment_sizes[j]));
+
+			cJSON * actual;
+			TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_json_stream_finish(&stream, &actual));
+
+			char * actual_text = cJSON_PrintUnformatted(actual);
+			TEST_ASSERT_EQUAL_STRING(expected_text, actual_text);
+
+			free(actual_text);
+			cJSON_Delete(actual);
+			ocpp_json_stream_deinit(&stream);
+		}
+
+		free(expected_text);
+		cJSON_Delete(expected);
+	}
+}
+
+TEST_CASE("Test json stream rejects invalid data", "[ocpp]") {
+	const char * documents[] = {
+		"[2,\"id\",]",
+		"{\"a\" 1}",
+		"{\"a\":1,}",
+		"[1 2]",
+		"[tru]",
+		"[1.2.3]",
+		"[\"\\x\"]",
+		"[\"\\ud83d\"]",
+		"[\"\\ude00\"]",
+		"[1]]",
+		"{\"a\":[1}",
+	};
+
+	struct ocpp_json_stream stream;
+	ocpp_json_stream_init(&stream, 16, NULL, NULL, NULL);
+
+	for(size_t i = 0; i < sizeof(documents) / sizeof(documents[0]); i++){
+		cJSON * root;
+		esp_err_t err = ocpp_json_stream_feed(&stream, documents[i], strlen(documents[i]));
+		if(err == ESP_OK)
+			err = ocpp_json_stream_finish(&stream, &root);
+
+		if(err == ESP_OK)
+			ESP_LOGE(TAG, "Accepted invalid document '%s'", documents[i]);
+
+		TEST_ASSERT_NOT_EQUAL(ESP_OK, err);
+		ocpp_json_stream_reset(&stream);
+	}
+
+	// Incomplete, too long and too deep values
+	const char * incomplete = "[2,\"id\",\"Reset\",{\"type\":";
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_json_stream_feed(&stream, incomplete, strlen(incomplete)));
+	cJSON * root;
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_STATE, ocpp_json_stream_finish(&stream, &root));
+	TEST_ASSERT_NULL(root);
+	ocpp_json_stream_reset(&stream);
+
+	const char * long_token = "[\"0123456789abcdefg\"]";
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_SIZE, ocpp_json_stream_feed(&stream, long_token, strlen(long_token)));
+	ocpp_json_stream_reset(&stream);
+
+	const char * deep = "[[[[[[[[[[[[[[[[[[[[]]]]]]]]]]]]]]]]]]]]";
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_SIZE, ocpp_json_stream_feed(&stream, deep, strlen(deep)));
+	ocpp_json_stream_reset(&stream);
+
+	// The parser can be used again after errors
+	const char * valid = "[3,\"id\",{}]";
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_json_stream_feed(&stream, valid, strlen(valid)));
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_json_stream_finish(&stream, &root));
+	TEST_ASSERT_EQUAL_INT(3, cJSON_GetArraySize(root));
+	cJSON_Delete(root);
+
+	ocpp_json_stream_deinit(&stream);
+}
+
+static int stop_at_third(cJSON * element, size_t index, void * cb_data){
+	return index == 2 ? -1 : 0;
+}
+
+TEST_CASE("Test json stream element callback can stop parsing", "[ocpp]") {
+	const char * path[] = {"list"};
+	const char * document = "{\"list\":[{\"a\":[1,2]},{\"a\":[3]},{\"a\":[4,5,6]},{\"a\":[]}]}";
+
+	struct ocpp_json_stream stream;
+	ocpp_json_stream_init(&stream, OCPP_JSON_STREAM_DEFAULT_MAX_TOKEN_LENGTH, NULL, stop_at_third, NULL);
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_json_stream_set_array_path(&stream, path, 1));
+
+	TEST_ASSERT_EQUAL_INT(ESP_FAIL, ocpp_json_stream_feed(&stream, document, strlen(document)));
+	TEST_ASSERT_EQUAL_INT(3, stream.streamed_count);
+
+	// Resetting in the middle of a streamed element must free the unattached element
+	ocpp_json_stream_reset(&stream);
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_json_stream_set_array_path(&stream, path, 1));
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_json_stream_feed(&stream, document, 18));
+	ocpp_json_stream_deinit(&stream);
+}
+
+static void test_large_frame(struct stream_test * test, const char * payload_start, const char * payload_end, size_t element_count,
+			int (*add_element)(char * buffer, size_t buffer_size, size_t index), const char * remaining_field){
+
+	char * frame = create_frame(test->action, payload_start, payload_end, element_count, add_element);
+	size_t frame_length = strlen(frame);
+	TEST_ASSERT_GREATER_THAN(100 * 1024, frame_length);
+
+	start_counting();
+	cJSON * parsed = cJSON_Parse(frame);
+	TEST_ASSERT_NOT_NULL(parsed);
+	size_t parse_peak = heap_peak;
+	cJSON_Delete(parsed);
+
+	struct ocpp_json_stream stream;
+	ocpp_json_stream_init(&stream, OCPP_JSON_STREAM_DEFAULT_MAX_TOKEN_LENGTH, select_path, check_element, test);
+
+	heap_in_use = 0;
+	heap_peak = 0;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, feed_fragmented(&stream, frame, TEST_FRAGMENT_SIZE));
+
+	cJSON * root;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_json_stream_finish(&stream, &root));
+	size_t stream_peak = heap_peak;
+
+	TEST_ASSERT_EQUAL_INT(element_count, test->element_count);
+	TEST_ASSERT_EQUAL_INT(element_count, stream.streamed_count);
+
+	// The rest of the payload is kept and the streamed array is left empty
+	cJSON * payload = cJSON_GetArrayItem(root, 3);
+	TEST_ASSERT_TRUE(cJSON_HasObjectItem(payload, remaining_field));
+
+	cJSON * streamed = payload;
+	for(size_t i = 1; i < test->path_length; i++)
+		streamed = cJSON_GetObjectItem(streamed, test->path[i]);
+
+	TEST_ASSERT_TRUE(cJSON_IsArray(streamed));
+	TEST_ASSERT_EQUAL_INT(0, cJSON_GetArraySize(streamed));
+
+	ESP_LOGI(TAG, "%s frame of %zu bytes in %d byte fragments: cJSON_Parse peak heap %zu bytes, streamed peak heap %zu bytes + %zu bytes token buffer",
+		test->action, frame_length, TEST_FRAGMENT_SIZE, parse_peak, stream_peak, stream.token_size);
+
+	TEST_ASSERT_LESS_THAN(4096, stream_peak);
+	TEST_ASSERT_LESS_THAN(parse_peak / 50, stream_peak);
+
+	cJSON_Delete(root);
+	ocpp_json_stream_deinit(&stream);
+	stop_counting();
+	free(frame);
+}
+
+TEST_CASE("Test json stream large SendLocalList frame", "[ocpp]") {
+	const char * path[] = {"3", "localAuthorizationList"};
+	struct stream_test test = {
+		.action = "SendLocalList",
+		.path = path,
+		.path_length = 2,
+		.expected_field = "idTag",
+	};
+
+	test_large_frame(&test, "{\"listVersion\":12,\"localAuthorizationList\":[", "],\"updateType\":\"Full\"}",
+			TEST_AUTH_ENTRIES, add_authorization_data, "updateType");
+}
+
+TEST_CASE("Test json stream large SetChargingProfile frame", "[ocpp]") {
+	const char * path[] = {"3", "csChargingProfiles", "chargingSchedule", "chargingSchedulePeriod"};
+	struct stream_test test = {
+		.action = "SetChargingProfile",
+		.path = path,
+		.path_length = 4,
+		.expected_field = "startPeriod",
+	};
+
+	test_large_frame(&test, "{\"connectorId\":1,\"csChargingProfiles\":{\"chargingProfileId\":5,\"stackLevel\":1,"
+			"\"chargingProfilePurpose\":\"TxDefaultProfile\",\"chargingProfileKind\":\"Absolute\",\"chargingSchedule\":{"
+			"\"chargingRateUnit\":\"A\",\"chargingSchedulePeriod\":[",
+			"],\"minChargingRate\":6}}}", TEST_PERIODS, add_period, "connectorId");
+}
@@ -0,0 +1,298 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+#include "esp_log.h"
+
+#include "ocpp_meter_retention.h"
+
+static const char *TAG = "OCPPTEST";
+
+#define TEST_START 1700006400 // Aligned to a whole day
+
+static const struct ocpp_retention_policy test_policy = {
+	.full_resolution_sec = 3600,
+	.boundary_sec = 900,
+};
+
+static void add_sample(struct ocpp_sampled_value_list * samples, const char * value, enum ocpp_reading_context_id context,
+		enum ocpp_measurand_id measurand, enum ocpp_phase_id phase, enum ocpp_unit_id unit){
+
+	struct ocpp_sampled_value sample = {
+		.context = context,
+		.measurand = measurand,
+		.phase = phase,
+		.unit = unit,
+	};
+	strncpy(sample.value, value, sizeof(sample.value) -1);
+
+	TEST_ASSERT_NOT_NULL(ocpp_sampled_list_add(samples, sample));
+}
+
+static size_t count_kept(const struct ocpp_retention_record * records, size_t record_count){
+	size_t kept = 0;
+	for(size_t i = 0; i < record_count; i++){
+		if(!(records[i].flags & OCPP_RETENTION_RECORD_DROPPED))
+			kept++;
+	}
+
+	return kept;
+}
+
+TEST_CASE("Test Retention record summarises stored meter value", "[ocpp]") {
+	struct ocpp_meter_value_list * list = ocpp_create_meter_list();
+	TEST_ASSERT_NOT_NULL(list);
+
+	struct ocpp_meter_value meter_value = {
+		.timestamp = TEST_START + 900,
+		.sampled_value = ocpp_create_sampled_list(),
+	};
+	TEST_ASSERT_NOT_NULL(meter_value.sampled_value);
+
+	add_sample(meter_value.sampled_value, "16.0", eOCPP_CONTEXT_SAMPLE_CLOCK, eOCPP_MEASURAND_CURRENT_IMPORT, eOCPP_PHASE_L1, eOCPP_UNIT_A);
+	add_sample(meter_value.sampled_value, "3.2", eOCPP_CONTEXT_SAMPLE_CLOCK, eOCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER, eOCPP_PHASE_L1, eOCPP_UNIT_KWH);
+	add_sample(meter_value.sampled_value, "12.5", eOCPP_CONTEXT_SAMPLE_CLOCK, eOCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER, 0, eOCPP_UNIT_KWH);
+	add_sample(meter_value.sampled_value, "9999", eOCPP_CONTEXT_SAMPLE_CLOCK, eOCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER, eOCPP_PHASE_L2, eOCPP_UNIT_WH);
+
+	TEST_ASSERT_NOT_NULL(ocpp_meter_list_add(list, meter_value));
+	ocpp_sampled_list_delete(meter_value.sampled_value);
+
+	struct ocpp_retention_record record;
+	ocpp_meter_retention_record_from_list(list, false, 120, &record);
+
+	TEST_ASSERT_EQUAL_INT64(TEST_START + 900, record.timestamp);
+	TEST_ASSERT_EQUAL_UINT16(120, record.size);
+	TEST_ASSERT_EQUAL_UINT8(OCPP_RETENTION_RECORD_CLOCK_ALIGNED | OCPP_RETENTION_RECORD_HAS_ENERGY, record.flags);
+	TEST_ASSERT_EQUAL_FLOAT(12500.0f, record.energy_wh); // Overall register in Wh
+
+	ocpp_meter_retention_record_from_list(list, true, 120, &record);
+	TEST_ASSERT_TRUE(record.flags & OCPP_RETENTION_RECORD_PROTECTED);
+
+	ocpp_meter_list_delete(list);
+}
+
+TEST_CASE("Test Retention drops oldest values and keeps protected values", "[ocpp]") {
+	struct ocpp_retention_record records[20];
+
+	for(size_t i = 0; i < 20; i++){
+		records[i] = (struct ocpp_retention_record){
+			.timestamp = TEST_START + 17 + i * 600, // Not on a boundary
+			.energy_wh = 1000.0f + i * 100,
+			.size = 50,
+			.flags = OCPP_RETENTION_RECORD_HAS_ENERGY,
+		};
+	}
+
+	records[19].flags |= OCPP_RETENTION_RECORD_PROTECTED;
+	records[1].flags |= OCPP_RETENTION_RECORD_PROTECTED;
+
+	// Nothing to free
+	TEST_ASSERT_EQUAL(0, ocpp_meter_retention_thin(&test_policy, records, 20, 0));
+	TEST_ASSERT_EQUAL(20, count_kept(records, 20));
+
+	TEST_ASSERT_EQUAL(200, ocpp_meter_retention_thin(&test_policy, records, 20, 180));
+	TEST_ASSERT_EQUAL(16, count_kept(records, 20));
+
+	TEST_ASSERT_FALSE(records[0].flags & OCPP_RETENTION_RECORD_DROPPED);
+	TEST_ASSERT_FALSE(records[1].flags & OCPP_RETENTION_RECORD_DROPPED);
+
+	// The dropped values are among the oldest
+	for(size_t i = 10; i < 20; i++)
+		TEST_ASSERT_FALSE(records[i].flags & OCPP_RETENTION_RECORD_DROPPED);
+
+	// Values within the full resolution window of the newest value are never dropped
+	for(size_t i = 0; i < 20; i++)
+		records[i].flags &= ~OCPP_RETENTION_RECORD_DROPPED;
+
+	size_t freed = ocpp_meter_retention_thin(&test_policy, records, 20, 20 * 50);
+	TEST_ASSERT_LESS_THAN(20 * 50, freed);
+
+	for(size_t i = 0; i < 20; i++){
+		if(records[19].timestamp - records[i].timestamp < test_policy.full_resolution_sec)
+			TEST_ASSERT_FALSE(records[i].flags & OCPP_RETENTION_RECORD_DROPPED);
+	}
+
+	TEST_ASSERT_FALSE(records[0].flags & OCPP_RETENTION_RECORD_DROPPED);
+	TEST_ASSERT_FALSE(records[1].flags & OCPP_RETENTION_RECORD_DROPPED);
+}
+
+TEST_CASE("Test Retention keeps energy extremes and aligned boundaries", "[ocpp]") {
+	struct ocpp_retention_record records[100];
+
+	for(size_t i = 0; i < 100; i++){
+		records[i] = (struct ocpp_retention_record){
+			.timestamp = TEST_START + i * 300,
+			.energy_wh = 1000.0f + i * 10,
+			.size = 50,
+			.flags = OCPP_RETENTION_RECORD_HAS_ENERGY,
+		};
+
+		if(records[i].timestamp % 900 == 0)
+			records[i].flags |= OCPP_RETENTION_RECORD_CLOCK_ALIGNED;
+	}
+
+	// Meter replaced, register starts from a lower value
+	for(size_t i = 40; i < 100; i++)
+		records[i].energy_wh -= 900.0f;
+
+	TEST_ASSERT_GREATER_OR_EQUAL(50 * 50, ocpp_meter_retention_thin(&test_policy, records, 100, 50 * 50));
+
+	// The highest and lowest register values around the replacement are kept
+	TEST_ASSERT_FALSE(records[39].flags & OCPP_RETENTION_RECORD_DROPPED);
+	TEST_ASSERT_FALSE(records[40].flags & OCPP_RETENTION_RECORD_DROPPED);
+
+	size_t aligned_kept = 0;
+	size_t aligned_count = 0;
+	size_t hour_kept = 0;
+	size_t hour_count = 0;
+	size_t periodic_kept = 0;
+	size_t periodic_count = 0;
+
+	for(size_t i = 0; i < 88; i++){ // Outside full resolution window
+		bool kept = !(records[i].flags & OCPP_RETENTION_RECORD_DROPPED);
+
+		if(records[i].timestamp % 3600 == 0){
+			hour_count++;
+			hour_kept += kept;
+		}else if(records[i].flags & OCPP_RETENTION_RECORD_CLOCK_ALIGNED){
+			aligned_count++;
+			aligned_kept += kept;
+		}else{
+			periodic_count++;
+			periodic_kept += kept;
+		}
+	}
+
+	ESP_LOGI(TAG, "Kept %zu/%zu hourly, %zu/%zu aligned and %zu/%zu periodic values",
+		hour_kept, hour_count, aligned_kept, aligned_count, periodic_kept, periodic_count);
+
+	TEST_ASSERT_EQUAL(hour_count, hour_kept);
+	TEST_ASSERT_GREATER_THAN(periodic_kept * aligned_count, aligned_kept * periodic_count);
+}
+
+#define TEST_FILE_SIZE 65536
+#define TEST_HIGH_WATER (TEST_FILE_SIZE * 90 / 100)
+#define TEST_LOW_WATER (TEST_FILE_SIZE * 75 / 100)
+#define TEST_SAMPLE_INTERVAL 60
+#define TEST_CLOCK_INTERVAL 900
+#define TEST_OUTAGE_DAYS 7
+
+/*
+ * Stored sizes of meter values with the default measurands using the compact encoding. Periodic values have current,
+ * power and energy. Clock aligned values also have voltage on three phases.
+ */
+#define TEST_PERIODIC_SIZE 52
+#define TEST_CLOCK_SIZE 84
+
+static size_t remove_dropped(struct ocpp_retention_record * records, size_t record_count, size_t * used){
+	size_t kept = 0;
+	for(size_t i = 0; i < record_count; i++){
+		if(records[i].flags & OCPP_RETENTION_RECORD_DROPPED){
+			*used -= records[i].size;
+		}else{
+			records[kept++] = records[i];
+		}
+	}
+
+	return kept;
+}
+
+/* Median gap between kept values with a timestamp in the given range */
+static time_t median_gap(const struct ocpp_retention_record * records, size_t record_count, time_t from, time_t to){
+	static time_t gaps[TEST_OUTAGE_DAYS * 86400 / TEST_SAMPLE_INTERVAL];
+	size_t gap_count = 0;
+
+	for(size_t i = 1; i < record_count; i++){
+		if(records[i].timestamp >= from && records[i].timestamp < to)
+			gaps[gap_count++] = records[i].timestamp - records[i-1].timestamp;
+	}
+
+	if(gap_count == 0)
+		return 0;
+
+	// Insertion sort is fast enough for the few gaps in a day
+	for(size_t i = 1; i < gap_count; i++){
+		time_t gap = gaps[i];
+		size_t j = i;
+		for(; j > 0 && gaps[j-1] > gap; j--)
+			gaps[j] = gaps[j-1];
+		gaps[j] = gap;
+	}
+
+	return gaps[gap_count / 2];
+}
+
+TEST_CASE("Test Retention degrades resolution gradually during week long outage", "[ocpp]") {
+	const size_t max_records = TEST_FILE_SIZE / TEST_PERIODIC_SIZE;
+	struct ocpp_retention_record * records = malloc(max_records * sizeof(struct ocpp_retention_record));
+	TEST_ASSERT_NOT_NULL(records);
+
+	size_t record_count = 0;
+	size_t used = 0;
+	size_t max_used = 0;
+	size_t thin_count = 0;
+	float energy = 250000.0f;
+
+	for(time_t t = TEST_START; t < TEST_START + TEST_OUTAGE_DAYS * 86400; t += TEST_SAMPLE_INTERVAL){
+		bool clock_aligned = (t % TEST_CLOCK_INTERVAL == 0);
+		size_t size = clock_aligned ? TEST_CLOCK_SIZE : TEST_PERIODIC_SIZE;
+
+		if(used + size > TEST_HIGH_WATER){
+			ocpp_meter_retention_thin(&test_policy, records, record_count, used + size - TEST_LOW_WATER);
+			record_count = remove_dropped(records, record_count, &used);
+			thin_count++;
+
+			TEST_ASSERT_LESS_OR_EQUAL(TEST_LOW_WATER, used + size);
+		}
+
+		energy += 183.0f;
+		records[record_count++] = (struct ocpp_retention_record){
+			.timestamp = t,
+			.energy_wh = energy,
+			.size = size,
+			.flags = OCPP_RETENTION_RECORD_HAS_ENERGY | (clock_aligned ? OCPP_RETENTION_RECORD_CLOCK_ALIGNED : 0),
+		};
+		used += size;
+
+		if(used > max_used)
+			max_used = used;
+	}
+
+	TEST_ASSERT_LESS_OR_EQUAL(TEST_HIGH_WATER, max_used);
+	TEST_ASSERT_EQUAL_INT64(TEST_START, records[0].timestamp);
+
+	const time_t end = TEST_START + TEST_OUTAGE_DAYS * 86400;
+	ESP_LOGI(TAG, "%zu values kept using %zu bytes after thinning %zu times", record_count, used, thin_count);
+
+	// Newest hour is kept at full resolution
+	TEST_ASSERT_EQUAL(TEST_SAMPLE_INTERVAL, median_gap(records, record_count, end - 3600 + TEST_SAMPLE_INTERVAL, end));
+	TEST_ASSERT_EQUAL_INT64(end - TEST_SAMPLE_INTERVAL, records[record_count -1].timestamp);
+	TEST_ASSERT_EQUAL_INT64(end - 3600, records[record_count - 60].timestamp);
+
+	time_t previous_gap = TEST_SAMPLE_INTERVAL;
+	for(int day = TEST_OUTAGE_DAYS -1; day >= 0; day--){
+		time_t from = TEST_START + day * 86400;
+		time_t gap = median_gap(records, record_count, from, from + 86400);
+
+		size_t hours_kept = 0;
+		for(size_t i = 0; i < record_count; i++){
+			if(records[i].timestamp >= from && records[i].timestamp < from + 86400 && records[i].timestamp % 3600 == 0)
+				hours_kept++;
+		}
+
+		ESP_LOGI(TAG, "Day %d: median resolution %lld s, %zu of 24 whole hours kept", day + 1, (long long)gap, hours_kept);
+
+		// Older days have the same or coarser resolution, and the coarsest is still better than one value per hour
+		TEST_ASSERT_GREATER_OR_EQUAL(previous_gap, gap);
+		TEST_ASSERT_LESS_OR_EQUAL(3600, gap);
+		TEST_ASSERT_EQUAL(24, hours_kept);
+
+		previous_gap = gap;
+	}
+
+	for(size_t i = 1; i < record_count; i++)
+		TEST_ASSERT_GREATER_THAN(records[i-1].energy_wh, records[i].energy_wh);
+
+	free(records);
+}
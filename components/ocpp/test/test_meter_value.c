@@ -0,0 +1,223 @@
+#include <time.h>
+#include <string.h>
+
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "types/ocpp_meter_value.h"
+
+static const char *TAG = "OCPPTEST";
+
+static void add_sample(struct ocpp_sampled_value_list * samples, const char * value, enum ocpp_measurand_id measurand,
+		enum ocpp_phase_id phase, enum ocpp_unit_id unit){
+
+	struct ocpp_sampled_value sample = {
+		.context = eOCPP_CONTEXT_SAMPLE_PERIODIC,
+		.format = eOCPP_FORMAT_RAW,
+		.measurand = measurand,
+		.phase = phase,
+		.location = eOCPP_LOCATION_OUTLET,
+		.unit = unit,
+	};
+	strncpy(sample.value, value, sizeof(sample.value) -1);
+
+	TEST_ASSERT_NOT_NULL(ocpp_sampled_list_add(samples, sample));
+}
+
+// Creates meter values similar to the ones sampled with all supported measurands on three phases
+static struct ocpp_meter_value_list * create_full_meter_list(size_t meter_value_count, time_t start, int interval){
+	struct ocpp_meter_value_list * list = ocpp_create_meter_list();
+	TEST_ASSERT_NOT_NULL(list);
+
+	char value[64];
+	for(size_t i = 0; i < meter_value_count; i++){
+		struct ocpp_meter_value meter_value = {
+			.timestamp = start + i * interval,
+			.sampled_value = ocpp_create_sampled_list(),
+		};
+		TEST_ASSERT_NOT_NULL(meter_value.sampled_value);
+
+		for(enum ocpp_phase_id phase = eOCPP_PHASE_L1; phase <= eOCPP_PHASE_L3; phase++){
+			snprintf(value, sizeof(value), "%f", 16.0f + (i % 7) * 0.25f);
+			add_sample(meter_value.sampled_value, value, eOCPP_MEASURAND_CURRENT_IMPORT, phase, eOCPP_UNIT_A);
+
+			snprintf(value, sizeof(value), "%f", 230.0f + (i % 5) * 0.5f);
+			add_sample(meter_value.sampled_value, value, eOCPP_MEASURAND_VOLTAGE, phase + (eOCPP_PHASE_L1_N - eOCPP_PHASE_L1), eOCPP_UNIT_V);
+		}
+
+		add_sample(meter_value.sampled_value, "32.000000", eOCPP_MEASURAND_CURRENT_OFFERED, 0, eOCPP_UNIT_A);
+
+		snprintf(value, sizeof(value), "%d", 1000000 + (int)i * 183);
+		add_sample(meter_value.sampled_value, value, eOCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER, 0, eOCPP_UNIT_WH);
+		add_sample(meter_value.sampled_value, "183", eOCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_INTERVAL, 0, eOCPP_UNIT_WH);
+
+		snprintf(value, sizeof(value), "%.2f", 11040.0f + i);
+		add_sample(meter_value.sampled_value, value, eOCPP_MEASURAND_POWER_ACTIVE_IMPORT, 0, eOCPP_UNIT_W);
+
+		snprintf(value, sizeof(value), "%.1f", 24.5f + (i % 3));
+		add_sample(meter_value.sampled_value, value, eOCPP_MEASURAND_TEMPERATURE, 0, eOCPP_UNIT_CELSIUS);
+
+		TEST_ASSERT_NOT_NULL(ocpp_meter_list_add(list, meter_value));
+		ocpp_sampled_list_delete(meter_value.sampled_value);
+	}
+
+	return list;
+}
+
+static void assert_meter_list_equal(struct ocpp_meter_value_list * expected, struct ocpp_meter_value_list * actual){
+	TEST_ASSERT_EQUAL_INT(ocpp_meter_list_get_length(expected), ocpp_meter_list_get_length(actual));
+
+	while(expected != NULL && actual != NULL){
+		TEST_ASSERT_EQUAL_INT64(expected->value->timestamp, actual->value->timestamp);
+
+		struct ocpp_sampled_value_list * expected_sample = expected->value->sampled_value;
+		struct ocpp_sampled_value_list * actual_sample = actual->value->sampled_value;
+
+		TEST_ASSERT_EQUAL_INT(ocpp_sampled_list_get_length(expected_sample), ocpp_sampled_list_get_length(actual_sample));
+
+		while(expected_sample != NULL && actual_sample != NULL){
+			TEST_ASSERT_EQUAL_STRING(expected_sample->value->value, actual_sample->value->value);
+			TEST_ASSERT_EQUAL_UINT8(expected_sample->value->context, actual_sample->value->context);
+			TEST_ASSERT_EQUAL_UINT8(expected_sample->value->format, actual_sample->value->format);
+			TEST_ASSERT_EQUAL_UINT8(expected_sample->value->measurand, actual_sample->value->measurand);
+			TEST_ASSERT_EQUAL_UINT8(expected_sample->value->phase, actual_sample->value->phase);
+			TEST_ASSERT_EQUAL_UINT8(expected_sample->value->location, actual_sample->value->location);
+			TEST_ASSERT_EQUAL_UINT8(expected_sample->value->unit, actual_sample->value->unit);
+
+			expected_sample = expected_sample->next;
+			actual_sample = actual_sample->next;
+		}
+
+		expected = expected->next;
+		actual = actual->next;
+	}
+}
+
+static void test_round_trip(enum ocpp_meter_buffer_version version, bool is_stop_txn_data){
+	struct ocpp_meter_value_list * list = create_full_meter_list(10, 1700000000, 60);
+
+	size_t length;
+	unsigned char * buffer = ocpp_meter_list_to_contiguous_buffer_version(list, is_stop_txn_data, version, &length);
+	TEST_ASSERT_NOT_NULL(buffer);
+
+	bool is_stop_out = !is_stop_txn_data;
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_is_stop_txn_data_from_contiguous_buffer(buffer, length, &is_stop_out));
+	TEST_ASSERT_EQUAL(is_stop_txn_data, is_stop_out);
+
+	is_stop_out = !is_stop_txn_data;
+	struct ocpp_meter_value_list * result = ocpp_meter_list_from_contiguous_buffer(buffer, length, &is_stop_out);
+	TEST_ASSERT_NOT_NULL(result);
+	TEST_ASSERT_EQUAL(is_stop_txn_data, is_stop_out);
+
+	assert_meter_list_equal(list, result);
+
+	ocpp_meter_list_delete(result);
+	ocpp_meter_list_delete(list);
+	free(buffer);
+}
+
+TEST_CASE("Test meter value v1 round trip", "[ocpp]") {
+	test_round_trip(eOCPP_METER_BUFFER_V1, false);
+	test_round_trip(eOCPP_METER_BUFFER_V1, true);
+}
+
+TEST_CASE("Test meter value v2 round trip", "[ocpp]") {
+	test_round_trip(eOCPP_METER_BUFFER_V2, false);
+	test_round_trip(eOCPP_METER_BUFFER_V2, true);
+}
+
+TEST_CASE("Test meter value v2 non numeric values", "[ocpp]") {
+	const char * values[] = {"0", "-0", "-0.5", "0.50", "007", "1e3", "12.", ".5", "+1", "-", "", "230.500000",
+		"123456789012345678", "1234567890123456789", "9.999999999999999999", "AB01CD02EF",
+		"012345678901234567890123456789012345678901234567890123456789012"};
+
+	struct ocpp_meter_value meter_value = {
+		.timestamp = 0,
+		.sampled_value = ocpp_create_sampled_list(),
+	};
+	TEST_ASSERT_NOT_NULL(meter_value.sampled_value);
+
+	for(size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+		add_sample(meter_value.sampled_value, values[i], eOCPP_MEASURAND_SOC, 0, eOCPP_UNIT_PERCENT);
+
+	struct ocpp_meter_value_list * list = ocpp_create_meter_list();
+	TEST_ASSERT_NOT_NULL(list);
+	TEST_ASSERT_NOT_NULL(ocpp_meter_list_add(list, meter_value));
+	ocpp_sampled_list_delete(meter_value.sampled_value);
+
+	size_t length;
+	unsigned char * buffer = ocpp_meter_list_to_contiguous_buffer_version(list, false, eOCPP_METER_BUFFER_V2, &length);
+	TEST_ASSERT_NOT_NULL(buffer);
+
+	bool is_stop_txn_data;
+	struct ocpp_meter_value_list * result = ocpp_meter_list_from_contiguous_buffer(buffer, length, &is_stop_txn_data);
+	TEST_ASSERT_NOT_NULL(result);
+
+	assert_meter_list_equal(list, result);
+
+	ocpp_meter_list_delete(result);
+	ocpp_meter_list_delete(list);
+	free(buffer);
+}
+
+TEST_CASE("Test meter value v2 rejects truncated buffer", "[ocpp]") {
+	struct ocpp_meter_value_list * list = create_full_meter_list(2, 1700000000, 60);
+
+	size_t length;
+	unsigned char * buffer = ocpp_meter_list_to_contiguous_buffer_version(list, false, eOCPP_METER_BUFFER_V2, &length);
+	TEST_ASSERT_NOT_NULL(buffer);
+
+	bool is_stop_txn_data;
+	for(size_t i = 1; i < length; i++){
+		struct ocpp_meter_value_list * result = ocpp_meter_list_from_contiguous_buffer(buffer, i, &is_stop_txn_data);
+
+		// A buffer may only be valid if truncated at the end of a meter value
+		if(result != NULL)
+			TEST_ASSERT(ocpp_meter_list_get_length(result) < 2);
+
+		ocpp_meter_list_delete(result);
+	}
+
+	ocpp_meter_list_delete(list);
+	free(buffer);
+}
+
+TEST_CASE("Test meter value storage size", "[ocpp]") {
+	const size_t meter_value_count = 60;
+	struct ocpp_meter_value_list * list = create_full_meter_list(meter_value_count, 1700000000, 60);
+
+	size_t sample_count = 0;
+	for(struct ocpp_meter_value_list * item = list; item != NULL; item = item->next)
+		sample_count += ocpp_sampled_list_get_length(item->value->sampled_value);
+
+	size_t length[2];
+	int64_t encode_time[2];
+	int64_t decode_time[2];
+
+	for(enum ocpp_meter_buffer_version version = eOCPP_METER_BUFFER_V1; version <= eOCPP_METER_BUFFER_V2; version++){
+		int64_t start = esp_timer_get_time();
+		unsigned char * buffer = ocpp_meter_list_to_contiguous_buffer_version(list, false, version, &length[version -1]);
+		encode_time[version -1] = esp_timer_get_time() - start;
+		TEST_ASSERT_NOT_NULL(buffer);
+
+		bool is_stop_txn_data;
+		start = esp_timer_get_time();
+		struct ocpp_meter_value_list * result = ocpp_meter_list_from_contiguous_buffer(buffer, length[version -1], &is_stop_txn_data);
+		decode_time[version -1] = esp_timer_get_time() - start;
+		TEST_ASSERT_NOT_NULL(result);
+
+		assert_meter_list_equal(list, result);
+
+		ocpp_meter_list_delete(result);
+		free(buffer);
+
+		ESP_LOGI(TAG, "v%d: %zu bytes for %zu samples (%.2f bytes per sample). Encode %lld us, decode %lld us",
+			version, length[version -1], sample_count, (float)length[version -1] / sample_count,
+			encode_time[version -1], decode_time[version -1]);
+	}
+
+	TEST_ASSERT_LESS_THAN(length[0], length[1]);
+
+	ocpp_meter_list_delete(list);
+}
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+#include "esp_log.h"
+#include "cJSON.h"
+
+#include "ocpp_rtt.h"
+
+static const char *TAG = "OCPPTEST";
+
+#define TEST_MIN_TIMEOUT_MS 3000
+#define TEST_MAX_TIMEOUT_MS 30000
+
+/* Deterministic pseudo random sequence so that the tests do not depend on esp_random */
+static uint32_t test_random_state = 1;
+
+static uint32_t test_random(void){
+	test_random_state = test_random_state * 1103515245 + 12345;
+	return (test_random_state >> 16) & 0x7fff;
+}
+
+TEST_CASE("Test Rtt estimate follows constant round trip time", "[ocpp]") {
+	struct ocpp_rtt_stats stats;
+	ocpp_rtt_reset(&stats);
+
+	TEST_ASSERT_FALSE(ocpp_rtt_is_usable(&stats));
+	TEST_ASSERT_EQUAL_UINT32(0, ocpp_rtt_percentile(&stats, 50));
+	TEST_ASSERT_EQUAL_UINT32(TEST_MAX_TIMEOUT_MS, ocpp_rtt_timeout(&stats, TEST_MIN_TIMEOUT_MS, TEST_MAX_TIMEOUT_MS));
+
+	for(size_t i = 0; i < 50; i++)
+		ocpp_rtt_add_sample(&stats, 120);
+
+	TEST_ASSERT_TRUE(ocpp_rtt_is_usable(&stats));
+	TEST_ASSERT_EQUAL_UINT32(120, ocpp_rtt_smoothed(&stats));
+	TEST_ASSERT_EQUAL_UINT32(120, stats.min_ms);
+	TEST_ASSERT_EQUAL_UINT32(120, stats.max_ms);
+	TEST_ASSERT_EQUAL_UINT32(120, ocpp_rtt_percentile(&stats, 99));
+	TEST_ASSERT_LESS_OR_EQUAL_UINT32(2, stats.rttvar_x4 >> 2);
+
+	// Low and stable round trip time gives the lower bound
+	TEST_ASSERT_EQUAL_UINT32(TEST_MIN_TIMEOUT_MS, ocpp_rtt_timeout(&stats, TEST_MIN_TIMEOUT_MS, TEST_MAX_TIMEOUT_MS));
+	TEST_ASSERT_UINT32_WITHIN(10, 120, ocpp_rtt_timeout(&stats, 0, TEST_MAX_TIMEOUT_MS));
+}
+
+TEST_CASE("Test Rtt timeout covers tail of varying round trip time", "[ocpp]") {
+	struct ocpp_rtt_stats stats;
+	ocpp_rtt_reset(&stats);
+
+	test_random_state = 1;
+
+	/* LTE like distribution: mostly 200 to 600 ms with one in twenty samples around 4 seconds */
+	size_t slow_count = 0;
+	for(size_t i = 0; i < 200; i++){
+		uint32_t rtt = 200 + test_random() % 400;
+		if(i % 20 == 19){
+			rtt = 3500 + test_random() % 1000;
+			slow_count++;
+		}
+
+		ocpp_rtt_add_sample(&stats, rtt);
+	}
+
+	TEST_ASSERT_EQUAL(10, slow_count);
+	TEST_ASSERT_LESS_OR_EQUAL_UINT32(600, ocpp_rtt_percentile(&stats, 50));
+	TEST_ASSERT_GREATER_OR_EQUAL_UINT32(3500, ocpp_rtt_percentile(&stats, 99));
+
+	uint32_t timeout = ocpp_rtt_timeout(&stats, TEST_MIN_TIMEOUT_MS, TEST_MAX_TIMEOUT_MS);
+	ESP_LOGI(TAG, "srtt %" PRIu32 " ms, p99 %" PRIu32 " ms, timeout %" PRIu32 " ms",
+		ocpp_rtt_smoothed(&stats), ocpp_rtt_percentile(&stats, 99), timeout);
+
+	TEST_ASSERT_GREATER_OR_EQUAL_UINT32(stats.max_ms, timeout);
+	TEST_ASSERT_LESS_THAN_UINT32(TEST_MAX_TIMEOUT_MS, timeout);
+}
+
+TEST_CASE("Test Rtt timeout backs off on consecutive timeouts", "[ocpp]") {
+	struct ocpp_rtt_stats stats;
+	ocpp_rtt_reset(&stats);
+
+	for(size_t i = 0; i < 10; i++)
+		ocpp_rtt_add_sample(&stats, 2000);
+
+	// SRTT + 4 * RTTVAR
+	uint32_t estimate = ocpp_rtt_smoothed(&stats) + stats.rttvar_x4;
+	TEST_ASSERT_GREATER_THAN_UINT32(2000, estimate);
+	TEST_ASSERT_LESS_THAN_UINT32(TEST_MIN_TIMEOUT_MS, estimate);
+
+	TEST_ASSERT_EQUAL_UINT32(TEST_MIN_TIMEOUT_MS, ocpp_rtt_timeout(&stats, TEST_MIN_TIMEOUT_MS, TEST_MAX_TIMEOUT_MS));
+
+	ocpp_rtt_add_timeout(&stats);
+	TEST_ASSERT_EQUAL_UINT32(estimate * 2, ocpp_rtt_timeout(&stats, TEST_MIN_TIMEOUT_MS, TEST_MAX_TIMEOUT_MS));
+
+	ocpp_rtt_add_timeout(&stats);
+	TEST_ASSERT_EQUAL_UINT32(estimate * 4, ocpp_rtt_timeout(&stats, TEST_MIN_TIMEOUT_MS, TEST_MAX_TIMEOUT_MS));
+
+	for(size_t i = 0; i < 10; i++)
+		ocpp_rtt_add_timeout(&stats);
+
+	TEST_ASSERT_EQUAL_UINT8(OCPP_RTT_MAX_BACKOFF, stats.backoff);
+	TEST_ASSERT_EQUAL_UINT32(12, stats.timeout_count);
+	TEST_ASSERT_EQUAL_UINT32(TEST_MAX_TIMEOUT_MS, ocpp_rtt_timeout(&stats, TEST_MIN_TIMEOUT_MS, TEST_MAX_TIMEOUT_MS));
+
+	// A response ends the back off
+	ocpp_rtt_add_sample(&stats, 2000);
+	TEST_ASSERT_EQUAL_UINT8(0, stats.backoff);
+	TEST_ASSERT_EQUAL_UINT32(TEST_MIN_TIMEOUT_MS, ocpp_rtt_timeout(&stats, TEST_MIN_TIMEOUT_MS, TEST_MAX_TIMEOUT_MS));
+}
+
+TEST_CASE("Test Rtt histogram decays to follow changed connection", "[ocpp]") {
+	struct ocpp_rtt_stats stats;
+	ocpp_rtt_reset(&stats);
+
+	for(size_t i = 0; i < OCPP_RTT_HISTOGRAM_DECAY_COUNT * 4; i++)
+		ocpp_rtt_add_sample(&stats, 5000);
+
+	TEST_ASSERT_LESS_OR_EQUAL_UINT16(OCPP_RTT_HISTOGRAM_DECAY_COUNT, stats.histogram_count);
+	TEST_ASSERT_EQUAL_UINT32(5000, ocpp_rtt_percentile(&stats, 50));
+
+	for(size_t i = 0; i < OCPP_RTT_HISTOGRAM_DECAY_COUNT * 4; i++)
+		ocpp_rtt_add_sample(&stats, 80);
+
+	// Percentiles are given as the upper limit of the bucket
+	TEST_ASSERT_EQUAL_UINT32(100, ocpp_rtt_percentile(&stats, 90));
+	TEST_ASSERT_EQUAL_UINT32(80, ocpp_rtt_smoothed(&stats));
+	TEST_ASSERT_EQUAL_UINT32(80, stats.min_ms);
+	TEST_ASSERT_EQUAL_UINT32(5000, stats.max_ms);
+
+	uint32_t sum = 0;
+	for(size_t i = 0; i < OCPP_RTT_HISTOGRAM_BUCKETS; i++)
+		sum += stats.histogram[i];
+
+	TEST_ASSERT_EQUAL_UINT32(stats.histogram_count, sum);
+}
+
+TEST_CASE("Test Rtt buckets and diagnostics", "[ocpp]") {
+	for(size_t i = 1; i < OCPP_RTT_HISTOGRAM_BUCKETS; i++)
+		TEST_ASSERT_GREATER_THAN_UINT32(ocpp_rtt_bucket_limit(i -1), ocpp_rtt_bucket_limit(i));
+
+	TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, ocpp_rtt_bucket_limit(OCPP_RTT_HISTOGRAM_BUCKETS -1));
+
+	struct ocpp_rtt_stats stats;
+	ocpp_rtt_reset(&stats);
+
+	ocpp_rtt_add_sample(&stats, 10);
+	ocpp_rtt_add_sample(&stats, 30);
+	ocpp_rtt_add_sample(&stats, 60000);
+	ocpp_rtt_add_timeout(&stats);
+
+	TEST_ASSERT_EQUAL_UINT16(1, stats.histogram[0]);
+	TEST_ASSERT_EQUAL_UINT16(1, stats.histogram[1]);
+	TEST_ASSERT_EQUAL_UINT16(1, stats.histogram[OCPP_RTT_HISTOGRAM_BUCKETS -1]);
+
+	cJSON * json = ocpp_rtt_to_json(&stats);
+	TEST_ASSERT_NOT_NULL(json);
+
+	TEST_ASSERT_EQUAL_INT(3, cJSON_GetObjectItem(json, "samples")->valueint);
+	TEST_ASSERT_EQUAL_INT(1, cJSON_GetObjectItem(json, "timeouts")->valueint);
+	TEST_ASSERT_EQUAL_INT(10, cJSON_GetObjectItem(json, "min")->valueint);
+	TEST_ASSERT_EQUAL_INT(60000, cJSON_GetObjectItem(json, "max")->valueint);
+	TEST_ASSERT_EQUAL_INT(OCPP_RTT_HISTOGRAM_BUCKETS, cJSON_GetArraySize(cJSON_GetObjectItem(json, "histogram")));
+
+	cJSON_Delete(json);
+}
@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "ocpp_sampling_plan.h"
+
+static const char *TAG = "OCPPTEST";
+
+#define TEST_FULL_CSL "Current.Import,Current.Offered,Energy.Active.Import.Register,Energy.Active.Import.Interval,"\
+	"Power.Active.Import,Temperature,Voltage"
+
+#define TEST_MAX_VALUES 32
+
+static void create_snapshot(struct ocpp_sample_snapshot * snapshot, bool interval_available){
+	for(size_t i = 0; i < eOCPP_SAMPLE_SOURCE_COUNT; i++)
+		snapshot->value[i] = 10.0f * i + 0.25f;
+
+	if(!interval_available)
+		snapshot->value[eOCPP_SAMPLE_SOURCE_ENERGY_INTERVAL] = NAN;
+
+	snapshot->timestamp = 1700000000;
+	snapshot->interval_timestamp = 1699999990;
+}
+
+/*
+ * Reference that parses the list and selects values on each sample the way meter values were created before sampling
+ * plans. Used to check that plans create the same values and to compare the time spent.
+ */
+static size_t reference_allocations = 0;
+
+static size_t reference_add_phases(const char * phase, enum ocpp_measurand_id measurand, enum ocpp_location_id location,
+				enum ocpp_unit_id unit, const float * readings, enum ocpp_reading_context_id context,
+				struct ocpp_sampled_value * values_out){
+
+	const char * phases[] = {OCPP_PHASE_L1, OCPP_PHASE_L2, OCPP_PHASE_L3};
+	size_t count = 0;
+
+	for(size_t i = 0; i < 3; i++){
+		if(phase == NULL || strcmp(phase, phases[i]) == 0){
+			struct ocpp_sampled_value new_value = {
+				.context = context,
+				.format = eOCPP_FORMAT_RAW,
+				.measurand = measurand,
+				.phase = eOCPP_PHASE_L1 + i,
+				.location = location,
+				.unit = unit
+			};
+			sprintf(new_value.value, "%.1f", readings[i]);
+			values_out[count++] = new_value;
+		}
+	}
+
+	return count;
+}
+
+static size_t reference_sample(const char * measurand_csl, unsigned int connector_id, bool single_phase,
+			const struct ocpp_sample_snapshot * snapshot, enum ocpp_reading_context_id context,
+			struct ocpp_sampled_value * values_out){
+
+	char * measurands = strdup(measurand_csl);
+	TEST_ASSERT_NOT_NULL(measurands);
+	reference_allocations++;
+
+	size_t count = 0;
+	char * item = strtok(measurands, ",");
+	while(item != NULL){
+		char * phase = rindex(item, '.');
+		if(phase != NULL && (strcasecmp(phase + 1, OCPP_PHASE_L1) == 0 || strcasecmp(phase + 1, OCPP_PHASE_L2) == 0
+					|| strcasecmp(phase + 1, OCPP_PHASE_L3) == 0)){
+			*phase = '\0';
+			phase++;
+		}else{
+			phase = NULL;
+		}
+
+		enum ocpp_measurand_id measurand = ocpp_measurand_to_id(item);
+		if(phase == NULL && measurand != eOCPP_MEASURAND_TEMPERATURE && single_phase)
+			phase = OCPP_PHASE_L1;
+
+		struct ocpp_sampled_value new_value = {
+			.context = context,
+			.format = eOCPP_FORMAT_RAW,
+			.measurand = measurand,
+		};
+
+		switch(measurand){
+		case eOCPP_MEASURAND_CURRENT_IMPORT:
+			count += reference_add_phases(phase, measurand, eOCPP_LOCATION_OUTLET, eOCPP_UNIT_A,
+						&snapshot->value[eOCPP_SAMPLE_SOURCE_CURRENT_L1], context, &values_out[count]);
+			break;
+		case eOCPP_MEASURAND_CURRENT_OFFERED:
+			new_value.unit = eOCPP_UNIT_A;
+			sprintf(new_value.value, "%.1f", snapshot->value[eOCPP_SAMPLE_SOURCE_CURRENT_OFFERED]);
+			values_out[count++] = new_value;
+			break;
+		case eOCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER:
+			new_value.unit = eOCPP_UNIT_WH;
+			sprintf(new_value.value, "%.0f", snapshot->value[eOCPP_SAMPLE_SOURCE_ENERGY_REGISTER]);
+			values_out[count++] = new_value;
+			break;
+		case eOCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_INTERVAL:
+			if(!isnan(snapshot->value[eOCPP_SAMPLE_SOURCE_ENERGY_INTERVAL])){
+				new_value.unit = eOCPP_UNIT_KWH;
+				sprintf(new_value.value, "%.2f", snapshot->value[eOCPP_SAMPLE_SOURCE_ENERGY_INTERVAL]);
+				values_out[count++] = new_value;
+			}
+			break;
+		case eOCPP_MEASURAND_POWER_ACTIVE_IMPORT:
+			new_value.location = eOCPP_LOCATION_OUTLET;
+			new_value.unit = eOCPP_UNIT_W;
+			sprintf(new_value.value, "%.1f", snapshot->value[eOCPP_SAMPLE_SOURCE_POWER]);
+			values_out[count++] = new_value;
+			break;
+		case eOCPP_MEASURAND_TEMPERATURE:
+			if(connector_id == 0 && phase == NULL){
+				new_value.location = eOCPP_LOCATION_BODY;
+				new_value.unit = eOCPP_UNIT_CELSIUS;
+				sprintf(new_value.value, "%.1f", snapshot->value[eOCPP_SAMPLE_SOURCE_TEMPERATURE_BODY_1]);
+				values_out[count++] = new_value;
+				sprintf(new_value.value, "%.1f", snapshot->value[eOCPP_SAMPLE_SOURCE_TEMPERATURE_BODY_2]);
+				values_out[count++] = new_value;
+
+			}else if(connector_id == 1){
+				if(phase == NULL && single_phase)
+					phase = OCPP_PHASE_L1;
+
+				count += reference_add_phases(phase, measurand, eOCPP_LOCATION_OUTLET, eOCPP_UNIT_CELSIUS,
+							&snapshot->value[eOCPP_SAMPLE_SOURCE_TEMPERATURE_L1], context, &values_out[count]);
+			}
+			break;
+		case eOCPP_MEASURAND_VOLTAGE:
+			count += reference_add_phases(phase, measurand, eOCPP_LOCATION_OUTLET, eOCPP_UNIT_V,
+						&snapshot->value[eOCPP_SAMPLE_SOURCE_VOLTAGE_L1], context, &values_out[count]);
+			break;
+		default:
+			break;
+		}
+
+		item = strtok(NULL, ",");
+	}
+
+	free(measurands);
+	return count;
+}
+
+static size_t plan_sample(const struct ocpp_sampling_plan * plan, const struct ocpp_sample_snapshot * snapshot,
+			enum ocpp_reading_context_id context, struct ocpp_sampled_value * values_out){
+	size_t count = 0;
+	for(size_t i = 0; i < plan->group_count; i++)
+		count += ocpp_sampling_plan_sample_group(plan, i, snapshot, context, &values_out[count]);
+
+	return count;
+}
+
+static void assert_values_equal(const struct ocpp_sampled_value * expected, const struct ocpp_sampled_value * actual, size_t count){
+	for(size_t i = 0; i < count; i++){
+		TEST_ASSERT_EQUAL_STRING(expected[i].value, actual[i].value);
+		TEST_ASSERT_EQUAL_INT(expected[i].context, actual[i].context);
+		TEST_ASSERT_EQUAL_INT(expected[i].format, actual[i].format);
+		TEST_ASSERT_EQUAL_INT(expected[i].measurand, actual[i].measurand);
+		TEST_ASSERT_EQUAL_INT(expected[i].phase, actual[i].phase);
+		TEST_ASSERT_EQUAL_INT(expected[i].location, actual[i].location);
+		TEST_ASSERT_EQUAL_INT(expected[i].unit, actual[i].unit);
+	}
+}
+
+TEST_CASE("Test sampling plan groups and phases", "[ocpp]") {
+	struct ocpp_sampling_plan plan;
+
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_sampling_plan_compile(&plan, TEST_FULL_CSL, 1, false));
+	TEST_ASSERT_EQUAL_INT(7, plan.group_count);
+	TEST_ASSERT_EQUAL_INT(13, plan.item_count);
+	TEST_ASSERT_EQUAL_HEX32((1u << eOCPP_SAMPLE_SOURCE_COUNT) - 1 - (1u << eOCPP_SAMPLE_SOURCE_TEMPERATURE_BODY_1)
+				- (1u << eOCPP_SAMPLE_SOURCE_TEMPERATURE_BODY_2), plan.source_mask);
+	TEST_ASSERT_TRUE(plan.groups[3].interval);
+	TEST_ASSERT_FALSE(plan.groups[0].interval);
+
+	// Only L1 is sampled on single phase grids unless another phase is requested
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_sampling_plan_compile(&plan, "Current.Import,Voltage.L2,Temperature", 1, true));
+	TEST_ASSERT_EQUAL_INT(3, plan.group_count);
+	TEST_ASSERT_EQUAL_INT(3, plan.item_count);
+	TEST_ASSERT_EQUAL_INT(eOCPP_PHASE_L1, plan.items[0].phase);
+	TEST_ASSERT_EQUAL_INT(eOCPP_PHASE_L2, plan.items[1].phase);
+	TEST_ASSERT_EQUAL_INT(eOCPP_SAMPLE_SOURCE_VOLTAGE_L2, plan.items[1].source);
+	TEST_ASSERT_EQUAL_INT(eOCPP_PHASE_L2, plan.groups[1].phase);
+	TEST_ASSERT_EQUAL_INT(eOCPP_SAMPLE_SOURCE_TEMPERATURE_L1, plan.items[2].source);
+
+	// Connector 0 reports the body temperature, and unsupported or unknown measurands create no groups
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_sampling_plan_compile(&plan, "Temperature,Temperature.L1,SoC,Unknown,,Power.Active.Import", 0, false));
+	TEST_ASSERT_EQUAL_INT(2, plan.group_count);
+	TEST_ASSERT_EQUAL_INT(3, plan.item_count);
+	TEST_ASSERT_EQUAL_INT(eOCPP_LOCATION_BODY, plan.items[0].location);
+	TEST_ASSERT_EQUAL_INT(0, plan.items[0].phase);
+	TEST_ASSERT_EQUAL_INT(eOCPP_MEASURAND_POWER_ACTIVE_IMPORT, plan.groups[1].measurand);
+
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_sampling_plan_compile(&plan, "", 1, false));
+	TEST_ASSERT_EQUAL_INT(0, plan.group_count);
+
+	TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_SIZE, ocpp_sampling_plan_compile(&plan,
+			"Voltage,Voltage,Voltage,Voltage,Voltage,Voltage,Voltage,Voltage,Voltage,Voltage,Voltage", 1, false));
+	TEST_ASSERT_EQUAL_INT(OCPP_SAMPLING_PLAN_MAX_GROUPS, plan.group_count);
+}
+
+TEST_CASE("Test sampling plan creates the same values as parsing the list", "[ocpp]") {
+	const char * lists[] = {
+		TEST_FULL_CSL,
+		"Current.Import.L1,Current.Import.L3,Voltage.L2,Temperature.L3",
+		"Energy.Active.Import.Interval,Energy.Active.Import.Register",
+		"Temperature,SoC,Frequency,Current.Offered",
+	};
+
+	struct ocpp_sample_snapshot snapshot;
+	struct ocpp_sampling_plan plan;
+	struct ocpp_sampled_value expected[TEST_MAX_VALUES];
+	struct ocpp_sampled_value actual[TEST_MAX_VALUES];
+
+	for(size_t list = 0; list < sizeof(lists) / sizeof(lists[0]); list++){
+		for(unsigned int connector_id = 0; connector_id <= 1; connector_id++){
+			for(int single_phase = 0; single_phase <= 1; single_phase++){
+				for(int interval_available = 0; interval_available <= 1; interval_available++){
+					create_snapshot(&snapshot, interval_available);
+
+					size_t expected_count = reference_sample(lists[list], connector_id, single_phase, &snapshot,
+										eOCPP_CONTEXT_SAMPLE_PERIODIC, expected);
+
+					TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_sampling_plan_compile(&plan, lists[list], connector_id, single_phase));
+					size_t actual_count = plan_sample(&plan, &snapshot, eOCPP_CONTEXT_SAMPLE_PERIODIC, actual);
+
+					TEST_ASSERT_EQUAL_INT(expected_count, actual_count);
+					assert_values_equal(expected, actual, actual_count);
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE("Test sampling plan skips unavailable readings", "[ocpp]") {
+	struct ocpp_sample_snapshot snapshot;
+	struct ocpp_sampling_plan plan;
+	struct ocpp_sampled_value values[OCPP_SAMPLING_PLAN_MAX_GROUP_ITEMS];
+
+	create_snapshot(&snapshot, false);
+	snapshot.value[eOCPP_SAMPLE_SOURCE_VOLTAGE_L2] = NAN;
+
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_sampling_plan_compile(&plan, "Energy.Active.Import.Interval,Voltage", 1, false));
+	TEST_ASSERT_EQUAL_INT(2, plan.group_count);
+
+	TEST_ASSERT_EQUAL_INT(0, ocpp_sampling_plan_sample_group(&plan, 0, &snapshot, eOCPP_CONTEXT_TRIGGER, values));
+	TEST_ASSERT_EQUAL_INT(2, ocpp_sampling_plan_sample_group(&plan, 1, &snapshot, eOCPP_CONTEXT_TRIGGER, values));
+	TEST_ASSERT_EQUAL_INT(eOCPP_PHASE_L1, values[0].phase);
+	TEST_ASSERT_EQUAL_INT(eOCPP_PHASE_L3, values[1].phase);
+	TEST_ASSERT_EQUAL_INT(eOCPP_CONTEXT_TRIGGER, values[1].context);
+	TEST_ASSERT_EQUAL_STRING("140.2", values[1].value);
+
+	TEST_ASSERT_EQUAL_INT(0, ocpp_sampling_plan_sample_group(&plan, 2, &snapshot, eOCPP_CONTEXT_TRIGGER, values));
+}
+
+TEST_CASE("Test sampling plan time and allocations per sample", "[ocpp]") {
+	const size_t repetitions = 500;
+
+	struct ocpp_sample_snapshot snapshot;
+	struct ocpp_sampling_plan plan;
+	struct ocpp_sampled_value values[TEST_MAX_VALUES];
+
+	create_snapshot(&snapshot, true);
+
+	reference_allocations = 0;
+	size_t value_count = 0;
+	int64_t start = esp_timer_get_time();
+	for(size_t i = 0; i < repetitions; i++)
+		value_count = reference_sample(TEST_FULL_CSL, 1, false, &snapshot, eOCPP_CONTEXT_SAMPLE_PERIODIC, values);
+	int64_t reference_time = esp_timer_get_time() - start;
+
+	start = esp_timer_get_time();
+	TEST_ASSERT_EQUAL_INT(ESP_OK, ocpp_sampling_plan_compile(&plan, TEST_FULL_CSL, 1, false));
+	int64_t compile_time = esp_timer_get_time() - start;
+
+	start = esp_timer_get_time();
+	for(size_t i = 0; i < repetitions; i++)
+		TEST_ASSERT_EQUAL_INT(value_count, plan_sample(&plan, &snapshot, eOCPP_CONTEXT_SAMPLE_PERIODIC, values));
+	int64_t plan_time = esp_timer_get_time() - start;
+
+	ESP_LOGI(TAG, "%zu values per sample: parsing list %lld us with %zu allocations, plan %lld us without allocations (compiled once in %lld us)",
+		value_count, reference_time / (int64_t)repetitions, reference_allocations / repetitions,
+		plan_time / (int64_t)repetitions, compile_time);
+
+	TEST_ASSERT_EQUAL_INT(13, value_count);
+	TEST_ASSERT_LESS_THAN(reference_time, plan_time);
+}
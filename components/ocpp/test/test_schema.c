@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+#include "cJSON.h"
+
+#include "ocpp_json/ocppj_schema.h"
+#include "ocpp_json/ocppj_schema_types.h"
+#include "types/ocpp_charging_profile.h"
+
+#define TEST_MAX_STACK_LEVEL 8
+#define TEST_MAX_PERIODS 4
+
+static const char * set_charging_profile_request = "{"
+	"\"connectorId\":1,"
+	"\"csChargingProfiles\":{"
+		"\"chargingProfileId\":12,"
+		"\"stackLevel\":2,"
+		"\"chargingProfilePurpose\":\"TxDefaultProfile\","
+		"\"chargingProfileKind\":\"Absolute\","
+		"\"validTo\":\"2030-01-01T00:00:00Z\","
+		"\"chargingSchedule\":{"
+			"\"duration\":3600,"
+			"\"startSchedule\":\"2023-06-01T12:00:00Z\","
+			"\"chargingRateUnit\":\"A\","
+			"\"chargingSchedulePeriod\":["
+				"{\"startPeriod\":0,\"limit\":16.0},"
+				"{\"startPeriod\":600,\"limit\":10.5,\"numberPhases\":1},"
+				"{\"startPeriod\":1800,\"limit\":32}"
+			"]"
+		"}"
+	"},"
+	"\"vendorExtension\":true"
+"}";
+
+static enum ocppj_err_t read_text(const struct ocppj_schema_object * schema, const char * text, void * value_out){
+	char err_str[128];
+
+	cJSON * payload = cJSON_Parse(text);
+	TEST_ASSERT_NOT_NULL(payload);
+
+	enum ocppj_err_t err = ocppj_schema_read(schema, payload, value_out, err_str, sizeof(err_str));
+
+	cJSON_Delete(payload);
+	return err;
+}
+
+TEST_CASE("Test Schema reads nested payload in a single pass", "[ocpp]") {
+	char err_str[128];
+
+	cJSON * payload = cJSON_Parse(set_charging_profile_request);
+	TEST_ASSERT_NOT_NULL(payload);
+
+	struct ocppj_set_charging_profile_req request;
+	TEST_ASSERT_EQUAL(eOCPPJ_NO_ERROR, ocppj_schema_read(&ocppj_set_charging_profile_req_schema, payload, &request,
+								err_str, sizeof(err_str)));
+
+	TEST_ASSERT_EQUAL_INT(1, request.connector_id);
+
+	const struct ocppj_charging_profile * profile = &request.cs_charging_profiles;
+	TEST_ASSERT_EQUAL_INT(12, profile->charging_profile_id);
+	TEST_ASSERT_EQUAL_INT(2, profile->stack_level);
+	TEST_ASSERT_EQUAL_STRING("TxDefaultProfile", profile->charging_profile_purpose);
+	TEST_ASSERT_TRUE(profile->present & OCPPJ_CHARGING_PROFILE_HAS_VALID_TO);
+	TEST_ASSERT_FALSE(profile->present & OCPPJ_CHARGING_PROFILE_HAS_VALID_FROM);
+	TEST_ASSERT_FALSE(profile->present & OCPPJ_CHARGING_PROFILE_HAS_TRANSACTION_ID);
+	TEST_ASSERT_EQUAL_INT(1893456000, (int)profile->valid_to);
+
+	const struct ocppj_charging_schedule * schedule = &profile->charging_schedule;
+	TEST_ASSERT_EQUAL_INT(3600, schedule->duration);
+	TEST_ASSERT_EQUAL_INT(1685620800, (int)schedule->start_schedule);
+	TEST_ASSERT_EQUAL_STRING("A", schedule->charging_rate_unit);
+	TEST_ASSERT_FALSE(schedule->present & OCPPJ_CHARGING_SCHEDULE_HAS_MIN_CHARGING_RATE);
+
+	TEST_ASSERT_EQUAL(3, schedule->charging_schedule_period_count);
+	TEST_ASSERT_EQUAL_INT(600, schedule->charging_schedule_period[1].start_period);
+	TEST_ASSERT_EQUAL_FLOAT(10.5, schedule->charging_schedule_period[1].limit);
+	TEST_ASSERT_EQUAL_INT(1, schedule->charging_schedule_period[1].number_phases);
+	TEST_ASSERT_FALSE(schedule->charging_schedule_period[2].present & OCPPJ_CHARGING_SCHEDULE_PERIOD_HAS_NUMBER_PHASES);
+
+	ocppj_schema_free(&ocppj_set_charging_profile_req_schema, &request);
+	TEST_ASSERT_NULL(request.cs_charging_profiles.charging_schedule.charging_schedule_period);
+
+	cJSON_Delete(payload);
+}
+
+TEST_CASE("Test Schema rejects payloads that do not conform", "[ocpp]") {
+	struct ocppj_set_charging_profile_req set_request;
+	struct ocppj_remote_start_transaction_req start_request;
+	struct ocppj_clear_charging_profile_req clear_request;
+
+	TEST_ASSERT_EQUAL(eOCPPJ_ERROR_FORMATION_VIOLATION,
+			read_text(&ocppj_remote_start_transaction_req_schema, "{\"connectorId\":1}", &start_request));
+
+	TEST_ASSERT_EQUAL(eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION,
+			read_text(&ocppj_remote_start_transaction_req_schema, "{\"idTag\":\"123456789012345678901\"}", &start_request));
+
+	TEST_ASSERT_EQUAL(eOCPPJ_NO_ERROR,
+			read_text(&ocppj_remote_start_transaction_req_schema, "{\"idTag\":\"12345678901234567890\"}", &start_request));
+
+	TEST_ASSERT_EQUAL(eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION,
+			read_text(&ocppj_clear_charging_profile_req_schema, "{\"connectorId\":1.5}", &clear_request));
+
+	TEST_ASSERT_EQUAL(eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION,
+			read_text(&ocppj_clear_charging_profile_req_schema, "{\"connectorId\":\"1\"}", &clear_request));
+
+	TEST_ASSERT_EQUAL(eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION,
+			read_text(&ocppj_clear_charging_profile_req_schema, "{\"chargingProfilePurpose\":\"txprofile\"}", &clear_request));
+
+	TEST_ASSERT_EQUAL(eOCPPJ_ERROR_OCCURENCE_CONSTRAINT_VIOLATION,
+			read_text(&ocppj_clear_charging_profile_req_schema, "{\"id\":1,\"id\":2}", &clear_request));
+
+	TEST_ASSERT_EQUAL(eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION,
+			read_text(&ocppj_clear_charging_profile_req_schema, "[]", &clear_request));
+
+	TEST_ASSERT_EQUAL(eOCPPJ_NO_ERROR,
+			read_text(&ocppj_clear_charging_profile_req_schema, "{}", &clear_request));
+	TEST_ASSERT_EQUAL_UINT32(0, clear_request.present);
+
+	// Errors after the periods have been allocated must not leak
+	char * text = strdup(set_charging_profile_request);
+	TEST_ASSERT_NOT_NULL(text);
+
+	char * limit = strstr(text, "10.5");
+	TEST_ASSERT_NOT_NULL(limit);
+	memcpy(limit, "1.05", 4);
+
+	TEST_ASSERT_EQUAL(eOCPPJ_ERROR_PROPERTY_CONSTRAINT_VIOLATION,
+			read_text(&ocppj_set_charging_profile_req_schema, text, &set_request));
+	TEST_ASSERT_NULL(set_request.cs_charging_profiles.charging_schedule.charging_schedule_period);
+
+	free(text);
+}
+
+TEST_CASE("Test Schema writes struct as JSON text", "[ocpp]") {
+	struct ocppj_charging_schedule_period periods[] = {
+		{.start_period = 0, .limit = 16.0, .number_phases = 3, .present = OCPPJ_CHARGING_SCHEDULE_PERIOD_HAS_NUMBER_PHASES},
+		{.start_period = 60, .limit = 10.1f},
+	};
+
+	struct ocppj_get_composite_schedule_conf confirmation = {
+		.present = OCPPJ_GET_COMPOSITE_SCHEDULE_CONF_HAS_CONNECTOR_ID | OCPPJ_GET_COMPOSITE_SCHEDULE_CONF_HAS_CHARGING_SCHEDULE,
+		.status = "Accepted",
+		.connector_id = 1,
+		.schedule_start = 0, // Not written as the bit is not set
+		.charging_schedule = {
+			.present = OCPPJ_CHARGING_SCHEDULE_HAS_DURATION,
+			.duration = 120,
+			.charging_rate_unit = "A",
+			.charging_schedule_period_count = 2,
+			.charging_schedule_period = periods,
+		},
+	};
+
+	const char * expected = "{\"status\":\"Accepted\",\"connectorId\":1,\"chargingSchedule\":{\"duration\":120,"
+		"\"chargingRateUnit\":\"A\",\"chargingSchedulePeriod\":[{\"startPeriod\":0,\"limit\":16.0,\"numberPhases\":3},"
+		"{\"startPeriod\":60,\"limit\":10.1}]}}";
+
+	char buffer[256];
+	int length = ocppj_schema_write(&ocppj_get_composite_schedule_conf_schema, &confirmation, buffer, sizeof(buffer));
+	TEST_ASSERT_EQUAL_INT(strlen(expected), length);
+	TEST_ASSERT_EQUAL_STRING(expected, buffer);
+
+	// Truncated like snprintf
+	char small_buffer[8];
+	TEST_ASSERT_EQUAL_INT(strlen(expected), ocppj_schema_write(&ocppj_get_composite_schedule_conf_schema, &confirmation,
+									small_buffer, sizeof(small_buffer)));
+	TEST_ASSERT_EQUAL_STRING("{\"statu", small_buffer);
+
+	char * message;
+	size_t message_length;
+	TEST_ASSERT_EQUAL(ESP_OK, ocppj_schema_create_call_result_text("id\"1", &ocppj_get_composite_schedule_conf_schema,
+										&confirmation, &message, &message_length));
+
+	TEST_ASSERT_EQUAL(strlen(message), message_length);
+	TEST_ASSERT_EQUAL_STRING_LEN("[3,\"id\\\"1\",{\"status\"", message, 20);
+
+	cJSON * parsed = cJSON_Parse(message);
+	TEST_ASSERT_NOT_NULL(parsed);
+	TEST_ASSERT_EQUAL_STRING("id\"1", cJSON_GetArrayItem(parsed, 1)->valuestring);
+
+	struct ocppj_get_composite_schedule_conf read_back;
+	char err_str[128];
+	TEST_ASSERT_EQUAL(eOCPPJ_NO_ERROR, ocppj_schema_read(&ocppj_get_composite_schedule_conf_schema, cJSON_GetArrayItem(parsed, 2),
+								&read_back, err_str, sizeof(err_str)));
+
+	TEST_ASSERT_EQUAL_UINT32(confirmation.present | OCPPJ_GET_COMPOSITE_SCHEDULE_CONF_HAS_STATUS, read_back.present);
+	TEST_ASSERT_EQUAL(2, read_back.charging_schedule.charging_schedule_period_count);
+	TEST_ASSERT_EQUAL_FLOAT(10.1, read_back.charging_schedule.charging_schedule_period[1].limit);
+
+	ocppj_schema_free(&ocppj_get_composite_schedule_conf_schema, &read_back);
+	cJSON_Delete(parsed);
+	free(message);
+
+	cJSON * json = ocppj_schema_to_json(&ocppj_get_composite_schedule_conf_schema, &confirmation);
+	TEST_ASSERT_NOT_NULL(json);
+	TEST_ASSERT_EQUAL_INT(2, cJSON_GetArraySize(cJSON_GetObjectItem(cJSON_GetObjectItem(json, "chargingSchedule"), "chargingSchedulePeriod")));
+	cJSON_Delete(json);
+
+	// Values that do not conform to the schema are not written
+	confirmation.status = "Maybe";
+	TEST_ASSERT_EQUAL_INT(-1, ocppj_schema_write(&ocppj_get_composite_schedule_conf_schema, &confirmation, buffer, sizeof(buffer)));
+	TEST_ASSERT_NULL(ocppj_schema_to_json(&ocppj_get_composite_schedule_conf_schema, &confirmation));
+
+	confirmation.status = "Accepted";
+	confirmation.charging_schedule.charging_rate_unit = NULL;
+	TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, ocppj_schema_create_call_result_text("1", &ocppj_get_composite_schedule_conf_schema,
+										&confirmation, &message, &message_length));
+}
+
+TEST_CASE("Test Charging profile from schema checks dependent fields", "[ocpp]") {
+	char err_str[128];
+	struct ocpp_charging_profile profile = {0};
+
+	cJSON * payload = cJSON_Parse(set_charging_profile_request);
+	TEST_ASSERT_NOT_NULL(payload);
+
+	cJSON * profile_json = cJSON_GetObjectItem(payload, "csChargingProfiles");
+
+	TEST_ASSERT_EQUAL(eOCPPJ_NO_ERROR, ocpp_charging_profile_from_json(profile_json, TEST_MAX_STACK_LEVEL, "A", TEST_MAX_PERIODS,
+										&profile, err_str, sizeof(err_str)));
+
+	TEST_ASSERT_EQUAL(eOCPP_CHARGING_PROFILE_PURPOSE_TX_DEFAULT, profile.profile_purpose);
+	TEST_ASSERT_EQUAL(eOCPP_CHARGING_RATE_A, profile.charging_schedule.charge_rate_unit);
+	TEST_ASSERT_EQUAL_INT(3600, *profile.charging_schedule.duration);
+	TEST_ASSERT_EQUAL_FLOAT(6.0f, profile.charging_schedule.min_charging_rate);
+	TEST_ASSERT_EQUAL_INT(3, profile.charging_schedule.schedule_period.value.number_phases);
+	TEST_ASSERT_NOT_NULL(profile.charging_schedule.schedule_period.next);
+	TEST_ASSERT_EQUAL_INT(1, profile.charging_schedule.schedule_period.next->value.number_phases);
+	TEST_ASSERT_EQUAL_INT(1893456000, (int)profile.valid_to);
+
+	ocpp_free_charging_schedule(&profile.charging_schedule, false);
+	memset(&profile, 0, sizeof(profile));
+
+	// Watt is valid but not allowed
+	TEST_ASSERT_EQUAL(eOCPPJ_ERROR_NOT_SUPPORTED, ocpp_charging_profile_from_json(profile_json, TEST_MAX_STACK_LEVEL, "W", TEST_MAX_PERIODS,
+											&profile, err_str, sizeof(err_str)));
+	ocpp_free_charging_schedule(&profile.charging_schedule, false);
+	memset(&profile, 0, sizeof(profile));
+
+	TEST_ASSERT_EQUAL(eOCPPJ_ERROR_PROPERTY_CONSTRAINT_VIOLATION, ocpp_charging_profile_from_json(profile_json, TEST_MAX_STACK_LEVEL, "A", 2,
+													&profile, err_str, sizeof(err_str)));
+	ocpp_free_charging_schedule(&profile.charging_schedule, false);
+	memset(&profile, 0, sizeof(profile));
+
+	// transactionId is only allowed for TxProfile
+	cJSON_AddNumberToObject(profile_json, "transactionId", 5);
+	TEST_ASSERT_EQUAL(eOCPPJ_ERROR_FORMATION_VIOLATION, ocpp_charging_profile_from_json(profile_json, TEST_MAX_STACK_LEVEL, "A", TEST_MAX_PERIODS,
+												&profile, err_str, sizeof(err_str)));
+	ocpp_free_charging_schedule(&profile.charging_schedule, false);
+	memset(&profile, 0, sizeof(profile));
+
+	cJSON_DeleteItemFromObject(profile_json, "transactionId");
+
+	// Relative profiles can not have a start schedule
+	cJSON_ReplaceItemInObject(profile_json, "chargingProfileKind", cJSON_CreateString("Relative"));
+	TEST_ASSERT_EQUAL(eOCPPJ_ERROR_FORMATION_VIOLATION, ocpp_charging_profile_from_json(profile_json, TEST_MAX_STACK_LEVEL, "A", TEST_MAX_PERIODS,
+												&profile, err_str, sizeof(err_str)));
+	ocpp_free_charging_schedule(&profile.charging_schedule, false);
+	memset(&profile, 0, sizeof(profile));
+
+	cJSON * null_profile = cJSON_CreateNull();
+	TEST_ASSERT_EQUAL(eOCPPJ_ERROR_FORMATION_VIOLATION, ocpp_charging_profile_from_json(null_profile, TEST_MAX_STACK_LEVEL, "A", TEST_MAX_PERIODS,
+												&profile, err_str, sizeof(err_str)));
+
+	cJSON_Delete(null_profile);
+	cJSON_Delete(payload);
+}
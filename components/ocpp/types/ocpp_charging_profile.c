@@ -10,7 +10,7 @@
 #include "types/ocpp_date_time.h"
 #include "types/ocpp_enum.h"
 #include "types/ocpp_csl.h"
-#include "ocpp_json/ocppj_validation.h"
+#include "ocpp_json/ocppj_schema_types.h"
 
 static const char * TAG = "OCPP CHARGING";
 
@@ -35,38 +35,22 @@ struct ocpp_charging_schedule_period_list * ocpp_extend_period_list(struct ocpp_
 	return period_list;
 }
 
-enum ocppj_err_t charging_schedule_period_from_json(cJSON * chargingSchedulePeriod, struct ocpp_charging_schedule_period * period_out,
-						char * error_description_out, size_t error_description_length){
-
-	enum ocppj_err_t ocppj_error = ocppj_get_int_field(chargingSchedulePeriod, "startPeriod", true, &period_out->start_period,
-							error_description_out, error_description_length);
-
-	if(ocppj_error != eOCPPJ_NO_ERROR)
-		return ocppj_error;
-
-	double limit;
-	ocppj_error = ocppj_get_decimal_field(chargingSchedulePeriod, "limit", true, &limit,
-					error_description_out, error_description_length);
-
-	if(ocppj_error != eOCPPJ_NO_ERROR)
-		return ocppj_error;
+static enum ocppj_err_t charging_schedule_period_from_schema(const struct ocppj_charging_schedule_period * period,
+							struct ocpp_charging_schedule_period * period_out,
+							char * error_description_out, size_t error_description_length){
 
-	if(limit < 0 || limit > 80){
+	if(period->limit < 0 || period->limit > 80){
 		snprintf(error_description_out, error_description_length, "'limit' out of range. IEC 61851-1 Expects 0-80");
 		return eOCPPJ_ERROR_PROPERTY_CONSTRAINT_VIOLATION;
 	}
 
-	period_out->limit = (float)limit;
+	period_out->start_period = period->start_period;
+	period_out->limit = (float)period->limit;
 
-	ocppj_error = ocppj_get_int_field(chargingSchedulePeriod, "numberPhases", false, &period_out->number_phases,
-					error_description_out, error_description_length);
-
-	if(ocppj_error == eOCPPJ_NO_VALUE){
+	if(period->present & OCPPJ_CHARGING_SCHEDULE_PERIOD_HAS_NUMBER_PHASES){
+		period_out->number_phases = period->number_phases;
+	}else{
 		period_out->number_phases = 3; //"numberPhases=3 will be assumed unless another number is given."
-
-	}else if(ocppj_error != eOCPPJ_NO_ERROR){
-		return ocppj_error;
-
 	}
 
 	if(period_out->number_phases != 1 && period_out->number_phases != 3){
@@ -77,55 +61,39 @@ enum ocppj_err_t charging_schedule_period_from_json(cJSON * chargingSchedulePeri
 	return eOCPPJ_NO_ERROR;
 }
 
-enum ocppj_err_t charging_schedule_from_json(cJSON * chargingSchedule, const char * allowed_charging_rate_units,
-					int max_periods, enum ocpp_charging_profile_kind profile_kind,
-					struct ocpp_charging_schedule * charging_schedule_out,
-					char * error_description_out, size_t error_description_length){
-
-	int duration;
-	enum ocppj_err_t ocppj_error = ocppj_get_int_field(chargingSchedule, "duration", false, &duration,
-							error_description_out, error_description_length);
+static enum ocppj_err_t charging_schedule_from_schema(const struct ocppj_charging_schedule * schedule, const char * allowed_charging_rate_units,
+						int max_periods, enum ocpp_charging_profile_kind profile_kind,
+						struct ocpp_charging_schedule * charging_schedule_out,
+						char * error_description_out, size_t error_description_length){
 
-	if(ocppj_error == eOCPPJ_NO_ERROR){
+	if(schedule->present & OCPPJ_CHARGING_SCHEDULE_HAS_DURATION){
 		charging_schedule_out->duration = malloc(sizeof(int));
 		if(charging_schedule_out->duration == NULL){
 			snprintf(error_description_out, error_description_length, "Unable to allocate memory for duration");
 			return eOCPPJ_ERROR_INTERNAL;
 		}
 
-		*charging_schedule_out->duration = duration;
-
-	}else if(ocppj_error != eOCPPJ_NO_VALUE){
-		return ocppj_error;
+		*charging_schedule_out->duration = schedule->duration;
 	}
 
-	char * value_str;
+	bool has_start_schedule = schedule->present & OCPPJ_CHARGING_SCHEDULE_HAS_START_SCHEDULE;
+
 	switch(profile_kind){
 	case eOCPP_CHARGING_PROFILE_KIND_ABSOLUTE:
 	case eOCPP_CHARGING_PROFILE_KIND_RECURRING: // TODO: check if startSchedule should be optional for recurring.
-		ocppj_error = ocppj_get_string_field(chargingSchedule, "startSchedule", true, &value_str,
-						error_description_out, error_description_length);
+		if(!has_start_schedule){
+			snprintf(error_description_out, error_description_length, "Expected 'startSchedule' field");
+			return eOCPPJ_ERROR_FORMATION_VIOLATION;
+		}
 		break;
 	case eOCPP_CHARGING_PROFILE_KIND_RELATIVE:
-		if(cJSON_HasObjectItem(chargingSchedule, "startSchedule")){
+		if(has_start_schedule){
 			snprintf(error_description_out, error_description_length, "Unexpected 'startSchedule' for Relative charge profile");
 			return eOCPPJ_ERROR_FORMATION_VIOLATION;
-		}else{
-			ocppj_error = eOCPPJ_NO_VALUE;
 		}
 	}
 
-	if(ocppj_error != eOCPPJ_NO_ERROR && ocppj_error != eOCPPJ_NO_VALUE)
-		return ocppj_error;
-
-	if(ocppj_error == eOCPPJ_NO_ERROR){
-		time_t start_schedule = ocpp_parse_date_time(value_str);
-
-		if(start_schedule == (time_t)-1){
-			snprintf(error_description_out, error_description_length, "'startSchedule' Unrecognised dateTime format");
-			return eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
-		}
-
+	if(has_start_schedule){
 		charging_schedule_out->start_schedule = malloc(sizeof(time_t));
 		if(charging_schedule_out->start_schedule == NULL)
 		{
@@ -133,119 +101,62 @@ enum ocppj_err_t charging_schedule_from_json(cJSON * chargingSchedule, const cha
 			return eOCPPJ_ERROR_INTERNAL;
 		}
 
-		*charging_schedule_out->start_schedule = start_schedule;
+		*charging_schedule_out->start_schedule = schedule->start_schedule;
 	}
 
-	ocppj_error = ocppj_get_string_field(chargingSchedule, "chargingRateUnit", true, &value_str,
-					error_description_out, error_description_length);
-
-	if(ocppj_error != eOCPPJ_NO_ERROR)
-		return ocppj_error;
-
-	if(ocpp_validate_enum(value_str, true, 2,
-				OCPP_CHARGING_RATE_W,
-				OCPP_CHARGING_RATE_A) == 0){
-
-		if(ocpp_csl_contains(allowed_charging_rate_units, value_str)){
-
-			charging_schedule_out->charge_rate_unit = ocpp_charging_rate_unit_to_id(value_str);
-		}else{
-			snprintf(error_description_out, error_description_length, "'chargingRateUnit' Is valid but not supported by current firmware");
-			return eOCPPJ_ERROR_NOT_SUPPORTED;
-		}
+	if(ocpp_csl_contains(allowed_charging_rate_units, schedule->charging_rate_unit)){
+		charging_schedule_out->charge_rate_unit = ocpp_charging_rate_unit_to_id(schedule->charging_rate_unit);
 	}else{
-		snprintf(error_description_out, error_description_length, "Expected 'chargingRateUnit' to be ChargingRateUnitType type");
-		return eOCPPJ_ERROR_PROPERTY_CONSTRAINT_VIOLATION;
+		snprintf(error_description_out, error_description_length, "'chargingRateUnit' Is valid but not supported by current firmware");
+		return eOCPPJ_ERROR_NOT_SUPPORTED;
 	}
 
-	if(cJSON_HasObjectItem(chargingSchedule, "chargingSchedulePeriod")){
-
-		cJSON * periods_json = cJSON_GetObjectItem(chargingSchedule, "chargingSchedulePeriod");
-		if(cJSON_IsArray(periods_json)){
-
-			int periods_count = cJSON_GetArraySize(periods_json);
-			if(periods_count > 0 && periods_count <= max_periods){
-
-				struct ocpp_charging_schedule_period_list * entry = &(charging_schedule_out->schedule_period);
-				for(int i = 0; i < periods_count; i++){
-					enum ocppj_err_t result = charging_schedule_period_from_json(cJSON_GetArrayItem(periods_json, i),
-												&entry->value, error_description_out,
-												error_description_length);
-					if(result != eOCPPJ_NO_ERROR)
-						return result;
+	if(schedule->charging_schedule_period_count == 0 || schedule->charging_schedule_period_count > (size_t)max_periods){
+		snprintf(error_description_out, error_description_length, "'chargingSchedulePeriod' Array size out of range");
+		return eOCPPJ_ERROR_PROPERTY_CONSTRAINT_VIOLATION;
+	}
 
-					if(i+1 < periods_count){
-						entry->next = malloc(sizeof(struct ocpp_charging_schedule_period_list));
-						if(entry->next == NULL){
-							snprintf(error_description_out, error_description_length, "Unable to allocate memory for period");
-							return eOCPPJ_ERROR_INTERNAL;
-						}
+	struct ocpp_charging_schedule_period_list * entry = &(charging_schedule_out->schedule_period);
+	for(size_t i = 0; i < schedule->charging_schedule_period_count; i++){
+		enum ocppj_err_t result = charging_schedule_period_from_schema(&schedule->charging_schedule_period[i], &entry->value,
+									error_description_out, error_description_length);
+		if(result != eOCPPJ_NO_ERROR)
+			return result;
 
-						entry = entry->next;
-						entry->next = NULL;
-					}
-				}
-			}else{
-				snprintf(error_description_out, error_description_length, "'chargingSchedulePeriod' Array size out of range");
-				return eOCPPJ_ERROR_PROPERTY_CONSTRAINT_VIOLATION;
+		if(i+1 < schedule->charging_schedule_period_count){
+			entry->next = malloc(sizeof(struct ocpp_charging_schedule_period_list));
+			if(entry->next == NULL){
+				snprintf(error_description_out, error_description_length, "Unable to allocate memory for period");
+				return eOCPPJ_ERROR_INTERNAL;
 			}
-		}else{
-			snprintf(error_description_out, error_description_length, "Expected 'chargingSchedulePeriod' to be array type");
-			return eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
+
+			entry = entry->next;
+			entry->next = NULL;
 		}
-	}else{
-		snprintf(error_description_out, error_description_length, "Expected 'chargingSchedulePeriod' field");
-		return eOCPPJ_ERROR_FORMATION_VIOLATION;
 	}
 
-	double minimum;
-	ocppj_error = ocppj_get_decimal_field(chargingSchedule, "minChargingRate", false, &minimum,
-					error_description_out, error_description_length);
-	if(ocppj_error == eOCPPJ_NO_ERROR){
-
-		if(minimum < 0 || minimum > 32){
+	if(schedule->present & OCPPJ_CHARGING_SCHEDULE_HAS_MIN_CHARGING_RATE){
+		if(schedule->min_charging_rate < 0 || schedule->min_charging_rate > 32){
 			snprintf(error_description_out, error_description_length, "'minChargingRate' out of range. Expected 0-32");
 			return eOCPPJ_ERROR_PROPERTY_CONSTRAINT_VIOLATION;
 		}
 
-		charging_schedule_out->min_charging_rate = (float)minimum;
-
-	}else if(ocppj_error == eOCPPJ_NO_VALUE){
-		charging_schedule_out->min_charging_rate = 6.0f;
+		charging_schedule_out->min_charging_rate = (float)schedule->min_charging_rate;
 
 	}else{
-		return ocppj_error;
+		charging_schedule_out->min_charging_rate = 6.0f;
 	}
 
 	return eOCPPJ_NO_ERROR;
 }
 
-enum ocppj_err_t ocpp_charging_profile_from_json(cJSON * csChargingProfiles, int max_stack_level, const char * allowed_charging_rate_units,
-				int max_periods, struct ocpp_charging_profile * charging_profile_out,
-				char * error_description_out, size_t error_description_length){
-
-	if(!cJSON_IsObject(csChargingProfiles)){
-			enum ocppj_err_t ret;
-			if(cJSON_IsNull(csChargingProfiles)){
-					snprintf(error_description_out, error_description_length, "Expected 'ChargingProfile' object was missing");
-					ret = eOCPPJ_ERROR_FORMATION_VIOLATION;
-			}else{
-					snprintf(error_description_out, error_description_length, "Expected 'ChargingProfile' object, but had incorrect type");
-					ret = eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
-			}
-			return ret;
-	}
-
-	enum ocppj_err_t ocppj_error = ocppj_get_int_field(csChargingProfiles, "chargingProfileId", true,
-							&charging_profile_out->profile_id,
-							error_description_out, error_description_length);
-	if(ocppj_error != eOCPPJ_NO_ERROR)
-		return ocppj_error;
+enum ocppj_err_t ocpp_charging_profile_from_schema(const struct ocppj_charging_profile * profile, int max_stack_level,
+						const char * allowed_charging_rate_units, int max_periods,
+						struct ocpp_charging_profile * charging_profile_out,
+						char * error_description_out, size_t error_description_length){
 
-	ocppj_error = ocppj_get_int_field(csChargingProfiles, "stackLevel", true, &charging_profile_out->stack_level,
-					error_description_out, error_description_length);
-	if(ocppj_error != eOCPPJ_NO_ERROR)
-		return ocppj_error;
+	charging_profile_out->profile_id = profile->charging_profile_id;
+	charging_profile_out->stack_level = profile->stack_level;
 
 	if(charging_profile_out->stack_level > max_stack_level
 		|| charging_profile_out->stack_level < 0){
@@ -254,133 +165,88 @@ enum ocppj_err_t ocpp_charging_profile_from_json(cJSON * csChargingProfiles, int
 		return eOCPPJ_ERROR_PROPERTY_CONSTRAINT_VIOLATION;
 	}
 
-	char * enum_str;
-	ocppj_error = ocppj_get_string_field(csChargingProfiles, "chargingProfilePurpose", true, &enum_str,
-					error_description_out, error_description_length);
-	if(ocppj_error != eOCPPJ_NO_ERROR)
-		return ocppj_error;
+	charging_profile_out->profile_purpose = ocpp_charging_profile_purpose_to_id(profile->charging_profile_purpose);
 
-	if(ocpp_validate_enum(enum_str, true, 3,
-				OCPP_CHARGING_PROFILE_PURPOSE_CHARGE_POINT_MAX,
-				OCPP_CHARGING_PROFILE_PURPOSE_TX_DEFAULT,
-				OCPP_CHARGING_PROFILE_PURPOSE_TX) == 0){
-
-		charging_profile_out->profile_purpose = ocpp_charging_profile_purpose_to_id(enum_str);
-	}else{
-		snprintf(error_description_out, error_description_length, "Expected 'chargingProfilePurpose' to be ChargingProfilePurposeType");
-		return eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
-	}
-
-	if(charging_profile_out->profile_purpose == eOCPP_CHARGING_PROFILE_PURPOSE_TX){
-		int transaction_id;
-		ocppj_error = ocppj_get_int_field(csChargingProfiles, "transactionId", false, &transaction_id,
-						error_description_out, error_description_length);
+	if(profile->present & OCPPJ_CHARGING_PROFILE_HAS_TRANSACTION_ID){
+		if(charging_profile_out->profile_purpose != eOCPP_CHARGING_PROFILE_PURPOSE_TX){
+			snprintf(error_description_out, error_description_length, "Profile contains transactionId, but chargingProfilePurpose is not 'TxProfile'");
+			return eOCPPJ_ERROR_FORMATION_VIOLATION;
+		}
 
-		if(ocppj_error == eOCPPJ_NO_ERROR){
-			charging_profile_out->transaction_id = malloc(sizeof(int));
-			if(charging_profile_out->transaction_id == NULL){
-				snprintf(error_description_out, error_description_length, "Unable to allocate memory for transactionId");
-				return eOCPPJ_ERROR_INTERNAL;
-			}else{
-				*charging_profile_out->transaction_id = transaction_id;
-			}
-		}else if(ocppj_error != eOCPPJ_NO_VALUE){
-			return ocppj_error;
+		charging_profile_out->transaction_id = malloc(sizeof(int));
+		if(charging_profile_out->transaction_id == NULL){
+			snprintf(error_description_out, error_description_length, "Unable to allocate memory for transactionId");
+			return eOCPPJ_ERROR_INTERNAL;
 		}
 
-	}else if(cJSON_HasObjectItem(csChargingProfiles, "transactionId")){
-		snprintf(error_description_out, error_description_length, "Profile contains transactionId, but chargingProfilePurpose is not 'TxProfile'");
-		return eOCPPJ_ERROR_FORMATION_VIOLATION;
+		*charging_profile_out->transaction_id = profile->transaction_id;
 	}
 
-	ocppj_error = ocppj_get_string_field(csChargingProfiles, "chargingProfileKind", true, &enum_str,
-					error_description_out, error_description_length);
-	if(ocppj_error != eOCPPJ_NO_ERROR){
-		return ocppj_error;
-
-	}else if(ocpp_validate_enum(enum_str, true, 3,
-					OCPP_CHARGING_PROFILE_KIND_ABSOLUTE,
-					OCPP_CHARGING_PROFILE_KIND_RECURRING,
-					OCPP_CHARGING_PROFILE_KIND_RELATIVE) == 0){
-
-		charging_profile_out->profile_kind = ocpp_charging_profile_kind_to_id(enum_str);
-	}else{
-		snprintf(error_description_out, error_description_length, "Expected 'chargingProfileKind' to be ChargingProfileKindType");
-		return eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
-	}
+	charging_profile_out->profile_kind = ocpp_charging_profile_kind_to_id(profile->charging_profile_kind);
 
 	if(charging_profile_out->profile_kind == eOCPP_CHARGING_PROFILE_KIND_RECURRING){
-		ocppj_error = ocppj_get_string_field(csChargingProfiles, "recurrencyKind", true, &enum_str,
-						error_description_out, error_description_length);
-		if(ocppj_error != eOCPPJ_NO_ERROR){
-			return ocppj_error;
-
-		}else if(ocpp_validate_enum(enum_str, true, 2,
-						OCPP_RECURRENCY_KIND_DAILY,
-						OCPP_RECURRENCY_KIND_WEEKLY) == 0){
-
-			charging_profile_out->recurrency_kind = malloc(sizeof(enum ocpp_recurrency_kind));
-			if(charging_profile_out->recurrency_kind == NULL){
-				snprintf(error_description_out, error_description_length, "Unable to allocate memory for 'recurrencyKind'");
-				return eOCPPJ_ERROR_INTERNAL;
-			}
-
-			*charging_profile_out->recurrency_kind = ocpp_recurrency_kind_to_id(enum_str);
-		}else{
-			snprintf(error_description_out, error_description_length, "Expected 'recurrencyKind' to be RecurrencyKindType");
-			return eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
-		}
-	}else{
-		if(cJSON_HasObjectItem(csChargingProfiles, "recurrencyKind")){
-			snprintf(error_description_out, error_description_length, "Profile contains recurrencyKind, but chargingProfileKind is not 'Recurring'");
+		if(!(profile->present & OCPPJ_CHARGING_PROFILE_HAS_RECURRENCY_KIND)){
+			snprintf(error_description_out, error_description_length, "Expected 'recurrencyKind' field");
 			return eOCPPJ_ERROR_FORMATION_VIOLATION;
 		}
-	}
 
-	char * date_time_str;
-	ocppj_error = ocppj_get_string_field(csChargingProfiles, "validFrom", false, &date_time_str,
-					error_description_out, error_description_length);
+		charging_profile_out->recurrency_kind = malloc(sizeof(enum ocpp_recurrency_kind));
+		if(charging_profile_out->recurrency_kind == NULL){
+			snprintf(error_description_out, error_description_length, "Unable to allocate memory for 'recurrencyKind'");
+			return eOCPPJ_ERROR_INTERNAL;
+		}
 
-	if(ocppj_error == eOCPPJ_NO_ERROR){
-		charging_profile_out->valid_from = ocpp_parse_date_time(date_time_str);
-		if(charging_profile_out->valid_from == (time_t) -1){
+		*charging_profile_out->recurrency_kind = ocpp_recurrency_kind_to_id(profile->recurrency_kind);
 
-			snprintf(error_description_out, error_description_length, "'validFrom' is not a recognoised dateTime");
-			return eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
-		}
-	}else if(ocppj_error == eOCPPJ_NO_VALUE){
+	}else if(profile->present & OCPPJ_CHARGING_PROFILE_HAS_RECURRENCY_KIND){
+		snprintf(error_description_out, error_description_length, "Profile contains recurrencyKind, but chargingProfileKind is not 'Recurring'");
+		return eOCPPJ_ERROR_FORMATION_VIOLATION;
+	}
+
+	if(profile->present & OCPPJ_CHARGING_PROFILE_HAS_VALID_FROM){
+		charging_profile_out->valid_from = profile->valid_from;
+	}else{
 		charging_profile_out->valid_from = time(NULL); // "If absent, the profile is valid as soon as it is received"
+	}
 
+	if(profile->present & OCPPJ_CHARGING_PROFILE_HAS_VALID_TO){
+		charging_profile_out->valid_to = profile->valid_to;
 	}else{
-		return ocppj_error;
+		charging_profile_out->valid_to = LONG_MAX;
 	}
 
-	ocppj_error = ocppj_get_string_field(csChargingProfiles, "validTo", false, &date_time_str,
+	return charging_schedule_from_schema(&profile->charging_schedule, allowed_charging_rate_units, max_periods,
+					charging_profile_out->profile_kind, &charging_profile_out->charging_schedule,
 					error_description_out, error_description_length);
-	if(ocppj_error == eOCPPJ_NO_ERROR){
-		charging_profile_out->valid_to = ocpp_parse_date_time(date_time_str);
-		if(charging_profile_out->valid_to == (time_t) -1){
-			snprintf(error_description_out, error_description_length, "'validTo' is not a recognoised dateTime");
-			return eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
-		}
+}
 
+enum ocppj_err_t ocpp_charging_profile_from_json(cJSON * csChargingProfiles, int max_stack_level, const char * allowed_charging_rate_units,
+				int max_periods, struct ocpp_charging_profile * charging_profile_out,
+				char * error_description_out, size_t error_description_length){
 
-	}else if(ocppj_error == eOCPPJ_NO_VALUE){
-		charging_profile_out->valid_to = LONG_MAX;
+	if(!cJSON_IsObject(csChargingProfiles)){
+			enum ocppj_err_t ret;
+			if(cJSON_IsNull(csChargingProfiles)){
+					snprintf(error_description_out, error_description_length, "Expected 'ChargingProfile' object was missing");
+					ret = eOCPPJ_ERROR_FORMATION_VIOLATION;
+			}else{
+					snprintf(error_description_out, error_description_length, "Expected 'ChargingProfile' object, but had incorrect type");
+					ret = eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
+			}
+			return ret;
+	}
 
-	}else{
+	struct ocppj_charging_profile profile;
+	enum ocppj_err_t ocppj_error = ocppj_schema_read(&ocppj_charging_profile_schema, csChargingProfiles, &profile,
+							error_description_out, error_description_length);
+	if(ocppj_error != eOCPPJ_NO_ERROR)
 		return ocppj_error;
-	}
 
-	if(cJSON_HasObjectItem(csChargingProfiles, "chargingSchedule")){
-		return charging_schedule_from_json(cJSON_GetObjectItem(csChargingProfiles, "chargingSchedule"),
-						allowed_charging_rate_units, max_periods, charging_profile_out->profile_kind,
-						&charging_profile_out->charging_schedule,
-						error_description_out, error_description_length);
-	}else{
-		snprintf(error_description_out, error_description_length, "Expected 'chargingSchedule' field");
-		return eOCPPJ_ERROR_FORMATION_VIOLATION;
-	}
+	ocppj_error = ocpp_charging_profile_from_schema(&profile, max_stack_level, allowed_charging_rate_units, max_periods,
+							charging_profile_out, error_description_out, error_description_length);
+
+	ocppj_schema_free(&ocppj_charging_profile_schema, &profile);
+	return ocppj_error;
 }
 
 void ocpp_free_charging_schedule_period_list(struct ocpp_charging_schedule_period_list * periods){
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <float.h>
 #include <ctype.h>
+#include <stdint.h>
 
 #include "cJSON.h"
 
@@ -701,8 +702,263 @@ static size_t ocpp_sample_list_to_contiguous_buffer(struct ocpp_sampled_value_li
 	return offset;
 }
 
+/*
+ * Meter values are stored as contiguous buffers when they can not be sent immediately. Two versions of the buffer exist.
+ * The version is identified by the first byte of the buffer.
+ *
+ * Version 1 starts with the is_stop_txn_data bool (0 or 1), followed by each meter value as a time_t timestamp, its
+ * sampled values and a terminating ';'. Each sampled value is written as a NUL terminated value string followed by
+ * one byte for each of context, format, measurand, phase, location and unit.
+ *
+ * Version 2 starts with METER_BUFFER_V2 with the METER_BUFFER_FLAG_STOP bit set if is_stop_txn_data. It is followed by
+ * a zigzag varint base timestamp and each meter value as a zigzag varint timestamp delta (from previous timestamp or
+ * base) and a varint sampled value count. Each sampled value is written as three meta data bytes followed by the value:
+ *
+ *   meta[0]: bit 0-4 measurand, bit 5-6 format, bit 7 set if value is fixed point
+ *   meta[1]: bit 0-3 context, bit 4-7 phase
+ *   meta[2]: bit 0-2 location, bit 3-7 unit
+ *
+ * A fixed point value is written as a zigzag varint mantissa followed by one byte with the number of decimals. It is
+ * only used if the value string can be recreated exactly from it. Other values are written as a varint length followed
+ * by the characters of the value without NUL.
+ */
 #define MAX_BUFFER_LENGTH 16384
-unsigned char * ocpp_meter_list_to_contiguous_buffer(struct ocpp_meter_value_list * list, bool is_stop_txn_data, size_t * buffer_length_out){
+
+#define METER_BUFFER_V2 0x20
+#define METER_BUFFER_FLAG_STOP 0x01
+
+#define METER_V2_FIXED_POINT 0x80
+#define METER_V2_MAX_DECIMALS 18
+#define METER_V2_MAX_VARINT_LENGTH 10
+
+static size_t write_varint(unsigned char * buffer, uint64_t value){
+	size_t length = 0;
+
+	do{
+		uint8_t byte = value & 0x7f;
+		value >>= 7;
+
+		if(value != 0)
+			byte |= 0x80;
+
+		if(buffer != NULL)
+			buffer[length] = byte;
+
+		length++;
+	}while(value != 0);
+
+	return length;
+}
+
+static bool read_varint(const unsigned char * buffer, size_t buffer_length, size_t * offset, uint64_t * value_out){
+	uint64_t value = 0;
+
+	for(size_t i = 0; i < METER_V2_MAX_VARINT_LENGTH; i++){
+		if(*offset >= buffer_length)
+			return false;
+
+		uint8_t byte = buffer[(*offset)++];
+		value |= (uint64_t)(byte & 0x7f) << (7 * i);
+
+		if((byte & 0x80) == 0){
+			*value_out = value;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static inline uint64_t zigzag_encode(int64_t value){
+	return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t zigzag_decode(uint64_t value){
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static size_t fixed_point_to_string(int64_t mantissa, uint8_t decimals, char * buffer, size_t buffer_size){
+	char digits[METER_V2_MAX_DECIMALS + 4];
+	uint64_t magnitude = (mantissa < 0) ? -(uint64_t)mantissa : (uint64_t)mantissa;
+
+	// Pad with zeros to ensure at least one integer digit
+	int digit_count = snprintf(digits, sizeof(digits), "%0*llu", decimals + 1, (unsigned long long)magnitude);
+	if(digit_count < 0 || digit_count >= sizeof(digits))
+		return 0;
+
+	size_t length = 0;
+	size_t integer_count = digit_count - decimals;
+
+	if(buffer_size < digit_count + 3)
+		return 0;
+
+	if(mantissa < 0)
+		buffer[length++] = '-';
+
+	memcpy(buffer + length, digits, integer_count);
+	length += integer_count;
+
+	if(decimals > 0){
+		buffer[length++] = '.';
+		memcpy(buffer + length, digits + integer_count, decimals);
+		length += decimals;
+	}
+
+	buffer[length] = '\0';
+	return length;
+}
+
+static bool value_to_fixed_point(const char * value, size_t value_size, int64_t * mantissa_out, uint8_t * decimals_out){
+	size_t index = 0;
+	bool negative = false;
+	uint64_t magnitude = 0;
+	size_t digit_count = 0;
+	int decimals = -1;
+
+	if(value[index] == '-'){
+		negative = true;
+		index++;
+	}
+
+	for(; index < value_size && value[index] != '\0'; index++){
+		if(value[index] == '.' && decimals == -1 && digit_count > 0){
+			decimals = 0;
+
+		}else if(isdigit((unsigned char)value[index]) && digit_count < METER_V2_MAX_DECIMALS){
+			magnitude = magnitude * 10 + (value[index] - '0');
+			digit_count++;
+
+			if(decimals != -1)
+				decimals++;
+		}else{
+			return false;
+		}
+	}
+
+	if(digit_count == 0 || decimals == 0 || index >= value_size)
+		return false;
+
+	*mantissa_out = negative ? -(int64_t)magnitude : (int64_t)magnitude;
+	*decimals_out = (decimals == -1) ? 0 : decimals;
+
+	// Only use fixed point if value would be recreated exactly e.g. not for leading zeros or "-0".
+	char recreated[METER_V2_MAX_DECIMALS + 4];
+	if(fixed_point_to_string(*mantissa_out, *decimals_out, recreated, sizeof(recreated)) == 0)
+		return false;
+
+	return strcmp(recreated, value) == 0;
+}
+
+/*
+ * Writes the list to buffer using version 2 encoding and sets length_out to the number of bytes. If buffer is NULL, then
+ * only the required length is set. Returns ESP_ERR_NOT_SUPPORTED if the list contains a sampled value with meta data
+ * that can not be encoded.
+ */
+static esp_err_t meter_list_to_buffer_v2(struct ocpp_meter_value_list * list, bool is_stop_txn_data, unsigned char * buffer, size_t * length_out){
+	size_t offset = 0;
+
+	if(buffer != NULL)
+		buffer[offset] = METER_BUFFER_V2 | (is_stop_txn_data ? METER_BUFFER_FLAG_STOP : 0);
+	offset++;
+
+	time_t previous_timestamp = 0;
+	for(struct ocpp_meter_value_list * item = list; item != NULL; item = item->next){
+		if(item->value != NULL && item->value->sampled_value != NULL){
+			previous_timestamp = item->value->timestamp;
+			break;
+		}
+	}
+
+	offset += write_varint(buffer != NULL ? buffer + offset : NULL, zigzag_encode(previous_timestamp));
+
+	while(list != NULL){
+		if(list->value != NULL && list->value->sampled_value != NULL){
+			offset += write_varint(buffer != NULL ? buffer + offset : NULL,
+					zigzag_encode((int64_t)list->value->timestamp - (int64_t)previous_timestamp));
+			previous_timestamp = list->value->timestamp;
+
+			size_t sample_count = 0;
+			for(struct ocpp_sampled_value_list * sample = list->value->sampled_value; sample != NULL; sample = sample->next){
+				if(sample->value != NULL)
+					sample_count++;
+			}
+
+			offset += write_varint(buffer != NULL ? buffer + offset : NULL, sample_count);
+
+			for(struct ocpp_sampled_value_list * sample = list->value->sampled_value; sample != NULL; sample = sample->next){
+				if(sample->value == NULL)
+					continue;
+
+				struct ocpp_sampled_value * value = sample->value;
+				if(value->measurand > 0x1f || value->format > 0x03 || value->context > 0x0f || value->phase > 0x0f
+					|| value->location > 0x07 || value->unit > 0x1f){
+					ESP_LOGW(TAG, "Sampled value meta data can not be written with compact encoding");
+					return ESP_ERR_NOT_SUPPORTED;
+				}
+
+				int64_t mantissa;
+				uint8_t decimals;
+				bool is_fixed_point = value_to_fixed_point(value->value, sizeof(value->value), &mantissa, &decimals);
+
+				if(buffer != NULL){
+					buffer[offset] = value->measurand | (value->format << 5) | (is_fixed_point ? METER_V2_FIXED_POINT : 0);
+					buffer[offset + 1] = value->context | (value->phase << 4);
+					buffer[offset + 2] = value->location | (value->unit << 3);
+				}
+				offset += 3;
+
+				if(is_fixed_point){
+					offset += write_varint(buffer != NULL ? buffer + offset : NULL, zigzag_encode(mantissa));
+
+					if(buffer != NULL)
+						buffer[offset] = decimals;
+					offset++;
+
+				}else{
+					size_t value_length = strnlen(value->value, sizeof(value->value));
+					offset += write_varint(buffer != NULL ? buffer + offset : NULL, value_length);
+
+					if(buffer != NULL)
+						memcpy(buffer + offset, value->value, value_length);
+					offset += value_length;
+				}
+			}
+		}
+		list = list->next;
+	}
+
+	*length_out = offset;
+	return ESP_OK;
+}
+
+static unsigned char * meter_list_to_contiguous_buffer_v2(struct ocpp_meter_value_list * list, bool is_stop_txn_data, size_t * buffer_length_out){
+	size_t length;
+	if(meter_list_to_buffer_v2(list, is_stop_txn_data, NULL, &length) != ESP_OK)
+		return NULL;
+
+	if(length > MAX_BUFFER_LENGTH){
+		ESP_LOGE(TAG, "Unable to create compact meter list buffer: Too long: %zu bytes", length);
+		return NULL;
+	}
+
+	unsigned char * buffer = malloc(length);
+	if(buffer == NULL){
+		ESP_LOGE(TAG, "Unable to allocate compact buffer");
+		return NULL;
+	}
+
+	size_t written_length;
+	if(meter_list_to_buffer_v2(list, is_stop_txn_data, buffer, &written_length) != ESP_OK || written_length != length){
+		ESP_LOGE(TAG, "Compact meter list buffer length changed during write");
+		free(buffer);
+		return NULL;
+	}
+
+	*buffer_length_out = length;
+	return buffer;
+}
+
+static unsigned char * meter_list_to_contiguous_buffer_v1(struct ocpp_meter_value_list * list, bool is_stop_txn_data, size_t * buffer_length_out){
 	struct ocpp_meter_value_list * list_start  = list;
 	size_t length = 1;
 
@@ -786,7 +1042,146 @@ unsigned char * ocpp_meter_list_to_contiguous_buffer(struct ocpp_meter_value_lis
 	return buffer;
 }
 
-struct ocpp_meter_value_list * ocpp_meter_list_from_contiguous_buffer(const unsigned char * buffer, size_t buffer_length, bool * is_stop_txn_data_out){
+unsigned char * ocpp_meter_list_to_contiguous_buffer_version(struct ocpp_meter_value_list * list, bool is_stop_txn_data,
+							enum ocpp_meter_buffer_version version, size_t * buffer_length_out){
+	if(version == eOCPP_METER_BUFFER_V2){
+		unsigned char * buffer = meter_list_to_contiguous_buffer_v2(list, is_stop_txn_data, buffer_length_out);
+		if(buffer != NULL)
+			return buffer;
+
+		ESP_LOGW(TAG, "Unable to create compact meter list buffer. Attempting version 1");
+	}
+
+	return meter_list_to_contiguous_buffer_v1(list, is_stop_txn_data, buffer_length_out);
+}
+
+unsigned char * ocpp_meter_list_to_contiguous_buffer(struct ocpp_meter_value_list * list, bool is_stop_txn_data, size_t * buffer_length_out){
+#ifdef CONFIG_OCPP_METER_VALUE_COMPACT_STORAGE
+	return ocpp_meter_list_to_contiguous_buffer_version(list, is_stop_txn_data, eOCPP_METER_BUFFER_V2, buffer_length_out);
+#else
+	return ocpp_meter_list_to_contiguous_buffer_version(list, is_stop_txn_data, eOCPP_METER_BUFFER_V1, buffer_length_out);
+#endif
+}
+
+static struct ocpp_meter_value_list * meter_list_from_contiguous_buffer_v2(const unsigned char * buffer, size_t buffer_length, bool * is_stop_txn_data_out){
+
+	struct ocpp_meter_value_list * result = ocpp_create_meter_list();
+	if(result == NULL){
+		ESP_LOGE(TAG, "Unable to create meter_value_list for compact buffer");
+		return NULL;
+	}
+
+	struct ocpp_meter_value * meter_value = NULL;
+	struct ocpp_sampled_value sample = {0};
+
+	size_t offset = 0;
+	*is_stop_txn_data_out = (buffer[offset++] & METER_BUFFER_FLAG_STOP) != 0;
+
+	uint64_t encoded;
+	if(!read_varint(buffer, buffer_length, &offset, &encoded)){
+		ESP_LOGE(TAG, "Unable to read base timestamp from compact buffer");
+		goto error;
+	}
+	int64_t timestamp = zigzag_decode(encoded);
+
+	while(offset < buffer_length){
+		if(!read_varint(buffer, buffer_length, &offset, &encoded)){
+			ESP_LOGE(TAG, "Unable to read timestamp delta from compact buffer");
+			goto error;
+		}
+		timestamp += zigzag_decode(encoded);
+
+		uint64_t sample_count;
+		if(!read_varint(buffer, buffer_length, &offset, &sample_count) || sample_count > buffer_length - offset){
+			ESP_LOGE(TAG, "Unable to read valid sample count from compact buffer");
+			goto error;
+		}
+
+		meter_value = malloc(sizeof(struct ocpp_meter_value));
+		if(meter_value == NULL){
+			ESP_LOGE(TAG, "Unable to create new meter_value for compact buffer");
+			goto error;
+		}
+
+		meter_value->timestamp = timestamp;
+		meter_value->sampled_value = ocpp_create_sampled_list();
+		if(meter_value->sampled_value == NULL){
+			ESP_LOGE(TAG, "Unable to create sampled_value_list for compact buffer");
+			goto error;
+		}
+
+		for(size_t i = 0; i < sample_count; i++){
+			if(buffer_length - offset < 3){
+				ESP_LOGE(TAG, "Compact buffer missing sampled value meta data");
+				goto error;
+			}
+
+			const unsigned char * meta = buffer + offset;
+			offset += 3;
+
+			sample.measurand = meta[0] & 0x1f;
+			sample.format = (meta[0] >> 5) & 0x03;
+			sample.context = meta[1] & 0x0f;
+			sample.phase = meta[1] >> 4;
+			sample.location = meta[2] & 0x07;
+			sample.unit = meta[2] >> 3;
+
+			if(meta[0] & METER_V2_FIXED_POINT){
+				if(!read_varint(buffer, buffer_length, &offset, &encoded) || offset >= buffer_length
+					|| buffer[offset] > METER_V2_MAX_DECIMALS){
+
+					ESP_LOGE(TAG, "Unable to read fixed point value from compact buffer");
+					goto error;
+				}
+
+				if(fixed_point_to_string(zigzag_decode(encoded), buffer[offset++], sample.value, sizeof(sample.value)) == 0){
+					ESP_LOGE(TAG, "Unable to write fixed point value from compact buffer");
+					goto error;
+				}
+			}else{
+				uint64_t value_length;
+				if(!read_varint(buffer, buffer_length, &offset, &value_length) || value_length > buffer_length - offset
+					|| value_length > sizeof(sample.value)){
+
+					ESP_LOGE(TAG, "Unable to read valid value length from compact buffer");
+					goto error;
+				}
+
+				memset(sample.value, '\0', sizeof(sample.value));
+				memcpy(sample.value, buffer + offset, value_length);
+				if(value_length == sizeof(sample.value)){
+					ESP_LOGE(TAG, "No space for NUL character in meter value.");
+					sample.value[sizeof(sample.value)-1] = '\0';
+				}
+				offset += value_length;
+			}
+
+			if(ocpp_sampled_list_add(meter_value->sampled_value, sample) == NULL){
+				ESP_LOGE(TAG, "Unable to add sampled value from compact buffer");
+				goto error;
+			}
+		}
+
+		if(ocpp_meter_list_add_reference(result, meter_value) == NULL){
+			ESP_LOGE(TAG, "Unable to add meter value to meter_value_list");
+			goto error;
+		}
+		meter_value = NULL;
+	}
+
+	return result;
+
+error:
+	ocpp_meter_list_delete(result);
+	if(meter_value != NULL){
+		ocpp_sampled_list_delete(meter_value->sampled_value);
+		free(meter_value);
+	}
+
+	return NULL;
+}
+
+static struct ocpp_meter_value_list * meter_list_from_contiguous_buffer_v1(const unsigned char * buffer, size_t buffer_length, bool * is_stop_txn_data_out){
 
 	struct ocpp_meter_value_list * result = ocpp_create_meter_list();
 	if(result == NULL){
@@ -896,10 +1291,26 @@ error:
 	return NULL;
 }
 
+struct ocpp_meter_value_list * ocpp_meter_list_from_contiguous_buffer(const unsigned char * buffer, size_t buffer_length, bool * is_stop_txn_data_out){
+	if(buffer == NULL || buffer_length < 1)
+		return NULL;
+
+	if((buffer[0] & ~METER_BUFFER_FLAG_STOP) == METER_BUFFER_V2){
+		return meter_list_from_contiguous_buffer_v2(buffer, buffer_length, is_stop_txn_data_out);
+	}else{
+		return meter_list_from_contiguous_buffer_v1(buffer, buffer_length, is_stop_txn_data_out);
+	}
+}
+
 esp_err_t ocpp_is_stop_txn_data_from_contiguous_buffer(const unsigned char * buffer, size_t buffer_length, bool * is_stop_txn_data_out){
 	if(buffer == NULL || buffer_length < sizeof(bool))
 		return ESP_ERR_INVALID_ARG;
 
-	memcpy(is_stop_txn_data_out, buffer, sizeof(bool));
+	if((buffer[0] & ~METER_BUFFER_FLAG_STOP) == METER_BUFFER_V2){
+		*is_stop_txn_data_out = (buffer[0] & METER_BUFFER_FLAG_STOP) != 0;
+	}else{
+		memcpy(is_stop_txn_data_out, buffer, sizeof(bool));
+	}
+
 	return ESP_OK;
 }
@@ -4,8 +4,14 @@
 #include "cJSON.h"
 #include "freertos/event_groups.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
 
 #include "zaptec_cloud_listener.h"
+#include "cloud_method.h"
+#include "cloud_settings.h"
+#include "publish_queue.h"
+#include "payload_compress.h"
 #include "sas_token.h"
 #include "zaptec_cloud_observations.h"
 #include "rfc3986.h"
@@ -124,6 +130,77 @@ int publish_to_iothub(const char* payload, const char* topic){
     return -2;
 }
 
+/*
+ * Flags given with events that are not UTF-8 JSON. They are published to the event topic with another content type or
+ * encoding, so the cloud knows how to decode them.
+ */
+#define EVENT_FLAG_BINARY (1 << 0)
+#define EVENT_FLAG_COMPRESSED (1 << 1)
+#define MQTT_EVENT_CONTENT_JSON "$.ct=application%2Fjson&$.ce=utf-8"
+#define MQTT_EVENT_CONTENT_BINARY "$.ct=application%2Fx-protobuf"
+#define MQTT_EVENT_CONTENT_COMPRESSED "$.ct=application%%2Fjson&$.ce=heatshrink-w%dl%d"
+
+static int publish_event_message(const char * payload, size_t length, uint32_t flags){
+    if(flags == 0){
+        return esp_mqtt_client_publish(mqtt_client, event_topic, payload, length, 1, 0);
+    }
+
+    const char * content = strstr(event_topic, MQTT_EVENT_CONTENT_JSON);
+    if(content == NULL){
+        ESP_LOGE(TAG, "No content type in event topic for flagged event");
+        return -1;
+    }
+
+    char content_type[64] = MQTT_EVENT_CONTENT_BINARY;
+#ifdef CONFIG_ZAPTEC_CLOUD_COMPRESS
+    if(flags & EVENT_FLAG_COMPRESSED){
+        snprintf(content_type, sizeof(content_type), MQTT_EVENT_CONTENT_COMPRESSED,
+                CONFIG_ZAPTEC_CLOUD_COMPRESS_WINDOW, CONFIG_ZAPTEC_CLOUD_COMPRESS_LOOKAHEAD);
+    }
+#endif
+
+    char flagged_topic[sizeof(event_topic) + 32];
+    snprintf(flagged_topic, sizeof(flagged_topic), "%.*s%s%s", (int)(content - event_topic), event_topic,
+            content_type, content + strlen(MQTT_EVENT_CONTENT_JSON));
+
+    return esp_mqtt_client_publish(mqtt_client, flagged_topic, payload, length, 1, 0);
+}
+
+#ifdef CONFIG_ZAPTEC_CLOUD_COMPRESS
+/*
+ * Large JSON events like completed sessions with signed meter values and diagnostics compress to less than half. The
+ * result is only used if it is smaller, so the buffer is the size of the payload.
+ */
+static char * compress_event(const char * payload, size_t length, size_t * length_out){
+    if(length < CONFIG_ZAPTEC_CLOUD_COMPRESS_THRESHOLD){
+        return NULL;
+    }
+
+    char * compressed = malloc(length);
+    if(compressed == NULL){
+        return NULL;
+    }
+
+    esp_err_t err = payload_compress(payload, length, CONFIG_ZAPTEC_CLOUD_COMPRESS_WINDOW,
+                                     CONFIG_ZAPTEC_CLOUD_COMPRESS_LOOKAHEAD, (uint8_t *)compressed, length, length_out);
+    if(err != ESP_OK){
+        if(err != ESP_ERR_INVALID_SIZE){
+            ESP_LOGW(TAG, "Unable to compress event: %s", esp_err_to_name(err));
+        }
+
+        free(compressed);
+        return NULL;
+    }
+
+    ESP_LOGD(TAG, "Compressed event from %zu to %zu bytes", length, *length_out);
+    return compressed;
+}
+#else
+static char * compress_event(const char * payload, size_t length, size_t * length_out){
+    return NULL;
+}
+#endif
+
 EventGroupHandle_t blocked_publish_event_group;
 #define BLOCKED_MESSAGE_PUBLISHED BIT0
 #define BLOCKED_MESSAGE_QUEUED BIT1
@@ -139,10 +216,17 @@ int publish_iothub_event_blocked(const char* payload, TickType_t xTicksToWait){
 		goto mutex_err;
 	}
 
-	int message_id = esp_mqtt_client_publish(
-            mqtt_client, event_topic,
-            payload, 0, 1, 0
-    );
+	size_t length = strlen(payload);
+	uint32_t flags = 0;
+
+	char * compressed = compress_event(payload, length, &length);
+	if(compressed != NULL){
+		payload = compressed;
+		flags = EVENT_FLAG_COMPRESSED;
+	}
+
+	int message_id = publish_event_message(payload, length, flags);
+	free(compressed);
 
 	if(message_id<0){
 		result = -2;
@@ -163,8 +247,176 @@ int publish_iothub_event_blocked(const char* payload, TickType_t xTicksToWait){
 	return result;
 }
 
+/*
+ * Events published with publish_iothub_event_tracked bypass the event queue. Every message the MQTT client acknowledges
+ * or deletes is reported to each added ack queue, and the publishers match the message ids they are waiting for.
+ */
+#define ACK_QUEUE_MAX 2
+
+static QueueHandle_t ack_queues[ACK_QUEUE_MAX];
+static portMUX_TYPE ack_queues_lock = portMUX_INITIALIZER_UNLOCKED;
+
+int publish_iothub_add_ack_queue(QueueHandle_t queue){
+	int result = -1;
+
+	taskENTER_CRITICAL(&ack_queues_lock);
+	for(size_t i = 0; i < ACK_QUEUE_MAX; i++){
+		if(ack_queues[i] == queue){
+			result = 0;
+			break;
+		}
+
+		if(ack_queues[i] == NULL && result != 0){
+			ack_queues[i] = queue;
+			result = 0;
+		}
+	}
+	taskEXIT_CRITICAL(&ack_queues_lock);
+
+	return result;
+}
+
+void publish_iothub_remove_ack_queue(QueueHandle_t queue){
+	taskENTER_CRITICAL(&ack_queues_lock);
+	for(size_t i = 0; i < ACK_QUEUE_MAX; i++){
+		if(ack_queues[i] == queue)
+			ack_queues[i] = NULL;
+	}
+	taskEXIT_CRITICAL(&ack_queues_lock);
+}
+
+static void report_ack(int message_id, bool published){
+	QueueHandle_t queues[ACK_QUEUE_MAX];
+
+	taskENTER_CRITICAL(&ack_queues_lock);
+	memcpy(queues, ack_queues, sizeof(queues));
+	taskEXIT_CRITICAL(&ack_queues_lock);
+
+	struct publish_ack ack = {.message_id = message_id, .published = published};
+
+	for(size_t i = 0; i < ACK_QUEUE_MAX; i++){
+		if(queues[i] != NULL && xQueueSend(queues[i], &ack, 0) != pdTRUE)
+			ESP_LOGW(TAG, "Ack queue full, dropped ack for %d", message_id);
+	}
+}
+
+static int publish_event_tracked(const char * payload, size_t length, uint32_t flags){
+	if(mqtt_client == NULL){
+		return -1;
+	}
+
+	char * compressed = NULL;
+	if((flags & EVENT_FLAG_BINARY) == 0){
+		compressed = compress_event(payload, length, &length);
+		if(compressed != NULL){
+			payload = compressed;
+			flags |= EVENT_FLAG_COMPRESSED;
+		}
+	}
+
+	int message_id = publish_event_message(payload, length, flags);
+	free(compressed);
+
+	if(message_id < 0){
+		ESP_LOGW(TAG, "failed ot add message to mqtt client publish queue");
+		return -2;
+	}
+
+	return message_id;
+}
+
+int publish_iothub_event_tracked(const char* payload){
+	return publish_event_tracked(payload, strlen(payload), 0);
+}
+
+int publish_iothub_binary_event_tracked(const char *payload, size_t length){
+	return publish_event_tracked(payload, length, EVENT_FLAG_BINARY);
+}
+
+/*
+ * Events are queued and handed to the MQTT client a few at a time, so a newer state can replace a queued one while the
+ * link is slow or down. See publish_queue.h.
+ */
+static struct publish_queue * event_queue = NULL;
+
+static int send_queued_event(const char * payload, size_t length, uint32_t flags, void * context){
+    if(mqtt_client == NULL){
+        return -1;
+    }
+
+    return publish_event_message(payload, length, flags);
+}
+
+static void start_event_queue()
+{
+	if(event_queue != NULL)
+		return;
+
+	struct publish_queue_config config = {
+		.max_bytes = CONFIG_ZAPTEC_CLOUD_PUBLISH_QUEUE_SIZE,
+		.max_in_flight = CONFIG_ZAPTEC_CLOUD_PUBLISH_IN_FLIGHT,
+		.overflow = ePUBLISH_QUEUE_DROP_OLDEST,
+		.send = send_queued_event,
+		.context = NULL,
+	};
+
+	event_queue = publish_queue_create(&config);
+	if(event_queue == NULL)
+		ESP_LOGE(TAG, "Unable to create event queue, events will be published directly");
+}
+
+static int queue_iothub_event(int state_key, const char *payload, size_t length, uint32_t flags){
+    if(mqtt_client == NULL){
+        return -1;
+    }
+
+    /* Compressed before queueing, so the queue holds more events while the link is slow */
+    char * compressed = NULL;
+    if((flags & EVENT_FLAG_BINARY) == 0){
+        compressed = compress_event(payload, length, &length);
+        if(compressed != NULL){
+            payload = compressed;
+            flags |= EVENT_FLAG_COMPRESSED;
+        }
+    }
+
+    int result = 0;
+
+    if(event_queue == NULL){
+        if(publish_event_message(payload, length, flags) <= 0){
+            ESP_LOGW(TAG, "failed ot add message to mqtt client publish queue");
+            result = -2;
+        }
+    }else{
+        esp_err_t err = publish_queue_add_message(event_queue, state_key, payload, length, flags);
+        if(err != ESP_OK){
+            ESP_LOGW(TAG, "failed to queue event: %s", esp_err_to_name(err));
+            result = -2;
+        }
+    }
+
+    free(compressed);
+    return result;
+}
+
 int publish_iothub_event(const char *payload){
-    return publish_to_iothub(payload, event_topic);
+    return queue_iothub_event(PUBLISH_QUEUE_EVENT, payload, strlen(payload), 0);
+}
+
+int publish_iothub_state(int state_key, const char *payload){
+    return queue_iothub_event(state_key, payload, strlen(payload), 0);
+}
+
+int publish_iothub_binary_state(int state_key, const char *payload, size_t length){
+    return queue_iothub_event(state_key, payload, length, EVENT_FLAG_BINARY);
+}
+
+struct publish_queue_stats publish_iothub_queue_stats(){
+    if(event_queue == NULL){
+        return (struct publish_queue_stats){0};
+    }
+
+    return publish_queue_get_stats(event_queue);
 }
 
 bool CloudSettingsAreUpdated()
@@ -306,709 +558,758 @@ void on_controller_change(enum session_controller old_controller, enum session_c
 	}
 }
 
-void ParseCloudSettingsFromCloud(char * message, int message_len)
+struct cloud_settings_context
 {
-	if ((message[0] != '{') || (message[message_len-1] != '}'))
-		return;
+	const cJSON ** values;
+	bool controller_change;
+};
 
-	ESP_LOGW(TAG, "message: %.*s", message_len, message);
+static const cJSON * setting_value(struct cloud_settings_context * context, int id);
 
-	ESP_LOGI(TAG, "***** Start parsing of Cloud settings *****\n");
+/* Returns the value string of settings that are sent as strings, or NULL with an error if the value has another type */
+static const char * setting_string(const cJSON * value)
+{
+	if(cJSON_IsString(value))
+		return value->valuestring;
 
-	bool doSave = false;
-	int nrOfParameters = 0;
+	ESP_LOGE(TAG, "Err: %s has incorrect type", value->string);
+	return NULL;
+}
 
-	cJSON *cloudObject = cJSON_Parse(message);//"{\"Version\":1,\"Package\":0,\"PackageCount\":1,\"Type\":0,\"Tokens\":[{\"Tag\":\"ble-f9f25dee-29c9-4eb2-af37-9f8e821ba0d9\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"ble-8b06fc14-aa7c-462d-a5d7-a7c943f2c4e0\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"nfc-5237AB3B\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"nfc-530796E7\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"nfc-034095E7\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"nfc-04C31102F84D80\",\"Action\":0,\"ExpiryDate\":null}]}");
-	cJSON *desiredObject = NULL;
-	cJSON *settings = NULL;
+//Managementmode or session_controller
+static bool setting_session_controller(const cJSON * management_mode_json, struct cloud_settings_context * context)
+{
+	enum session_controller old_session_controller = storage_Get_session_controller();
+	enum session_controller new_session_controller = old_session_controller;
 
-	//The settings in the message may start on two different levels, handle both
-	if(cJSON_HasObjectItem(cloudObject, "desired"))
-	{
-		desiredObject = cJSON_GetObjectItem(cloudObject,"desired");
-		if(cJSON_HasObjectItem(desiredObject, "Settings"))
-			settings = cJSON_GetObjectItem(desiredObject,"Settings");
-	}
-	else if(cJSON_HasObjectItem(cloudObject, "Settings"))
-	{
-		settings = cJSON_GetObjectItem(cloudObject,"Settings");
+	int management_mode = -1;
+
+	if(cJSON_IsString(management_mode_json)){
+		errno = 0;
+		long tmp_mode = strtol(management_mode_json->valuestring, NULL, 10);
+		if(tmp_mode == 0 && errno != 0){
+			ESP_LOGE(TAG, "Unable to convert Management mode string: %s", strerror(errno));
+		}else{
+			if(tmp_mode < 0 || tmp_mode > 3){
+				ESP_LOGE(TAG, "Management mode out of range");
+			}else{
+				management_mode = tmp_mode;
+			}
+		}
+	}else if(cJSON_IsNumber(management_mode_json)){
+		management_mode = cJSON_GetNumberValue(management_mode_json);
+	}else if(cJSON_IsNull(management_mode_json)){
+		management_mode = storage_Get_Standalone() ? 1 : 0;
+		ESP_LOGW(TAG, "Management mode cleared. Interpteting as %d", management_mode);
+	}else{
+		ESP_LOGE(TAG, "Management mode has incorrect type");
 	}
 
-	if(settings != NULL)
-	{
+	switch(management_mode){
+	case 0:
+		new_session_controller = eSESSION_ZAPTEC_CLOUD;
+		break;
+	case 1:
+		new_session_controller = eSESSION_STANDALONE;
+		break;
+	case 2:
+		new_session_controller = eSESSION_OCPP;
+		break;
+	default:
+		ESP_LOGE(TAG, "Invalid management mode: %d", management_mode);
+	}
 
-		enum session_controller old_session_controller = storage_Get_session_controller();
-		bool controller_change = false;
+	if(new_session_controller != old_session_controller){
+		ESP_LOGW(TAG, "New: 860 session controller: %x", new_session_controller);
+		storage_Set_session_controller(new_session_controller);
 
-		//Managementmode or session_controller
-		if(cJSON_HasObjectItem(settings, "860"))
-		{
-			enum session_controller new_session_controller = old_session_controller;
+		context->controller_change = true;
+		return true;
+	}else{
+		ESP_LOGI(TAG, "Old: 860 session controller: %x", old_session_controller);
+		return false;
+	}
+}
 
-			if(cJSON_HasObjectItem(settings, "860")){
-				nrOfParameters++;
+//OcppNativeURL
+static bool setting_ocpp_url(const cJSON * url_json, struct cloud_settings_context * context)
+{
+	if(cJSON_IsNull(url_json)){
+		if(storage_Get_url_ocpp()[0] != '\0'){
+			storage_Set_url_ocpp("");
 
-				cJSON * management_mode_json = cJSON_GetObjectItem(settings, "860");
-				int management_mode = -1;
+			ESP_LOGW(TAG, "New: 861 ocpp url: %s", storage_Get_url_ocpp());
+			context->controller_change = true;
+			return true;
+		}else{
+			ESP_LOGI(TAG, "Old: 861 ocpp url:%s", storage_Get_url_ocpp());
+		}
 
-				if(cJSON_IsString(management_mode_json)){
-					errno = 0;
-					long tmp_mode = strtol(management_mode_json->valuestring, NULL, 10);
-					if(tmp_mode == 0 && errno != 0){
-						ESP_LOGE(TAG, "Unable to convert Management mode string: %s", strerror(errno));
-					}else{
-						if(tmp_mode < 0 || tmp_mode > 3){
-							ESP_LOGE(TAG, "Management mode out of range");
-						}else{
-							management_mode = tmp_mode;
-						}
-					}
-				}else if(cJSON_IsNumber(management_mode_json)){
-					management_mode = cJSON_GetNumberValue(management_mode_json);
-				}else if(cJSON_IsNull(management_mode_json)){
-					management_mode = storage_Get_Standalone() ? 1 : 0;
-					ESP_LOGW(TAG, "Management mode cleared. Interpteting as %d", management_mode);
-				}else{
-					ESP_LOGE(TAG, "Management mode has incorrect type");
-				}
+	}else if(cJSON_IsString(url_json)){
 
-				switch(management_mode){
-				case 0:
-					new_session_controller = eSESSION_ZAPTEC_CLOUD;
-					break;
-				case 1:
-					new_session_controller = eSESSION_STANDALONE;
-					break;
-				case 2:
-					new_session_controller = eSESSION_OCPP;
-					break;
-				default:
-					ESP_LOGE(TAG, "Invalid management mode: %d", management_mode);
-				}
-			}
+		char * url = url_json->valuestring;
+		if(strcmp(storage_Get_url_ocpp(), url) == 0){
+			ESP_LOGI(TAG, "Old: 861 ocpp url: %s", storage_Get_url_ocpp());
+		}else{
+			const unsigned char * uri_end = NULL;
+			if((strncmp(url, "ws://", 5) == 0 || strncmp(url, "wss://", 6) == 0)
+				&& strlen(url) <= CONFIG_OCPP_URL_MAX_LENGTH
+				&& rfc3986_is_valid_uri((unsigned char *)url, &uri_end)
+				&& *uri_end == '\0'){
 
-			if(new_session_controller != old_session_controller || cJSON_HasObjectItem(settings, "860")){
-				if(new_session_controller != old_session_controller){
-					ESP_LOGW(TAG, "New: 860 session controller: %x", new_session_controller);
-					storage_Set_session_controller(new_session_controller);
-					doSave = true;
+				ESP_LOGW(TAG, "New: 861 ocpp url: %s", url);
+				storage_Set_url_ocpp(url);
 
-					controller_change = true;
-				}else{
-					ESP_LOGI(TAG, "Old: 860 session controller: %x", old_session_controller);
-				}
+				context->controller_change = true;
+				return true;
+			}else{
+				ESP_LOGW(TAG, "Recieved invalid url '%s' for ocpp", url);
+				ESP_LOGI(TAG, "Err: 861 ocpp url: %s", storage_Get_url_ocpp());
 			}
 		}
+	}
 
-		//OcppNativeURL
-		if(cJSON_HasObjectItem(settings, "861"))
-		{
-			nrOfParameters++;
-
-			cJSON * url_json = cJSON_GetObjectItem(settings, "861");
+	return false;
+}
 
-			if(cJSON_IsNull(url_json)){
-				if(storage_Get_url_ocpp()[0] != '\0'){
-					storage_Set_url_ocpp("");
-					doSave = true;
+//OcppNativeCBID
+static bool setting_ocpp_cbid(const cJSON * cbid_json, struct cloud_settings_context * context)
+{
+	bool doSave = false;
 
-					ESP_LOGW(TAG, "New: 861 ocpp url: %s", storage_Get_url_ocpp());
-					controller_change = true;
-				}else{
-					ESP_LOGI(TAG, "Old: 861 ocpp url:%s", storage_Get_url_ocpp());
-				}
+	if(cJSON_IsNull(cbid_json)){
+		if(storage_Get_url_ocpp()[0] != '\0'){
+			storage_Set_chargebox_identity_ocpp("");
+			doSave = true;
+			ESP_LOGW(TAG, "New: 862 CBID: %s", storage_Get_chargebox_identity_ocpp());
+			context->controller_change = true;
+		}else{
+			ESP_LOGI(TAG, "Old: 862 CBID: %s", storage_Get_chargebox_identity_ocpp());
+		}
 
-			}else if(cJSON_IsString(url_json)){
+	}else if(cJSON_IsString(cbid_json)){
+		char * cbid = cbid_json->valuestring;
 
-				char * url = url_json->valuestring;
-				if(strcmp(storage_Get_url_ocpp(), url) == 0){
-					ESP_LOGI(TAG, "Old: 861 ocpp url: %s", storage_Get_url_ocpp());
-				}else{
-					bool url_is_valid = true;
+		if(strcmp(cbid, storage_Get_chargebox_identity_ocpp()) == 0){
+			ESP_LOGI(TAG, "Old: 862 CBID: %s", storage_Get_chargebox_identity_ocpp());
+		}else{
+			bool cbid_accepted = false;
+			bool free_cbid = false;
 
-					const unsigned char * uri_end = NULL;
-					if((strncmp(url, "ws://", 5) == 0 || strncmp(url, "wss://", 6) == 0)
-						&& strlen(url) <= CONFIG_OCPP_URL_MAX_LENGTH
-						&& rfc3986_is_valid_uri((unsigned char *)url, &uri_end)
-						&& *uri_end == '\0'){
+			if(strlen(cbid) > CHARGEBOX_IDENTITY_OCPP_MAX_LENGTH){
+				ESP_LOGE(TAG, "CBID is too long");
 
-						url_is_valid = true;
+			}else if(!rfc3986_is_percent_encode_compliant((unsigned char *)cbid)){
+				char * cbid_encoded = malloc(strlen(cbid) * 3);
+				if(cbid_encoded == NULL){
+					ESP_LOGE(TAG, "Unable to allocate buffer for encoded CBID");
+				}else{
+					rfc3986_percent_encode((unsigned char *)cbid, cbid_encoded);
+					if(strlen(cbid_encoded) > CHARGEBOX_IDENTITY_OCPP_MAX_LENGTH){
+						ESP_LOGE(TAG, "Percent encoding increased CBID length beyound allowed limit");
+						free(cbid_encoded);
 					}else{
-						url_is_valid = false;
+						cbid = cbid_encoded;
+						free_cbid = true;
+						cbid_accepted = true;
 					}
+				}
+			}else{
+				cbid_accepted = true;
+			}
 
+			if(cbid_accepted){
+				storage_Set_chargebox_identity_ocpp(cbid);
+				doSave = true;
 
-					if(url_is_valid){
-						ESP_LOGW(TAG, "New: 861 ocpp url: %s", url);
-						storage_Set_url_ocpp(url);
-						doSave = true;
+				context->controller_change = true;
 
-						controller_change = true;
-					}else{
-						ESP_LOGW(TAG, "Recieved invalid url '%s' for ocpp", url);
-						ESP_LOGI(TAG, "Err: 861 ocpp url: %s", storage_Get_url_ocpp());
-					}
-				}
+				ESP_LOGI(TAG, "New: 862 CBID: %s", storage_Get_chargebox_identity_ocpp());
+			}else{
+				ESP_LOGW(TAG, "Err: 862 CBID: %s", storage_Get_chargebox_identity_ocpp());
 			}
-		}
 
-		//OcppNativeCBID
-		if(cJSON_HasObjectItem(settings, "862"))
-		{
-			nrOfParameters++;
+			if(free_cbid)
+				free(cbid);
+		}
+	}
 
-			cJSON * cbid_json = cJSON_GetObjectItem(settings, "862");
-			if(cJSON_IsNull(cbid_json)){
-				if(storage_Get_url_ocpp()[0] != '\0'){
-					storage_Set_chargebox_identity_ocpp("");
-					doSave = true;
-					ESP_LOGW(TAG, "New: 862 CBID: %s", storage_Get_chargebox_identity_ocpp());
-					controller_change = true;
-				}else{
-					ESP_LOGI(TAG, "Old: 862 CBID: %s", storage_Get_chargebox_identity_ocpp());
-				}
+	return doSave;
+}
 
-			}else if(cJSON_IsString(cbid_json)){
-				char * cbid = cbid_json->valuestring;
+// OCPP AuthorizationKey, only applied together with 864 authorization_key_set_from_zaptec
+static bool setting_ocpp_authorization_key(const cJSON * authorization_key, struct cloud_settings_context * context)
+{
+	const cJSON * set_from_zaptec_json = setting_value(context, 864);
+	if(set_from_zaptec_json == NULL)
+		return false;
 
-				if(strcmp(cbid, storage_Get_chargebox_identity_ocpp()) == 0){
-					ESP_LOGI(TAG, "Old: 862 CBID: %s", storage_Get_chargebox_identity_ocpp());
-				}else{
-					bool cbid_accepted = false;
-					bool free_cbid = false;
+	bool set_from_zaptec = false;
 
-					if(strlen(cbid) > CHARGEBOX_IDENTITY_OCPP_MAX_LENGTH){
-						ESP_LOGE(TAG, "CBID is too long");
+	if(cJSON_IsBool(set_from_zaptec_json)){
+		set_from_zaptec = cJSON_IsTrue(set_from_zaptec_json);
+	}else if(cJSON_IsString(set_from_zaptec_json)){
+		char * set_from_zaptec_str = set_from_zaptec_json->valuestring;
+		set_from_zaptec = (strcmp(set_from_zaptec_str, "1") == 0 || strcasecmp(set_from_zaptec_str, "true") == 0);
+	}else{
+		ESP_LOGE(TAG, "Err: 864 authorization_key_set_from_zaptec: %s", set_from_zaptec ? "true" : "false");
+	}
 
-					}else if(!rfc3986_is_percent_encode_compliant((unsigned char *)cbid)){
-						char * cbid_encoded = malloc(strlen(cbid) * 3);
-						if(cbid_encoded == NULL){
-							ESP_LOGE(TAG, "Unable to allocate buffer for encoded CBID");
-						}else{
-							rfc3986_percent_encode((unsigned char *)cbid, cbid_encoded);
-							if(strlen(cbid_encoded) > CHARGEBOX_IDENTITY_OCPP_MAX_LENGTH){
-								ESP_LOGE(TAG, "Percent encoding increased CBID length beyound allowed limit");
-								free(cbid_encoded);
-							}else{
-								cbid = cbid_encoded;
-								free_cbid = true;
-								cbid_accepted = true;
-							}
-						}
-					}else{
-						cbid_accepted = true;
-					}
+	if((cJSON_IsString(authorization_key) &&
+			(strlen(authorization_key->valuestring) == 0 || (strlen(authorization_key->valuestring) >= 16 && strlen(authorization_key->valuestring) <= 40)))
+			|| cJSON_IsNull(authorization_key)
+		){
 
-					if(cbid_accepted){
-						storage_Set_chargebox_identity_ocpp(cbid);
-						doSave = true;
+		char * new_key = cJSON_IsString(authorization_key) ? authorization_key->valuestring : "";
 
-						controller_change = true;
+		if(strcmp(new_key, storage_Get_ocpp_authorization_key()) == 0
+			|| !set_from_zaptec){
+			ESP_LOGI(TAG, "Old: 863 authorization_key");
+		}else{
+			storage_Set_ocpp_authorization_key(new_key);
+			storage_Set_authorization_key_set_from_zaptec_ocpp(true);
+			ESP_LOGW(TAG, "New: 863 authorization_key");
 
-						ESP_LOGI(TAG, "New: 862 CBID: %s", storage_Get_chargebox_identity_ocpp());
-					}else{
-						ESP_LOGW(TAG, "Err: 862 CBID: %s", storage_Get_chargebox_identity_ocpp());
-					}
+			context->controller_change = true;
 
-					if(free_cbid)
-						free(cbid);
-				}
+			if(storage_Get_ocpp_security_profile() == 0 || storage_Get_ocpp_security_profile() == 1){
+				storage_Set_ocpp_security_profile(1);
 			}
-		}
 
-		// OCPP AuthorizationKey
-		if(cJSON_HasObjectItem(settings, "863") && cJSON_HasObjectItem(settings, "864"))
-		{
-			nrOfParameters += 2;
+			return true;
+		}
+	}else{
+		ESP_LOGE(TAG, "Err: 863 authorization_key");
+	}
 
-			cJSON * authorization_key = cJSON_GetObjectItem(settings, "863");
-			cJSON * set_from_zaptec_json = cJSON_GetObjectItem(settings, "864");
+	return false;
+}
 
-			bool set_from_zaptec = false;
+//Authorization
+static bool setting_authentication_required(const cJSON * value, struct cloud_settings_context * context)
+{
+	if(storage_Get_session_controller() == eSESSION_OCPP){
+		ESP_LOGW(TAG, "Ignore: 120 AuthenticationRequired");
+		return false;
+	}
 
-			if(cJSON_IsBool(set_from_zaptec_json)){
-				set_from_zaptec = cJSON_IsTrue(set_from_zaptec_json);
-			}else if(cJSON_IsString(set_from_zaptec_json)){
-				char * set_from_zaptec_str = set_from_zaptec_json->valuestring;
-				set_from_zaptec = (strcmp(set_from_zaptec_str, "1") == 0 || strcasecmp(set_from_zaptec_str, "true") == 0);
-			}else{
-				ESP_LOGE(TAG, "Err: 864 authorization_key_set_from_zaptec: %s", set_from_zaptec ? "true" : "false");
-			}
+	const char * valueString = setting_string(value);
+	if(valueString == NULL)
+		return false;
 
-			if((cJSON_IsString(authorization_key) &&
-					(strlen(authorization_key->valuestring) == 0 || (strlen(authorization_key->valuestring) >= 16 && strlen(authorization_key->valuestring) <= 40)))
-					|| cJSON_IsNull(authorization_key)
-				){
+	int useAuthorization = atoi(valueString);
 
-				char * new_key = cJSON_IsString(authorization_key) ? authorization_key->valuestring : "";
+	if((useAuthorization == 0) || (useAuthorization == 1))
+	{
+		//Only save if different from value on file
+		if(useAuthorization != (int)storage_Get_AuthenticationRequired())
+		{
+			MessageType ret = MCU_SendUint8Parameter(AuthenticationRequired, (uint8_t)useAuthorization);
+			if(ret == MsgWriteAck)
+			{
+				storage_Set_AuthenticationRequired((uint8_t)useAuthorization);
+				ESP_LOGW(TAG, "New: 120 AuthenticationRequired=%d", useAuthorization);
+				return true;
+			}
+			else
+			{
+				ESP_LOGE(TAG, "MCU useAuthorization parameter error");
+			}
+		}
+		else
+		{
+			ESP_LOGI(TAG, "Old: 120 Authorization %d", storage_Get_AuthenticationRequired());
+		}
+	}
+	else
+	{
+		ESP_LOGI(TAG, "Invalid useAuthorization: %d \n", useAuthorization);
+	}
 
-				if(strcmp(new_key, storage_Get_ocpp_authorization_key()) == 0
-					|| !set_from_zaptec){
-					ESP_LOGI(TAG, "Old: 863 authorization_key");
-				}else{
-					storage_Set_ocpp_authorization_key(new_key);
-					storage_Set_authorization_key_set_from_zaptec_ocpp(true);
-					ESP_LOGW(TAG, "New: 863 authorization_key");
+	return false;
+}
 
-					doSave = true;
-					controller_change = true;
+//Scale of the dead-bands for measured values published on change
+static bool setting_transmit_change_level(const cJSON * value, struct cloud_settings_context * context)
+{
+	const char * valueString = setting_string(value);
+	if(valueString == NULL)
+		return false;
 
-					if(storage_Get_ocpp_security_profile() == 0 || storage_Get_ocpp_security_profile() == 1){
-						storage_Set_ocpp_security_profile(1);
-					}
-				}
-			}else{
-				ESP_LOGE(TAG, "Err: 863 authorization_key");
-			}
-		}
+	float changeLevel = atof(valueString);
 
-		if(controller_change){
-			on_controller_change(old_session_controller, storage_Get_session_controller());
-			doSave = true;
+	if((changeLevel >= 0.1) && (changeLevel <= 10.0))
+	{
+		if(changeLevel != storage_Get_TransmitChangeLevel())
+		{
+			storage_Set_TransmitChangeLevel(changeLevel);
+			ESP_LOGW(TAG, "New: 146 TransmitChangeLevel=%f", changeLevel);
+			return true;
 		}
-
-		//Authorization
-		if(cJSON_HasObjectItem(settings, "120"))
+		else
 		{
-			nrOfParameters++;
+			ESP_LOGI(TAG, "Old: 146 TransmitChangeLevel %f", changeLevel);
+		}
+	}
+	else
+	{
+		ESP_LOGI(TAG, "Invalid TransmitChangeLevel: %f \n", changeLevel);
+	}
 
-			if(storage_Get_session_controller() != eSESSION_OCPP){
-				char * valueString = cJSON_GetObjectItem(settings,"120")->valuestring;
-				//ESP_LOGI(TAG, "120 Authorization=%s", valueString);
+	return false;
+}
 
-				int useAuthorization = atoi(valueString);
+//Encoding of published observations, 0: JSON, 1: binary telemetry format. Kept until restart.
+static bool setting_telemetry_encoding(const cJSON * value, struct cloud_settings_context * context)
+{
+	const char * valueString = setting_string(value);
+	if(valueString == NULL)
+		return false;
 
-				//ESP_LOGI(TAG, "120 useAuthorization: %d", useAuthorization);
+	int encoding = atoi(valueString);
 
-				if((useAuthorization == 0) || (useAuthorization == 1))
-				{
-					//Only save if different from value on file
-					if(useAuthorization != (int)storage_Get_AuthenticationRequired())
-					{
-						MessageType ret = MCU_SendUint8Parameter(AuthenticationRequired, (uint8_t)useAuthorization);
-						if(ret == MsgWriteAck)
-						{
-							storage_Set_AuthenticationRequired((uint8_t)useAuthorization);
-							ESP_LOGW(TAG, "New: 120 AuthenticationRequired=%d", useAuthorization);
-							doSave = true;
-						}
-						else
-						{
-							ESP_LOGE(TAG, "MCU useAuthorization parameter error");
-						}
-					}
-					else
-					{
-						ESP_LOGI(TAG, "Old: 120 Authorization %d", storage_Get_AuthenticationRequired());
-					}
-				}
-				else
-				{
-					ESP_LOGI(TAG, "Invalid useAuthorization: %d \n", useAuthorization);
-				}
-			}else{
-				ESP_LOGW(TAG, "Ignore: 120 AuthenticationRequired");
-			}
-		}
+	if((encoding == 0) || (encoding == 1))
+	{
+		cloud_observations_set_binary(encoding == 1);
+		ESP_LOGI(TAG, "148 TelemetryEncoding=%d", encoding);
+	}
+	else
+	{
+		ESP_LOGI(TAG, "Invalid TelemetryEncoding: %d \n", encoding);
+	}
 
-		//Maximum current
-		if(cJSON_HasObjectItem(settings, "510"))
-		{
-			nrOfParameters++;
+	return false;
+}
 
-			char * valueString = cJSON_GetObjectItem(settings,"510")->valuestring;
-			//ESP_LOGI(TAG, "510 MaxCurrent=%s", valueString);
+//Maximum current
+static bool setting_current_in_maximum(const cJSON * value, struct cloud_settings_context * context)
+{
+	const char * valueString = setting_string(value);
+	if(valueString == NULL)
+		return false;
 
-			float currentInMaximum = atof(valueString);
+	float currentInMaximum = atof(valueString);
 
-			if((32.0 >= currentInMaximum) && (currentInMaximum >= 0.0))
+	if((32.0 >= currentInMaximum) && (currentInMaximum >= 0.0))
+	{
+		if(currentInMaximum != storage_Get_CurrentInMaximum())
+		{
+			MessageType ret = MCU_SendFloatParameter(ParamCurrentInMaximum, currentInMaximum);
+			if(ret == MsgWriteAck)
 			{
-				if(currentInMaximum != storage_Get_CurrentInMaximum())
-				{
-					MessageType ret = MCU_SendFloatParameter(ParamCurrentInMaximum, currentInMaximum);
-					if(ret == MsgWriteAck)
-					{
-						storage_Set_CurrentInMaximum(currentInMaximum);
-						ESP_LOGW(TAG, "New: 510 currentInMaximum: %f \n", currentInMaximum);
-						doSave = true;
-					}
-					else
-					{
-						ESP_LOGE(TAG, "MCU currentInMaximum parameter error");
-					}
-				}
-				else
-				{
-					ESP_LOGI(TAG, "Old: 510 Maximum current: %f", storage_Get_CurrentInMaximum());
-				}
+				storage_Set_CurrentInMaximum(currentInMaximum);
+				ESP_LOGW(TAG, "New: 510 currentInMaximum: %f \n", currentInMaximum);
+				return true;
 			}
 			else
 			{
-				ESP_LOGI(TAG, "Invalid currentInMaximum: %f \n", currentInMaximum);
+				ESP_LOGE(TAG, "MCU currentInMaximum parameter error");
 			}
 		}
-
-
-		///Minimum current
-		if(cJSON_HasObjectItem(settings, "511"))
+		else
 		{
-			nrOfParameters++;
+			ESP_LOGI(TAG, "Old: 510 Maximum current: %f", storage_Get_CurrentInMaximum());
+		}
+	}
+	else
+	{
+		ESP_LOGI(TAG, "Invalid currentInMaximum: %f \n", currentInMaximum);
+	}
+
+	return false;
+}
 
-			char * valueString = cJSON_GetObjectItem(settings,"511")->valuestring;
-			//ESP_LOGI(TAG, "511 MinCurrent=%s", valueString);
+///Minimum current
+static bool setting_current_in_minimum(const cJSON * value, struct cloud_settings_context * context)
+{
+	const char * valueString = setting_string(value);
+	if(valueString == NULL)
+		return false;
 
-			float currentInMinimum = atof(valueString);
+	float currentInMinimum = atof(valueString);
 
-			if((32.0 >= currentInMinimum) && (currentInMinimum >= 0.0))
+	if((32.0 >= currentInMinimum) && (currentInMinimum >= 0.0))
+	{
+		if(currentInMinimum != storage_Get_CurrentInMinimum())
+		{
+			MessageType ret = MCU_SendFloatParameter(ParamCurrentInMinimum, currentInMinimum);
+			if(ret == MsgWriteAck)
 			{
-				if(currentInMinimum != storage_Get_CurrentInMinimum())
-				{
-					MessageType ret = MCU_SendFloatParameter(ParamCurrentInMinimum, currentInMinimum);
-					if(ret == MsgWriteAck)
-					{
-						storage_Set_CurrentInMinimum(currentInMinimum);
-						ESP_LOGW(TAG, "New: 511 currentInMinimum: %f \n", currentInMinimum);
-						doSave = true;
-					}
-					else
-					{
-						ESP_LOGE(TAG, "MCU currentInMinimum parameter error");
-					}
-				}
-				else
-				{
-					ESP_LOGI(TAG, "Old: 511 Minimum current: %f", storage_Get_CurrentInMinimum());
-				}
+				storage_Set_CurrentInMinimum(currentInMinimum);
+				ESP_LOGW(TAG, "New: 511 currentInMinimum: %f \n", currentInMinimum);
+				return true;
 			}
 			else
 			{
-				ESP_LOGI(TAG, "Invalid currentInMinimum: %f \n", currentInMinimum);
+				ESP_LOGE(TAG, "MCU currentInMinimum parameter error");
 			}
 		}
+		else
+		{
+			ESP_LOGI(TAG, "Old: 511 Minimum current: %f", storage_Get_CurrentInMinimum());
+		}
+	}
+	else
+	{
+		ESP_LOGI(TAG, "Invalid currentInMinimum: %f \n", currentInMinimum);
+	}
 
+	return false;
+}
 
-		//MaxPhases
-		if(cJSON_HasObjectItem(settings, "520"))
-		{
-			nrOfParameters++;
+//MaxPhases
+static bool setting_max_phases(const cJSON * value, struct cloud_settings_context * context)
+{
+	const char * valueString = setting_string(value);
+	if(valueString == NULL)
+		return false;
 
-			char * valueString = cJSON_GetObjectItem(settings,"520")->valuestring;
-			//ESP_LOGI(TAG, "520 MaxPhases=%s", valueString);
+	int maxPhases = atoi(valueString);
 
-			int maxPhases = atoi(valueString);
+	//Since this is not a setting like on Pro, but a measurement Go sends to cloud, we don't need to save it or send to MCU
+	//Just compare and see if measured value matches value received from Cloud.
 
-			//Since this is not a setting like on Pro, but a measurement Go sends to cloud, we don't need to save it or send to MCU
-			//Just compare and see if measured value matches value received from Cloud.
+	if(maxPhases != GetMaxPhases())
+	{
+		ESP_LOGE(TAG, "520 MaxPhases: %d !=%d -> Differ!!!", maxPhases, GetMaxPhases());
+	}
+	else
+	{
+		ESP_LOGI(TAG, "NA : 520 MaxPhases: %d == %d -> OK", maxPhases, GetMaxPhases());
+	}
 
-			if(maxPhases != GetMaxPhases())
-			{
-				ESP_LOGE(TAG, "520 MaxPhases: %d !=%d -> Differ!!!", maxPhases, GetMaxPhases());
-			}
-			else
-			{
-				ESP_LOGI(TAG, "NA : 520 MaxPhases: %d == %d -> OK", maxPhases, GetMaxPhases());
-			}
+	return false;
+}
 
-			/*if((3 >= maxPhases) && (maxPhases >= 1))
-			{
-				if(maxPhases != (int)storage_Get_MaxPhases())
-				{
-					MessageType ret = MCU_SendUint8Parameter(MaxPhases, (uint8_t)maxPhases);
-					if(ret == MsgWriteAck)
-					{
-						storage_Set_MaxPhases((uint8_t)maxPhases);
-						ESP_LOGW(TAG, "New: 520 maxPhases=%d\n", maxPhases);
-						doSave = true;
-					}
-					else
-					{
-						ESP_LOGE(TAG, "MCU maxPhases parameter error");
-					}
-				}
-				else
-				{
-					ESP_LOGI(TAG, "Old: 520 MaxPhases: %d", storage_Get_MaxPhases());
-				}
-			}
-			else
-			{
-				ESP_LOGI(TAG, "Invalid maxPhases: %d \n", maxPhases);
-			}*/
-		}
+//DefaultOfflinePhase
+static bool setting_default_offline_phase(const cJSON * value, struct cloud_settings_context * context)
+{
+	const char * valueString = setting_string(value);
+	if(valueString == NULL)
+		return false;
 
-		//DefaultOfflinePhase
-		if(cJSON_HasObjectItem(settings, "522"))
+	int defaultOfflinePhase = atoi(valueString);
+
+	if((9 >= defaultOfflinePhase) && (defaultOfflinePhase >= 1))
+	{
+		if(defaultOfflinePhase != (int)storage_Get_DefaultOfflinePhase())
+		{
+			storage_Set_DefaultOfflinePhase((uint8_t)defaultOfflinePhase);
+			ESP_LOGW(TAG, "New: 522 defaultOfflinePhase=%d\n", defaultOfflinePhase);
+			return true;
+		}
+		else
 		{
-			nrOfParameters++;
+			ESP_LOGI(TAG, "Old: 522 OfflinePhase: %d", storage_Get_DefaultOfflinePhase());
+		}
+	}
+	else
+	{
+		ESP_LOGI(TAG, "Invalid defaultOfflinePhase: %d \n", defaultOfflinePhase);
+	}
 
-			char * valueString = cJSON_GetObjectItem(settings,"522")->valuestring;
-			//ESP_LOGI(TAG, "522 DefaultOfflinePhase=%s", valueString);
+	return false;
+}
 
-			int defaultOfflinePhase = atoi(valueString);
+//DefaultOfflineCurrent
+static bool setting_default_offline_current(const cJSON * value, struct cloud_settings_context * context)
+{
+	const char * valueString = setting_string(value);
+	if(valueString == NULL)
+		return false;
 
-			//ESP_LOGE(TAG, "522 defaultOfflinePhase=%d\n", defaultOfflinePhase);
+	float defaultOfflineCurrent = atof(valueString);
 
-			if((9 >= defaultOfflinePhase) && (defaultOfflinePhase >= 1))
-			{
-				//MessageType ret = MCU_SendUint8Parameter(ChargerOfflinePhase, (uint8_t)defaultOfflinePhase);
-				//if(ret == MsgWriteAck)
-				//{
-				if(defaultOfflinePhase != (int)storage_Get_DefaultOfflinePhase())
-				{
-					storage_Set_DefaultOfflinePhase((uint8_t)defaultOfflinePhase);
-					ESP_LOGW(TAG, "New: 522 defaultOfflinePhase=%d\n", defaultOfflinePhase);
-					doSave = true;
-				}
-				else
-				{
-					ESP_LOGI(TAG, "Old: 522 OfflinePhase: %d", storage_Get_DefaultOfflinePhase());
-				}
-				//}
-				//else
-				//{
-				//	ESP_LOGE(TAG, "MCU defaultOfflinePhase parameter error");
-				//}
-			}
-			else
-			{
-				ESP_LOGI(TAG, "Invalid defaultOfflinePhase: %d \n", defaultOfflinePhase);
-			}
+	if((32.0 >= defaultOfflineCurrent) && (defaultOfflineCurrent >= 0.0))
+	{
+		if(defaultOfflineCurrent != storage_Get_DefaultOfflineCurrent())
+		{
+			storage_Set_DefaultOfflineCurrent(defaultOfflineCurrent);
+			ESP_LOGW(TAG, "New: 523 defaultOfflineCurrent: %f \n", defaultOfflineCurrent);
+			return true;
 		}
-
-		//DefaultOfflineCurrent
-		if(cJSON_HasObjectItem(settings, "523"))
+		else
 		{
-			nrOfParameters++;
+			ESP_LOGI(TAG, "Old: 523 OfflineCurrent: %f", storage_Get_DefaultOfflineCurrent());
+		}
+	}
+	else
+	{
+		ESP_LOGI(TAG, "Invalid defaultOfflineCurrent: %f \n", defaultOfflineCurrent);
+	}
 
-			char * valueString = cJSON_GetObjectItem(settings,"523")->valuestring;
-			//ESP_LOGI(TAG, "523 DefaultOfflineCurrent=%s", valueString);
+	return false;
+}
+
+//IsEnable
+static bool setting_is_enabled(const cJSON * value, struct cloud_settings_context * context)
+{
+	const char * valueString = setting_string(value);
+	if(valueString == NULL)
+		return false;
 
-			float defaultOfflineCurrent = atof(valueString);
+	int isEnabled = atoi(valueString);
 
-			if((32.0 >= defaultOfflineCurrent) && (defaultOfflineCurrent >= 0.0))
+	if((isEnabled == 0) || (isEnabled == 1))
+	{
+		if(isEnabled != (int)storage_Get_IsEnabled())
+		{
+			MessageType ret = MCU_SendUint8Parameter(ParamIsEnabled, (uint8_t)isEnabled);
+			if(ret == MsgWriteAck)
 			{
-				//MessageType ret = MCU_SendFloatParameter(ChargerOfflineCurrent, defaultOfflineCurrent);
-				//if(ret == MsgWriteAck)
-				//{
-				if(defaultOfflineCurrent != storage_Get_DefaultOfflineCurrent())
-				{
-					storage_Set_DefaultOfflineCurrent(defaultOfflineCurrent);
-					ESP_LOGW(TAG, "New: 523 defaultOfflineCurrent: %f \n", defaultOfflineCurrent);
-					doSave = true;
-				}
-				else
-				{
-					ESP_LOGI(TAG, "Old: 523 OfflineCurrent: %f", storage_Get_DefaultOfflineCurrent());
-				}
-				//}
-				//else
-				//{
-					//ESP_LOGE(TAG, "MCU defaultOfflineCurrent parameter error");
-				//}
+				storage_Set_IsEnabled((uint8_t)isEnabled);
+				ESP_LOGW(TAG, "New: 711 isEnabled=%d\n", isEnabled);
+				return true;
 			}
 			else
 			{
-				ESP_LOGI(TAG, "Invalid defaultOfflineCurrent: %f \n", defaultOfflineCurrent);
+				ESP_LOGE(TAG, "MCU isEnabled parameter error");
 			}
 		}
-
-		//IsEnable
-		if(cJSON_HasObjectItem(settings, "711"))
+		else
 		{
-			nrOfParameters++;
+			ESP_LOGI(TAG, "Old: 711 IsEnabled: %d ", storage_Get_IsEnabled());
+		}
+	}
+	else
+	{
+		ESP_LOGI(TAG, "Invalid isEnabled: %d \n", isEnabled);
+	}
+
+	return false;
+}
+
+//Standalone
+static bool setting_standalone(const cJSON * value, struct cloud_settings_context * context)
+{
+	if(storage_Get_session_controller() == eSESSION_OCPP){
+		ESP_LOGW(TAG, "Ignoring: 712 standalone");
+		return false;
+	}
 
-			char * valueString = cJSON_GetObjectItem(settings,"711")->valuestring;
-			//ESP_LOGI(TAG, "711 Isenabled=%s", valueString);
+	const char * valueString = setting_string(value);
+	if(valueString == NULL)
+		return false;
 
-			int isEnabled = atoi(valueString);
-			//ESP_LOGI(TAG, "711 isEnabled: %d \n", isEnabled);
+	int standalone = atoi(valueString);
 
-			if((isEnabled == 0) || (isEnabled == 1))
+	if((standalone == 0) || (standalone == 1))
+	{
+		if(standalone != (int)storage_Get_Standalone())
+		{
+			if(chargeController_SetStandaloneState(standalone == 1 ? eSESSION_STANDALONE : eSESSION_ZAPTEC_CLOUD))
 			{
-				if(isEnabled != (int)storage_Get_IsEnabled())
-				{
-					MessageType ret = MCU_SendUint8Parameter(ParamIsEnabled, (uint8_t)isEnabled);
-					if(ret == MsgWriteAck)
-					{
-						storage_Set_IsEnabled((uint8_t)isEnabled);
-						ESP_LOGW(TAG, "New: 711 isEnabled=%d\n", isEnabled);
-						doSave = true;
-					}
-					else
-					{
-						ESP_LOGE(TAG, "MCU isEnabled parameter error");
-					}
-				}
-				else
-				{
-					ESP_LOGI(TAG, "Old: 711 IsEnabled: %d ", storage_Get_IsEnabled());
-				}
+				ESP_LOGW(TAG, "New: 712 standalone=%d\n", standalone);
+
+				cloud_listener_SetMQTTKeepAliveTime(standalone);
+
+				return true;
 			}
 			else
 			{
-				ESP_LOGI(TAG, "Invalid isEnabled: %d \n", isEnabled);
+				ESP_LOGE(TAG, "MCU standalone parameter error");
 			}
 		}
-
-		//Standalone
-		if(cJSON_HasObjectItem(settings, "712"))
+		else
 		{
-			nrOfParameters++;
+			ESP_LOGI(TAG, "Old: 712 Standalone: %d", storage_Get_Standalone());
+		}
+	}
+	else
+	{
+		ESP_LOGI(TAG, "Invalid standalone: %d \n", standalone);
+	}
 
-			if(storage_Get_session_controller() != eSESSION_OCPP){
-				char * valueString = cJSON_GetObjectItem(settings,"712")->valuestring;
-				//ESP_LOGI(TAG, "712 Standalone=%s", valueString);
+	return false;
+}
 
-				int standalone = atoi(valueString);
+//InstallationId
+static bool setting_installation_id(const cJSON * value, struct cloud_settings_context * context)
+{
+	const char * valueString = setting_string(value);
+	if(valueString == NULL)
+		return false;
 
-				//ESP_LOGI(TAG, "712 standalone: %d \n", standalone);
+	char installationId[DEFAULT_STR_SIZE] = {0};
 
-				if((standalone == 0) || (standalone == 1))
-				{
-					if(standalone != (int)storage_Get_Standalone())
-					{
-						//MessageType ret = MCU_SendUint8Parameter(ParamIsStandalone, (uint8_t)standalone);
-						//if(ret == MsgWriteAck)
-						if(chargeController_SetStandaloneState(standalone == 1 ? eSESSION_STANDALONE : eSESSION_ZAPTEC_CLOUD))
-						{
-							//storage_Set_Standalone((uint8_t)standalone);
-							ESP_LOGW(TAG, "New: 712 standalone=%d\n", standalone);
+	//Ensure string is not longer than buffer
+	if(strlen(valueString) < DEFAULT_STR_SIZE)
+		strcpy(installationId, valueString);
 
-							cloud_listener_SetMQTTKeepAliveTime(standalone);
+	if(strcmp(installationId, storage_Get_InstallationId()) != 0)
+	{
+		ESP_LOGW(TAG, "800 installationId: %s \n", installationId);
+		storage_Set_InstallationId(installationId);
 
-							doSave = true;
-						}
-						else
-						{
-							ESP_LOGE(TAG, "MCU standalone parameter error");
-						}
-					}
-					else
-					{
-						ESP_LOGI(TAG, "Old: 712 Standalone: %d", storage_Get_Standalone());
-					}
-				}
-				else
-				{
-					ESP_LOGI(TAG, "Invalid standalone: %d \n", standalone);
-				}
-			}else{
-				ESP_LOGW(TAG, "Ignoring: 712 standalone");
-			}
-		}
+		newInstallationIdFlag = true;
+		return true;
+	}
+	else
+	{
+		ESP_LOGI(TAG, "Old: 800 InstallationId: %s", storage_Get_InstallationId());
+	}
 
-		//InstallationId
-		if(cJSON_HasObjectItem(settings, "800"))
-		{
-			nrOfParameters++;
+	return false;
+}
 
-			char * valueString = cJSON_GetObjectItem(settings,"800")->valuestring;
-			//ESP_LOGI(TAG, "800 InstallationId=%s", valueString);
+//RoutingId
+static bool setting_routing_id(const cJSON * value, struct cloud_settings_context * context)
+{
+	const char * valueString = setting_string(value);
+	if(valueString == NULL)
+		return false;
 
-			char installationId[DEFAULT_STR_SIZE] = {0};
+	char routingId[DEFAULT_STR_SIZE] = {0};
 
-			//Ensure string is not longer than buffer
-			if(strlen(valueString) < DEFAULT_STR_SIZE)
-				strcpy(installationId, valueString);
+	//Ensure string is not longer than buffer
+	if(strlen(valueString) < DEFAULT_STR_SIZE)
+		strcpy(routingId, valueString);
 
-			int instLen = strlen(installationId);
-			if(instLen < DEFAULT_STR_SIZE)
-			{
-				int cmpResult = strcmp(installationId, storage_Get_InstallationId());
-				if(cmpResult != 0)
-				{
-					ESP_LOGW(TAG, "800 installationId: %s \n", installationId);
-					storage_Set_InstallationId(installationId);
-					doSave = true;
+	if(strcmp(routingId, storage_Get_RoutingId()) != 0)
+	{
+		ESP_LOGW(TAG, "New: 801 RoutingId: %s", routingId);
+		storage_Set_RoutingId(routingId);
 
-					newInstallationIdFlag = true;
-				}
-				else
-				{
-					ESP_LOGI(TAG, "Old: 800 InstallationId: %s", storage_Get_InstallationId());
-				}
-			}
-		}
+		newInstallationIdFlag = true;
+		return true;
+	}
+	else
+	{
+		ESP_LOGI(TAG, "Old: 801 RoutingId: %s", storage_Get_RoutingId());
+	}
 
-		//RoutingId
-		if(cJSON_HasObjectItem(settings, "801"))
-		{
-			nrOfParameters++;
+	return false;
+}
 
-			char * valueString = cJSON_GetObjectItem(settings,"801")->valuestring;
-			//ESP_LOGI(TAG, "801 RoutingId=%s", valueString);
+//ChargerName
+static bool setting_charger_name(const cJSON * value, struct cloud_settings_context * context)
+{
+	const char * valueString = setting_string(value);
+	if(valueString == NULL)
+		return false;
 
-			char routingId[DEFAULT_STR_SIZE] = {0};
+	char chargerName[DEFAULT_STR_SIZE] = {0};
 
-			//Ensure string is not longer than buffer
-			if(strlen(valueString) < DEFAULT_STR_SIZE)
-				strcpy(routingId, valueString);
+	//Ensure string is not longer than buffer
+	if(strlen(valueString) < DEFAULT_STR_SIZE)
+		strcpy(chargerName, valueString);
 
-			int riLen = strlen(routingId);
-			if(riLen < DEFAULT_STR_SIZE)
-			{
-				int cmpResult = strcmp(routingId, storage_Get_RoutingId());
-				if(cmpResult != 0)
-				{
-					ESP_LOGW(TAG, "New: 801 RoutingId: %s", routingId);
-					storage_Set_RoutingId(routingId);
-					doSave = true;
+	if(strcmp(chargerName, storage_Get_ChargerName()) != 0)
+	{
+		ESP_LOGW(TAG, "New: 802 ChargerName: %s", chargerName);
+		storage_Set_ChargerName(chargerName);
+		return true;
+	}
+	else
+	{
+		ESP_LOGI(TAG, "Old: 802 ChargerName: %s", storage_Get_ChargerName());
+	}
 
-					newInstallationIdFlag = true;
-				}
-				else
-				{
-					ESP_LOGI(TAG, "Old: 801 RoutingId: %s", storage_Get_RoutingId());
-				}
-			}
-		}
+	return false;
+}
 
-		//ChargerName
-		if(cJSON_HasObjectItem(settings, "802"))
-		{
-			nrOfParameters++;
+//Due to this being set to SWAP_COMMUNICATION_MODE in earlier versions up to 0.0.1.22,
+//diagnosticsMode must never be set as Cloud parameter, only through command.
+static bool setting_diagnostics_mode(const cJSON * value, struct cloud_settings_context * context)
+{
+	ESP_LOGE(TAG, "#### 805 DiagnosticsMode: DO NOT USE ####");
+	return false;
+}
 
-			char * valueString = cJSON_GetObjectItem(settings,"802")->valuestring;
-			//ESP_LOGI(TAG, "802 ChargerName=%s", valueString);
+/*
+ * Cloud settings sorted by id for cloud_settings_find. Settings that decide the session controller are applied first,
+ * as 120 and 712 are ignored when OCPP is the session controller.
+ */
+static const struct cloud_setting cloud_settings[] = {
+	{120, setting_authentication_required, 0},
+	{146, setting_transmit_change_level, 0},
+	{148, setting_telemetry_encoding, 0},
+	{510, setting_current_in_maximum, 0},
+	{511, setting_current_in_minimum, 0},
+	{520, setting_max_phases, 0},
+	{522, setting_default_offline_phase, 0},
+	{523, setting_default_offline_current, 0},
+	{711, setting_is_enabled, 0},
+	{712, setting_standalone, 0},
+	{800, setting_installation_id, 0},
+	{801, setting_routing_id, 0},
+	{802, setting_charger_name, 0},
+	{805, setting_diagnostics_mode, 0},
+	{860, setting_session_controller, CLOUD_SETTING_FIRST},
+	{861, setting_ocpp_url, CLOUD_SETTING_FIRST},
+	{862, setting_ocpp_cbid, CLOUD_SETTING_FIRST},
+	{863, setting_ocpp_authorization_key, CLOUD_SETTING_FIRST},
+	{864, NULL, CLOUD_SETTING_FIRST}, // Applied with 863
+};
+
+#define CLOUD_SETTING_COUNT (sizeof(cloud_settings) / sizeof(cloud_settings[0]))
+
+static const cJSON * setting_value(struct cloud_settings_context * context, int id)
+{
+	int index = cloud_settings_find(cloud_settings, CLOUD_SETTING_COUNT, id);
+	return (index >= 0) ? context->values[index] : NULL;
+}
 
+static bool apply_cloud_settings(struct cloud_settings_context * context, bool first)
+{
+	bool doSave = false;
 
-			if(valueString != NULL)
-			{
-				char chargerName[DEFAULT_STR_SIZE] = {0};
+	for(size_t i = 0; i < CLOUD_SETTING_COUNT; i++)
+	{
+		if(context->values[i] == NULL || cloud_settings[i].apply == NULL)
+			continue;
 
-				//Ensure string is not longer than buffer
-				if(strlen(valueString) < DEFAULT_STR_SIZE)
-					strcpy(chargerName, valueString);
+		if(((cloud_settings[i].flags & CLOUD_SETTING_FIRST) != 0) != first)
+			continue;
 
-				int nameLen = strlen(chargerName);
-				if(nameLen < DEFAULT_STR_SIZE)
-				{
-					int cmpResult = strcmp(chargerName, storage_Get_ChargerName());
-					if(cmpResult != 0)
-					{
-						ESP_LOGW(TAG, "New: 802 ChargerName: %s", chargerName);
-						storage_Set_ChargerName(chargerName);
-						doSave = true;
-					}
-					else
-					{
-						ESP_LOGI(TAG, "Old: 802 ChargerName: %s", storage_Get_ChargerName());
-					}
-				}
-			}
-		}
+		if(cloud_settings[i].apply(context->values[i], context))
+			doSave = true;
+	}
+
+	return doSave;
+}
+
+void ParseCloudSettingsFromCloud(char * message, int message_len)
+{
+	if ((message[0] != '{') || (message[message_len-1] != '}'))
+		return;
+
+	ESP_LOGW(TAG, "message: %.*s", message_len, message);
 
-		//Due to this being set to SWAP_COMMUNICATION_MODE in earlier versions up to 0.0.1.22,
-		//diagnosticsMode must never be set as Cloud parameter, only through command.
+	ESP_LOGI(TAG, "***** Start parsing of Cloud settings *****\n");
 
+	cJSON *cloudObject = cJSON_ParseWithLength(message, message_len);
+	cJSON *settings = NULL;
 
-		if(cJSON_HasObjectItem(settings, "805"))
-		{
-			nrOfParameters++;
+	//The settings in the message may start on two different levels, handle both
+	cJSON *desiredObject = cJSON_GetObjectItem(cloudObject, "desired");
+	if(desiredObject != NULL)
+		settings = cJSON_GetObjectItem(desiredObject, "Settings");
+	else
+		settings = cJSON_GetObjectItem(cloudObject, "Settings");
+
+	if(settings != NULL)
+	{
+		const cJSON * values[CLOUD_SETTING_COUNT];
+		int nrOfParameters = cloud_settings_collect(settings, cloud_settings, CLOUD_SETTING_COUNT, values);
+
+		struct cloud_settings_context context = {
+			.values = values,
+			.controller_change = false,
+		};
+
+		enum session_controller old_session_controller = storage_Get_session_controller();
+
+		bool doSave = apply_cloud_settings(&context, true);
 
-			ESP_LOGE(TAG, "#### 805 DiagnosticsMode: DO NOT USE ####");
+		if(context.controller_change){
+			on_controller_change(old_session_controller, storage_Get_session_controller());
+			doSave = true;
 		}
 
+		if(apply_cloud_settings(&context, false))
+			doSave = true;
+
 		ESP_LOGI(TAG, "Received %d parameters", nrOfParameters);
 
 		if(doSave == true)
@@ -1021,15 +1322,14 @@ void ParseCloudSettingsFromCloud(char * message, int message_len)
 		{
 			ESP_LOGI(TAG, "CloudSettings: Nothing to save");
 		}
-
-		if(cloudObject != NULL)
-			cJSON_Delete(cloudObject);
 	}
 
+	cJSON_Delete(cloudObject);
+
 	ESP_LOGI(TAG, "***** End parsing of Cloud settings *****\n");
 }
 
-void ParseLocalSettingsFromCloud(char * message, int message_len)
+void ParseLocalSettingsFromCloud(const char * message, int message_len)
 {
 	if(message_len < 1)
 		return;
@@ -1331,803 +1631,865 @@ void ClearOTADelay()
 static bool blockStartToTestPingReply = false;
 static bool blockPingReply = false;
 
-int ParseCommandFromCloud(esp_mqtt_event_handle_t commandEvent)
+static int command_ping_reply(const struct cloud_method_call * call, char * response, size_t response_size)
 {
 	int responseStatus = 0;
 
-	//Don't spend time in this function, must return from mqtt-event. May need separate process
-	if(strstr(commandEvent->topic, "iothub/methods/POST/1/"))
+	if(blockPingReply)
+	{
+		ESP_LOGW(TAG, "# INCHARGE_PING_REPLY BLOCKED #");
+	}
+	else
 	{
+		ESP_LOGW(TAG, "###### INCHARGE_PING_REPLY ######");
+		offlineHandler_UpdatePingReplyState(PING_REPLY_ONLINE);
+	}
 
-		if(blockPingReply)
-		{
-			ESP_LOGW(TAG, "# INCHARGE_PING_REPLY BLOCKED #");
-		}
-		else
-		{
-			ESP_LOGW(TAG, "###### INCHARGE_PING_REPLY ######");
-			offlineHandler_UpdatePingReplyState(PING_REPLY_ONLINE);
-		}
+	responseStatus = 200;
 
+	return responseStatus;
+}
+
+static int command_restart_esp(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	int responseStatus = 0;
+
+	ESP_LOGI(TAG, "Received \"Restart ESP32\"-command");
+	//Execute delayed in another thread to allow command ack to be sent to cloud
+
+	MessageType ret = MCU_SendCommandId(CommandReset);
+	if(ret == MsgCommandAck)
+	{
+		restartCmdReceived = true;
 		responseStatus = 200;
+		storage_Set_And_Save_DiagnosticsLog("#10 Cloud restart command");
+		ESP_LOGI(TAG, "MCU reset command OK");
 	}
-	else if(strstr(commandEvent->topic, "iothub/methods/POST/102/"))
+	else
 	{
-		ESP_LOGI(TAG, "Received \"Restart ESP32\"-command");
-		//Execute delayed in another thread to allow command ack to be sent to cloud
+		responseStatus = 400;
+		ESP_LOGI(TAG, "MCU reset command FAILED");
+	}
 
-		MessageType ret = MCU_SendCommandId(CommandReset);
-		if(ret == MsgCommandAck)
-		{
-			restartCmdReceived = true;
-			responseStatus = 200;
-			storage_Set_And_Save_DiagnosticsLog("#10 Cloud restart command");
-			ESP_LOGI(TAG, "MCU reset command OK");
-		}
-		else
-		{
-			responseStatus = 400;
-			ESP_LOGI(TAG, "MCU reset command FAILED");
-		}
+	return responseStatus;
+}
+
+static int command_restart_mcu(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	int responseStatus = 0;
+
+	ESP_LOGI(TAG, "Received \"Restart MCU\"-command");
+	MessageType ret = MCU_SendCommandId(CommandReset);
+	if(ret == MsgCommandAck)
+	{
+		responseStatus = 200;
+		ESP_LOGI(TAG, "MCU reset command OK");
 	}
-	else if(strstr(commandEvent->topic, "iothub/methods/POST/103/"))
+	else
 	{
-		ESP_LOGI(TAG, "Received \"Restart MCU\"-command");
-		MessageType ret = MCU_SendCommandId(CommandReset);
-		if(ret == MsgCommandAck)
-		{
-			responseStatus = 200;
-			ESP_LOGI(TAG, "MCU reset command OK");
-		}
-		else
-		{
-			responseStatus = 400;
-			ESP_LOGI(TAG, "MCU reset command FAILED");
-		}
+		responseStatus = 400;
+		ESP_LOGI(TAG, "MCU reset command FAILED");
 	}
 
-	else if(strstr(commandEvent->topic, "iothub/methods/POST/200/"))
-	{
-		ESP_LOGI(TAG, "Received \"UpgradeFirmware\"-command");
+	return responseStatus;
+}
 
-		if(MCU_GetChargeOperatingMode() == CHARGE_OPERATION_STATE_DISCONNECTED)
-		{
+static int command_upgrade_firmware(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	int responseStatus = 0;
 
-			responseStatus = InitiateOTASequence();
-		}
-		else
-		{
-			otaDelayActive = true;
-			responseStatus = 200;
-			ESP_LOGW(TAG, "OTA Delayed start");
-		}
+	ESP_LOGI(TAG, "Received \"UpgradeFirmware\"-command");
 
-	}
-	else if(strstr(commandEvent->topic, "iothub/methods/POST/201/"))
+	if(MCU_GetChargeOperatingMode() == CHARGE_OPERATION_STATE_DISCONNECTED)
 	{
-		ESP_LOGI(TAG, "Received \"UpgradeFirmwareForced\"-command");
 
 		responseStatus = InitiateOTASequence();
-
-		ESP_LOGW(TAG, "OTA forced: %d", responseStatus);
 	}
-	else if(strstr(commandEvent->topic, "iothub/methods/POST/202/"))
+	else
 	{
-		ESP_LOGI(TAG, "Received \"OTA rollback\"-command");
-		ESP_LOGE(TAG, "Active partition: %s", OTAReadRunningPartition());
+		otaDelayActive = true;
+		responseStatus = 200;
+		ESP_LOGW(TAG, "OTA Delayed start");
+	}
+
+	return responseStatus;
+}
 
-		char commandString[commandEvent->data_len+1];
-		commandString[commandEvent->data_len] = '\0';
-		strncpy(commandString, commandEvent->data, commandEvent->data_len);
+static int command_upgrade_firmware_forced(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	int responseStatus = 0;
 
-		if(strstr(commandString, "factory") != NULL)
-			restartCmdReceived = ota_rollback_to_factory();
-		else
-			rollbackCmdReceived = true;
+	ESP_LOGI(TAG, "Received \"UpgradeFirmwareForced\"-command");
+
+	responseStatus = InitiateOTASequence();
+
+	ESP_LOGW(TAG, "OTA forced: %d", responseStatus);
+
+	return responseStatus;
+}
+
+static int command_ota_rollback(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	int responseStatus = 0;
+
+	ESP_LOGI(TAG, "Received \"OTA rollback\"-command");
+	ESP_LOGE(TAG, "Active partition: %s", OTAReadRunningPartition());
+
+	char commandString[call->data_len+1];
+	commandString[call->data_len] = '\0';
+	strncpy(commandString, call->data, call->data_len);
+
+	if(strstr(commandString, "factory") != NULL)
+		restartCmdReceived = ota_rollback_to_factory();
+	else
+		rollbackCmdReceived = true;
 
+	responseStatus = 200;
+
+	return responseStatus;
+}
+
+static int command_start_charging(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	int responseStatus = 0;
+
+	if(blockStartToTestPingReply == true)
+	{
 		responseStatus = 200;
+		return responseStatus;
 	}
-	else if(strstr(commandEvent->topic, "iothub/methods/POST/501/"))
-	{
-		if(blockStartToTestPingReply == true)
-		{
-			responseStatus = 200;
-			return responseStatus;
-		}
 
 
-		//return 200; //For testing offline resendRequestTimer in system mode
-		//rDATA=["16","4"]
-		char commandString[commandEvent->data_len+1];
-		//char commandString[20] = {0};
-		commandString[commandEvent->data_len] = '\0';
-		strncpy(commandString, commandEvent->data, commandEvent->data_len);
+	//return 200; //For testing offline resendRequestTimer in system mode
+	//rDATA=["16","4"]
+	char commandString[call->data_len+1];
+	//char commandString[20] = {0};
+	commandString[call->data_len] = '\0';
+	strncpy(commandString, call->data, call->data_len);
 
-		//Replace apostrophe with space for sscanf() to work
-		for (int i = 0; i < commandEvent->data_len; i++)
-		{
-			if(commandString[i] == '"')
-				commandString[i] = ' ';
-		}
+	//Replace apostrophe with space for sscanf() to work
+	for (int i = 0; i < call->data_len; i++)
+	{
+		if(commandString[i] == '"')
+			commandString[i] = ' ';
+	}
 
-		float currentFromCloud = 0;
-		int phaseFromCloud = 0;
-		sscanf(commandString,"%*s%f%*s%d%*s", &currentFromCloud, &phaseFromCloud);
+	float currentFromCloud = 0;
+	int phaseFromCloud = 0;
+	sscanf(commandString,"%*s%f%*s%d%*s", &currentFromCloud, &phaseFromCloud);
 
-		if((32 >= currentFromCloud) && (currentFromCloud >= 0))
+	if((32 >= currentFromCloud) && (currentFromCloud >= 0))
+	{
+		//Ensure that when a cloud start command is received, the offlineCurrentSent flag must be cleared
+		//to allow a offline current to be resent in case we go offline multiple times.
+		offlineHandler_ClearOfflineCurrentSent();
+		MessageType ret = MCU_SendFloatParameter(ParamChargeCurrentUserMax, currentFromCloud);
+		if(ret == MsgWriteAck)
 		{
-			//Ensure that when a cloud start command is received, the offlineCurrentSent flag must be cleared
-			//to allow a offline current to be resent in case we go offline multiple times.
-			offlineHandler_ClearOfflineCurrentSent();
-			MessageType ret = MCU_SendFloatParameter(ParamChargeCurrentUserMax, currentFromCloud);
-			if(ret == MsgWriteAck)
-			{
-				responseStatus = 200;
-				ESP_LOGW(TAG, "Charge Start from Cloud: %f PhaseId: %d \n", currentFromCloud, phaseFromCloud);
+			responseStatus = 200;
+			ESP_LOGW(TAG, "Charge Start from Cloud: %f PhaseId: %d \n", currentFromCloud, phaseFromCloud);
 
-				bool isSent = chargeController_SendStartCommandToMCU(eCHARGE_SOURCE_CLOUD);
-				//MessageType ret = MCU_SendCommandId(CommandStartCharging);
-				if(isSent)
-				{
-					//ESP_LOGI(TAG, "MCU Start command OK");
+			bool isSent = chargeController_SendStartCommandToMCU(eCHARGE_SOURCE_CLOUD);
+			//MessageType ret = MCU_SendCommandId(CommandStartCharging);
+			if(isSent)
+			{
+				//ESP_LOGI(TAG, "MCU Start command OK");
 
-					HOLD_SetPhases(phaseFromCloud);
-					sessionHandler_HoldParametersFromCloud(currentFromCloud, phaseFromCloud);
+				HOLD_SetPhases(phaseFromCloud);
+				sessionHandler_HoldParametersFromCloud(currentFromCloud, phaseFromCloud);
 
-					responseStatus = 200;
-				}
-				else
-				{
-					responseStatus = 400;
-					//ESP_LOGI(TAG, "MCU Start command FAILED");
-				}
+				responseStatus = 200;
 			}
 			else
 			{
 				responseStatus = 400;
-				ESP_LOGE(TAG, "MCU Start command FAILED");
+				//ESP_LOGI(TAG, "MCU Start command FAILED");
 			}
 		}
 		else
 		{
 			responseStatus = 400;
-			ESP_LOGE(TAG, "Start command with invalid current");
+			ESP_LOGE(TAG, "MCU Start command FAILED");
 		}
 	}
-	//Stop charging command
-	else if(strstr(commandEvent->topic, "iothub/methods/POST/502/"))
+	else
 	{
-		ESP_LOGE(TAG, "MCU Stop");
-
-		//rDATA=null
-		MessageType ret = MCU_SendCommandId(CommandStopCharging);
-		if(ret == MsgCommandAck)
-		{
-			responseStatus = 200;
-			ESP_LOGI(TAG, "MCU Stop command OK");
-		}
-		else
-		{
-			responseStatus = 400;
-			ESP_LOGE(TAG, "MCU Stop command FAILED");
-		}
+		responseStatus = 400;
+		ESP_LOGE(TAG, "Start command with invalid current");
 	}
 
-	else if(strstr(commandEvent->topic, "iothub/methods/POST/503/"))
+	return responseStatus;
+}
+
+//Stop charging command
+static int command_stop_charging(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	int responseStatus = 0;
+
+	ESP_LOGE(TAG, "MCU Stop");
+
+	//rDATA=null
+	MessageType ret = MCU_SendCommandId(CommandStopCharging);
+	if(ret == MsgCommandAck)
 	{
-		ESP_LOGI(TAG, "Received \"ReportChargingState\"-command");
-		ClearStartupSent();				//Trig resend of general and local settings
-		cloudSettingsAreUpdated = true; //Trig resend of cloud parameters
 		responseStatus = 200;
+		ESP_LOGI(TAG, "MCU Stop command OK");
 	}
-	/// SetSessionId
-	else if(strstr(commandEvent->topic, "iothub/methods/POST/504/"))
+	else
 	{
-		//rTOPIC=$iothub/methods/POST/504/?$rid=1
-		//rDATA=["806b2f4e-54e1-4913-aa90-376e14daedba"]
+		responseStatus = 400;
+		ESP_LOGE(TAG, "MCU Stop command FAILED");
+	}
+
+	return responseStatus;
+}
+
+static int command_report_charging_state(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	int responseStatus = 0;
 
-		//Suport null, [null] and "" formatting of empty session
-		ESP_LOGW(TAG, "504: Len: %d, %s", commandEvent->data_len, commandEvent->data);
-		if(((commandEvent->data_len == 2) && (strncmp(commandEvent->data, "\"\"", 2) == 0)) ||
-			((commandEvent->data_len == 4) && (strncmp(commandEvent->data, "[\"\"]", 4) == 0)))
+	ESP_LOGI(TAG, "Received \"ReportChargingState\"-command");
+	ClearStartupSent();				//Trig resend of general and local settings
+	cloudSettingsAreUpdated = true; //Trig resend of cloud parameters
+	responseStatus = 200;
+
+	return responseStatus;
+}
+
+/// SetSessionId
+static int command_set_session_id(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	int responseStatus = 0;
+
+	//rTOPIC=$iothub/methods/POST/504/?$rid=1
+	//rDATA=["806b2f4e-54e1-4913-aa90-376e14daedba"]
+
+	//Suport null, [null] and "" formatting of empty session
+	ESP_LOGW(TAG, "504: Len: %d, %s", call->data_len, call->data);
+	if(((call->data_len == 2) && (strncmp(call->data, "\"\"", 2) == 0)) ||
+		((call->data_len == 4) && (strncmp(call->data, "[\"\"]", 4) == 0)))
+	{
+		if((storage_Get_Standalone() == 0))
 		{
-			if((storage_Get_Standalone() == 0))
-			{
-				sessionHandler_InitiateResetChargeSession();
-				chargeSession_HoldUserUUID();
-			}
-			return 200;
+			sessionHandler_InitiateResetChargeSession();
+			chargeSession_HoldUserUUID();
 		}
+		return 200;
+	}
 
 
-		if(commandEvent->data_len < 40)
-		{
+	if(call->data_len < 40)
+	{
 
-			if(strncmp(commandEvent->data, "[null]",commandEvent->data_len) == 0)
-			{
-				ESP_LOGE(TAG, "No session");
-				return 400;
-			}
-			else
-			{
-				ESP_LOGE(TAG, "Too short SessionId received from cloud");
-				return -1;
-			}
+		if(strncmp(call->data, "[null]",call->data_len) == 0)
+		{
+			ESP_LOGE(TAG, "No session");
+			return 400;
+		}
+		else
+		{
+			ESP_LOGE(TAG, "Too short SessionId received from cloud");
+			return -1;
 		}
+	}
 
-		if ((commandEvent->data[0] != '[') || (commandEvent->data[commandEvent->data_len-1] != ']'))
-			return -2;
+	if ((call->data[0] != '[') || (call->data[call->data_len-1] != ']'))
+		return -2;
 
-		char sessionIdString[commandEvent->data_len];
-		strncpy(sessionIdString, commandEvent->data+2, commandEvent->data_len-4);
-		sessionIdString[commandEvent->data_len-4] = '\0';
+	char sessionIdString[call->data_len];
+	strncpy(sessionIdString, call->data+2, call->data_len-4);
+	sessionIdString[call->data_len-4] = '\0';
 
-		//ESP_LOGI(TAG, "SessionId: %s , len: %d\n", sessionIdString, strlen(sessionIdString));
-		int8_t ret = chargeSession_SetSessionIdFromCloud(sessionIdString);
+	//ESP_LOGI(TAG, "SessionId: %s , len: %d\n", sessionIdString, strlen(sessionIdString));
+	int8_t ret = chargeSession_SetSessionIdFromCloud(sessionIdString);
 
-		//If SessionId has been set before, check if Cloud needs an update of chargerOperatingMode
-		if(ret == 1)
-			ChargeModeUpdateToCloudNeeded();
+	//If SessionId has been set before, check if Cloud needs an update of chargerOperatingMode
+	if(ret == 1)
+		ChargeModeUpdateToCloudNeeded();
 
-		//Return error if the Session was received with no car connected. Can happen in race-condition with short connect-disconnect
-		if(ret == -1)
-			responseStatus = 400;
-		else
-			responseStatus = 200;
-	}
-	/// SetUserUuid
-	else if(strstr(commandEvent->topic, "iothub/methods/POST/505/"))
-	{
-		//rTOPIC=$iothub/methods/POST/504/?$rid=1
-		//rDATA=["806b2f4e-54e1-4913-aa90-376e14daedba"]
+	//Return error if the Session was received with no car connected. Can happen in race-condition with short connect-disconnect
+	if(ret == -1)
+		responseStatus = 400;
+	else
+		responseStatus = 200;
+
+	return responseStatus;
+}
+
+/// SetUserUuid
+static int command_set_user_uuid(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	int responseStatus = 0;
 
-		//sessionHandler_InitiateResetChargeSession();
+	//rTOPIC=$iothub/methods/POST/504/?$rid=1
+	//rDATA=["806b2f4e-54e1-4913-aa90-376e14daedba"]
 
-		//Clear user UUID
-		//if((storage_Get_AuthenticationRequired() == 1) && (storage_Get_Standalone() == 0))//Only in system mode
-		if((storage_Get_Standalone() == 0))//Only in system mode
+	//sessionHandler_InitiateResetChargeSession();
+
+	//Clear user UUID
+	//if((storage_Get_AuthenticationRequired() == 1) && (storage_Get_Standalone() == 0))//Only in system mode
+	if((storage_Get_Standalone() == 0))//Only in system mode
+	{
+		///Check for cleared userUUID command [""]
+		ESP_LOGW(TAG, "505: Len: %d, %s", call->data_len, call->data);
+		if(((call->data_len == 2) && (strncmp(call->data, "\"\"", 2) == 0)) ||
+			((call->data_len == 4) && (strncmp(call->data, "[\"\"]", 4) == 0)))
 		{
-			///Check for cleared userUUID command [""]
-			ESP_LOGW(TAG, "505: Len: %d, %s", commandEvent->data_len, commandEvent->data);
-			if(((commandEvent->data_len == 2) && (strncmp(commandEvent->data, "\"\"", 2) == 0)) ||
-				((commandEvent->data_len == 4) && (strncmp(commandEvent->data, "[\"\"]", 4) == 0)))
+			if((storage_Get_Standalone() == 0))
 			{
-				if((storage_Get_Standalone() == 0))
-				{
-					//Clear session
-					SetUUIDFlagAsCleared();
-					sessionHandler_InitiateResetChargeSession();
-				}
-				return 200;
+				//Clear session
+				SetUUIDFlagAsCleared();
+				sessionHandler_InitiateResetChargeSession();
 			}
+			return 200;
+		}
 
-			else if((commandEvent->data_len > 4) && (commandEvent->data_len < 37)) //Auth code length limit
+		else if((call->data_len > 4) && (call->data_len < 37)) //Auth code length limit
+		{
+			if((chargeSession_Get().SessionId[0] != '\0') && (storage_Get_AuthenticationRequired() == 1))
 			{
-				if((chargeSession_Get().SessionId[0] != '\0') && (storage_Get_AuthenticationRequired() == 1))
+				char newAuthCode[37] = {0};
+				strncpy(newAuthCode, &call->data[2], call->data_len-4);
+				MessageType ret = MCU_SendCommandId(CommandAuthorizationGranted);
+				if(ret == MsgCommandAck)
 				{
-					char newAuthCode[37] = {0};
-					strncpy(newAuthCode, &commandEvent->data[2], commandEvent->data_len-4);
-					MessageType ret = MCU_SendCommandId(CommandAuthorizationGranted);
-					if(ret == MsgCommandAck)
-					{
-						//chargeSession_SetAuthenticationCode(newAuthCode);
-						SetPendingRFIDTag(newAuthCode);
-						SetAuthorized(true);
-						publish_debug_telemetry_observation_NFC_tag_id(newAuthCode);
-						publish_debug_telemetry_observation_ChargingStateParameters();
-						ESP_LOGI(TAG, "MCU AuthorizationGranted command OK");
-						return 200;
-					}
-					else
-					{
-						ESP_LOGE(TAG, "MCU AuthorizationGranted command FAILED");
-						return 400;
-					}
+					//chargeSession_SetAuthenticationCode(newAuthCode);
+					SetPendingRFIDTag(newAuthCode);
+					SetAuthorized(true);
+					publish_debug_telemetry_observation_NFC_tag_id(newAuthCode);
+					publish_debug_telemetry_observation_ChargingStateParameters();
+					ESP_LOGI(TAG, "MCU AuthorizationGranted command OK");
+					return 200;
 				}
 				else
 				{
+					ESP_LOGE(TAG, "MCU AuthorizationGranted command FAILED");
 					return 400;
 				}
 			}
-		}
-		else
-		{
-			return 400;
+			else
+			{
+				return 400;
+			}
 		}
 	}
-
-	//StopChargingFinal = 506
-	else if(strstr(commandEvent->topic, "iothub/methods/POST/506/"))
+	else
 	{
-		MessageType ret = MCU_SendCommandId(CommandStopChargingFinal);// = 508
-		if(ret == MsgCommandAck)
-		{
-			responseStatus = 200;
-			ESP_LOGI(TAG, "MCU CommandStopChargingFinal command OK");
-			SetFinalStopActiveStatus(1);
-			chargeController_CancelOverride();
-			chargeController_SetPauseByCloudCommand(true);
-		}
-		else
-		{
-			responseStatus = 400;
-			ESP_LOGI(TAG, "MCU CommandStopChargingFinal command FAILED");
-		}
+		return 400;
 	}
 
-	//ResumeCharging = 507
-	else if(strstr(commandEvent->topic, "iothub/methods/POST/507/"))
-	{
-		//ESP_LOGI(TAG, "Charging denied!");
-		MessageType ret = MCU_SendCommandId(CommandResumeChargingMCU);// = 509
-		if(ret == MsgCommandAck)
-		{
-			responseStatus = 200;
-			ESP_LOGI(TAG, "MCU CommandResumeChargingMCU command OK");
-			SetFinalStopActiveStatus(0);
-			sessionHandler_ClearCarInterfaceResetConditions();
-			chargeController_Override();
-			chargeController_SetPauseByCloudCommand(false);
+	return responseStatus;
+}
+
+//StopChargingFinal = 506
+static int command_stop_charging_final(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	int responseStatus = 0;
+
+	MessageType ret = MCU_SendCommandId(CommandStopChargingFinal);// = 508
+	if(ret == MsgCommandAck)
+	{
+		responseStatus = 200;
+		ESP_LOGI(TAG, "MCU CommandStopChargingFinal command OK");
+		SetFinalStopActiveStatus(1);
+		chargeController_CancelOverride();
+		chargeController_SetPauseByCloudCommand(true);
+	}
+	else
+	{
+		responseStatus = 400;
+		ESP_LOGI(TAG, "MCU CommandStopChargingFinal command FAILED");
+	}
+
+	return responseStatus;
+}
+
+//ResumeCharging = 507
+static int command_resume_charging(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	int responseStatus = 0;
+
+	//ESP_LOGI(TAG, "Charging denied!");
+	MessageType ret = MCU_SendCommandId(CommandResumeChargingMCU);// = 509
+	if(ret == MsgCommandAck)
+	{
+		responseStatus = 200;
+		ESP_LOGI(TAG, "MCU CommandResumeChargingMCU command OK");
+		SetFinalStopActiveStatus(0);
+		sessionHandler_ClearCarInterfaceResetConditions();
+		chargeController_Override();
+		chargeController_SetPauseByCloudCommand(false);
+	}
+	else
+	{
+		responseStatus = 400;
+		ESP_LOGI(TAG, "MCU CommandResumeChargingMCU command FAILED");
+	}
+
+	return responseStatus;
+}
+
+static int command_grant_charging(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	int responseStatus = 0;
+
+	//ESP_LOGI(TAG, "Charging granted!");
+	//Only in system mode
+	if(storage_Get_Standalone() == 0)
+	{
+		MessageType ret = MCU_SendCommandId(CommandAuthorizationGranted);
+		if(ret == MsgCommandAck)
+		{
+			responseStatus = 200;
+			SetAuthorized(true);
+			ESP_LOGI(TAG, "MCU Granted command OK");
 		}
 		else
 		{
 			responseStatus = 400;
-			ESP_LOGI(TAG, "MCU CommandResumeChargingMCU command FAILED");
+			ESP_LOGI(TAG, "MCU Granted command FAILED");
 		}
 	}
+	else
+	{
+		ESP_LOGI(TAG, "Granted from Cloud in standalone");
+		responseStatus = 200; //For standalone - don't do anything, just return this responseStatus to make the cloud happy
+	}
+
+	return responseStatus;
+}
+
+static int command_deny_charging(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	int responseStatus = 0;
 
-	else if(strstr(commandEvent->topic, "iothub/methods/POST/601/"))
+	//ESP_LOGI(TAG, "Charging denied!");
+	//Only in system mode
+	if(storage_Get_Standalone() == 0)
 	{
-		//ESP_LOGI(TAG, "Charging granted!");
-		//Only in system mode
-		if(storage_Get_Standalone() == 0)
+
+		MessageType ret = MCU_SendUint8Parameter(ParamAuthState, SESSION_NOT_AUTHORIZED);
+		if(ret == MsgWriteAck)
 		{
-			MessageType ret = MCU_SendCommandId(CommandAuthorizationGranted);
-			if(ret == MsgCommandAck)
-			{
-				responseStatus = 200;
-				SetAuthorized(true);
-				ESP_LOGI(TAG, "MCU Granted command OK");
-			}
-			else
-			{
-				responseStatus = 400;
-				ESP_LOGI(TAG, "MCU Granted command FAILED");
-			}
+			ESP_LOGI(TAG, "Ack on SESSION_NOT_AUTHORIZED");
 		}
 		else
 		{
-			ESP_LOGI(TAG, "Granted from Cloud in standalone");
-			responseStatus = 200; //For standalone - don't do anything, just return this responseStatus to make the cloud happy
+			ESP_LOGE(TAG, "NACK on SESSION_NOT_AUTHORIZED");
 		}
-	}
-	else if(strstr(commandEvent->topic, "iothub/methods/POST/602/"))
-	{
-		//ESP_LOGI(TAG, "Charging denied!");
-		//Only in system mode
-		if(storage_Get_Standalone() == 0)
-		{
-
-			MessageType ret = MCU_SendUint8Parameter(ParamAuthState, SESSION_NOT_AUTHORIZED);
-			if(ret == MsgWriteAck)
-			{
-				ESP_LOGI(TAG, "Ack on SESSION_NOT_AUTHORIZED");
-			}
-			else
-			{
-				ESP_LOGE(TAG, "NACK on SESSION_NOT_AUTHORIZED");
-			}
 
-			ret = MCU_SendCommandId(CommandAuthorizationDenied);
-			if(ret == MsgCommandAck)
-			{
-				responseStatus = 200;
-				SetAuthorized(false);
-				ESP_LOGI(TAG, "MCU Granted command OK");
-			}
-			else
-			{
-				responseStatus = 400;
-				ESP_LOGI(TAG, "MCU Granted command FAILED");
-			}
+		ret = MCU_SendCommandId(CommandAuthorizationDenied);
+		if(ret == MsgCommandAck)
+		{
+			responseStatus = 200;
+			SetAuthorized(false);
+			ESP_LOGI(TAG, "MCU Granted command OK");
 		}
 		else
 		{
 			responseStatus = 400;
+			ESP_LOGI(TAG, "MCU Granted command FAILED");
 		}
 	}
-	else if(strstr(commandEvent->topic, "iothub/methods/POST/750/"))
+	else
 	{
-		rfidPairing_SetState(ePairing_AddedOk);
-		ESP_LOGW(TAG, "Command NFC pairing OK");
-		responseStatus = 200;
+		responseStatus = 400;
 	}
-	else if(strstr(commandEvent->topic, "iothub/methods/POST/800/"))
+
+	return responseStatus;
+}
+
+static int command_nfc_pairing_ok(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	int responseStatus = 0;
+
+	rfidPairing_SetState(ePairing_AddedOk);
+	ESP_LOGW(TAG, "Command NFC pairing OK");
+	responseStatus = 200;
+
+	return responseStatus;
+}
+
+static int command_debug(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	int responseStatus = 0;
+
+	if(call->data_len > 4)
 	{
+		// Ensure to use a string with proper ending
+		char commandString[call->data_len+1];
+		commandString[call->data_len] = '\0';
+		strncpy(commandString, call->data, call->data_len);
+
+		ESP_LOGI(TAG, "Debug command: %s", commandString);
 
-		if(commandEvent->data_len > 4)
+		//DiagnosticsModes
+		if(strstr(commandString,"DiagnosticsMode 0") != NULL)
 		{
-			// Ensure to use a string with proper ending
-			char commandString[commandEvent->data_len+1];
-			commandString[commandEvent->data_len] = '\0';
-			strncpy(commandString, commandEvent->data, commandEvent->data_len);
+			storage_Set_DiagnosticsMode(eCLEAR_DIAGNOSTICS_MODE);
+			storage_SaveConfiguration();
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"DiagnosticsMode 1") != NULL)
+		{
+			storage_Set_DiagnosticsMode(eNFC_ERROR_COUNT);
+			storage_SaveConfiguration();
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"DiagnosticsMode 6") != NULL)
+		{
+			storage_Set_DiagnosticsMode(eDISABLE_CERTIFICATE_ONCE);
+			storage_SaveConfiguration();
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"DiagnosticsMode 7") != NULL)
+		{
+			storage_Set_DiagnosticsMode(eDISABLE_CERTIFICATE_ALWAYS);
+			storage_SaveConfiguration();
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"Restart ESP") != NULL)
+		{
+			restartCmdReceived = true;
 
-			ESP_LOGI(TAG, "Debug command: %s", commandString);
+			storage_Set_And_Save_DiagnosticsLog("#11 Cloud Restart ESP command");
+			responseStatus = 200;
+		}
 
-			//DiagnosticsModes
-			if(strstr(commandString,"DiagnosticsMode 0") != NULL)
-			{
-				storage_Set_DiagnosticsMode(eCLEAR_DIAGNOSTICS_MODE);
-				storage_SaveConfiguration();
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"DiagnosticsMode 1") != NULL)
-			{
-				storage_Set_DiagnosticsMode(eNFC_ERROR_COUNT);
-				storage_SaveConfiguration();
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"DiagnosticsMode 6") != NULL)
-			{
-				storage_Set_DiagnosticsMode(eDISABLE_CERTIFICATE_ONCE);
-				storage_SaveConfiguration();
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"DiagnosticsMode 7") != NULL)
+		// Connectivity
+		else if(strstr(commandString,"Set LTE") != NULL)
+		{
+			storage_Set_CommunicationMode(eCONNECTION_LTE);
+			storage_SaveConfiguration();
+			ESP_LOGI(TAG, "Restarting on LTE");
+			restartCmdReceived = true;
+			responseStatus = 200;
+			//esp_restart();
+		}
+		else if(strstr(commandString,"Set Wifi") != NULL)
+		{
+			if(network_CheckWifiParameters())
 			{
-				storage_Set_DiagnosticsMode(eDISABLE_CERTIFICATE_ALWAYS);
+				storage_Set_CommunicationMode(eCONNECTION_WIFI);
 				storage_SaveConfiguration();
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"Restart ESP") != NULL)
-			{
-				restartCmdReceived = true;
 
-				storage_Set_And_Save_DiagnosticsLog("#11 Cloud Restart ESP command");
-				responseStatus = 200;
-			}
-
-			// Connectivity
-			else if(strstr(commandString,"Set LTE") != NULL)
-			{
-				storage_Set_CommunicationMode(eCONNECTION_LTE);
-				storage_SaveConfiguration();
-				ESP_LOGI(TAG, "Restarting on LTE");
+				ESP_LOGI(TAG, "Restarting on Wifi");
 				restartCmdReceived = true;
 				responseStatus = 200;
 				//esp_restart();
 			}
-			else if(strstr(commandString,"Set Wifi") != NULL)
+			else
 			{
-				if(network_CheckWifiParameters())
-				{
-					storage_Set_CommunicationMode(eCONNECTION_WIFI);
-					storage_SaveConfiguration();
-
-					ESP_LOGI(TAG, "Restarting on Wifi");
-					restartCmdReceived = true;
-					responseStatus = 200;
-					//esp_restart();
-				}
-				else
-				{
-					ESP_LOGI(TAG, "No valid Wifi parameters");
-				}
+				ESP_LOGI(TAG, "No valid Wifi parameters");
 			}
-			else if(strstr(commandString,"Clear Wifi") != NULL)
-			{
-				storage_clearWifiParameters();
+		}
+		else if(strstr(commandString,"Clear Wifi") != NULL)
+		{
+			storage_clearWifiParameters();
 
-				ESP_LOGI(TAG, "Cleared Wifi parameters");
-				responseStatus = 200;
-			}
+			ESP_LOGI(TAG, "Cleared Wifi parameters");
+			responseStatus = 200;
+		}
 
 
-			// Configuration reset
-			else if(strstr(commandString,"Configuration reset") != NULL)
-			{
-				responseStatus = 400;
+		// Configuration reset
+		else if(strstr(commandString,"Configuration reset") != NULL)
+		{
+			responseStatus = 400;
 
-				MessageType ret = MCU_SendFloatParameter(StandAloneCurrent, 0.0);
+			MessageType ret = MCU_SendFloatParameter(StandAloneCurrent, 0.0);
+			if(ret == MsgWriteAck)
+			{
+				MessageType ret = MCU_SendFloatParameter(ChargeCurrentInstallationMaxLimit, 0.0);
 				if(ret == MsgWriteAck)
 				{
-					MessageType ret = MCU_SendFloatParameter(ChargeCurrentInstallationMaxLimit, 0.0);
-					if(ret == MsgWriteAck)
-					{
-						storage_Init_Configuration();
-						storage_SaveConfiguration();
-						responseStatus = 200;
-					}
+					storage_Init_Configuration();
+					storage_SaveConfiguration();
+					responseStatus = 200;
 				}
-
-				ESP_LOGI(TAG, "Configuration reset");
 			}
 
+			ESP_LOGI(TAG, "Configuration reset");
+		}
+
 
-			// Installation reset
-			else if(strstr(commandString,"Installation reset") != NULL)
-			{
-				responseStatus = 400;
+		// Installation reset
+		else if(strstr(commandString,"Installation reset") != NULL)
+		{
+			responseStatus = 400;
 
-				MessageType ret = MCU_SendFloatParameter(StandAloneCurrent, 0.0);
+			MessageType ret = MCU_SendFloatParameter(StandAloneCurrent, 0.0);
+			if(ret == MsgWriteAck)
+			{
+				MessageType ret = MCU_SendFloatParameter(ChargeCurrentInstallationMaxLimit, 0.0);
 				if(ret == MsgWriteAck)
 				{
-					MessageType ret = MCU_SendFloatParameter(ChargeCurrentInstallationMaxLimit, 0.0);
-					if(ret == MsgWriteAck)
-					{
-						storage_Set_StandaloneCurrent(6.0);
-						storage_Set_MaxInstallationCurrentConfig(0.0);
-						storage_Set_PhaseRotation(0);
-						storage_SaveConfiguration();
-						ESP_LOGI(TAG, "Installation reset");
-						responseStatus = 200;
-					}
+					storage_Set_StandaloneCurrent(6.0);
+					storage_Set_MaxInstallationCurrentConfig(0.0);
+					storage_Set_PhaseRotation(0);
+					storage_SaveConfiguration();
+					ESP_LOGI(TAG, "Installation reset");
+					responseStatus = 200;
 				}
 			}
+		}
 
 
-			// Factory reset
-			else if(strstr(commandString,"Factory reset") != NULL)
-			{
-				MessageType ret = MCU_SendUint8Parameter(CommandFactoryReset, 0);
-				if(ret == MsgWriteAck) {
+		// Factory reset
+		else if(strstr(commandString,"Factory reset") != NULL)
+		{
+			MessageType ret = MCU_SendUint8Parameter(CommandFactoryReset, 0);
+			if(ret == MsgWriteAck) {
 
-					ESP_LOGI(TAG, "MCU Factory Reset OK");
-					if(strstr(commandString,"Factory reset keep wifi") != NULL)
-					{
-						uint8_t comMode = storage_Get_CommunicationMode();
+				ESP_LOGI(TAG, "MCU Factory Reset OK");
+				if(strstr(commandString,"Factory reset keep wifi") != NULL)
+				{
+					uint8_t comMode = storage_Get_CommunicationMode();
 
-						//Not clearing wifi
-						storage_clearAllRFIDTagsOnFile();
-						storage_Init_Configuration();
+					//Not clearing wifi
+					storage_clearAllRFIDTagsOnFile();
+					storage_Init_Configuration();
 
-						if(comMode == eCONNECTION_WIFI)
-							storage_Set_CommunicationMode(eCONNECTION_WIFI);
+					if(comMode == eCONNECTION_WIFI)
+						storage_Set_CommunicationMode(eCONNECTION_WIFI);
 
-						storage_SaveConfiguration();
-						responseStatus = 200;
-						ESP_LOGI(TAG, "Factory reset keep wifi complete");
-					}
-					else
-					{
-						storage_clearAllRFIDTagsOnFile();
-						storage_clearWifiParameters();
-						storage_Init_Configuration();
-						storage_SaveConfiguration();
-						responseStatus = 200;
-						ESP_LOGI(TAG, "Factory reset complete");
-					}
+					storage_SaveConfiguration();
+					responseStatus = 200;
+					ESP_LOGI(TAG, "Factory reset keep wifi complete");
 				}
-				else {
-					ESP_LOGE(TAG, "MCU Factory Reset FAILED");
-					responseStatus=400;
+				else
+				{
+					storage_clearAllRFIDTagsOnFile();
+					storage_clearWifiParameters();
+					storage_Init_Configuration();
+					storage_SaveConfiguration();
+					responseStatus = 200;
+					ESP_LOGI(TAG, "Factory reset complete");
 				}
-			}else if(strstr(commandString, "segmentota") != NULL){
+			}
+			else {
+				ESP_LOGE(TAG, "MCU Factory Reset FAILED");
+				responseStatus=400;
+			}
+		}else if(strstr(commandString, "segmentota") != NULL){
 
-				MessageType ret = MCU_SendCommandId(CommandHostFwUpdateStart);
-				if(ret == MsgCommandAck)
-					ESP_LOGI(TAG, "MCU CommandHostFwUpdateStart OK");
-				else
-					ESP_LOGI(TAG, "MCU CommandHostFwUpdateStart FAILED");
+			MessageType ret = MCU_SendCommandId(CommandHostFwUpdateStart);
+			if(ret == MsgCommandAck)
+				ESP_LOGI(TAG, "MCU CommandHostFwUpdateStart OK");
+			else
+				ESP_LOGI(TAG, "MCU CommandHostFwUpdateStart FAILED");
 
-				//start_segmented_ota();
-				start_ota();
-				responseStatus = 200;
-			}else if(strstr(commandString, "multiblockota") != NULL){
+			//start_segmented_ota();
+			start_ota();
+			responseStatus = 200;
+		}else if(strstr(commandString, "multiblockota") != NULL){
 
-				MessageType ret = MCU_SendCommandId(CommandHostFwUpdateStart);
-				if(ret == MsgCommandAck)
-					ESP_LOGI(TAG, "MCU CommandHostFwUpdateStart OK");
-				else
-					ESP_LOGI(TAG, "MCU CommandHostFwUpdateStart FAILED");
+			MessageType ret = MCU_SendCommandId(CommandHostFwUpdateStart);
+			if(ret == MsgCommandAck)
+				ESP_LOGI(TAG, "MCU CommandHostFwUpdateStart OK");
+			else
+				ESP_LOGI(TAG, "MCU CommandHostFwUpdateStart FAILED");
 
-				start_segmented_ota();
-				responseStatus = 200;
-			}
+			start_segmented_ota();
+			responseStatus = 200;
+		}
 
 
-			// Logging interval, with space expects number in seconds: "LogInterval 60". This is not yet saved.
-			else if(strstr(commandString,"LogInterval ") != NULL)
-			{
-				char *endptr;
-				uint32_t interval = (uint32_t)strtol(commandString+14, &endptr, 10);
-				if(((86400 >= interval) && (interval > 10)) || (interval == 0))
-				{
-					//SetDataInterval(interval);
-					storage_Set_TransmitInterval(interval);
-					storage_SaveConfiguration();
-					ESP_LOGI(TAG, "Setting LogInterval %" PRIu32, interval);
-					responseStatus = 200;
-				}
-				else
-				{
-					responseStatus = 400;
-				}
-			}
-			// Logging interval
-			/*else if(strstr(commandString,"LogInterval") != NULL)
+		// Logging interval, with space expects number in seconds: "LogInterval 60". This is not yet saved.
+		else if(strstr(commandString,"LogInterval ") != NULL)
+		{
+			char *endptr;
+			uint32_t interval = (uint32_t)strtol(commandString+14, &endptr, 10);
+			if(((86400 >= interval) && (interval > 10)) || (interval == 0))
 			{
-				//SetDataInterval(0);
-				storage_Set_TransmitInterval(3600);
-				ESP_LOGI(TAG, "Using default LogInterval");
+				//SetDataInterval(interval);
+				storage_Set_TransmitInterval(interval);
+				storage_SaveConfiguration();
+				ESP_LOGI(TAG, "Setting LogInterval %" PRIu32, interval);
 				responseStatus = 200;
-			}*/
-			else if(strstr(commandString,"ClearServoCalibration") != NULL)
-			{
-				ESP_LOGI(TAG, "ClearServoCalibration");
-				MessageType ret = MCU_SendCommandId(CommandServoClearCalibration);
-				if(ret == MsgCommandAck)
-				{
-					responseStatus = 200;
-					ESP_LOGI(TAG, "MCU cleared servo");
-				}
-				else
-				{
-					responseStatus = 400;
-					ESP_LOGI(TAG, "MCU servo clear FAILED");
-				}
 			}
-			else if(strstr(commandString,"Unlock") != NULL)
+			else
 			{
-				MCU_SendCommandServoForceUnlock();
+				responseStatus = 400;
 			}
-
-			// Update certificate (without clearing old directly)
-			else if(strstr(commandString,"Update certificate") != NULL)
+		}
+		// Logging interval
+		/*else if(strstr(commandString,"LogInterval") != NULL)
+		{
+			//SetDataInterval(0);
+			storage_Set_TransmitInterval(3600);
+			ESP_LOGI(TAG, "Using default LogInterval");
+			responseStatus = 200;
+		}*/
+		else if(strstr(commandString,"ClearServoCalibration") != NULL)
+		{
+			ESP_LOGI(TAG, "ClearServoCalibration");
+			MessageType ret = MCU_SendCommandId(CommandServoClearCalibration);
+			if(ret == MsgCommandAck)
 			{
-				certifcate_setBundleVersion(0); //Fake old version for test
-				certificate_update(0);
-
-				ESP_LOGI(TAG, "Update certificate");
 				responseStatus = 200;
+				ESP_LOGI(TAG, "MCU cleared servo");
 			}
-			// Clear certificate (results in new update on next start)
-			else if(strstr(commandString,"Clear certificate") != NULL)
+			else
 			{
-				certificate_clear();
-
-				ESP_LOGI(TAG, "Clear certificate");
-				responseStatus = 200;
+				responseStatus = 400;
+				ESP_LOGI(TAG, "MCU servo clear FAILED");
 			}
+		}
+		else if(strstr(commandString,"Unlock") != NULL)
+		{
+			MCU_SendCommandServoForceUnlock();
+		}
 
-			// Set tls error
-			else if(strstr(commandString,"Set tls error") != NULL)
-			{
-				simulateTlsError = true;
+		// Update certificate (without clearing old directly)
+		else if(strstr(commandString,"Update certificate") != NULL)
+		{
+			certifcate_setBundleVersion(0); //Fake old version for test
+			certificate_update(0);
 
-				ESP_LOGI(TAG, "Set tls error");
-				responseStatus = 200;
-			}
+			ESP_LOGI(TAG, "Update certificate");
+			responseStatus = 200;
+		}
+		// Clear certificate (results in new update on next start)
+		else if(strstr(commandString,"Clear certificate") != NULL)
+		{
+			certificate_clear();
 
+			ESP_LOGI(TAG, "Clear certificate");
+			responseStatus = 200;
+		}
 
-			else if(strstr(commandString,"Override ") != NULL)
-			{
-				char *endptr;
-				int overrideVersion = strtol(commandString+11, &endptr, 10);
-				if((1000 > overrideVersion) && (overrideVersion >=0))
-				{
-					certifcate_setOverrideVersion(overrideVersion); //Fake old version for test
-					certificate_update(0);
+		// Set tls error
+		else if(strstr(commandString,"Set tls error") != NULL)
+		{
+			simulateTlsError = true;
+
+			ESP_LOGI(TAG, "Set tls error");
+			responseStatus = 200;
+		}
 
-					ESP_LOGI(TAG, "Update to override version: %d", overrideVersion);
-					responseStatus = 200;
-				}
-				else
-				{
-					responseStatus = 400;
-				}
-			}
 
-			else if(strstr(commandString,"SetMaxInstallationCurrent ") != NULL)
+		else if(strstr(commandString,"Override ") != NULL)
+		{
+			char *endptr;
+			int overrideVersion = strtol(commandString+11, &endptr, 10);
+			if((1000 > overrideVersion) && (overrideVersion >=0))
 			{
-				char *endptr;
-				int maxInt = (int)strtol(commandString+28, &endptr, 10);
+				certifcate_setOverrideVersion(overrideVersion); //Fake old version for test
+				certificate_update(0);
 
-				float maxInstCurrentConfig = maxInt * 1.0;
+				ESP_LOGI(TAG, "Update to override version: %d", overrideVersion);
+				responseStatus = 200;
+			}
+			else
+			{
+				responseStatus = 400;
+			}
+		}
 
-				//Sanity check
-				if((40.0 >= maxInstCurrentConfig) && (maxInstCurrentConfig >= 0.0))
-				{
-					float limitedMaxInst = maxInstCurrentConfig;
-					if(maxInstCurrentConfig > 32.0)
-						limitedMaxInst = 32.0;
+		else if(strstr(commandString,"SetMaxInstallationCurrent ") != NULL)
+		{
+			char *endptr;
+			int maxInt = (int)strtol(commandString+28, &endptr, 10);
 
-					//Never send higher than 32 to MCU
-					MessageType ret = MCU_SendFloatParameter(ChargeCurrentInstallationMaxLimit, limitedMaxInst);
-					if(ret == MsgWriteAck)
-					{
-						storage_Set_MaxInstallationCurrentConfig(maxInstCurrentConfig);
-						ESP_LOGI(TAG, "Set MaxInstallationCurrentConfig to MCU: %f", maxInstCurrentConfig);
-						storage_SaveConfiguration();
-						responseStatus = 200;
-					}
-					else
-					{
-						responseStatus = 400;
-					}
-				}
-				else
-				{
-					responseStatus = 400;
-				}
-			}
+			float maxInstCurrentConfig = maxInt * 1.0;
 
-			else if(strstr(commandString,"SetPhaseRotation ") != NULL)
+			//Sanity check
+			if((40.0 >= maxInstCurrentConfig) && (maxInstCurrentConfig >= 0.0))
 			{
-				char *endptr;
-				int newPhaseRotation = (int)strtol(commandString+19, &endptr, 10);
+				float limitedMaxInst = maxInstCurrentConfig;
+				if(maxInstCurrentConfig > 32.0)
+					limitedMaxInst = 32.0;
 
-				//Sanity check
-				if((18 >= newPhaseRotation) && (newPhaseRotation >= 0))
+				//Never send higher than 32 to MCU
+				MessageType ret = MCU_SendFloatParameter(ChargeCurrentInstallationMaxLimit, limitedMaxInst);
+				if(ret == MsgWriteAck)
 				{
-						storage_Set_PhaseRotation(newPhaseRotation);
-						ESP_LOGI(TAG, "Set PhaseRotation: %i", newPhaseRotation);
-						storage_SaveConfiguration();
-						responseStatus = 200;
+					storage_Set_MaxInstallationCurrentConfig(maxInstCurrentConfig);
+					ESP_LOGI(TAG, "Set MaxInstallationCurrentConfig to MCU: %f", maxInstCurrentConfig);
+					storage_SaveConfiguration();
+					responseStatus = 200;
 				}
 				else
 				{
 					responseStatus = 400;
 				}
 			}
-
-			// GetInstallationConfigOnFile
-			else if(strstr(commandString,"GetInstallationConfigOnFile") != NULL)
+			else
 			{
-				reportInstallationConfigOnFile = true;
-				ESP_LOGI(TAG, "Getting installationConfigOnFile");
-				responseStatus = 200;
+				responseStatus = 400;
 			}
+		}
+
+		else if(strstr(commandString,"SetPhaseRotation ") != NULL)
+		{
+			char *endptr;
+			int newPhaseRotation = (int)strtol(commandString+19, &endptr, 10);
 
-			// SetNewWifi
-			else if(strstr(commandString,"SetNewWifi:") != NULL)
+			//Sanity check
+			if((18 >= newPhaseRotation) && (newPhaseRotation >= 0))
 			{
-				char * start = strstr(commandString,"{");
-				commandString[commandEvent->data_len-1] = '\0';
+					storage_Set_PhaseRotation(newPhaseRotation);
+					ESP_LOGI(TAG, "Set PhaseRotation: %i", newPhaseRotation);
+					storage_SaveConfiguration();
+					responseStatus = 200;
+			}
+			else
+			{
+				responseStatus = 400;
+			}
+		}
 
-				char wifiString[commandEvent->data_len-1];
-				int nextChar = 0;
-				for (int i = 0; i < commandEvent->data_len-2; i++)
+		// GetInstallationConfigOnFile
+		else if(strstr(commandString,"GetInstallationConfigOnFile") != NULL)
+		{
+			reportInstallationConfigOnFile = true;
+			ESP_LOGI(TAG, "Getting installationConfigOnFile");
+			responseStatus = 200;
+		}
+
+		// SetNewWifi
+		else if(strstr(commandString,"SetNewWifi:") != NULL)
+		{
+			char * start = strstr(commandString,"{");
+			commandString[call->data_len-1] = '\0';
+
+			char wifiString[call->data_len-1];
+			int nextChar = 0;
+			for (int i = 0; i < call->data_len-2; i++)
+			{
+				if(start[i] != '\\')
 				{
-					if(start[i] != '\\')
-					{
-						wifiString[nextChar] = start[i];
-						nextChar++;
-					}
+					wifiString[nextChar] = start[i];
+					nextChar++;
 				}
-				wifiString[nextChar] = '\0';
+			}
+			wifiString[nextChar] = '\0';
 
-				cJSON *body = cJSON_Parse(wifiString);
-				if(body!=NULL){
-					if(cJSON_HasObjectItem(body, "Pin")){
-						char * pin = cJSON_GetObjectItem(body, "Pin")->valuestring;
-						if(strcmp(pin,i2cGetLoadedDeviceInfo().Pin) == 0)
-						{
-							if(cJSON_HasObjectItem(body, "SSID")){
+			cJSON *body = cJSON_Parse(wifiString);
+			if(body!=NULL){
+				if(cJSON_HasObjectItem(body, "Pin")){
+					char * pin = cJSON_GetObjectItem(body, "Pin")->valuestring;
+					if(strcmp(pin,i2cGetLoadedDeviceInfo().Pin) == 0)
+					{
+						if(cJSON_HasObjectItem(body, "SSID")){
 
-								char * ssid = cJSON_GetObjectItem(body, "SSID")->valuestring;
-								ESP_LOGW(TAG, "SSID: %s", ssid);
+							char * ssid = cJSON_GetObjectItem(body, "SSID")->valuestring;
+							ESP_LOGW(TAG, "SSID: %s", ssid);
 
 
-								if(cJSON_HasObjectItem(body, "PSK")){
+							if(cJSON_HasObjectItem(body, "PSK")){
 
-									char * psk = cJSON_GetObjectItem(body, "PSK")->valuestring;
-									ESP_LOGW(TAG, "Psk: %s", psk);
+								char * psk = cJSON_GetObjectItem(body, "PSK")->valuestring;
+								ESP_LOGW(TAG, "Psk: %s", psk);
 
-									storage_SaveWifiParameters(ssid, psk);
-									if(network_CheckWifiParameters())
-									{
-										network_updateWifi();
-										ESP_LOGW(TAG, "Updated Wifi");
-										responseStatus = 200;
-									}
-								}
-								else
+								storage_SaveWifiParameters(ssid, psk);
+								if(network_CheckWifiParameters())
 								{
-									responseStatus = 400;
-									return false;
+									network_updateWifi();
+									ESP_LOGW(TAG, "Updated Wifi");
+									responseStatus = 200;
 								}
-
 							}
 							else
 							{
@@ -2136,1289 +2498,1061 @@ int ParseCommandFromCloud(esp_mqtt_event_handle_t commandEvent)
 							}
 
 						}
-					}
-					else
-					{
-						//Do not continue invalid content
-						responseStatus = 400;
-						return false;
-					}
+						else
+						{
+							responseStatus = 400;
+							return false;
+						}
 
+					}
+				}
+				else
+				{
+					//Do not continue invalid content
+					responseStatus = 400;
+					return false;
 				}
 
-				cJSON_Delete(body);
+			}
 
+			cJSON_Delete(body);
 
-				ESP_LOGI(TAG, "Setting new Wifi");
-			}
 
-			else if(strstr(commandString,"SwapCommunicationMode") != NULL)
-			{
-				if(storage_Get_CommunicationMode() == eCONNECTION_WIFI)
-					storage_Set_CommunicationMode(eCONNECTION_LTE);
-				else if(storage_Get_CommunicationMode() == eCONNECTION_LTE)
-					storage_Set_CommunicationMode(eCONNECTION_WIFI);
+			ESP_LOGI(TAG, "Setting new Wifi");
+		}
 
-				storage_Set_DiagnosticsMode(eSWAP_COMMUNICATION_MODE);
-				storage_SaveConfiguration();
+		else if(strstr(commandString,"SwapCommunicationMode") != NULL)
+		{
+			if(storage_Get_CommunicationMode() == eCONNECTION_WIFI)
+				storage_Set_CommunicationMode(eCONNECTION_LTE);
+			else if(storage_Get_CommunicationMode() == eCONNECTION_LTE)
+				storage_Set_CommunicationMode(eCONNECTION_WIFI);
 
-				ESP_LOGI(TAG, "SwapCommunicationMode");
+			storage_Set_DiagnosticsMode(eSWAP_COMMUNICATION_MODE);
+			storage_SaveConfiguration();
 
-				restartCmdReceived = true;
-				responseStatus = 200;
-				//esp_restart();
-			}
+			ESP_LOGI(TAG, "SwapCommunicationMode");
 
-			else if(strstr(commandString,"ActivateLogging") != NULL)
-			{
-				esp_log_level_set("*", ESP_LOG_INFO);
-				storage_Set_DiagnosticsMode(eACTIVATE_LOGGING);
-				storage_SaveConfiguration();
+			restartCmdReceived = true;
+			responseStatus = 200;
+			//esp_restart();
+		}
 
-				ESP_LOGI(TAG, "ActivateLogging");
-				responseStatus = 200;
+		else if(strstr(commandString,"ActivateLogging") != NULL)
+		{
+			esp_log_level_set("*", ESP_LOG_INFO);
+			storage_Set_DiagnosticsMode(eACTIVATE_LOGGING);
+			storage_SaveConfiguration();
 
-			}
-			else if(strstr(commandString,"ActivateEMC") != NULL)
-			{
-				esp_log_level_set("*", ESP_LOG_INFO);
-				storage_Set_DiagnosticsMode(eACTIVATE_EMC_LOGGING);
-				storage_SaveConfiguration();
+			ESP_LOGI(TAG, "ActivateLogging");
+			responseStatus = 200;
 
-				ESP_LOGI(TAG, "ActivateEMCLogging");
-				responseStatus = 200;
-			}
-			else if(strstr(commandString, "set log level for") != NULL){
+		}
+		else if(strstr(commandString,"ActivateEMC") != NULL)
+		{
+			esp_log_level_set("*", ESP_LOG_INFO);
+			storage_Set_DiagnosticsMode(eACTIVATE_EMC_LOGGING);
+			storage_SaveConfiguration();
+
+			ESP_LOGI(TAG, "ActivateEMCLogging");
+			responseStatus = 200;
+		}
+		else if(strstr(commandString, "set log level for") != NULL){
 #define MAX_ALLOWED_TAG_LENGTH 32
-				/*
-				 * Example with arguments:
-				 * set log level for '*' N
-				 * set log level for 'MAIN           ' W
-				 */
-				bool valid_tag = false;
-				bool valid_level = true;
+			/*
+			 * Example with arguments:
+			 * set log level for '*' N
+			 * set log level for 'MAIN           ' W
+			 */
+			bool valid_tag = false;
+			bool valid_level = true;
 
-				char tag[MAX_ALLOWED_TAG_LENGTH +1];
+			char tag[MAX_ALLOWED_TAG_LENGTH +1];
 
-				char * tag_start = strchr(commandString+16, '\''); // search for the tag string from position close to end of already parsed sting
-				char * tag_end = NULL;
+			char * tag_start = strchr(commandString+16, '\''); // search for the tag string from position close to end of already parsed sting
+			char * tag_end = NULL;
 
-				if(tag_start != NULL){
-					tag_end = strchr(++tag_start, '\'');
-				}
+			if(tag_start != NULL){
+				tag_end = strchr(++tag_start, '\'');
+			}
 
-				if(tag_end != NULL){
-					int tag_length = tag_end - tag_start;
-					if(tag_length < MAX_ALLOWED_TAG_LENGTH){
-						valid_tag = true;
+			if(tag_end != NULL){
+				int tag_length = tag_end - tag_start;
+				if(tag_length < MAX_ALLOWED_TAG_LENGTH){
+					valid_tag = true;
 
-						for(size_t i = 0; i < tag_length; i++){
-							if(!isalnum((unsigned char)tag_start[i]) && !isblank((unsigned char)tag_start[i]) && tag_start[i] != '*' && tag_start[i] != '_' && tag_start[i] != '-'){
-								valid_tag = false;
-								break;
-							}
-						}
-						if(valid_tag){
-							strncpy(tag, tag_start, tag_length);
-							tag[tag_length] = '\0';
+					for(size_t i = 0; i < tag_length; i++){
+						if(!isalnum((unsigned char)tag_start[i]) && !isblank((unsigned char)tag_start[i]) && tag_start[i] != '*' && tag_start[i] != '_' && tag_start[i] != '-'){
+							valid_tag = false;
+							break;
 						}
 					}
+					if(valid_tag){
+						strncpy(tag, tag_start, tag_length);
+						tag[tag_length] = '\0';
+					}
 				}
+			}
 
 
-				if(valid_tag){
-					char level = '\0';
-					size_t remaining_length = strlen(tag_end);
-					for(size_t i = 0; i < remaining_length; i++){
-						if(isalpha((unsigned char)tag_end[i])){
-							level = tag_end[i];
-						}
-					}
-
-					switch(level){
-					case 'N':
-						esp_log_level_set(tag, ESP_LOG_NONE);
-						break;
-					case 'E':
-						esp_log_level_set(tag, ESP_LOG_ERROR);
-						break;
-					case 'W':
-						esp_log_level_set(tag, ESP_LOG_WARN);
-						break;
-					case 'I':
-						esp_log_level_set(tag, ESP_LOG_INFO);
-						break;
-					case 'D':
-						esp_log_level_set(tag, ESP_LOG_DEBUG);
-						break;
-					case 'V':
-						esp_log_level_set(tag, ESP_LOG_VERBOSE);
-						break;
-					default:
-						valid_level = false;
+			if(valid_tag){
+				char level = '\0';
+				size_t remaining_length = strlen(tag_end);
+				for(size_t i = 0; i < remaining_length; i++){
+					if(isalpha((unsigned char)tag_end[i])){
+						level = tag_end[i];
 					}
 				}
 
-				if(valid_tag && valid_level){
-					responseStatus = 200;
-				}else{
-					responseStatus = 400;
+				switch(level){
+				case 'N':
+					esp_log_level_set(tag, ESP_LOG_NONE);
+					break;
+				case 'E':
+					esp_log_level_set(tag, ESP_LOG_ERROR);
+					break;
+				case 'W':
+					esp_log_level_set(tag, ESP_LOG_WARN);
+					break;
+				case 'I':
+					esp_log_level_set(tag, ESP_LOG_INFO);
+					break;
+				case 'D':
+					esp_log_level_set(tag, ESP_LOG_DEBUG);
+					break;
+				case 'V':
+					esp_log_level_set(tag, ESP_LOG_VERBOSE);
+					break;
+				default:
+					valid_level = false;
 				}
 			}
 
-			else if(strstr(commandString,"Simulate offline ") != NULL)
-			{
-				char *endptr;
-				int offlineTime = (int)strtol(commandString+19, &endptr, 10);
-				if((offlineTime <= 86400) && (offlineTime > 0))
-					offlineHandler_SimulateOffline(offlineTime);
-
-				ESP_LOGI(TAG, "Simulate offline %d", offlineTime);
-				responseStatus = 200;
-			}
-
-			else if(strstr(commandString,"Activate TCP") != NULL)
-			{
-				storage_Set_DiagnosticsMode(eACTIVATE_TCP_PORT);
-				storage_SaveConfiguration();
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"AlwaysSendSessionDiagnostics") != NULL)
-			{
-				storage_Set_DiagnosticsMode(eALWAYS_SEND_SESSION_DIAGNOSTICS);
-				storage_SaveConfiguration();
+			if(valid_tag && valid_level){
 				responseStatus = 200;
+			}else{
+				responseStatus = 400;
 			}
+		}
 
-			else if(strstr(commandString,"OverrideNetworkType") != NULL)
-			{
-				//char *endptr;
-				int newNetworkType = 0;//(int)strtol(commandString+22, &endptr, 10);
-				if(strstr(commandString,"IT1") != NULL)
-					newNetworkType = NETWORK_1P3W;
-				else if(strstr(commandString,"IT3") != NULL)
-					newNetworkType = NETWORK_3P3W;
-				else if(strstr(commandString,"TN1") != NULL)
-					newNetworkType = NETWORK_1P4W;
-				else if(strstr(commandString,"TN3") != NULL)
-					newNetworkType = NETWORK_3P4W;
-
-				//Sanity check
-				if(IsUKOPENPowerBoardRevision())
-				{
-					responseStatus = 400;
-				}
-				else if((4 >= newNetworkType) && (newNetworkType >= 0))
-				{
-					ESP_LOGI(TAG, "Override Network type to set: %i", newNetworkType);
-
-					MessageType ret = MCU_SendUint8Parameter(ParamGridTypeOverride, newNetworkType);
-					if(ret == MsgWriteAck)
-					{
-						int ret = (int)MCU_UpdateOverrideGridType();
+		else if(strstr(commandString,"Simulate offline ") != NULL)
+		{
+			char *endptr;
+			int offlineTime = (int)strtol(commandString+19, &endptr, 10);
+			if((offlineTime <= 86400) && (offlineTime > 0))
+				offlineHandler_SimulateOffline(offlineTime);
 
-						if(ret == newNetworkType)
-						{
-							ESP_LOGI(TAG, "Set OverrideNetworkType OK");
-							responseStatus = 200;
-						}
-						else
-						{
-							ESP_LOGE(TAG, "Set OverrideNetworkType FAILED 1");
-							responseStatus = 400;
-						}
-					}
-					else
-					{
-						ESP_LOGE(TAG, "Set OverrideNetworkType FAILED 2");
-					}
+			ESP_LOGI(TAG, "Simulate offline %d", offlineTime);
+			responseStatus = 200;
+		}
 
-					responseStatus = 200;
-				}
-				else
-				{
-					responseStatus = 400;
-				}
-			}
+		else if(strstr(commandString,"Activate TCP") != NULL)
+		{
+			storage_Set_DiagnosticsMode(eACTIVATE_TCP_PORT);
+			storage_SaveConfiguration();
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"AlwaysSendSessionDiagnostics") != NULL)
+		{
+			storage_Set_DiagnosticsMode(eALWAYS_SEND_SESSION_DIAGNOSTICS);
+			storage_SaveConfiguration();
+			responseStatus = 200;
+		}
 
-			else if(strstr(commandString,"IT3 enable") != NULL)
+		else if(strstr(commandString,"OverrideNetworkType") != NULL)
+		{
+			//char *endptr;
+			int newNetworkType = 0;//(int)strtol(commandString+22, &endptr, 10);
+			if(strstr(commandString,"IT1") != NULL)
+				newNetworkType = NETWORK_1P3W;
+			else if(strstr(commandString,"IT3") != NULL)
+				newNetworkType = NETWORK_3P3W;
+			else if(strstr(commandString,"TN1") != NULL)
+				newNetworkType = NETWORK_1P4W;
+			else if(strstr(commandString,"TN3") != NULL)
+				newNetworkType = NETWORK_3P4W;
+
+			//Sanity check
+			if(IsUKOPENPowerBoardRevision())
 			{
-				MessageType ret = MCU_SendUint8Parameter(ParamIT3OptimizationEnabled, 1);
-				if(ret == MsgWriteAck)
-				{
-					uint8_t ret = MCU_UpdateIT3OptimizationState();
-					if(ret == 0)
-					{
-						responseStatus = 200;
-					}
-					else
-					{
-						ESP_LOGE(TAG, "Set IT3 optimization enabled FAILED 1");
-						responseStatus = 400;
-					}
-				}
-				else
-				{
-					ESP_LOGE(TAG, "Set IT3 optimization enabled FAILED 2");
-					responseStatus = 400;
-				}
+				responseStatus = 400;
 			}
-			else if(strstr(commandString,"IT3 disable") != NULL)
+			else if((4 >= newNetworkType) && (newNetworkType >= 0))
 			{
-				MessageType ret = MCU_SendUint8Parameter(ParamIT3OptimizationEnabled, 0);
+				ESP_LOGI(TAG, "Override Network type to set: %i", newNetworkType);
+
+				MessageType ret = MCU_SendUint8Parameter(ParamGridTypeOverride, newNetworkType);
 				if(ret == MsgWriteAck)
 				{
+					int ret = (int)MCU_UpdateOverrideGridType();
 
-					uint8_t ret = MCU_UpdateIT3OptimizationState();
-					if(ret == 0)
+					if(ret == newNetworkType)
 					{
-						ESP_LOGI(TAG, "Set IT3 optimization disabled OK");
+						ESP_LOGI(TAG, "Set OverrideNetworkType OK");
 						responseStatus = 200;
 					}
 					else
 					{
-						ESP_LOGE(TAG, "Set IT3 optimization disabled FAILED 1");
+						ESP_LOGE(TAG, "Set OverrideNetworkType FAILED 1");
 						responseStatus = 400;
 					}
 				}
 				else
 				{
-					ESP_LOGE(TAG, "Set IT3 optimization disabled FAILED 2");
-					responseStatus = 400;
+					ESP_LOGE(TAG, "Set OverrideNetworkType FAILED 2");
 				}
-			}
 
+				responseStatus = 200;
+			}
+			else
+			{
+				responseStatus = 400;
+			}
+		}
 
-			else if(strstr(commandString,"ITStart") != NULL)
+		else if(strstr(commandString,"IT3 enable") != NULL)
+		{
+			MessageType ret = MCU_SendUint8Parameter(ParamIT3OptimizationEnabled, 1);
+			if(ret == MsgWriteAck)
 			{
-				ESP_LOGI(TAG, "IT diagnostics stop");
-				MessageType ret = MCU_SendCommandId(CommandITDiagnosticsStart);
-				if(ret == MsgCommandAck)
+				uint8_t ret = MCU_UpdateIT3OptimizationState();
+				if(ret == 0)
 				{
-					MCUDiagnosticsResults = true;
 					responseStatus = 200;
-					ESP_LOGI(TAG, "MCU IT diag ON");
 				}
 				else
 				{
+					ESP_LOGE(TAG, "Set IT3 optimization enabled FAILED 1");
 					responseStatus = 400;
-					ESP_LOGI(TAG, "MCU IT diag FAILED");
 				}
 			}
-			else if(strstr(commandString,"ITStop") != NULL)
+			else
 			{
-				ESP_LOGI(TAG, "IT diagnostics stop");
-				MessageType ret = MCU_SendCommandId(CommandITDiagnosticsStop);
-				if(ret == MsgCommandAck)
+				ESP_LOGE(TAG, "Set IT3 optimization enabled FAILED 2");
+				responseStatus = 400;
+			}
+		}
+		else if(strstr(commandString,"IT3 disable") != NULL)
+		{
+			MessageType ret = MCU_SendUint8Parameter(ParamIT3OptimizationEnabled, 0);
+			if(ret == MsgWriteAck)
+			{
+
+				uint8_t ret = MCU_UpdateIT3OptimizationState();
+				if(ret == 0)
 				{
-					MCUDiagnosticsResults = false;
+					ESP_LOGI(TAG, "Set IT3 optimization disabled OK");
 					responseStatus = 200;
-					ESP_LOGI(TAG, "MCU IT mode switched");
 				}
 				else
 				{
+					ESP_LOGE(TAG, "Set IT3 optimization disabled FAILED 1");
 					responseStatus = 400;
-					ESP_LOGI(TAG, "MCU IT switch FAILED");
 				}
 			}
-			else if(strstr(commandString,"GetDiagnostics") != NULL)
+			else
 			{
-				ESP_LOGI(TAG, "GetDiagnostics");
-				MCUDiagnosticsResults = true;
-				responseStatus = 200;
+				ESP_LOGE(TAG, "Set IT3 optimization disabled FAILED 2");
+				responseStatus = 400;
 			}
-			else if(strstr(commandString,"GetRFIDList") != NULL)
+		}
+
+
+		else if(strstr(commandString,"ITStart") != NULL)
+		{
+			ESP_LOGI(TAG, "IT diagnostics stop");
+			MessageType ret = MCU_SendCommandId(CommandITDiagnosticsStart);
+			if(ret == MsgCommandAck)
 			{
-				ESP_LOGI(TAG, "GetRFIDList");
-				storage_CreateRFIDbuffer();
-				storage_printRFIDTagsOnFile(true);
-				ESPDiagnosticsResults = true;
+				MCUDiagnosticsResults = true;
 				responseStatus = 200;
+				ESP_LOGI(TAG, "MCU IT diag ON");
 			}
-			else if(strstr(commandString,"RTC ") != NULL)
+			else
 			{
-				char *endptr;
-				int rtc = (int)strtol(commandString+5, &endptr, 10);
-
-				ESP_LOGI(TAG, "RTC %i -> 0x%X", rtc, rtc);
-				RTCWriteControl(rtc);
-
-				responseStatus = 200;
-
+				responseStatus = 400;
+				ESP_LOGI(TAG, "MCU IT diag FAILED");
 			}
-			else if(strstr(commandString,"RTC") != NULL)
+		}
+		else if(strstr(commandString,"ITStop") != NULL)
+		{
+			ESP_LOGI(TAG, "IT diagnostics stop");
+			MessageType ret = MCU_SendCommandId(CommandITDiagnosticsStop);
+			if(ret == MsgCommandAck)
 			{
-				SetSendRTC();
+				MCUDiagnosticsResults = false;
 				responseStatus = 200;
+				ESP_LOGI(TAG, "MCU IT mode switched");
 			}
-			else if(strstr(commandString,"PulseInterval ") != NULL)
+			else
 			{
-				char *endptr;
-				uint32_t interval = (uint32_t)strtol(commandString+16, &endptr, 10);
-				if((3600 >= interval) && (interval >= 10))
-				{
-					storage_Set_PulseInterval(interval);
-					storage_SaveConfiguration();
-					ESP_LOGI(TAG, "Setting Pulse interval %" PRIu32, interval);
-					responseStatus = 200;
-				}
-				else
-				{
-					responseStatus = 400;
-				}
+				responseStatus = 400;
+				ESP_LOGI(TAG, "MCU IT switch FAILED");
 			}
-			else if(strstr(commandString,"PowerOff4GAndReset") != NULL)
-			{
-				cellularPinsOff();
+		}
+		else if(strstr(commandString,"GetDiagnostics") != NULL)
+		{
+			ESP_LOGI(TAG, "GetDiagnostics");
+			MCUDiagnosticsResults = true;
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"GetRFIDList") != NULL)
+		{
+			ESP_LOGI(TAG, "GetRFIDList");
+			storage_CreateRFIDbuffer();
+			storage_printRFIDTagsOnFile(true);
+			ESPDiagnosticsResults = true;
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"RTC ") != NULL)
+		{
+			char *endptr;
+			int rtc = (int)strtol(commandString+5, &endptr, 10);
 
-				//Restart must be done to ensure that we don't remain offline if communication mode is set to 4G.
-				//The 4G module will be powered on automatically if 4G is active communication mode
-				restartCmdReceived = true;
-				responseStatus = 200;
-				//esp_restart();
-			}
+			ESP_LOGI(TAG, "RTC %i -> 0x%X", rtc, rtc);
+			RTCWriteControl(rtc);
+
+			responseStatus = 200;
 
-			//For testing AT on BG while on Wifi
-			else if(strstr(commandString,"PowerToggle4G") != NULL)
+		}
+		else if(strstr(commandString,"RTC") != NULL)
+		{
+			SetSendRTC();
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"PulseInterval ") != NULL)
+		{
+			char *endptr;
+			uint32_t interval = (uint32_t)strtol(commandString+16, &endptr, 10);
+			if((3600 >= interval) && (interval >= 10))
 			{
-				cellularPinsOff();
+				storage_Set_PulseInterval(interval);
+				storage_SaveConfiguration();
+				ESP_LOGI(TAG, "Setting Pulse interval %" PRIu32, interval);
 				responseStatus = 200;
 			}
-
-			//For testing AT on BG while on Wifi
-			else if(strstr(commandString,"PowerOn4G") != NULL)
+			else
 			{
-				cellularPinsOn();
-				ATOnly();
-				responseStatus = 200;
+				responseStatus = 400;
 			}
+		}
+		else if(strstr(commandString,"PowerOff4GAndReset") != NULL)
+		{
+			cellularPinsOff();
 
-			//AT command tunneling - do not change command mode
-			else if(strstr(commandString,"AT") != NULL)
-			{
-				//Don't change data mode when on wifi
-				if(storage_Get_CommunicationMode() == eCONNECTION_WIFI)
-					TunnelATCommand(commandString, 0);
+			//Restart must be done to ensure that we don't remain offline if communication mode is set to 4G.
+			//The 4G module will be powered on automatically if 4G is active communication mode
+			restartCmdReceived = true;
+			responseStatus = 200;
+			//esp_restart();
+		}
 
-				//Change data mode when on LTE
-				if(storage_Get_CommunicationMode() == eCONNECTION_LTE)
-					TunnelATCommand(commandString, 1);
-			}
-			//AT command tunneling - do change command mode
-			else if(strstr(commandString,"OnlineWD") != NULL)
-			{
-				SetOnlineWatchdog();
-				responseStatus = 200;
-			}
-			//AT command tunneling - do change command mode
-			else if(strstr(commandString,"ClearNotifications") != NULL)
-			{
-				ClearNotifications();
-				responseStatus = 200;
-			}
+		//For testing AT on BG while on Wifi
+		else if(strstr(commandString,"PowerToggle4G") != NULL)
+		{
+			cellularPinsOff();
+			responseStatus = 200;
+		}
 
-			else if(strstr(commandString,"PrintStat") != NULL)
-			{
-				char stat[100] = {0};
-				storage_GetStats(stat);
-				publish_debug_telemetry_observation_Diagnostics(stat);
-				responseStatus = 200;
-			}
+		//For testing AT on BG while on Wifi
+		else if(strstr(commandString,"PowerOn4G") != NULL)
+		{
+			cellularPinsOn();
+			ATOnly();
+			responseStatus = 200;
+		}
 
-			else if(strstr(commandString,"DeleteOfflineLog") != NULL)
-			{
-				int ret = offline_log_delete();
-				if(ret == 1)
-					publish_debug_telemetry_observation_Diagnostics("Delete OK");
-				else
-					publish_debug_telemetry_observation_Diagnostics("Delete failed");
+		//AT command tunneling - do not change command mode
+		else if(strstr(commandString,"AT") != NULL)
+		{
+			//Don't change data mode when on wifi
+			if(storage_Get_CommunicationMode() == eCONNECTION_WIFI)
+				TunnelATCommand(commandString, 0);
 
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"StartStack") != NULL)
-			{
-				//Also send instantly when activated
-				SendStacks();
-				StackDiagnostics(true);
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"StopStack") != NULL)
-			{
-				StackDiagnostics(false);
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"OCMFHigh") != NULL)
-			{
-				SessionHandler_SetOCMFHighInterval();
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"LogCurrent") != NULL)
-			{
-				int interval = 0;
-				sscanf(&commandString[12], "%d", &interval);
+			//Change data mode when on LTE
+			if(storage_Get_CommunicationMode() == eCONNECTION_LTE)
+				TunnelATCommand(commandString, 1);
+		}
+		//AT command tunneling - do change command mode
+		else if(strstr(commandString,"OnlineWD") != NULL)
+		{
+			SetOnlineWatchdog();
+			responseStatus = 200;
+		}
+		//AT command tunneling - do change command mode
+		else if(strstr(commandString,"ClearNotifications") != NULL)
+		{
+			ClearNotifications();
+			responseStatus = 200;
+		}
 
-				ESP_LOGI(TAG, "Interval: %i", interval);
+		else if(strstr(commandString,"PrintStat") != NULL)
+		{
+			char stat[100] = {0};
+			storage_GetStats(stat);
+			publish_debug_telemetry_observation_Diagnostics(stat);
+			responseStatus = 200;
+		}
 
-				if((interval >= 0) && (interval <= 86400))
-				{
-					SessionHandler_SetLogCurrents(interval);
-				}
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"RestartCar") != NULL)//MCU Command 507: Reset Car Interface sequence
-			{
-				MessageType ret = MCU_SendCommandId(MCUCommandRestartCarInterface);
-				if(ret == MsgCommandAck)
-				{
-					responseStatus = 200;
-					ESP_LOGI(TAG, "MCU Restart car OK");
-				}
-				else
-				{
-					responseStatus = 400;
-					ESP_LOGI(TAG, "MCU Restart car FAILED");
-				}
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"ServoCheck") != NULL)
-			{
-				MCU_PerformServoCheck();
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"GetHWCurrentLimits") != NULL)
-			{
-				char msg[60] = {0};
-				sprintf(msg, "eMeter HW Current limit: %f / %f A", MCU_GetHWCurrentActiveLimit(), MCU_GetHWCurrentMaxLimit());
-				publish_debug_telemetry_observation_Diagnostics(msg);
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"blockreq") != NULL)
-			{
-				blockStartToTestPingReply = true;
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"blockall") != NULL)
-			{
-				blockStartToTestPingReply = true;
-				blockPingReply = true;
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"unblock") != NULL)
-			{
-				blockStartToTestPingReply = false;
-				blockPingReply = false;
-				responseStatus = 200;
-			}
+		else if(strstr(commandString,"DeleteOfflineLog") != NULL)
+		{
+			int ret = offline_log_delete();
+			if(ret == 1)
+				publish_debug_telemetry_observation_Diagnostics("Delete OK");
+			else
+				publish_debug_telemetry_observation_Diagnostics("Delete failed");
 
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"StartStack") != NULL)
+		{
+			//Also send instantly when activated
+			SendStacks();
+			StackDiagnostics(true);
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"StopStack") != NULL)
+		{
+			StackDiagnostics(false);
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"OCMFHigh") != NULL)
+		{
+			SessionHandler_SetOCMFHighInterval();
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"LogCurrent") != NULL)
+		{
+			int interval = 0;
+			sscanf(&commandString[12], "%d", &interval);
 
-			else if(strstr(commandString,"pr on") != NULL)
-			{
-				offlineHandler_UpdatePingReplyState(PING_REPLY_ONLINE);
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"pr off") != NULL)
-			{
-				offlineHandler_UpdatePingReplyState(PING_REPLY_OFFLINE);
-				responseStatus = 200;
-			}
+			ESP_LOGI(TAG, "Interval: %i", interval);
 
-			else if(strstr(commandString,"datalog on") != NULL)
-			{
-				datalog = true;
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"datalog off") != NULL)
+			if((interval >= 0) && (interval <= 86400))
 			{
-				datalog = false;
-				responseStatus = 200;
+				SessionHandler_SetLogCurrents(interval);
 			}
-			/// This command may not be required, only for troubleshooting if MCU does not respond. Has never happened.
-			else if(strstr(commandString,"OTA no MCU") != NULL)
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"RestartCar") != NULL)//MCU Command 507: Reset Car Interface sequence
+		{
+			MessageType ret = MCU_SendCommandId(MCUCommandRestartCarInterface);
+			if(ret == MsgCommandAck)
 			{
-				//Here no command is sent to stop MCU directly.
-				ble_interface_deinit();
-				start_segmented_ota();
 				responseStatus = 200;
+				ESP_LOGI(TAG, "MCU Restart car OK");
 			}
-			//Run factory test function - dev - disable socket connection
-			else if(strstr(commandString,"factest") != NULL)
+			else
 			{
-				run_component_tests();
-				responseStatus = 200;
+				responseStatus = 400;
+				ESP_LOGI(TAG, "MCU Restart car FAILED");
 			}
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"ServoCheck") != NULL)
+		{
+			MCU_PerformServoCheck();
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"GetHWCurrentLimits") != NULL)
+		{
+			char msg[60] = {0};
+			sprintf(msg, "eMeter HW Current limit: %f / %f A", MCU_GetHWCurrentActiveLimit(), MCU_GetHWCurrentMaxLimit());
+			publish_debug_telemetry_observation_Diagnostics(msg);
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"blockreq") != NULL)
+		{
+			blockStartToTestPingReply = true;
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"blockall") != NULL)
+		{
+			blockStartToTestPingReply = true;
+			blockPingReply = true;
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"unblock") != NULL)
+		{
+			blockStartToTestPingReply = false;
+			blockPingReply = false;
+			responseStatus = 200;
+		}
 
 
-			///OfflineSessions
+		else if(strstr(commandString,"pr on") != NULL)
+		{
+			offlineHandler_UpdatePingReplyState(PING_REPLY_ONLINE);
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"pr off") != NULL)
+		{
+			offlineHandler_UpdatePingReplyState(PING_REPLY_OFFLINE);
+			responseStatus = 200;
+		}
 
-			else if(strstr(commandString,"GetOfflineSessions") != NULL)
-			{
-				sessionHandler_SetOfflineSessionFlag();
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"DeleteOfflineSessions") != NULL)
-			{
-				offlineSession_DeleteAllFiles();
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"PrintOffsLog") != NULL)
-			{
-				ESP_LOGW(TAG, "SequenceLog: \r\n%s", offlineSession_GetLog());
-				publish_debug_telemetry_observation_Diagnostics(offlineSession_GetLog());
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"GetNrOfSessionsFiles") != NULL)
-			{
-				char sbuf[12] = {0};
-				snprintf(sbuf, 12,"Files: %i", offlineSession_FindNrOfFiles());
-				publish_debug_telemetry_observation_Diagnostics(sbuf);
+		else if(strstr(commandString,"datalog on") != NULL)
+		{
+			datalog = true;
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"datalog off") != NULL)
+		{
+			datalog = false;
+			responseStatus = 200;
+		}
+		/// This command may not be required, only for troubleshooting if MCU does not respond. Has never happened.
+		else if(strstr(commandString,"OTA no MCU") != NULL)
+		{
+			//Here no command is sent to stop MCU directly.
+			ble_interface_deinit();
+			start_segmented_ota();
+			responseStatus = 200;
+		}
+		//Run factory test function - dev - disable socket connection
+		else if(strstr(commandString,"factest") != NULL)
+		{
+			run_component_tests();
+			responseStatus = 200;
+		}
 
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"GetOfflineFile ") != NULL)
+
+		///OfflineSessions
+
+		else if(strstr(commandString,"GetOfflineSessions") != NULL)
+		{
+			sessionHandler_SetOfflineSessionFlag();
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"DeleteOfflineSessions") != NULL)
+		{
+			offlineSession_DeleteAllFiles();
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"PrintOffsLog") != NULL)
+		{
+			ESP_LOGW(TAG, "SequenceLog: \r\n%s", offlineSession_GetLog());
+			publish_debug_telemetry_observation_Diagnostics(offlineSession_GetLog());
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"GetNrOfSessionsFiles") != NULL)
+		{
+			char sbuf[12] = {0};
+			snprintf(sbuf, 12,"Files: %i", offlineSession_FindNrOfFiles());
+			publish_debug_telemetry_observation_Diagnostics(sbuf);
+
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"GetOfflineFile ") != NULL)
+		{
+			int fileNo = -1;
+			sscanf(&commandString[17], "%d", &fileNo);
+			if((fileNo >= 0) && (fileNo < 100))
 			{
-				int fileNo = -1;
-				sscanf(&commandString[17], "%d", &fileNo);
-				if((fileNo >= 0) && (fileNo < 100))
+				cJSON * csObject = offlineSession_ReadChargeSessionFromFile(fileNo);
+				if(csObject == NULL)
 				{
-					cJSON * csObject = offlineSession_ReadChargeSessionFromFile(fileNo);
-					if(csObject == NULL)
-					{
-						publish_debug_telemetry_observation_Diagnostics("csObject == NULL");
-					}
-					else
-					{
-						char *buf = cJSON_PrintUnformatted(csObject);
-						publish_debug_telemetry_observation_Diagnostics(buf);
-						free(csObject);
-
-					}
+					publish_debug_telemetry_observation_Diagnostics("csObject == NULL");
 				}
+				else
+				{
+					char *buf = cJSON_PrintUnformatted(csObject);
+					publish_debug_telemetry_observation_Diagnostics(buf);
+					free(csObject);
 
-				responseStatus = 200;
+				}
 			}
-			//Test Offline Sessions
-			else if(strstr(commandString,"tos ") != NULL)
+
+			responseStatus = 200;
+		}
+		//Test Offline Sessions
+		else if(strstr(commandString,"tos ") != NULL)
+		{
+			char *endptr;
+			uint32_t nrOfSessions = (uint32_t)strtol(commandString+6, &endptr, 10);
+			if(nrOfSessions <= 110)
 			{
-				char *endptr;
-				uint32_t nrOfSessions = (uint32_t)strtol(commandString+6, &endptr, 10);
-				if(nrOfSessions <= 110)
+				char *sec = strchr(commandString, '|');
+				if(sec != NULL)
 				{
-					char *sec = strchr(commandString, '|');
-					if(sec != NULL)
+					uint32_t nrOfSignedValues = (uint32_t)strtol(sec+1, &endptr, 10);
+					if(nrOfSignedValues <= 110)
 					{
-						uint32_t nrOfSignedValues = (uint32_t)strtol(sec+1, &endptr, 10);
-						if(nrOfSignedValues <= 110)
-						{
-							ESP_LOGW(TAG, "NrSess: %" PRIu32 " NrSV: %" PRIu32, nrOfSessions, nrOfSignedValues);
-							sessionHandler_TestOfflineSessions(nrOfSessions, nrOfSignedValues);
-						}
+						ESP_LOGW(TAG, "NrSess: %" PRIu32 " NrSV: %" PRIu32, nrOfSessions, nrOfSignedValues);
+						sessionHandler_TestOfflineSessions(nrOfSessions, nrOfSignedValues);
 					}
 				}
-				responseStatus = 200;
 			}
-			// Get general ocpp diagnostics
-			else if(strstr(commandString, "get ocpp diagnostics") != NULL){
-				ESP_LOGI(TAG, "Got request for ocpp diagnostics");
-
-				cJSON * result = ocpp_get_diagnostics();
-				if(result == NULL){
-					responseStatus = 500;
-				}else{
-					char * result_str = cJSON_PrintUnformatted(result);
-					if(result_str == NULL){
-						responseStatus = 500;
-					} else {
-						publish_debug_telemetry_observation_Diagnostics(result_str);
-						cJSON_Delete(result);
-						free(result_str);
-						responseStatus = 200;
-					}
-				}
-			}
-			// Get ocpp transaction diagnostics
-			else if(strstr(commandString, "get ocpp transaction diagnostics") != NULL){
-				ESP_LOGI(TAG, "Got request for ocpp transaction diagnostics");
+			responseStatus = 200;
+		}
+		// Get general ocpp diagnostics
+		else if(strstr(commandString, "get ocpp diagnostics") != NULL){
+			ESP_LOGI(TAG, "Got request for ocpp diagnostics");
 
-				int transaction_count = ocpp_transaction_count();
-				if(transaction_count < 0 || transaction_count > 9999){
+			cJSON * result = ocpp_get_diagnostics();
+			if(result == NULL){
+				responseStatus = 500;
+			}else{
+				char * result_str = cJSON_PrintUnformatted(result);
+				if(result_str == NULL){
 					responseStatus = 500;
-				}else{
-					char result[5];
-					sprintf(result, "%d", transaction_count % 1000);
-
-					publish_debug_telemetry_observation_Diagnostics(result);
+				} else {
+					publish_debug_telemetry_observation_Diagnostics(result_str);
+					cJSON_Delete(result);
+					free(result_str);
 					responseStatus = 200;
 				}
 			}
-			// Clear ocpp transactions files
-			else if(strstr(commandString, "clear ocpp transactions") != NULL){
-				ESP_LOGI(TAG, "Got request to clear ocpp transactions");
+		}
+		// Get ocpp transaction diagnostics
+		else if(strstr(commandString, "get ocpp transaction diagnostics") != NULL){
+			ESP_LOGI(TAG, "Got request for ocpp transaction diagnostics");
 
-				if(ocpp_transaction_clear_all() != 0) {
-					responseStatus = 500;
-				}else{
-					responseStatus = 200;
-				}
-			}
-			// Fail ocpp transactions messages
-			else if(strstr(commandString, "fail ocpp transactions") != NULL){
-				ESP_LOGI(TAG, "Got request to fail ocpp transactions");
+			int transaction_count = ocpp_transaction_count();
+			if(transaction_count < 0 || transaction_count > 9999){
+				responseStatus = 500;
+			}else{
+				char result[5];
+				sprintf(result, "%d", transaction_count % 1000);
 
-				ocpp_transaction_fail_all("Cloud command");
+				publish_debug_telemetry_observation_Diagnostics(result);
 				responseStatus = 200;
 			}
-			// Clear ocpp reservations
-			else if(strstr(commandString, "clear ocpp reservations") != NULL){
-				ESP_LOGI(TAG, "Got request to clear ocpp reservations");
+		}
+		// Clear ocpp transactions files
+		else if(strstr(commandString, "clear ocpp transactions") != NULL){
+			ESP_LOGI(TAG, "Got request to clear ocpp transactions");
 
-				ocpp_reservation_clear_info();
+			if(ocpp_transaction_clear_all() != 0) {
+				responseStatus = 500;
+			}else{
 				responseStatus = 200;
 			}
-			/*else if(strstr(commandString,"StartTimer") != NULL)
-			{
-				//chargeController_SetStartTimer();
-				chargeController_SendStartCommandToMCU(eCHARGE_SOURCE_SCHEDULE);
-				responseStatus = 200;
-			}*/
-
-
-			else if(strstr(commandString,"Loc ") != NULL)
-			{
-				//Remove end of string formatting
-				int end = strlen(commandString);
-				commandString[end-2] = '\0';
-
-				storage_Set_Location(&commandString[6]);
-				storage_SaveConfiguration();
-				publish_debug_telemetry_observation_TimeAndSchedule(0x7);
+		}
+		// Fail ocpp transactions messages
+		else if(strstr(commandString, "fail ocpp transactions") != NULL){
+			ESP_LOGI(TAG, "Got request to fail ocpp transactions");
 
-				chargeController_Activation();
+			ocpp_transaction_fail_all("Cloud command");
+			responseStatus = 200;
+		}
+		// Clear ocpp reservations
+		else if(strstr(commandString, "clear ocpp reservations") != NULL){
+			ESP_LOGI(TAG, "Got request to clear ocpp reservations");
 
-				responseStatus = 200;
-			}
+			ocpp_reservation_clear_info();
+			responseStatus = 200;
+		}
+		/*else if(strstr(commandString,"StartTimer") != NULL)
+		{
+			//chargeController_SetStartTimer();
+			chargeController_SendStartCommandToMCU(eCHARGE_SOURCE_SCHEDULE);
+			responseStatus = 200;
+		}*/
 
-			else if(strstr(commandString,"Tz ") != NULL)
-			{
-				//Remove end of string formatting
-				int end = strlen(commandString);
-				commandString[end-2] = '\0';
 
-				storage_Set_Timezone(&commandString[5]);
-				storage_SaveConfiguration();
-				publish_debug_telemetry_observation_TimeAndSchedule(0x7);
+		else if(strstr(commandString,"Loc ") != NULL)
+		{
+			//Remove end of string formatting
+			int end = strlen(commandString);
+			commandString[end-2] = '\0';
 
-				responseStatus = 200;
-			}
+			storage_Set_Location(&commandString[6]);
+			storage_SaveConfiguration();
+			publish_debug_telemetry_observation_TimeAndSchedule(0x7);
 
-			else if(strstr(commandString,"SS") != NULL)
-			{
-				if (strstr(commandString,"SSID")) {
-					// Probably SetNewWifi should handle this..
-					return responseStatus;
-				}
+			chargeController_Activation();
 
-				//chargeController_SendStartCommandToMCU(eCHARGE_SOURCE_SCHEDULE);
+			responseStatus = 200;
+		}
 
-				//Remove end of string formatting
-				int end = strlen(commandString);
-				commandString[end-2] = '\0';
-				if(end >= 19)
-				{
-					chargeController_WriteNewTimeSchedule(&commandString[4]);
-					chargeController_Activation();
-					storage_SaveConfiguration();
-					chargeController_SetRandomStartDelay();
-				}
-				else
-				{
-					char* p = "";
-					chargeController_WriteNewTimeSchedule(p);
-					chargeController_Activation();
-					storage_SaveConfiguration();
-					chargeController_ClearRandomStartDelay();
-					chargeController_ClearNextStartTime();
-					chargeController_SendStartCommandToMCU(eCHARGE_SOURCE_NO_SCHEDULE);
-				}
-				//chargeController_SetTimes();
+		else if(strstr(commandString,"Tz ") != NULL)
+		{
+			//Remove end of string formatting
+			int end = strlen(commandString);
+			commandString[end-2] = '\0';
 
+			storage_Set_Timezone(&commandString[5]);
+			storage_SaveConfiguration();
+			publish_debug_telemetry_observation_TimeAndSchedule(0x7);
 
+			responseStatus = 200;
+		}
 
-				publish_debug_telemetry_observation_TimeAndSchedule(0x7);
-				//chargeController_SetStartTimer();
-				responseStatus = 200;
+		else if(strstr(commandString,"SS") != NULL)
+		{
+			if (strstr(commandString,"SSID")) {
+				// Probably SetNewWifi should handle this..
+				return responseStatus;
 			}
 
-			else if(strstr(commandString,"NT") != NULL)
-			{
-				//chargeController_SendStartCommandToMCU(eCHARGE_SOURCE_SCHEDULE);
+			//chargeController_SendStartCommandToMCU(eCHARGE_SOURCE_SCHEDULE);
 
-				//Remove end of string formatting
-				int end = strlen(commandString);
-				commandString[end-2] = '\0';
-
-				chargeController_SetNowTime(&commandString[4]);
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"SIMSTOP") != NULL)
+			//Remove end of string formatting
+			int end = strlen(commandString);
+			commandString[end-2] = '\0';
+			if(end >= 19)
 			{
-				//505
-				sessionHandler_InitiateResetChargeSession();
-
-				//504
-				sessionHandler_InitiateResetChargeSession();
-				chargeSession_HoldUserUUID();
-
-				//502
-				MessageType ret = MCU_SendCommandId(CommandStopCharging);
-				if(ret == MsgCommandAck)
-				{
-					responseStatus = 200;
-					ESP_LOGI(TAG, "MCU Stop command OK");
-				}
-				else
-				{
-					responseStatus = 400;
-					ESP_LOGE(TAG, "MCU Stop command FAILED");
-				}
-
-				responseStatus = 200;
+				chargeController_WriteNewTimeSchedule(&commandString[4]);
+				chargeController_Activation();
+				storage_SaveConfiguration();
+				chargeController_SetRandomStartDelay();
 			}
-			else if(strstr(commandString,"StartNow") != NULL)
+			else
 			{
-				chargeController_Override();
-
-				responseStatus = 200;
+				char* p = "";
+				chargeController_WriteNewTimeSchedule(p);
+				chargeController_Activation();
+				storage_SaveConfiguration();
+				chargeController_ClearRandomStartDelay();
+				chargeController_ClearNextStartTime();
+				chargeController_SendStartCommandToMCU(eCHARGE_SOURCE_NO_SCHEDULE);
 			}
+			//chargeController_SetTimes();
 
-			else if(strstr(commandString,"SchedDiag") != NULL)
-			{
-				chargeController_SetSendScheduleDiagnosticsFlag();
 
-				responseStatus = 200;
-			}
 
-			/*else if(strstr(commandString,"ClearSchedule") != NULL)
-			{
-				storage_Initialize_ScheduleParameteres();
-				storage_SaveConfiguration();
-				publish_debug_telemetry_observation_TimeAndSchedule(0x7);
+			publish_debug_telemetry_observation_TimeAndSchedule(0x7);
+			//chargeController_SetStartTimer();
+			responseStatus = 200;
+		}
 
-				chargeController_Activation();
+		else if(strstr(commandString,"NT") != NULL)
+		{
+			//chargeController_SendStartCommandToMCU(eCHARGE_SOURCE_SCHEDULE);
 
-				chargeController_ClearNextStartTime();
+			//Remove end of string formatting
+			int end = strlen(commandString);
+			commandString[end-2] = '\0';
 
+			chargeController_SetNowTime(&commandString[4]);
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"SIMSTOP") != NULL)
+		{
+			//505
+			sessionHandler_InitiateResetChargeSession();
+
+			//504
+			sessionHandler_InitiateResetChargeSession();
+			chargeSession_HoldUserUUID();
+
+			//502
+			MessageType ret = MCU_SendCommandId(CommandStopCharging);
+			if(ret == MsgCommandAck)
+			{
 				responseStatus = 200;
-			}*/
-			else if(strstr(commandString,"SetSchedule") != NULL)
+				ESP_LOGI(TAG, "MCU Stop command OK");
+			}
+			else
 			{
-				if(strstr(commandString,"SetScheduleUK") != NULL)
-					storage_Initialize_UK_TestScheduleParameteres();
-				else if(strstr(commandString,"SetScheduleNO") != NULL)
-					storage_Initialize_NO_TestScheduleParameteres();
-				else
-					storage_Initialize_ScheduleParameteres();
-
-				storage_SaveConfiguration();
-				publish_debug_telemetry_observation_TimeAndSchedule(0x7);
+				responseStatus = 400;
+				ESP_LOGE(TAG, "MCU Stop command FAILED");
+			}
 
-				chargeController_Activation();
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"StartNow") != NULL)
+		{
+			chargeController_Override();
 
-				chargeController_ClearNextStartTime();
+			responseStatus = 200;
+		}
 
-				responseStatus = 200;
-			}
+		else if(strstr(commandString,"SchedDiag") != NULL)
+		{
+			chargeController_SetSendScheduleDiagnosticsFlag();
 
-			else if(strstr(commandString,"SetMaxStartDelay ") != NULL)
-			{
-				int newMaxValue = 0;
-				sscanf(&commandString[19], "%d", &newMaxValue);
-				if((newMaxValue >= 0) && (newMaxValue <= 3600))
-				{
-					storage_Set_MaxStartDelay(newMaxValue);
-					storage_SaveConfiguration();
-					chargeController_SetRandomStartDelay();
-				}
+			responseStatus = 200;
+		}
 
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"GetMCUSettings") != NULL)
-			{
-				if(strstr(commandString,"GetMCUSettings600") != NULL)
-					SetMCUDiagnosticsFrequency(600);
-				else if(strstr(commandString,"GetMCUSettings60") != NULL)
-					SetMCUDiagnosticsFrequency(60);
-				else if(strstr(commandString,"GetMCUSettings2") != NULL)
-					SetMCUDiagnosticsFrequency(2);
-				else
-					SetMCUDiagnosticsFrequency(1);
+		/*else if(strstr(commandString,"ClearSchedule") != NULL)
+		{
+			storage_Initialize_ScheduleParameteres();
+			storage_SaveConfiguration();
+			publish_debug_telemetry_observation_TimeAndSchedule(0x7);
 
-				responseStatus = 200;
-			}
+			chargeController_Activation();
 
-			else if(strstr(commandString,"GetOPENSamples") != NULL)
-			{
-				char samples[161] = {0};
-				MCU_GetOPENSamples(samples);
-				publish_debug_telemetry_observation_Diagnostics(samples);
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"AbortOTA") != NULL)
-			{
-				do_segment_ota_abort();
-				do_safe_ota_abort();
-				responseStatus = 200;
-			}
-			else if(strstr(commandString,"GetRelayStates") != NULL)
-			{
-				sessionHandler_SendRelayStates();
-				responseStatus = 200;
-			}
-			else if(strstr(commandString, "CoverProximity"))
-			{
-				if(strstr(commandString, "SetCoverProximity "))
-				{
-					int newProxValue = 0;
-					sscanf(&commandString[20], "%d", &newProxValue);
-					if((newProxValue >= 0) && (newProxValue <= 1000))
-					{
+			chargeController_ClearNextStartTime();
 
-						storage_Set_cover_on_value((uint16_t)newProxValue);
-						storage_SaveConfiguration();
-					}
-					responseStatus = 200;
-				}
-				else if(strstr(commandString, "GetCoverProximity"))
-				{
+			responseStatus = 200;
+		}*/
+		else if(strstr(commandString,"SetSchedule") != NULL)
+		{
+			if(strstr(commandString,"SetScheduleUK") != NULL)
+				storage_Initialize_UK_TestScheduleParameteres();
+			else if(strstr(commandString,"SetScheduleNO") != NULL)
+				storage_Initialize_NO_TestScheduleParameteres();
+			else
+				storage_Initialize_ScheduleParameteres();
 
-					char buf[50];
-					snprintf(buf, 50, "CoverPriximity: %i", storage_Get_cover_on_value());
+			storage_SaveConfiguration();
+			publish_debug_telemetry_observation_TimeAndSchedule(0x7);
 
-					publish_debug_telemetry_observation_Diagnostics(buf);
-					responseStatus = 200;
-				}
-				else if(strstr(commandString, "PrintCoverProximity"))
-				{
-					tamper_PrintProximity();
-					responseStatus = 200;
-				}
-				else if(strstr(commandString, "SendCoverProximity "))
-				{
-					int duration = 0;
-					sscanf(&commandString[21], "%d", &duration);
+			chargeController_Activation();
 
-					ESP_LOGW(TAG, "Setting duration %i", duration);
+			chargeController_ClearNextStartTime();
 
-					if((duration >= 0) && (duration <= 300000))
-					{
-						tamper_SendProximity(duration);
-						responseStatus = 200;
-					}
-					else
-					{
-						responseStatus = 400;
-					}
-				}
-				else if(strstr(commandString, "CalibrateCoverProximity"))
-				{
-					esp_err_t err = I2CCalibrateCoverProximity();
+			responseStatus = 200;
+		}
 
-					switch(err){
-					case ESP_OK:
-						responseStatus = 200;
-						break;
-					case ESP_FAIL:
-						responseStatus = 500;
-						break;
-					case ESP_ERR_NOT_SUPPORTED:
-						responseStatus = 501; // TODO: See if more appropriate status code exist. (405?)
-						break;
-					}
-				}
-			}
-			else if(strstr(commandString, "pppoff"))
+		else if(strstr(commandString,"SetMaxStartDelay ") != NULL)
+		{
+			int newMaxValue = 0;
+			sscanf(&commandString[19], "%d", &newMaxValue);
+			if((newMaxValue >= 0) && (newMaxValue <= 3600))
 			{
-				ppp_disconnect();
-				responseStatus = 200;
+				storage_Set_MaxStartDelay(newMaxValue);
+				storage_SaveConfiguration();
+				chargeController_SetRandomStartDelay();
 			}
-			else if(strstr(commandString,"SetOTAChunkSize ") != NULL)
-			{
-				int newSize = 0;
-				sscanf(&commandString[18], "%d", &newSize);
-				if((newSize > 64) && (newSize <= (65536*2)))
-				{
-					ota_set_chunk_size(newSize);
-				}
 
-				responseStatus = 200;
-			}
-			else if(strstr(commandString, "GetFPGAInfo"))
-			{
-				sessionHandler_SendFPGAInfo();
-				responseStatus = 200;
-			}
-			else if(strstr(commandString, "GetFailedRFID"))
-			{
-				char atqa[12] = {0};
-				uint16_t value = NFCGetLastFailedATQA();
-				snprintf(atqa, 12,"ATQA: %02X %02X", ((value>>8) & 0xff), (value & 0xff));
-				publish_debug_telemetry_observation_Diagnostics(atqa);
-				responseStatus = 200;
-			}
-			/*else if(strstr(commandString, "getpartitions"))
-			{
-				char buf[351]={0};
-				offlineSession_test_GetPartitions(buf);
-				ESP_LOGW(TAG, "Part buf len: %i", strlen(buf));
-				publish_debug_telemetry_observation_Diagnostics(buf);
-				responseStatus = 200;
-			}
-			else if(strstr(commandString, "erasefilespartition"))
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"GetMCUSettings") != NULL)
+		{
+			if(strstr(commandString,"GetMCUSettings600") != NULL)
+				SetMCUDiagnosticsFrequency(600);
+			else if(strstr(commandString,"GetMCUSettings60") != NULL)
+				SetMCUDiagnosticsFrequency(60);
+			else if(strstr(commandString,"GetMCUSettings2") != NULL)
+				SetMCUDiagnosticsFrequency(2);
+			else
+				SetMCUDiagnosticsFrequency(1);
+
+			responseStatus = 200;
+		}
+
+		else if(strstr(commandString,"GetOPENSamples") != NULL)
+		{
+			char samples[161] = {0};
+			MCU_GetOPENSamples(samples);
+			publish_debug_telemetry_observation_Diagnostics(samples);
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"AbortOTA") != NULL)
+		{
+			do_segment_ota_abort();
+			do_safe_ota_abort();
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"GetRelayStates") != NULL)
+		{
+			sessionHandler_SendRelayStates();
+			responseStatus = 200;
+		}
+		else if(strstr(commandString, "CoverProximity"))
+		{
+			if(strstr(commandString, "SetCoverProximity "))
 			{
-				esp_partition_t *part  = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, "files");
-
-				esp_err_t err = esp_partition_erase_range(part, 0, part->size);
-
-				char partbuf[50];
-				snprintf(partbuf, 50, "ErasePartitionResult: %i", err);
+				int newProxValue = 0;
+				sscanf(&commandString[20], "%d", &newProxValue);
+				if((newProxValue >= 0) && (newProxValue <= 1000))
+				{
 
-				publish_debug_telemetry_observation_Diagnostics(partbuf);
+					storage_Set_cover_on_value((uint16_t)newProxValue);
+					storage_SaveConfiguration();
+				}
 				responseStatus = 200;
 			}
-			else if(strstr(commandString, "getaccenergy"))
-			{
-				double accumulated_energy = OCMF_Write_Read_accumulated_energy(0.0);
-				ESP_LOGW(TAG, "Read accumulated energy: %f", accumulated_energy);
-				char accbuf[50];
-				snprintf(accbuf, 40, "ReadEnergy: %f", accumulated_energy);
-				publish_debug_telemetry_observation_Diagnostics(accbuf);
-			}
-			else if(strstr(commandString, "setaccenergy"))
+			else if(strstr(commandString, "GetCoverProximity"))
 			{
-				float newEnergy = 0;
-				sscanf(&commandString[14], "%f", &newEnergy);
-
-				double accumulated_energy = OCMF_Write_Read_accumulated_energy(newEnergy);
-				ESP_LOGW(TAG, "Wrote accumulated energy: %f", accumulated_energy);
-				char accbuf[50];
-				snprintf(accbuf, 40, "WroteEnergy: %f", accumulated_energy);
-				publish_debug_telemetry_observation_Diagnostics(accbuf);
-				publish_debug_telemetry_observation_Diagnostics(offlineSession_test_GetFileDiagnostics());
-				responseStatus = 200;
-			}
 
-			else if(strstr(commandString, "getmount"))
-			{
-				publish_debug_telemetry_observation_Diagnostics(offlineSession_test_GetFileDiagnostics());
-				responseStatus = 200;
-			}
-			else if(strstr(commandString, "testmount"))
-			{
-				offlineSession_mount_folder();
-				publish_debug_telemetry_observation_Diagnostics(offlineSession_test_GetFileDiagnostics());
-				responseStatus = 200;
-			}*/
-			/*else if(strstr(commandString, "testcreate"))
-			{
-				offlineSession_test_Createfile();
-				publish_debug_telemetry_observation_Diagnostics(offlineSession_test_GetFileDiagnostics());
-				responseStatus = 200;
-			}
-			else if(strstr(commandString, "testwrite"))
-			{
-				offlineSession_test_Writefile();
-				publish_debug_telemetry_observation_Diagnostics(offlineSession_test_GetFileDiagnostics());
-				responseStatus = 200;
-			}
-			else if(strstr(commandString, "testread"))
-			{
-				offlineSession_test_Readfile();
-				publish_debug_telemetry_observation_Diagnostics(offlineSession_test_GetFileDiagnostics());
+				char buf[50];
+				snprintf(buf, 50, "CoverPriximity: %i", storage_Get_cover_on_value());
+
+				publish_debug_telemetry_observation_Diagnostics(buf);
 				responseStatus = 200;
 			}
-			else if(strstr(commandString, "testdelete"))
+			else if(strstr(commandString, "PrintCoverProximity"))
 			{
-				offlineSession_test_Deletefile();
-				publish_debug_telemetry_observation_Diagnostics(offlineSession_test_GetFileDiagnostics());
+				tamper_PrintProximity();
 				responseStatus = 200;
 			}
-			else if(strstr(commandString, "readsessionfile"))
+			else if(strstr(commandString, "SendCoverProximity "))
 			{
-				offlineSession_Diagnostics_ReadFileContent(0);
-
-				publish_debug_telemetry_observation_Diagnostics(offlineSession_test_GetFileDiagnostics());
-				responseStatus = 200;
-			}*/
-			else if(strstr(commandString, "FixPartition"))
-			{
-				if(strstr(commandString, "FixPartitionFilesCheck"))
-				{
-					offlineSession_ClearDiagnostics();
-					offlineSession_CheckFilesSystem();
-					publish_debug_telemetry_observation_Diagnostics(offlineSession_GetDiagnostics());
-					responseStatus = 200;
-				}
-				else if(strstr(commandString, "FixPartitionFilesErase"))
-				{
-					offlineSession_ClearDiagnostics();
-					offlineSession_eraseAndRemountPartition();
-					publish_debug_telemetry_observation_Diagnostics(offlineSession_GetDiagnostics());
-					responseStatus = 200;
-				}
-				else if(strstr(commandString, "FixPartitionFilesCorrect"))
-				{
-					offlineSession_ClearDiagnostics();
-					offlineSession_CheckAndCorrectFilesSystem();
-					publish_debug_telemetry_observation_Diagnostics(offlineSession_GetDiagnostics());
-					responseStatus = 200;
-				}
-				else if(strstr(commandString, "FixPartitionDiskCheck"))
-				{
-					fat_ClearDiagnostics();
-					fat_CheckFilesSystem();
-					publish_debug_telemetry_observation_Diagnostics(fat_GetDiagnostics());
-					responseStatus = 200;
-				}
-				else if(strstr(commandString, "FixPartitionDiskErase"))
-				{
-					fat_ClearDiagnostics();
-					fat_CorrectFilesystem(); //Erases Disk partition
-					publish_debug_telemetry_observation_Diagnostics(fat_GetDiagnostics());
-					responseStatus = 200;
-				}
-				else if(strstr(commandString, "listdirectory")){
-					char * directory_path = index(commandString, '/');
-					if(directory_path != NULL && strlen(directory_path) > 0){
-
-						for(size_t i = strlen(directory_path)-1; i > 0; i--){
-							if(isspace((unsigned char)directory_path[i]) != 0 || directory_path[i] == '\\' || directory_path[i] == ']'
-								|| directory_path[i] == '"'){
-								directory_path[i] = '\0';
-							}
-						}
+				int duration = 0;
+				sscanf(&commandString[21], "%d", &duration);
 
-						ESP_LOGI(TAG, "Listing directory: '%s'", directory_path);
+				ESP_LOGW(TAG, "Setting duration %i", duration);
 
-						cJSON * result = cJSON_CreateObject();
-						if(result == NULL){
-							responseStatus = 500;
-						}else{
-							fat_list_directory(directory_path, result);
-							char * result_str = cJSON_PrintUnformatted(result);
-							cJSON_Delete(result);
-
-							if(result_str != NULL){
-								responseStatus = 200;
-								publish_debug_telemetry_observation_Diagnostics(result_str);
-								free(result_str);
-							}else{
-								responseStatus = 500;
-							}
-						}
-					}else{
-						ESP_LOGW(TAG, "listdirectory requested with missing path");
-						responseStatus = 400;
-					}
-				}
-				else if(strstr(commandString, "FixPartitionAndLog"))
+				if((duration >= 0) && (duration <= 300000))
 				{
-					char partbuf[150] = {0};
-					enum fat_id partition_id = -1;
-					if(strstr(commandString, "FixPartitionAndLogFiles"))
-					{
-						partition_id = eFAT_ID_FILES;
-					}
-					else if(strstr(commandString, "FixPartitionAndLogDisk"))
-					{
-						partition_id = eFAT_ID_DISK;
-					}
-
-					if(partition_id != -1){
-						fat_fix_and_log_result(partition_id, partbuf, sizeof(partbuf));
-
-						publish_debug_telemetry_observation_Diagnostics(partbuf);
-
-						responseStatus = 200;
-					}else{
-						ESP_LOGW(TAG, "fixpartition with invalid partition requested");
-						responseStatus = 400;
-					}
+					tamper_SendProximity(duration);
+					responseStatus = 200;
 				}
 				else
 				{
 					responseStatus = 400;
 				}
 			}
-			else if(strstr(commandString, "GetFileDiagnostics"))
+			else if(strstr(commandString, "CalibrateCoverProximity"))
 			{
-				publish_debug_telemetry_observation_Diagnostics(offlineSession_GetDiagnostics());
-				responseStatus = 200;
-			}
-#ifdef CONFIG_ZAPTEC_DIAGNOSTICS_LOG
-			else if(strstr(commandString, "EnableLogDiagnostics"))
-			{
-				storage_Set_DiagnosticsLogEnabled(true);
-				storage_SaveConfiguration();
-				if(diagnostics_log_init() == ESP_OK){
-					responseStatus = 200;
-				}else{
-					responseStatus = 500;
-				}
-			}
-			else if(strstr(commandString, "DisabletLogDiagnostics"))
-			{
-				storage_Set_DiagnosticsLogEnabled(false);
-				storage_SaveConfiguration();
-				if(diagnostics_log_deinit() == ESP_OK){
+				esp_err_t err = I2CCalibrateCoverProximity();
+
+				switch(err){
+				case ESP_OK:
 					responseStatus = 200;
-				}else{
+					break;
+				case ESP_FAIL:
 					responseStatus = 500;
+					break;
+				case ESP_ERR_NOT_SUPPORTED:
+					responseStatus = 501; // TODO: See if more appropriate status code exist. (405?)
+					break;
 				}
 			}
-			else if(strstr(commandString, "EmptyLogDiagnostics"))
+		}
+		else if(strstr(commandString, "pppoff"))
+		{
+			ppp_disconnect();
+			responseStatus = 200;
+		}
+		else if(strstr(commandString,"SetOTAChunkSize ") != NULL)
+		{
+			int newSize = 0;
+			sscanf(&commandString[18], "%d", &newSize);
+			if((newSize > 64) && (newSize <= (65536*2)))
 			{
-				ESP_LOGW(TAG, "Emptying Diagnostics_log");
-				esp_err_t err = diagnostics_log_empty();
-				if(err == ESP_OK){
-					responseStatus = 200;
-				}else{
-					ESP_LOGE(TAG, "Unable to empty diagnostics log: %s | %s", esp_err_to_name(err), strerror(errno));
-					responseStatus = 500;
-				}
+				ota_set_chunk_size(newSize);
 			}
-			else if(strstr(commandString, "FillLogDiagnostics")){
-				// Example with arguments: FillLogDiagnostics:E,W,50,2100,16
-				esp_log_level_t log_level_from = ESP_LOG_INFO;
-				esp_log_level_t log_level_to = ESP_LOG_INFO;
-
-				size_t size_params[3][3] = {
-					{16, 2, 4096}, // minimum entry size
-					{36, 2, 4096}, // maximum entry size
-					{16, 1, 256} // entry count
-				}; // Each row has a default value, a minimum value and a maximum value.
-
-				char * argument_list = strchr(commandString, ':');
-				if(argument_list != NULL){
-					argument_list++;
-
-					char * arg = strtok(argument_list, ",");
-					if(arg != NULL){
-						log_level_from = esp_log_level_from_char(arg[0]);
-					}else{
-						log_level_from = ESP_LOG_INFO;
-					}
-
-					arg = strtok(NULL, ",");
-					if(arg != NULL){
-						log_level_to = esp_log_level_from_char(arg[0]);
-					}else{
-						log_level_to = ESP_LOG_INFO;
-					}
-
-					for(size_t i = 0; i < 3; i++){
-						arg = strtok(NULL, ",");
-						if(arg != NULL){
-							long value = strtol(arg, NULL, 10);
-							if(value > size_params[i][1] || value < size_params[i][2]){
-								size_params[i][0] = value;
-							}
-						}
-					}
-				}
 
-				ESP_LOGI(TAG, "Filling log with %d entries with level %d - %d and length %u - %u", size_params[2][0], log_level_from, log_level_to, size_params[0][0], size_params[1][0]);
+			responseStatus = 200;
+		}
+		else if(strstr(commandString, "GetFPGAInfo"))
+		{
+			sessionHandler_SendFPGAInfo();
+			responseStatus = 200;
+		}
+		else if(strstr(commandString, "GetFailedRFID"))
+		{
+			char atqa[12] = {0};
+			uint16_t value = NFCGetLastFailedATQA();
+			snprintf(atqa, 12,"ATQA: %02X %02X", ((value>>8) & 0xff), (value & 0xff));
+			publish_debug_telemetry_observation_Diagnostics(atqa);
+			responseStatus = 200;
+		}
+		/*else if(strstr(commandString, "getpartitions"))
+		{
+			char buf[351]={0};
+			offlineSession_test_GetPartitions(buf);
+			ESP_LOGW(TAG, "Part buf len: %i", strlen(buf));
+			publish_debug_telemetry_observation_Diagnostics(buf);
+			responseStatus = 200;
+		}
+		else if(strstr(commandString, "erasefilespartition"))
+		{
+			esp_partition_t *part  = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, "files");
 
-				uint log_range = log_level_to - log_level_from;
-				uint entry_size_range = size_params[1][0] - size_params[0][0];
+			esp_err_t err = esp_partition_erase_range(part, 0, part->size);
 
-				for(size_t i = 0; i < size_params[2][0]; i++){
-					uint32_t value = esp_random();
-					uint log_level;
-					uint entry_size;
+			char partbuf[50];
+			snprintf(partbuf, 50, "ErasePartitionResult: %i", err);
 
-					log_level = log_level_from + (value % (log_range +1));
-					entry_size = size_params[0][0] + (value % (entry_size_range +1));
+			publish_debug_telemetry_observation_Diagnostics(partbuf);
+			responseStatus = 200;
+		}
+		else if(strstr(commandString, "getaccenergy"))
+		{
+			double accumulated_energy = OCMF_Write_Read_accumulated_energy(0.0);
+			ESP_LOGW(TAG, "Read accumulated energy: %f", accumulated_energy);
+			char accbuf[50];
+			snprintf(accbuf, 40, "ReadEnergy: %f", accumulated_energy);
+			publish_debug_telemetry_observation_Diagnostics(accbuf);
+		}
+		else if(strstr(commandString, "setaccenergy"))
+		{
+			float newEnergy = 0;
+			sscanf(&commandString[14], "%f", &newEnergy);
+
+			double accumulated_energy = OCMF_Write_Read_accumulated_energy(newEnergy);
+			ESP_LOGW(TAG, "Wrote accumulated energy: %f", accumulated_energy);
+			char accbuf[50];
+			snprintf(accbuf, 40, "WroteEnergy: %f", accumulated_energy);
+			publish_debug_telemetry_observation_Diagnostics(accbuf);
+			publish_debug_telemetry_observation_Diagnostics(offlineSession_test_GetFileDiagnostics());
+			responseStatus = 200;
+		}
 
-					ESP_LOG_LEVEL(log_level, TAG, "%u - %0*u", i, entry_size - 7,0);
-				}
+		else if(strstr(commandString, "getmount"))
+		{
+			publish_debug_telemetry_observation_Diagnostics(offlineSession_test_GetFileDiagnostics());
+			responseStatus = 200;
+		}
+		else if(strstr(commandString, "testmount"))
+		{
+			offlineSession_mount_folder();
+			publish_debug_telemetry_observation_Diagnostics(offlineSession_test_GetFileDiagnostics());
+			responseStatus = 200;
+		}*/
+		/*else if(strstr(commandString, "testcreate"))
+		{
+			offlineSession_test_Createfile();
+			publish_debug_telemetry_observation_Diagnostics(offlineSession_test_GetFileDiagnostics());
+			responseStatus = 200;
+		}
+		else if(strstr(commandString, "testwrite"))
+		{
+			offlineSession_test_Writefile();
+			publish_debug_telemetry_observation_Diagnostics(offlineSession_test_GetFileDiagnostics());
+			responseStatus = 200;
+		}
+		else if(strstr(commandString, "testread"))
+		{
+			offlineSession_test_Readfile();
+			publish_debug_telemetry_observation_Diagnostics(offlineSession_test_GetFileDiagnostics());
+			responseStatus = 200;
+		}
+		else if(strstr(commandString, "testdelete"))
+		{
+			offlineSession_test_Deletefile();
+			publish_debug_telemetry_observation_Diagnostics(offlineSession_test_GetFileDiagnostics());
+			responseStatus = 200;
+		}
+		else if(strstr(commandString, "readsessionfile"))
+		{
+			offlineSession_Diagnostics_ReadFileContent(0);
 
-				responseStatus = 200;
-			}
-			else if(strstr(commandString, "GetLogDiagnostics"))
+			publish_debug_telemetry_observation_Diagnostics(offlineSession_test_GetFileDiagnostics());
+			responseStatus = 200;
+		}*/
+		else if(strstr(commandString, "FixPartition"))
+		{
+			if(strstr(commandString, "FixPartitionFilesCheck"))
 			{
-				ESP_LOGW(TAG, "Diagnostics_log requested. Good luck");
-				esp_err_t result = diagnostics_log_publish_as_event();
-				if(result == ESP_OK){
-					responseStatus = 200;
-					ESP_LOGI(TAG, "Print success");
-				}else{
-					ESP_LOGE(TAG, "Unable to print: %s", esp_err_to_name(result));
-					responseStatus = 500;
-				}
+				offlineSession_ClearDiagnostics();
+				offlineSession_CheckFilesSystem();
+				publish_debug_telemetry_observation_Diagnostics(offlineSession_GetDiagnostics());
+				responseStatus = 200;
 			}
-#endif /* CONFIG_ZAPTEC_DIAGNOSTICS_LOG */
-			else if(strstr(commandString, "RunRCDTest"))
+			else if(strstr(commandString, "FixPartitionFilesErase"))
 			{
-				MessageType ret = MCU_SendCommandId(CommandRunRCDTest);
-				if(ret == MsgCommandAck)
-				{
-
-					ESP_LOGW(TAG, "MCU RunRCDTest command OK");
-					if(isMqttConnected())
-					{
-						publish_debug_telemetry_observation_Diagnostics("Cloud: RCD button test run");
-					}
-					responseStatus = 200;
-				}
-				else
-				{
-					ESP_LOGE(TAG, "MCU RunRCDTest command FAILED");
-					responseStatus = 400;
-				}
+				offlineSession_ClearDiagnostics();
+				offlineSession_eraseAndRemountPartition();
+				publish_debug_telemetry_observation_Diagnostics(offlineSession_GetDiagnostics());
+				responseStatus = 200;
 			}
-			else if(strstr(commandString, "GetMemoryStatus"))
+			else if(strstr(commandString, "FixPartitionFilesCorrect"))
 			{
-				if(strstr(commandString, "GetMemoryStatus1"))
-					SetMemoryDiagnosticsFrequency(1);
-				else if(strstr(commandString, "GetMemoryStatus3600"))
-					SetMemoryDiagnosticsFrequency(3600);
-				else
-					SetMemoryDiagnosticsFrequency(0);
-
+				offlineSession_ClearDiagnostics();
+				offlineSession_CheckAndCorrectFilesSystem();
+				publish_debug_telemetry_observation_Diagnostics(offlineSession_GetDiagnostics());
 				responseStatus = 200;
 			}
-			else if(strstr(commandString, "ConnectTo"))
+			else if(strstr(commandString, "FixPartitionDiskCheck"))
 			{
-				if(strstr(commandString, "ConnectToProd"))
-				{
-					storage_Set_ConnectToPortalType(PORTAL_TYPE_PROD_DEFAULT);
-					ESP_LOGW(TAG, "Connecting to PROD after boot");
-					storage_SaveConfiguration();
-					responseStatus = 200;
-				}
-				else if(strstr(commandString, "ConnectToDev"))
-				{
-					storage_Set_ConnectToPortalType(PORTAL_TYPE_DEV);
-					ESP_LOGW(TAG, "Connecting to DEV after boot");
-					storage_SaveConfiguration();
-					responseStatus = 200;
-				}
+				fat_ClearDiagnostics();
+				fat_CheckFilesSystem();
+				publish_debug_telemetry_observation_Diagnostics(fat_GetDiagnostics());
+				responseStatus = 200;
 			}
-			else if(strstr(commandString, "PulseType"))
+			else if(strstr(commandString, "FixPartitionDiskErase"))
 			{
-				if(strstr(commandString, "PulseType 0"))
-				{
-					storage_Set_PulseType(ePULSE_IOT_HUB);
-					ESP_LOGW(TAG, "Pulse: Iot-hub");
-					storage_SaveConfiguration();
-					responseStatus = 200;
-				}
-				else if(strstr(commandString, "PulseType 1"))
-				{
-					storage_Set_PulseType(eMQTT_KEEP_ALIVE);
-					ESP_LOGW(TAG, "Pulse: mqtt keep alive");
-					storage_SaveConfiguration();
-					responseStatus = 200;
-				}
+				fat_ClearDiagnostics();
+				fat_CorrectFilesystem(); //Erases Disk partition
+				publish_debug_telemetry_observation_Diagnostics(fat_GetDiagnostics());
+				responseStatus = 200;
 			}
 			else if(strstr(commandString, "listdirectory")){
 				char * directory_path = index(commandString, '/');
@@ -3454,149 +3588,389 @@ int ParseCommandFromCloud(esp_mqtt_event_handle_t commandEvent)
 					responseStatus = 400;
 				}
 			}
-			else if(strstr(commandString, "TestFileCorrection"))
+			else if(strstr(commandString, "FixPartitionAndLog"))
+			{
+				char partbuf[150] = {0};
+				enum fat_id partition_id = -1;
+				if(strstr(commandString, "FixPartitionAndLogFiles"))
+				{
+					partition_id = eFAT_ID_FILES;
+				}
+				else if(strstr(commandString, "FixPartitionAndLogDisk"))
+				{
+					partition_id = eFAT_ID_DISK;
+				}
+
+				if(partition_id != -1){
+					fat_fix_and_log_result(partition_id, partbuf, sizeof(partbuf));
+
+					publish_debug_telemetry_observation_Diagnostics(partbuf);
+
+					responseStatus = 200;
+				}else{
+					ESP_LOGW(TAG, "fixpartition with invalid partition requested");
+					responseStatus = 400;
+				}
+			}
+			else
+			{
+				responseStatus = 400;
+			}
+		}
+		else if(strstr(commandString, "GetFileDiagnostics"))
+		{
+			publish_debug_telemetry_observation_Diagnostics(offlineSession_GetDiagnostics());
+			responseStatus = 200;
+		}
+#ifdef CONFIG_ZAPTEC_DIAGNOSTICS_LOG
+		else if(strstr(commandString, "EnableLogDiagnostics"))
+		{
+			storage_Set_DiagnosticsLogEnabled(true);
+			storage_SaveConfiguration();
+			if(diagnostics_log_init() == ESP_OK){
+				responseStatus = 200;
+			}else{
+				responseStatus = 500;
+			}
+		}
+		else if(strstr(commandString, "DisabletLogDiagnostics"))
+		{
+			storage_Set_DiagnosticsLogEnabled(false);
+			storage_SaveConfiguration();
+			if(diagnostics_log_deinit() == ESP_OK){
+				responseStatus = 200;
+			}else{
+				responseStatus = 500;
+			}
+		}
+		else if(strstr(commandString, "EmptyLogDiagnostics"))
+		{
+			ESP_LOGW(TAG, "Emptying Diagnostics_log");
+			esp_err_t err = diagnostics_log_empty();
+			if(err == ESP_OK){
+				responseStatus = 200;
+			}else{
+				ESP_LOGE(TAG, "Unable to empty diagnostics log: %s | %s", esp_err_to_name(err), strerror(errno));
+				responseStatus = 500;
+			}
+		}
+		else if(strstr(commandString, "FillLogDiagnostics")){
+			// Example with arguments: FillLogDiagnostics:E,W,50,2100,16
+			esp_log_level_t log_level_from = ESP_LOG_INFO;
+			esp_log_level_t log_level_to = ESP_LOG_INFO;
+
+			size_t size_params[3][3] = {
+				{16, 2, 4096}, // minimum entry size
+				{36, 2, 4096}, // maximum entry size
+				{16, 1, 256} // entry count
+			}; // Each row has a default value, a minimum value and a maximum value.
+
+			char * argument_list = strchr(commandString, ':');
+			if(argument_list != NULL){
+				argument_list++;
+
+				char * arg = strtok(argument_list, ",");
+				if(arg != NULL){
+					log_level_from = esp_log_level_from_char(arg[0]);
+				}else{
+					log_level_from = ESP_LOG_INFO;
+				}
+
+				arg = strtok(NULL, ",");
+				if(arg != NULL){
+					log_level_to = esp_log_level_from_char(arg[0]);
+				}else{
+					log_level_to = ESP_LOG_INFO;
+				}
+
+				for(size_t i = 0; i < 3; i++){
+					arg = strtok(NULL, ",");
+					if(arg != NULL){
+						long value = strtol(arg, NULL, 10);
+						if(value > size_params[i][1] || value < size_params[i][2]){
+							size_params[i][0] = value;
+						}
+					}
+				}
+			}
+
+			ESP_LOGI(TAG, "Filling log with %d entries with level %d - %d and length %u - %u", size_params[2][0], log_level_from, log_level_to, size_params[0][0], size_params[1][0]);
+
+			uint log_range = log_level_to - log_level_from;
+			uint entry_size_range = size_params[1][0] - size_params[0][0];
+
+			for(size_t i = 0; i < size_params[2][0]; i++){
+				uint32_t value = esp_random();
+				uint log_level;
+				uint entry_size;
+
+				log_level = log_level_from + (value % (log_range +1));
+				entry_size = size_params[0][0] + (value % (entry_size_range +1));
+
+				ESP_LOG_LEVEL(log_level, TAG, "%u - %0*u", i, entry_size - 7,0);
+			}
+
+			responseStatus = 200;
+		}
+		else if(strstr(commandString, "GetLogDiagnostics"))
+		{
+			ESP_LOGW(TAG, "Diagnostics_log requested. Good luck");
+			esp_err_t result = diagnostics_log_publish_as_event();
+			if(result == ESP_OK){
+				responseStatus = 200;
+				ESP_LOGI(TAG, "Print success");
+			}else{
+				ESP_LOGE(TAG, "Unable to print: %s", esp_err_to_name(result));
+				responseStatus = 500;
+			}
+		}
+#endif /* CONFIG_ZAPTEC_DIAGNOSTICS_LOG */
+		else if(strstr(commandString, "RunRCDTest"))
+		{
+			MessageType ret = MCU_SendCommandId(CommandRunRCDTest);
+			if(ret == MsgCommandAck)
+			{
+
+				ESP_LOGW(TAG, "MCU RunRCDTest command OK");
+				if(isMqttConnected())
+				{
+					publish_debug_telemetry_observation_Diagnostics("Cloud: RCD button test run");
+				}
+				responseStatus = 200;
+			}
+			else
+			{
+				ESP_LOGE(TAG, "MCU RunRCDTest command FAILED");
+				responseStatus = 400;
+			}
+		}
+		else if(strstr(commandString, "GetMemoryStatus"))
+		{
+			if(strstr(commandString, "GetMemoryStatus1"))
+				SetMemoryDiagnosticsFrequency(1);
+			else if(strstr(commandString, "GetMemoryStatus3600"))
+				SetMemoryDiagnosticsFrequency(3600);
+			else
+				SetMemoryDiagnosticsFrequency(0);
+
+			responseStatus = 200;
+		}
+		else if(strstr(commandString, "ConnectTo"))
+		{
+			if(strstr(commandString, "ConnectToProd"))
 			{
-				ESP_LOGI(TAG, "Testing FileCorrection");
-				chargeSession_SetTestFileCorrection();
+				storage_Set_ConnectToPortalType(PORTAL_TYPE_PROD_DEFAULT);
+				ESP_LOGW(TAG, "Connecting to PROD after boot");
+				storage_SaveConfiguration();
 				responseStatus = 200;
 			}
-			else if(strstr(commandString, "Reconnect"))
+			else if(strstr(commandString, "ConnectToDev"))
 			{
-				ESP_LOGI(TAG, "Reconnect");
-				reconnectFlag = true;
+				storage_Set_ConnectToPortalType(PORTAL_TYPE_DEV);
+				ESP_LOGW(TAG, "Connecting to DEV after boot");
+				storage_SaveConfiguration();
 				responseStatus = 200;
 			}
-			else if(strstr(commandString, "OCPP"))
+		}
+		else if(strstr(commandString, "PulseType"))
+		{
+			if(strstr(commandString, "PulseType 0"))
 			{
-				bool controller_change = false;
-				bool old_controller = storage_Get_session_controller();
-
-				if(strstr(commandString, "OCPPURL:"))
-				{
-					int end = strlen(commandString);
-					commandString[end-2] = '\0';
-
-					int len = strlen(&commandString[10]);
-					if(len <= CONFIG_OCPP_URL_MAX_LENGTH)
-					{
-						ESP_LOGI(TAG, "Setting OCPP URL: %s", &commandString[10]);
-
-						storage_Set_url_ocpp(&commandString[10]);
-						storage_SaveConfiguration();
-
-						controller_change = true;
-						responseStatus = 200;
-					}
-					else
-					{
-						responseStatus = 400;
+				storage_Set_PulseType(ePULSE_IOT_HUB);
+				ESP_LOGW(TAG, "Pulse: Iot-hub");
+				storage_SaveConfiguration();
+				responseStatus = 200;
+			}
+			else if(strstr(commandString, "PulseType 1"))
+			{
+				storage_Set_PulseType(eMQTT_KEEP_ALIVE);
+				ESP_LOGW(TAG, "Pulse: mqtt keep alive");
+				storage_SaveConfiguration();
+				responseStatus = 200;
+			}
+		}
+		else if(strstr(commandString, "listdirectory")){
+			char * directory_path = index(commandString, '/');
+			if(directory_path != NULL && strlen(directory_path) > 0){
+
+				for(size_t i = strlen(directory_path)-1; i > 0; i--){
+					if(isspace((unsigned char)directory_path[i]) != 0 || directory_path[i] == '\\' || directory_path[i] == ']'
+						|| directory_path[i] == '"'){
+						directory_path[i] = '\0';
 					}
 				}
-				else if(strstr(commandString, "OCPPAUTHKEY:"))
-				{
-					int end = strlen(commandString);
-					commandString[end-2] = '\0';
 
-					int len = strlen(&commandString[14]);
-					if(len < 41)//Max ocpp_authorization_key length
-					{
-						ESP_LOGI(TAG, "Setting OCPP AUTH KEY: %s", &commandString[10]);
+				ESP_LOGI(TAG, "Listing directory: '%s'", directory_path);
 
-						storage_Set_ocpp_authorization_key(&commandString[10]);
-						storage_Set_authorization_key_set_from_zaptec_ocpp(true);
-						storage_SaveConfiguration();
+				cJSON * result = cJSON_CreateObject();
+				if(result == NULL){
+					responseStatus = 500;
+				}else{
+					fat_list_directory(directory_path, result);
+					char * result_str = cJSON_PrintUnformatted(result);
+					cJSON_Delete(result);
 
-						controller_change = true;
+					if(result_str != NULL){
 						responseStatus = 200;
-					}
-					else
-					{
-						responseStatus = 400;
+						publish_debug_telemetry_observation_Diagnostics(result_str);
+						free(result_str);
+					}else{
+						responseStatus = 500;
 					}
 				}
-				else if(strstr(commandString, "OCPPMODE:"))
+			}else{
+				ESP_LOGW(TAG, "listdirectory requested with missing path");
+				responseStatus = 400;
+			}
+		}
+		else if(strstr(commandString, "TestFileCorrection"))
+		{
+			ESP_LOGI(TAG, "Testing FileCorrection");
+			chargeSession_SetTestFileCorrection();
+			responseStatus = 200;
+		}
+		else if(strstr(commandString, "Reconnect"))
+		{
+			ESP_LOGI(TAG, "Reconnect");
+			reconnectFlag = true;
+			responseStatus = 200;
+		}
+		else if(strstr(commandString, "OCPP"))
+		{
+			bool controller_change = false;
+			bool old_controller = storage_Get_session_controller();
+
+			if(strstr(commandString, "OCPPURL:"))
+			{
+				int end = strlen(commandString);
+				commandString[end-2] = '\0';
+
+				int len = strlen(&commandString[10]);
+				if(len <= CONFIG_OCPP_URL_MAX_LENGTH)
 				{
-					enum session_controller new_session_controller = new_session_controller;
-					if(strstr(commandString, "OCPPMODE: 0"))
-						new_session_controller = eSESSION_ZAPTEC_CLOUD;
-					else if (strstr(commandString, "OCPPMODE: 1"))
-						new_session_controller = eSESSION_STANDALONE;
-					else if (strstr(commandString, "OCPPMODE: 2"))
-						new_session_controller = eSESSION_OCPP;
-
-					ESP_LOGW(TAG, "New:  session controller: %x", new_session_controller);
-					storage_Set_session_controller(new_session_controller);
+					ESP_LOGI(TAG, "Setting OCPP URL: %s", &commandString[10]);
+
+					storage_Set_url_ocpp(&commandString[10]);
 					storage_SaveConfiguration();
 
 					controller_change = true;
+					responseStatus = 200;
 				}
-
-				if(controller_change){
-					on_controller_change(old_controller, storage_Get_session_controller());
-					storage_SaveConfiguration();
+				else
+				{
+					responseStatus = 400;
 				}
 			}
-			else if(strstr(commandString, "ocpp allow lte"))
+			else if(strstr(commandString, "OCPPAUTHKEY:"))
 			{
-				ESP_LOGI(TAG, "Requested to allow/disallow OCPP on LTE");
-				char * param_index = strstr(commandString, "ocpp allow lte") + strlen("ocpp allow lte");
+				int end = strlen(commandString);
+				commandString[end-2] = '\0';
 
-				while(isblank(*param_index))
-					param_index++;
+				int len = strlen(&commandString[14]);
+				if(len < 41)//Max ocpp_authorization_key length
+				{
+					ESP_LOGI(TAG, "Setting OCPP AUTH KEY: %s", &commandString[10]);
 
-				bool allow = false;
-				if(param_index == NULL){
-					responseStatus = 400;
-				}else if(strncasecmp(param_index, "true", strlen("true")) == 0){
-					param_index = param_index + strlen("true");
-					responseStatus = 200;
-					allow = true;
+					storage_Set_ocpp_authorization_key(&commandString[10]);
+					storage_Set_authorization_key_set_from_zaptec_ocpp(true);
+					storage_SaveConfiguration();
 
-				}else if(strncasecmp(param_index, "false", strlen("false")) == 0){
-					param_index = param_index + strlen("false");
+					controller_change = true;
 					responseStatus = 200;
-					allow = false;
-
-				}else{
+				}
+				else
+				{
 					responseStatus = 400;
 				}
+			}
+			else if(strstr(commandString, "OCPPMODE:"))
+			{
+				enum session_controller new_session_controller = new_session_controller;
+				if(strstr(commandString, "OCPPMODE: 0"))
+					new_session_controller = eSESSION_ZAPTEC_CLOUD;
+				else if (strstr(commandString, "OCPPMODE: 1"))
+					new_session_controller = eSESSION_STANDALONE;
+				else if (strstr(commandString, "OCPPMODE: 2"))
+					new_session_controller = eSESSION_OCPP;
 
-				if(responseStatus == 200){
-					while(isblank(*param_index))
-						param_index++;
-
-					if(*param_index != '\"' || *(param_index+1) != ']' || *(param_index+2) != '\0')
-						responseStatus = 400;
-				}
+				ESP_LOGW(TAG, "New:  session controller: %x", new_session_controller);
+				storage_Set_session_controller(new_session_controller);
+				storage_SaveConfiguration();
 
-				if(responseStatus == 200){
-					storage_Set_allow_lte_ocpp(allow);
-					ESP_LOGI(TAG, "New allow_lte_ocpp value is: %s", storage_Get_allow_lte_ocpp() ? "True" : "False");
-				}
+				controller_change = true;
 			}
-			else
-			{
-				responseStatus = 400;
+
+			if(controller_change){
+				on_controller_change(old_controller, storage_Get_session_controller());
+				storage_SaveConfiguration();
 			}
 		}
-	}
-	else if(strstr(commandEvent->topic, "iothub/methods/POST/804/"))
-	{
-		ESP_LOGI(TAG, "GridTest command");
-		MessageType ret = MCU_SendCommandId(CommandRunGridTest);
-		if(ret == MsgCommandAck)
+		else if(strstr(commandString, "ocpp allow lte"))
 		{
-			responseStatus = 200;
-			ESP_LOGI(TAG, "MCU GridTest command OK");
-			reportGridTestResults = true;
+			ESP_LOGI(TAG, "Requested to allow/disallow OCPP on LTE");
+			char * param_index = strstr(commandString, "ocpp allow lte") + strlen("ocpp allow lte");
+
+			while(isblank(*param_index))
+				param_index++;
+
+			bool allow = false;
+			if(param_index == NULL){
+				responseStatus = 400;
+			}else if(strncasecmp(param_index, "true", strlen("true")) == 0){
+				param_index = param_index + strlen("true");
+				responseStatus = 200;
+				allow = true;
+
+			}else if(strncasecmp(param_index, "false", strlen("false")) == 0){
+				param_index = param_index + strlen("false");
+				responseStatus = 200;
+				allow = false;
+
+			}else{
+				responseStatus = 400;
+			}
+
+			if(responseStatus == 200){
+				while(isblank(*param_index))
+					param_index++;
+
+				if(*param_index != '\"' || *(param_index+1) != ']' || *(param_index+2) != '\0')
+					responseStatus = 400;
+			}
+
+			if(responseStatus == 200){
+				storage_Set_allow_lte_ocpp(allow);
+				ESP_LOGI(TAG, "New allow_lte_ocpp value is: %s", storage_Get_allow_lte_ocpp() ? "True" : "False");
+			}
 		}
 		else
 		{
 			responseStatus = 400;
-			ESP_LOGI(TAG, "MCU GridTest command FAILED");
 		}
+	}
+
+	return responseStatus;
+}
+
+static int command_grid_test(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	int responseStatus = 0;
+
+	ESP_LOGI(TAG, "GridTest command");
+	MessageType ret = MCU_SendCommandId(CommandRunGridTest);
+	if(ret == MsgCommandAck)
+	{
 		responseStatus = 200;
+		ESP_LOGI(TAG, "MCU GridTest command OK");
+		reportGridTestResults = true;
+	}
+	else
+	{
+		responseStatus = 400;
+		ESP_LOGI(TAG, "MCU GridTest command FAILED");
 	}
+	responseStatus = 200;
+
 	return responseStatus;
 }
 
@@ -3648,6 +4022,213 @@ static void BuildLocalSettingsResponse(char * responseBuffer)
 
 
 
+static int command_local_settings(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	if(call->data_len > 10)
+	{
+		ParseLocalSettingsFromCloud(call->data, call->data_len);
+	}
+
+	BuildLocalSettingsResponse(response);
+	ESP_LOGW(TAG, "responseStringLength: %d, responseBuffer: %s", strlen(response), response);
+
+	return 200;
+}
+
+//Handle incoming offline AuthenticationList
+static int command_offline_authentication_list(const struct cloud_method_call * call, char * response, size_t response_size)
+{
+	ESP_LOGW(TAG, "***** Data len: %d *****", call->data_len);
+
+	//Limit max size since we have not testet with large data size(many tags in package)
+	if((3000 > call->data_len) && (call->data_len > 10))
+	{
+		//Remove '\\' escape character due to uint8_t->char conversion
+		char * rfidList = calloc(call->data_len, 1);
+		if(rfidList == NULL)
+			return 400;
+
+		int nextChar = 0;
+		for (int i = 0; i < call->data_len; i++)
+		{
+			if(call->data[i] != '\\')
+			{
+				rfidList[nextChar] = call->data[i];
+				nextChar++;
+			}
+		}
+		rfidList[nextChar] = '\0';
+
+		int version = authentication_ParseOfflineList(rfidList, strlen(rfidList));
+
+		free(rfidList);
+
+		ESP_LOGI(TAG, "***** AuthenticationListVersion: %d *****", version);
+
+		if(version >= 0)
+		{
+			//Set flag value to trig sending of AuthenticationListVersion from SessionHandler
+			rfidListIsUpdated = version;
+		}
+	}
+
+	return 200;
+}
+
+/*
+ * Most handlers copy the payload to the stack, so payloads are limited before a handler is called. The offline
+ * authentication list is the only long payload and is copied to the heap.
+ */
+#define METHOD_DATA_MAX_LENGTH 512
+#define METHOD_AUTHENTICATION_LIST_MAX_LENGTH 3000
+
+/*
+ * Direct methods sorted by method number for cloud_method_find. Handlers that wait for the MCU or otherwise block are
+ * deferred to method_task so that the MQTT task can keep receiving and sending while they run. Their responses may
+ * therefore be sent after responses to methods received later; the cloud matches responses by request id.
+ *
+ * Handlers that write settings or files run on the MQTT task even if they block, so that they do not write storage at
+ * the same time as cloud settings received on the MQTT task.
+ */
+static const struct cloud_method_handler method_handlers[] = {
+	{1, command_ping_reply, 0, METHOD_DATA_MAX_LENGTH},
+	{102, command_restart_esp, 0, METHOD_DATA_MAX_LENGTH},
+	{103, command_restart_mcu, CLOUD_METHOD_DEFERRED, METHOD_DATA_MAX_LENGTH},
+	{200, command_upgrade_firmware, CLOUD_METHOD_DEFERRED, METHOD_DATA_MAX_LENGTH},
+	{201, command_upgrade_firmware_forced, CLOUD_METHOD_DEFERRED, METHOD_DATA_MAX_LENGTH},
+	{202, command_ota_rollback, CLOUD_METHOD_DEFERRED, METHOD_DATA_MAX_LENGTH},
+	{300, command_local_settings, 0, METHOD_DATA_MAX_LENGTH},
+	{501, command_start_charging, CLOUD_METHOD_DEFERRED, METHOD_DATA_MAX_LENGTH},
+	{502, command_stop_charging, CLOUD_METHOD_DEFERRED, METHOD_DATA_MAX_LENGTH},
+	{503, command_report_charging_state, 0, METHOD_DATA_MAX_LENGTH},
+	{504, command_set_session_id, CLOUD_METHOD_DEFERRED, METHOD_DATA_MAX_LENGTH},
+	{505, command_set_user_uuid, CLOUD_METHOD_DEFERRED, METHOD_DATA_MAX_LENGTH},
+	{506, command_stop_charging_final, CLOUD_METHOD_DEFERRED, METHOD_DATA_MAX_LENGTH},
+	{507, command_resume_charging, CLOUD_METHOD_DEFERRED, METHOD_DATA_MAX_LENGTH},
+	{601, command_grant_charging, CLOUD_METHOD_DEFERRED, METHOD_DATA_MAX_LENGTH},
+	{602, command_deny_charging, CLOUD_METHOD_DEFERRED, METHOD_DATA_MAX_LENGTH},
+	{750, command_nfc_pairing_ok, 0, METHOD_DATA_MAX_LENGTH},
+	{751, command_offline_authentication_list, 0, METHOD_AUTHENTICATION_LIST_MAX_LENGTH},
+	{800, command_debug, 0, METHOD_DATA_MAX_LENGTH},
+	{804, command_grid_test, CLOUD_METHOD_DEFERRED, METHOD_DATA_MAX_LENGTH},
+};
+
+#define METHOD_HANDLER_COUNT (sizeof(method_handlers) / sizeof(method_handlers[0]))
+
+/*
+ * A deferred call owns a copy of the payload as the MQTT buffer is reused when the event handler returns. The copy is
+ * null terminated.
+ */
+struct deferred_method{
+	const struct cloud_method_handler * handler;
+	struct cloud_method_call call;
+	char data[];
+};
+
+static QueueHandle_t method_queue = NULL;
+static TaskHandle_t method_task_handle = NULL;
+
+static void send_method_response(const struct cloud_method_call * call, int status, const char * response)
+{
+	char topic[CLOUD_METHOD_RESPONSE_TOPIC_SIZE];
+	if(cloud_method_response_topic(call, status, topic, sizeof(topic)) != ESP_OK)
+	{
+		ESP_LOGE(TAG, "Unable to create response topic for method %d", call->method);
+		return;
+	}
+
+	esp_mqtt_client_publish(mqtt_client, topic, response, 0, 1, 0);//200 = OK, 400 = FAIL
+}
+
+static void run_method(const struct cloud_method_handler * handler, const struct cloud_method_call * call)
+{
+	char response[CLOUD_METHOD_RESPONSE_SIZE] = {0};
+	int status = 0;
+
+	if(handler != NULL)
+	{
+		status = handler->function(call, response, sizeof(response));
+	}
+	else
+	{
+		ESP_LOGW(TAG, "Received unknown method: %d", call->method);
+	}
+
+	send_method_response(call, status, (response[0] != '\0') ? response : NULL);
+}
+
+static void method_task(void * arg)
+{
+	struct deferred_method * deferred;
+
+	while(true)
+	{
+		if(xQueueReceive(method_queue, &deferred, portMAX_DELAY) != pdTRUE)
+			continue;
+
+		run_method(deferred->handler, &deferred->call);
+		free(deferred);
+	}
+}
+
+static void dispatch_method(const struct cloud_method_call * call)
+{
+	const struct cloud_method_handler * handler = cloud_method_find(method_handlers, METHOD_HANDLER_COUNT, call->method);
+
+	if(handler != NULL && call->data_len > handler->max_data_len)
+	{
+		ESP_LOGW(TAG, "Rejected method %d with %d byte payload, limit is %d", call->method, call->data_len, handler->max_data_len);
+		send_method_response(call, 400, NULL);
+		return;
+	}
+
+	if(handler != NULL && (handler->flags & CLOUD_METHOD_DEFERRED) && method_queue != NULL)
+	{
+		struct deferred_method * deferred = malloc(sizeof(struct deferred_method) + call->data_len + 1);
+		if(deferred != NULL)
+		{
+			deferred->handler = handler;
+			deferred->call = *call;
+			memcpy(deferred->data, call->data, call->data_len);
+			deferred->data[call->data_len] = '\0';
+			deferred->call.data = deferred->data;
+
+			if(xQueueSend(method_queue, &deferred, 0) == pdTRUE)
+				return;
+
+			free(deferred);
+		}
+
+		ESP_LOGW(TAG, "Unable to defer method %d, running it on the mqtt task", call->method);
+	}
+
+	run_method(handler, call);
+}
+
+static void start_method_task()
+{
+	if(method_queue != NULL)
+		return;
+
+	if(!cloud_method_table_is_valid(method_handlers, METHOD_HANDLER_COUNT))
+		ESP_LOGE(TAG, "Method table is not sorted, some methods will not be found");
+
+	method_queue = xQueueCreate(CONFIG_ZAPTEC_CLOUD_METHOD_QUEUE_LENGTH, sizeof(struct deferred_method *));
+	if(method_queue == NULL)
+	{
+		ESP_LOGE(TAG, "Unable to create method queue, methods will run on the mqtt task");
+		return;
+	}
+
+	if(xTaskCreate(method_task, "cloud_method", CONFIG_ZAPTEC_CLOUD_METHOD_TASK_STACK_SIZE, NULL, 4, &method_task_handle) != pdPASS)
+	{
+		ESP_LOGE(TAG, "Unable to create method task, methods will run on the mqtt task");
+		vQueueDelete(method_queue);
+		method_queue = NULL;
+	}
+}
+
+
 static int ridNr = 4199; // TODO: Check if int is correct. Azure sdk seems to use PRIu16.
 static bool isFirstConnection = true;
 static int incrementalRefreshTimeout = 0;
@@ -3728,10 +4309,15 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
         esp_mqtt_set_config(mqtt_client, &mqtt_config);
         incrementalRefreshTimeout = 0;
 
+        if(event_queue != NULL)
+        	publish_queue_set_connected(event_queue, true);
+
         break;
     case MQTT_EVENT_DISCONNECTED:
         ESP_LOGI(TAG, "MQTT_EVENT_DISCONNECTED");
         mqttConnected = false;
+        if(event_queue != NULL)
+        	publish_queue_set_connected(event_queue, false);
         break;
     case MQTT_EVENT_SUBSCRIBED:
         ESP_LOGI(TAG, "MQTT_EVENT_SUBSCRIBED, msg_id=%d", event->msg_id);
@@ -3752,6 +4338,18 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
 			}
 		}
 
+		if(event_queue != NULL)
+			publish_queue_on_published(event_queue, event->msg_id);
+
+		report_ack(event->msg_id, true);
+        break;
+    case MQTT_EVENT_DELETED:
+        ESP_LOGW(TAG, "MQTT_EVENT_DELETED, msg_id=%d", event->msg_id);
+        //Expired from the outbox, will not be acknowledged
+        if(event_queue != NULL)
+        	publish_queue_on_published(event_queue, event->msg_id);
+
+        report_ack(event->msg_id, false);
         break;
     case MQTT_EVENT_DATA:
         ESP_LOGI(TAG, "MQTT_EVENT_DATA");
@@ -3800,130 +4398,18 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
 		}
         }
 
-	if(strstr(event->topic, "iothub/methods/POST/300/"))
-        {
-
-        	if(event->data_len > 10)
-        	{
-        		ParseLocalSettingsFromCloud(event->data, event->data_len);
-        	}
-
-        	//Build LocalSettings-response
-			char devicetwin_topic[64];
-			char ridString[event->topic_len+1];
-			strncpy(ridString, event->topic, event->topic_len);
-			ridString[event->topic_len] = '\0';
-			char * ridSubString = strstr(ridString, "$rid=");
-
-			sprintf(devicetwin_topic, "$iothub/methods/res/200/?%s", ridSubString);
-
-			char responseBuffer[500]={0};//TODO: check length
-			BuildLocalSettingsResponse(responseBuffer);
-			ESP_LOGW(TAG, "responseStringLength: %d, responseBuffer: %s", strlen(responseBuffer), responseBuffer);
-
-			esp_mqtt_client_publish(mqtt_client, devicetwin_topic, responseBuffer, 0, 1, 0);
-
-        }
-
-        //Handle incoming offline AuthenticationList
-        if(strstr(event->topic, "iothub/methods/POST/751/"))
+        //Handle incoming commands
+        struct cloud_method_call call;
+        esp_err_t err = cloud_method_parse_topic(event->topic, event->topic_len, &call);
+        if(err == ESP_OK)
         {
-
-        	ESP_LOGW(TAG, "***** Data len: %d *****", event->data_len);
-
-        	//Limit max size since we have not testet with large data size(many tags in package)
-        	if((3000 > event->data_len) && (event->data_len > 10))
-        	{
-        		//Remove '\\' escape character due to uint8_t->char conversion
-        		//char rfidList[event->data_len];
-        		char * rfidList = calloc(event->data_len, 1);
-        		int nextChar = 0;
-        		for (int i = 0; i < event->data_len; i++)
-        		{
-        			if(event->data[i] != '\\')
-        			{
-        				rfidList[nextChar] = event->data[i];
-        				nextChar++;
-        			}
-        		}
-        		rfidList[nextChar] = '\0';
-
-        		int version = authentication_ParseOfflineList(rfidList, strlen(rfidList));
-
-        		free(rfidList);
-
-        		ESP_LOGI(TAG, "***** AuthenticationListVersion: %d *****", version);
-
-        		if(version >= 0)
-        		{
-        			//Set flag value to trig sending of AuthenticationListVersion from SessionHandler
-        			rfidListIsUpdated = version;
-        		}
-
-        		//				Debug - for testing authentication
-//        		char * messageZer = "{\"Version\":1,\"Package\":0,\"PackageCount\":1,\"Type\":0,\"Tokens\":[{\"Tag\":\"*\",\"Action\":0,\"ExpiryDate\":null}]}";
-//
-//        		//Add 6
-//        		char * messageOne = "{\"Version\":1,\"Package\":0,\"PackageCount\":1,\"Type\":0,\"Tokens\":[{\"Tag\":\"ble-f9f25dee-29c9-4eb2-af37-9f8e821ba0d9\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"ble-8b06fc14-aa7c-462d-a5d7-a7c943f2c4e0\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"nfc-5237AB3B\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"nfc-530796E7\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"nfc-034095E7\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"nfc-04C31102F84D80\",\"Action\":0,\"ExpiryDate\":null}]}";
-//        		//Remove 1 and 6  - 4 middle left
-//        		char * messageTwo = "{\"Version\":1,\"Package\":0,\"PackageCount\":1,\"Type\":0,\"Tokens\":[{\"Tag\":\"ble-f9f25dee-29c9-4eb2-af37-9f8e821ba0d9\",\"Action\":1,\"ExpiryDate\":null},{\"Tag\":\"ble-8b06fc14-aa7c-462d-a5d7-a7c943f2c4e0\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"nfc-5237AB3B\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"nfc-530796E7\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"nfc-034095E7\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"nfc-04C31102F84D80\",\"Action\":1,\"ExpiryDate\":null}]}";
-//
-//        		//Add 1 a bit different (add) and tag 6 back(add), tag 5 not in, multiple duplicate - 6 in total
-//        		char * messageThr = "{\"Version\":1,\"Package\":0,\"PackageCount\":1,\"Type\":0,\"Tokens\":[{\"Tag\":\"ble-ffffffff-29c9-4eb2-af37-9f8e821ba0d9\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"ble-8b06fc14-aa7c-462d-a5d7-a7c943f2c4e0\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"nfc-5237AB3B\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"nfc-530796E7\",\"Action\":0,\"ExpiryDate\":null},{\"Tag\":\"nfc-04C31102F84D80\",\"Action\":0,\"ExpiryDate\":null}]}";
-//
-//        		ESP_LOGI(TAG, "***** 0 *****");
-//        		ParseOfflineAuthenticationList(messageZer, strlen(messageOne));
-//
-//        		ESP_LOGI(TAG, "***** 1 *****");
-//        		ParseOfflineAuthenticationList(messageOne, strlen(messageOne));
-//
-//        		ESP_LOGI(TAG, "***** 2 *****");
-//        		ParseOfflineAuthenticationList(messageTwo, strlen(messageTwo));
-//
-//        		ESP_LOGI(TAG, "***** 3 *****");
-//        		ParseOfflineAuthenticationList(messageThr, strlen(messageThr));
-
-        		//storage_GetStats();
-
-        	}
-
-        	//Build LocalSettings-response
-			char devicetwin_topic[64];
-			char ridString[event->topic_len+1];
-			strncpy(ridString, event->topic, event->topic_len);
-			ridString[event->topic_len] = '\0';
-			char * ridSubString = strstr(ridString, "$rid=");
-
-
-			sprintf(devicetwin_topic, "$iothub/methods/res/200/?%s", ridSubString);
-
-			/*char responseBuffer[500]={0};//TODO: check length ~400
-			BuildLocalSettingsResponse(responseBuffer);
-			ESP_LOGW(TAG, "responseStringLength: %d, responseBuffer: %s", strlen(responseBuffer), responseBuffer);
-
-			esp_mqtt_client_publish(mqtt_client, devicetwin_topic, responseBuffer, 0, 1, 0);*/
-			char * data = NULL;
-			esp_mqtt_client_publish(mqtt_client, devicetwin_topic, data, 0, 1, 0);
+        	call.data = event->data;
+        	call.data_len = event->data_len;
+        	dispatch_method(&call);
         }
-
-        //Handle incoming commands
-        else if(strstr(event->topic, "iothub/methods/POST/"))
+        else if(err != ESP_ERR_INVALID_ARG)
         {
-        	int responseStatus = ParseCommandFromCloud(event);
-
-    		char devicetwin_topic[64];
-
-    		char ridString[event->topic_len+1];
-
-    		strncpy(ridString, event->topic, event->topic_len);
-    		ridString[event->topic_len] = '\0';
-    		volatile char * ridSubString = strstr(ridString, "$rid=");
-
-    		sprintf(devicetwin_topic, "$iothub/methods/res/%d/?%s", responseStatus, ridSubString);//200 = OK, 400 = FAIL
-
-    		char * data = NULL;
-    		esp_mqtt_client_publish(mqtt_client, devicetwin_topic, data, 0, 1, 0);
-
+        	ESP_LOGE(TAG, "Unable to parse method topic '%.*s': %s", event->topic_len, event->topic, esp_err_to_name(err));
         }
 
         //memset(event->data, 0, event->data_len);
@@ -4285,6 +4771,9 @@ void start_cloud_listener_task(struct DeviceInfo deviceInfo){
 	xEventGroupClearBits(blocked_publish_event_group, BLOCKED_MESSAGE_QUEUED);
 	blocked_publish_mutex = xSemaphoreCreateMutex();
 
+	start_method_task();
+	start_event_queue();
+
     mqtt_client = esp_mqtt_client_init(&mqtt_config);
     ESP_LOGI(TAG, "starting mqtt");
 
@@ -4296,6 +4785,8 @@ void start_cloud_listener_task(struct DeviceInfo deviceInfo){
 void stop_cloud_listener_task()
 {
 	MqttSetDisconnected();
+	if(event_queue != NULL)
+		publish_queue_set_connected(event_queue, false);
 	esp_mqtt_client_disconnect(mqtt_client);
 	esp_mqtt_client_stop(mqtt_client);
 	esp_mqtt_client_destroy(mqtt_client);
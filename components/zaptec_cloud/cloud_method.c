@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+#include "cloud_method.h"
+
+#define RID_PARAMETER "$rid="
+
+esp_err_t cloud_method_parse_topic(const char * topic, int topic_len, struct cloud_method_call * call_out){
+	const size_t prefix_length = strlen(CLOUD_METHOD_TOPIC_PREFIX);
+
+	if(topic == NULL || topic_len < 0 || (size_t)topic_len < prefix_length
+		|| strncmp(topic, CLOUD_METHOD_TOPIC_PREFIX, prefix_length) != 0)
+		return ESP_ERR_INVALID_ARG;
+
+	const char * position = topic + prefix_length;
+	const char * end = topic + topic_len;
+
+	int method = 0;
+	const char * method_start = position;
+	while(position < end && *position >= '0' && *position <= '9'){
+		if(method > (INT_MAX - 9) / 10)
+			return ESP_ERR_NOT_SUPPORTED;
+
+		method = method * 10 + (*position - '0');
+		position++;
+	}
+
+	if(position == method_start || position == end || *position != '/')
+		return ESP_ERR_NOT_SUPPORTED;
+
+	/*
+	 * The request id is a property in the query part. It is normally the only property, but search for it in case
+	 * other properties are added.
+	 */
+	const size_t rid_parameter_length = strlen(RID_PARAMETER);
+	const char * rid = NULL;
+	for(; (size_t)(end - position) > rid_parameter_length; position++){
+		if((*position == '?' || *position == '&') && strncmp(position + 1, RID_PARAMETER, rid_parameter_length) == 0){
+
+			rid = position + 1 + rid_parameter_length;
+			break;
+		}
+	}
+
+	if(rid == NULL)
+		return ESP_ERR_NOT_FOUND;
+
+	const char * rid_end = rid;
+	while(rid_end < end && *rid_end != '&')
+		rid_end++;
+
+	if(rid_end == rid)
+		return ESP_ERR_NOT_FOUND;
+
+	if(rid_end - rid > CLOUD_METHOD_RID_MAX_LENGTH)
+		return ESP_ERR_INVALID_SIZE;
+
+	call_out->method = method;
+	memcpy(call_out->rid, rid, rid_end - rid);
+	call_out->rid[rid_end - rid] = '\0';
+
+	return ESP_OK;
+}
+
+bool cloud_method_table_is_valid(const struct cloud_method_handler * table, size_t table_length){
+	for(size_t i = 0; i < table_length; i++){
+		if(table[i].function == NULL)
+			return false;
+
+		if(i > 0 && table[i-1].method >= table[i].method)
+			return false;
+	}
+
+	return true;
+}
+
+const struct cloud_method_handler * cloud_method_find(const struct cloud_method_handler * table, size_t table_length, int method){
+	size_t low = 0;
+	size_t high = table_length;
+
+	while(low < high){
+		size_t middle = low + (high - low) / 2;
+
+		if(table[middle].method == method){
+			return &table[middle];
+
+		}else if(table[middle].method < method){
+			low = middle + 1;
+
+		}else{
+			high = middle;
+		}
+	}
+
+	return NULL;
+}
+
+esp_err_t cloud_method_response_topic(const struct cloud_method_call * call, int status, char * topic_out, size_t topic_size){
+	int written = snprintf(topic_out, topic_size, "$iothub/methods/res/%d/?" RID_PARAMETER "%s", status, call->rid);
+
+	if(written < 0 || (size_t)written >= topic_size)
+		return ESP_ERR_INVALID_SIZE;
+
+	return ESP_OK;
+}
@@ -0,0 +1,70 @@
+#include <limits.h>
+
+#include "cloud_settings.h"
+
+bool cloud_settings_table_is_valid(const struct cloud_setting * table, size_t table_length){
+	for(size_t i = 1; i < table_length; i++){
+		if(table[i-1].id >= table[i].id)
+			return false;
+	}
+
+	return true;
+}
+
+int cloud_settings_find(const struct cloud_setting * table, size_t table_length, int id){
+	size_t low = 0;
+	size_t high = table_length;
+
+	while(low < high){
+		size_t middle = low + (high - low) / 2;
+
+		if(table[middle].id == id){
+			return middle;
+
+		}else if(table[middle].id < id){
+			low = middle + 1;
+
+		}else{
+			high = middle;
+		}
+	}
+
+	return -1;
+}
+
+/* Setting ids are decimal numbers without leading zeros. Other keys, like "$version", are not settings */
+static int parse_id(const char * key){
+	if(key == NULL || *key == '\0' || (key[0] == '0' && key[1] != '\0'))
+		return -1;
+
+	int id = 0;
+	for(; *key != '\0'; key++){
+		if(*key < '0' || *key > '9' || id > (INT_MAX - 9) / 10)
+			return -1;
+
+		id = id * 10 + (*key - '0');
+	}
+
+	return id;
+}
+
+size_t cloud_settings_collect(const cJSON * settings, const struct cloud_setting * table, size_t table_length,
+			const cJSON ** values_out){
+
+	for(size_t i = 0; i < table_length; i++)
+		values_out[i] = NULL;
+
+	size_t found = 0;
+	const cJSON * value;
+
+	cJSON_ArrayForEach(value, settings){
+		int index = cloud_settings_find(table, table_length, parse_id(value->string));
+
+		if(index >= 0 && values_out[index] == NULL){
+			values_out[index] = value;
+			found++;
+		}
+	}
+
+	return found;
+}
@@ -0,0 +1,157 @@
+/*
+ * Measures the time from a received direct method topic to the handler and response topic, for every method handled by
+ * cloud_listener.c. The previous dispatch, a sequence of strstr on the topic followed by a copy of the topic to find the
+ * request id, is measured for comparison. Handlers do nothing, so only the dispatch is measured.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "esp_log.h"
+
+#include "cloud_method.h"
+
+/* The methods of method_handlers in cloud_listener.c */
+static const int methods[] = {1, 102, 103, 200, 201, 202, 300, 501, 502, 503, 504, 505, 506, 507, 601, 602, 750, 751, 800, 804};
+#define METHOD_COUNT (sizeof(methods) / sizeof(methods[0]))
+
+/* The order of the strstr checks in the previous ParseCommandFromCloud */
+static const char * legacy_chain[] = {
+	"iothub/methods/POST/1/", "iothub/methods/POST/102/", "iothub/methods/POST/103/", "iothub/methods/POST/200/",
+	"iothub/methods/POST/201/", "iothub/methods/POST/202/", "iothub/methods/POST/501/", "iothub/methods/POST/502/",
+	"iothub/methods/POST/503/", "iothub/methods/POST/504/", "iothub/methods/POST/505/", "iothub/methods/POST/506/",
+	"iothub/methods/POST/507/", "iothub/methods/POST/601/", "iothub/methods/POST/602/", "iothub/methods/POST/750/",
+	"iothub/methods/POST/800/", "iothub/methods/POST/804/",
+};
+#define LEGACY_CHAIN_LENGTH (sizeof(legacy_chain) / sizeof(legacy_chain[0]))
+
+static volatile int sink;
+
+static int handler(const struct cloud_method_call * call, char * response, size_t response_size){
+	return 200 + (call->data_len & 1);
+}
+
+static struct cloud_method_handler table[METHOD_COUNT];
+
+static int legacy_parse(const char * topic){
+	for(size_t i = 0; i < LEGACY_CHAIN_LENGTH; i++){
+		if(strstr(topic, legacy_chain[i]))
+			return handler(&(struct cloud_method_call){0}, NULL, 0);
+	}
+
+	return 0;
+}
+
+static void legacy_dispatch(const char * topic, int topic_len){
+	int status = 0;
+	char response[CLOUD_METHOD_RESPONSE_SIZE] = {0};
+
+	if(strstr(topic, "iothub/methods/POST/300/")){
+		status = handler(&(struct cloud_method_call){0}, response, sizeof(response));
+
+	}else if(strstr(topic, "iothub/methods/POST/751/")){
+		status = handler(&(struct cloud_method_call){0}, response, sizeof(response));
+
+	}else if(strstr(topic, "iothub/methods/POST/")){
+		status = legacy_parse(topic);
+	}
+
+	char response_topic[64];
+	char rid_string[topic_len + 1];
+	strncpy(rid_string, topic, topic_len);
+	rid_string[topic_len] = '\0';
+	char * rid = strstr(rid_string, "$rid=");
+
+	sprintf(response_topic, "$iothub/methods/res/%d/?%s", status, rid);
+	sink = response_topic[20];
+}
+
+static void table_dispatch(const char * topic, int topic_len){
+	struct cloud_method_call call;
+	if(cloud_method_parse_topic(topic, topic_len, &call) != ESP_OK)
+		return;
+
+	call.data = NULL;
+	call.data_len = 0;
+
+	char response[CLOUD_METHOD_RESPONSE_SIZE] = {0};
+	int status = 0;
+	const struct cloud_method_handler * entry = cloud_method_find(table, METHOD_COUNT, call.method);
+	if(entry != NULL)
+		status = entry->function(&call, response, sizeof(response));
+
+	char response_topic[CLOUD_METHOD_RESPONSE_TOPIC_SIZE];
+	cloud_method_response_topic(&call, status, response_topic, sizeof(response_topic));
+	sink = response_topic[20];
+}
+
+static double now_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double measure(void (*dispatch)(const char *, int), const char * topic, int topic_len, long iterations){
+	double start = now_ns();
+	for(long i = 0; i < iterations; i++)
+		dispatch(topic, topic_len);
+
+	return (now_ns() - start) / iterations;
+}
+
+int main(int argc, char ** argv){
+	long iterations = 1000000;
+
+	int opt;
+	while((opt = getopt(argc, argv, "n:")) != -1){
+		switch(opt){
+		case 'n':
+			iterations = strtol(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n iterations per method]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	for(size_t i = 0; i < METHOD_COUNT; i++)
+		table[i] = (struct cloud_method_handler){methods[i], handler, 0, 512};
+
+	if(!cloud_method_table_is_valid(table, METHOD_COUNT)){
+		fprintf(stderr, "Method table is not sorted\n");
+		return 1;
+	}
+
+	double legacy_sum = 0.0, legacy_max = 0.0;
+	double table_sum = 0.0, table_max = 0.0;
+
+	printf("%8s %12s %12s\n", "method", "strstr ns", "table ns");
+	for(size_t i = 0; i < METHOD_COUNT; i++){
+		/* esp-mqtt does not null terminate the topic, the buffer continues with the payload */
+		char buffer[128];
+		int topic_len = snprintf(buffer, sizeof(buffer), "$iothub/methods/POST/%d/?$rid=%zu", methods[i], 100 + i);
+		snprintf(buffer + topic_len, sizeof(buffer) - topic_len, "[\"806b2f4e-54e1-4913-aa90-376e14daedba\"]");
+
+		char legacy_topic[128];
+		snprintf(legacy_topic, sizeof(legacy_topic), "%.*s", topic_len, buffer);
+
+		double legacy = measure(legacy_dispatch, legacy_topic, topic_len, iterations);
+		double table = measure(table_dispatch, buffer, topic_len, iterations);
+
+		printf("%8d %12.1f %12.1f\n", methods[i], legacy, table);
+
+		legacy_sum += legacy;
+		table_sum += table;
+		if(legacy > legacy_max)
+			legacy_max = legacy;
+		if(table > table_max)
+			table_max = table;
+	}
+
+	printf("%8s %12.1f %12.1f\n", "mean", legacy_sum / METHOD_COUNT, table_sum / METHOD_COUNT);
+	printf("%8s %12.1f %12.1f\n", "max", legacy_max, table_max);
+
+	return 0;
+}
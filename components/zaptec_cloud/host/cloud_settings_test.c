@@ -0,0 +1,179 @@
+/*
+ * Checks cloud_settings_collect with a full device twin settings document and measures the time to find the known
+ * settings, compared to the previous cJSON_HasObjectItem and cJSON_GetObjectItem for each known id.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "cJSON.h"
+
+#include "cloud_settings.h"
+
+/* The ids of cloud_settings in cloud_listener.c */
+static const int known_ids[] = {120, 146, 148, 510, 511, 520, 522, 523, 711, 712, 800, 801, 802, 805, 860, 861, 862, 863, 864};
+#define KNOWN_COUNT (sizeof(known_ids) / sizeof(known_ids[0]))
+
+/* Settings sent by the cloud that are not used by the charger */
+static const int other_ids[] = {
+	100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111, 112, 113, 114, 121, 122, 123, 124, 125,
+	150, 151, 152, 153, 154, 155, 156, 157, 158, 159, 200, 201, 202, 300, 301, 302, 500, 501, 502, 503,
+};
+#define OTHER_COUNT (sizeof(other_ids) / sizeof(other_ids[0]))
+
+static struct cloud_setting table[KNOWN_COUNT];
+
+static volatile size_t sink;
+
+static char * create_document(void){
+	cJSON * root = cJSON_CreateObject();
+	cJSON * desired = cJSON_AddObjectToObject(root, "desired");
+	cJSON * settings = cJSON_AddObjectToObject(desired, "Settings");
+
+	char key[16];
+	char value[64];
+
+	/* Known and other ids interleaved, roughly in the order of the twin */
+	size_t known = 0, other = 0;
+	while(known < KNOWN_COUNT || other < OTHER_COUNT){
+		int id;
+		if(other >= OTHER_COUNT || (known < KNOWN_COUNT && known_ids[known] < other_ids[other])){
+			id = known_ids[known++];
+		}else{
+			id = other_ids[other++];
+		}
+
+		snprintf(key, sizeof(key), "%d", id);
+		snprintf(value, sizeof(value), "value-of-setting-%d", id);
+		cJSON_AddStringToObject(settings, key, value);
+	}
+
+	cJSON_AddNumberToObject(desired, "$version", 1234);
+
+	char * document = cJSON_PrintUnformatted(root);
+	cJSON_Delete(root);
+
+	return document;
+}
+
+static size_t lookup_each(const cJSON * settings, const cJSON ** values){
+	size_t found = 0;
+	char key[16];
+
+	for(size_t i = 0; i < KNOWN_COUNT; i++){
+		snprintf(key, sizeof(key), "%d", known_ids[i]);
+		values[i] = NULL;
+
+		if(cJSON_HasObjectItem(settings, key)){
+			values[i] = cJSON_GetObjectItem(settings, key);
+			found++;
+		}
+	}
+
+	return found;
+}
+
+static double now_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char ** argv){
+	long iterations = 100000;
+
+	int opt;
+	while((opt = getopt(argc, argv, "n:")) != -1){
+		switch(opt){
+		case 'n':
+			iterations = strtol(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n iterations]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	for(size_t i = 0; i < KNOWN_COUNT; i++)
+		table[i] = (struct cloud_setting){known_ids[i], NULL, 0};
+
+	if(!cloud_settings_table_is_valid(table, KNOWN_COUNT)){
+		fprintf(stderr, "Settings table is not sorted\n");
+		return 1;
+	}
+
+	char * document = create_document();
+	cJSON * root = cJSON_Parse(document);
+	const cJSON * settings = cJSON_GetObjectItem(cJSON_GetObjectItem(root, "desired"), "Settings");
+
+	const cJSON * expected[KNOWN_COUNT];
+	const cJSON * values[KNOWN_COUNT];
+
+	size_t expected_count = lookup_each(settings, expected);
+	size_t count = cloud_settings_collect(settings, table, KNOWN_COUNT, values);
+
+	int failures = 0;
+	if(count != KNOWN_COUNT || expected_count != KNOWN_COUNT){
+		fprintf(stderr, "FAIL: found %zu and %zu of %zu settings\n", count, expected_count, KNOWN_COUNT);
+		failures++;
+	}
+
+	for(size_t i = 0; i < KNOWN_COUNT; i++){
+		if(values[i] != expected[i]){
+			fprintf(stderr, "FAIL: wrong value for %d\n", known_ids[i]);
+			failures++;
+		}
+	}
+
+	/* Keys that are not decimal ids and absent settings */
+	cJSON * partial = cJSON_Parse("{\"$version\":3,\"0511\":\"7\",\"511\":\"6\",\"51a\":\"8\",\"-510\":\"9\",\"511\":\"10\"}");
+	count = cloud_settings_collect(partial, table, KNOWN_COUNT, values);
+	int index = cloud_settings_find(table, KNOWN_COUNT, 511);
+
+	if(count != 1 || index < 0 || values[index] == NULL || strcmp(values[index]->valuestring, "6") != 0){
+		fprintf(stderr, "FAIL: partial document\n");
+		failures++;
+	}
+	cJSON_Delete(partial);
+
+	if(cloud_settings_find(table, KNOWN_COUNT, 121) != -1 || cloud_settings_find(table, KNOWN_COUNT, 864) != KNOWN_COUNT - 1){
+		fprintf(stderr, "FAIL: find\n");
+		failures++;
+	}
+
+	double start = now_ns();
+	for(long i = 0; i < iterations; i++){
+		cJSON * parsed = cJSON_Parse(document);
+		sink = (size_t)parsed;
+		cJSON_Delete(parsed);
+	}
+	double parse_ns = (now_ns() - start) / iterations;
+
+	start = now_ns();
+	for(long i = 0; i < iterations; i++)
+		sink = lookup_each(settings, values);
+	double lookup_each_ns = (now_ns() - start) / iterations;
+
+	start = now_ns();
+	for(long i = 0; i < iterations; i++)
+		sink = cloud_settings_collect(settings, table, KNOWN_COUNT, values);
+	double collect_ns = (now_ns() - start) / iterations;
+
+	printf("document: %zu bytes, %zu settings of which %zu known\n", strlen(document), KNOWN_COUNT + OTHER_COUNT, KNOWN_COUNT);
+	printf("cJSON_Parse:                       %8.0f ns\n", parse_ns);
+	printf("HasObjectItem+GetObjectItem per id: %8.0f ns\n", lookup_each_ns);
+	printf("cloud_settings_collect:            %8.0f ns\n", collect_ns);
+
+	cJSON_Delete(root);
+	free(document);
+
+	if(failures != 0){
+		printf("%d failures\n", failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
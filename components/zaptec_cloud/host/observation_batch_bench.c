@@ -0,0 +1,202 @@
+/*
+ * Checks that observation_batch writes the same document as the cJSON observation collection, and measures the bytes
+ * and time per telemetry round for both. The cJSON path formats the timestamp for each observation like
+ * create_observation in zaptec_cloud_observations.c, the batch formats it once per round.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <sys/time.h>
+#include <getopt.h>
+
+#include "cJSON.h"
+
+#include "observation_batch.h"
+
+struct observation{
+	int id;
+	const char * value;
+};
+
+/* Similar to publish_debug_telemetry_observation_all while charging */
+static const struct observation round_all[] = {
+	{201, "31.250"}, {202, "38.100"}, {513, "11042.375"}, {204, "41.500"}, {205, "40.875"}, {206, "42.000"},
+	{209, "47.250"}, {210, "45.125"}, {220, "-67.000"},
+	{808, "2023-10-12 10:11:12 T_EM: 41.50 40.88 42.00  T_M: 47.25 45.13   V: 231.20 230.80 232.10   I: 16.01 15.98 "
+		"16.02  11.042kW 4.523kWh C3 CM3 MCnt:12345 Rs:0 Rc:1"},
+};
+
+/* Similar to publish_telemetry_observation_on_change when a session starts */
+static const struct observation round_on_change[] = {
+	{501, "231.200"}, {502, "230.800"}, {503, "232.100"}, {507, "16.010"}, {508, "15.980"}, {509, "16.020"},
+	{513, "11042.375"}, {553, "4.523"}, {710, "3"}, {711, "1"}, {712, "0"}, {714, "3"}, {715, "16.000"},
+	{716, "0"}, {718, "1"}, {720, "\"quoted\" back\\slash\nnewline"},
+};
+
+static volatile size_t sink;
+
+static void utc_time_string(char * time_string){
+	time_t now = 0;
+	struct tm timeinfo = { 0 };
+	char strftime_buf[64] = {0};
+
+	time(&now);
+
+	setenv("TZ", "UTC-0", 1);
+	tzset();
+
+	localtime_r(&now, &timeinfo);
+
+	struct timeval t_now;
+	gettimeofday(&t_now, NULL);
+
+	strftime(strftime_buf, sizeof(strftime_buf), "%Y-%m-%dT%H:%M:%S", &timeinfo);
+
+	sprintf(strftime_buf+strlen(strftime_buf), ".%06" PRIu32 "Z", (uint32_t)t_now.tv_usec);
+	strcpy(time_string, strftime_buf);
+}
+
+static const char * fixed_time = NULL;
+
+static void observed_at(char * time_string){
+	if(fixed_time != NULL){
+		strcpy(time_string, fixed_time);
+	}else{
+		utc_time_string(time_string);
+	}
+}
+
+static char * encode_cjson(const struct observation * observations, size_t count){
+	cJSON * collection = cJSON_CreateObject();
+	cJSON_AddArrayToObject(collection, "Observations");
+	cJSON_AddNumberToObject(collection, "Type", (float) 6.0);
+
+	for(size_t i = 0; i < count; i++){
+		cJSON * result = cJSON_CreateObject();
+
+		char strftime_buf[32];
+		observed_at(strftime_buf);
+		cJSON_AddStringToObject(result, "ObservedAt", strftime_buf);
+
+		cJSON_AddStringToObject(result, "Value", observations[i].value);
+		cJSON_AddNumberToObject(result, "ObservationId", (float) observations[i].id);
+		cJSON_AddNumberToObject(result, "Type", (float) 1.0);
+
+		cJSON_AddItemToArray(cJSON_GetObjectItem(collection, "Observations"), result);
+	}
+
+	char * message = cJSON_PrintUnformatted(collection);
+	cJSON_Delete(collection);
+
+	return message;
+}
+
+static char * encode_batch(const struct observation * observations, size_t count){
+	char timestamp[OBSERVATION_BATCH_TIMESTAMP_SIZE];
+	observed_at(timestamp);
+
+	struct observation_batch * batch = observation_batch_create(1024, timestamp);
+
+	for(size_t i = 0; i < count; i++)
+		observation_batch_add(batch, observations[i].id, observations[i].value, NULL);
+
+	const char * message = observation_batch_finish(batch, NULL);
+	char * result = message != NULL ? strdup(message) : NULL;
+
+	observation_batch_free(batch);
+	return result;
+}
+
+static double now_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double measure(char * (*encode)(const struct observation *, size_t), const struct observation * observations,
+		size_t count, long iterations){
+
+	double start = now_ns();
+	for(long i = 0; i < iterations; i++){
+		char * message = encode(observations, count);
+		sink = strlen(message);
+		free(message);
+	}
+
+	return (now_ns() - start) / iterations;
+}
+
+static int check_round(const char * name, const struct observation * observations, size_t count, long iterations){
+	fixed_time = "2023-10-12T10:11:12.123456Z";
+	char * expected = encode_cjson(observations, count);
+	char * actual = encode_batch(observations, count);
+	fixed_time = NULL;
+
+	int failures = 0;
+	if(actual == NULL || strcmp(expected, actual) != 0){
+		fprintf(stderr, "FAIL: %s differs\ncJSON: %s\nbatch: %s\n", name, expected, actual ? actual : "(null)");
+		failures++;
+	}
+
+	double cjson_ns = measure(encode_cjson, observations, count, iterations);
+	double batch_ns = measure(encode_batch, observations, count, iterations);
+
+	printf("%-10s %3zu %8zu %8zu %12.0f %12.0f\n", name, count, strlen(expected), actual ? strlen(actual) : 0,
+		cjson_ns, batch_ns);
+
+	free(expected);
+	free(actual);
+
+	return failures;
+}
+
+int main(int argc, char ** argv){
+	long iterations = 100000;
+
+	int opt;
+	while((opt = getopt(argc, argv, "n:")) != -1){
+		switch(opt){
+		case 'n':
+			iterations = strtol(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n iterations per round]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	int failures = 0;
+
+	printf("%-10s %3s %8s %8s %12s %12s\n", "round", "obs", "cJSON B", "batch B", "cJSON ns", "batch ns");
+	failures += check_round("all", round_all, sizeof(round_all) / sizeof(round_all[0]), iterations);
+	failures += check_round("on_change", round_on_change, sizeof(round_on_change) / sizeof(round_on_change[0]), iterations);
+
+	/* Growth from a small initial buffer and the held timestamp for a single observation */
+	struct observation_batch * batch = observation_batch_create(8, "shared");
+	for(int i = 0; i < 100; i++)
+		observation_batch_add(batch, 808, round_all[9].value, (i == 50) ? "held" : NULL);
+
+	size_t length;
+	const char * message = observation_batch_finish(batch, &length);
+	if(message == NULL || batch->count != 100 || length != strlen(message) || strstr(message, "\"held\"") == NULL
+		|| observation_batch_add(batch, 1, "late", NULL) != ESP_ERR_INVALID_STATE){
+		fprintf(stderr, "FAIL: growth\n");
+		failures++;
+	}
+	observation_batch_free(batch);
+
+	if(observation_batch_add(NULL, 1, "1", NULL) != ESP_ERR_INVALID_ARG || observation_batch_finish(NULL, NULL) != NULL){
+		fprintf(stderr, "FAIL: NULL batch\n");
+		failures++;
+	}
+
+	if(failures != 0){
+		printf("%d failures\n", failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
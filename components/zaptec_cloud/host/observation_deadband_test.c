@@ -0,0 +1,351 @@
+/*
+ * Checks the observation_deadband rules and counts the power and energy publishes for one second current and voltage
+ * traces, compared to the previous hand written change detection in publish_telemetry_observation_on_change.
+ *
+ * The traces are generated with a fixed seed and shaped like sessions logged from chargers: a steady three phase
+ * session, a session where load balancing moves the current every 10-40 seconds, and a single phase session close to
+ * 7kW where the previous band switched between 200W and 500W.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "observation_deadband.h"
+
+#define ParamTotalChargePower 513
+#define ParamTotalChargePowerSession 553
+
+enum deadband_index{
+	DEADBAND_POWER,
+	DEADBAND_ENERGY,
+	DEADBAND_COUNT,
+};
+
+/* Same as deadbands in zaptec_cloud_observations.c */
+static const struct observation_deadband deadbands_initial[DEADBAND_COUNT] = {
+	[DEADBAND_POWER] = {ParamTotalChargePower, 200.0, 0.07, 500.0, 5, 10, 0, OBSERVATION_DEADBAND_ZERO_IMMEDIATE, .sent = true},
+	[DEADBAND_ENERGY] = {ParamTotalChargePowerSession, 0.1, 0.1, 0.5, 0, 0, 0, 0},
+};
+
+struct sample{
+	float currents[3];
+	float voltages[3];
+};
+
+static uint32_t seed = 1;
+
+static float noise(float amplitude){
+	seed = seed * 1103515245 + 12345;
+	return amplitude * (((seed >> 8) & 0xffff) / 32768.0f - 1.0f);
+}
+
+static size_t ramp(struct sample * trace, size_t t, size_t length, float from, float to, int phases){
+	for(size_t i = 0; i < length; i++, t++){
+		float current = from + (to - from) * (i + 1) / length;
+		for(int p = 0; p < 3; p++){
+			trace[t].currents[p] = (p < phases && current > 0.0f) ? current + noise(0.3) : 0.0f;
+			trace[t].voltages[p] = 230.0f + noise(2.0);
+		}
+	}
+
+	return t;
+}
+
+static size_t steady(struct sample * trace, size_t t, size_t length, float current, float current_noise, int phases){
+	for(size_t i = 0; i < length; i++, t++){
+		for(int p = 0; p < 3; p++){
+			trace[t].currents[p] = (p < phases && current > 0.0f) ? current + noise(current_noise) : 0.0f;
+			trace[t].voltages[p] = 230.0f + noise(2.0);
+		}
+	}
+
+	return t;
+}
+
+static size_t trace_steady(struct sample * trace){
+	size_t t = steady(trace, 0, 60, 0.0, 0.0, 3);
+	t = ramp(trace, t, 8, 0.0, 16.0, 3);
+	t = steady(trace, t, 7200, 16.0, 0.4, 3);
+	t = ramp(trace, t, 3, 16.0, 0.0, 3);
+	return steady(trace, t, 60, 0.0, 0.0, 3);
+}
+
+static size_t trace_load_balancing(struct sample * trace){
+	size_t t = steady(trace, 0, 60, 0.0, 0.0, 3);
+	float current = 6.0;
+	t = ramp(trace, t, 4, 0.0, current, 3);
+
+	while(t < 7200){
+		float next = 6.0f + (int)(noise(5.0) + 5.0f);
+		t = ramp(trace, t, 2, current, next, 3);
+		t = steady(trace, t, 10 + (int)(noise(15.0) + 15.0f), next, 0.4, 3);
+		current = next;
+	}
+
+	t = ramp(trace, t, 3, current, 0.0, 3);
+	return steady(trace, t, 60, 0.0, 0.0, 3);
+}
+
+static size_t trace_single_phase(struct sample * trace){
+	size_t t = steady(trace, 0, 60, 0.0, 0.0, 1);
+	t = ramp(trace, t, 8, 0.0, 30.0, 1);
+	t = steady(trace, t, 7200, 30.0, 1.2, 1);
+	t = ramp(trace, t, 3, 30.0, 0.0, 1);
+	return steady(trace, t, 60, 0.0, 0.0, 1);
+}
+
+static float trace_power(const struct sample * sample){
+	float power = 0.0;
+	for(int p = 0; p < 3; p++)
+		power += sample->currents[p] * sample->voltages[p];
+
+	return power;
+}
+
+struct publish_count{
+	size_t power;
+	size_t energy;
+};
+
+/* The change detection removed from publish_telemetry_observation_on_change */
+static struct publish_count count_previous(const struct sample * trace, size_t length){
+	struct publish_count count = {0};
+
+	float previousPower = -1.0;
+	float previousEnergy = -1.0;
+	int8_t sendUpdateInSeconds = 0;
+	bool sendPower = false;
+	float energy = 0.0;
+
+	for(size_t t = 0; t < length; t++){
+		float power = trace_power(&trace[t]);
+		energy += power / 3600000.0f;
+
+		float powerLimit = (power > 7000.0) ? 500.0 : 200.0;
+
+		if(((power > previousPower + powerLimit) || (power < (previousPower - powerLimit))) && (sendUpdateInSeconds == 0))
+			sendUpdateInSeconds = 5;
+
+		if((power == 0.0) && (previousPower > 0.0))
+			sendPower = true;
+
+		if(sendUpdateInSeconds > 0){
+			sendUpdateInSeconds--;
+			if(sendUpdateInSeconds == 0)
+				sendPower = true;
+		}
+
+		if(sendPower == true){
+			sendPower = false;
+			sendUpdateInSeconds = 0;
+			previousPower = power;
+			count.power++;
+		}
+
+		float rounded = floor(energy * 1000) / 1000.0;
+		float trigLimit = 0.1;
+		if(rounded >= 1.0)
+			trigLimit = 0.2;
+		if(rounded >= 5.0)
+			trigLimit = 0.5;
+
+		if((rounded > previousEnergy + trigLimit) || (rounded < (previousEnergy - trigLimit))){
+			previousEnergy = rounded;
+			count.energy++;
+		}
+	}
+
+	return count;
+}
+
+/* Also checks that the last published power follows the trace once it has been stable for the delay */
+static struct publish_count count_deadband(const struct sample * trace, size_t length, float scale, int * failures){
+	struct publish_count count = {0};
+
+	struct observation_deadband deadbands[DEADBAND_COUNT];
+	memcpy(deadbands, deadbands_initial, sizeof(deadbands));
+
+	float energy = 0.0;
+
+	for(size_t t = 0; t < length; t++){
+		float values[DEADBAND_COUNT];
+		bool publish[DEADBAND_COUNT];
+
+		values[DEADBAND_POWER] = trace_power(&trace[t]);
+		energy += values[DEADBAND_POWER] / 3600000.0f;
+		values[DEADBAND_ENERGY] = floor(energy * 1000) / 1000.0;
+
+		observation_deadband_update(deadbands, DEADBAND_COUNT, values, scale, t, publish);
+
+		count.power += publish[DEADBAND_POWER];
+		count.energy += publish[DEADBAND_ENERGY];
+	}
+
+	float power = trace_power(&trace[length - 1]);
+	if(deadbands[DEADBAND_POWER].last_value != power){
+		fprintf(stderr, "FAIL: last published power %.1f, trace ended at %.1f\n", deadbands[DEADBAND_POWER].last_value, power);
+		(*failures)++;
+	}
+
+	float band = observation_deadband_band(&deadbands[DEADBAND_ENERGY], scale);
+	if(fabsf(deadbands[DEADBAND_ENERGY].last_value - energy) > band + 0.001f){
+		fprintf(stderr, "FAIL: last published energy %.3f, session ended at %.3f\n", deadbands[DEADBAND_ENERGY].last_value, energy);
+		(*failures)++;
+	}
+
+	return count;
+}
+
+static int check_rules(void){
+	int failures = 0;
+	bool publish;
+
+	struct observation_deadband entry = {1, 10.0, 0.1, 50.0, 3, 10, 60, OBSERVATION_DEADBAND_ZERO_IMMEDIATE};
+
+	/* First value is always published */
+	if(observation_deadband_update(&entry, 1, (float[]){100.0}, 1.0, 0, &publish) != 1 || !publish){
+		fprintf(stderr, "FAIL: first value\n");
+		failures++;
+	}
+
+	/* The relative band wins over the absolute, and the maximum over both */
+	if(observation_deadband_band(&entry, 1.0) != 10.0f || observation_deadband_band(&entry, 2.0) != 20.0f){
+		fprintf(stderr, "FAIL: band %f\n", observation_deadband_band(&entry, 1.0));
+		failures++;
+	}
+
+	entry.last_value = 1000.0;
+	if(observation_deadband_band(&entry, 1.0) != 50.0f){
+		fprintf(stderr, "FAIL: maximum band\n");
+		failures++;
+	}
+	entry.last_value = 100.0;
+
+	/* A spike shorter than the delay is not published */
+	uint32_t t = 20;
+	observation_deadband_update(&entry, 1, (float[]){150.0}, 1.0, t++, &publish);
+	observation_deadband_update(&entry, 1, (float[]){150.0}, 1.0, t++, &publish);
+	observation_deadband_update(&entry, 1, (float[]){105.0}, 1.0, t++, &publish);
+	observation_deadband_update(&entry, 1, (float[]){150.0}, 1.0, t++, &publish);
+	if(publish || entry.last_value != 100.0f){
+		fprintf(stderr, "FAIL: spike\n");
+		failures++;
+	}
+
+	/* Published when outside the band for the delay */
+	observation_deadband_update(&entry, 1, (float[]){151.0}, 1.0, t++, &publish);
+	observation_deadband_update(&entry, 1, (float[]){152.0}, 1.0, t++, &publish);
+	observation_deadband_update(&entry, 1, (float[]){153.0}, 1.0, t++, &publish);
+	if(!publish || entry.last_value != 153.0f || entry.last_time != t - 1){
+		fprintf(stderr, "FAIL: delay, published %d at %u\n", publish, entry.last_time);
+		failures++;
+	}
+
+	/* Not again before the minimum interval */
+	uint32_t published_at = entry.last_time;
+	for(t = published_at + 1; t < published_at + 10; t++){
+		observation_deadband_update(&entry, 1, (float[]){200.0}, 1.0, t, &publish);
+		if(publish){
+			fprintf(stderr, "FAIL: minimum interval at %u\n", t - published_at);
+			failures++;
+			break;
+		}
+	}
+	observation_deadband_update(&entry, 1, (float[]){200.0}, 1.0, published_at + 10, &publish);
+	if(!publish){
+		fprintf(stderr, "FAIL: after minimum interval\n");
+		failures++;
+	}
+
+	/* Zero is published at once */
+	observation_deadband_update(&entry, 1, (float[]){0.0}, 1.0, published_at + 11, &publish);
+	if(!publish || entry.last_value != 0.0f){
+		fprintf(stderr, "FAIL: zero\n");
+		failures++;
+	}
+
+	/* Small changes are published after the maximum interval */
+	published_at = entry.last_time;
+	observation_deadband_update(&entry, 1, (float[]){1.0}, 1.0, published_at + 59, &publish);
+	if(publish){
+		fprintf(stderr, "FAIL: small change before maximum interval\n");
+		failures++;
+	}
+	observation_deadband_update(&entry, 1, (float[]){1.0}, 1.0, published_at + 60, &publish);
+	if(!publish){
+		fprintf(stderr, "FAIL: small change after maximum interval\n");
+		failures++;
+	}
+	observation_deadband_update(&entry, 1, (float[]){1.0}, 1.0, published_at + 200, &publish);
+	if(publish){
+		fprintf(stderr, "FAIL: unchanged value published\n");
+		failures++;
+	}
+
+	observation_deadband_reset(&entry, 1);
+	observation_deadband_update(&entry, 1, (float[]){1.0}, 1.0, published_at + 201, &publish);
+	if(!publish){
+		fprintf(stderr, "FAIL: reset\n");
+		failures++;
+	}
+
+	return failures;
+}
+
+int main(int argc, char ** argv){
+	float scale = 1.0;
+
+	int opt;
+	while((opt = getopt(argc, argv, "s:")) != -1){
+		switch(opt){
+		case 's':
+			scale = strtof(optarg, NULL);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-s TransmitChangeLevel]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	int failures = check_rules();
+
+	struct{
+		const char * name;
+		size_t (*create)(struct sample *);
+	} traces[] = {
+		{"steady 3x16A", trace_steady},
+		{"load balancing", trace_load_balancing},
+		{"1x30A", trace_single_phase},
+	};
+
+	struct sample * trace = malloc(sizeof(struct sample) * 8000);
+
+	printf("%-16s %8s %14s %14s %14s %14s\n", "trace", "seconds", "power before", "power after", "energy before", "energy after");
+	for(size_t i = 0; i < sizeof(traces) / sizeof(traces[0]); i++){
+		seed = 1 + i;
+		size_t length = traces[i].create(trace);
+
+		struct publish_count previous = count_previous(trace, length);
+		struct publish_count deadband = count_deadband(trace, length, scale, &failures);
+
+		printf("%-16s %8zu %14zu %14zu %14zu %14zu\n", traces[i].name, length, previous.power, deadband.power,
+			previous.energy, deadband.energy);
+
+		if(scale >= 1.0f && deadband.power > previous.power){
+			fprintf(stderr, "FAIL: more power publishes than before\n");
+			failures++;
+		}
+	}
+
+	free(trace);
+
+	if(failures != 0){
+		printf("%d failures\n", failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
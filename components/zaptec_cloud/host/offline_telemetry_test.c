@@ -0,0 +1,576 @@
+/*
+ * Tests offline_telemetry on a file in /dev/shm: wrap-around of the ring, records surviving interrupted writes, batches
+ * waiting for acknowledgement, and the rate records are drained at after reconnect.
+ *
+ * Power loss is emulated by opening the file again while the first store is still open, without writing the records it
+ * keeps in memory, and interrupted writes by overwriting part of the file with random bytes before opening it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "esp_log.h"
+
+#include "offline_telemetry.h"
+
+#define TEST_PATH "/dev/shm/cloud_host_telemetry.bin"
+
+#define RECORDS_PER_BLOCK 31
+#define FIRST_TIME 1700000000
+
+/* Record number n has a time, id, type and value that are all derived from n */
+static struct offline_telemetry_record make_record(uint32_t n){
+	struct offline_telemetry_record record = {
+		.time = FIRST_TIME + n * 10,
+		.id = 500 + n % 3,
+		.type = eOFFLINE_TELEMETRY_DOUBLE + n % 3,
+	};
+
+	switch(record.type){
+	case eOFFLINE_TELEMETRY_DOUBLE:
+		record.value.d = n + 0.25;
+		break;
+	case eOFFLINE_TELEMETRY_UINT32:
+		record.value.u = n;
+		break;
+	case eOFFLINE_TELEMETRY_INT32:
+		record.value.i = -(int32_t)n;
+		break;
+	}
+
+	return record;
+}
+
+/* Returns the record number or -1 if the record was not made by make_record */
+static int record_number(const struct offline_telemetry_record * record){
+	if(record->time < FIRST_TIME || (record->time - FIRST_TIME) % 10 != 0)
+		return -1;
+
+	uint32_t n = (record->time - FIRST_TIME) / 10;
+	struct offline_telemetry_record expected = make_record(n);
+
+	if(record->id != expected.id || record->type != expected.type)
+		return -1;
+
+	if(record->type == eOFFLINE_TELEMETRY_DOUBLE ? record->value.d != expected.value.d : record->value.u != expected.value.u)
+		return -1;
+
+	return n;
+}
+
+struct collector{
+	int fail; ///< Result of send
+	int message_id; ///< Returned by send if fail is 0, incremented for each batch
+	int first;
+	int last; ///< Last record number received, -1 if none
+	uint32_t received;
+	bool valid; ///< All records were made by make_record and in increasing order
+
+	uint32_t now;
+	uint32_t batches;
+	uint32_t min_gap;
+	uint32_t last_batch;
+	size_t largest_batch;
+
+	bool * numbers; ///< Set for each record number received, if not NULL
+	uint32_t numbers_size;
+};
+
+static void collector_init(struct collector * collector){
+	memset(collector, 0, sizeof(struct collector));
+	collector->first = -1;
+	collector->last = -1;
+	collector->valid = true;
+	collector->min_gap = UINT32_MAX;
+}
+
+static int collect(const struct offline_telemetry_record * records, size_t count, void * context){
+	struct collector * collector = context;
+
+	if(collector->fail != 0)
+		return collector->fail;
+
+	for(size_t i = 0; i < count; i++){
+		int n = record_number(&records[i]);
+		if(n < 0 || n <= collector->last)
+			collector->valid = false;
+
+		if(collector->first < 0)
+			collector->first = n;
+
+		if(collector->numbers != NULL && n >= 0 && (uint32_t)n < collector->numbers_size)
+			collector->numbers[n] = true;
+
+		collector->last = n;
+	}
+
+	if(collector->batches > 0 && collector->now - collector->last_batch < collector->min_gap)
+		collector->min_gap = collector->now - collector->last_batch;
+
+	if(count > collector->largest_batch)
+		collector->largest_batch = count;
+
+	collector->received += count;
+	collector->last_batch = collector->now;
+	collector->batches++;
+
+	return (collector->message_id != 0) ? collector->message_id++ : 0;
+}
+
+static void drain_all(struct offline_telemetry * store, struct collector * collector){
+	while(offline_telemetry_drain(store, collector->now, collect, collector) > 0)
+		;
+}
+
+static struct offline_telemetry_config test_config(size_t block_count){
+	struct offline_telemetry_config config = {
+		.path = TEST_PATH,
+		.block_count = block_count,
+		.sync_interval = 60000,
+		.batch_records = 1000,
+		.batch_interval = 0,
+		.ack_timeout = 10000,
+	};
+
+	return config;
+}
+
+static void add_records(struct offline_telemetry * store, uint32_t first, uint32_t count, uint32_t now){
+	for(uint32_t n = first; n < first + count; n++){
+		struct offline_telemetry_record record = make_record(n);
+		offline_telemetry_add(store, &record, now);
+	}
+}
+
+static void overwrite(long offset, const void * data, size_t length){
+	FILE * fp = fopen(TEST_PATH, "r+b");
+	fseek(fp, offset, SEEK_SET);
+	fwrite(data, 1, length, fp);
+	fclose(fp);
+}
+
+static int check_wrap_around(void){
+	int failures = 0;
+	struct offline_telemetry_config config = test_config(4);
+	struct collector collector;
+
+	remove(TEST_PATH);
+
+	/* 6 full blocks and 5 records in a ring of 4 blocks */
+	struct offline_telemetry * store = offline_telemetry_open(&config);
+	add_records(store, 0, RECORDS_PER_BLOCK * 6 + 5, 0);
+
+	struct offline_telemetry_stats stats = offline_telemetry_get_stats(store);
+	if(stats.stored != RECORDS_PER_BLOCK * 3 + 5 || stats.overwritten != RECORDS_PER_BLOCK * 3 || stats.blocks_written != 6){
+		fprintf(stderr, "FAIL: wrap-around, %zu stored %u overwritten %u written\n", stats.stored, stats.overwritten,
+			stats.blocks_written);
+		failures++;
+	}
+
+	offline_telemetry_close(store);
+
+	store = offline_telemetry_open(&config);
+	collector_init(&collector);
+	drain_all(store, &collector);
+
+	if(!collector.valid || collector.first != RECORDS_PER_BLOCK * 3 || collector.last != RECORDS_PER_BLOCK * 6 + 4
+		|| collector.received != RECORDS_PER_BLOCK * 3 + 5){
+
+		fprintf(stderr, "FAIL: reopened after wrap-around, drained %u records %d-%d\n", collector.received,
+			collector.first, collector.last);
+		failures++;
+	}
+
+	/* The drained position is kept, and the ring wraps again from the partial block */
+	add_records(store, 200, RECORDS_PER_BLOCK * 5, 0);
+	offline_telemetry_close(store);
+
+	store = offline_telemetry_open(&config);
+	collector_init(&collector);
+	drain_all(store, &collector);
+
+	stats = offline_telemetry_get_stats(store);
+	uint32_t expected = RECORDS_PER_BLOCK * 3 + 5;
+	if(!collector.valid || collector.last != 200 + RECORDS_PER_BLOCK * 5 - 1 || collector.received != expected
+		|| stats.stored != 0){
+
+		fprintf(stderr, "FAIL: second lap, drained %u records %d-%d\n", collector.received, collector.first,
+			collector.last);
+		failures++;
+	}
+
+	offline_telemetry_close(store);
+
+	return failures;
+}
+
+static int check_power_loss(void){
+	int failures = 0;
+	struct offline_telemetry_config config = test_config(8);
+	struct collector collector;
+
+	remove(TEST_PATH);
+
+	/* Records in memory are lost, records synced or in a full block are not */
+	struct offline_telemetry * store = offline_telemetry_open(&config);
+	add_records(store, 0, 40, 0);
+	offline_telemetry_sync(store);
+	add_records(store, 40, 5, 1000);
+
+	struct offline_telemetry * after_loss = offline_telemetry_open(&config);
+	struct offline_telemetry_stats stats = offline_telemetry_get_stats(after_loss);
+	if(stats.stored != 40){
+		fprintf(stderr, "FAIL: power loss with records in memory, %zu stored\n", stats.stored);
+		failures++;
+	}
+
+	/* The first store is abandoned like at power loss. It has no unwritten data in its file buffer. */
+	(void)store;
+	offline_telemetry_close(after_loss);
+
+	/* The rewrite of the partial block is interrupted after 5 of its 9 records */
+	uint8_t garbage[16];
+	memset(garbage, 0xa5, sizeof(garbage));
+	overwrite(2 * 512 + 16 + 5 * 16, garbage, sizeof(garbage));
+
+	store = offline_telemetry_open(&config);
+	stats = offline_telemetry_get_stats(store);
+	if(stats.stored != RECORDS_PER_BLOCK + 5 || stats.corrupt != 4){
+		fprintf(stderr, "FAIL: interrupted records, %zu stored %u corrupt\n", stats.stored, stats.corrupt);
+		failures++;
+	}
+
+	/* Writing continues after the last valid record */
+	add_records(store, 100, 10, 0);
+	offline_telemetry_close(store);
+
+	store = offline_telemetry_open(&config);
+	collector_init(&collector);
+	drain_all(store, &collector);
+
+	if(!collector.valid || collector.received != RECORDS_PER_BLOCK + 5 + 10 || collector.last != 109){
+		fprintf(stderr, "FAIL: after interrupted records, drained %u records to %d\n", collector.received,
+			collector.last);
+		failures++;
+	}
+
+	offline_telemetry_close(store);
+
+	/* An interrupted write of a new block loses that block only */
+	remove(TEST_PATH);
+	store = offline_telemetry_open(&config);
+	add_records(store, 0, RECORDS_PER_BLOCK * 3 + 7, 0);
+	offline_telemetry_close(store);
+
+	overwrite(2 * 512, garbage, sizeof(garbage));
+	overwrite(4 * 512, garbage, sizeof(garbage));
+
+	store = offline_telemetry_open(&config);
+	collector_init(&collector);
+	drain_all(store, &collector);
+	stats = offline_telemetry_get_stats(store);
+
+	if(!collector.valid || collector.received != RECORDS_PER_BLOCK * 2 || collector.last != RECORDS_PER_BLOCK * 3 - 1
+		|| stats.corrupt != RECORDS_PER_BLOCK){
+
+		fprintf(stderr, "FAIL: interrupted block headers, drained %u records to %d, %u corrupt\n", collector.received,
+			collector.last, stats.corrupt);
+		failures++;
+	}
+
+	/* New records take the place of the lost head block */
+	add_records(store, 300, 3, 0);
+	offline_telemetry_close(store);
+
+	store = offline_telemetry_open(&config);
+	collector_init(&collector);
+	drain_all(store, &collector);
+
+	if(!collector.valid || collector.received != 3 || collector.first != 300){
+		fprintf(stderr, "FAIL: after lost head block, drained %u records from %d\n", collector.received,
+			collector.first);
+		failures++;
+	}
+
+	offline_telemetry_close(store);
+
+	/* An interrupted write of the drained position resends one batch */
+	remove(TEST_PATH);
+	config.batch_records = 20;
+	store = offline_telemetry_open(&config);
+	add_records(store, 0, 60, 0);
+
+	collector_init(&collector);
+	offline_telemetry_drain(store, 0, collect, &collector);
+	offline_telemetry_drain(store, 0, collect, &collector);
+	offline_telemetry_close(store);
+
+	/* The second position was written to the first slot */
+	overwrite(0, garbage, sizeof(garbage));
+
+	store = offline_telemetry_open(&config);
+	collector_init(&collector);
+	drain_all(store, &collector);
+
+	if(!collector.valid || collector.first != 20 || collector.received != 40){
+		fprintf(stderr, "FAIL: interrupted position, drained %u records from %d\n", collector.received, collector.first);
+		failures++;
+	}
+
+	offline_telemetry_close(store);
+
+	return failures;
+}
+
+/* A batch given with a message id is drained when acknowledged, and given again if deleted or not acknowledged */
+static int check_acknowledgement(void){
+	int failures = 0;
+	struct offline_telemetry_config config = test_config(8);
+	config.batch_records = 10;
+	struct collector collector;
+
+	remove(TEST_PATH);
+
+	struct offline_telemetry * store = offline_telemetry_open(&config);
+	add_records(store, 0, 40, 0);
+
+	collector_init(&collector);
+	collector.message_id = 100;
+
+	/* Nothing more is given while the batch waits, and other messages are not matched */
+	int first = offline_telemetry_drain(store, 0, collect, &collector);
+	int waiting = offline_telemetry_drain(store, 1000, collect, &collector);
+	bool other = offline_telemetry_acknowledge(store, 55, true);
+
+	if(first != 10 || waiting != 0 || other || offline_telemetry_get_stats(store).stored != 40){
+		fprintf(stderr, "FAIL: waiting batch, gave %d then %d, other message %s\n", first, waiting,
+			other ? "matched" : "not matched");
+		failures++;
+	}
+
+	/* Acknowledged */
+	bool matched = offline_telemetry_acknowledge(store, 100, true);
+	if(!matched || offline_telemetry_get_stats(store).stored != 30){
+		fprintf(stderr, "FAIL: acknowledged batch, %zu stored\n", offline_telemetry_get_stats(store).stored);
+		failures++;
+	}
+
+	/* Deleted by the client, the same records are given again */
+	offline_telemetry_drain(store, 2000, collect, &collector);
+	offline_telemetry_acknowledge(store, 101, false);
+	offline_telemetry_drain(store, 3000, collect, &collector);
+
+	/* Not acknowledged within the timeout, given again */
+	offline_telemetry_drain(store, 3000 + config.ack_timeout, collect, &collector);
+	bool late = offline_telemetry_acknowledge(store, 102, true);
+	offline_telemetry_acknowledge(store, 103, true);
+
+	struct offline_telemetry_stats stats = offline_telemetry_get_stats(store);
+	if(collector.batches != 4 || collector.last != 19 || late || stats.stored != 20 || stats.drained != 20){
+		fprintf(stderr, "FAIL: resent batches, %u batches to %d, %zu stored %u drained, late ack %s\n",
+			collector.batches, collector.last, stats.stored, stats.drained, late ? "matched" : "not matched");
+		failures++;
+	}
+
+	/* Only the acknowledged position is kept */
+	offline_telemetry_drain(store, 20000, collect, &collector);
+	offline_telemetry_close(store);
+
+	store = offline_telemetry_open(&config);
+	collector_init(&collector);
+	drain_all(store, &collector);
+
+	if(!collector.valid || collector.first != 20 || collector.received != 20){
+		fprintf(stderr, "FAIL: reopened with waiting batch, drained %u records from %d\n", collector.received,
+			collector.first);
+		failures++;
+	}
+
+	offline_telemetry_close(store);
+
+	return failures;
+}
+
+/*
+ * Overwrites random bytes in a random part of the file. Records outside the blocks that were hit must all be drained,
+ * and only valid records may be drained.
+ */
+static int check_random_interruptions(uint32_t iterations){
+	int failures = 0;
+	struct offline_telemetry_config config = test_config(16);
+	config.batch_records = 64;
+
+	srand(1);
+
+	for(uint32_t iteration = 0; iteration < iterations; iteration++){
+		remove(TEST_PATH);
+
+		struct offline_telemetry * store = offline_telemetry_open(&config);
+		uint32_t total = rand() % 400;
+		uint32_t drained = (total > 0) ? rand() % total : 0;
+
+		for(uint32_t n = 0; n < total; n++){
+			struct offline_telemetry_record record = make_record(n);
+			offline_telemetry_add(store, &record, n * 1000);
+		}
+
+		struct collector collector;
+		collector_init(&collector);
+
+		config.batch_records = drained;
+		offline_telemetry_close(store);
+
+		if(drained > 0){
+			store = offline_telemetry_open(&config);
+			offline_telemetry_drain(store, 0, collect, &collector);
+			offline_telemetry_close(store);
+		}
+
+		config.batch_records = 64;
+
+		uint8_t garbage[512];
+		long offset = rand() % (512 * 17);
+		size_t length = 1 + rand() % sizeof(garbage);
+		for(size_t i = 0; i < length; i++)
+			garbage[i] = rand();
+
+		overwrite(offset, garbage, length);
+
+		long first_hit = offset / 512;
+		long last_hit = (offset + length - 1) / 512;
+
+		store = offline_telemetry_open(&config);
+		if(store == NULL){
+			fprintf(stderr, "FAIL: iteration %u does not open\n", iteration);
+			failures++;
+			continue;
+		}
+
+		bool * received = calloc(total + 1, sizeof(bool));
+		collector_init(&collector);
+		collector.numbers = received;
+		collector.numbers_size = total;
+		drain_all(store, &collector);
+
+		/* Record n is in block sequence (n + 31) / 31, at file block sequence */
+		for(uint32_t n = drained; n < total; n++){
+			long block = (n + RECORDS_PER_BLOCK) / RECORDS_PER_BLOCK;
+			if(!received[n] && (block < first_hit || block > last_hit)){
+				collector.valid = false;
+				break;
+			}
+		}
+
+		if(!collector.valid){
+			fprintf(stderr, "FAIL: iteration %u, %u records, %u drained, %zu bytes at %ld\n", iteration, total, drained,
+				length, offset);
+			failures++;
+		}
+
+		free(received);
+		offline_telemetry_close(store);
+	}
+
+	return failures;
+}
+
+static int check_drain_rate(uint32_t records, uint32_t batch_records, uint32_t interval){
+	int failures = 0;
+	struct offline_telemetry_config config = test_config(64);
+	config.batch_records = batch_records;
+	config.batch_interval = interval;
+
+	remove(TEST_PATH);
+
+	struct offline_telemetry * store = offline_telemetry_open(&config);
+	add_records(store, 0, records, 0);
+
+	struct collector collector;
+	collector_init(&collector);
+
+	/* Called every 100 ms, with the cloud not accepting messages for 3 seconds */
+	uint32_t failed = 0;
+	for(collector.now = 0; collector.now < 3600000; collector.now += 100){
+		collector.fail = (collector.now >= 5000 && collector.now < 8000) ? -1 : 0;
+
+		if(offline_telemetry_drain(store, collector.now, collect, &collector) < 0)
+			failed++;
+
+		if(offline_telemetry_get_stats(store).stored == 0)
+			break;
+	}
+
+	printf("drained %u records in %u batches over %u ms, %u failed, largest %zu, shortest gap %u ms\n",
+		collector.received, collector.batches, collector.now, failed, collector.largest_batch, collector.min_gap);
+
+	uint32_t expected_batches = (records + batch_records - 1) / batch_records;
+	if(!collector.valid || collector.received != records || collector.batches != expected_batches
+		|| collector.largest_batch > batch_records || collector.min_gap < interval || failed != 1){
+
+		fprintf(stderr, "FAIL: drain rate\n");
+		failures++;
+	}
+
+	offline_telemetry_close(store);
+
+	return failures;
+}
+
+/* Records one value every 10 seconds for an hour, and compares the blocks written to writing each record at once */
+static void print_write_amplification(uint32_t sync_interval){
+	struct offline_telemetry_config config = test_config(64);
+	config.sync_interval = sync_interval;
+
+	remove(TEST_PATH);
+
+	struct offline_telemetry * store = offline_telemetry_open(&config);
+	const uint32_t records = 360;
+	for(uint32_t n = 0; n < records; n++){
+		struct offline_telemetry_record record = make_record(n);
+		offline_telemetry_add(store, &record, n * 10000);
+	}
+
+	struct offline_telemetry_stats stats = offline_telemetry_get_stats(store);
+	offline_telemetry_close(store);
+
+	printf("sync every %u s: %u records, %u blocks written, %.2f blocks per record\n", sync_interval / 1000, records,
+		stats.blocks_written, (double)stats.blocks_written / records);
+}
+
+int main(int argc, char ** argv){
+	uint32_t iterations = 1000;
+
+	int opt;
+	while((opt = getopt(argc, argv, "n:")) != -1){
+		switch(opt){
+		case 'n':
+			iterations = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n random interruptions]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	esp_log_level_set("*", ESP_LOG_NONE);
+
+	int failures = check_wrap_around();
+	failures += check_power_loss();
+	failures += check_acknowledgement();
+	failures += check_random_interruptions(iterations);
+	failures += check_drain_rate(1000, 50, 2000);
+
+	print_write_amplification(60000);
+	print_write_amplification(300000);
+
+	remove(TEST_PATH);
+
+	if(failures != 0){
+		printf("%d failures\n", failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
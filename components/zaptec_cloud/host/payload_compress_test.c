@@ -0,0 +1,503 @@
+/*
+ * Tests payload_compress round trips with input and output in pieces of many sizes, rejection of corrupt streams, and
+ * measures ratio and time for large events with each window size.
+ *
+ * The samples are synthetic. They are built the way the firmware builds them: a CompletedSession observation with the
+ * hourly OCMF readings of an 8 and a 72 hour session, a Diagnostics observation with a text log, 24 SignedMeterValue
+ * observations in one collection and a telemetry_all collection.
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "cJSON.h"
+
+#include "observation_batch.h"
+#include "payload_compress.h"
+
+#define SESSION_START 1710230400 /* 2024-03-12T08:00:00Z */
+
+static int failures;
+static unsigned int seed = 1;
+
+struct buffer{
+	uint8_t * data;
+	size_t length;
+	size_t size;
+	size_t write_size; ///< Largest write seen
+};
+
+static esp_err_t append(const uint8_t * data, size_t length, void * context){
+	struct buffer * buffer = context;
+
+	if(buffer->length + length > buffer->size){
+		buffer->size = (buffer->length + length) * 2;
+		buffer->data = realloc(buffer->data, buffer->size);
+	}
+
+	memcpy(buffer->data + buffer->length, data, length);
+	buffer->length += length;
+
+	if(length > buffer->write_size)
+		buffer->write_size = length;
+
+	return ESP_OK;
+}
+
+static esp_err_t compress_pieces(const uint8_t * data, size_t length, uint8_t window_bits, uint8_t lookahead_bits,
+				size_t piece, struct buffer * output){
+	struct payload_compress_config config = {window_bits, lookahead_bits, append, output};
+
+	struct payload_compressor * compressor = payload_compressor_create(&config);
+	if(compressor == NULL)
+		return ESP_ERR_NO_MEM;
+
+	esp_err_t err = ESP_OK;
+	for(size_t offset = 0; offset < length && err == ESP_OK; offset += piece)
+		err = payload_compressor_write(compressor, data + offset, (length - offset < piece) ? length - offset : piece);
+
+	if(err == ESP_OK)
+		err = payload_compressor_finish(compressor);
+
+	if(err == ESP_OK && payload_compressor_written(compressor) != output->length)
+		err = ESP_FAIL;
+
+	payload_compressor_free(compressor);
+	return err;
+}
+
+static esp_err_t decompress_pieces(const uint8_t * data, size_t length, uint8_t window_bits, uint8_t lookahead_bits,
+				size_t piece, struct buffer * output){
+	struct payload_compress_config config = {window_bits, lookahead_bits, append, output};
+
+	struct payload_decompressor * decompressor = payload_decompressor_create(&config);
+	if(decompressor == NULL)
+		return ESP_ERR_NO_MEM;
+
+	esp_err_t err = ESP_OK;
+	for(size_t offset = 0; offset < length && err == ESP_OK; offset += piece)
+		err = payload_decompressor_write(decompressor, data + offset, (length - offset < piece) ? length - offset : piece);
+
+	if(err == ESP_OK)
+		err = payload_decompressor_finish(decompressor);
+
+	payload_decompressor_free(decompressor);
+	return err;
+}
+
+static void check_round_trip(const char * name, const uint8_t * data, size_t length){
+	static const size_t pieces[] = {1, 7, 64, 1000, SIZE_MAX};
+
+	for(uint8_t window_bits = PAYLOAD_COMPRESS_MIN_WINDOW_BITS; window_bits <= PAYLOAD_COMPRESS_MAX_WINDOW_BITS; window_bits++){
+		for(uint8_t lookahead_bits = 3; lookahead_bits < window_bits && lookahead_bits <= 8; lookahead_bits++){
+			struct buffer reference = {0};
+
+			for(size_t i = 0; i < sizeof(pieces) / sizeof(pieces[0]); i++){
+				struct buffer compressed = {0};
+				struct buffer decompressed = {0};
+
+				esp_err_t err = compress_pieces(data, length, window_bits, lookahead_bits, pieces[i], &compressed);
+				if(err == ESP_OK)
+					err = decompress_pieces(compressed.data, compressed.length, window_bits, lookahead_bits,
+								pieces[(i + 2) % 5], &decompressed);
+
+				if(err != ESP_OK || decompressed.length != length
+					|| (length > 0 && memcmp(decompressed.data, data, length) != 0)
+					|| compressed.write_size > PAYLOAD_COMPRESS_OUTPUT_SIZE
+					|| decompressed.write_size > PAYLOAD_COMPRESS_OUTPUT_SIZE){
+					fprintf(stderr, "FAIL: %s w%u l%u, pieces of %zu: error %d, %zu of %zu bytes\n", name, window_bits,
+						lookahead_bits, pieces[i], err, decompressed.length, length);
+					failures++;
+				}
+
+				/* Compressed output must not depend on how the input was split */
+				if(i == 0){
+					reference = compressed;
+					compressed = (struct buffer){0};
+
+				}else if(compressed.length != reference.length
+					|| (reference.length > 0 && memcmp(compressed.data, reference.data, reference.length) != 0)){
+					fprintf(stderr, "FAIL: %s w%u l%u, output differs with pieces of %zu\n", name, window_bits,
+						lookahead_bits, pieces[i]);
+					failures++;
+				}
+
+				free(compressed.data);
+				free(decompressed.data);
+			}
+
+			free(reference.data);
+		}
+	}
+}
+
+static void check_round_trips(void){
+	check_round_trip("empty", (const uint8_t *)"", 0);
+	check_round_trip("one byte", (const uint8_t *)"{", 1);
+
+	uint8_t * data = malloc(20000);
+
+	memset(data, 'a', 20000);
+	check_round_trip("repeated", data, 20000);
+
+	for(size_t i = 0; i < 20000; i++)
+		data[i] = rand_r(&seed);
+	check_round_trip("random", data, 20000);
+
+	/* Repetitions at every distance, crossing the window and buffer boundaries */
+	for(size_t i = 0; i < 20000; i++)
+		data[i] = (rand_r(&seed) % 4 == 0) ? data[i - (i > 0 ? 1 + rand_r(&seed) % (i < 5000 ? i : 5000) : 0)] : 'a' + rand_r(&seed) % 8;
+	check_round_trip("mixed", data, 20000);
+
+	free(data);
+}
+
+static void check_errors(void){
+	struct buffer output = {0};
+	struct payload_compress_config config = {8, 4, append, &output};
+
+	/* Copy of one byte at distance 1 before anything was written */
+	struct payload_decompressor * decompressor = payload_decompressor_create(&config);
+	esp_err_t err = payload_decompressor_write(decompressor, (const uint8_t[]){0x00, 0x00}, 2);
+	if(err != ESP_ERR_INVALID_ARG){
+		fprintf(stderr, "FAIL: copy before start gave %d\n", err);
+		failures++;
+	}
+	payload_decompressor_free(decompressor);
+
+	/* A literal 'a' is 0xb0 0x80, so the first byte alone ends inside the literal */
+	output.length = 0;
+	decompressor = payload_decompressor_create(&config);
+	err = payload_decompressor_write(decompressor, (const uint8_t[]){0xb0}, 1);
+	if(err == ESP_OK)
+		err = payload_decompressor_finish(decompressor);
+	if(err != ESP_ERR_INVALID_SIZE){
+		fprintf(stderr, "FAIL: stream ending inside an item gave %d\n", err);
+		failures++;
+	}
+	payload_decompressor_free(decompressor);
+
+	/* Truncated streams must not decode to the original */
+	char text[4000];
+	size_t text_length = 0;
+	while(text_length < sizeof(text) - 64)
+		text_length += snprintf(text + text_length, sizeof(text) - text_length, "{\"RV\":%u,\"ST\":\"G\"},",
+					rand_r(&seed) % 100000);
+
+	uint8_t compressed[4000];
+	size_t compressed_length;
+	err = payload_compress(text, text_length, 10, 5, compressed, sizeof(compressed), &compressed_length);
+	if(err != ESP_OK){
+		fprintf(stderr, "FAIL: compress gave %d\n", err);
+		failures++;
+	}
+
+	for(size_t length = 0; err == ESP_OK && length < compressed_length; length++){
+		output.length = 0;
+		esp_err_t result = decompress_pieces(compressed, length, 10, 5, 13, &output);
+		if(result == ESP_OK && output.length == text_length && memcmp(output.data, text, text_length) == 0){
+			fprintf(stderr, "FAIL: %zu of %zu bytes decode to the original\n", length, compressed_length);
+			failures++;
+		}
+	}
+
+	if(payload_compress(text, text_length, 10, 5, compressed, compressed_length - 1, &compressed_length)
+		!= ESP_ERR_INVALID_SIZE){
+		fprintf(stderr, "FAIL: output one byte too small is accepted\n");
+		failures++;
+	}
+
+	if(payload_compress(text, text_length, 13, 5, compressed, sizeof(compressed), &compressed_length) != ESP_ERR_INVALID_ARG
+		|| payload_compress(text, text_length, 10, 10, compressed, sizeof(compressed), &compressed_length) != ESP_ERR_INVALID_ARG
+		|| payload_compress(text, text_length, 10, 2, compressed, sizeof(compressed), &compressed_length) != ESP_ERR_INVALID_ARG){
+		fprintf(stderr, "FAIL: invalid window or lookahead is accepted\n");
+		failures++;
+	}
+
+	struct payload_compressor * compressor = payload_compressor_create(&config);
+	payload_compressor_finish(compressor);
+	if(payload_compressor_write(compressor, "a", 1) != ESP_ERR_INVALID_STATE
+		|| payload_compressor_finish(compressor) != ESP_ERR_INVALID_STATE){
+		fprintf(stderr, "FAIL: compressor accepts data after finish\n");
+		failures++;
+	}
+	payload_compressor_free(compressor);
+
+	free(output.data);
+}
+
+static void format_time(time_t time, const char * format, char * buffer, size_t size){
+	struct tm timeinfo;
+	gmtime_r(&time, &timeinfo);
+	strftime(buffer, size, format, &timeinfo);
+}
+
+/* As OCMF_CompletedSession_AddElementToOCMFLog and offlineSession_GetSignedSessionFromActiveFile */
+static void add_reading(cJSON * readings, time_t time, const char * type, double energy){
+	char tm[50];
+	format_time(time, "%Y-%m-%dT%H:%M:%S,000+00:00 R", tm, sizeof(tm));
+
+	cJSON * reading = cJSON_CreateObject();
+	cJSON_AddStringToObject(reading, "TM", tm);
+	cJSON_AddStringToObject(reading, "TX", type);
+	cJSON_AddNumberToObject(reading, "RV", energy);
+	cJSON_AddStringToObject(reading, "RI", "1-0:1.8.0");
+	cJSON_AddStringToObject(reading, "RU", "kWh");
+	cJSON_AddStringToObject(reading, "RT", "AC");
+	cJSON_AddStringToObject(reading, "ST", "G");
+	cJSON_AddItemToArray(readings, reading);
+}
+
+static cJSON * create_ocmf_root(const char * pagination){
+	cJSON * root = cJSON_CreateObject();
+	cJSON_AddStringToObject(root, "FV", "1.0");
+	cJSON_AddStringToObject(root, "GI", "ZAPTEC GO");
+	cJSON_AddStringToObject(root, "GS", "ZAP049872");
+	cJSON_AddStringToObject(root, "GV", "2.2.0.1");
+	cJSON_AddStringToObject(root, "PG", pagination);
+
+	return root;
+}
+
+static char * print_ocmf(cJSON * root){
+	char * json = cJSON_PrintUnformatted(root);
+	char * ocmf = malloc(strlen(json) + 6);
+	sprintf(ocmf, "OCMF|%s", json);
+
+	free(json);
+	cJSON_Delete(root);
+	return ocmf;
+}
+
+static char * observed_at(time_t time){
+	static char buffer[OBSERVATION_BATCH_TIMESTAMP_SIZE];
+	char seconds[24];
+	format_time(time, "%Y-%m-%dT%H:%M:%S", seconds, sizeof(seconds));
+	snprintf(buffer, sizeof(buffer), "%s.%06uZ", seconds, rand_r(&seed) % 1000000);
+
+	return buffer;
+}
+
+static char * finish_collection(struct observation_batch * batch){
+	char * json = strdup(observation_batch_finish(batch, NULL));
+	observation_batch_free(batch);
+
+	return json;
+}
+
+/* As chargeSession_GetSessionAsString and OCMF_CompletedSession_FinalizeOCMFLog */
+static char * create_completed_session(int hours){
+	cJSON * root = create_ocmf_root("T1");
+	cJSON * readings = cJSON_CreateArray();
+
+	double energy = 0.0;
+	add_reading(readings, SESSION_START, "B", energy);
+
+	for(int hour = 1; hour <= hours; hour++){
+		/* Charges 11 kW for 8 hours and then stays connected */
+		if(hour <= 8)
+			energy += 10.9 + (rand_r(&seed) % 200) / 1000.0;
+
+		add_reading(readings, SESSION_START + hour * 3600, (hour == hours) ? "E" : "T", energy);
+	}
+
+	cJSON_AddItemToObject(root, "RD", readings);
+	char * signed_session = print_ocmf(root);
+
+	char start[OBSERVATION_BATCH_TIMESTAMP_SIZE];
+	char end[OBSERVATION_BATCH_TIMESTAMP_SIZE];
+	strcpy(start, observed_at(SESSION_START));
+	strcpy(end, observed_at(SESSION_START + hours * 3600 + 120));
+
+	cJSON * session = cJSON_CreateObject();
+	cJSON_AddStringToObject(session, "SessionId", "8f3b2c1e-4a5d-4e6f-9a7b-0c1d2e3f4a5b");
+	cJSON_AddNumberToObject(session, "Energy", energy);
+	cJSON_AddStringToObject(session, "StartDateTime", start);
+	cJSON_AddStringToObject(session, "EndDateTime", end);
+	cJSON_AddBoolToObject(session, "ReliableClock", true);
+	cJSON_AddBoolToObject(session, "StoppedByRFID", false);
+	cJSON_AddStringToObject(session, "AuthenticationCode", "nfc-04A2B3C4D5E680");
+	cJSON_AddStringToObject(session, "SignedSession", signed_session);
+
+	char * session_json = cJSON_PrintUnformatted(session);
+	cJSON_Delete(session);
+	free(signed_session);
+
+	struct observation_batch * batch = observation_batch_create(1024, end);
+	observation_batch_add(batch, 723, session_json, NULL);
+	free(session_json);
+
+	return finish_collection(batch);
+}
+
+/* Lines as written by the offline session and diagnostics logs */
+static char * create_diagnostics(void){
+	static const char * lines[] = {
+		"I (%u) OFFLINE_SESSION: Using file %u, %u bytes\n",
+		"W (%u) CLOUD LISTENER : MQTT_EVENT_DISCONNECTED, reconnect %u after %u ms\n",
+		"I (%u) SESSION        : Energy %u.%03u kWh in session\n",
+		"E (%u) OCMF           : 2#### Sess: %u.%03u vs Signed: %u.%03u -> Diff: 0.000000 #### FAILED\n",
+		"I (%u) CLOUD LISTENER : MQTT_EVENT_CONNECTED, %u subscriptions, %u ms\n",
+		"W (%u) PPP_TASK       : AT response %u timed out after %u ms\n",
+	};
+
+	char * log = malloc(4096);
+	size_t length = 0;
+	unsigned int uptime = 120000;
+
+	while(length < 3900){
+		uptime += rand_r(&seed) % 60000;
+		length += snprintf(log + length, 4096 - length, lines[rand_r(&seed) % 6], uptime, rand_r(&seed) % 100,
+				rand_r(&seed) % 5000, rand_r(&seed) % 1000, rand_r(&seed) % 1000);
+	}
+
+	struct observation_batch * batch = observation_batch_create(1024, observed_at(SESSION_START));
+	observation_batch_add(batch, 808, log, NULL);
+	free(log);
+
+	return finish_collection(batch);
+}
+
+/* As OCMF_SignedMeterValue_CreateMessageFromLog for the offline log */
+static char * create_signed_meter_values(void){
+	struct observation_batch * batch = observation_batch_create(1024, observed_at(SESSION_START));
+	double energy = 1834.271;
+
+	for(int hour = 0; hour < 24; hour++){
+		time_t time = SESSION_START + hour * 3600;
+		char tm[50];
+		format_time(time, "%Y-%m-%dT%H:%M:%S,000+00:00 R", tm, sizeof(tm));
+
+		cJSON * root = create_ocmf_root("F1");
+		cJSON * readings = cJSON_CreateArray();
+		cJSON * reading = cJSON_CreateObject();
+		cJSON_AddStringToObject(reading, "TM", tm);
+		cJSON_AddNumberToObject(reading, "RV", energy);
+		cJSON_AddStringToObject(reading, "RI", "1-0:1.8.0");
+		cJSON_AddStringToObject(reading, "RU", "kWh");
+		cJSON_AddStringToObject(reading, "RT", "AC");
+		cJSON_AddStringToObject(reading, "ST", "G");
+		cJSON_AddItemToArray(readings, reading);
+		cJSON_AddItemToObject(root, "RD", readings);
+
+		char * ocmf = print_ocmf(root);
+		observation_batch_add(batch, 554, ocmf, observed_at(time));
+		free(ocmf);
+
+		if(hour >= 8 && hour < 16)
+			energy += 10.9 + (rand_r(&seed) % 200) / 1000.0;
+	}
+
+	return finish_collection(batch);
+}
+
+static char * create_telemetry_all(void){
+	static const int ids[] = {201, 202, 204, 205, 206, 207, 270, 501, 502, 503, 507, 508, 509, 510, 513, 809};
+
+	struct observation_batch * batch = observation_batch_create(1024, observed_at(SESSION_START));
+
+	for(size_t i = 0; i < sizeof(ids) / sizeof(ids[0]); i++){
+		char value[32];
+		snprintf(value, sizeof(value), "%.3f", (rand_r(&seed) % 250000) / 1000.0);
+		observation_batch_add(batch, ids[i], value, NULL);
+	}
+
+	char text[256];
+	snprintf(text, sizeof(text), "2024-03-12 08:00:00 T_EM: 35.21 34.70 35.02  T_M: 39.20 37.70   V: 231.20 230.80 "
+		"232.10   I: 15.87 15.87 15.87  11.000kW 42.118kWh C3 CM3 MCnt:12345 Rs:0 Rc:0");
+	observation_batch_add(batch, 808, text, NULL);
+
+	return finish_collection(batch);
+}
+
+static double elapsed_ns(const struct timespec * start){
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+static void benchmark(const char * name, const char * sample, int iterations){
+	static const uint8_t configs[][2] = {{8, 4}, {9, 4}, {10, 5}, {11, 5}, {12, 6}};
+
+	size_t length = strlen(sample);
+	check_round_trip(name, (const uint8_t *)sample, length);
+
+	printf("%-22s %6zu bytes\n", name, length);
+
+	for(size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++){
+		uint8_t window_bits = configs[i][0];
+		uint8_t lookahead_bits = configs[i][1];
+
+		struct buffer compressed = {0};
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		for(int n = 0; n < iterations; n++){
+			compressed.length = 0;
+			compress_pieces((const uint8_t *)sample, length, window_bits, lookahead_bits, SIZE_MAX, &compressed);
+		}
+
+		double compress_ns = elapsed_ns(&start) / iterations;
+
+		struct buffer decompressed = {0};
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		for(int n = 0; n < iterations; n++){
+			decompressed.length = 0;
+			decompress_pieces(compressed.data, compressed.length, window_bits, lookahead_bits, SIZE_MAX, &decompressed);
+		}
+
+		double decompress_ns = elapsed_ns(&start) / iterations;
+
+		printf("  w%-2u l%u %5zu B state: %6zu bytes %5.1f%%, compress %6.0f ns/KiB, decompress %5.0f ns/KiB\n",
+			window_bits, lookahead_bits, payload_compressor_size(window_bits), compressed.length,
+			100.0 * compressed.length / length, compress_ns * 1024 / length, decompress_ns * 1024 / length);
+
+		free(compressed.data);
+		free(decompressed.data);
+	}
+}
+
+int main(int argc, char ** argv){
+	int iterations = 20;
+
+	int opt;
+	while((opt = getopt(argc, argv, "n:")) != -1){
+		switch(opt){
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n benchmark iterations]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if(iterations < 1)
+		iterations = 1;
+
+	check_round_trips();
+	check_errors();
+
+	char * samples[] = {create_completed_session(8), create_completed_session(72), create_diagnostics(),
+		create_signed_meter_values(), create_telemetry_all()};
+	const char * names[] = {"CompletedSession 8 h", "CompletedSession 72 h", "Diagnostics", "SignedMeterValue x24",
+		"telemetry_all"};
+
+	for(size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++){
+		benchmark(names[i], samples[i], iterations);
+		free(samples[i]);
+	}
+
+	if(failures != 0){
+		printf("%d failures\n", failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,462 @@
+/*
+ * Tests publish_queue with a stubbed MQTT client on a congested link, and compares it to publishing every message
+ * directly to the MQTT client as before.
+ *
+ * The stub client sends QoS 1 messages one at a time over a link with limited bandwidth and acknowledges each message a
+ * round trip later. While disconnected, messages published directly are kept in the outbox and sent on reconnect, like
+ * esp-mqtt does. The charger publishes the power state every second, a full telemetry snapshot every 10 seconds and an
+ * on change event every 5 seconds.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "esp_log.h"
+
+#include "publish_queue.h"
+
+#define KEY_POWER 513
+#define KEY_TELEMETRY_ALL 100000
+
+#define TICK_MS 100
+
+struct outbox_message{
+	struct outbox_message * next;
+	int id;
+	size_t length;
+	uint32_t ack_time; ///< Time the acknowledgement is received, 0 until transmitted
+	char * payload;
+};
+
+struct link{
+	uint32_t bytes_per_second;
+	uint32_t round_trip_ms;
+	bool connected;
+	uint32_t now;
+	uint32_t busy_until; ///< Time the link is done sending the current message
+
+	struct outbox_message * outbox;
+	size_t outbox_bytes;
+	size_t outbox_peak;
+	int next_id;
+
+	uint32_t transmitted;
+	size_t transmitted_bytes;
+
+	/* Last value received by the cloud for each state and the last event sequence number */
+	int last_power;
+	int last_all;
+	int last_event;
+	bool events_in_order;
+
+	struct publish_queue * queue; ///< Acknowledged to the queue if not NULL
+};
+
+static int client_publish(const char * payload, size_t length, uint32_t flags, void * context){
+	struct link * link = context;
+
+	struct outbox_message * message = calloc(1, sizeof(struct outbox_message));
+	message->id = ++link->next_id;
+	message->length = length;
+	message->payload = strndup(payload, length);
+
+	struct outbox_message ** last = &link->outbox;
+	while(*last != NULL)
+		last = &(*last)->next;
+	*last = message;
+
+	link->outbox_bytes += length;
+	if(link->outbox_bytes > link->outbox_peak)
+		link->outbox_peak = link->outbox_bytes;
+
+	return message->id;
+}
+
+static void receive(struct link * link, const char * payload){
+	int key, value;
+	if(sscanf(payload, "{\"Key\":%d,\"Value\":%d", &key, &value) != 2)
+		return;
+
+	if(key == KEY_POWER){
+		link->last_power = value;
+
+	}else if(key == KEY_TELEMETRY_ALL){
+		link->last_all = value;
+
+	}else{
+		if(value <= link->last_event)
+			link->events_in_order = false;
+		link->last_event = value;
+	}
+}
+
+/* Transmits the outbox in order and acknowledges messages a round trip after they are sent */
+static void link_tick(struct link * link){
+	link->now += TICK_MS;
+
+	if(!link->connected){
+		/* Unacknowledged messages are sent again after reconnect */
+		for(struct outbox_message * message = link->outbox; message != NULL; message = message->next)
+			message->ack_time = 0;
+
+		link->busy_until = link->now;
+		return;
+	}
+
+	for(struct outbox_message * message = link->outbox; message != NULL; message = message->next){
+		if(message->ack_time != 0)
+			continue;
+
+		if(link->busy_until > link->now)
+			break;
+
+		uint32_t start = (link->busy_until > link->now - TICK_MS) ? link->busy_until : link->now - TICK_MS;
+		link->busy_until = start + (message->length * 1000) / link->bytes_per_second;
+		message->ack_time = link->busy_until + link->round_trip_ms;
+
+		link->transmitted++;
+		link->transmitted_bytes += message->length;
+	}
+
+	while(link->outbox != NULL && link->outbox->ack_time != 0 && link->outbox->ack_time <= link->now){
+		struct outbox_message * message = link->outbox;
+		link->outbox = message->next;
+		link->outbox_bytes -= message->length;
+
+		receive(link, message->payload);
+
+		if(link->queue != NULL)
+			publish_queue_on_published(link->queue, message->id);
+
+		free(message->payload);
+		free(message);
+	}
+}
+
+struct result{
+	uint32_t transmitted;
+	size_t transmitted_bytes;
+	size_t peak_bytes;
+	uint32_t drain_ms;
+	int last_power;
+	int last_all;
+	int last_event;
+	bool events_in_order;
+	struct publish_queue_stats stats;
+};
+
+static void create_payload(char * buffer, size_t size, int key, int value, size_t length){
+	int written = snprintf(buffer, size, "{\"Key\":%d,\"Value\":%d,\"Data\":\"", key, value);
+	while((size_t)written < length - 2 && (size_t)written < size - 3)
+		buffer[written++] = 'x';
+	strcpy(buffer + written, "\"}");
+}
+
+/*
+ * Runs the charger for duration_s seconds with the link down from disconnect_s to reconnect_s, then runs until the
+ * outbox is empty.
+ */
+static struct result simulate(bool use_queue, uint32_t bytes_per_second, uint32_t duration_s, uint32_t disconnect_s,
+			uint32_t reconnect_s){
+
+	struct link link = {
+		.bytes_per_second = bytes_per_second,
+		.round_trip_ms = 600,
+		.connected = true,
+		.events_in_order = true,
+	};
+
+	struct publish_queue_config config = {
+		.max_bytes = 16384,
+		.max_in_flight = 2,
+		.overflow = ePUBLISH_QUEUE_DROP_OLDEST,
+		.send = client_publish,
+		.context = &link,
+	};
+
+	if(use_queue){
+		link.queue = publish_queue_create(&config);
+		publish_queue_set_connected(link.queue, true);
+	}
+
+	size_t peak = 0;
+	char payload[1200];
+	int event = 0;
+
+	uint32_t end = duration_s * 1000;
+	uint32_t drained = 0;
+
+	while(link.now < end || link.outbox != NULL || (use_queue && publish_queue_get_stats(link.queue).queued > 0)){
+		if(link.now > end + 3600 * 1000){
+			fprintf(stderr, "outbox not drained after an hour\n");
+			break;
+		}
+
+		bool connected = !(link.now >= disconnect_s * 1000 && link.now < reconnect_s * 1000);
+		if(connected != link.connected){
+			link.connected = connected;
+			if(use_queue)
+				publish_queue_set_connected(link.queue, connected);
+		}
+
+		if(link.now < end && link.now % 1000 == 0){
+			uint32_t second = link.now / 1000;
+			if(second % 5 == 0)
+				event++;
+
+			struct{
+				int key;
+				int value;
+				size_t length;
+				bool due;
+			} messages[] = {
+				{KEY_POWER, second, 180, true},
+				{KEY_TELEMETRY_ALL, second, 1100, second % 10 == 0},
+				{PUBLISH_QUEUE_EVENT, event, 300, second % 5 == 0},
+			};
+
+			for(size_t i = 0; i < sizeof(messages) / sizeof(messages[0]); i++){
+				if(!messages[i].due)
+					continue;
+
+				create_payload(payload, sizeof(payload), messages[i].key, messages[i].value, messages[i].length);
+
+				if(use_queue){
+					publish_queue_add(link.queue, messages[i].key, payload);
+				}else{
+					client_publish(payload, strlen(payload), 0, &link);
+				}
+			}
+		}
+
+		link_tick(&link);
+
+		size_t bytes = link.outbox_bytes;
+		if(use_queue)
+			bytes += publish_queue_get_stats(link.queue).queued_bytes;
+		if(bytes > peak)
+			peak = bytes;
+
+		drained = link.now;
+	}
+
+	struct result result = {
+		.transmitted = link.transmitted,
+		.transmitted_bytes = link.transmitted_bytes,
+		.peak_bytes = peak,
+		.drain_ms = drained - end,
+		.last_power = link.last_power,
+		.last_all = link.last_all,
+		.last_event = link.last_event,
+		.events_in_order = link.events_in_order,
+	};
+
+	if(use_queue)
+		result.stats = publish_queue_get_stats(link.queue);
+
+	return result;
+}
+
+static int sent_count;
+static char last_sent[64];
+static size_t last_length;
+static uint32_t last_flags;
+static struct publish_queue * ack_queue;
+static int send_result;
+
+static int record_send(const char * payload, size_t length, uint32_t flags, void * context){
+	if(send_result < 0)
+		return send_result;
+
+	snprintf(last_sent, sizeof(last_sent), "%.*s", (int)length, payload);
+	last_length = length;
+	last_flags = flags;
+	sent_count++;
+
+	/* Acknowledged before the sender has recorded the id */
+	if(ack_queue != NULL)
+		publish_queue_on_published(ack_queue, sent_count);
+
+	return sent_count;
+}
+
+static int check_rules(void){
+	int failures = 0;
+
+	struct publish_queue_config config = {
+		.max_bytes = 10,
+		.max_in_flight = 1,
+		.overflow = ePUBLISH_QUEUE_DROP_OLDEST,
+		.send = record_send,
+	};
+
+	/* Replacing and ordering while disconnected */
+	struct publish_queue * queue = publish_queue_create(&config);
+	publish_queue_add(queue, PUBLISH_QUEUE_EVENT, "e1");
+	publish_queue_add(queue, 7, "s1");
+	publish_queue_add(queue, PUBLISH_QUEUE_EVENT, "e2");
+	publish_queue_add(queue, 7, "s2");
+
+	struct publish_queue_stats stats = publish_queue_get_stats(queue);
+	if(stats.queued != 3 || stats.queued_bytes != 6 || stats.replaced != 1 || sent_count != 0){
+		fprintf(stderr, "FAIL: replace, %zu queued\n", stats.queued);
+		failures++;
+	}
+
+	/* Full: the oldest is dropped */
+	publish_queue_add(queue, PUBLISH_QUEUE_EVENT, "e3e3e3");
+	stats = publish_queue_get_stats(queue);
+	if(stats.queued != 3 || stats.dropped != 1){
+		fprintf(stderr, "FAIL: drop oldest, %zu queued %u dropped\n", stats.queued, stats.dropped);
+		failures++;
+	}
+
+	if(publish_queue_add(queue, PUBLISH_QUEUE_EVENT, "12345678901") != ESP_ERR_INVALID_SIZE){
+		fprintf(stderr, "FAIL: too large\n");
+		failures++;
+	}
+
+	/* One in flight at a time, in order, the replacing state after the event queued before it */
+	publish_queue_set_connected(queue, true);
+	if(sent_count != 1 || strcmp(last_sent, "e2") != 0){
+		fprintf(stderr, "FAIL: first sent '%s'\n", last_sent);
+		failures++;
+	}
+
+	publish_queue_on_published(queue, 99);
+	if(sent_count != 1){
+		fprintf(stderr, "FAIL: unknown acknowledgement\n");
+		failures++;
+	}
+
+	publish_queue_on_published(queue, 1);
+	if(sent_count != 2 || strcmp(last_sent, "s2") != 0){
+		fprintf(stderr, "FAIL: second sent '%s'\n", last_sent);
+		failures++;
+	}
+
+	/* A failed send is kept first in the queue */
+	send_result = -1;
+	publish_queue_on_published(queue, 2);
+	publish_queue_add(queue, PUBLISH_QUEUE_EVENT, "e4");
+	stats = publish_queue_get_stats(queue);
+	if(stats.queued != 2 || stats.in_flight != 0){
+		fprintf(stderr, "FAIL: failed send, %zu queued %zu in flight\n", stats.queued, stats.in_flight);
+		failures++;
+	}
+
+	send_result = 0;
+	publish_queue_flush(queue);
+	if(sent_count != 3 || strcmp(last_sent, "e3e3e3") != 0){
+		fprintf(stderr, "FAIL: resend after failure\n");
+		failures++;
+	}
+
+	/* Reconnect forgets messages given to the client before */
+	publish_queue_set_connected(queue, false);
+	publish_queue_add(queue, PUBLISH_QUEUE_EVENT, "e5");
+	publish_queue_set_connected(queue, true);
+	if(sent_count != 4){
+		fprintf(stderr, "FAIL: reconnect\n");
+		failures++;
+	}
+
+	/* Rejecting new messages */
+	struct publish_queue_config reject_config = config;
+	reject_config.overflow = ePUBLISH_QUEUE_REJECT_NEW;
+	struct publish_queue * reject = publish_queue_create(&reject_config);
+	publish_queue_add(reject, PUBLISH_QUEUE_EVENT, "12345678");
+	if(publish_queue_add(reject, PUBLISH_QUEUE_EVENT, "123") != ESP_ERR_NO_MEM || publish_queue_get_stats(reject).queued != 1){
+		fprintf(stderr, "FAIL: reject new\n");
+		failures++;
+	}
+
+	/* Acknowledgement received before the id is recorded */
+	struct publish_queue_config early_config = config;
+	early_config.max_bytes = 1000;
+	struct publish_queue * early = publish_queue_create(&early_config);
+	ack_queue = early;
+	publish_queue_set_connected(early, true);
+	int before = sent_count;
+	for(int i = 0; i < 5; i++)
+		publish_queue_add(early, PUBLISH_QUEUE_EVENT, "early");
+	ack_queue = NULL;
+
+	stats = publish_queue_get_stats(early);
+	if(sent_count - before != 5 || stats.in_flight != 0 || stats.queued != 0){
+		fprintf(stderr, "FAIL: early acknowledgement, %d sent %zu in flight\n", sent_count - before, stats.in_flight);
+		failures++;
+	}
+
+	/* Messages with null bytes keep their length, and the flags are given to send */
+	ack_queue = early;
+	publish_queue_add_message(early, PUBLISH_QUEUE_EVENT, "\x08\x00\x12", 3, 1);
+	if(last_length != 3 || last_flags != 1){
+		fprintf(stderr, "FAIL: binary message, %zu bytes flags %u\n", last_length, last_flags);
+		failures++;
+	}
+
+	publish_queue_add(early, PUBLISH_QUEUE_EVENT, "text");
+	if(last_length != 4 || last_flags != 0){
+		fprintf(stderr, "FAIL: text message flags %u\n", last_flags);
+		failures++;
+	}
+	ack_queue = NULL;
+
+	return failures;
+}
+
+int main(int argc, char ** argv){
+	uint32_t bytes_per_second = 400;
+
+	int opt;
+	while((opt = getopt(argc, argv, "b:")) != -1){
+		switch(opt){
+		case 'b':
+			bytes_per_second = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-b link bytes per second]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	esp_log_level_set("*", ESP_LOG_ERROR);
+
+	int failures = check_rules();
+
+	const uint32_t duration = 600, disconnect = 200, reconnect = 320;
+
+	struct result direct = simulate(false, bytes_per_second, duration, disconnect, reconnect);
+	struct result queued = simulate(true, bytes_per_second, duration, disconnect, reconnect);
+
+	printf("%u s at %u B/s, disconnected %u-%u s\n", duration, bytes_per_second, disconnect, reconnect);
+	printf("%-8s %8s %10s %10s %10s\n", "", "messages", "bytes", "peak bytes", "drain ms");
+	printf("%-8s %8u %10zu %10zu %10u\n", "direct", direct.transmitted, direct.transmitted_bytes, direct.peak_bytes, direct.drain_ms);
+	printf("%-8s %8u %10zu %10zu %10u\n", "queue", queued.transmitted, queued.transmitted_bytes, queued.peak_bytes, queued.drain_ms);
+	printf("queue: %u replaced, %u dropped\n", queued.stats.replaced, queued.stats.dropped);
+
+	if(queued.last_power != (int)duration - 1 || queued.last_all != (int)duration - 10){
+		fprintf(stderr, "FAIL: last state received power %d all %d\n", queued.last_power, queued.last_all);
+		failures++;
+	}
+
+	if(!queued.events_in_order || queued.last_event != direct.last_event){
+		fprintf(stderr, "FAIL: events, last %d of %d\n", queued.last_event, direct.last_event);
+		failures++;
+	}
+
+	if(queued.peak_bytes > 16384 + 2 * 1200 || queued.transmitted_bytes >= direct.transmitted_bytes){
+		fprintf(stderr, "FAIL: queue does not reduce memory or data\n");
+		failures++;
+	}
+
+	if(failures != 0){
+		printf("%d failures\n", failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,476 @@
+/*
+ * Compares the bytes published in a day with JSON and with the binary telemetry format, and checks that every binary
+ * message decodes to the JSON collection it replaces.
+ *
+ * The day is synthetic. It follows what the firmware publishes with the default settings: telemetry_all every 12 hours
+ * when idle and every hour while charging (TransmitInterval 3600), power and energy on change while charging, the power
+ * state now and then, settings at boot and a few operating mode changes. One 11 kW session of 8 hours is charged.
+ * Single observations are JSON objects of their own, and collections of one in the binary format. The completed session
+ * is published blocking, which is always JSON, and is counted the same in both.
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "cJSON.h"
+#include "pb_encode.h"
+
+#include "observation_batch.h"
+#include "telemetry_binary.h"
+#include "telemetry-message.pb.h"
+#include "telemetry_json.h"
+
+/* Bytes of topic and MQTT header per message, as estimated for mqttTxBytesIncMeta in zaptec_cloud_observations.c */
+#define MESSAGE_OVERHEAD 112
+
+#define MAX_OBSERVATIONS 32
+#define DAY_START 1710201600LL /* 2024-03-12T00:00:00Z */
+#define SECOND 1000000LL
+
+enum category{
+	eCATEGORY_ON_CHANGE,
+	eCATEGORY_POWER_STATE,
+	eCATEGORY_TELEMETRY_ALL,
+	eCATEGORY_SETTINGS_EVENTS,
+	eCATEGORY_BLOCKING,
+	eCATEGORY_COUNT,
+};
+
+static const char * category_names[eCATEGORY_COUNT] = {"on change", "power", "all", "settings", "blocking"};
+
+struct totals{
+	size_t messages;
+	size_t observations;
+	size_t json_bytes;
+	size_t binary_bytes;
+};
+
+static struct totals totals[eCATEGORY_COUNT];
+static int failures;
+
+struct observation{
+	int id;
+	char value[512];
+	int64_t time;
+};
+
+static struct observation pending[MAX_OBSERVATIONS];
+static size_t pending_count;
+
+static unsigned int seed = 1;
+
+static double uniform(void){
+	return rand_r(&seed) / (RAND_MAX + 1.0);
+}
+
+static void add(int id, int64_t time, const char * format, ...) __attribute__((format(printf, 3, 4)));
+
+static void add(int id, int64_t time, const char * format, ...){
+	struct observation * observation = &pending[pending_count++];
+	observation->id = id;
+	observation->time = time;
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(observation->value, sizeof(observation->value), format, args);
+	va_end(args);
+}
+
+static char * encode_json_collection(void){
+	char shared[OBSERVATION_BATCH_TIMESTAMP_SIZE];
+	telemetry_binary_format_time(pending[0].time, shared);
+
+	struct observation_batch * batch = observation_batch_create(1024, shared);
+
+	for(size_t i = 0; i < pending_count; i++){
+		char observed_at[OBSERVATION_BATCH_TIMESTAMP_SIZE];
+		telemetry_binary_format_time(pending[i].time, observed_at);
+		observation_batch_add(batch, pending[i].id, pending[i].value, observed_at);
+	}
+
+	char * json = strdup(observation_batch_finish(batch, NULL));
+	observation_batch_free(batch);
+
+	return json;
+}
+
+/* As create_observation in zaptec_cloud_observations.c */
+static char * encode_json_single(void){
+	char observed_at[OBSERVATION_BATCH_TIMESTAMP_SIZE];
+	telemetry_binary_format_time(pending[0].time, observed_at);
+
+	cJSON * result = cJSON_CreateObject();
+	cJSON_AddStringToObject(result, "ObservedAt", observed_at);
+	cJSON_AddStringToObject(result, "Value", pending[0].value);
+	cJSON_AddNumberToObject(result, "ObservationId", (float) pending[0].id);
+	cJSON_AddNumberToObject(result, "Type", (float) 1.0);
+
+	char * json = cJSON_PrintUnformatted(result);
+	cJSON_Delete(result);
+
+	return json;
+}
+
+/* Publishes the pending observations as one message */
+static void publish(enum category category, bool single){
+	char * collection = encode_json_collection();
+	char * json = single ? encode_json_single() : strdup(collection);
+
+	size_t binary_length = strlen(json);
+
+	if(category != eCATEGORY_BLOCKING){
+		char shared[OBSERVATION_BATCH_TIMESTAMP_SIZE];
+		telemetry_binary_format_time(pending[0].time, shared);
+
+		struct observation_batch * batch = observation_batch_create_binary(16, shared);
+		for(size_t i = 0; i < pending_count; i++){
+			char observed_at[OBSERVATION_BATCH_TIMESTAMP_SIZE];
+			telemetry_binary_format_time(pending[i].time, observed_at);
+			observation_batch_add(batch, pending[i].id, pending[i].value, pending[i].time == pending[0].time ? NULL : observed_at);
+		}
+
+		const uint8_t * binary = (const uint8_t *)observation_batch_finish(batch, &binary_length);
+		char * decoded = binary != NULL ? telemetry_json_from_binary(binary, binary_length, NULL) : NULL;
+
+		if(decoded == NULL || strcmp(decoded, collection) != 0){
+			fprintf(stderr, "FAIL: decoded message differs\nJSON:    %s\ndecoded: %s\n", collection,
+				decoded != NULL ? decoded : "(null)");
+			failures++;
+		}
+
+		free(decoded);
+		observation_batch_free(batch);
+	}
+
+	totals[category].messages++;
+	totals[category].observations += pending_count;
+	totals[category].json_bytes += strlen(json);
+	totals[category].binary_bytes += binary_length;
+
+	free(json);
+	free(collection);
+	pending_count = 0;
+}
+
+static int64_t jitter(int64_t time){
+	return time + (int64_t)(uniform() * SECOND);
+}
+
+static void publish_telemetry_all(int64_t time, bool charging, double power, double energy){
+	time = jitter(time);
+	double temperature = 18.0 + uniform() * 4.0 + (charging ? 14.0 : 0.0);
+
+	add(201, time, "%.3f", temperature);
+	add(270, time, "%.3f", 38.0 + uniform() * 10.0);
+	add(513, time, "%.3f", power);
+
+	if(charging){
+		add(202, time, "%.3f", temperature + 4.0);
+		add(204, time, "%.3f", temperature + 3.5);
+		add(205, time, "%.3f", temperature + 3.8);
+		add(206, time, "%.3f", temperature + 8.0);
+		add(207, time, "%.3f", temperature + 6.5);
+	}
+
+	add(809, time, "%.3f", -(double)(60 + rand_r(&seed) % 30));
+
+	time_t seconds = time / SECOND;
+	struct tm timeinfo;
+	gmtime_r(&seconds, &timeinfo);
+	char time_on[64];
+	strftime(time_on, sizeof(time_on), "%Y-%m-%d %H:%M:%S", &timeinfo);
+
+	add(808, time, "%s T_EM: %3.2f %3.2f %3.2f  T_M: %3.2f %3.2f   V: %3.2f %3.2f %3.2f   I: %2.2f %2.2f %2.2f  %.3fkW "
+		"%.3fkWh C%d CM%d MCnt:%d Rs:0 Rc:0", time_on, temperature + 4.0, temperature + 3.5, temperature + 3.8,
+		temperature + 8.0, temperature + 6.5, 231.2, 230.8, 232.1, power / 693.0, power / 693.0, power / 693.0,
+		power / 1000.0, energy, charging ? 3 : 1, charging ? 3 : 1, 12345);
+
+	publish(eCATEGORY_TELEMETRY_ALL, false);
+}
+
+static void publish_power_state(int64_t time, double power, double energy){
+	time = jitter(time);
+	double current = power / 693.0;
+
+	add(507, time, "%.3f", current + uniform() * 0.05);
+	add(508, time, "%.3f", current - uniform() * 0.05);
+	add(509, time, "%.3f", current + uniform() * 0.03);
+	add(501, time, "%.3f", 229.0 + uniform() * 4.0);
+	add(502, time, "%.3f", 229.0 + uniform() * 4.0);
+	add(503, time, "%.3f", 229.0 + uniform() * 4.0);
+	add(513, time, "%.3f", power);
+	add(553, time, "%.3f", energy);
+
+	publish(eCATEGORY_POWER_STATE, false);
+}
+
+static void publish_single(enum category category, int id, int64_t time, const char * value){
+	add(id, jitter(time), "%s", value);
+	publish(category, true);
+}
+
+static void publish_boot(int64_t time){
+	time = jitter(time);
+
+	add(100, time, "%s", "{\"SchemaVersion\":\"1.2\",\"DeviceType\":4,\"MeterCalibrated\":true,\"OcppVersions\":[1],"
+		"\"CommunicationModes\":[2,1],\"BinaryTelemetry\":true}");
+	add(911, time, "%s", "2.3.1.0");
+	publish(eCATEGORY_SETTINGS_EVENTS, false);
+
+	add(808, time, "%s", "1970-01-01 00:00:12 Boot: ESP: v2.3.1.0, MCU: v2.3.0.2  Switch: 4/MaxInst: 32.0A Sta: 10.0A  "
+		"ChargeState: 1  MCnt: 0  BRTC: 0x0 0x0 Partition: ota_1");
+	add(811, time, "%s", "1");
+	add(815, time, "%s", "3");
+	add(711, time, "%s", "1");
+	publish(eCATEGORY_SETTINGS_EVENTS, false);
+
+	add(120, time, "%s", "1");
+	add(121, time, "%s", "3");
+	add(510, time, "%s", "32.000");
+	add(511, time, "%s", "6.000");
+	add(520, time, "%s", "3");
+	add(522, time, "%s", "4");
+	add(523, time, "%s", "10.000");
+	add(711, time, "%s", "1");
+	add(800, time, "%s", "a200c784-e914-491d-99ad-4e0fb5da229b");
+	add(801, time, "%s", "default");
+	add(802, time, "%s", "Garage");
+	add(805, time, "%s", "0");
+	add(712, time, "%s", "0");
+	add(860, time, "%s", "1");
+	add(861, time, "%s", "");
+	add(862, time, "%s", "");
+	add(863, time, "%s", "0");
+	add(864, time, "%s", "0");
+	publish(eCATEGORY_SETTINGS_EVENTS, false);
+
+	add(150, time, "%s", "LTE");
+	add(712, time, "%s", "0");
+	add(547, time, "%s", "10.000");
+	add(523, time, "%s", "10.000");
+	add(151, time, "%s", "0");
+	add(153, time, "%s", "0.500");
+	publish(eCATEGORY_SETTINGS_EVENTS, false);
+
+	add(960, time, "%s", "242011234567890");
+	add(962, time, "%s", "89470000000000000000");
+	add(963, time, "%s", "351234567890123");
+	publish(eCATEGORY_SETTINGS_EVENTS, false);
+}
+
+static void simulate_day(void){
+	const int64_t day = DAY_START * SECOND;
+	const int64_t session_start = day + (15 * 3600 + 40 * 60) * SECOND;
+	const int64_t session_end = session_start + 8 * 3600 * SECOND;
+
+	publish_boot(day + 4 * SECOND);
+	publish_power_state(day + 5 * SECOND, 0.0, 0.0);
+	publish_telemetry_all(day + 6 * SECOND, false, 0.0, 0.0);
+
+	/* Idle until the car connects */
+	publish_telemetry_all(day + 12 * 3600 * SECOND, false, 0.0, 0.0);
+
+	publish_single(eCATEGORY_SETTINGS_EVENTS, 710, session_start - 35 * SECOND, "2");
+	publish_single(eCATEGORY_SETTINGS_EVENTS, 722, session_start - 30 * SECOND, "nfc-0A1B2C3D");
+	publish_single(eCATEGORY_SETTINGS_EVENTS, 710, session_start, "3");
+
+	double power = 0.0;
+	double energy = 0.0;
+	double sent_power = 0.0;
+	double sent_energy = 0.0;
+	int64_t next_all = session_start + 3600 * SECOND;
+	int64_t next_power_state = session_start + 10 * SECOND;
+
+	for(int64_t time = session_start; time < session_end; time += 10 * SECOND){
+		/* Ramps up, then varies with the load balancing of the installation */
+		double target = 11040.0 - ((time / (600 * SECOND)) % 5 == 0 ? 3500.0 : 0.0);
+		power += (target - power) * 0.5 + (uniform() - 0.5) * 120.0;
+		energy += power * 10.0 / 3600.0 / 1000.0;
+
+		char value[32];
+		if(power - sent_power > 500.0 || sent_power - power > 500.0){
+			sprintf(value, "%.3f", power);
+			publish_single(eCATEGORY_ON_CHANGE, 513, time, value);
+			sent_power = power;
+		}
+
+		if(energy - sent_energy >= 0.1){
+			sprintf(value, "%.3f", energy);
+			publish_single(eCATEGORY_ON_CHANGE, 553, time, value);
+			sent_energy = energy;
+		}
+
+		if(time >= next_power_state){
+			publish_power_state(time, power, energy);
+			next_power_state += 900 * SECOND;
+		}
+
+		if(time >= next_all){
+			publish_telemetry_all(time, true, power, energy);
+			next_all += 3600 * SECOND;
+		}
+	}
+
+	publish_single(eCATEGORY_ON_CHANGE, 513, session_end, "0.000");
+	publish_single(eCATEGORY_SETTINGS_EVENTS, 710, session_end + 2 * SECOND, "5");
+	publish_power_state(session_end + 3 * SECOND, 0.0, energy);
+
+	char completed[512];
+	snprintf(completed, sizeof(completed), "{\"SessionId\":\"4f6fd1e4-70d2-4b5a-a6b7-3c2d6b1b0e3e\",\"Energy\":%.6f,"
+		"\"StartDateTime\":\"2024-03-12T15:40:00.123456Z\",\"EndDateTime\":\"2024-03-12T23:40:02.654321Z\","
+		"\"ReliableClock\":true,\"StoppedByRFID\":false,\"AuthenticationCode\":\"0A1B2C3D\",\"SignedSession\":"
+		"\"OCMF|{\\\"FV\\\":\\\"1.0\\\",\\\"GI\\\":\\\"ZAPTEC GO\\\",\\\"GS\\\":\\\"ZAP000001\\\",\\\"GV\\\":"
+		"\\\"2.3.1.0\\\",\\\"PG\\\":\\\"T1\\\",\\\"RD\\\":[{\\\"TM\\\":\\\"2024-03-12T15:40:00,000+00:00 R\\\","
+		"\\\"TX\\\":\\\"B\\\",\\\"RV\\\":0.0,\\\"RI\\\":\\\"1-0:1.8.0\\\",\\\"RU\\\":\\\"kWh\\\",\\\"ST\\\":\\\"G\\\"}]}\"}",
+		energy);
+	add(723, session_end + 4 * SECOND, "%s", completed);
+	publish(eCATEGORY_BLOCKING, false);
+
+	publish_single(eCATEGORY_SETTINGS_EVENTS, 710, session_end + 60 * SECOND, "1");
+	publish_telemetry_all(session_end + 600 * SECOND, false, 0.0, energy);
+}
+
+static void expect_kind(const char * value, enum telemetry_binary_kind expected, int64_t expected_number){
+	int64_t number = 0;
+	enum telemetry_binary_kind kind = telemetry_binary_value_kind(value, &number);
+
+	if(kind != expected || (kind != eTELEMETRY_BINARY_TEXT && number != expected_number)){
+		fprintf(stderr, "FAIL: '%s' is kind %d with %" PRId64 "\n", value, kind, number);
+		failures++;
+	}
+}
+
+static void check_encoding(void){
+	expect_kind("0", eTELEMETRY_BINARY_INTEGER, 0);
+	expect_kind("-5", eTELEMETRY_BINARY_INTEGER, -5);
+	expect_kind("4294967295", eTELEMETRY_BINARY_INTEGER, 4294967295LL);
+	expect_kind("12.345", eTELEMETRY_BINARY_MILLI, 12345);
+	expect_kind("0.000", eTELEMETRY_BINARY_MILLI, 0);
+	expect_kind("-0.500", eTELEMETRY_BINARY_MILLI, -500);
+	expect_kind("-67.000", eTELEMETRY_BINARY_MILLI, -67000);
+	expect_kind("123456789012345.999", eTELEMETRY_BINARY_MILLI, 123456789012345999LL);
+
+	const char * texts[] = {"", "-", "007", "-0", "-0.000", "1.5", "12.3456", "1e3", " 1", "1 ", "+1", "1.",
+		".500", "1234567890123456", "1234567890123456.000", "LTE", "0x10"};
+	for(size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++)
+		expect_kind(texts[i], eTELEMETRY_BINARY_TEXT, 0);
+
+	/* Timestamps from 1900 to 2200 against gmtime */
+	for(int i = 0; i < 100000; i++){
+		int64_t time = (int64_t)((uniform() * 9467280000.0 - 2208988800.0) * SECOND) + rand_r(&seed) % SECOND;
+
+		char formatted[TELEMETRY_BINARY_TIMESTAMP_SIZE];
+		telemetry_binary_format_time(time, formatted);
+
+		time_t seconds = (time - ((time % SECOND) + SECOND) % SECOND) / SECOND;
+		struct tm timeinfo;
+		gmtime_r(&seconds, &timeinfo);
+		char expected[64];
+		strftime(expected, sizeof(expected), "%Y-%m-%dT%H:%M:%S", &timeinfo);
+		sprintf(expected + strlen(expected), ".%06dZ", (int)(((time % SECOND) + SECOND) % SECOND));
+
+		int64_t parsed = 0;
+		if(strcmp(formatted, expected) != 0 || telemetry_binary_parse_time(formatted, &parsed) != ESP_OK || parsed != time){
+			fprintf(stderr, "FAIL: time %" PRId64 " formatted '%s' expected '%s'\n", time, formatted, expected);
+			failures++;
+			break;
+		}
+	}
+
+	const char * invalid_times[] = {"2024-02-30T00:00:00.000000Z", "2024-03-12 00:00:00.000000Z",
+		"2024-03-12T24:00:00.000000Z", "2024-03-12T00:00:00.000000", "2024-03-12T00:00:00Z", "shared", ""};
+	for(size_t i = 0; i < sizeof(invalid_times) / sizeof(invalid_times[0]); i++){
+		int64_t parsed;
+		if(telemetry_binary_parse_time(invalid_times[i], &parsed) != ESP_ERR_INVALID_ARG){
+			fprintf(stderr, "FAIL: accepted time '%s'\n", invalid_times[i]);
+			failures++;
+		}
+	}
+
+	struct observation_batch * batch = observation_batch_create_binary(1, "2024-03-12T00:00:00.000000Z");
+	if(observation_batch_add(batch, 1, "1", "yesterday") != ESP_ERR_INVALID_ARG || observation_batch_add(batch, -1, "1", NULL)
+		!= ESP_ERR_INVALID_ARG || observation_batch_add(batch, 1, NULL, NULL) != ESP_OK || batch->count != 1){
+		fprintf(stderr, "FAIL: binary batch arguments\n");
+		failures++;
+	}
+
+	size_t length;
+	const char * message = observation_batch_finish(batch, &length);
+	char * decoded = message != NULL ? telemetry_json_from_binary((const uint8_t *)message, length, NULL) : NULL;
+	if(decoded == NULL || strstr(decoded, "\"Value\":\"\"") == NULL
+		|| observation_batch_add(batch, 1, "late", NULL) != ESP_ERR_INVALID_STATE){
+		fprintf(stderr, "FAIL: empty value\n");
+		failures++;
+	}
+	free(decoded);
+	observation_batch_free(batch);
+
+	/* An integer observation without a number */
+	uint32_t key = 513 << 2 | eTELEMETRY_BINARY_INTEGER;
+	TelemetryBatch invalid = TelemetryBatch_init_zero;
+	invalid.Keys_count = 1;
+	invalid.Keys = &key;
+
+	uint8_t buffer[32];
+	pb_ostream_t stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
+	pb_encode(&stream, TelemetryBatch_fields, &invalid);
+
+	fprintf(stderr, "Expecting an error: ");
+	decoded = telemetry_json_from_binary(buffer, stream.bytes_written, NULL);
+	if(decoded != NULL){
+		fprintf(stderr, "FAIL: decoded observation without value\n");
+		failures++;
+	}
+	free(decoded);
+}
+
+int main(int argc, char ** argv){
+	int opt;
+	while((opt = getopt(argc, argv, "s:")) != -1){
+		switch(opt){
+		case 's':
+			seed = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-s random seed]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	check_encoding();
+	simulate_day();
+
+	struct totals sum = {0};
+
+	printf("%-10s %8s %8s %10s %10s %8s\n", "", "messages", "obs", "JSON B", "binary B", "saved");
+	for(int i = 0; i < eCATEGORY_COUNT; i++){
+		printf("%-10s %8zu %8zu %10zu %10zu %7.1f%%\n", category_names[i], totals[i].messages, totals[i].observations,
+			totals[i].json_bytes, totals[i].binary_bytes,
+			100.0 * (1.0 - (double)totals[i].binary_bytes / totals[i].json_bytes));
+
+		sum.messages += totals[i].messages;
+		sum.observations += totals[i].observations;
+		sum.json_bytes += totals[i].json_bytes;
+		sum.binary_bytes += totals[i].binary_bytes;
+	}
+
+	printf("%-10s %8zu %8zu %10zu %10zu %7.1f%%\n", "payload", sum.messages, sum.observations, sum.json_bytes,
+		sum.binary_bytes, 100.0 * (1.0 - (double)sum.binary_bytes / sum.json_bytes));
+
+	size_t overhead = sum.messages * MESSAGE_OVERHEAD;
+	printf("%-10s %8s %8s %10zu %10zu %7.1f%%\n", "with MQTT", "", "", sum.json_bytes + overhead,
+		sum.binary_bytes + overhead,
+		100.0 * (1.0 - (double)(sum.binary_bytes + overhead) / (sum.json_bytes + overhead)));
+
+	if(failures != 0){
+		printf("%d failures\n", failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
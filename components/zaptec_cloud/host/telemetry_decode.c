@@ -0,0 +1,64 @@
+/*
+ * Prints a message in the binary telemetry format as the JSON observation collection it replaces.
+ *
+ *   telemetry_decode message.bin
+ *   telemetry_decode < message.bin
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "telemetry_json.h"
+
+int main(int argc, char ** argv){
+	if(argc > 2){
+		fprintf(stderr, "Usage: %s [message file]\n", argv[0]);
+		return 1;
+	}
+
+	FILE * input = stdin;
+	if(argc == 2){
+		input = fopen(argv[1], "rb");
+		if(input == NULL){
+			perror(argv[1]);
+			return 1;
+		}
+	}
+
+	size_t size = 4096;
+	size_t length = 0;
+	uint8_t * data = malloc(size);
+
+	size_t read;
+	while(data != NULL && (read = fread(data + length, 1, size - length, input)) > 0){
+		length += read;
+
+		if(length == size){
+			size *= 2;
+			uint8_t * grown = realloc(data, size);
+			if(grown == NULL)
+				free(data);
+
+			data = grown;
+		}
+	}
+
+	if(input != stdin)
+		fclose(input);
+
+	if(data == NULL){
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	char * json = telemetry_json_from_binary(data, length, NULL);
+	free(data);
+
+	if(json == NULL)
+		return 1;
+
+	printf("%s\n", json);
+	free(json);
+
+	return 0;
+}
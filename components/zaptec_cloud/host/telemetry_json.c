@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pb_decode.h"
+
+#include "observation_batch.h"
+#include "telemetry_binary.h"
+#include "telemetry-message.pb.h"
+#include "telemetry_json.h"
+
+static char * write_json(const TelemetryBatch * message, size_t * length_out){
+	if(message->TimeDeltas_count != 0 && message->TimeDeltas_count != message->Keys_count){
+		fprintf(stderr, "%u time deltas for %u observations\n", message->TimeDeltas_count, message->Keys_count);
+		return NULL;
+	}
+
+	char shared[TELEMETRY_BINARY_TIMESTAMP_SIZE];
+	telemetry_binary_format_time(message->ObservedAt, shared);
+
+	struct observation_batch * batch = observation_batch_create(1024, shared);
+	if(batch == NULL)
+		return NULL;
+
+	int64_t time = message->ObservedAt;
+	size_t next_number = 0;
+	size_t next_text = 0;
+	bool valid = true;
+
+	for(size_t i = 0; i < message->Keys_count && valid; i++){
+		int observation_id = message->Keys[i] >> 2;
+		enum telemetry_binary_kind kind = message->Keys[i] & 3;
+
+		if(message->TimeDeltas_count != 0)
+			time += message->TimeDeltas[i];
+
+		char observed_at[TELEMETRY_BINARY_TIMESTAMP_SIZE];
+		telemetry_binary_format_time(time, observed_at);
+
+		char number[TELEMETRY_BINARY_NUMBER_SIZE];
+		const char * value = NULL;
+
+		if(kind == eTELEMETRY_BINARY_TEXT){
+			if(next_text < message->Texts_count){
+				value = message->Texts[next_text++];
+				if(value == NULL)
+					value = "";
+			}
+
+		}else if(kind == eTELEMETRY_BINARY_INTEGER || kind == eTELEMETRY_BINARY_MILLI){
+			if(next_number < message->Numbers_count){
+				telemetry_binary_format_number(kind, message->Numbers[next_number++], number);
+				value = number;
+			}
+		}
+
+		if(value == NULL){
+			fprintf(stderr, "No value for observation %zu with key %u\n", i, message->Keys[i]);
+			valid = false;
+			break;
+		}
+
+		observation_batch_add(batch, observation_id, value, observed_at);
+	}
+
+	if(valid && (next_number != message->Numbers_count || next_text != message->Texts_count)){
+		fprintf(stderr, "Values not used by any observation\n");
+		valid = false;
+	}
+
+	size_t length = 0;
+	const char * json = observation_batch_finish(batch, &length);
+	char * result = (valid && json != NULL) ? strdup(json) : NULL;
+
+	observation_batch_free(batch);
+
+	if(result != NULL && length_out != NULL)
+		*length_out = length;
+
+	return result;
+}
+
+char * telemetry_json_from_binary(const uint8_t * data, size_t length, size_t * length_out){
+	TelemetryBatch message = TelemetryBatch_init_zero;
+
+	pb_istream_t stream = pb_istream_from_buffer(data, length);
+	if(!pb_decode(&stream, TelemetryBatch_fields, &message)){
+		fprintf(stderr, "Invalid message: %s\n", PB_GET_ERROR(&stream));
+		pb_release(TelemetryBatch_fields, &message);
+		return NULL;
+	}
+
+	char * json = write_json(&message, length_out);
+	pb_release(TelemetryBatch_fields, &message);
+
+	return json;
+}
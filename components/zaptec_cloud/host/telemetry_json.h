@@ -0,0 +1,22 @@
+#ifndef TELEMETRY_JSON_H
+#define TELEMETRY_JSON_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** @file
+ * @brief Decoder from the binary telemetry format to the JSON observation collection, as the cloud would decode it.
+ */
+
+/**
+ * @brief decodes a TelemetryBatch message
+ *
+ * @param data the encoded message
+ * @param length bytes in data
+ * @param length_out set to the length of the JSON if not NULL
+ *
+ * @return null terminated JSON to be freed by the caller, or NULL if the message is invalid
+ */
+char * telemetry_json_from_binary(const uint8_t * data, size_t length, size_t * length_out);
+
+#endif /*TELEMETRY_JSON_H*/
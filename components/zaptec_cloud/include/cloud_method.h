@@ -0,0 +1,118 @@
+#ifndef CLOUD_METHOD_H
+#define CLOUD_METHOD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+/** @file
+ * @brief Parsing and dispatch of IoT Hub direct methods.
+ *
+ * @details Direct methods are received on "$iothub/methods/POST/{method}/?$rid={request id}" and are answered on
+ * "$iothub/methods/res/{status}/?$rid={request id}". The cloud uses numeric method names. The topic is parsed once into
+ * a cloud_method_call, and the handler is found by method number in a table sorted by method.
+ */
+
+#define CLOUD_METHOD_TOPIC_PREFIX "$iothub/methods/POST/"
+
+/**
+ * @brief Longest request id accepted. IoT Hub uses short decimal request ids.
+ */
+#define CLOUD_METHOD_RID_MAX_LENGTH 32
+
+/**
+ * @brief Size of a buffer that can hold any response topic including null terminator
+ */
+#define CLOUD_METHOD_RESPONSE_TOPIC_SIZE (sizeof("$iothub/methods/res/-2147483648/?$rid=") + CLOUD_METHOD_RID_MAX_LENGTH)
+
+/**
+ * @brief Size of the response body buffer given to handlers
+ */
+#define CLOUD_METHOD_RESPONSE_SIZE 500
+
+/**
+ * @brief Handler may block, e.g. waiting for the MCU, and should not run on the MQTT task
+ *
+ * @note The response to a deferred method is sent when its handler finishes, which may be after the responses to
+ * methods received later and run on the MQTT task. Handlers that write settings must not be deferred, as settings are
+ * also written by the MQTT task when cloud settings are received.
+ */
+#define CLOUD_METHOD_DEFERRED (1 << 0)
+
+/**
+ * @brief A received direct method
+ */
+struct cloud_method_call{
+	int method; ///< Method number from the topic
+	char rid[CLOUD_METHOD_RID_MAX_LENGTH + 1]; ///< Request id to use in the response topic
+	const char * data; ///< Payload, not null terminated
+	int data_len; ///< Length of data
+};
+
+/**
+ * @brief Handles a direct method
+ *
+ * @param call the received method
+ * @param response buffer for an optional response body. Left empty if no body should be sent.
+ * @param response_size size of response
+ *
+ * @return the status to respond with, 200 for success
+ */
+typedef int (*cloud_method_function)(const struct cloud_method_call * call, char * response, size_t response_size);
+
+/**
+ * @brief Entry of the method table
+ */
+struct cloud_method_handler{
+	int method; ///< Method number handled
+	cloud_method_function function; ///< Handler
+	uint8_t flags; ///< CLOUD_METHOD_ flags
+	int max_data_len; ///< Longest payload accepted. Longer payloads are answered with status 400 without calling the handler
+};
+
+/**
+ * @brief parses a direct method topic
+ *
+ * @param topic the received topic, need not be null terminated
+ * @param topic_len length of topic
+ * @param call_out method and request id. data and data_len are not set.
+ *
+ * @return ESP_OK on success,
+ * ESP_ERR_INVALID_ARG if topic is not a direct method topic,
+ * ESP_ERR_NOT_SUPPORTED if the method name is not a number,
+ * ESP_ERR_NOT_FOUND if the request id is missing,
+ * ESP_ERR_INVALID_SIZE if the request id is too long
+ */
+esp_err_t cloud_method_parse_topic(const char * topic, int topic_len, struct cloud_method_call * call_out);
+
+/**
+ * @brief checks that a method table is sorted by method without duplicates as required by cloud_method_find
+ */
+bool cloud_method_table_is_valid(const struct cloud_method_handler * table, size_t table_length);
+
+/**
+ * @brief finds the handler of a method
+ *
+ * @param table method table sorted by method
+ * @param table_length number of entries in table
+ * @param method method to find
+ *
+ * @return the entry for the method or NULL if not found
+ */
+const struct cloud_method_handler * cloud_method_find(const struct cloud_method_handler * table, size_t table_length, int method);
+
+/**
+ * @brief writes the topic used to respond to a call
+ *
+ * @param call the call to respond to
+ * @param status status of the response
+ * @param topic_out buffer for the topic, should be at least CLOUD_METHOD_RESPONSE_TOPIC_SIZE
+ * @param topic_size size of topic_out
+ *
+ * @return ESP_OK on success or ESP_ERR_INVALID_SIZE if topic_out is too small
+ */
+esp_err_t cloud_method_response_topic(const struct cloud_method_call * call, int status, char * topic_out, size_t topic_size);
+
+#endif /*CLOUD_METHOD_H*/
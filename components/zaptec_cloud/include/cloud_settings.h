@@ -0,0 +1,68 @@
+#ifndef CLOUD_SETTINGS_H
+#define CLOUD_SETTINGS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cJSON.h"
+
+/** @file
+ * @brief Lookup of cloud settings by id.
+ *
+ * @details Cloud settings are received as an object with the setting id as key, e.g. {"510":"32","711":"1"}. The
+ * object is iterated once and each known id is found in a table sorted by id, instead of searching the object for each
+ * known id.
+ */
+
+/**
+ * @brief Setting is applied before the other settings, e.g. because other settings depend on the session controller
+ */
+#define CLOUD_SETTING_FIRST (1 << 0)
+
+/**
+ * @brief State shared by the setting handlers, defined by the user of the table
+ */
+struct cloud_settings_context;
+
+/**
+ * @brief Entry of the settings table
+ */
+struct cloud_setting{
+	int id; ///< Setting id
+	/**
+	 * @brief Validates and applies the value. NULL if the value is used by the handler of another setting.
+	 *
+	 * @return true if the configuration was changed and should be saved
+	 */
+	bool (*apply)(const cJSON * value, struct cloud_settings_context * context);
+	uint8_t flags; ///< CLOUD_SETTING_ flags
+};
+
+/**
+ * @brief checks that a settings table is sorted by id without duplicates
+ */
+bool cloud_settings_table_is_valid(const struct cloud_setting * table, size_t table_length);
+
+/**
+ * @brief finds the index of a setting id in a table sorted by id
+ *
+ * @return the index or -1 if not found
+ */
+int cloud_settings_find(const struct cloud_setting * table, size_t table_length, int id);
+
+/**
+ * @brief finds the values of the known settings with a single iteration of the settings object
+ *
+ * @param settings the settings object
+ * @param table settings table sorted by id
+ * @param table_length number of entries in table
+ * @param values_out array of table_length values. Set to the value of the setting at the same index in table, or NULL
+ * if the setting is absent. If an id occurs more than once the first value is used.
+ *
+ * @return the number of known settings found
+ */
+size_t cloud_settings_collect(const cJSON * settings, const struct cloud_setting * table, size_t table_length,
+			const cJSON ** values_out);
+
+#endif /*CLOUD_SETTINGS_H*/
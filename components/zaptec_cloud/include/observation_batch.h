@@ -0,0 +1,94 @@
+#ifndef OBSERVATION_BATCH_H
+#define OBSERVATION_BATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+/** @file
+ * @brief Encoder for observation collections.
+ *
+ * @details Writes observations directly as JSON into a single buffer instead of building a cJSON tree and printing it.
+ * The ObservedAt timestamp is formatted once by the caller and shared by the observations in the batch. The result is
+ * the same document as the cJSON collection:
+ *
+ * {"Observations":[{"ObservedAt":"...","Value":"...","ObservationId":N,"Type":1},...],"Type":6}
+ *
+ * A batch created with observation_batch_create_binary encodes the observations in the binary telemetry format instead.
+ * See telemetry_binary.h.
+ */
+
+struct telemetry_binary;
+
+/**
+ * @brief Length of the buffer for the shared ObservedAt timestamp, including null terminator
+ */
+#define OBSERVATION_BATCH_TIMESTAMP_SIZE 32
+
+/**
+ * @brief Observations written so far
+ */
+struct observation_batch{
+	char * buffer; ///< JSON written so far. Null terminated after observation_batch_finish
+	size_t size; ///< Allocated size of buffer
+	size_t length; ///< Bytes written to buffer
+	size_t count; ///< Number of observations added
+	bool failed; ///< An allocation failed, the batch can not be published
+	bool finished; ///< observation_batch_finish has been called
+	char observed_at[OBSERVATION_BATCH_TIMESTAMP_SIZE]; ///< Timestamp used by observations without their own
+	struct telemetry_binary * binary; ///< Binary encoder used instead of buffer, or NULL for JSON
+};
+
+/**
+ * @brief creates an empty batch
+ *
+ * @param initial_size bytes to preallocate. The buffer grows if more is needed.
+ * @param observed_at timestamp shared by the observations in the batch
+ *
+ * @return the batch or NULL if out of memory
+ */
+struct observation_batch * observation_batch_create(size_t initial_size, const char * observed_at);
+
+/**
+ * @brief creates an empty batch encoded in the binary telemetry format
+ *
+ * @param initial_count observations to preallocate for
+ * @param observed_at timestamp shared by the observations in the batch
+ *
+ * @return the batch or NULL if out of memory
+ */
+struct observation_batch * observation_batch_create_binary(size_t initial_count, const char * observed_at);
+
+/**
+ * @brief appends an observation
+ *
+ * @param batch batch to append to. May be NULL, in which case the observation is dropped.
+ * @param observation_id id of the observation
+ * @param value string value. NULL is written as an empty string.
+ * @param observed_at timestamp to use instead of the shared timestamp or NULL
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the buffer could not grow, ESP_ERR_INVALID_STATE if finished or
+ * ESP_ERR_INVALID_ARG if batch is NULL or a binary batch is given a timestamp it can not encode
+ */
+esp_err_t observation_batch_add(struct observation_batch * batch, int observation_id, const char * value,
+				const char * observed_at);
+
+/**
+ * @brief closes the collection. No more observations can be added.
+ *
+ * @param batch the batch to finish
+ * @param length_out set to the length of the message if not NULL
+ *
+ * @return the message owned by the batch, or NULL if batch is NULL or an allocation failed. JSON is null terminated,
+ * the binary format is not.
+ */
+const char * observation_batch_finish(struct observation_batch * batch, size_t * length_out);
+
+/**
+ * @brief frees the batch and its buffer. batch may be NULL.
+ */
+void observation_batch_free(struct observation_batch * batch);
+
+#endif /*OBSERVATION_BATCH_H*/
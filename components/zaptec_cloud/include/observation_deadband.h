@@ -0,0 +1,70 @@
+#ifndef OBSERVATION_DEADBAND_H
+#define OBSERVATION_DEADBAND_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** @file
+ * @brief Change detection for observed values that are published when they change.
+ *
+ * @details Each observed value has a dead-band around the last published value. A value is published when it has been
+ * outside the band for the entry's delay, but not more often than its minimum interval. Smaller changes are
+ * published once the maximum interval has passed. The band is the largest of the absolute and relative (to the last
+ * published value) band, limited by the maximum band, and multiplied by a common scale.
+ */
+
+/**
+ * @brief Publish at once when the value becomes zero, ignoring delay and minimum interval
+ */
+#define OBSERVATION_DEADBAND_ZERO_IMMEDIATE (1 << 0)
+
+/**
+ * @brief An observed value with its dead-band and the state of the last publish
+ */
+struct observation_deadband{
+	int id; ///< Observation id
+	float absolute; ///< Smallest change to publish
+	float relative; ///< Change to publish as a fraction of the last published value
+	float maximum; ///< Largest change needed to publish. 0 for no limit
+	uint16_t delay; ///< Seconds the value must stay outside the band before it is published
+	uint16_t min_interval; ///< Minimum seconds between publishes
+	uint32_t max_interval; ///< Seconds after which any change is published. 0 to disable
+	uint8_t flags; ///< OBSERVATION_DEADBAND_ flags
+
+	bool sent; ///< A value has been published, otherwise the next value is published. Set to start from last_value
+	bool pending; ///< The value is outside the band and waiting for the delay
+	float last_value; ///< Last published value
+	uint32_t last_time; ///< Time of the last publish
+	uint32_t pending_time; ///< Time the value left the band
+};
+
+/**
+ * @brief gets the current dead-band of an entry
+ *
+ * @param entry the entry
+ * @param scale factor for the band, e.g. from the TransmitChangeLevel setting
+ */
+float observation_deadband_band(const struct observation_deadband * entry, float scale);
+
+/**
+ * @brief evaluates all entries once. Entries that should be published are updated as published.
+ *
+ * @param table entries to evaluate
+ * @param table_length number of entries
+ * @param values current value for each entry
+ * @param scale factor for the bands, e.g. from the TransmitChangeLevel setting
+ * @param now current time in seconds
+ * @param publish_out set for each entry to true if the value should be published
+ *
+ * @return number of entries to publish
+ */
+size_t observation_deadband_update(struct observation_deadband * table, size_t table_length, const float * values,
+				float scale, uint32_t now, bool * publish_out);
+
+/**
+ * @brief clears the state so all entries are published at the next update
+ */
+void observation_deadband_reset(struct observation_deadband * table, size_t table_length);
+
+#endif /*OBSERVATION_DEADBAND_H*/
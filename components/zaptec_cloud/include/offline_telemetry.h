@@ -0,0 +1,142 @@
+#ifndef OFFLINE_TELEMETRY_H
+#define OFFLINE_TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+/** @file
+ * @brief Flash backed ring of observations recorded while the cloud is unreachable.
+ *
+ * @details Records are collected in a block of OFFLINE_TELEMETRY_BLOCK_SIZE bytes that is written to the file when it is
+ * full, or when the sync interval has passed since the first record that is not on file. Each block has a sequence
+ * number and checksum, and each record its own check, so the valid records can be found after a write is interrupted
+ * by power loss. When the ring is full the oldest block is overwritten.
+ *
+ * Stored records are drained in batches, at most one batch per batch interval. A batch given to send with a message id
+ * is only drained when that message is acknowledged, and is given again if it is not acknowledged within the ack
+ * timeout. The position of the drained records is written to one of two slots in turn, so an interrupted write resends
+ * at most one batch.
+ */
+
+/**
+ * @brief Bytes written to the file at a time
+ */
+#define OFFLINE_TELEMETRY_BLOCK_SIZE 512
+
+/**
+ * @brief Type of the value in a record
+ */
+enum offline_telemetry_type{
+	eOFFLINE_TELEMETRY_DOUBLE = 1,
+	eOFFLINE_TELEMETRY_UINT32,
+	eOFFLINE_TELEMETRY_INT32,
+};
+
+/**
+ * @brief A timestamped observation
+ */
+struct offline_telemetry_record{
+	uint32_t time; ///< Seconds since epoch when the value was observed
+	uint16_t id; ///< Observation id
+	enum offline_telemetry_type type;
+	union{
+		double d;
+		uint32_t u;
+		int32_t i;
+	}value;
+};
+
+/**
+ * @brief Gives drained records to the cloud
+ *
+ * @return 0 if the records were accepted, a positive message id if they are drained when the message is acknowledged
+ * with offline_telemetry_acknowledge, or negative if they should be given again at the next drain
+ */
+typedef int (*offline_telemetry_send_function)(const struct offline_telemetry_record * records, size_t count, void * context);
+
+/**
+ * @brief Configuration given to offline_telemetry_open
+ */
+struct offline_telemetry_config{
+	const char * path; ///< File used for the ring. Created if it does not exist
+	size_t block_count; ///< Blocks in the ring, at least 2
+	uint32_t sync_interval; ///< Milliseconds a record may wait in memory before the block is written
+	size_t batch_records; ///< Largest number of records given to send at a time
+	uint32_t batch_interval; ///< Minimum milliseconds between batches
+	uint32_t ack_timeout; ///< Milliseconds to wait for the acknowledgement of a batch before it is given again
+};
+
+/**
+ * @brief Counters for diagnostics
+ */
+struct offline_telemetry_stats{
+	size_t stored; ///< Records not yet drained
+	uint32_t blocks_written; ///< Blocks written to the file, including rewrites of a partial block
+	uint32_t overwritten; ///< Records lost before they were drained because the ring was full
+	uint32_t corrupt; ///< Records lost to interrupted writes
+	uint32_t drained; ///< Records accepted by send or acknowledged
+};
+
+struct offline_telemetry;
+
+/**
+ * @brief opens the ring and recovers the stored records
+ *
+ * @return the ring or NULL if the file can not be used or out of memory
+ */
+struct offline_telemetry * offline_telemetry_open(const struct offline_telemetry_config * config);
+
+/**
+ * @brief writes records kept in memory and closes the ring. store may be NULL.
+ */
+void offline_telemetry_close(struct offline_telemetry * store);
+
+/**
+ * @brief stores a record. The block is written if it is full or the sync interval has passed.
+ *
+ * @param store the ring
+ * @param record the record to store
+ * @param now current time in milliseconds, used for the sync interval
+ *
+ * @return ESP_OK if stored, ESP_ERR_INVALID_ARG for an invalid record, ESP_FAIL if the block could not be written. The
+ * record is kept in memory on ESP_FAIL.
+ */
+esp_err_t offline_telemetry_add(struct offline_telemetry * store, const struct offline_telemetry_record * record, uint32_t now);
+
+/**
+ * @brief writes the records kept in memory
+ */
+esp_err_t offline_telemetry_sync(struct offline_telemetry * store);
+
+/**
+ * @brief gives the oldest stored records to send if the batch interval has passed since the previous batch
+ *
+ * @param store the ring
+ * @param now current time in milliseconds
+ * @param send function given the batch
+ * @param context given to send
+ *
+ * @return number of records given to send, 0 if there is nothing to drain, the batch interval has not passed or a batch
+ * is waiting for acknowledgement, negative if send failed
+ */
+int offline_telemetry_drain(struct offline_telemetry * store, uint32_t now, offline_telemetry_send_function send,
+			void * context);
+
+/**
+ * @brief drains the batch waiting for the acknowledgement of message_id, or gives it again at the next drain if it was
+ * not published. A batch waits from when send returns, so acknowledgements received before drain returns must be kept
+ * until then.
+ *
+ * @return true if a batch was waiting for message_id
+ */
+bool offline_telemetry_acknowledge(struct offline_telemetry * store, int message_id, bool published);
+
+/**
+ * @brief gets the diagnostics counters
+ */
+struct offline_telemetry_stats offline_telemetry_get_stats(struct offline_telemetry * store);
+
+#endif /*OFFLINE_TELEMETRY_H*/
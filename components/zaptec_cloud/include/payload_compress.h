@@ -0,0 +1,133 @@
+#ifndef PAYLOAD_COMPRESS_H
+#define PAYLOAD_COMPRESS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+/** @file
+ * @brief Streaming LZSS compression of large payloads in the heatshrink format.
+ *
+ * @details The compressed stream is a sequence of bits, most significant bit first. A 1 bit is followed by a literal
+ * byte. A 0 bit is followed by window_bits bits with the distance back minus one and lookahead_bits bits with the
+ * number of bytes to copy minus one. The last byte is padded with 0 bits. This is the format of heatshrink with the
+ * same window and lookahead sizes, so the cloud can use an existing decoder.
+ *
+ * The compressor only keeps a buffer of twice the window and a hash chain for it, see payload_compressor_size, so the
+ * state for the default window of 1 KiB fits in internal RAM. Data is given in pieces of any size and the compressed
+ * stream is given to a write function PAYLOAD_COMPRESS_OUTPUT_SIZE bytes at a time.
+ */
+
+/**
+ * @brief Smallest and largest window_bits
+ */
+#define PAYLOAD_COMPRESS_MIN_WINDOW_BITS 8
+#define PAYLOAD_COMPRESS_MAX_WINDOW_BITS 12
+
+/**
+ * @brief Bytes given to the write function at a time, except for the last write
+ */
+#define PAYLOAD_COMPRESS_OUTPUT_SIZE 64
+
+/**
+ * @brief Receives compressed or decompressed data
+ *
+ * @return ESP_OK to continue, anything else stops and is returned by the function that wrote
+ */
+typedef esp_err_t (*payload_compress_write_function)(const uint8_t * data, size_t length, void * context);
+
+/**
+ * @brief Configuration given to payload_compressor_create and payload_decompressor_create
+ */
+struct payload_compress_config{
+	uint8_t window_bits; ///< Log2 of the window, from PAYLOAD_COMPRESS_MIN_WINDOW_BITS to PAYLOAD_COMPRESS_MAX_WINDOW_BITS
+	uint8_t lookahead_bits; ///< Log2 of the longest copy, from 3 to window_bits - 1
+	payload_compress_write_function write; ///< Function given the output
+	void * context; ///< Given to write
+};
+
+struct payload_compressor;
+struct payload_decompressor;
+
+/**
+ * @brief gets the bytes allocated by payload_compressor_create for a window
+ */
+size_t payload_compressor_size(uint8_t window_bits);
+
+/**
+ * @brief creates a compressor
+ *
+ * @return the compressor, or NULL if the configuration is invalid or out of memory
+ */
+struct payload_compressor * payload_compressor_create(const struct payload_compress_config * config);
+
+/**
+ * @brief compresses data. Output is written when a full PAYLOAD_COMPRESS_OUTPUT_SIZE is ready.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if finished, or the error returned by write
+ */
+esp_err_t payload_compressor_write(struct payload_compressor * compressor, const void * data, size_t length);
+
+/**
+ * @brief compresses the remaining data and writes the rest of the output. No more data can be written.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if already finished, or the error returned by write
+ */
+esp_err_t payload_compressor_finish(struct payload_compressor * compressor);
+
+/**
+ * @brief gets the number of compressed bytes given to write so far
+ */
+size_t payload_compressor_written(const struct payload_compressor * compressor);
+
+/**
+ * @brief frees the compressor. compressor may be NULL.
+ */
+void payload_compressor_free(struct payload_compressor * compressor);
+
+/**
+ * @brief creates a decompressor
+ *
+ * @return the decompressor, or NULL if the configuration is invalid or out of memory
+ */
+struct payload_decompressor * payload_decompressor_create(const struct payload_compress_config * config);
+
+/**
+ * @brief decompresses data
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG if a copy refers to data before the start, or the error returned by write
+ */
+esp_err_t payload_decompressor_write(struct payload_decompressor * decompressor, const void * data, size_t length);
+
+/**
+ * @brief writes the rest of the output
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE if the stream ended inside an item, or the error returned by write
+ */
+esp_err_t payload_decompressor_finish(struct payload_decompressor * decompressor);
+
+/**
+ * @brief frees the decompressor. decompressor may be NULL.
+ */
+void payload_decompressor_free(struct payload_decompressor * decompressor);
+
+/**
+ * @brief compresses a payload into a buffer
+ *
+ * @param data the payload
+ * @param length bytes in the payload
+ * @param window_bits see payload_compress_config
+ * @param lookahead_bits see payload_compress_config
+ * @param output buffer for the compressed payload
+ * @param output_size bytes in output
+ * @param length_out set to the length of the compressed payload
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE if the compressed payload does not fit in output, ESP_ERR_NO_MEM if out of
+ * memory or ESP_ERR_INVALID_ARG for an invalid window or lookahead
+ */
+esp_err_t payload_compress(const void * data, size_t length, uint8_t window_bits, uint8_t lookahead_bits,
+			uint8_t * output, size_t output_size, size_t * length_out);
+
+#endif /*PAYLOAD_COMPRESS_H*/
@@ -0,0 +1,121 @@
+#ifndef PUBLISH_QUEUE_H
+#define PUBLISH_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+/** @file
+ * @brief Queue of messages waiting to be handed to the MQTT client.
+ *
+ * @details Only a limited number of QoS 1 messages are given to the MQTT client at a time. The rest wait in this queue,
+ * where a newer message with the same state key replaces the queued one, so a slow or disconnected link does not fill
+ * the MQTT outbox with values that are already outdated. Messages without a state key (events) are kept in order.
+ *
+ * The replacing message is moved to the end of the queue, so it is never sent before a message that was queued
+ * earlier and may contain an older value of the same observation.
+ */
+
+/**
+ * @brief State key of messages that are never replaced
+ */
+#define PUBLISH_QUEUE_EVENT 0
+
+/**
+ * @brief What to do when a new message does not fit in the queue
+ */
+enum publish_queue_overflow{
+	ePUBLISH_QUEUE_DROP_OLDEST, ///< Drop the oldest queued messages until the new message fits
+	ePUBLISH_QUEUE_REJECT_NEW, ///< Reject the new message
+};
+
+/**
+ * @brief Hands a message to the MQTT client
+ *
+ * @param payload the message, not null terminated if added with publish_queue_add_message
+ * @param length bytes in payload
+ * @param flags given with the message to publish_queue_add_message. Not interpreted by the queue.
+ * @param context from publish_queue_config
+ *
+ * @return message id on success or negative on failure
+ */
+typedef int (*publish_queue_send_function)(const char * payload, size_t length, uint32_t flags, void * context);
+
+/**
+ * @brief Configuration given to publish_queue_create
+ */
+struct publish_queue_config{
+	size_t max_bytes; ///< Largest total size of the queued payloads
+	size_t max_in_flight; ///< Messages given to the MQTT client and not yet acknowledged
+	enum publish_queue_overflow overflow; ///< Policy when max_bytes is reached
+	publish_queue_send_function send; ///< Function used to send a message
+	void * context; ///< Given to send
+};
+
+/**
+ * @brief Counters for diagnostics
+ */
+struct publish_queue_stats{
+	size_t queued; ///< Messages in the queue
+	size_t queued_bytes; ///< Bytes in the queue
+	size_t in_flight; ///< Messages waiting for acknowledgement
+	uint32_t sent; ///< Messages given to the MQTT client
+	uint32_t replaced; ///< Queued messages replaced by a newer state
+	uint32_t dropped; ///< Messages dropped or rejected because the queue was full
+};
+
+struct publish_queue;
+
+/**
+ * @brief creates a queue. The queue starts disconnected.
+ *
+ * @return the queue or NULL if out of memory
+ */
+struct publish_queue * publish_queue_create(const struct publish_queue_config * config);
+
+/**
+ * @brief queues a copy of a message and sends queued messages if possible
+ *
+ * @param queue the queue
+ * @param state_key key of the state in the message, or PUBLISH_QUEUE_EVENT. A queued message with the same key is
+ * replaced.
+ * @param payload null terminated message
+ *
+ * @return ESP_OK if queued, ESP_ERR_NO_MEM if out of memory or the queue is full, ESP_ERR_INVALID_SIZE if the message
+ * is larger than max_bytes
+ */
+esp_err_t publish_queue_add(struct publish_queue * queue, int state_key, const char * payload);
+
+/**
+ * @brief queues a copy of a message of the given length, which may contain null bytes. See publish_queue_add.
+ *
+ * @param flags given to send with the message
+ */
+esp_err_t publish_queue_add_message(struct publish_queue * queue, int state_key, const char * payload, size_t length,
+				uint32_t flags);
+
+/**
+ * @brief sends queued messages while fewer than max_in_flight are waiting for acknowledgement
+ */
+void publish_queue_flush(struct publish_queue * queue);
+
+/**
+ * @brief marks a message as acknowledged (MQTT_EVENT_PUBLISHED) or given up by the client (MQTT_EVENT_DELETED) and sends
+ * more messages
+ */
+void publish_queue_on_published(struct publish_queue * queue, int message_id);
+
+/**
+ * @brief sets if the MQTT client is connected. On connect, messages given to the client earlier are no longer counted
+ * as in flight, as they are resent by the client, and queued messages are sent.
+ */
+void publish_queue_set_connected(struct publish_queue * queue, bool connected);
+
+/**
+ * @brief gets the diagnostics counters
+ */
+struct publish_queue_stats publish_queue_get_stats(struct publish_queue * queue);
+
+#endif /*PUBLISH_QUEUE_H*/
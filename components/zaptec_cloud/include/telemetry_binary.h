@@ -0,0 +1,111 @@
+#ifndef TELEMETRY_BINARY_H
+#define TELEMETRY_BINARY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+/** @file
+ * @brief Encoder for observations in the binary telemetry format.
+ *
+ * @details Writes the same observations as observation_batch as a TelemetryBatch message (telemetry-message.proto).
+ * Observation ids and values are varints, the timestamps are microseconds from the previous observation and the
+ * repeated fields are packed. Values are only encoded as numbers if they are formatted exactly like the JSON value
+ * would be, so a decoder can restore the JSON observation collection byte for byte.
+ */
+
+/**
+ * @brief How a value is encoded, stored in the two lowest bits of the key
+ */
+enum telemetry_binary_kind{
+	eTELEMETRY_BINARY_INTEGER = 0, ///< Integer written with "%d"
+	eTELEMETRY_BINARY_MILLI = 1, ///< Decimal written with "%.3f", stored multiplied by 1000
+	eTELEMETRY_BINARY_TEXT = 2, ///< Any other string
+};
+
+/**
+ * @brief Length of the buffer for a formatted number value, including null terminator
+ */
+#define TELEMETRY_BINARY_NUMBER_SIZE 24
+
+/**
+ * @brief Length of the buffer for a formatted timestamp, including null terminator
+ */
+#define TELEMETRY_BINARY_TIMESTAMP_SIZE 32
+
+struct telemetry_binary;
+
+/**
+ * @brief creates an empty message
+ *
+ * @param initial_count observations to preallocate for. The arrays grow if more are added.
+ *
+ * @return the message or NULL if out of memory
+ */
+struct telemetry_binary * telemetry_binary_create(size_t initial_count);
+
+/**
+ * @brief appends an observation
+ *
+ * @param binary message to append to
+ * @param observation_id id of the observation
+ * @param value string value. NULL is encoded as an empty string.
+ * @param observed_at timestamp as "YYYY-MM-DDTHH:MM:SS.ffffffZ"
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if out of memory, ESP_ERR_INVALID_ARG if observed_at is not in the
+ * expected format or observation_id is negative, ESP_ERR_INVALID_STATE if finished
+ */
+esp_err_t telemetry_binary_add(struct telemetry_binary * binary, int observation_id, const char * value,
+			const char * observed_at);
+
+/**
+ * @brief encodes the message. No more observations can be added.
+ *
+ * @param binary the message to finish
+ * @param length_out set to the length of the encoded message
+ *
+ * @return the encoded message owned by binary, or NULL if out of memory or encoding failed
+ */
+const uint8_t * telemetry_binary_finish(struct telemetry_binary * binary, size_t * length_out);
+
+/**
+ * @brief frees the message. binary may be NULL.
+ */
+void telemetry_binary_free(struct telemetry_binary * binary);
+
+/**
+ * @brief gets how a value can be encoded
+ *
+ * @param value the string value
+ * @param number_out set to the number to store for eTELEMETRY_BINARY_INTEGER and eTELEMETRY_BINARY_MILLI
+ */
+enum telemetry_binary_kind telemetry_binary_value_kind(const char * value, int64_t * number_out);
+
+/**
+ * @brief writes a number value as the string it was encoded from
+ *
+ * @param buffer TELEMETRY_BINARY_NUMBER_SIZE bytes
+ */
+void telemetry_binary_format_number(enum telemetry_binary_kind kind, int64_t number, char * buffer);
+
+/**
+ * @brief parses an ObservedAt timestamp
+ *
+ * @param observed_at timestamp as "YYYY-MM-DDTHH:MM:SS.ffffffZ"
+ * @param time_out set to microseconds since epoch
+ *
+ * @return ESP_OK or ESP_ERR_INVALID_ARG if formatting the result would not give the same string
+ */
+esp_err_t telemetry_binary_parse_time(const char * observed_at, int64_t * time_out);
+
+/**
+ * @brief writes an ObservedAt timestamp
+ *
+ * @param time microseconds since epoch. Times outside the years 0000 to 9999 are written as the nearest time inside.
+ * @param buffer TELEMETRY_BINARY_TIMESTAMP_SIZE bytes
+ */
+void telemetry_binary_format_time(int64_t time, char * buffer);
+
+#endif /*TELEMETRY_BINARY_H*/
@@ -1,7 +1,11 @@
 #ifndef ZAPTEC_CLOUD_LISTENER_H
 #define ZAPTEC_CLOUD_LISTENER_H
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
 #include "../../main/DeviceInfo.h"
+#include "publish_queue.h"
 
 void MqttSetDisconnected();
 void MqttSetSimulatedOffline(bool simOffline);
@@ -41,7 +45,51 @@ bool IsOTADelayActive();
 void ClearOTADelay();
 
 int publish_iothub_event(const char *payload);
+/**
+ * @brief publishes an event that replaces a queued event with the same state key, if it has not been sent yet
+ *
+ * @param state_key observation id of a single observation, or other key above the observation ids
+ */
+int publish_iothub_state(int state_key, const char *payload);
+/**
+ * @brief publishes a state in the binary telemetry format, see publish_iothub_state
+ */
+int publish_iothub_binary_state(int state_key, const char *payload, size_t length);
+struct publish_queue_stats publish_iothub_queue_stats();
 int publish_iothub_event_blocked(const char* payload, TickType_t xTicksToWait);
+
+/**
+ * @brief acknowledgement given to the queues added with publish_iothub_add_ack_queue
+ */
+struct publish_ack{
+	int message_id; ///< id returned when the message was published
+	bool published; ///< false if the MQTT client deleted the message without acknowledgement
+};
+
+/**
+ * @brief adds a queue of struct publish_ack that receives the id of every message acknowledged or deleted by the MQTT
+ * client. Acks that do not fit in the queue are dropped. Adding a queue that is already added has no effect.
+ *
+ * @return 0 on success or negative if the largest number of queues are added
+ */
+int publish_iothub_add_ack_queue(QueueHandle_t queue);
+
+/**
+ * @brief stops giving acks to a queue added with publish_iothub_add_ack_queue
+ */
+void publish_iothub_remove_ack_queue(QueueHandle_t queue);
+
+/**
+ * @brief publishes an event without queueing it or waiting for acknowledgement. See publish_iothub_add_ack_queue.
+ *
+ * @return message id on success or negative on failure
+ */
+int publish_iothub_event_tracked(const char* payload);
+
+/**
+ * @brief publishes a binary event like publish_iothub_event_tracked
+ */
+int publish_iothub_binary_event_tracked(const char *payload, size_t length);
 int publish_to_iothub(const char* payload, const char* topic);
 
 void update_installationId();
@@ -16,6 +16,11 @@ struct MqttDataDiagnostics
 };
 
 void cloud_observations_disable(bool disable);
+/**
+ * @brief selects the binary telemetry format instead of JSON for observations that are not published blocking.
+ * Ignored if CONFIG_ZAPTEC_CLOUD_BINARY_TELEMETRY is not set.
+ */
+void cloud_observations_set_binary(bool binary);
 
 void MqttSetRxDiagnostics(uint32_t bytes, uint32_t metabytes);
 
@@ -86,6 +91,18 @@ void ReInitParametersForCloud();
 
 int publish_telemetry_observation_on_change();
 
+/**
+ * @brief stores changed measured values in the offline telemetry ring while the cloud is unreachable
+ */
+int record_telemetry_observation_offline();
+
+/**
+ * @brief publishes a batch of values stored while offline, if the batch interval has passed
+ *
+ * @return number of values published or negative on failure
+ */
+int publish_offline_telemetry();
+
 void SendStacks();
 
 void SetSendRTC();
@@ -101,6 +118,15 @@ int publish_uint32_observation(int observationId, uint32_t value);
 int publish_double_observation(int observationId, double value);
 int publish_string_observation(int observationId, char *message);
 int publish_string_observation_blocked(int observationId, char *message, int timeout_ms);
+
+/**
+ * @brief publishes string values of one observation as a single collection without waiting for acknowledgement. See
+ * publish_iothub_event_tracked.
+ *
+ * @return message id, 0 if observations are disabled and nothing was published, or negative on failure
+ */
+int publish_string_observations_tracked(int observationId, const char * const *messages, size_t count);
+
 int publish_diagnostics_observation(char *message);
 int publish_debug_message_event(char *message, cloud_event_level level);
 int publish_cloud_pulse(void);
@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "observation_batch.h"
+#include "telemetry_binary.h"
+
+#define BATCH_PREFIX "{\"Observations\":["
+#define BATCH_SUFFIX "],\"Type\":6}"
+
+static bool reserve(struct observation_batch * batch, size_t needed){
+	if(batch->failed)
+		return false;
+
+	/* One extra byte for the null terminator written by finish */
+	if(batch->length + needed + 1 <= batch->size)
+		return true;
+
+	size_t new_size = batch->size * 2;
+	if(new_size < batch->length + needed + 1)
+		new_size = batch->length + needed + 1;
+
+	char * new_buffer = realloc(batch->buffer, new_size);
+	if(new_buffer == NULL){
+		batch->failed = true;
+		return false;
+	}
+
+	batch->buffer = new_buffer;
+	batch->size = new_size;
+
+	return true;
+}
+
+static void append(struct observation_batch * batch, const char * data, size_t length){
+	if(!reserve(batch, length))
+		return;
+
+	memcpy(batch->buffer + batch->length, data, length);
+	batch->length += length;
+}
+
+/* Escapes the same characters as cJSON_PrintUnformatted so the output does not change */
+static size_t escaped_length(const char * value){
+	size_t length = 2;
+
+	for(const unsigned char * c = (const unsigned char *)value; *c != '\0'; c++){
+		switch(*c){
+		case '"':
+		case '\\':
+		case '\b':
+		case '\f':
+		case '\n':
+		case '\r':
+		case '\t':
+			length += 2;
+			break;
+		default:
+			length += (*c < 32) ? 6 : 1;
+		}
+	}
+
+	return length;
+}
+
+static void append_string(struct observation_batch * batch, const char * value){
+	if(value == NULL)
+		value = "";
+
+	if(!reserve(batch, escaped_length(value)))
+		return;
+
+	char * out = batch->buffer + batch->length;
+	*out++ = '"';
+
+	for(const unsigned char * c = (const unsigned char *)value; *c != '\0'; c++){
+		char escape = 0;
+
+		switch(*c){
+		case '"': escape = '"'; break;
+		case '\\': escape = '\\'; break;
+		case '\b': escape = 'b'; break;
+		case '\f': escape = 'f'; break;
+		case '\n': escape = 'n'; break;
+		case '\r': escape = 'r'; break;
+		case '\t': escape = 't'; break;
+		}
+
+		if(escape != 0){
+			*out++ = '\\';
+			*out++ = escape;
+
+		}else if(*c < 32){
+			sprintf(out, "\\u%04x", *c);
+			out += 6;
+
+		}else{
+			*out++ = *c;
+		}
+	}
+
+	*out++ = '"';
+	batch->length = out - batch->buffer;
+}
+
+struct observation_batch * observation_batch_create(size_t initial_size, const char * observed_at){
+	struct observation_batch * batch = calloc(1, sizeof(struct observation_batch));
+	if(batch == NULL)
+		return NULL;
+
+	if(initial_size < sizeof(BATCH_PREFIX BATCH_SUFFIX))
+		initial_size = sizeof(BATCH_PREFIX BATCH_SUFFIX);
+
+	batch->buffer = malloc(initial_size);
+	if(batch->buffer == NULL){
+		free(batch);
+		return NULL;
+	}
+
+	batch->size = initial_size;
+	strncpy(batch->observed_at, observed_at != NULL ? observed_at : "", sizeof(batch->observed_at) - 1);
+
+	append(batch, BATCH_PREFIX, strlen(BATCH_PREFIX));
+
+	return batch;
+}
+
+struct observation_batch * observation_batch_create_binary(size_t initial_count, const char * observed_at){
+	struct observation_batch * batch = calloc(1, sizeof(struct observation_batch));
+	if(batch == NULL)
+		return NULL;
+
+	batch->binary = telemetry_binary_create(initial_count);
+	if(batch->binary == NULL){
+		free(batch);
+		return NULL;
+	}
+
+	strncpy(batch->observed_at, observed_at != NULL ? observed_at : "", sizeof(batch->observed_at) - 1);
+
+	return batch;
+}
+
+esp_err_t observation_batch_add(struct observation_batch * batch, int observation_id, const char * value,
+				const char * observed_at){
+	if(batch == NULL)
+		return ESP_ERR_INVALID_ARG;
+
+	if(batch->finished)
+		return ESP_ERR_INVALID_STATE;
+
+	if(batch->binary != NULL){
+		esp_err_t err = telemetry_binary_add(batch->binary, observation_id, value,
+						observed_at != NULL ? observed_at : batch->observed_at);
+		if(err == ESP_OK)
+			batch->count++;
+
+		return err;
+	}
+
+	if(batch->count > 0)
+		append(batch, ",", 1);
+
+	append(batch, "{\"ObservedAt\":", strlen("{\"ObservedAt\":"));
+	append_string(batch, observed_at != NULL ? observed_at : batch->observed_at);
+
+	append(batch, ",\"Value\":", strlen(",\"Value\":"));
+	append_string(batch, value);
+
+	char tail[48];
+	int tail_length = snprintf(tail, sizeof(tail), ",\"ObservationId\":%d,\"Type\":1}", observation_id);
+	append(batch, tail, tail_length);
+
+	if(batch->failed)
+		return ESP_ERR_NO_MEM;
+
+	batch->count++;
+	return ESP_OK;
+}
+
+const char * observation_batch_finish(struct observation_batch * batch, size_t * length_out){
+	if(batch == NULL)
+		return NULL;
+
+	if(batch->binary != NULL){
+		batch->finished = true;
+		size_t length;
+		const uint8_t * encoded = telemetry_binary_finish(batch->binary, &length);
+
+		if(encoded != NULL && length_out != NULL)
+			*length_out = length;
+
+		return (const char *)encoded;
+	}
+
+	if(!batch->finished){
+		append(batch, BATCH_SUFFIX, strlen(BATCH_SUFFIX));
+		batch->finished = true;
+	}
+
+	if(batch->failed)
+		return NULL;
+
+	batch->buffer[batch->length] = '\0';
+
+	if(length_out != NULL)
+		*length_out = batch->length;
+
+	return batch->buffer;
+}
+
+void observation_batch_free(struct observation_batch * batch){
+	if(batch == NULL)
+		return;
+
+	telemetry_binary_free(batch->binary);
+	free(batch->buffer);
+	free(batch);
+}
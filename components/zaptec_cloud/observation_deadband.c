@@ -0,0 +1,65 @@
+#include <math.h>
+
+#include "observation_deadband.h"
+
+float observation_deadband_band(const struct observation_deadband * entry, float scale){
+	float band = entry->relative * fabsf(entry->last_value);
+
+	if(band < entry->absolute)
+		band = entry->absolute;
+
+	if(entry->maximum > 0.0f && band > entry->maximum)
+		band = entry->maximum;
+
+	return band * scale;
+}
+
+static bool should_publish(struct observation_deadband * entry, float value, float scale, uint32_t now){
+	if(!entry->sent)
+		return true;
+
+	if((entry->flags & OBSERVATION_DEADBAND_ZERO_IMMEDIATE) && value == 0.0f && entry->last_value != 0.0f)
+		return true;
+
+	uint32_t elapsed = now - entry->last_time;
+
+	if(fabsf(value - entry->last_value) <= observation_deadband_band(entry, scale)){
+		/* Back inside the band before the delay ended, the change was a spike */
+		entry->pending = false;
+
+		return entry->max_interval != 0 && elapsed >= entry->max_interval && value != entry->last_value;
+	}
+
+	if(!entry->pending){
+		entry->pending = true;
+		entry->pending_time = now;
+	}
+
+	return (now - entry->pending_time) >= entry->delay && elapsed >= entry->min_interval;
+}
+
+size_t observation_deadband_update(struct observation_deadband * table, size_t table_length, const float * values,
+				float scale, uint32_t now, bool * publish_out){
+	size_t count = 0;
+
+	for(size_t i = 0; i < table_length; i++){
+		publish_out[i] = should_publish(&table[i], values[i], scale, now);
+
+		if(publish_out[i]){
+			table[i].sent = true;
+			table[i].pending = false;
+			table[i].last_value = values[i];
+			table[i].last_time = now;
+			count++;
+		}
+	}
+
+	return count;
+}
+
+void observation_deadband_reset(struct observation_deadband * table, size_t table_length){
+	for(size_t i = 0; i < table_length; i++){
+		table[i].sent = false;
+		table[i].pending = false;
+	}
+}
@@ -0,0 +1,621 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_crc.h"
+#include "esp_log.h"
+
+#include "offline_telemetry.h"
+
+static const char *TAG = "OFFLINE TELEM  ";
+
+#define BLOCK_MAGIC 0x4d4c545a
+#define CURSOR_MAGIC 0x5255435a
+
+/*
+ * The first block of the file holds two cursor slots. The ring starts at the second block. Records are numbered
+ * sequence * RECORDS_PER_BLOCK + index, and the cursor is the number of the first record that is not drained.
+ */
+struct block_header{
+	uint32_t magic;
+	uint32_t sequence; ///< 0 is never used
+	uint16_t count;
+	uint16_t reserved;
+	uint32_t crc; ///< of the preceding fields
+};
+
+struct block_record{
+	uint32_t time;
+	uint16_t id;
+	uint8_t type;
+	uint8_t check; ///< low byte of the crc of the record with check set to 0
+	uint8_t value[8];
+};
+
+struct cursor_slot{
+	uint32_t magic;
+	uint32_t generation;
+	uint32_t cursor;
+	uint32_t crc; ///< of the preceding fields
+};
+
+_Static_assert(sizeof(struct block_header) == 16, "block header must not be padded");
+_Static_assert(sizeof(struct block_record) == 16, "block record must not be padded");
+
+#define RECORDS_PER_BLOCK ((OFFLINE_TELEMETRY_BLOCK_SIZE - sizeof(struct block_header)) / sizeof(struct block_record))
+
+struct offline_telemetry{
+	struct offline_telemetry_config config;
+	SemaphoreHandle_t lock;
+	FILE * fp;
+
+	uint8_t block[OFFLINE_TELEMETRY_BLOCK_SIZE]; ///< Block being filled, with head_count records
+	uint8_t read_block[OFFLINE_TELEMETRY_BLOCK_SIZE];
+	uint32_t head_sequence;
+	uint16_t head_count;
+	bool dirty; ///< The block has records that are not on file
+	uint32_t dirty_since;
+
+	uint32_t cursor;
+	uint32_t saved_cursor;
+	uint32_t cursor_generation;
+
+	struct offline_telemetry_record * batch;
+	bool draining; ///< The batch is being given to send without the lock
+	bool drained_once;
+	uint32_t last_drain;
+
+	int awaiting_message; ///< Message id of the batch waiting for acknowledgement, 0 if none
+	uint32_t awaiting_next; ///< Position after the batch waiting for acknowledgement
+	size_t awaiting_count;
+
+	struct offline_telemetry_stats stats;
+};
+
+static uint8_t record_check(const struct block_record * record){
+	struct block_record copy = *record;
+	copy.check = 0;
+
+	return esp_crc32_le(0, (const uint8_t *)&copy, sizeof(copy)) & 0xff;
+}
+
+static void encode_record(const struct offline_telemetry_record * record, struct block_record * out){
+	memset(out, 0, sizeof(struct block_record));
+
+	out->time = record->time;
+	out->id = record->id;
+	out->type = record->type;
+
+	if(record->type == eOFFLINE_TELEMETRY_DOUBLE){
+		memcpy(out->value, &record->value.d, sizeof(double));
+	}else{
+		memcpy(out->value, &record->value.u, sizeof(uint32_t));
+	}
+
+	out->check = record_check(out);
+}
+
+static bool decode_record(const struct block_record * record, struct offline_telemetry_record * out){
+	if(record->id == 0 || record->type < eOFFLINE_TELEMETRY_DOUBLE || record->type > eOFFLINE_TELEMETRY_INT32
+		|| record->check != record_check(record))
+		return false;
+
+	out->time = record->time;
+	out->id = record->id;
+	out->type = record->type;
+
+	if(record->type == eOFFLINE_TELEMETRY_DOUBLE){
+		memcpy(&out->value.d, record->value, sizeof(double));
+	}else{
+		memcpy(&out->value.u, record->value, sizeof(uint32_t));
+	}
+
+	return true;
+}
+
+static struct block_record * block_records(uint8_t * block){
+	return (struct block_record *)(block + sizeof(struct block_header));
+}
+
+static uint32_t header_crc(const struct block_header * header){
+	return esp_crc32_le(0, (const uint8_t *)header, offsetof(struct block_header, crc));
+}
+
+static bool header_valid(const struct block_header * header){
+	return header->magic == BLOCK_MAGIC && header->sequence != 0 && header->count <= RECORDS_PER_BLOCK
+		&& header->crc == header_crc(header);
+}
+
+/* Number of records before the first invalid one */
+static uint16_t valid_prefix(uint8_t * block, uint16_t count){
+	struct offline_telemetry_record decoded;
+
+	for(uint16_t i = 0; i < count; i++){
+		if(!decode_record(&block_records(block)[i], &decoded))
+			return i;
+	}
+
+	return count;
+}
+
+static long block_offset(const struct offline_telemetry * store, uint32_t sequence){
+	return OFFLINE_TELEMETRY_BLOCK_SIZE * (1 + (long)((sequence - 1) % store->config.block_count));
+}
+
+static uint32_t oldest_sequence(const struct offline_telemetry * store){
+	if(store->head_sequence > store->config.block_count)
+		return store->head_sequence - store->config.block_count + 1;
+
+	return 1;
+}
+
+static uint32_t end_position(const struct offline_telemetry * store){
+	return store->head_sequence * RECORDS_PER_BLOCK + store->head_count;
+}
+
+static esp_err_t write_at(struct offline_telemetry * store, long offset, const void * data, size_t length){
+	if(fseek(store->fp, offset, SEEK_SET) != 0 || fwrite(data, 1, length, store->fp) != length
+		|| fflush(store->fp) != 0 || fsync(fileno(store->fp)) != 0){
+
+		ESP_LOGE(TAG, "Unable to write %zu bytes at %ld: %s", length, offset, strerror(errno));
+		clearerr(store->fp);
+		return ESP_FAIL;
+	}
+
+	return ESP_OK;
+}
+
+/* Must hold the lock */
+static esp_err_t write_head_block(struct offline_telemetry * store){
+	struct block_header header = {
+		.magic = BLOCK_MAGIC,
+		.sequence = store->head_sequence,
+		.count = store->head_count,
+	};
+	header.crc = header_crc(&header);
+
+	memcpy(store->block, &header, sizeof(header));
+
+	esp_err_t err = write_at(store, block_offset(store, store->head_sequence), store->block, OFFLINE_TELEMETRY_BLOCK_SIZE);
+	if(err == ESP_OK){
+		store->dirty = false;
+		store->stats.blocks_written++;
+	}
+
+	return err;
+}
+
+/* Must hold the lock */
+static void start_next_block(struct offline_telemetry * store){
+	store->head_sequence++;
+	store->head_count = 0;
+	memset(store->block, 0, sizeof(store->block));
+
+	/* The block taking the place of the oldest block is overwritten when it is written */
+	uint32_t oldest = oldest_sequence(store) * RECORDS_PER_BLOCK;
+	if(store->cursor < oldest){
+		store->stats.overwritten += oldest - store->cursor;
+		store->cursor = oldest;
+	}
+}
+
+/* Must hold the lock */
+static esp_err_t save_cursor(struct offline_telemetry * store){
+	if(store->cursor == store->saved_cursor)
+		return ESP_OK;
+
+	struct cursor_slot slot = {
+		.magic = CURSOR_MAGIC,
+		.generation = store->cursor_generation + 1,
+		.cursor = store->cursor,
+	};
+	slot.crc = esp_crc32_le(0, (const uint8_t *)&slot, offsetof(struct cursor_slot, crc));
+
+	esp_err_t err = write_at(store, (slot.generation % 2) * sizeof(slot), &slot, sizeof(slot));
+	if(err == ESP_OK){
+		store->cursor_generation = slot.generation;
+		store->saved_cursor = slot.cursor;
+	}
+
+	return err;
+}
+
+/* Reads a block before the head block to read_block. Must hold the lock */
+static bool load_block(struct offline_telemetry * store, uint32_t sequence, uint16_t * count_out){
+	if(fseek(store->fp, block_offset(store, sequence), SEEK_SET) != 0
+		|| fread(store->read_block, 1, OFFLINE_TELEMETRY_BLOCK_SIZE, store->fp) != OFFLINE_TELEMETRY_BLOCK_SIZE){
+
+		clearerr(store->fp);
+		return false;
+	}
+
+	struct block_header header;
+	memcpy(&header, store->read_block, sizeof(header));
+
+	if(!header_valid(&header) || header.sequence != sequence)
+		return false;
+
+	*count_out = header.count;
+	return true;
+}
+
+/*
+ * Reads up to max records from position and sets position to the record after the last one read. Blocks lost to
+ * interrupted writes are skipped. Must hold the lock.
+ */
+static size_t read_records(struct offline_telemetry * store, uint32_t * position, struct offline_telemetry_record * records,
+			size_t max){
+	uint32_t current = *position;
+	uint32_t end = end_position(store);
+
+	uint32_t loaded_sequence = 0;
+	uint16_t loaded_count = 0;
+	size_t count = 0;
+
+	while(count < max && current < end){
+		uint32_t sequence = current / RECORDS_PER_BLOCK;
+		uint16_t index = current % RECORDS_PER_BLOCK;
+
+		if(sequence == store->head_sequence){
+			decode_record(&block_records(store->block)[index], &records[count++]);
+			current++;
+			continue;
+		}
+
+		if(loaded_sequence != sequence){
+			if(!load_block(store, sequence, &loaded_count)){
+				ESP_LOGW(TAG, "Block %" PRIu32 " is lost", sequence);
+				store->stats.corrupt += RECORDS_PER_BLOCK - index;
+				current = (sequence + 1) * RECORDS_PER_BLOCK;
+				continue;
+			}
+
+			loaded_sequence = sequence;
+		}
+
+		if(index >= loaded_count || !decode_record(&block_records(store->read_block)[index], &records[count])){
+			if(index < loaded_count)
+				store->stats.corrupt += loaded_count - index;
+
+			current = (sequence + 1) * RECORDS_PER_BLOCK;
+			continue;
+		}
+
+		count++;
+		current++;
+	}
+
+	*position = current;
+	return count;
+}
+
+/* Finds the newest block and the saved cursor */
+static esp_err_t recover(struct offline_telemetry * store){
+	uint32_t newest = 0;
+
+	for(size_t i = 0; i < store->config.block_count; i++){
+		struct block_header header;
+
+		if(fseek(store->fp, OFFLINE_TELEMETRY_BLOCK_SIZE * (long)(i + 1), SEEK_SET) != 0
+			|| fread(&header, 1, sizeof(header), store->fp) != sizeof(header)){
+
+			ESP_LOGE(TAG, "Unable to read block %zu", i);
+			return ESP_FAIL;
+		}
+
+		if(header_valid(&header) && (header.sequence - 1) % store->config.block_count == i && header.sequence > newest)
+			newest = header.sequence;
+	}
+
+	store->head_sequence = 1;
+	store->head_count = 0;
+
+	uint16_t count;
+	if(newest != 0 && load_block(store, newest, &count)){
+		uint16_t valid = valid_prefix(store->read_block, count);
+		if(valid < count){
+			ESP_LOGW(TAG, "Block %" PRIu32 " was interrupted after %d of %d records", newest, valid, count);
+			store->stats.corrupt += count - valid;
+		}
+
+		memset(store->block, 0, sizeof(store->block));
+
+		if(valid == RECORDS_PER_BLOCK){
+			store->head_sequence = newest + 1;
+		}else{
+			store->head_sequence = newest;
+			store->head_count = valid;
+			memcpy(store->block, store->read_block, sizeof(struct block_header) + valid * sizeof(struct block_record));
+		}
+	}
+
+	struct cursor_slot slots[2];
+	if(fseek(store->fp, 0, SEEK_SET) != 0 || fread(slots, 1, sizeof(slots), store->fp) != sizeof(slots)){
+		ESP_LOGE(TAG, "Unable to read cursor");
+		return ESP_FAIL;
+	}
+
+	store->cursor = 0;
+	store->cursor_generation = 0;
+
+	for(size_t i = 0; i < 2; i++){
+		if(slots[i].magic == CURSOR_MAGIC
+			&& slots[i].crc == esp_crc32_le(0, (const uint8_t *)&slots[i], offsetof(struct cursor_slot, crc))
+			&& slots[i].generation >= store->cursor_generation){
+
+			store->cursor = slots[i].cursor;
+			store->cursor_generation = slots[i].generation;
+		}
+	}
+
+	store->saved_cursor = store->cursor;
+
+	uint32_t oldest = oldest_sequence(store) * RECORDS_PER_BLOCK;
+	if(store->cursor < oldest)
+		store->cursor = oldest;
+
+	/* Drained records may have been lost with an interrupted write */
+	if(store->cursor > end_position(store))
+		store->cursor = end_position(store);
+
+	return ESP_OK;
+}
+
+/* Extends the file to the size of the ring, so blocks can be written in any order */
+static esp_err_t allocate_file(struct offline_telemetry * store){
+	long size = OFFLINE_TELEMETRY_BLOCK_SIZE * (long)(store->config.block_count + 1);
+
+	if(fseek(store->fp, 0, SEEK_END) != 0)
+		return ESP_FAIL;
+
+	long current = ftell(store->fp);
+	if(current < 0)
+		return ESP_FAIL;
+
+	memset(store->read_block, 0, sizeof(store->read_block));
+
+	while(current < size){
+		size_t length = OFFLINE_TELEMETRY_BLOCK_SIZE - (current % OFFLINE_TELEMETRY_BLOCK_SIZE);
+
+		if(write_at(store, current, store->read_block, length) != ESP_OK)
+			return ESP_FAIL;
+
+		current += length;
+	}
+
+	return ESP_OK;
+}
+
+struct offline_telemetry * offline_telemetry_open(const struct offline_telemetry_config * config){
+	if(config == NULL || config->path == NULL || config->block_count < 2 || config->batch_records == 0)
+		return NULL;
+
+	struct offline_telemetry * store = calloc(1, sizeof(struct offline_telemetry));
+	if(store == NULL)
+		return NULL;
+
+	store->config = *config;
+	store->batch = calloc(config->batch_records, sizeof(struct offline_telemetry_record));
+	store->lock = xSemaphoreCreateMutex();
+
+	if(store->batch == NULL || store->lock == NULL){
+		ESP_LOGE(TAG, "Unable to allocate offline telemetry");
+		goto error;
+	}
+
+	struct stat st;
+	if(stat(config->path, &st) != 0){
+		// Doesn't exist, w+ will create
+		store->fp = fopen(config->path, "w+b");
+	}else{
+		// Does exist, r+ will allow updating
+		store->fp = fopen(config->path, "r+b");
+	}
+
+	if(store->fp == NULL){
+		ESP_LOGE(TAG, "Unable to open '%s': %s", config->path, strerror(errno));
+		goto error;
+	}
+
+	if(allocate_file(store) != ESP_OK || recover(store) != ESP_OK){
+		ESP_LOGE(TAG, "Unable to prepare '%s'", config->path);
+		goto error;
+	}
+
+	ESP_LOGI(TAG, "Opened with %" PRIu32 " records to drain", end_position(store) - store->cursor);
+
+	return store;
+
+error:
+	if(store->fp != NULL)
+		fclose(store->fp);
+
+	if(store->lock != NULL)
+		vSemaphoreDelete(store->lock);
+
+	free(store->batch);
+	free(store);
+
+	return NULL;
+}
+
+void offline_telemetry_close(struct offline_telemetry * store){
+	if(store == NULL)
+		return;
+
+	xSemaphoreTake(store->lock, portMAX_DELAY);
+
+	if(store->dirty)
+		write_head_block(store);
+
+	save_cursor(store);
+
+	if(fclose(store->fp) != 0)
+		ESP_LOGE(TAG, "Unable to close: %s", strerror(errno));
+
+	xSemaphoreGive(store->lock);
+
+	vSemaphoreDelete(store->lock);
+	free(store->batch);
+	free(store);
+}
+
+esp_err_t offline_telemetry_add(struct offline_telemetry * store, const struct offline_telemetry_record * record, uint32_t now){
+	if(record->id == 0 || record->type < eOFFLINE_TELEMETRY_DOUBLE || record->type > eOFFLINE_TELEMETRY_INT32)
+		return ESP_ERR_INVALID_ARG;
+
+	esp_err_t err = ESP_OK;
+
+	xSemaphoreTake(store->lock, portMAX_DELAY);
+
+	/* A full block that could not be written earlier */
+	if(store->head_count == RECORDS_PER_BLOCK){
+		err = write_head_block(store);
+		if(err != ESP_OK)
+			goto out;
+
+		start_next_block(store);
+	}
+
+	encode_record(record, &block_records(store->block)[store->head_count]);
+	store->head_count++;
+
+	if(!store->dirty){
+		store->dirty = true;
+		store->dirty_since = now;
+	}
+
+	if(store->head_count == RECORDS_PER_BLOCK){
+		err = write_head_block(store);
+		if(err == ESP_OK)
+			start_next_block(store);
+
+	}else if(now - store->dirty_since >= store->config.sync_interval){
+		err = write_head_block(store);
+	}
+
+out:
+	xSemaphoreGive(store->lock);
+
+	return err;
+}
+
+esp_err_t offline_telemetry_sync(struct offline_telemetry * store){
+	esp_err_t err = ESP_OK;
+
+	xSemaphoreTake(store->lock, portMAX_DELAY);
+
+	if(store->dirty)
+		err = write_head_block(store);
+
+	xSemaphoreGive(store->lock);
+
+	return err;
+}
+
+/* Must hold the lock */
+static void commit_drained(struct offline_telemetry * store, uint32_t next, size_t count){
+	/* The ring may have overwritten past the drained records while sending */
+	if(next > store->cursor)
+		store->cursor = next;
+
+	store->stats.drained += count;
+	save_cursor(store);
+}
+
+int offline_telemetry_drain(struct offline_telemetry * store, uint32_t now, offline_telemetry_send_function send,
+			void * context){
+
+	xSemaphoreTake(store->lock, portMAX_DELAY);
+
+	if(store->draining || (store->drained_once && now - store->last_drain < store->config.batch_interval)){
+		xSemaphoreGive(store->lock);
+		return 0;
+	}
+
+	if(store->awaiting_message != 0){
+		if(now - store->last_drain < store->config.ack_timeout){
+			xSemaphoreGive(store->lock);
+			return 0;
+		}
+
+		ESP_LOGW(TAG, "No acknowledgement for message %d, giving the batch again", store->awaiting_message);
+		store->awaiting_message = 0;
+	}
+
+	uint32_t next = store->cursor;
+	size_t count = read_records(store, &next, store->batch, store->config.batch_records);
+
+	if(count == 0){
+		/* Only lost records were found */
+		if(next > store->cursor){
+			store->cursor = next;
+			save_cursor(store);
+		}
+
+		xSemaphoreGive(store->lock);
+		return 0;
+	}
+
+	store->draining = true;
+	xSemaphoreGive(store->lock);
+
+	int result = send(store->batch, count, context);
+
+	xSemaphoreTake(store->lock, portMAX_DELAY);
+
+	store->draining = false;
+	store->drained_once = true;
+	store->last_drain = now;
+
+	if(result == 0){
+		commit_drained(store, next, count);
+
+	}else if(result > 0){
+		store->awaiting_message = result;
+		store->awaiting_next = next;
+		store->awaiting_count = count;
+	}
+
+	xSemaphoreGive(store->lock);
+
+	return (result >= 0) ? count : -1;
+}
+
+bool offline_telemetry_acknowledge(struct offline_telemetry * store, int message_id, bool published){
+	xSemaphoreTake(store->lock, portMAX_DELAY);
+
+	bool matched = (store->awaiting_message != 0 && message_id == store->awaiting_message);
+
+	if(matched){
+		store->awaiting_message = 0;
+
+		if(published){
+			commit_drained(store, store->awaiting_next, store->awaiting_count);
+		}else{
+			ESP_LOGW(TAG, "Message %d was not published, giving the batch again", message_id);
+		}
+	}
+
+	xSemaphoreGive(store->lock);
+
+	return matched;
+}
+
+struct offline_telemetry_stats offline_telemetry_get_stats(struct offline_telemetry * store){
+	xSemaphoreTake(store->lock, portMAX_DELAY);
+
+	struct offline_telemetry_stats stats = store->stats;
+	stats.stored = end_position(store) - store->cursor;
+
+	xSemaphoreGive(store->lock);
+
+	return stats;
+}
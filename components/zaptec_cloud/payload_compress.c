@@ -0,0 +1,402 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "payload_compress.h"
+
+/* Positions in the window are found by the hash of their first two bytes, the minimum useful match */
+#define HASH_BITS 10
+#define HASH_SIZE (1 << HASH_BITS)
+
+/* Candidates compared per position. Bounds the time spent on repetitive input. */
+#define MAX_CHAIN 16
+
+#define NO_POSITION -1
+
+struct payload_compressor{
+	struct payload_compress_config config;
+	size_t window;
+	size_t max_match;
+	size_t min_match;
+
+	uint8_t * buffer; ///< Twice the window. The first half is history once the buffer has been shifted.
+	int16_t * previous; ///< Previous position with the same hash, for each position in buffer
+	int16_t head[HASH_SIZE]; ///< Latest position with each hash
+
+	size_t fill; ///< Bytes in buffer
+	size_t position; ///< Next byte in buffer to compress
+
+	uint32_t bits;
+	uint8_t bit_count;
+
+	uint8_t output[PAYLOAD_COMPRESS_OUTPUT_SIZE];
+	size_t output_length;
+	size_t written;
+
+	esp_err_t error; ///< First error returned by write
+	bool finished;
+};
+
+struct payload_decompressor{
+	struct payload_compress_config config;
+	size_t window;
+	uint8_t * history; ///< Last window bytes written, as a ring
+	size_t produced; ///< Bytes decompressed
+
+	uint32_t bits;
+	uint8_t bit_count;
+
+	uint8_t output[PAYLOAD_COMPRESS_OUTPUT_SIZE];
+	size_t output_length;
+
+	esp_err_t error;
+};
+
+static bool valid_config(const struct payload_compress_config * config){
+	return config != NULL && config->write != NULL
+		&& config->window_bits >= PAYLOAD_COMPRESS_MIN_WINDOW_BITS
+		&& config->window_bits <= PAYLOAD_COMPRESS_MAX_WINDOW_BITS
+		&& config->lookahead_bits >= 3 && config->lookahead_bits < config->window_bits;
+}
+
+size_t payload_compressor_size(uint8_t window_bits){
+	size_t window = (size_t)1 << window_bits;
+	return sizeof(struct payload_compressor) + window * 2 + window * 2 * sizeof(int16_t);
+}
+
+struct payload_compressor * payload_compressor_create(const struct payload_compress_config * config){
+	if(!valid_config(config))
+		return NULL;
+
+	struct payload_compressor * compressor = malloc(payload_compressor_size(config->window_bits));
+	if(compressor == NULL)
+		return NULL;
+
+	memset(compressor, 0, sizeof(struct payload_compressor));
+
+	compressor->config = *config;
+	compressor->window = (size_t)1 << config->window_bits;
+	compressor->max_match = (size_t)1 << config->lookahead_bits;
+
+	/* Shortest copy that takes fewer bits than the literals it replaces */
+	compressor->min_match = (1 + config->window_bits + config->lookahead_bits) / 9 + 1;
+
+	compressor->previous = (int16_t *)(compressor + 1);
+	compressor->buffer = (uint8_t *)(compressor->previous + compressor->window * 2);
+
+	for(size_t i = 0; i < HASH_SIZE; i++)
+		compressor->head[i] = NO_POSITION;
+
+	return compressor;
+}
+
+static void flush_output(struct payload_compressor * compressor){
+	if(compressor->output_length == 0)
+		return;
+
+	if(compressor->error == ESP_OK)
+		compressor->error = compressor->config.write(compressor->output, compressor->output_length,
+							compressor->config.context);
+
+	compressor->written += compressor->output_length;
+	compressor->output_length = 0;
+}
+
+static void push_bits(struct payload_compressor * compressor, uint32_t value, uint8_t count){
+	compressor->bits = (compressor->bits << count) | value;
+	compressor->bit_count += count;
+
+	while(compressor->bit_count >= 8){
+		compressor->bit_count -= 8;
+		compressor->output[compressor->output_length++] = compressor->bits >> compressor->bit_count;
+
+		if(compressor->output_length == PAYLOAD_COMPRESS_OUTPUT_SIZE)
+			flush_output(compressor);
+	}
+
+	compressor->bits &= (1u << compressor->bit_count) - 1;
+}
+
+static uint16_t hash_at(const struct payload_compressor * compressor, size_t position){
+	return ((compressor->buffer[position] << 2) ^ compressor->buffer[position + 1]) & (HASH_SIZE - 1);
+}
+
+static void insert(struct payload_compressor * compressor, size_t position){
+	if(position + 1 >= compressor->fill)
+		return;
+
+	uint16_t hash = hash_at(compressor, position);
+	compressor->previous[position] = compressor->head[hash];
+	compressor->head[hash] = position;
+}
+
+/* Moves the second half of the buffer to the first, which keeps one window of history */
+static void shift_window(struct payload_compressor * compressor){
+	size_t window = compressor->window;
+
+	memmove(compressor->buffer, compressor->buffer + window, window);
+	compressor->fill -= window;
+	compressor->position -= window;
+
+	for(size_t i = 0; i < HASH_SIZE; i++)
+		compressor->head[i] = (compressor->head[i] >= (int)window) ? compressor->head[i] - window : NO_POSITION;
+
+	for(size_t i = 0; i < window; i++){
+		int16_t previous = compressor->previous[i + window];
+		compressor->previous[i] = (previous >= (int)window) ? previous - window : NO_POSITION;
+	}
+}
+
+static size_t find_match(struct payload_compressor * compressor, size_t * distance_out){
+	size_t position = compressor->position;
+	if(position + 1 >= compressor->fill)
+		return 0;
+
+	size_t limit = compressor->fill - position;
+	if(limit > compressor->max_match)
+		limit = compressor->max_match;
+
+	const uint8_t * current = compressor->buffer + position;
+	size_t best = 0;
+
+	int candidate = compressor->head[hash_at(compressor, position)];
+	for(int chain = 0; candidate != NO_POSITION && chain < MAX_CHAIN; chain++){
+		size_t distance = position - candidate;
+		if(distance > compressor->window)
+			break;
+
+		const uint8_t * earlier = compressor->buffer + candidate;
+		size_t length = 0;
+		while(length < limit && earlier[length] == current[length])
+			length++;
+
+		if(length > best){
+			best = length;
+			*distance_out = distance;
+
+			if(length == limit)
+				break;
+		}
+
+		candidate = compressor->previous[candidate];
+	}
+
+	return best;
+}
+
+/*
+ * Compresses the buffered data. Unless finishing, more than a full lookahead is kept, so matches are not cut short and
+ * every position passed can be hashed. The output then does not depend on the size of the pieces written.
+ */
+static void compress_buffered(struct payload_compressor * compressor, bool finishing){
+	while(compressor->position < compressor->fill){
+		if(!finishing && compressor->fill - compressor->position <= compressor->max_match)
+			break;
+
+		size_t distance = 0;
+		size_t length = find_match(compressor, &distance);
+
+		if(length >= compressor->min_match){
+			push_bits(compressor, 0, 1);
+			push_bits(compressor, distance - 1, compressor->config.window_bits);
+			push_bits(compressor, length - 1, compressor->config.lookahead_bits);
+		}else{
+			length = 1;
+			push_bits(compressor, 0x100 | compressor->buffer[compressor->position], 9);
+		}
+
+		for(size_t i = 0; i < length; i++)
+			insert(compressor, compressor->position + i);
+
+		compressor->position += length;
+	}
+}
+
+esp_err_t payload_compressor_write(struct payload_compressor * compressor, const void * data, size_t length){
+	if(compressor->finished)
+		return ESP_ERR_INVALID_STATE;
+
+	const uint8_t * input = data;
+
+	while(length > 0 && compressor->error == ESP_OK){
+		if(compressor->fill == compressor->window * 2)
+			shift_window(compressor);
+
+		size_t count = compressor->window * 2 - compressor->fill;
+		if(count > length)
+			count = length;
+
+		memcpy(compressor->buffer + compressor->fill, input, count);
+		compressor->fill += count;
+		input += count;
+		length -= count;
+
+		compress_buffered(compressor, false);
+	}
+
+	return compressor->error;
+}
+
+esp_err_t payload_compressor_finish(struct payload_compressor * compressor){
+	if(compressor->finished)
+		return ESP_ERR_INVALID_STATE;
+
+	compressor->finished = true;
+	compress_buffered(compressor, true);
+
+	if(compressor->bit_count > 0)
+		push_bits(compressor, 0, 8 - compressor->bit_count);
+
+	flush_output(compressor);
+
+	return compressor->error;
+}
+
+size_t payload_compressor_written(const struct payload_compressor * compressor){
+	return compressor->written;
+}
+
+void payload_compressor_free(struct payload_compressor * compressor){
+	free(compressor);
+}
+
+struct payload_decompressor * payload_decompressor_create(const struct payload_compress_config * config){
+	if(!valid_config(config))
+		return NULL;
+
+	size_t window = (size_t)1 << config->window_bits;
+
+	struct payload_decompressor * decompressor = calloc(1, sizeof(struct payload_decompressor) + window);
+	if(decompressor == NULL)
+		return NULL;
+
+	decompressor->config = *config;
+	decompressor->window = window;
+	decompressor->history = (uint8_t *)(decompressor + 1);
+
+	return decompressor;
+}
+
+static void put_byte(struct payload_decompressor * decompressor, uint8_t byte){
+	decompressor->history[decompressor->produced++ & (decompressor->window - 1)] = byte;
+	decompressor->output[decompressor->output_length++] = byte;
+
+	if(decompressor->output_length == PAYLOAD_COMPRESS_OUTPUT_SIZE){
+		if(decompressor->error == ESP_OK)
+			decompressor->error = decompressor->config.write(decompressor->output, decompressor->output_length,
+								decompressor->config.context);
+
+		decompressor->output_length = 0;
+	}
+}
+
+esp_err_t payload_decompressor_write(struct payload_decompressor * decompressor, const void * data, size_t length){
+	const uint8_t * input = data;
+	const uint8_t window_bits = decompressor->config.window_bits;
+	const uint8_t lookahead_bits = decompressor->config.lookahead_bits;
+
+	for(size_t i = 0; i < length && decompressor->error == ESP_OK; i++){
+		decompressor->bits = (decompressor->bits << 8) | input[i];
+		decompressor->bit_count += 8;
+
+		while(decompressor->bit_count > 0 && decompressor->error == ESP_OK){
+			bool literal = (decompressor->bits >> (decompressor->bit_count - 1)) & 1;
+			uint8_t needed = literal ? 9 : 1 + window_bits + lookahead_bits;
+
+			if(decompressor->bit_count < needed)
+				break;
+
+			decompressor->bit_count -= needed;
+			uint32_t item = decompressor->bits >> decompressor->bit_count;
+
+			if(literal){
+				put_byte(decompressor, item & 0xff);
+				continue;
+			}
+
+			size_t distance = ((item >> lookahead_bits) & (decompressor->window - 1)) + 1;
+			size_t count = (item & ((1u << lookahead_bits) - 1)) + 1;
+
+			if(distance > decompressor->produced){
+				decompressor->error = ESP_ERR_INVALID_ARG;
+				break;
+			}
+
+			for(size_t j = 0; j < count; j++)
+				put_byte(decompressor, decompressor->history[(decompressor->produced - distance) & (decompressor->window - 1)]);
+		}
+
+		decompressor->bits &= (1u << decompressor->bit_count) - 1;
+	}
+
+	return decompressor->error;
+}
+
+esp_err_t payload_decompressor_finish(struct payload_decompressor * decompressor){
+	if(decompressor->error == ESP_OK && decompressor->output_length > 0)
+		decompressor->error = decompressor->config.write(decompressor->output, decompressor->output_length,
+							decompressor->config.context);
+
+	decompressor->output_length = 0;
+
+	/* Only the zero bits padding the last byte may be left */
+	if(decompressor->error == ESP_OK && (decompressor->bit_count >= 8 || decompressor->bits != 0))
+		decompressor->error = ESP_ERR_INVALID_SIZE;
+
+	return decompressor->error;
+}
+
+void payload_decompressor_free(struct payload_decompressor * decompressor){
+	free(decompressor);
+}
+
+struct buffer_output{
+	uint8_t * data;
+	size_t size;
+	size_t length;
+};
+
+static esp_err_t write_to_buffer(const uint8_t * data, size_t length, void * context){
+	struct buffer_output * output = context;
+
+	if(output->length + length > output->size)
+		return ESP_ERR_INVALID_SIZE;
+
+	memcpy(output->data + output->length, data, length);
+	output->length += length;
+
+	return ESP_OK;
+}
+
+esp_err_t payload_compress(const void * data, size_t length, uint8_t window_bits, uint8_t lookahead_bits,
+			uint8_t * output, size_t output_size, size_t * length_out){
+
+	struct buffer_output buffer = {
+		.data = output,
+		.size = output_size,
+	};
+
+	struct payload_compress_config config = {
+		.window_bits = window_bits,
+		.lookahead_bits = lookahead_bits,
+		.write = write_to_buffer,
+		.context = &buffer,
+	};
+
+	if(!valid_config(&config))
+		return ESP_ERR_INVALID_ARG;
+
+	struct payload_compressor * compressor = payload_compressor_create(&config);
+	if(compressor == NULL)
+		return ESP_ERR_NO_MEM;
+
+	esp_err_t err = payload_compressor_write(compressor, data, length);
+	if(err == ESP_OK)
+		err = payload_compressor_finish(compressor);
+
+	payload_compressor_free(compressor);
+
+	if(err == ESP_OK)
+		*length_out = buffer.length;
+
+	return err;
+}
@@ -0,0 +1,332 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+
+#include "publish_queue.h"
+
+static const char *TAG = "PUBLISH QUEUE  ";
+
+/*
+ * Acknowledgements for message ids that were not yet recorded as in flight. The MQTT task can receive the
+ * acknowledgement before the task that sent the message has stored the id.
+ */
+#define EARLY_ACK_COUNT 4
+
+struct queued_message{
+	struct queued_message * next;
+	int state_key;
+	uint32_t flags;
+	size_t length;
+	char payload[];
+};
+
+struct publish_queue{
+	struct publish_queue_config config;
+	SemaphoreHandle_t lock;
+
+	struct queued_message * head;
+	struct queued_message * tail;
+
+	bool connected;
+	bool sending; ///< A message is being given to the MQTT client without the lock
+
+	int * in_flight_ids;
+	int early_acks[EARLY_ACK_COUNT];
+	size_t early_ack_next;
+
+	struct publish_queue_stats stats;
+};
+
+struct publish_queue * publish_queue_create(const struct publish_queue_config * config){
+	if(config == NULL || config->send == NULL || config->max_in_flight == 0)
+		return NULL;
+
+	struct publish_queue * queue = calloc(1, sizeof(struct publish_queue));
+	if(queue == NULL)
+		return NULL;
+
+	queue->config = *config;
+	queue->in_flight_ids = calloc(config->max_in_flight, sizeof(int));
+	queue->lock = xSemaphoreCreateMutex();
+
+	if(queue->in_flight_ids == NULL || queue->lock == NULL){
+		if(queue->lock != NULL)
+			vSemaphoreDelete(queue->lock);
+
+		free(queue->in_flight_ids);
+		free(queue);
+		return NULL;
+	}
+
+	return queue;
+}
+
+/* Removes the message after previous, or the head if previous is NULL. Must hold the lock */
+static struct queued_message * unlink_message(struct publish_queue * queue, struct queued_message * previous){
+	struct queued_message * message = (previous == NULL) ? queue->head : previous->next;
+
+	if(previous == NULL){
+		queue->head = message->next;
+	}else{
+		previous->next = message->next;
+	}
+
+	if(queue->tail == message)
+		queue->tail = previous;
+
+	message->next = NULL;
+	queue->stats.queued--;
+	queue->stats.queued_bytes -= message->length;
+
+	return message;
+}
+
+static void append_message(struct publish_queue * queue, struct queued_message * message){
+	message->next = NULL;
+
+	if(queue->tail == NULL){
+		queue->head = message;
+	}else{
+		queue->tail->next = message;
+	}
+
+	queue->tail = message;
+	queue->stats.queued++;
+	queue->stats.queued_bytes += message->length;
+}
+
+static void prepend_message(struct publish_queue * queue, struct queued_message * message){
+	message->next = queue->head;
+	queue->head = message;
+
+	if(queue->tail == NULL)
+		queue->tail = message;
+
+	queue->stats.queued++;
+	queue->stats.queued_bytes += message->length;
+}
+
+/* Removes the queued message with the given state key, if any. Must hold the lock */
+static struct queued_message * unlink_state(struct publish_queue * queue, int state_key){
+	if(state_key == PUBLISH_QUEUE_EVENT)
+		return NULL;
+
+	struct queued_message * previous = NULL;
+	for(struct queued_message * message = queue->head; message != NULL; previous = message, message = message->next){
+		if(message->state_key == state_key)
+			return unlink_message(queue, previous);
+	}
+
+	return NULL;
+}
+
+esp_err_t publish_queue_add(struct publish_queue * queue, int state_key, const char * payload){
+	return publish_queue_add_message(queue, state_key, payload, strlen(payload), 0);
+}
+
+esp_err_t publish_queue_add_message(struct publish_queue * queue, int state_key, const char * payload, size_t length,
+				uint32_t flags){
+	if(length > queue->config.max_bytes)
+		return ESP_ERR_INVALID_SIZE;
+
+	struct queued_message * message = malloc(sizeof(struct queued_message) + length + 1);
+	if(message == NULL)
+		return ESP_ERR_NO_MEM;
+
+	message->state_key = state_key;
+	message->flags = flags;
+	message->length = length;
+	memcpy(message->payload, payload, length);
+	message->payload[length] = '\0';
+
+	/* Freed after the lock is released */
+	struct queued_message * removed = NULL;
+	esp_err_t err = ESP_OK;
+
+	xSemaphoreTake(queue->lock, portMAX_DELAY);
+
+	struct queued_message * replaced = unlink_state(queue, state_key);
+	if(replaced != NULL){
+		replaced->next = removed;
+		removed = replaced;
+		queue->stats.replaced++;
+	}
+
+	while(queue->stats.queued_bytes + length > queue->config.max_bytes){
+		if(queue->config.overflow == ePUBLISH_QUEUE_REJECT_NEW){
+			err = ESP_ERR_NO_MEM;
+			break;
+		}
+
+		struct queued_message * oldest = unlink_message(queue, NULL);
+		oldest->next = removed;
+		removed = oldest;
+		queue->stats.dropped++;
+	}
+
+	if(err == ESP_OK){
+		append_message(queue, message);
+	}else{
+		queue->stats.dropped++;
+	}
+
+	xSemaphoreGive(queue->lock);
+
+	if(err != ESP_OK){
+		ESP_LOGW(TAG, "Queue full, rejected message of %zu bytes", length);
+		free(message);
+	}
+
+	while(removed != NULL){
+		struct queued_message * next = removed->next;
+		free(removed);
+		removed = next;
+	}
+
+	publish_queue_flush(queue);
+
+	return err;
+}
+
+/* Must hold the lock */
+static bool take_early_ack(struct publish_queue * queue, int message_id){
+	for(size_t i = 0; i < EARLY_ACK_COUNT; i++){
+		if(queue->early_acks[i] == message_id){
+			queue->early_acks[i] = 0;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Must hold the lock */
+static void record_in_flight(struct publish_queue * queue, int message_id){
+	/* QoS 0 messages are not acknowledged */
+	if(message_id == 0 || take_early_ack(queue, message_id)){
+		queue->stats.in_flight--;
+		return;
+	}
+
+	for(size_t i = 0; i < queue->config.max_in_flight; i++){
+		if(queue->in_flight_ids[i] == 0){
+			queue->in_flight_ids[i] = message_id;
+			return;
+		}
+	}
+}
+
+void publish_queue_flush(struct publish_queue * queue){
+	while(true){
+		xSemaphoreTake(queue->lock, portMAX_DELAY);
+
+		if(!queue->connected || queue->sending || queue->head == NULL
+			|| queue->stats.in_flight >= queue->config.max_in_flight){
+
+			xSemaphoreGive(queue->lock);
+			return;
+		}
+
+		struct queued_message * message = unlink_message(queue, NULL);
+		queue->stats.in_flight++;
+		queue->sending = true;
+
+		xSemaphoreGive(queue->lock);
+
+		/* The MQTT client has its own lock, which the MQTT task holds while calling publish_queue_on_published */
+		int message_id = queue->config.send(message->payload, message->length, message->flags, queue->config.context);
+
+		xSemaphoreTake(queue->lock, portMAX_DELAY);
+		queue->sending = false;
+
+		if(message_id < 0){
+			queue->stats.in_flight--;
+
+			/* Put back first, unless a newer state has been queued while sending */
+			struct queued_message * newer = NULL;
+			if(message->state_key != PUBLISH_QUEUE_EVENT){
+				for(newer = queue->head; newer != NULL; newer = newer->next){
+					if(newer->state_key == message->state_key)
+						break;
+				}
+			}
+
+			if(newer == NULL){
+				prepend_message(queue, message);
+				message = NULL;
+			}
+
+		}else{
+			record_in_flight(queue, message_id);
+			queue->stats.sent++;
+		}
+
+		xSemaphoreGive(queue->lock);
+
+		free(message);
+
+		if(message_id < 0){
+			ESP_LOGW(TAG, "Unable to give message to MQTT client");
+			return;
+		}
+	}
+}
+
+void publish_queue_on_published(struct publish_queue * queue, int message_id){
+	if(message_id <= 0)
+		return;
+
+	bool found = false;
+
+	xSemaphoreTake(queue->lock, portMAX_DELAY);
+
+	for(size_t i = 0; i < queue->config.max_in_flight; i++){
+		if(queue->in_flight_ids[i] == message_id){
+			queue->in_flight_ids[i] = 0;
+			queue->stats.in_flight--;
+			found = true;
+			break;
+		}
+	}
+
+	/* May be the acknowledgement of a message being sent, or of a message not sent by this queue */
+	if(!found && queue->sending){
+		queue->early_acks[queue->early_ack_next] = message_id;
+		queue->early_ack_next = (queue->early_ack_next + 1) % EARLY_ACK_COUNT;
+	}
+
+	xSemaphoreGive(queue->lock);
+
+	if(found)
+		publish_queue_flush(queue);
+}
+
+void publish_queue_set_connected(struct publish_queue * queue, bool connected){
+	xSemaphoreTake(queue->lock, portMAX_DELAY);
+
+	queue->connected = connected;
+
+	if(connected){
+		memset(queue->in_flight_ids, 0, queue->config.max_in_flight * sizeof(int));
+		memset(queue->early_acks, 0, sizeof(queue->early_acks));
+
+		/* A message being sent is still counted and recorded when the send returns */
+		queue->stats.in_flight = queue->sending ? 1 : 0;
+	}
+
+	xSemaphoreGive(queue->lock);
+
+	if(connected)
+		publish_queue_flush(queue);
+}
+
+struct publish_queue_stats publish_queue_get_stats(struct publish_queue * queue){
+	xSemaphoreTake(queue->lock, portMAX_DELAY);
+	struct publish_queue_stats stats = queue->stats;
+	xSemaphoreGive(queue->lock);
+
+	return stats;
+}
@@ -0,0 +1,13 @@
+/* Nanopb descriptors for telemetry-message.proto. Written by hand in the layout of nanopb_generator 0.4.7 output, as
+ * the generator is not part of the build. Keep the field list in step with the tags and types in the .proto, or replace
+ * this file with the output of nanopb_generator.py telemetry-message.proto. */
+
+#include "telemetry-message.pb.h"
+#if PB_PROTO_HEADER_VERSION != 40
+#error Update this file for the current version of the nanopb runtime.
+#endif
+
+PB_BIND(TelemetryBatch, TelemetryBatch, AUTO)
+
+
+
@@ -0,0 +1,73 @@
+/* Nanopb descriptors for telemetry-message.proto. Written by hand in the layout of nanopb_generator 0.4.7 output, as
+ * the generator is not part of the build. Keep the field list in step with the tags and types in the .proto, or replace
+ * this file with the output of nanopb_generator.py telemetry-message.proto. */
+
+#ifndef PB_TELEMETRY_MESSAGE_PB_H_INCLUDED
+#define PB_TELEMETRY_MESSAGE_PB_H_INCLUDED
+#include <pb.h>
+
+#if PB_PROTO_HEADER_VERSION != 40
+#error Update this file for the current version of the nanopb runtime.
+#endif
+
+/* Struct definitions */
+/* Observations published in the binary telemetry format, when enabled by the cloud with the TelemetryEncoding
+ setting. Decodes to the JSON observation message:
+   {"Observations":[{"ObservedAt":"...","Value":"...","ObservationId":N,"Type":1},...],"Type":6} */
+typedef struct _TelemetryBatch {
+    /* ObservedAt of the first observation, microseconds since epoch */
+    int64_t ObservedAt;
+    /* Observation id << 2 | value kind, for each observation. Value kinds:
+   0: integer, the next value in Numbers
+   1: decimal with 3 decimals, the next value in Numbers multiplied by 1000
+   2: text, the next value in Texts */
+    pb_size_t Keys_count;
+    uint32_t *Keys;
+    /* Microseconds from the previous observation, for each observation. Empty if all observations have the same time */
+    pb_size_t TimeDeltas_count;
+    int64_t *TimeDeltas;
+    pb_size_t Numbers_count;
+    int64_t *Numbers;
+    pb_size_t Texts_count;
+    char **Texts;
+} TelemetryBatch;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Initializer values for message structs */
+#define TelemetryBatch_init_default              {0, 0, NULL, 0, NULL, 0, NULL, 0, NULL}
+#define TelemetryBatch_init_zero                 {0, 0, NULL, 0, NULL, 0, NULL, 0, NULL}
+
+/* Field tags (for use in manual encoding/decoding) */
+#define TelemetryBatch_ObservedAt_tag            1
+#define TelemetryBatch_Keys_tag                  2
+#define TelemetryBatch_TimeDeltas_tag            3
+#define TelemetryBatch_Numbers_tag               4
+#define TelemetryBatch_Texts_tag                 5
+
+/* Struct field encoding specification for nanopb */
+#define TelemetryBatch_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, INT64,    ObservedAt,        1) \
+X(a, POINTER,  REPEATED, UINT32,   Keys,              2) \
+X(a, POINTER,  REPEATED, SINT64,   TimeDeltas,        3) \
+X(a, POINTER,  REPEATED, SINT64,   Numbers,           4) \
+X(a, POINTER,  REPEATED, STRING,   Texts,             5)
+#define TelemetryBatch_CALLBACK NULL
+#define TelemetryBatch_DEFAULT NULL
+
+extern const pb_msgdesc_t TelemetryBatch_msg;
+
+/* Defines for backwards compatibility with code written before nanopb-0.4.0 */
+#define TelemetryBatch_fields &TelemetryBatch_msg
+
+/* Maximum encoded size of messages (where known) */
+/* TelemetryBatch_size depends on runtime parameters */
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif
@@ -0,0 +1,348 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "pb_encode.h"
+
+#include "telemetry_binary.h"
+#include "telemetry-message.pb.h"
+
+/* Longest integer part of a "%.3f" value stored as a number, so that the value multiplied by 1000 fits */
+#define MILLI_MAX_DIGITS 15
+
+struct telemetry_binary{
+	size_t count;
+	size_t capacity;
+	uint32_t * keys;
+	int64_t * time_deltas;
+	bool time_varies; ///< Not all observations have the time of the first
+
+	int64_t * numbers;
+	size_t number_count;
+
+	char ** texts;
+	size_t text_count;
+
+	int64_t first_time;
+	int64_t previous_time;
+
+	uint8_t * encoded;
+	size_t encoded_length;
+	bool finished;
+};
+
+static bool grow(void ** array, size_t element_size, size_t capacity){
+	void * grown = realloc(*array, element_size * capacity);
+	if(grown == NULL)
+		return false;
+
+	*array = grown;
+	return true;
+}
+
+/* Numbers and texts have at most as many entries as keys, so all arrays grow together */
+static bool reserve(struct telemetry_binary * binary){
+	if(binary->count < binary->capacity)
+		return true;
+
+	size_t capacity = binary->capacity * 2;
+	if(capacity < 8)
+		capacity = 8;
+
+	if(!grow((void **)&binary->keys, sizeof(uint32_t), capacity)
+		|| !grow((void **)&binary->time_deltas, sizeof(int64_t), capacity)
+		|| !grow((void **)&binary->numbers, sizeof(int64_t), capacity)
+		|| !grow((void **)&binary->texts, sizeof(char *), capacity))
+		return false;
+
+	binary->capacity = capacity;
+	return true;
+}
+
+struct telemetry_binary * telemetry_binary_create(size_t initial_count){
+	struct telemetry_binary * binary = calloc(1, sizeof(struct telemetry_binary));
+	if(binary == NULL)
+		return NULL;
+
+	if(initial_count > 0){
+		binary->capacity = initial_count;
+		binary->keys = malloc(initial_count * sizeof(uint32_t));
+		binary->time_deltas = malloc(initial_count * sizeof(int64_t));
+		binary->numbers = malloc(initial_count * sizeof(int64_t));
+		binary->texts = malloc(initial_count * sizeof(char *));
+
+		if(binary->keys == NULL || binary->time_deltas == NULL || binary->numbers == NULL || binary->texts == NULL){
+			telemetry_binary_free(binary);
+			return NULL;
+		}
+	}
+
+	return binary;
+}
+
+static bool is_digit(char c){
+	return c >= '0' && c <= '9';
+}
+
+enum telemetry_binary_kind telemetry_binary_value_kind(const char * value, int64_t * number_out){
+	if(value == NULL)
+		return eTELEMETRY_BINARY_TEXT;
+
+	const char * c = value;
+	bool negative = (*c == '-');
+	if(negative)
+		c++;
+
+	int64_t integer = 0;
+	size_t digits = 0;
+	while(is_digit(*c) && digits <= MILLI_MAX_DIGITS){
+		integer = integer * 10 + (*c - '0');
+		digits++;
+		c++;
+	}
+
+	if(digits == 0 || digits > MILLI_MAX_DIGITS)
+		return eTELEMETRY_BINARY_TEXT;
+
+	enum telemetry_binary_kind kind;
+	int64_t number;
+
+	if(*c == '\0'){
+		kind = eTELEMETRY_BINARY_INTEGER;
+		number = negative ? -integer : integer;
+
+	}else if(c[0] == '.' && is_digit(c[1]) && is_digit(c[2]) && is_digit(c[3]) && c[4] == '\0'){
+		kind = eTELEMETRY_BINARY_MILLI;
+		number = integer * 1000 + (c[1] - '0') * 100 + (c[2] - '0') * 10 + (c[3] - '0');
+		if(negative)
+			number = -number;
+
+	}else{
+		return eTELEMETRY_BINARY_TEXT;
+	}
+
+	/* Leading zeros, "-0" and "-0.000" can not be restored from the number */
+	char formatted[TELEMETRY_BINARY_NUMBER_SIZE];
+	telemetry_binary_format_number(kind, number, formatted);
+
+	if(strcmp(formatted, value) != 0)
+		return eTELEMETRY_BINARY_TEXT;
+
+	*number_out = number;
+	return kind;
+}
+
+void telemetry_binary_format_number(enum telemetry_binary_kind kind, int64_t number, char * buffer){
+	if(kind != eTELEMETRY_BINARY_MILLI){
+		snprintf(buffer, TELEMETRY_BINARY_NUMBER_SIZE, "%" PRId64, number);
+		return;
+	}
+
+	uint64_t magnitude = (number < 0) ? -(uint64_t)number : (uint64_t)number;
+	snprintf(buffer, TELEMETRY_BINARY_NUMBER_SIZE, "%s%" PRIu64 ".%03u", (number < 0) ? "-" : "",
+		magnitude / 1000, (unsigned int)(magnitude % 1000));
+}
+
+/* Days since 1970-01-01 of a date in the proleptic Gregorian calendar */
+static int64_t days_from_civil(int64_t year, int month, int day){
+	year -= (month <= 2);
+	int64_t era = (year >= 0 ? year : year - 399) / 400;
+	int64_t year_of_era = year - era * 400;
+	int64_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+
+	return era * 146097 + day_of_era - 719468;
+}
+
+static void civil_from_days(int64_t days, int64_t * year, int * month, int * day){
+	days += 719468;
+	int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+	int64_t day_of_era = days - era * 146097;
+	int64_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+	int64_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+	int64_t month_index = (5 * day_of_year + 2) / 153;
+
+	*day = day_of_year - (153 * month_index + 2) / 5 + 1;
+	*month = month_index < 10 ? month_index + 3 : month_index - 9;
+	*year = year_of_era + era * 400 + (*month <= 2);
+}
+
+/* First and last microsecond that can be written with a four digit year */
+#define FIRST_TIME (-62167219200LL * 1000000)
+#define LAST_TIME (253402300800LL * 1000000 - 1)
+
+void telemetry_binary_format_time(int64_t time, char * buffer){
+	if(time < FIRST_TIME)
+		time = FIRST_TIME;
+
+	if(time > LAST_TIME)
+		time = LAST_TIME;
+
+	int64_t seconds = time / 1000000;
+	int64_t micros = time % 1000000;
+	if(micros < 0){
+		micros += 1000000;
+		seconds--;
+	}
+
+	int64_t days = seconds / 86400;
+	int64_t second_of_day = seconds % 86400;
+	if(second_of_day < 0){
+		second_of_day += 86400;
+		days--;
+	}
+
+	int64_t year;
+	int month;
+	int day;
+	civil_from_days(days, &year, &month, &day);
+
+	/* The remainders only tell the compiler the width of each field */
+	snprintf(buffer, TELEMETRY_BINARY_TIMESTAMP_SIZE, "%04u-%02u-%02uT%02u:%02u:%02u.%06uZ", (unsigned int)year % 10000,
+		(unsigned int)month % 100, (unsigned int)day % 100, (unsigned int)(second_of_day / 3600) % 100,
+		(unsigned int)(second_of_day / 60 % 60), (unsigned int)(second_of_day % 60), (unsigned int)micros % 1000000);
+}
+
+static bool parse_digits(const char * text, size_t count, int64_t * value_out){
+	int64_t value = 0;
+
+	for(size_t i = 0; i < count; i++){
+		if(!is_digit(text[i]))
+			return false;
+
+		value = value * 10 + (text[i] - '0');
+	}
+
+	*value_out = value;
+	return true;
+}
+
+esp_err_t telemetry_binary_parse_time(const char * observed_at, int64_t * time_out){
+	if(observed_at == NULL || strlen(observed_at) != 27)
+		return ESP_ERR_INVALID_ARG;
+
+	int64_t year, month, day, hour, minute, second, micros;
+
+	if(!parse_digits(observed_at, 4, &year) || !parse_digits(observed_at + 5, 2, &month)
+		|| !parse_digits(observed_at + 8, 2, &day) || !parse_digits(observed_at + 11, 2, &hour)
+		|| !parse_digits(observed_at + 14, 2, &minute) || !parse_digits(observed_at + 17, 2, &second)
+		|| !parse_digits(observed_at + 20, 6, &micros))
+		return ESP_ERR_INVALID_ARG;
+
+	if(month < 1 || month > 12)
+		return ESP_ERR_INVALID_ARG;
+
+	int64_t time = ((days_from_civil(year, month, day) * 86400) + hour * 3600 + minute * 60 + second) * 1000000 + micros;
+
+	/* Catches wrong separators and out of range fields like the 31st of April */
+	char formatted[TELEMETRY_BINARY_TIMESTAMP_SIZE];
+	telemetry_binary_format_time(time, formatted);
+
+	if(strcmp(formatted, observed_at) != 0)
+		return ESP_ERR_INVALID_ARG;
+
+	*time_out = time;
+	return ESP_OK;
+}
+
+esp_err_t telemetry_binary_add(struct telemetry_binary * binary, int observation_id, const char * value,
+			const char * observed_at){
+	if(binary->finished)
+		return ESP_ERR_INVALID_STATE;
+
+	int64_t time;
+	if(observation_id < 0 || telemetry_binary_parse_time(observed_at, &time) != ESP_OK)
+		return ESP_ERR_INVALID_ARG;
+
+	if(!reserve(binary))
+		return ESP_ERR_NO_MEM;
+
+	if(value == NULL)
+		value = "";
+
+	int64_t number;
+	enum telemetry_binary_kind kind = telemetry_binary_value_kind(value, &number);
+
+	if(kind == eTELEMETRY_BINARY_TEXT){
+		char * text = strdup(value);
+		if(text == NULL)
+			return ESP_ERR_NO_MEM;
+
+		binary->texts[binary->text_count++] = text;
+	}else{
+		binary->numbers[binary->number_count++] = number;
+	}
+
+	if(binary->count == 0){
+		binary->first_time = time;
+		binary->previous_time = time;
+	}
+
+	binary->keys[binary->count] = ((uint32_t)observation_id << 2) | kind;
+	binary->time_deltas[binary->count] = time - binary->previous_time;
+
+	if(time != binary->previous_time)
+		binary->time_varies = true;
+
+	binary->previous_time = time;
+	binary->count++;
+
+	return ESP_OK;
+}
+
+const uint8_t * telemetry_binary_finish(struct telemetry_binary * binary, size_t * length_out){
+	if(!binary->finished){
+		binary->finished = true;
+
+		TelemetryBatch message = TelemetryBatch_init_zero;
+		message.ObservedAt = binary->first_time;
+		message.Keys_count = binary->count;
+		message.Keys = binary->keys;
+		message.TimeDeltas_count = binary->time_varies ? binary->count : 0;
+		message.TimeDeltas = binary->time_deltas;
+		message.Numbers_count = binary->number_count;
+		message.Numbers = binary->numbers;
+		message.Texts_count = binary->text_count;
+		message.Texts = binary->texts;
+
+		size_t size;
+		if(!pb_get_encoded_size(&size, TelemetryBatch_fields, &message))
+			return NULL;
+
+		/* An empty message is valid, but malloc(0) may return NULL */
+		binary->encoded = malloc(size > 0 ? size : 1);
+		if(binary->encoded == NULL)
+			return NULL;
+
+		pb_ostream_t stream = pb_ostream_from_buffer(binary->encoded, size);
+		if(!pb_encode(&stream, TelemetryBatch_fields, &message)){
+			free(binary->encoded);
+			binary->encoded = NULL;
+			return NULL;
+		}
+
+		binary->encoded_length = stream.bytes_written;
+	}
+
+	if(binary->encoded == NULL)
+		return NULL;
+
+	*length_out = binary->encoded_length;
+	return binary->encoded;
+}
+
+void telemetry_binary_free(struct telemetry_binary * binary){
+	if(binary == NULL)
+		return;
+
+	for(size_t i = 0; i < binary->text_count; i++)
+		free(binary->texts[i]);
+
+	free(binary->keys);
+	free(binary->time_deltas);
+	free(binary->numbers);
+	free(binary->texts);
+	free(binary->encoded);
+	free(binary);
+}
@@ -8,10 +8,14 @@
 #include "esp_ota_ops.h"
 #include "esp_mac.h"
 #include "esp_tls.h"
+#include "esp_timer.h"
 #include "../../main/storage.h"
 #include "../../main/main.h"
 #include "zaptec_cloud_listener.h"
 #include "zaptec_cloud_observations.h"
+#include "observation_batch.h"
+#include "observation_deadband.h"
+#include "offline_telemetry.h"
 #include "../zaptec_protocol/include/zaptec_protocol_serialisation.h"
 #include "../i2c/include/i2cDevices.h"
 #include "../i2c/include/RTC.h"
@@ -63,33 +67,37 @@ void cloud_observations_disable(bool disable) {
     disableObservations = disable;
 }
 
-int _publish_json(cJSON *payload, bool blocking, TickType_t xTicksToWait){
-    if (disableObservations) {
-        ESP_LOGI(TAG, "Blocking observation during calibration!");
-        return 0;
-    }
+/// Set by the cloud with the TelemetryEncoding setting. JSON until the setting has been received.
+static bool binaryTelemetry = false;
 
-    char *message = cJSON_PrintUnformatted(payload);
+void cloud_observations_set_binary(bool binary) {
+#ifdef CONFIG_ZAPTEC_CLOUD_BINARY_TELEMETRY
+    binaryTelemetry = binary;
+#endif
+}
 
-    if(message == NULL){
-        ESP_LOGE(TAG, "failed to print json");
-        cJSON_Delete(payload);
-        return -2;
-    }
+/*
+ * Keys for states published as a collection. A queued message with the same key is replaced by a newer one. Single
+ * observations use the observation id as key.
+ */
+#define STATE_KEY_TELEMETRY_ALL 100000
+#define STATE_KEY_POWER 100001
 
-    int len = strlen(message);
+/// Observations preallocated for a collection in the binary telemetry format
+#define BINARY_BATCH_COUNT 16
+
+static int publish_message(const char *message, size_t len, bool binary, int state_key, bool blocking, TickType_t xTicksToWait){
     //ESP_LOGE(TAG, "<<<sending>>> %d: %s", len, message);
 
     int publish_err;
     if(blocking){
         publish_err = publish_iothub_event_blocked(message, xTicksToWait);
+    }else if(binary){
+        publish_err = publish_iothub_binary_state(state_key, message, len);
     }else{
-        publish_err = publish_iothub_event(message);
+        publish_err = publish_iothub_state(state_key, message);
     }
 
-    cJSON_Delete(payload);
-    free(message);
-
     if(publish_err == 0)
     {
     	mqttDiagnostics.mqttTxBytes += len;
@@ -104,6 +112,33 @@ int _publish_json(cJSON *payload, bool blocking, TickType_t xTicksToWait){
     return 0;
 }
 
+static int publish_json_state(cJSON *payload, int state_key, bool blocking, TickType_t xTicksToWait){
+    if (disableObservations) {
+        ESP_LOGI(TAG, "Blocking observation during calibration!");
+        cJSON_Delete(payload);
+        return 0;
+    }
+
+    char *message = cJSON_PrintUnformatted(payload);
+
+    if(message == NULL){
+        ESP_LOGE(TAG, "failed to print json");
+        cJSON_Delete(payload);
+        return -2;
+    }
+
+    int ret = publish_message(message, strlen(message), false, state_key, blocking, xTicksToWait);
+
+    cJSON_Delete(payload);
+    free(message);
+
+    return ret;
+}
+
+int _publish_json(cJSON *payload, bool blocking, TickType_t xTicksToWait){
+    return publish_json_state(payload, PUBLISH_QUEUE_EVENT, blocking, xTicksToWait);
+}
+
 int publish_json(cJSON *payload){
     return _publish_json(payload, false, 0);
 }
@@ -112,6 +147,41 @@ int publish_json_blocked(cJSON *payload, int timeout_ms){
     return _publish_json(payload, true, pdMS_TO_TICKS(timeout_ms));
 }
 
+static int _publish_observations(struct observation_batch *batch, int state_key, bool blocking, TickType_t xTicksToWait){
+    if (disableObservations) {
+        ESP_LOGI(TAG, "Blocking observation during calibration!");
+        observation_batch_free(batch);
+        return 0;
+    }
+
+    size_t length;
+    const char *message = observation_batch_finish(batch, &length);
+
+    if(message == NULL){
+        ESP_LOGE(TAG, "failed to encode observations");
+        observation_batch_free(batch);
+        return -2;
+    }
+
+    int ret = publish_message(message, length, batch->binary != NULL, state_key, blocking, xTicksToWait);
+
+    observation_batch_free(batch);
+
+    return ret;
+}
+
+static int publish_observations(struct observation_batch *batch){
+    return _publish_observations(batch, PUBLISH_QUEUE_EVENT, false, 0);
+}
+
+static int publish_observations_state(struct observation_batch *batch, int state_key){
+    return _publish_observations(batch, state_key, false, 0);
+}
+
+static int publish_observations_blocked(struct observation_batch *batch, int timeout_ms){
+    return _publish_observations(batch, PUBLISH_QUEUE_EVENT, true, pdMS_TO_TICKS(timeout_ms));
+}
+
 
 static bool initiateHoldRequestTimeStamp = false;
 void InitiateHoldRequestTimeStamp()
@@ -173,12 +243,10 @@ void cloud_observation_ClearTimeStruct()
 
 
 
-cJSON *create_observation(int observation_id, const char *value){
-    cJSON *result = cJSON_CreateObject();
-    if(result == NULL){return NULL;}
-
-    char strftime_buf[32];
-
+/*
+ * Returns the held timestamp if this observation should use it instead of the current time, or NULL.
+ */
+static const char *held_observed_at(int observation_id){
     /// When a new request command is sent the first time, hold the timestamp to use as StartDateTime in the CompletedSessionStructure.
     if((observation_id == 710) && (initiateHoldRequestTimeStamp == true) && (timeStruct.usedInSession == false) && (timeStruct.usedInRequest == false))
     {
@@ -190,23 +258,35 @@ cJSON *create_observation(int observation_id, const char *value){
 
     	initiateHoldRequestTimeStamp = false;
 
-    	cJSON_AddStringToObject(result, "ObservedAt", timeStruct.timeString);
-
     	ESP_LOGW(TAG, "Made REQUESTING TimeStamp: %i: %s for use in Session", strlen(timeStruct.timeString), timeStruct.timeString);
+    	return timeStruct.timeString;
     }
     //Start time was defined in ChargeSession_Set_StartTime(), use for first requesting message
     else if((observation_id == 710) && (initiateHoldRequestTimeStamp == true) && (timeStruct.usedInSession == true) && (timeStruct.usedInRequest == false))
     {
-    	cJSON_AddStringToObject(result, "ObservedAt", timeStruct.timeString);
     	initiateHoldRequestTimeStamp = false;
     	timeStruct.usedInRequest = true;
 
     	ESP_LOGW(TAG, "Using SESSION TimeStamp: %i: %s in REQUEST", strlen(timeStruct.timeString), timeStruct.timeString);
+    	return timeStruct.timeString;
     }
-    else
 
+    return NULL;
+}
+
+cJSON *create_observation(int observation_id, const char *value){
+    cJSON *result = cJSON_CreateObject();
+    if(result == NULL){return NULL;}
+
+    const char *held = held_observed_at(observation_id);
+    if(held != NULL)
+    {
+    	cJSON_AddStringToObject(result, "ObservedAt", held);
+    }
+    else
     {
     	/// Get the time-string for Observation only use
+    	char strftime_buf[32];
     	GetUTCTimeString(strftime_buf, NULL, NULL);
     	cJSON_AddStringToObject(result, "ObservedAt", strftime_buf);
     }
@@ -230,40 +310,70 @@ cJSON *create_uint32_t_observation(int observation_id, uint32_t value){
     return create_observation(observation_id, value_string);
 }
 
-cJSON *create_int32_t_observation(int observation_id, int32_t value){
-    char value_string[32];
-    sprintf(value_string, "%" PRId32 "", value);
-    return create_observation(observation_id, value_string);
-}
+/*
+ * Observations sent together are written directly to one buffer by observation_batch and share the timestamp taken
+ * when the collection is created, instead of a cJSON object and a formatted time for each observation.
+ */
+static struct observation_batch *create_batch(bool binary){
+    char observed_at[OBSERVATION_BATCH_TIMESTAMP_SIZE];
+    GetUTCTimeString(observed_at, NULL, NULL);
 
-cJSON *create_observation_collection(void){
-    cJSON *result = cJSON_CreateObject();
-    if(result == NULL){return NULL;}
+    struct observation_batch *result;
+    if(binary){
+    	result = observation_batch_create_binary(BINARY_BATCH_COUNT, observed_at);
+    }else{
+    	result = observation_batch_create(CONFIG_ZAPTEC_CLOUD_OBSERVATION_BATCH_SIZE, observed_at);
+    }
+
+    if(result == NULL)
+    	ESP_LOGE(TAG, "failed to allocate observations");
 
-    cJSON_AddArrayToObject(result, "Observations");
-    cJSON_AddNumberToObject(result, "Type", (float) 6.0);
     return result;
 }
 
-int add_observation_to_collection(cJSON *collection, cJSON *observation){
-    cJSON_AddItemToArray(
-        cJSON_GetObjectItem(collection, "Observations"),
-        observation
-    );
+static struct observation_batch *create_observation_collection(void){
+    return create_batch(binaryTelemetry);
+}
+
+/*
+ * Blocking events are given directly to the MQTT client as null terminated JSON on the JSON event topic.
+ */
+static struct observation_batch *create_json_observation_collection(void){
+    return create_batch(false);
+}
 
-    return 0;
+static void add_observation(struct observation_batch *collection, int observation_id, const char *value){
+    observation_batch_add(collection, observation_id, value, held_observed_at(observation_id));
+}
+
+static void add_double_observation(struct observation_batch *collection, int observation_id, double value){
+    char value_string[32];
+    sprintf(value_string, "%.3f", value);
+    add_observation(collection, observation_id, value_string);
+}
+
+static void add_uint32_t_observation(struct observation_batch *collection, int observation_id, uint32_t value){
+    char value_string[32];
+    sprintf(value_string, "%" PRId32 "", value);
+    add_observation(collection, observation_id, value_string);
+}
+
+static void add_int32_t_observation(struct observation_batch *collection, int observation_id, int32_t value){
+    char value_string[32];
+    sprintf(value_string, "%" PRId32 "", value);
+    add_observation(collection, observation_id, value_string);
 }
 
 
 int publish_debug_telemetry_observation_capabilities(){
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
-    add_observation_to_collection(observations, create_observation(Capabilities, GetCapabilityString()));
+    add_observation(observations, Capabilities, GetCapabilityString());
 
 	/// Always send firmare version in same message bundle as capability so it can be used on Cloud to handle
 	/// rollback to old firmwares without capabilities.
-	add_observation_to_collection(observations, create_observation(ParamSmartComputerAppVersion, GetSoftwareVersion()));
-    int ret = publish_json(observations);
+	add_observation(observations, ParamSmartComputerAppVersion, GetSoftwareVersion());
+    int ret = publish_observations(observations);
 
     return ret;
 }
@@ -271,25 +381,25 @@ int publish_debug_telemetry_observation_capabilities(){
 int publish_debug_telemetry_observation_power(){
     ESP_LOGD(TAG, "sending charging telemetry");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
-    add_observation_to_collection(observations, create_double_observation(ParamCurrentPhase1, MCU_GetCurrents(0)));
-    add_observation_to_collection(observations, create_double_observation(ParamCurrentPhase2, MCU_GetCurrents(1)));
-    add_observation_to_collection(observations, create_double_observation(ParamCurrentPhase3, MCU_GetCurrents(2)));
+    add_double_observation(observations, ParamCurrentPhase1, MCU_GetCurrents(0));
+    add_double_observation(observations, ParamCurrentPhase2, MCU_GetCurrents(1));
+    add_double_observation(observations, ParamCurrentPhase3, MCU_GetCurrents(2));
 
-    add_observation_to_collection(observations, create_double_observation(ParamVoltagePhase1, MCU_GetVoltages(0)));
-    add_observation_to_collection(observations, create_double_observation(ParamVoltagePhase2, MCU_GetVoltages(1)));
-    add_observation_to_collection(observations, create_double_observation(ParamVoltagePhase3, MCU_GetVoltages(2)));
+    add_double_observation(observations, ParamVoltagePhase1, MCU_GetVoltages(0));
+    add_double_observation(observations, ParamVoltagePhase2, MCU_GetVoltages(1));
+    add_double_observation(observations, ParamVoltagePhase3, MCU_GetVoltages(2));
 
-    add_observation_to_collection(observations, create_double_observation(ParamTotalChargePower, MCU_GetPower()));
-    add_observation_to_collection(observations, create_double_observation(ParamTotalChargePowerSession, chargeSession_Get().Energy));
+    add_double_observation(observations, ParamTotalChargePower, MCU_GetPower());
+    add_double_observation(observations, ParamTotalChargePowerSession, chargeSession_Get().Energy);
 
     if(IsUKOPENPowerBoardRevision())
     {
-    	add_observation_to_collection(observations, create_double_observation(ParamOPENVoltage, MCU_GetOPENVoltage()));
+    	add_double_observation(observations, ParamOPENVoltage, MCU_GetOPENVoltage());
     }
 
-    return publish_json(observations);
+    return publish_observations_state(observations, STATE_KEY_POWER);
 }
 
 
@@ -297,34 +407,34 @@ int publish_debug_telemetry_observation_cloud_settings()
 {
     ESP_LOGD(TAG, "sending cloud settings");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
-    add_observation_to_collection(observations, create_uint32_t_observation(AuthenticationRequired, storage_Get_AuthenticationRequired()));
-    add_observation_to_collection(observations, create_uint32_t_observation(NrOfChargeCards, storage_ReadNrOfTagsOnFile()));
-    add_observation_to_collection(observations, create_double_observation(ParamCurrentInMaximum, storage_Get_CurrentInMaximum()));
-    add_observation_to_collection(observations, create_double_observation(ParamCurrentInMinimum, storage_Get_CurrentInMinimum()));
+    add_uint32_t_observation(observations, AuthenticationRequired, storage_Get_AuthenticationRequired());
+    add_uint32_t_observation(observations, NrOfChargeCards, storage_ReadNrOfTagsOnFile());
+    add_double_observation(observations, ParamCurrentInMaximum, storage_Get_CurrentInMaximum());
+    add_double_observation(observations, ParamCurrentInMinimum, storage_Get_CurrentInMinimum());
 
-    add_observation_to_collection(observations, create_uint32_t_observation(MaxPhases, (uint32_t)GetMaxPhases()));
-    add_observation_to_collection(observations, create_uint32_t_observation(ChargerOfflinePhase, (uint32_t)storage_Get_DefaultOfflinePhase()));
-    add_observation_to_collection(observations, create_double_observation(ChargerOfflineCurrent, storage_Get_DefaultOfflineCurrent()));
+    add_uint32_t_observation(observations, MaxPhases, (uint32_t)GetMaxPhases());
+    add_uint32_t_observation(observations, ChargerOfflinePhase, (uint32_t)storage_Get_DefaultOfflinePhase());
+    add_double_observation(observations, ChargerOfflineCurrent, storage_Get_DefaultOfflineCurrent());
 
-    add_observation_to_collection(observations, create_uint32_t_observation(ParamIsEnabled, (uint32_t)storage_Get_IsEnabled()));
-    add_observation_to_collection(observations, create_observation(InstallationId, storage_Get_InstallationId()));
-    add_observation_to_collection(observations, create_observation(RoutingId, storage_Get_RoutingId()));
-    add_observation_to_collection(observations, create_observation(ChargePointName, storage_Get_ChargerName()));
+    add_uint32_t_observation(observations, ParamIsEnabled, (uint32_t)storage_Get_IsEnabled());
+    add_observation(observations, InstallationId, storage_Get_InstallationId());
+    add_observation(observations, RoutingId, storage_Get_RoutingId());
+    add_observation(observations, ChargePointName, storage_Get_ChargerName());
 
-    add_observation_to_collection(observations, create_uint32_t_observation(DiagnosticsMode, storage_Get_DiagnosticsMode()));
-    add_observation_to_collection(observations, create_uint32_t_observation(ParamIsStandalone, (uint32_t)storage_Get_Standalone()));
+    add_uint32_t_observation(observations, DiagnosticsMode, storage_Get_DiagnosticsMode());
+    add_uint32_t_observation(observations, ParamIsStandalone, (uint32_t)storage_Get_Standalone());
 
-    add_observation_to_collection(observations, create_int32_t_observation(SessionController, ocpp_get_session_controller_mode()));
+    add_int32_t_observation(observations, SessionController, ocpp_get_session_controller_mode());
 
-    add_observation_to_collection(observations, create_observation(OcppNativeURL, storage_Get_url_ocpp()));
-    add_observation_to_collection(observations, create_observation(OcppNativeCBID, storage_Get_chargebox_identity_ocpp()));
-    add_observation_to_collection(observations, create_uint32_t_observation(OcppNativeSecurityProfile, storage_Get_ocpp_security_profile()));
+    add_observation(observations, OcppNativeURL, storage_Get_url_ocpp());
+    add_observation(observations, OcppNativeCBID, storage_Get_chargebox_identity_ocpp());
+    add_uint32_t_observation(observations, OcppNativeSecurityProfile, storage_Get_ocpp_security_profile());
 
-    add_observation_to_collection(observations, create_observation(OcppNativeAuthorizationKeyFromZaptec, storage_Get_authorization_key_set_from_zaptec_ocpp() ? "1" : "0"));
+    add_observation(observations, OcppNativeAuthorizationKeyFromZaptec, storage_Get_authorization_key_set_from_zaptec_ocpp() ? "1" : "0");
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }
 
 
@@ -334,24 +444,24 @@ int publish_debug_telemetry_observation_local_settings()
 {
     ESP_LOGD(TAG, "sending local settings");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
     if(storage_Get_CommunicationMode() == eCONNECTION_WIFI)
-    	add_observation_to_collection(observations, create_observation(CommunicationMode, "Wifi"));
+    	add_observation(observations, CommunicationMode, "Wifi");
     else if (storage_Get_CommunicationMode() == eCONNECTION_LTE)
-    	add_observation_to_collection(observations, create_observation(CommunicationMode, "LTE"));
+    	add_observation(observations, CommunicationMode, "LTE");
 
     //uint8_t networkType = storage_Get_NetworkType();
     //if(networkType != 0)
-    	//add_observation_to_collection(observations, create_uint32_t_observation(ParamNetworkType, (uint32_t)networkType));
-    add_observation_to_collection(observations, create_uint32_t_observation(ParamIsStandalone, (uint32_t)storage_Get_Standalone()));
-    add_observation_to_collection(observations, create_double_observation(StandAloneCurrent, MCU_StandAloneCurrent()));
-    add_observation_to_collection(observations, create_double_observation(ChargerOfflineCurrent, storage_Get_DefaultOfflineCurrent()));
-    //add_observation_to_collection(observations, create_uint32_t_observation(ChargerOfflinePhase, storage_Get_DefaultOfflinePhase()));
-    add_observation_to_collection(observations, create_uint32_t_observation(PermanentCableLock, (uint32_t)storage_Get_PermanentLock()));
-    add_observation_to_collection(observations, create_double_observation(HmiBrightness, storage_Get_HmiBrightness()));
-
-    return publish_json(observations);
+    	//add_uint32_t_observation(observations, ParamNetworkType, (uint32_t)networkType);
+    add_uint32_t_observation(observations, ParamIsStandalone, (uint32_t)storage_Get_Standalone());
+    add_double_observation(observations, StandAloneCurrent, MCU_StandAloneCurrent());
+    add_double_observation(observations, ChargerOfflineCurrent, storage_Get_DefaultOfflineCurrent());
+    //add_uint32_t_observation(observations, ChargerOfflinePhase, storage_Get_DefaultOfflinePhase());
+    add_uint32_t_observation(observations, PermanentCableLock, (uint32_t)storage_Get_PermanentLock());
+    add_double_observation(observations, HmiBrightness, storage_Get_HmiBrightness());
+
+    return publish_observations(observations);
 }
 
 
@@ -359,39 +469,39 @@ int publish_debug_telemetry_observation_local_settings()
 {
     ESP_LOGD(TAG, "sending local settings");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
-    add_observation_to_collection(observations, create_double_observation(ParamChargeCurrentUserMax, storage_Get_DefaultOfflineCurrent()));
-    add_observation_to_collection(observations, create_uint32_t_observation(ParamSetPhases, (uint32_t)HOLD_GetSetPhases()));
+    add_double_observation(observations, ParamChargeCurrentUserMax, storage_Get_DefaultOfflineCurrent());
+    add_uint32_t_observation(observations, ParamSetPhases, (uint32_t)HOLD_GetSetPhases());
 
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }*/
 
 int publish_debug_telemetry_observation_Calibration(char *calibrationJSON) {
-    cJSON *observations = create_observation_collection();
-    add_observation_to_collection(observations, create_observation(MIDCalibration, calibrationJSON));
-    return publish_json_blocked(observations, 5000);
+    struct observation_batch *observations = create_json_observation_collection();
+    add_observation(observations, MIDCalibration, calibrationJSON);
+    return publish_observations_blocked(observations, 5000);
 }
 
 int publish_debug_telemetry_observation_Connectivity_None()
 {
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
-    add_observation_to_collection(observations, create_observation(CommunicationMode, "None"));
+    add_observation(observations, CommunicationMode, "None");
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }
 
 int publish_debug_telemetry_observation_NFC_tag_id(char * NFCHexString)
 {
     ESP_LOGD(TAG, "sending NFC telemetry");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
-    add_observation_to_collection(observations, create_observation(ChargerCurrentUserUuid, NFCHexString));
+    add_observation(observations, ChargerCurrentUserUuid, NFCHexString);
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }
 
 
@@ -399,11 +509,11 @@ int publish_debug_telemetry_observation_AddNewChargeCard(char * NewChargeCardStr
 {
     ESP_LOGD(TAG, "sending AddNewChargeCard telemetry");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
-    add_observation_to_collection(observations, create_observation(NewChargeCard, NewChargeCardString));
+    add_observation(observations, NewChargeCard, NewChargeCardString);
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }
 
 
@@ -411,11 +521,11 @@ int publish_debug_telemetry_observation_CompletedSession(char * CompletedSession
 {
     ESP_LOGD(TAG, "sending CompletedSession");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_json_observation_collection();
 
-    add_observation_to_collection(observations, create_observation(CompletedSession, CompletedSessionString));
+    add_observation(observations, CompletedSession, CompletedSessionString);
 
-    return publish_json_blocked(observations, 10000);
+    return publish_observations_blocked(observations, 10000);
 }
 
 
@@ -423,33 +533,33 @@ int publish_debug_telemetry_observation_GridTestResults(char * gridTestResults)
 {
     ESP_LOGD(TAG, "sending GridTestResults");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
-    add_observation_to_collection(observations, create_observation(GridTestResult, gridTestResults));
+    add_observation(observations, GridTestResult, gridTestResults);
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }
 
 int publish_debug_telemetry_observation_tamper_cover_state(uint32_t cover_state)
 {
     ESP_LOGD(TAG, "sending GridTestResults");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
-    add_observation_to_collection(observations, create_uint32_t_observation(ParamTamperCover, cover_state));
+    add_uint32_t_observation(observations, ParamTamperCover, cover_state);
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }
 
 int publish_debug_telemetry_observation_ocpp_native_connected(bool connected)
 {
     ESP_LOGD(TAG, "sending OCPP connected");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
-    add_observation_to_collection(observations, create_observation(OcppNativeConnected, connected ? "1" : "0"));
+    add_observation(observations, OcppNativeConnected, connected ? "1" : "0");
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }
 
 
@@ -462,7 +572,7 @@ int publish_debug_telemetry_security_log(const char * event_name, const char * e
 
     ESP_LOGD(TAG, "sending security log");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
     char log_entry[256];
     time_t timestamp = time(NULL);
@@ -475,20 +585,20 @@ int publish_debug_telemetry_security_log(const char * event_name, const char * e
 
     sprintf(log_entry, "[%s] %-16.16s: %.200s", timestamp_str, event_name, event_description);
 
-    add_observation_to_collection(observations, create_observation(SecurityLog, log_entry));
+    add_observation(observations, SecurityLog, log_entry);
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }
 
 int publish_debug_telemetry_observation_Diagnostics(char * diagnostics)
 {
     ESP_LOGD(TAG, "sending diagnostics");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
-    add_observation_to_collection(observations, create_observation(ParamDiagnosticsString, diagnostics));
+    add_observation(observations, ParamDiagnosticsString, diagnostics);
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }
 
 
@@ -496,11 +606,11 @@ int publish_debug_telemetry_observation_DiagnosticsLog()
 {
     ESP_LOGD(TAG, "sending diagnosticsLog");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
-    add_observation_to_collection(observations, create_observation(InternalDiagnosticsLog, storage_Get_DiagnosticsLog()));
+    add_observation(observations, InternalDiagnosticsLog, storage_Get_DiagnosticsLog());
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }
 
 /*
@@ -510,15 +620,15 @@ int publish_debug_telemetry_observation_InstallationConfigOnFile()
 {
     ESP_LOGD(TAG, "sending GridTestResults");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
     char buf[100];
     snprintf(buf, sizeof(buf), "On file: MaxInstallationCurrentConfig: %f, StandaloneCurrent: %f, PhaseRotation %d", storage_Get_MaxInstallationCurrentConfig(), storage_Get_StandaloneCurrent(), storage_Get_PhaseRotation());
 
     ESP_LOGI(TAG, "Sending InstallationConfigOnFile telemetry: %d/100", strlen(buf));
-    add_observation_to_collection(observations, create_observation(808, buf));
+    add_observation(observations, 808, buf);
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }
 
 
@@ -526,79 +636,79 @@ int publish_debug_telemetry_observation_StartUpParameters()
 {
     ESP_LOGD(TAG, "sending startup telemetry");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
-	add_observation_to_collection(observations, create_observation(Capabilities, GetCapabilityString()));
-    add_observation_to_collection(observations, create_double_observation(ParamChargeCurrentUserMax, MCU_GetChargeCurrentUserMax()));
-    add_observation_to_collection(observations, create_uint32_t_observation(ParamSetPhases, (uint32_t)HOLD_GetSetPhases()));
-    add_observation_to_collection(observations, create_observation(SessionIdentifier, chargeSession_GetSessionId()));
-	add_observation_to_collection(observations, create_uint32_t_observation(ParamIsStandalone, (uint32_t)storage_Get_Standalone()));
+	add_observation(observations, Capabilities, GetCapabilityString());
+    add_double_observation(observations, ParamChargeCurrentUserMax, MCU_GetChargeCurrentUserMax());
+    add_uint32_t_observation(observations, ParamSetPhases, (uint32_t)HOLD_GetSetPhases());
+    add_observation(observations, SessionIdentifier, chargeSession_GetSessionId());
+	add_uint32_t_observation(observations, ParamIsStandalone, (uint32_t)storage_Get_Standalone());
 
 	char buffer[MID_PUBLIC_KEY_SIZE];
 	if (storage_Get_MIDPublicKeyDER(buffer)) {
-		add_observation_to_collection(observations, create_observation(MIDPublicKey, buffer));
+		add_observation(observations, MIDPublicKey, buffer);
 	}
 
-	add_observation_to_collection(observations, create_observation(ParamSmartComputerAppVersion, GetSoftwareVersion()));
-    add_observation_to_collection(observations, create_observation(ParamSmartMainboardAppSwVersion, MCU_GetSwVersionString()));
+	add_observation(observations, ParamSmartComputerAppVersion, GetSoftwareVersion());
+    add_observation(observations, ParamSmartMainboardAppSwVersion, MCU_GetSwVersionString());
 #ifdef DEVELOPEMENT_URL
     char sourceVersionString[38] = {0};
     snprintf(sourceVersionString, 38, "%s (DEV)",(char*)esp_app_get_description()->version);
-    add_observation_to_collection(observations, create_observation(SourceVersion, sourceVersionString));
+    add_observation(observations, SourceVersion, sourceVersionString);
 #else
-    add_observation_to_collection(observations, create_observation(SourceVersion, (char*)esp_app_get_description()->version));
+    add_observation(observations, SourceVersion, (char*)esp_app_get_description()->version);
 #endif
-    add_observation_to_collection(observations, create_uint32_t_observation(ParamSmartMainboardBootSwVersion, (uint32_t)get_bootloader_version()));
-    add_observation_to_collection(observations, create_uint32_t_observation(MCUResetSource,  MCU_GetResetSource()));
-    add_observation_to_collection(observations, create_uint32_t_observation(ESPResetSource,  esp_reset_reason()));
-    add_observation_to_collection(observations, create_uint32_t_observation(ParamWarnings, (uint32_t)MCU_GetWarnings()));
-    add_observation_to_collection(observations, create_int32_t_observation(ParamChargeMode, (int32_t)MCU_GetChargeMode()));
-   	add_observation_to_collection(observations, create_uint32_t_observation(ParamChargeOperationMode, (uint32_t)MCU_GetChargeOperatingMode()));
+    add_uint32_t_observation(observations, ParamSmartMainboardBootSwVersion, (uint32_t)get_bootloader_version());
+    add_uint32_t_observation(observations, MCUResetSource,  MCU_GetResetSource());
+    add_uint32_t_observation(observations, ESPResetSource,  esp_reset_reason());
+    add_uint32_t_observation(observations, ParamWarnings, (uint32_t)MCU_GetWarnings());
+    add_int32_t_observation(observations, ParamChargeMode, (int32_t)MCU_GetChargeMode());
+   	add_uint32_t_observation(observations, ParamChargeOperationMode, (uint32_t)MCU_GetChargeOperatingMode());
 
     //ESP_LOGE(TAG, "\n ************* 1 Sending OperatingMode %d ***************\n", MCU_GetChargeOperatingMode());
-    add_observation_to_collection(observations, create_uint32_t_observation(PhaseRotation, (uint32_t)storage_Get_PhaseRotation()));
+    add_uint32_t_observation(observations, PhaseRotation, (uint32_t)storage_Get_PhaseRotation());
 
-    add_observation_to_collection(observations, create_uint32_t_observation(HwIdMCUSpeed, (uint32_t)MCU_GetHwIdMCUSpeed()));
-    add_observation_to_collection(observations, create_uint32_t_observation(HwIdMCUPower, (uint32_t)MCU_GetHwIdMCUPower()));
+    add_uint32_t_observation(observations, HwIdMCUSpeed, (uint32_t)MCU_GetHwIdMCUSpeed());
+    add_uint32_t_observation(observations, HwIdMCUPower, (uint32_t)MCU_GetHwIdMCUPower());
 
     char buf[256];
     GetTimeOnString(buf);
     snprintf(buf + strlen(buf), sizeof(buf), " Boot: ESP: v%s, MCU: v%s  Switch: %d/MaxInst: %2.1fA Sta: %2.1fA  ChargeState: %d  MCnt: %" PRId32 "  BRTC: 0x%X 0x%X Partition: %s", GetSoftwareVersion(), MCU_GetSwVersionString(), MCU_GetSwitchState(), MCU_ChargeCurrentInstallationMaxLimit(), MCU_StandAloneCurrent(), MCU_GetChargeOperatingMode(), MCU_GetDebugCounter(), RTCGetBootValue0(), RTCGetBootValue1(), OTAReadRunningPartition());
 
     ESP_LOGI(TAG, "Sending charging telemetry: %d/256", strlen(buf));
-    add_observation_to_collection(observations, create_observation(808, buf));
+    add_observation(observations, 808, buf);
 
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }
 
 int publish_debug_telemetry_observation_RequestNewStartChargingCommand()
 {
     ESP_LOGI(TAG, "sending Request start command telemetry");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
-    add_observation_to_collection(observations, create_observation(SessionIdentifier, chargeSession_GetSessionId()));
-    add_observation_to_collection(observations, create_uint32_t_observation(ParamChargeOperationMode, CHARGE_OPERATION_STATE_REQUESTING));
+    add_observation(observations, SessionIdentifier, chargeSession_GetSessionId());
+    add_uint32_t_observation(observations, ParamChargeOperationMode, CHARGE_OPERATION_STATE_REQUESTING);
 
     //ESP_LOGE(TAG, "\n ************* 2 Sending OperatingMode %d ***************\n", CHARGE_OPERATION_STATE_REQUESTING);
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }
 
 int publish_debug_telemetry_observation_ChargingStateParameters()
 {
     ESP_LOGD(TAG, "sending ChargeState telemetry");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
-    add_observation_to_collection(observations, create_uint32_t_observation(ParamCableType, (uint32_t)MCU_GetCableType()));
-    add_observation_to_collection(observations, create_int32_t_observation(ParamChargeMode, (int32_t)MCU_GetChargeMode()));
-    add_observation_to_collection(observations, create_uint32_t_observation(ParamChargeOperationMode, (uint32_t)MCU_GetChargeOperatingMode()));
+    add_uint32_t_observation(observations, ParamCableType, (uint32_t)MCU_GetCableType());
+    add_int32_t_observation(observations, ParamChargeMode, (int32_t)MCU_GetChargeMode());
+    add_uint32_t_observation(observations, ParamChargeOperationMode, (uint32_t)MCU_GetChargeOperatingMode());
 
     //ESP_LOGE(TAG, "\n ************* 3 Sending OperatingMode %d ***************\n", MCU_GetChargeOperatingMode());
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }
 
 
@@ -606,29 +716,29 @@ int publish_debug_telemetry_observation_WifiParameters()
 {
     ESP_LOGD(TAG, "sending LTE telemetry");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
     char wifiMAC[18] = {0};
     esp_read_mac((uint8_t*)wifiMAC, 0); //0=Wifi station
     snprintf(wifiMAC, sizeof(wifiMAC), "%02x:%02x:%02x:%02x:%02x:%02x", wifiMAC[0],wifiMAC[1],wifiMAC[2],wifiMAC[3],wifiMAC[4],wifiMAC[5]);
 
-    add_observation_to_collection(observations, create_observation(MacWiFi, wifiMAC));
+    add_observation(observations, MacWiFi, wifiMAC);
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }
 
 int publish_debug_telemetry_observation_LteParameters()
 {
     ESP_LOGD(TAG, "sending LTE telemetry");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
-    add_observation_to_collection(observations, create_observation(LteImsi, (char*)LTEGetImsi()));
-    //add_observation_to_collection(observations, create_observation(LteMsisdn, "0"));
-    add_observation_to_collection(observations, create_observation(LteIccid, (char*)LTEGetIccid()));
-    add_observation_to_collection(observations, create_observation(LteImei, (char*)LTEGetImei()));
+    add_observation(observations, LteImsi, (char*)LTEGetImsi());
+    //add_observation(observations, LteMsisdn, "0");
+    add_observation(observations, LteIccid, (char*)LTEGetIccid());
+    add_observation(observations, LteImei, (char*)LTEGetImei());
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }
 
 /*
@@ -638,68 +748,68 @@ int publish_debug_telemetry_observation_TimeAndSchedule(uint8_t bitmask)
 {
     ESP_LOGD(TAG, "sending Loc, TZ and Schedule");
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
     if(bitmask & 0x01)
-    	add_observation_to_collection(observations, create_observation(Location, storage_Get_Location()));
+    	add_observation(observations, Location, storage_Get_Location());
 
     if(bitmask & 0x02)
-    	add_observation_to_collection(observations, create_observation(TimeZone, storage_Get_Timezone()));
+    	add_observation(observations, TimeZone, storage_Get_Timezone());
 
     if(bitmask & 0x04)
-    	add_observation_to_collection(observations, create_observation(TimeSchedule, storage_Get_TimeSchedule()));
+    	add_observation(observations, TimeSchedule, storage_Get_TimeSchedule());
 
-    return publish_json(observations);
+    return publish_observations(observations);
 }
 
 
 int publish_debug_telemetry_observation_PulseInterval(uint32_t pulseInterval)
 {
-    cJSON *observations = create_observation_collection();
-    add_observation_to_collection(observations, create_uint32_t_observation(PulseInterval, pulseInterval));
-    return publish_json(observations);
-    //return publish_json_blocked(observations, 10000);
+    struct observation_batch *observations = create_observation_collection();
+    add_uint32_t_observation(observations, PulseInterval, pulseInterval);
+    return publish_observations(observations);
+    //return publish_observations_blocked(observations, 10000);
 }
 
 static uint32_t txCnt = 0;
 static float OPENVoltage = 0.0;
 int publish_debug_telemetry_observation_all(double rssi){
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
-    add_observation_to_collection(observations, create_double_observation(ParamInternalTemperature, I2CGetSHT30Temperature()));
-    add_observation_to_collection(observations, create_double_observation(ParamHumidity, I2CGetSHT30Humidity()));
+    add_double_observation(observations, ParamInternalTemperature, I2CGetSHT30Temperature());
+    add_double_observation(observations, ParamHumidity, I2CGetSHT30Humidity());
 
-    add_observation_to_collection(observations, create_double_observation(ParamTotalChargePower, MCU_GetPower()));
+    add_double_observation(observations, ParamTotalChargePower, MCU_GetPower());
 
     //Only send temperatures periodically when charging is active
     if(MCU_GetChargeMode() == eCAR_CHARGING)
     {
 
 
-		add_observation_to_collection(observations, create_double_observation(ParamInternalTemperatureEmeter, MCU_GetEmeterTemperature(0)));
+		add_double_observation(observations, ParamInternalTemperatureEmeter, MCU_GetEmeterTemperature(0));
 		if(IsUKOPENPowerBoardRevision() == false)
 		{
-			add_observation_to_collection(observations, create_double_observation(ParamInternalTemperatureEmeter2, MCU_GetEmeterTemperature(1)));
-			add_observation_to_collection(observations, create_double_observation(ParamInternalTemperatureEmeter3, MCU_GetEmeterTemperature(2)));
+			add_double_observation(observations, ParamInternalTemperatureEmeter2, MCU_GetEmeterTemperature(1));
+			add_double_observation(observations, ParamInternalTemperatureEmeter3, MCU_GetEmeterTemperature(2));
 		}
-		add_observation_to_collection(observations, create_double_observation(ParamInternalTemperatureT, MCU_GetTemperaturePowerBoard(0)));
-		add_observation_to_collection(observations, create_double_observation(ParamInternalTemperatureT2, MCU_GetTemperaturePowerBoard(1)));
+		add_double_observation(observations, ParamInternalTemperatureT, MCU_GetTemperaturePowerBoard(0));
+		add_double_observation(observations, ParamInternalTemperatureT2, MCU_GetTemperaturePowerBoard(1));
     }
 
     if(IsUKOPENPowerBoardRevision())
     {
     	OPENVoltage = MCU_GetOPENVoltage();
-    	add_observation_to_collection(observations, create_double_observation(ParamOPENVoltage, OPENVoltage));
+    	add_double_observation(observations, ParamOPENVoltage, OPENVoltage);
     }
 
 
-	add_observation_to_collection(observations, create_double_observation(CommunicationSignalStrength, rssi));
-	//add_observation_to_collection(observations, create_uint32_t_observation(ParamWarnings, (uint32_t)MCU_GetWarnings()));
+	add_double_observation(observations, CommunicationSignalStrength, rssi);
+	//add_uint32_t_observation(observations, ParamWarnings, (uint32_t)MCU_GetWarnings());
 
 	/*if(startupMessage == true)
 	{
-		add_observation_to_collection(observations, create_uint32_t_observation(MCUResetSource, (uint32_t)MCU_GetResetSource()));
-		add_observation_to_collection(observations, create_uint32_t_observation(ESPResetSource, (uint32_t)esp_reset_reason()));
+		add_uint32_t_observation(observations, MCUResetSource, (uint32_t)MCU_GetResetSource());
+		add_uint32_t_observation(observations, ESPResetSource, (uint32_t)esp_reset_reason());
 
 		startupMessage = false;
 	}*/
@@ -723,9 +833,9 @@ int publish_debug_telemetry_observation_all(double rssi){
 
 	ESP_LOGI(TAG, "Sending charging telemetry: %d/256", strlen(buf));
 
-	add_observation_to_collection(observations, create_observation(808, buf));
+	add_observation(observations, 808, buf);
 
-    return publish_json(observations);
+    return publish_observations_state(observations, STATE_KEY_TELEMETRY_ALL);
 }
 
 
@@ -756,8 +866,6 @@ static float previousMaxInstallationCurrentOnFile = -1.0;
 static uint8_t previousSwitchState = 0xff;
 static uint8_t previousPermanentLock = 0xff;
 static uint8_t previousCableType = 0xff;
-static float previousPower = -1.0;
-static float previousEnergy = -1.0;
 static uint32_t previousDiagnosticsMode = 0;
 
 static uint8_t previousOfflinePhase = 0;
@@ -777,9 +885,22 @@ static uint8_t previousOverrideGridType = 0xff;
 static uint8_t previousIT3OptimizationEnabled = 0xff;
 static bool previousPingReplyState = 1;
 static uint32_t previousMaxStartDelay = 0;
-static int8_t sendUpdateInSeconds = 0;
-static bool sendPower = false;
-static float powerLimit = 0.0;
+
+enum deadband_index{
+	DEADBAND_POWER,
+	DEADBAND_ENERGY,
+	DEADBAND_COUNT,
+};
+
+/*
+ * Measured values published on change. The bands are scaled by TransmitChangeLevel. Power is in W and waits 5 seconds
+ * to stabilize before it is sent, starting from 0 so it is not sent at boot when idle. Energy is in kWh and sent every
+ * 0.1kWh at the start of a session to make the app responsive, up to every 0.5kWh in longer sessions.
+ */
+static struct observation_deadband deadbands[DEADBAND_COUNT] = {
+	[DEADBAND_POWER] = {ParamTotalChargePower, 200.0, 0.07, 500.0, 5, 10, 0, OBSERVATION_DEADBAND_ZERO_IMMEDIATE, .sent = true},
+	[DEADBAND_ENERGY] = {ParamTotalChargePowerSession, 0.1, 0.1, 0.5, 0, 0, 0, 0},
+};
 
 /*
  * Calling this resets the previous values,
@@ -806,7 +927,7 @@ int publish_telemetry_observation_on_change(){
 
     bool isChange = false;
 
-    cJSON *observations = create_observation_collection();
+    struct observation_batch *observations = create_observation_collection();
 
 
     uint8_t chargeOperatingMode = MCU_GetChargeOperatingMode();
@@ -816,11 +937,11 @@ int publish_telemetry_observation_on_change(){
 		//If a disconnect occur, send 0 voltage levels
 		if (chargeOperatingMode == CHARGE_OPERATION_STATE_DISCONNECTED)
 		{
-			add_observation_to_collection(observations, create_double_observation(ParamVoltagePhase1, MCU_GetVoltages(0)));
+			add_double_observation(observations, ParamVoltagePhase1, MCU_GetVoltages(0));
 			if(IsUKOPENPowerBoardRevision() == false)
 			{
-				add_observation_to_collection(observations, create_double_observation(ParamVoltagePhase2, MCU_GetVoltages(1)));
-				add_observation_to_collection(observations, create_double_observation(ParamVoltagePhase3, MCU_GetVoltages(2)));
+				add_double_observation(observations, ParamVoltagePhase2, MCU_GetVoltages(1));
+				add_double_observation(observations, ParamVoltagePhase3, MCU_GetVoltages(2));
 			}
 		}
 
@@ -831,11 +952,11 @@ int publish_telemetry_observation_on_change(){
 			clearSessionFlag = false;
 		}*/
 
-		add_observation_to_collection(observations, create_uint32_t_observation(ParamChargeOperationMode, (uint32_t)chargeOperatingMode));
+		add_uint32_t_observation(observations, ParamChargeOperationMode, (uint32_t)chargeOperatingMode);
 
 		//Update Cloud with latest energy when entering paused state for display accurate value on user interfaces
 		if(chargeOperatingMode == CHARGE_OPERATION_STATE_PAUSED)
-			add_observation_to_collection(observations, create_double_observation(ParamTotalChargePowerSession, chargeSession_Get().Energy));
+			add_double_observation(observations, ParamTotalChargePowerSession, chargeSession_Get().Energy);
 
 		//ESP_LOGE(TAG, "\n ************* 4 Sending OperatingMode %d ***************\n", chargeOperatingMode);
 		previousChargeOperatingMode = chargeOperatingMode;
@@ -845,7 +966,7 @@ int publish_telemetry_observation_on_change(){
     int8_t chargeMode = MCU_GetChargeMode();
 	if ((previousChargeMode != chargeMode) && (chargeMode != 0) && (chargeMode != -1))
 	{
-		add_observation_to_collection(observations, create_int32_t_observation(ParamChargeMode, (int32_t)chargeMode));
+		add_int32_t_observation(observations, ParamChargeMode, (int32_t)chargeMode);
 		previousChargeMode = chargeMode;
 		isChange = true;
 	}
@@ -856,8 +977,8 @@ int publish_telemetry_observation_on_change(){
     int setPhases = HOLD_GetSetPhases();
 	if ((previousChargeCurrentUserMax != chargeCurrentUserMax) || (previousSetPhases != setPhases))
 	{
-		add_observation_to_collection(observations, create_double_observation(ParamChargeCurrentUserMax, chargeCurrentUserMax));
-		add_observation_to_collection(observations, create_uint32_t_observation(ParamSetPhases, (uint32_t)setPhases));
+		add_double_observation(observations, ParamChargeCurrentUserMax, chargeCurrentUserMax);
+		add_uint32_t_observation(observations, ParamSetPhases, (uint32_t)setPhases);
 		previousChargeCurrentUserMax = chargeCurrentUserMax;
 		previousSetPhases = setPhases;
 		isChange = true;
@@ -868,10 +989,10 @@ int publish_telemetry_observation_on_change(){
     uint8_t networkType = MCU_GetGridType();
     if (previousNetworkType != networkType)
     {
-    	add_observation_to_collection(observations, create_uint32_t_observation(ParamNetworkType, (uint32_t)networkType));
+    	add_uint32_t_observation(observations, ParamNetworkType, (uint32_t)networkType);
 
     	//Always send this also to ensure consistency
-    	add_observation_to_collection(observations, create_uint32_t_observation(MaxPhases, (uint32_t)GetMaxPhases()));
+    	add_uint32_t_observation(observations, MaxPhases, (uint32_t)GetMaxPhases());
     	previousNetworkType = networkType;
     	isChange = true;
     }
@@ -884,11 +1005,11 @@ int publish_telemetry_observation_on_change(){
 			if(((warnings & 0x400000) && !(previousWarnings & 0x400000)) || (!(warnings & 0x400000) && (previousWarnings & 0x400000)))
 			{
 				ESP_LOGI(TAG, "Sending O-PEN voltage on warning change: 0x%06" PRIX32 ", 0x%06" PRIX32, warnings, previousWarnings);
-				add_observation_to_collection(observations, create_double_observation(ParamOPENVoltage, MCU_GetOPENVoltage()));
+				add_double_observation(observations, ParamOPENVoltage, MCU_GetOPENVoltage());
 			}
 		}
 
-    	add_observation_to_collection(observations, create_uint32_t_observation(ParamWarnings, warnings));
+    	add_uint32_t_observation(observations, ParamWarnings, warnings);
     	previousWarnings = warnings;
     	isChange = true;
     }
@@ -901,7 +1022,7 @@ int publish_telemetry_observation_on_change(){
 			if((rxMsg.identifier == ParamWarningValue) && (rxMsg.length == 4))
 			{
 				warningValue = GetFloat(rxMsg.data);
-				add_observation_to_collection(observations, create_uint32_t_observation(ParamWarningValue, warningValue));
+				add_uint32_t_observation(observations, ParamWarningValue, warningValue);
 			}
     	}
     }
@@ -915,7 +1036,7 @@ int publish_telemetry_observation_on_change(){
     uint32_t notifications = GetCombinedNotificationsMasked();
     if(previousNotifications != notifications)
     {
-    	add_observation_to_collection(observations, create_uint32_t_observation(Notifications, notifications));
+    	add_uint32_t_observation(observations, Notifications, notifications);
     	previousNotifications = notifications;
     	isChange = true;
     }
@@ -923,7 +1044,7 @@ int publish_telemetry_observation_on_change(){
     uint32_t phaseRotation = storage_Get_PhaseRotation();
 	if(previousPhaseRotation != phaseRotation)
 	{
-		add_observation_to_collection(observations, create_uint32_t_observation(PhaseRotation, phaseRotation));
+		add_uint32_t_observation(observations, PhaseRotation, phaseRotation);
 		previousPhaseRotation = phaseRotation;
 		isChange = true;
 	}
@@ -935,7 +1056,7 @@ int publish_telemetry_observation_on_change(){
 
 	if((previousIsStandalone != isStandalone) && (isStandalone != 0xff))
 	{
-		add_observation_to_collection(observations, create_uint32_t_observation(ParamIsStandalone, (uint32_t)isStandalone));
+		add_uint32_t_observation(observations, ParamIsStandalone, (uint32_t)isStandalone);
 		previousIsStandalone = isStandalone;
 		isChange = true;
 	}
@@ -947,7 +1068,7 @@ int publish_telemetry_observation_on_change(){
 
 	if((previousStandaloneCurrent != standaloneCurrent))
 	{
-		add_observation_to_collection(observations, create_double_observation(StandAloneCurrent, standaloneCurrent));
+		add_double_observation(observations, StandAloneCurrent, standaloneCurrent);
 		previousStandaloneCurrent = standaloneCurrent;
 		isChange = true;
 	}
@@ -968,7 +1089,7 @@ int publish_telemetry_observation_on_change(){
 			ESP_LOGW(TAG, "Sending MCUs MaxInstCurrent: %f", maxInstallationCurrentConfig);
 		}
 
-		add_observation_to_collection(observations, create_double_observation(ChargeCurrentInstallationMaxLimit, valueToSend));
+		add_double_observation(observations, ChargeCurrentInstallationMaxLimit, valueToSend);
 		previousMaxInstallationCurrentConfig = maxInstallationCurrentConfig;
 		previousMaxInstallationCurrentOnFile = maxInstallationCurrentOnFile;
 		isChange = true;
@@ -977,7 +1098,7 @@ int publish_telemetry_observation_on_change(){
 	uint8_t switchState = MCU_GetSwitchState();
 	if((previousSwitchState != switchState) && (switchState != 0xff))
 	{
-		add_observation_to_collection(observations, create_uint32_t_observation(SwitchPosition, (uint32_t)switchState));
+		add_uint32_t_observation(observations, SwitchPosition, (uint32_t)switchState);
 		previousSwitchState = switchState;
 		isChange = true;
 	}
@@ -989,7 +1110,7 @@ int publish_telemetry_observation_on_change(){
 
 	if(previousPermanentLock != permanentLock)
 	{
-		add_observation_to_collection(observations, create_uint32_t_observation(PermanentCableLock, (uint32_t)permanentLock));
+		add_uint32_t_observation(observations, PermanentCableLock, (uint32_t)permanentLock);
 		previousPermanentLock = permanentLock;
 		isChange = true;
 	}
@@ -997,48 +1118,39 @@ int publish_telemetry_observation_on_change(){
 	uint8_t cableType = MCU_GetCableType();
 	if(previousCableType != cableType)
 	{
-		add_observation_to_collection(observations, create_uint32_t_observation(ParamCableType, (uint32_t)cableType));
+		add_uint32_t_observation(observations, ParamCableType, (uint32_t)cableType);
 		previousCableType = cableType;
 		isChange = true;
 	}
 
-	float power = MCU_GetPower();
+	float changeLevel = storage_Get_TransmitChangeLevel();
+	if(changeLevel <= 0.0)
+		changeLevel = 1.0;
 
-	/// In Watts
-	if (power > 7000.0)
-		powerLimit = 500.0;
-	else
-		powerLimit = 200.0;
+	float values[DEADBAND_COUNT];
+	bool publish[DEADBAND_COUNT];
 
-	/// Evaluate conditions for sending power, to avoid frequent transmission, but give good accuracy
+	values[DEADBAND_POWER] = MCU_GetPower();
 
-	if(((power > previousPower + powerLimit) || (power < (previousPower - powerLimit))) && (sendUpdateInSeconds == 0))
-	{
-		sendUpdateInSeconds = 5;
-	}
+	/// Round down on the 3rd decmial to ensure. In OCMF this digit may be rounded down to meet the SignedValue diff
+	/// to compensate for rounding inaccuracy. By always rounding down here it ensures that this value can never be
+	/// 1Wh higher than the CompletedSession energy.
+	values[DEADBAND_ENERGY] = floor(chargeSession_Get().Energy * 1000) / 1000.0;
 
-	if((power == 0.0) && (previousPower > 0.0))
-	{
-		sendPower = true;
-	}
+	/// Sanity check
+	if(values[DEADBAND_ENERGY] < 0.0)
+		values[DEADBAND_ENERGY] = 0.0;
 
-	/// This delays sending the power value to let it stabilize. Avoids sending often during frequent change to save data/server load
-	if(sendUpdateInSeconds > 0)
-	{
-		sendUpdateInSeconds--;
-		ESP_LOGI(TAG, "Delay power: %i", sendUpdateInSeconds);
-		if(sendUpdateInSeconds == 0)
-		{
-			sendPower = true;
-		}
-	}
+	float previousPower = deadbands[DEADBAND_POWER].last_value;
+	float previousEnergy = deadbands[DEADBAND_ENERGY].sent ? deadbands[DEADBAND_ENERGY].last_value : -1.0;
+
+	observation_deadband_update(deadbands, DEADBAND_COUNT, values, changeLevel, (uint32_t)(esp_timer_get_time() / 1000000), publish);
 
-	if(sendPower == true)
+	if(publish[DEADBAND_POWER])
 	{
-		sendPower = false;
-		sendUpdateInSeconds = 0;
+		float power = values[DEADBAND_POWER];
 
-		add_observation_to_collection(observations, create_double_observation(ParamTotalChargePower, power));
+		add_double_observation(observations, ParamTotalChargePower, power);
 
 		float currents[3] = {0};
 		currents[0] = MCU_GetCurrents(0);
@@ -1054,75 +1166,55 @@ int publish_telemetry_observation_on_change(){
 		{
 			struct ThreePhaseResult result = CalculatePhasePairCurrentFromPhaseCurrent(currents[0], currents[1], currents[2]);
 			/* Original "Pro" mapping
-			add_observation_to_collection(observations, create_double_observation(ParamCurrentPhase1, result.L3_L1));
-			add_observation_to_collection(observations, create_double_observation(ParamCurrentPhase2, result.L3_L2));
-			add_observation_to_collection(observations, create_double_observation(ParamCurrentPhase3, result.L1_L2));
+			add_double_observation(observations, ParamCurrentPhase1, result.L3_L1);
+			add_double_observation(observations, ParamCurrentPhase2, result.L3_L2);
+			add_double_observation(observations, ParamCurrentPhase3, result.L1_L2);
 			*/
 			//Mapping because of Go wiring
-			add_observation_to_collection(observations, create_double_observation(ParamCurrentPhase1, result.L1_L2)); //The value measured on N(L3) must be shown on L1;
-			add_observation_to_collection(observations, create_double_observation(ParamCurrentPhase2, result.L3_L1)); //The value measured on L1 must be shown on L2;
-			add_observation_to_collection(observations, create_double_observation(ParamCurrentPhase3, result.L3_L2)); //The value measured on L2 must be shown on L3;
+			add_double_observation(observations, ParamCurrentPhase1, result.L1_L2); //The value measured on N(L3) must be shown on L1;
+			add_double_observation(observations, ParamCurrentPhase2, result.L3_L1); //The value measured on L1 must be shown on L2;
+			add_double_observation(observations, ParamCurrentPhase3, result.L3_L2); //The value measured on L2 must be shown on L3;
 
 			ESP_LOGW(TAG, "IT3-Phase: Meas: %2.2f %2.2f %2.2f  Calc: %2.2f %2.2f %2.2f  %d", currents[0],currents[1],currents[2], result.L3_L1, result.L3_L2, result.L1_L2, result.usedAlgorithm);
 
 			/*char buf[256];
 			sprintf(buf, "IT3-Phase: %2.fW Meas: %2.2f %2.2f %2.2f  Calc: %2.2f %2.2f %2.2f  %d", power, currents[0],currents[1],currents[2], result.L3_L1, result.L3_L2, result.L1_L2, result.usedAlgorithm);
 			//ESP_LOGI(TAG, "Sending charging telemetry: %d/256", strlen(buf));
-			add_observation_to_collection(observations, create_observation(808, buf));*/
+			add_observation(observations, 808, buf);*/
 		}
 		else
 		{
 			//When power changes also update currents to be responsive
-			add_observation_to_collection(observations, create_double_observation(ParamCurrentPhase1, currents[0]));
+			add_double_observation(observations, ParamCurrentPhase1, currents[0]);
 			if(IsUKOPENPowerBoardRevision() == false)
 			{
-				add_observation_to_collection(observations, create_double_observation(ParamCurrentPhase2, currents[1]));
-				add_observation_to_collection(observations, create_double_observation(ParamCurrentPhase3, currents[2]));
+				add_double_observation(observations, ParamCurrentPhase2, currents[1]);
+				add_double_observation(observations, ParamCurrentPhase3, currents[2]);
 			}
 		}
 
-		ESP_LOGI(TAG, "Sending power: %i: %4.2f W (%4.2f)", sendUpdateInSeconds, power, previousPower);
+		ESP_LOGI(TAG, "Sending power: %4.2f W (%4.2f)", power, previousPower);
 
-		previousPower = power;
 		isChange = true;
 	}
 
-	float energy = chargeSession_Get().Energy;
-
-	/// Round down on the 3rd decmial to ensure. In OCMF this digit may be rounded down to meet the SignedValue diff
-	/// to compensate for rounding inaccuracy. By always rounding down here it ensures that this value can never be
-	/// 1Wh higher than the CompletedSession energy.
-	energy = floor(energy * 1000) / 1000.0;
-
-	//Send energy for every 0.1kWh when below 1kWh to make the app responsive at start of charging
-	//Send for every 0.2kWh above 1kWh
-	float trigLimit = 0.1;
-	if(energy >= 1.0)
-		trigLimit = 0.2;
-	if(energy >= 5.0)
-		trigLimit = 0.5;
-
-	//Send energy based on level of change
-	if((energy > previousEnergy + trigLimit) || (energy < (previousEnergy - trigLimit)))
+	if(publish[DEADBAND_ENERGY])
 	{
-		/// Sanity check
-		if(energy < 0.0)
-			energy = 0.0;
+		float energy = values[DEADBAND_ENERGY];
 
-		add_observation_to_collection(observations, create_double_observation(ParamTotalChargePowerSession, energy));
+		add_double_observation(observations, ParamTotalChargePowerSession, energy);
 
 		/// When 0.1kWh has been consumed, send voltages once
 		if ((energy >= 0.1) && (previousEnergy < 0.1))
 		{
-			add_observation_to_collection(observations, create_double_observation(ParamVoltagePhase1, MCU_GetVoltages(0)));
+			add_double_observation(observations, ParamVoltagePhase1, MCU_GetVoltages(0));
 			if(IsUKOPENPowerBoardRevision() == false)
 			{
-				add_observation_to_collection(observations, create_double_observation(ParamVoltagePhase2, MCU_GetVoltages(1)));
-				add_observation_to_collection(observations, create_double_observation(ParamVoltagePhase3, MCU_GetVoltages(2)));
+				add_double_observation(observations, ParamVoltagePhase2, MCU_GetVoltages(1));
+				add_double_observation(observations, ParamVoltagePhase3, MCU_GetVoltages(2));
 			}
 		}
 
-		previousEnergy = energy;
 		isChange = true;
 	}
 
@@ -1130,7 +1222,7 @@ int publish_telemetry_observation_on_change(){
 	uint32_t diagnosticsMode = storage_Get_DiagnosticsMode();
 	if(previousDiagnosticsMode != diagnosticsMode)
 	{
-		add_observation_to_collection(observations, create_uint32_t_observation(DiagnosticsMode, diagnosticsMode));
+		add_uint32_t_observation(observations, DiagnosticsMode, diagnosticsMode);
 		previousDiagnosticsMode = diagnosticsMode;
 		isChange = true;
 	}
@@ -1142,7 +1234,7 @@ int publish_telemetry_observation_on_change(){
 
 		ESP_LOGI(TAG, "Sending RTC telemetry: %d/80", strlen(buf));
 
-		add_observation_to_collection(observations, create_observation(808, buf));
+		add_observation(observations, 808, buf);
 
 		sendRTC = false;
 
@@ -1154,7 +1246,7 @@ int publish_telemetry_observation_on_change(){
 	uint8_t offlinePhase = storage_Get_DefaultOfflinePhase();
 	if(previousOfflinePhase != offlinePhase)
 	{
-		add_observation_to_collection(observations, create_uint32_t_observation(ChargerOfflinePhase, (uint32_t)offlinePhase));
+		add_uint32_t_observation(observations, ChargerOfflinePhase, (uint32_t)offlinePhase);
 		previousOfflinePhase = offlinePhase;
 		isChange = true;
 	}
@@ -1166,7 +1258,7 @@ int publish_telemetry_observation_on_change(){
 
 	if((previousOfflineCurrent != offlineCurrent))
 	{
-		add_observation_to_collection(observations, create_double_observation(ChargerOfflineCurrent, offlineCurrent));
+		add_double_observation(observations, ChargerOfflineCurrent, offlineCurrent);
 		previousOfflineCurrent = offlineCurrent;
 		isChange = true;
 	}
@@ -1174,7 +1266,7 @@ int publish_telemetry_observation_on_change(){
 	uint8_t finalStopActiveStatus = GetFinalStopActiveStatus();
 	if(finalStopActiveStatus != previousFinalStopActiveStatus)
 	{
-		add_observation_to_collection(observations, create_uint32_t_observation(FinalStopActive, (uint32_t)finalStopActiveStatus));
+		add_uint32_t_observation(observations, FinalStopActive, (uint32_t)finalStopActiveStatus);
 		previousFinalStopActiveStatus = finalStopActiveStatus;
 		isChange = true;
 	}
@@ -1182,7 +1274,7 @@ int publish_telemetry_observation_on_change(){
     uint32_t transmitInterval = storage_Get_TransmitInterval();
     if(previousTransmitInterval != transmitInterval)
     {
-    	add_observation_to_collection(observations, create_uint32_t_observation(TransmitInterval, transmitInterval));
+    	add_uint32_t_observation(observations, TransmitInterval, transmitInterval);
     	previousTransmitInterval = transmitInterval;
     	isChange = true;
     }
@@ -1190,7 +1282,7 @@ int publish_telemetry_observation_on_change(){
 	/*uint32_t pulseInterval = storage_Get_PulseInterval();
 	if(previousPulseInterval != pulseInterval)
 	{
-		add_observation_to_collection(observations, create_uint32_t_observation(PulseInterval, pulseInterval));
+		add_uint32_t_observation(observations, PulseInterval, pulseInterval);
 		previousPulseInterval = pulseInterval;
 		isChange = true;
 	}*/
@@ -1198,7 +1290,7 @@ int publish_telemetry_observation_on_change(){
 	uint32_t certificateVersion = (uint32_t)certificate_GetCurrentBundleVersion();
 	if(previousCertificateVersion != certificateVersion)
 	{
-		add_observation_to_collection(observations, create_uint32_t_observation(CertificateVersion, certificateVersion));
+		add_uint32_t_observation(observations, CertificateVersion, certificateVersion);
 		previousCertificateVersion = certificateVersion;
 		isChange = true;
 	}
@@ -1206,7 +1298,7 @@ int publish_telemetry_observation_on_change(){
 	uint8_t maxCurrentConfigSource = GetMaxCurrentConfigurationSource();
 	if(previousMaxCurrentConfigSource != maxCurrentConfigSource)
 	{
-		add_observation_to_collection(observations, create_uint32_t_observation(MaxCurrentConfigurationSource, (uint32_t)maxCurrentConfigSource));
+		add_uint32_t_observation(observations, MaxCurrentConfigurationSource, (uint32_t)maxCurrentConfigSource);
 		previousMaxCurrentConfigSource = maxCurrentConfigSource;
 		isChange = true;
 	}
@@ -1214,7 +1306,7 @@ int publish_telemetry_observation_on_change(){
 	uint32_t nrOfTagsCount = storage_GetNrOfTagsCounter();
 	if(previousNumberOfTagsCount != nrOfTagsCount)
 	{
-		add_observation_to_collection(observations, create_uint32_t_observation(NrOfChargeCards, nrOfTagsCount));
+		add_uint32_t_observation(observations, NrOfChargeCards, nrOfTagsCount);
 		previousNumberOfTagsCount = nrOfTagsCount;
 		isChange = true;
 	}
@@ -1222,7 +1314,7 @@ int publish_telemetry_observation_on_change(){
 	uint8_t overrideGridType = MCU_GetOverrideGridType();
 	if(overrideGridType != previousOverrideGridType)
 	{
-		add_observation_to_collection(observations, create_uint32_t_observation(ParamGridTypeOverride, (uint32_t)overrideGridType));
+		add_uint32_t_observation(observations, ParamGridTypeOverride, (uint32_t)overrideGridType);
 		previousOverrideGridType = overrideGridType;
 		isChange = true;
 	}
@@ -1233,7 +1325,7 @@ int publish_telemetry_observation_on_change(){
 		uint8_t IT3OptimizationEnabled = MCU_GetIT3OptimizationState();
 		if(IT3OptimizationEnabled != previousIT3OptimizationEnabled)
 		{
-			add_observation_to_collection(observations, create_uint32_t_observation(ParamIT3OptimizationEnabled, (uint32_t)IT3OptimizationEnabled));
+			add_uint32_t_observation(observations, ParamIT3OptimizationEnabled, (uint32_t)IT3OptimizationEnabled);
 			previousIT3OptimizationEnabled = IT3OptimizationEnabled;
 			isChange = true;
 		}
@@ -1244,7 +1336,7 @@ int publish_telemetry_observation_on_change(){
 		bool pingReplyState = offlineHandler_IsPingReplyOffline();
 		if(pingReplyState != previousPingReplyState)
 		{
-			add_observation_to_collection(observations, create_uint32_t_observation(OfflineMode, (uint32_t)pingReplyState));
+			add_uint32_t_observation(observations, OfflineMode, (uint32_t)pingReplyState);
 			previousPingReplyState = pingReplyState;
 			isChange = true;
 		}
@@ -1252,26 +1344,26 @@ int publish_telemetry_observation_on_change(){
 
 	if(chargeController_CheckForNewScheduleEvent())
 	{
-		add_observation_to_collection(observations, create_observation(NextScheduleEvent, chargeController_GetNextStartString()));
+		add_observation(observations, NextScheduleEvent, chargeController_GetNextStartString());
 		isChange = true;
 	}
 
 	if(BLE_CheckForNewLocation())
 	{
-		add_observation_to_collection(observations, create_observation(Location, storage_Get_Location()));
+		add_observation(observations, Location, storage_Get_Location());
 		isChange = true;
 	}
 
 
 	if(BLE_CheckForNewTimezone())
 	{
-		add_observation_to_collection(observations, create_observation(TimeZone, storage_Get_Timezone()));
+		add_observation(observations, TimeZone, storage_Get_Timezone());
 		isChange = true;
 	}
 
 	if(BLE_CheckForNewTimeSchedule())
 	{
-		add_observation_to_collection(observations, create_observation(TimeSchedule, storage_Get_TimeSchedule()));
+		add_observation(observations, TimeSchedule, storage_Get_TimeSchedule());
 		isChange = true;
 	}
 
@@ -1280,7 +1372,7 @@ int publish_telemetry_observation_on_change(){
 		uint32_t maxStartDelay = storage_Get_MaxStartDelay();
 		if(previousMaxStartDelay != maxStartDelay)
 		{
-			add_observation_to_collection(observations, create_uint32_t_observation(MaxStartDelay, maxStartDelay));
+			add_uint32_t_observation(observations, MaxStartDelay, maxStartDelay);
 			previousMaxStartDelay = maxStartDelay;
 			isChange = true;
 		}
@@ -1291,13 +1383,218 @@ int publish_telemetry_observation_on_change(){
     int ret = 0;
 
     if(isChange == true)
-    	ret = publish_json(observations);
+    	ret = publish_observations(observations);
     else
-    	cJSON_Delete(observations);
+    	observation_batch_free(observations);
 
     return ret;
 }
 
+/*
+ * While offline, changed power, energy and operating mode are stored with their time in a ring on /files, and
+ * published in batches when online again. The ring has its own copy of the dead-bands, starting from the last
+ * published values, so the recorded values do not keep the current values from being published on reconnect.
+ *
+ * A batch is only removed from the ring when the broker acknowledges its message. The ack queue is added while a batch
+ * is waiting, and read each time recorded values are published.
+ */
+#define OFFLINE_TELEMETRY_ACK_QUEUE_LENGTH 8
+
+static struct offline_telemetry *offlineTelemetry = NULL;
+static QueueHandle_t offlineTelemetryAcks = NULL;
+static bool offlineTelemetryOpened = false;
+static bool recordingOffline = false;
+static struct observation_deadband offlineDeadbands[DEADBAND_COUNT];
+static uint8_t offlineChargeOperatingMode = 0;
+
+static struct offline_telemetry *get_offline_telemetry(void){
+	if(!offlineTelemetryOpened)
+	{
+		offlineTelemetryOpened = true;
+
+		struct offline_telemetry_config config = {
+			.path = "/files/telemetry.bin",
+			.block_count = CONFIG_ZAPTEC_CLOUD_OFFLINE_TELEMETRY_BLOCKS,
+			.sync_interval = CONFIG_ZAPTEC_CLOUD_OFFLINE_TELEMETRY_SYNC_INTERVAL * 1000,
+			.batch_records = CONFIG_ZAPTEC_CLOUD_OFFLINE_TELEMETRY_BATCH,
+			.batch_interval = CONFIG_ZAPTEC_CLOUD_OFFLINE_TELEMETRY_BATCH_INTERVAL,
+			.ack_timeout = CONFIG_ZAPTEC_CLOUD_OFFLINE_TELEMETRY_ACK_TIMEOUT,
+		};
+
+		offlineTelemetryAcks = xQueueCreate(OFFLINE_TELEMETRY_ACK_QUEUE_LENGTH, sizeof(struct publish_ack));
+		if(offlineTelemetryAcks == NULL)
+		{
+			ESP_LOGE(TAG, "Offline telemetry not available, no memory for ack queue");
+			return NULL;
+		}
+
+		offlineTelemetry = offline_telemetry_open(&config);
+		if(offlineTelemetry == NULL)
+			ESP_LOGE(TAG, "Offline telemetry not available");
+	}
+
+	return offlineTelemetry;
+}
+
+static void record_offline_observation(struct offline_telemetry *store, int observation_id, enum offline_telemetry_type type,
+				double value, uint32_t now){
+
+	struct offline_telemetry_record record = {
+		.time = (uint32_t)time(NULL),
+		.id = observation_id,
+		.type = type,
+	};
+
+	if(type == eOFFLINE_TELEMETRY_DOUBLE){
+		record.value.d = value;
+	}else{
+		record.value.u = (uint32_t)value;
+	}
+
+	if(offline_telemetry_add(store, &record, now) != ESP_OK)
+		ESP_LOGW(TAG, "Unable to record observation %d offline", observation_id);
+}
+
+int record_telemetry_observation_offline(){
+	struct offline_telemetry *store = get_offline_telemetry();
+	if(store == NULL || disableObservations)
+		return -1;
+
+	if(!recordingOffline)
+	{
+		memcpy(offlineDeadbands, deadbands, sizeof(deadbands));
+		offlineChargeOperatingMode = previousChargeOperatingMode;
+		recordingOffline = true;
+	}
+
+	uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
+
+	float changeLevel = storage_Get_TransmitChangeLevel();
+	if(changeLevel <= 0.0)
+		changeLevel = 1.0;
+
+	float values[DEADBAND_COUNT];
+	bool publish[DEADBAND_COUNT];
+
+	values[DEADBAND_POWER] = MCU_GetPower();
+	values[DEADBAND_ENERGY] = floor(chargeSession_Get().Energy * 1000) / 1000.0;
+
+	if(values[DEADBAND_ENERGY] < 0.0)
+		values[DEADBAND_ENERGY] = 0.0;
+
+	observation_deadband_update(offlineDeadbands, DEADBAND_COUNT, values, changeLevel, now / 1000, publish);
+
+	for(size_t i = 0; i < DEADBAND_COUNT; i++)
+	{
+		if(publish[i])
+			record_offline_observation(store, offlineDeadbands[i].id, eOFFLINE_TELEMETRY_DOUBLE, values[i], now);
+	}
+
+	uint8_t chargeOperatingMode = MCU_GetChargeOperatingMode();
+	if((offlineChargeOperatingMode != chargeOperatingMode) && (chargeOperatingMode != 0))
+	{
+		record_offline_observation(store, ParamChargeOperationMode, eOFFLINE_TELEMETRY_UINT32, chargeOperatingMode, now);
+		offlineChargeOperatingMode = chargeOperatingMode;
+	}
+
+	return 0;
+}
+
+/* Returns the message id to wait for, 0 if observations are disabled, or negative on failure */
+static int publish_observations_tracked(struct observation_batch *batch){
+    if (disableObservations) {
+        ESP_LOGI(TAG, "Blocking observation during calibration!");
+        observation_batch_free(batch);
+        return 0;
+    }
+
+    size_t length;
+    const char *message = observation_batch_finish(batch, &length);
+
+    int message_id = -2;
+    if(message != NULL && batch->binary != NULL)
+        message_id = publish_iothub_binary_event_tracked(message, length);
+    else if(message != NULL)
+        message_id = publish_iothub_event_tracked(message);
+
+    if(message_id > 0)
+    {
+    	mqttDiagnostics.mqttTxBytes += length;
+    	mqttDiagnostics.mqttTxBytesIncMeta += (length+112);
+    	mqttDiagnostics.nrOfTxMessages++;
+    }
+
+    observation_batch_free(batch);
+    return message_id;
+}
+
+static int publish_offline_records(const struct offline_telemetry_record *records, size_t count, void *context){
+	/// Added before publishing so the ack is not missed
+	xQueueReset(offlineTelemetryAcks);
+	if(publish_iothub_add_ack_queue(offlineTelemetryAcks) != 0)
+		return -1;
+
+	struct observation_batch *batch = create_observation_collection();
+	if(batch == NULL)
+	{
+		publish_iothub_remove_ack_queue(offlineTelemetryAcks);
+		return -1;
+	}
+
+	for(size_t i = 0; i < count; i++)
+	{
+		char observed_at[OBSERVATION_BATCH_TIMESTAMP_SIZE];
+		struct tm timeinfo;
+		time_t observedTime = records[i].time;
+
+		gmtime_r(&observedTime, &timeinfo);
+		strftime(observed_at, sizeof(observed_at), "%Y-%m-%dT%H:%M:%S.000000Z", &timeinfo);
+
+		char value_string[32];
+		switch(records[i].type)
+		{
+		case eOFFLINE_TELEMETRY_DOUBLE:
+			sprintf(value_string, "%.3f", records[i].value.d);
+			break;
+		case eOFFLINE_TELEMETRY_UINT32:
+			sprintf(value_string, "%" PRIu32 "", records[i].value.u);
+			break;
+		default:
+			sprintf(value_string, "%" PRId32 "", records[i].value.i);
+			break;
+		}
+
+		observation_batch_add(batch, records[i].id, value_string, observed_at);
+	}
+
+	int message_id = publish_observations_tracked(batch);
+	if(message_id <= 0)
+		publish_iothub_remove_ack_queue(offlineTelemetryAcks);
+
+	return message_id;
+}
+
+int publish_offline_telemetry(){
+	recordingOffline = false;
+
+	struct offline_telemetry *store = get_offline_telemetry();
+	if(store == NULL)
+		return 0;
+
+	struct publish_ack ack;
+	while(xQueueReceive(offlineTelemetryAcks, &ack, 0) == pdTRUE)
+	{
+		if(offline_telemetry_acknowledge(store, ack.message_id, ack.published))
+			publish_iothub_remove_ack_queue(offlineTelemetryAcks);
+	}
+
+	/// Leave the event queue to current values
+	if(publish_iothub_queue_stats().queued > 0)
+		return 0;
+
+	return offline_telemetry_drain(store, (uint32_t)(esp_timer_get_time() / 1000), publish_offline_records, NULL);
+}
+
 
 void SendStacks()
 {
@@ -1307,15 +1604,37 @@ void SendStacks()
 }
 
 
+/*
+ * The binary telemetry format has no single observation message, so single observations are published as a
+ * collection of one when it is used.
+ */
 int publish_uint32_observation(int observationId, uint32_t value){
-    return publish_json(create_uint32_t_observation(observationId, value));
+    if(binaryTelemetry){
+        struct observation_batch *observations = create_observation_collection();
+        add_uint32_t_observation(observations, observationId, value);
+        return publish_observations_state(observations, observationId);
+    }
+
+    return publish_json_state(create_uint32_t_observation(observationId, value), observationId, false, 0);
 }
 
 int publish_double_observation(int observationId, double value){
-    return publish_json(create_double_observation(observationId, value));
+    if(binaryTelemetry){
+        struct observation_batch *observations = create_observation_collection();
+        add_double_observation(observations, observationId, value);
+        return publish_observations_state(observations, observationId);
+    }
+
+    return publish_json_state(create_double_observation(observationId, value), observationId, false, 0);
 }
 
 int publish_string_observation(int observationId, char *message){
+    if(binaryTelemetry){
+        struct observation_batch *observations = create_observation_collection();
+        add_observation(observations, observationId, message);
+        return publish_observations(observations);
+    }
+
     return publish_json(create_observation(observationId, message));
 }
 
@@ -1323,6 +1642,37 @@ int publish_string_observation_blocked(int observationId, char *message, int tim
     return publish_json_blocked(create_observation(observationId, message), timeout_ms);
 }
 
+int publish_string_observations_tracked(int observationId, const char * const *messages, size_t count){
+    if (disableObservations) {
+        ESP_LOGI(TAG, "Blocking observation during calibration!");
+        return 0;
+    }
+
+    struct observation_batch *observations = create_json_observation_collection();
+    if(observations == NULL)
+        return -2;
+
+    for(size_t i = 0; i < count; i++)
+        add_observation(observations, observationId, messages[i]);
+
+    size_t length;
+    const char *message = observation_batch_finish(observations, &length);
+
+    int message_id = -2;
+    if(message != NULL)
+        message_id = publish_iothub_event_tracked(message);
+
+    if(message_id > 0)
+    {
+    	mqttDiagnostics.mqttTxBytes += length;
+    	mqttDiagnostics.mqttTxBytesIncMeta += (length+112);
+    	mqttDiagnostics.nrOfTxMessages++;
+    }
+
+    observation_batch_free(observations);
+    return message_id;
+}
+
 int publish_diagnostics_observation(char *message){
     return publish_json(create_observation(808, message));
 }
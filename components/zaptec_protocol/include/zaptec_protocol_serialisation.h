@@ -61,6 +61,7 @@ typedef enum {
 	TransmitInterval = 145,
 	TransmitChangeLevel = 146,
 	PulseInterval = 147,
+	TelemetryEncoding = 148,
 	CommunicationMode  = 150,
 	PermanentCableLock = 151,
 	ProductCode = 152,
@@ -5,15 +5,18 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <inttypes.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "freertos/timers.h"
 
 #include "esp_http_client.h"
 #include "esp_crc.h"
 
 #include "diagnostics_log.h"
+#include "diagnostics_ring.h"
 #include "certificate.h"
 #include "zaptec_cloud_observations.h"
 #include "types/ocpp_date_time.h"
@@ -211,6 +214,7 @@ char char_from_esp_log_level(esp_log_level_t severity){
 	}
 }
 
+// Does not update the header in the file, as that is done once for each batch of entries
 static esp_err_t write_entry(FILE * fp, struct log_entry_info * entry_info, const char * entry, bool * should_truncate_out, off_t * truncate_length_out){
 
 #ifdef CONFIG_LOG_COLORS
@@ -343,16 +347,9 @@ static esp_err_t write_entry(FILE * fp, struct log_entry_info * entry_info, cons
 		*truncate_length_out = header.write_offset;
 	}
 
-	header_result = write_header(fp, &header);
-
-	if(header_result != ESP_OK)
-		is_header_valid = false;
-
-	return header_result;
+	return ESP_OK;
 }
 
-char * log_buffer = NULL;
-
 esp_err_t diagnostics_log_empty(){
 
 	esp_err_t err = ESP_FAIL;
@@ -387,32 +384,56 @@ error:
 	return err;
 }
 
-esp_err_t diagnostics_log_write(const char * fmt, va_list ap){
+/*
+ * Writes the entries queued by custom_log_function to file. Must be called with file_lock held.
+ *
+ * The header is written once after the entries, and the file is synced every 60 seconds. Returns ESP_ERR_NOT_FINISHED
+ * if writing stopped to truncate the file.
+ */
+static esp_err_t write_queued_entries(){
+	esp_err_t write_result = ESP_OK;
+	bool should_truncate = false;
+	off_t truncate_length;
+	long start_offset = header.write_offset;
 
-	if(log_buffer == NULL){
-		log_buffer = malloc(CONFIG_ZAPTEC_DIAGNOSTICS_LOG_ENTRY_SIZE);
+	uint32_t dropped = diagnostics_ring_take_dropped();
+	if(dropped > 0){
+		char dropped_entry[48];
 
-		if(log_buffer == NULL){
-			return ESP_ERR_NO_MEM;
-		}
+		struct log_entry_info entry_info = {
+			.timestamp = time(NULL),
+			.length = snprintf(dropped_entry, sizeof(dropped_entry), "W %" PRIu32 " log entries dropped", dropped)
+		};
+
+		write_result = write_entry(diagnostics_file, &entry_info, dropped_entry, &should_truncate, &truncate_length);
 	}
 
-	int written = vsnprintf(log_buffer, CONFIG_ZAPTEC_DIAGNOSTICS_LOG_ENTRY_SIZE, fmt, ap);
-	if(written >= CONFIG_ZAPTEC_DIAGNOSTICS_LOG_ENTRY_SIZE){
-		written = CONFIG_ZAPTEC_DIAGNOSTICS_LOG_ENTRY_SIZE-1;
+	const char * entry;
+	time_t timestamp;
+	size_t length;
+
+	while(write_result == ESP_OK && !should_truncate && (entry = diagnostics_ring_front(&timestamp, &length)) != NULL){
+		struct log_entry_info entry_info = {
+			.timestamp = timestamp,
+			.length = length
+		};
 
-	}else if(written < 0){
-		return ESP_FAIL;
+		write_result = write_entry(diagnostics_file, &entry_info, entry, &should_truncate, &truncate_length);
+		diagnostics_ring_pop(); // An entry that could not be written is dropped
 	}
 
-	struct log_entry_info entry_info = {
-		.timestamp = time(NULL),
-		.length = written
-	};
+	bool is_bad_file = (write_result == ESP_FAIL && errno == EBADF);
 
-	bool should_truncate = false;
-	off_t truncate_length;
-	esp_err_t write_result = write_entry(diagnostics_file, &entry_info, log_buffer, &should_truncate, &truncate_length);
+	// Entries below the log level are not written
+	if(is_header_valid && (header.write_offset != start_offset || should_truncate)){
+		esp_err_t header_result = write_header(diagnostics_file, &header);
+
+		if(header_result != ESP_OK){
+			is_header_valid = false;
+			if(write_result == ESP_OK)
+				write_result = header_result;
+		}
+	}
 
 	if(last_sync + 60 < time(NULL) && !should_truncate){
 		// We close the file routinely to make sure it is saved in case of reboot.
@@ -424,7 +445,7 @@ esp_err_t diagnostics_log_write(const char * fmt, va_list ap){
 		last_sync = time(NULL);
 	}
 
-	if(should_truncate || (write_result == ESP_FAIL && errno == EBADF)){ // We close the file to truncate or if filedes is invalid (file could point to dismounted file)
+	if(should_truncate || is_bad_file){ // We close the file to truncate or if filedes is invalid (file could point to dismounted file)
 		if(fclose(diagnostics_file) != 0)
 			printf("Failed to close file: %s\n", strerror(errno));
 
@@ -436,9 +457,30 @@ esp_err_t diagnostics_log_write(const char * fmt, va_list ap){
 		last_sync = time(NULL);
 	}
 
+	if(should_truncate && write_result == ESP_OK)
+		return ESP_ERR_NOT_FINISHED;
+
 	return write_result;
 }
 
+#define DIAGNOSTICS_LOG_FLUSH_INTERVAL_MS 1000
+
+static TaskHandle_t flush_task_handle = NULL;
+
+static void flush_task(void * arg){
+	while(true){
+		// Woken early by custom_log_function if the queue is half full
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DIAGNOSTICS_LOG_FLUSH_INTERVAL_MS));
+
+		if(xSemaphoreTake(file_lock, portMAX_DELAY) != pdTRUE)
+			continue;
+
+		while(diagnostics_file != NULL && write_queued_entries() == ESP_ERR_NOT_FINISHED);
+
+		xSemaphoreGive(file_lock);
+	}
+}
+
 cloud_event_level esp_log_level_to_event_level(esp_err_t  level){
 	if(level == ESP_LOG_ERROR){
 		return cloud_event_level_error;
@@ -959,23 +1001,55 @@ error:
 
 static vprintf_like_t default_esp_log = NULL;
 
+/*
+ * Checks the severity letter at the start of ESP_LOG formats, optionally after a color sequence, so that entries that
+ * write_entry would skip are not formatted. Other formats are not skipped.
+ */
+static bool is_skipped_format(const char * fmt){
+#ifdef CONFIG_LOG_COLORS
+	if(strncmp(fmt, "\033[", 2) == 0){
+		for(size_t i = 3; i <= 6 && fmt[i] != '\0'; i++){
+			if(fmt[i] == 'm'){
+				fmt = fmt + i + 1;
+				break;
+			}
+		}
+	}
+#endif /*CONFIG_LOG_COLORS*/
+
+	if(fmt[0] == '\0' || strchr("EWIDV", fmt[0]) == NULL || fmt[1] != ' ' || fmt[2] != '(')
+		return false;
+
+	return esp_log_level_from_char(fmt[0]) > CONFIG_ZAPTEC_DIAGNOSTICS_LOG_LEVEL;
+}
+
+/*
+ * Called by the logging task. The entry is formatted into a lock-free queue and written to file by flush_task, so this
+ * does not block on the file or on other logging tasks.
+ */
 int custom_log_function(const char * fmt, va_list ap){
-	if(default_esp_log != NULL)
-		default_esp_log(fmt, ap);
+	if(default_esp_log != NULL){
+		va_list console_ap;
+		va_copy(console_ap, ap);
+		default_esp_log(fmt, console_ap);
+		va_end(console_ap);
+	}
 
 	if(!filesystem_is_ready()){
 		return ESP_ERR_INVALID_STATE;
 	}
 
-	if(xSemaphoreTake(file_lock, 0) != pdTRUE){
-		return ESP_ERR_TIMEOUT;
-	}
+	if(is_skipped_format(fmt))
+		return 0;
 
-	/* esp_err_t err =  */diagnostics_log_write(fmt, ap);
-	/* if(err != ESP_OK) */
-	/* 	printf("log error: %s\n", esp_err_to_name(err)); */
+	bool half_full;
+	esp_err_t err = diagnostics_ring_vprintf(&half_full, fmt, ap);
+	if(err != ESP_OK)
+		return err;
+
+	if(half_full)
+		xTaskNotifyGive(flush_task_handle);
 
-	xSemaphoreGive(file_lock);
 	return 0;
 }
 
@@ -1054,6 +1128,15 @@ esp_err_t diagnostics_log_init(){
 		last_sync = time(NULL);
 	}
 
+	if(ret == ESP_OK && flush_task_handle == NULL){
+		diagnostics_ring_init();
+
+		if(xTaskCreate(flush_task, "diagnostics_log", 3072, NULL, tskIDLE_PRIORITY + 1, &flush_task_handle) != pdPASS){
+			flush_task_handle = NULL;
+			ret = ESP_ERR_NO_MEM;
+		}
+	}
+
 	if(ret == ESP_OK && default_esp_log == NULL){
 		default_esp_log = esp_log_set_vprintf(custom_log_function);
 	}
@@ -1071,18 +1154,21 @@ esp_err_t diagnostics_log_deinit(){
 	if(xSemaphoreTake(file_lock, pdMS_TO_TICKS(2500)) != pdTRUE)
 		return ESP_ERR_TIMEOUT;
 
-	fclose(diagnostics_file);
+	if(default_esp_log != NULL)
+		esp_log_set_vprintf(default_esp_log);
+
+	default_esp_log = NULL;
+
+	while(diagnostics_file != NULL && write_queued_entries() == ESP_ERR_NOT_FINISHED);
+
+	if(diagnostics_file != NULL)
+		fclose(diagnostics_file);
 	diagnostics_file = NULL;
 
 	free(entry_content);
 	entry_content = NULL;
 	is_header_valid = false;
 
-	if(default_esp_log != NULL)
-		esp_log_set_vprintf(default_esp_log);
-
-	default_esp_log = NULL;
-
 	xSemaphoreGive(file_lock); // We do not Delete the semaphore as it would require us to guarantee that no tasks are blocking on it.
 
 	return ESP_OK;
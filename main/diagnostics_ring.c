@@ -0,0 +1,182 @@
+#include "diagnostics_ring.h"
+#ifdef CONFIG_ZAPTEC_DIAGNOSTICS_LOG
+
+#include <stdatomic.h>
+#include <stdio.h>
+
+/*
+ * The queue is an array of slots, each with a sequence number as in Dmitry Vyukov's bounded MPMC queue. An entry uses
+ * as many consecutive slots as it needs, with a header in the first. A slot at position p is free when its sequence is
+ * p and holds a complete entry when its sequence is p + 1. Only the first slot of an entry is marked complete.
+ *
+ * A task reserves slots for the longest entry by moving head past them with a compare and swap, formats the entry into
+ * them and then marks the first slot complete. The entry is formatted once, so its length is not known until then. If
+ * no other task has reserved slots since, the unused slots are given back by moving head back to the end of the entry,
+ * else they are kept with the entry and freed with it. The reader frees the slots of an entry in order by setting their
+ * sequence to the position they get on the next round, so the last slot being free means that all slots before it are
+ * free.
+ *
+ * Entries do not wrap around the end of the array. If an entry does not fit before the end, the remaining slots are
+ * reserved with it and marked as padding.
+ */
+
+#define SLOT_SIZE 64
+#define SLOT_COUNT (CONFIG_ZAPTEC_DIAGNOSTICS_LOG_QUEUE_SIZE / SLOT_SIZE)
+#define SLOT_MASK (SLOT_COUNT - 1)
+
+_Static_assert(SLOT_COUNT >= 4 && (SLOT_COUNT & SLOT_MASK) == 0, "Diagnostics log queue size must be a power of two");
+
+#define PADDING_LENGTH UINT16_MAX
+
+struct entry_header{
+	time_t timestamp;
+	uint16_t length; // Excluding null terminator, or PADDING_LENGTH
+	uint16_t slots;
+};
+
+/*
+ * An entry and its padding may not use more than half the slots, else the padding could overlap the entry. Padding is
+ * shorter than the entry it precedes.
+ */
+#define MAX_SLOTS_SIZE (SLOT_COUNT / 2 * SLOT_SIZE - sizeof(struct entry_header))
+#define MAX_ENTRY_SIZE (int)(CONFIG_ZAPTEC_DIAGNOSTICS_LOG_ENTRY_SIZE < MAX_SLOTS_SIZE ? CONFIG_ZAPTEC_DIAGNOSTICS_LOG_ENTRY_SIZE : MAX_SLOTS_SIZE)
+#define MAX_ENTRY_SLOTS ((sizeof(struct entry_header) + MAX_ENTRY_SIZE + SLOT_SIZE - 1) / SLOT_SIZE)
+
+static _Alignas(struct entry_header) uint8_t slots[SLOT_COUNT * SLOT_SIZE];
+static atomic_uint sequences[SLOT_COUNT];
+
+static atomic_uint head;
+static atomic_uint tail;
+static atomic_uint dropped;
+
+void diagnostics_ring_init(void){
+	for(unsigned int i = 0; i < SLOT_COUNT; i++)
+		atomic_init(&sequences[i], i);
+
+	atomic_init(&head, 0);
+	atomic_init(&tail, 0);
+	atomic_init(&dropped, 0);
+}
+
+static struct entry_header * header_at(unsigned int position){
+	return (struct entry_header *)&slots[(position & SLOT_MASK) * SLOT_SIZE];
+}
+
+esp_err_t diagnostics_ring_vprintf(bool * half_full_out, const char * fmt, va_list ap){
+	*half_full_out = false;
+
+	unsigned int slot_count = MAX_ENTRY_SLOTS;
+
+	unsigned int position = atomic_load_explicit(&head, memory_order_relaxed);
+	unsigned int padding;
+	unsigned int last;
+
+	while(true){
+		unsigned int index = position & SLOT_MASK;
+		padding = (index + slot_count > SLOT_COUNT) ? SLOT_COUNT - index : 0;
+		last = position + padding + slot_count - 1;
+
+		unsigned int sequence = atomic_load_explicit(&sequences[last & SLOT_MASK], memory_order_acquire);
+		int difference = (int)(sequence - last);
+
+		if(difference == 0){
+			if(atomic_compare_exchange_weak_explicit(&head, &position, last + 1, memory_order_relaxed, memory_order_relaxed))
+				break;
+
+		}else if(difference < 0){
+			// The slot is still used by an entry of the previous round, unless another task reserved it since position was read
+			unsigned int current = atomic_load_explicit(&head, memory_order_relaxed);
+			if(current == position){
+				atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+				return ESP_ERR_NO_MEM;
+			}
+			position = current;
+
+		}else{
+			position = atomic_load_explicit(&head, memory_order_relaxed);
+		}
+	}
+
+	if(padding > 0){
+		struct entry_header * padding_header = header_at(position);
+		padding_header->length = PADDING_LENGTH;
+		padding_header->slots = padding;
+		atomic_store_explicit(&sequences[position & SLOT_MASK], position + 1, memory_order_release);
+
+		position += padding;
+	}
+
+	struct entry_header * header = header_at(position);
+	char * entry = (char *)(header + 1);
+
+	int length = vsnprintf(entry, MAX_ENTRY_SIZE, fmt, ap);
+	if(length > MAX_ENTRY_SIZE - 1)
+		length = MAX_ENTRY_SIZE - 1;
+
+	unsigned int used_count = (length < 0) ? 1 : (sizeof(struct entry_header) + length + 1 + SLOT_SIZE - 1) / SLOT_SIZE;
+
+	// The unused slots are still free, so they can be given back unless head has moved past them
+	unsigned int end = last + 1;
+	if(used_count < slot_count){
+		unsigned int expected = end;
+		if(atomic_compare_exchange_strong_explicit(&head, &expected, position + used_count,
+				memory_order_relaxed, memory_order_relaxed)){
+			slot_count = used_count;
+			end = position + used_count;
+		}
+	}
+
+	header->timestamp = time(NULL);
+	header->length = (length < 0) ? PADDING_LENGTH : length;
+	header->slots = slot_count;
+	atomic_store_explicit(&sequences[position & SLOT_MASK], position + 1, memory_order_release);
+
+	if(length < 0)
+		return ESP_FAIL;
+
+	*half_full_out = (end - atomic_load_explicit(&tail, memory_order_relaxed)) >= SLOT_COUNT / 2;
+
+	return ESP_OK;
+}
+
+static void free_slots(unsigned int position, unsigned int count){
+	for(unsigned int i = 0; i < count; i++)
+		atomic_store_explicit(&sequences[(position + i) & SLOT_MASK], position + i + SLOT_COUNT, memory_order_release);
+
+	atomic_store_explicit(&tail, position + count, memory_order_relaxed);
+}
+
+const char * diagnostics_ring_front(time_t * timestamp_out, size_t * length_out){
+	while(true){
+		unsigned int position = atomic_load_explicit(&tail, memory_order_relaxed);
+
+		if(atomic_load_explicit(&sequences[position & SLOT_MASK], memory_order_acquire) != position + 1)
+			return NULL;
+
+		struct entry_header * header = header_at(position);
+		if(header->length == PADDING_LENGTH){
+			free_slots(position, header->slots);
+			continue;
+		}
+
+		*timestamp_out = header->timestamp;
+		*length_out = header->length;
+
+		return (const char *)(header + 1);
+	}
+}
+
+void diagnostics_ring_pop(void){
+	unsigned int position = atomic_load_explicit(&tail, memory_order_relaxed);
+
+	if(atomic_load_explicit(&sequences[position & SLOT_MASK], memory_order_acquire) != position + 1)
+		return;
+
+	free_slots(position, header_at(position)->slots);
+}
+
+uint32_t diagnostics_ring_take_dropped(void){
+	return atomic_exchange_explicit(&dropped, 0, memory_order_relaxed);
+}
+
+#endif /* CONFIG_ZAPTEC_DIAGNOSTICS_LOG */
@@ -0,0 +1,62 @@
+#ifndef DIAGNOSTICS_RING_H
+#define DIAGNOSTICS_RING_H
+
+/** @file
+ * @brief Lock-free queue of formatted log entries between the logging tasks and the diagnostics log file.
+ *
+ * Any number of tasks may add entries with diagnostics_ring_vprintf. They never block: an entry that does not fit is
+ * counted as dropped. A single task reads the entries in the order they were reserved with diagnostics_ring_front and
+ * diagnostics_ring_pop.
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+/**
+ * @brief Resets the queue. Must be called once before the first entry is added.
+ */
+void diagnostics_ring_init(void);
+
+/**
+ * @brief Formats an entry into the queue.
+ *
+ * Entries are truncated to CONFIG_ZAPTEC_DIAGNOSTICS_LOG_ENTRY_SIZE or half the queue size. Space for the longest entry
+ * must be free while the entry is formatted, else it is dropped.
+ *
+ * @param half_full_out set to true if the queue is at least half full after the entry is added.
+ *
+ * @return ESP_OK if added, ESP_ERR_NO_MEM if the queue is full and the entry was dropped or ESP_FAIL if formatting
+ * failed.
+ */
+esp_err_t diagnostics_ring_vprintf(bool * half_full_out, const char * fmt, va_list ap);
+
+/**
+ * @brief Gets the oldest entry without removing it. May only be called by the reading task.
+ *
+ * An entry is not available until the task that added it is done formatting it, so entries added later by other tasks
+ * wait for it.
+ *
+ * @param timestamp_out time the entry was added.
+ * @param length_out length of the entry, excluding the null terminator.
+ *
+ * @return the null terminated entry, or NULL if there are no entries available.
+ */
+const char * diagnostics_ring_front(time_t * timestamp_out, size_t * length_out);
+
+/**
+ * @brief Removes the entry returned by diagnostics_ring_front.
+ */
+void diagnostics_ring_pop(void);
+
+/**
+ * @brief Gets the number of entries dropped since the last call and resets it.
+ */
+uint32_t diagnostics_ring_take_dropped(void);
+
+#endif /* DIAGNOSTICS_RING_H */
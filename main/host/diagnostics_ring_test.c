@@ -0,0 +1,460 @@
+/*
+ * Tests main/diagnostics_ring.c with many producer threads logging at once and one reader thread draining the queue like
+ * flush_task in diagnostics_log.c, and measures the time each log call takes.
+ *
+ * Each entry holds its producer and sequence number and a padding of varying length, so that entries use several slots
+ * and some are padded at the end of the queue. The reader checks that the entries of each producer arrive in order and
+ * intact, and that every entry is either read or counted as dropped. Latency is reported for the calls that added an
+ * entry, together with the number of calls that dropped theirs, since a dropped call returns early.
+ *
+ * For comparison, the same producers log as custom_log_function did before: formatting into a shared buffer and writing
+ * to a file while holding a lock, and dropping entries when the lock is taken.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "diagnostics_ring.h"
+
+#define MAX_PRODUCERS 64
+#define MAX_PADDING 300
+#define BASELINE_PATH "/dev/shm/diagnostics_ring_test.bin"
+
+static char padding[MAX_PADDING + 1];
+
+static int producer_count = 8;
+static uint32_t entry_count = 100000;
+static uint32_t flush_interval_us = 1000;
+static uint32_t pause_us; ///< Time each producer waits between entries
+
+static sem_t flush_wake;
+static atomic_int producers_done;
+
+struct producer{
+	pthread_t thread;
+	int id;
+	uint32_t * latency_ns; ///< Of the calls that added an entry
+	uint32_t added;
+	uint32_t dropped;
+	uint32_t half_full;
+};
+
+static struct producer producers[MAX_PRODUCERS];
+
+/* State of the comparison, which mimics custom_log_function before the queue */
+static bool use_baseline;
+static pthread_mutex_t baseline_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE * baseline_file;
+static char baseline_buffer[CONFIG_ZAPTEC_DIAGNOSTICS_LOG_ENTRY_SIZE];
+static long baseline_offset;
+
+static uint64_t now_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static bool baseline_vprintf(const char * fmt, va_list ap){
+	if(pthread_mutex_trylock(&baseline_lock) != 0)
+		return false;
+
+	int written = vsnprintf(baseline_buffer, sizeof(baseline_buffer), fmt, ap);
+	if(written >= (int)sizeof(baseline_buffer))
+		written = sizeof(baseline_buffer) - 1;
+
+	/* Entry info, entry and crc, then the header */
+	if(baseline_offset + written + 32 > 16384)
+		baseline_offset = 16;
+
+	uint32_t info[4] = {0, written, 0, 0};
+	fseek(baseline_file, baseline_offset, SEEK_SET);
+	fwrite(info, sizeof(info), 1, baseline_file);
+	fwrite(baseline_buffer, written, 1, baseline_file);
+	fwrite(info, sizeof(uint32_t), 1, baseline_file);
+	baseline_offset = ftell(baseline_file);
+
+	fseek(baseline_file, 0, SEEK_SET);
+	fwrite(info, 16, 1, baseline_file);
+
+	pthread_mutex_unlock(&baseline_lock);
+	return true;
+}
+
+static bool log_entry(struct producer * producer, const char * fmt, ...){
+	va_list ap;
+	va_start(ap, fmt);
+
+	bool added;
+	if(use_baseline){
+		added = baseline_vprintf(fmt, ap);
+	}else{
+		bool half_full;
+		added = diagnostics_ring_vprintf(&half_full, fmt, ap) == ESP_OK;
+		if(added && half_full){
+			producer->half_full++;
+			sem_post(&flush_wake);
+		}
+	}
+
+	va_end(ap);
+	return added;
+}
+
+static void * producer_thread(void * arg){
+	struct producer * producer = arg;
+
+	for(uint32_t i = 0; i < entry_count; i++){
+		int padding_length = (i * 37 + producer->id * 11) % MAX_PADDING;
+
+		uint64_t start = now_ns();
+		bool added = log_entry(producer, "W (%" PRIu32 ") TEST: %d %" PRIu32 " %.*s", i, producer->id, i, padding_length,
+			padding);
+		uint64_t duration = now_ns() - start;
+
+		if(added){
+			producer->latency_ns[producer->added++] = duration > UINT32_MAX ? UINT32_MAX : duration;
+		}else{
+			producer->dropped++;
+		}
+
+		if(pause_us > 0)
+			usleep(pause_us);
+	}
+
+	atomic_fetch_add(&producers_done, 1);
+	sem_post(&flush_wake);
+	return NULL;
+}
+
+struct reader_result{
+	uint64_t read;
+	uint64_t dropped;
+	uint64_t batches;
+	uint32_t max_batch;
+	int failures;
+};
+
+/* Checks an entry written by producer_thread. Sequence numbers of a producer must increase. */
+static int check_entry(const char * entry, size_t length, int64_t * last_sequence){
+	unsigned int id;
+	uint32_t sequence;
+	uint32_t prefix_sequence;
+	int prefix_length;
+
+	if(sscanf(entry, "W (%" SCNu32 ") TEST: %u %" SCNu32 " %n", &prefix_sequence, &id, &sequence, &prefix_length) != 3
+		|| id >= (unsigned int)producer_count || prefix_sequence != sequence){
+		fprintf(stderr, "FAIL: unexpected entry '%.*s'\n", (int)length, entry);
+		return 1;
+	}
+
+	int padding_length = (sequence * 37 + id * 11) % MAX_PADDING;
+	if(strlen(entry) != length || length != (size_t)prefix_length + padding_length
+		|| memcmp(entry + prefix_length, padding, padding_length) != 0){
+		fprintf(stderr, "FAIL: entry %u %" PRIu32 " corrupt, length %zu\n", id, sequence, length);
+		return 1;
+	}
+
+	if((int64_t)sequence <= last_sequence[id]){
+		fprintf(stderr, "FAIL: entry %u %" PRIu32 " after %" PRId64 "\n", id, sequence, last_sequence[id]);
+		return 1;
+	}
+
+	last_sequence[id] = sequence;
+	return 0;
+}
+
+/* Drains the queue every flush interval, or when woken by a producer, like flush_task */
+static void * reader_thread(void * arg){
+	struct reader_result * result = arg;
+	int64_t last_sequence[MAX_PRODUCERS];
+
+	for(int i = 0; i < MAX_PRODUCERS; i++)
+		last_sequence[i] = -1;
+
+	while(true){
+		bool done = atomic_load(&producers_done) == producer_count;
+
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += flush_interval_us * 1000;
+		deadline.tv_sec += deadline.tv_nsec / 1000000000;
+		deadline.tv_nsec %= 1000000000;
+
+		if(!done)
+			while(sem_timedwait(&flush_wake, &deadline) != 0 && errno == EINTR);
+
+		result->dropped += diagnostics_ring_take_dropped();
+
+		const char * entry;
+		time_t timestamp;
+		size_t length;
+		uint32_t batch = 0;
+
+		while((entry = diagnostics_ring_front(&timestamp, &length)) != NULL){
+			if(result->failures < 10)
+				result->failures += check_entry(entry, length, last_sequence);
+
+			diagnostics_ring_pop();
+			batch++;
+		}
+
+		if(batch > 0){
+			result->batches++;
+			result->read += batch;
+			if(batch > result->max_batch)
+				result->max_batch = batch;
+		}
+
+		if(done)
+			break;
+	}
+
+	result->dropped += diagnostics_ring_take_dropped();
+	return NULL;
+}
+
+static int compare_latency(const void * a, const void * b){
+	uint32_t latency_a = *(const uint32_t *)a;
+	uint32_t latency_b = *(const uint32_t *)b;
+
+	return (latency_a > latency_b) - (latency_a < latency_b);
+}
+
+static void print_latency(const char * name){
+	size_t calls = (size_t)producer_count * entry_count;
+	size_t total = 0;
+	uint32_t * all = malloc(calls * sizeof(uint32_t));
+	double sum = 0;
+
+	for(int p = 0; p < producer_count; p++){
+		memcpy(all + total, producers[p].latency_ns, producers[p].added * sizeof(uint32_t));
+		total += producers[p].added;
+	}
+
+	printf("%s: %d producers, %zu calls, %zu dropped (%.1f%%)", name, producer_count, calls, calls - total,
+		100.0 * (calls - total) / calls);
+
+	if(total > 0){
+		for(size_t i = 0; i < total; i++)
+			sum += all[i];
+
+		qsort(all, total, sizeof(uint32_t), compare_latency);
+
+		printf(", latency of added mean %.0f ns, p50 %" PRIu32 " ns, p99 %" PRIu32 " ns, p99.9 %" PRIu32 " ns, "
+			"max %" PRIu32 " ns", sum / total, all[total / 2], all[total * 99 / 100], all[total * 999 / 1000],
+			all[total - 1]);
+	}
+
+	printf("\n");
+	free(all);
+}
+
+static void run_producers(void){
+	atomic_store(&producers_done, 0);
+
+	for(int p = 0; p < producer_count; p++){
+		producers[p].id = p;
+		producers[p].added = 0;
+		producers[p].dropped = 0;
+		producers[p].half_full = 0;
+		pthread_create(&producers[p].thread, NULL, producer_thread, &producers[p]);
+	}
+
+	for(int p = 0; p < producer_count; p++)
+		pthread_join(producers[p].thread, NULL);
+}
+
+static int check_concurrent(void){
+	int failures = 0;
+	struct reader_result result = {0};
+	pthread_t reader;
+
+	diagnostics_ring_init();
+	sem_init(&flush_wake, 0, 0);
+
+	use_baseline = false;
+	pthread_create(&reader, NULL, reader_thread, &result);
+	run_producers();
+	pthread_join(reader, NULL);
+
+	uint64_t total = (uint64_t)producer_count * entry_count;
+	uint32_t half_full = 0;
+	uint64_t dropped = 0;
+	for(int p = 0; p < producer_count; p++){
+		half_full += producers[p].half_full;
+		dropped += producers[p].dropped;
+	}
+
+	printf("queue of %d bytes, flush every %" PRIu32 " us: %" PRIu64 " read in %" PRIu64 " batches (max %" PRIu32 "), "
+		"%" PRIu64 " dropped, %" PRIu32 " early wakeups\n", CONFIG_ZAPTEC_DIAGNOSTICS_LOG_QUEUE_SIZE, flush_interval_us,
+		result.read, result.batches, result.max_batch, result.dropped, half_full);
+	print_latency("queue");
+
+	failures += result.failures;
+	if(result.read + result.dropped != total || result.dropped != dropped){
+		fprintf(stderr, "FAIL: %" PRIu64 " read and %" PRIu64 " dropped of %" PRIu64 ", %" PRIu64 " calls failed\n",
+			result.read, result.dropped, total, dropped);
+		failures++;
+	}
+
+	sem_destroy(&flush_wake);
+	return failures;
+}
+
+static void ring_printf(bool * half_full, esp_err_t * result, const char * fmt, ...){
+	va_list ap;
+	va_start(ap, fmt);
+	*result = diagnostics_ring_vprintf(half_full, fmt, ap);
+	va_end(ap);
+}
+
+/* Without a reader the queue fills and further entries are dropped, and long entries are truncated */
+static int check_full(void){
+	int failures = 0;
+	bool half_full = false;
+	esp_err_t result = ESP_OK;
+	uint32_t added = 0;
+	uint32_t half_full_at = 0;
+
+	diagnostics_ring_init();
+
+	while(true){
+		ring_printf(&half_full, &result, "E (%" PRIu32 ") FULL: %.*s", added, 100, padding);
+		if(result != ESP_OK)
+			break;
+
+		added++;
+		if(half_full && half_full_at == 0)
+			half_full_at = added;
+	}
+
+	ring_printf(&half_full, &result, "E (%" PRIu32 ") FULL: %.*s", added, 100, padding);
+	if(result != ESP_ERR_NO_MEM || diagnostics_ring_take_dropped() != 2 || diagnostics_ring_take_dropped() != 0){
+		fprintf(stderr, "FAIL: full queue, result %d\n", result);
+		failures++;
+	}
+
+	/* Each entry takes more than 100 and less than 256 bytes of the queue. The queue is full while less than
+	 * CONFIG_ZAPTEC_DIAGNOSTICS_LOG_ENTRY_SIZE is free, so a small queue may be full as soon as it is half full. */
+	if(half_full_at == 0 || half_full_at > CONFIG_ZAPTEC_DIAGNOSTICS_LOG_QUEUE_SIZE / 2 / 100 + 1
+		|| half_full_at < CONFIG_ZAPTEC_DIAGNOSTICS_LOG_QUEUE_SIZE / 2 / 256){
+		fprintf(stderr, "FAIL: half full after %" PRIu32 " of %" PRIu32 " entries\n", half_full_at, added);
+		failures++;
+	}
+
+	const char * entry;
+	time_t timestamp;
+	size_t length;
+	uint32_t read = 0;
+
+	while((entry = diagnostics_ring_front(&timestamp, &length)) != NULL){
+		uint32_t number;
+		if(sscanf(entry, "E (%" SCNu32 ") FULL:", &number) != 1 || number != read){
+			fprintf(stderr, "FAIL: full queue, entry %" PRIu32 " is '%s'\n", read, entry);
+			failures++;
+			break;
+		}
+
+		diagnostics_ring_pop();
+		read++;
+	}
+
+	if(read != added){
+		fprintf(stderr, "FAIL: full queue, %" PRIu32 " of %" PRIu32 " entries read\n", read, added);
+		failures++;
+	}
+
+	char * long_entry = malloc(CONFIG_ZAPTEC_DIAGNOSTICS_LOG_QUEUE_SIZE * 2);
+	memset(long_entry, 'x', CONFIG_ZAPTEC_DIAGNOSTICS_LOG_QUEUE_SIZE * 2 - 1);
+	long_entry[CONFIG_ZAPTEC_DIAGNOSTICS_LOG_QUEUE_SIZE * 2 - 1] = '\0';
+
+	/* Starts mid queue so that the entries are padded */
+	for(int i = 0; i < 4; i++){
+		ring_printf(&half_full, &result, "%s", long_entry);
+		entry = diagnostics_ring_front(&timestamp, &length);
+
+		if(result != ESP_OK || entry == NULL || length >= CONFIG_ZAPTEC_DIAGNOSTICS_LOG_QUEUE_SIZE / 2
+			|| length >= CONFIG_ZAPTEC_DIAGNOSTICS_LOG_ENTRY_SIZE || strlen(entry) != length
+			|| strncmp(entry, long_entry, length) != 0){
+			fprintf(stderr, "FAIL: long entry %d, result %d, length %zu\n", i, result, length);
+			failures++;
+			break;
+		}
+
+		diagnostics_ring_pop();
+	}
+
+	free(long_entry);
+	return failures;
+}
+
+int main(int argc, char ** argv){
+	int opt;
+	while((opt = getopt(argc, argv, "p:n:i:s:")) != -1){
+		switch(opt){
+		case 'p':
+			producer_count = atoi(optarg);
+			break;
+		case 'n':
+			entry_count = strtoul(optarg, NULL, 10);
+			break;
+		case 'i':
+			flush_interval_us = strtoul(optarg, NULL, 10);
+			break;
+		case 's':
+			pause_us = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-p producers] [-n entries per producer] [-i flush interval us] "
+				"[-s pause between entries us]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if(producer_count < 1 || producer_count > MAX_PRODUCERS || entry_count < 1){
+		fprintf(stderr, "Invalid arguments\n");
+		return 1;
+	}
+
+	for(int i = 0; i < MAX_PADDING; i++)
+		padding[i] = 'a' + i % 26;
+
+	for(int p = 0; p < producer_count; p++)
+		producers[p].latency_ns = malloc(entry_count * sizeof(uint32_t));
+
+	int failures = check_full();
+	failures += check_concurrent();
+
+	baseline_file = fopen(BASELINE_PATH, "wb+");
+	if(baseline_file == NULL){
+		fprintf(stderr, "FAIL: unable to open " BASELINE_PATH "\n");
+		failures++;
+	}else{
+		use_baseline = true;
+		baseline_offset = 16;
+		run_producers();
+		print_latency("locked file write, dropped while the lock was taken");
+
+		fclose(baseline_file);
+		remove(BASELINE_PATH);
+	}
+
+	for(int p = 0; p < producer_count; p++)
+		free(producers[p].latency_ns);
+
+	if(failures != 0){
+		printf("%d failures\n", failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,352 @@
+/*
+ * Tests main/offline_log.c on a file in /dev/shm with a stubbed publisher, and measures the time and flash writes to
+ * drain a full log.
+ *
+ * The stub broker acknowledges each message after a round trip with some jitter, so acks may arrive out of order. The
+ * OCMF message of a line only contains its MID position, which lets the test check that every logged line is
+ * published. Flash writes are counted by wrapping fwrite: the header is the only 12 byte write.
+ *
+ * Build with CONFIG_ZAPTEC_OFFLINE_LOG_BATCH and CONFIG_ZAPTEC_OFFLINE_LOG_IN_FLIGHT set to 1 to measure publishing
+ * one line per message as before.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <getopt.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+
+#include "offline_log.h"
+#include "zaptec_cloud_listener.h"
+
+#define LOG_PATH CONFIG_ZAPTEC_OFFLINE_LOG_MOUNT_POINT "/log64.bin"
+#define MAX_LINES 999 /* OFFLINE_LOG_MAX_ITEMS - 1 */
+#define HEADER_SIZE 12
+#define LINE_SIZE 8
+#define MAX_PENDING 64
+#define MAX_POSITION 100000
+
+struct pending_ack{
+	int message_id;
+	TickType_t due;
+	bool published;
+};
+
+static pthread_mutex_t broker_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct pending_ack pending[MAX_PENDING];
+static size_t pending_count;
+static QueueHandle_t registered_queue;
+
+static uint32_t round_trip_ms = 20;
+static unsigned int seed = 1;
+
+static int next_message_id = 1;
+static uint32_t messages;
+static uint32_t published_lines;
+static uint32_t max_in_flight;
+
+/* Faults injected by the checks. Message numbers count from 1 from the start of the check. */
+static int fail_publish_at;
+static int drop_ack_at;
+static int delete_ack_at;
+
+static uint16_t publish_count[MAX_POSITION];
+
+static uint32_t header_writes;
+static uint32_t line_writes;
+
+size_t __real_fwrite(const void * data, size_t size, size_t count, FILE * stream);
+
+size_t __wrap_fwrite(const void * data, size_t size, size_t count, FILE * stream){
+	if(stream != stdout && stream != stderr){
+		if(size * count == HEADER_SIZE){
+			header_writes++;
+		}else{
+			line_writes++;
+		}
+	}
+
+	return __real_fwrite(data, size, count, stream);
+}
+
+int OCMF_SignedMeterValue_CreateMessageFromMID(char * buf, size_t buf_size, uint32_t mid_id, bool include_event_log){
+	snprintf(buf, buf_size, "OCMF|{\"FV\":\"1.0\",\"GI\":\"ZAPTEC GO\",\"PG\":\"F%" PRIu32 "\"}", mid_id);
+	return 0;
+}
+
+int publish_iothub_add_ack_queue(QueueHandle_t queue){
+	registered_queue = queue;
+	return 0;
+}
+
+void publish_iothub_remove_ack_queue(QueueHandle_t queue){
+	if(registered_queue == queue)
+		registered_queue = NULL;
+}
+
+int publish_string_observations_tracked(int observationId, const char * const * messages_in, size_t count){
+	pthread_mutex_lock(&broker_lock);
+
+	int number = ++messages;
+	if(number == fail_publish_at || pending_count == MAX_PENDING){
+		pthread_mutex_unlock(&broker_lock);
+		return -2;
+	}
+
+	for(size_t i = 0; i < count; i++){
+		uint32_t position;
+		if(sscanf(messages_in[i], "OCMF|{\"FV\":\"1.0\",\"GI\":\"ZAPTEC GO\",\"PG\":\"F%" SCNu32 "\"}", &position) == 1
+			&& position < MAX_POSITION)
+			publish_count[position]++;
+	}
+
+	published_lines += count;
+
+	int message_id = next_message_id++;
+	if(number != drop_ack_at){
+		uint32_t jitter = round_trip_ms / 2 + rand_r(&seed) % (round_trip_ms + 1);
+		pending[pending_count++] = (struct pending_ack){
+			.message_id = message_id,
+			.due = xTaskGetTickCount() + pdMS_TO_TICKS(jitter),
+			.published = (number != delete_ack_at),
+		};
+	}
+
+	if(pending_count > max_in_flight)
+		max_in_flight = pending_count;
+
+	pthread_mutex_unlock(&broker_lock);
+	return message_id;
+}
+
+/* Acknowledges messages when their round trip is over, as MQTT_EVENT_PUBLISHED in cloud_listener.c */
+static void broker_task(void * arg){
+	while(true){
+		vTaskDelay(1);
+
+		pthread_mutex_lock(&broker_lock);
+		TickType_t now = xTaskGetTickCount();
+
+		for(size_t i = 0; i < pending_count;){
+			if((int32_t)(now - pending[i].due) < 0){
+				i++;
+				continue;
+			}
+
+			struct publish_ack ack = {.message_id = pending[i].message_id, .published = pending[i].published};
+			if(registered_queue != NULL)
+				xQueueSend(registered_queue, &ack, 0);
+
+			pending[i] = pending[--pending_count];
+		}
+
+		pthread_mutex_unlock(&broker_lock);
+	}
+}
+
+static void reset_counters(void){
+	pthread_mutex_lock(&broker_lock);
+	messages = 0;
+	published_lines = 0;
+	max_in_flight = 0;
+	fail_publish_at = 0;
+	drop_ack_at = 0;
+	delete_ack_at = 0;
+	memset(publish_count, 0, sizeof(publish_count));
+	pthread_mutex_unlock(&broker_lock);
+
+	header_writes = 0;
+	line_writes = 0;
+}
+
+/* Waits for acks of messages from an aborted drain, so they do not arrive during the next check */
+static void wait_for_broker(void){
+	vTaskDelay(pdMS_TO_TICKS(round_trip_ms * 2 + 10));
+}
+
+static void append(uint32_t first, uint32_t count){
+	for(uint32_t position = first; position < first + count; position++)
+		offline_log_append_energy(position);
+}
+
+/* Checks that positions first to first + count - 1 were published at least once and at most max_times */
+static int check_published(const char * name, uint32_t first, uint32_t count, uint16_t max_times){
+	for(uint32_t position = first; position < first + count; position++){
+		if(publish_count[position] == 0 || publish_count[position] > max_times){
+			fprintf(stderr, "FAIL: %s, line %" PRIu32 " published %u times\n", name, position, publish_count[position]);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static double elapsed_ms(TickType_t start){
+	return (double)(xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+}
+
+static int check_full_log(void){
+	int failures = 0;
+
+	offline_log_delete();
+	reset_counters();
+
+	append(0, MAX_LINES);
+	uint32_t append_writes = header_writes + line_writes;
+
+	reset_counters();
+	TickType_t start = xTaskGetTickCount();
+	int result = offline_log_attempt_send();
+	double duration = elapsed_ms(start);
+
+	if(result != 0 || published_lines != MAX_LINES){
+		fprintf(stderr, "FAIL: full log, result %d, %" PRIu32 " lines published\n", result, published_lines);
+		failures++;
+	}
+
+	failures += check_published("full log", 0, MAX_LINES, 1);
+
+	printf("drain %d lines, %d per message, %d in flight, round trip %" PRIu32 " ms: %" PRIu32 " messages, "
+		"%.0f ms (%.1f round trips), %" PRIu32 " header writes, %" PRIu32 " writes to append\n", MAX_LINES,
+		CONFIG_ZAPTEC_OFFLINE_LOG_BATCH, CONFIG_ZAPTEC_OFFLINE_LOG_IN_FLIGHT, round_trip_ms, messages, duration,
+		duration / round_trip_ms, header_writes, append_writes);
+
+	if(max_in_flight > CONFIG_ZAPTEC_OFFLINE_LOG_IN_FLIGHT){
+		fprintf(stderr, "FAIL: %" PRIu32 " messages in flight\n", max_in_flight);
+		failures++;
+	}
+
+	reset_counters();
+	if(offline_log_attempt_send() != 0 || messages != 0 || header_writes != 0){
+		fprintf(stderr, "FAIL: drained log is not empty, %" PRIu32 " messages\n", messages);
+		failures++;
+	}
+
+	return failures;
+}
+
+/* The lines of unacknowledged messages are published again, and no line is lost */
+static int check_faults(void){
+	int failures = 0;
+	uint16_t window_lines = CONFIG_ZAPTEC_OFFLINE_LOG_BATCH * CONFIG_ZAPTEC_OFFLINE_LOG_IN_FLIGHT;
+
+	static const char * names[] = {"publish failure", "lost ack", "deleted message"};
+
+	for(int fault = 0; fault < 3; fault++){
+		offline_log_delete();
+		reset_counters();
+		append(0, 200);
+
+		int at = 200 / CONFIG_ZAPTEC_OFFLINE_LOG_BATCH / 2 + 1;
+		if(fault == 0)
+			fail_publish_at = at;
+		if(fault == 1)
+			drop_ack_at = at;
+		if(fault == 2)
+			delete_ack_at = at;
+
+		int result = offline_log_attempt_send();
+		wait_for_broker();
+
+		fail_publish_at = drop_ack_at = delete_ack_at = 0;
+
+		if(result == 0){
+			fprintf(stderr, "FAIL: %s, drain succeeded\n", names[fault]);
+			failures++;
+		}
+
+		/* Lines are appended while some are waiting to be sent again */
+		append(200, 50);
+
+		if(offline_log_attempt_send() != 0){
+			fprintf(stderr, "FAIL: %s, second drain failed\n", names[fault]);
+			failures++;
+		}
+
+		failures += check_published(names[fault], 0, 250, 1 + window_lines);
+	}
+
+	return failures;
+}
+
+/* The ring wraps around and a corrupt line is skipped */
+static int check_wrap_and_corrupt(void){
+	int failures = 0;
+
+	offline_log_delete();
+	reset_counters();
+
+	append(0, 700);
+	fail_publish_at = 700 / CONFIG_ZAPTEC_OFFLINE_LOG_BATCH / 2;
+	offline_log_attempt_send();
+	wait_for_broker();
+	fail_publish_at = 0;
+
+	append(700, 600);
+
+	FILE * fp = fopen(LOG_PATH, "r+b");
+	uint32_t corrupt = 0xffffffff;
+	fseek(fp, HEADER_SIZE + LINE_SIZE * 900, SEEK_SET);
+	__real_fwrite(&corrupt, sizeof(corrupt), 1, fp);
+	fclose(fp);
+
+	if(offline_log_attempt_send() != 0){
+		fprintf(stderr, "FAIL: wrapped log not drained\n");
+		failures++;
+	}
+
+	/* The oldest lines were overwritten and line 900 was corrupted */
+	for(uint32_t position = 1300 - MAX_LINES; position < 1300; position++){
+		if((position == 900) != (publish_count[position] == 0)){
+			fprintf(stderr, "FAIL: wrapped log, line %" PRIu32 " published %u times\n", position,
+				publish_count[position]);
+			failures++;
+			break;
+		}
+	}
+
+	return failures;
+}
+
+int main(int argc, char ** argv){
+	int opt;
+	while((opt = getopt(argc, argv, "r:")) != -1){
+		switch(opt){
+		case 'r':
+			round_trip_ms = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-r round trip ms]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if(round_trip_ms < 1)
+		round_trip_ms = 1;
+
+	esp_log_level_set("*", ESP_LOG_NONE);
+
+	mkdir(CONFIG_ZAPTEC_OFFLINE_LOG_MOUNT_POINT, 0755);
+	offline_log_init();
+	xTaskCreate(broker_task, "broker", 4096, NULL, 5, NULL);
+
+	int failures = check_full_log();
+	failures += check_faults();
+	failures += check_wrap_and_corrupt();
+
+	offline_log_delete();
+
+	if(failures != 0){
+		printf("%d failures\n", failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
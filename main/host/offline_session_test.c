@@ -0,0 +1,647 @@
+/*
+ * Tests main/offlineSession.c on a directory in /dev/shm, and measures append latency and the time to load the session
+ * index at boot.
+ *
+ * The crash check runs a workload of session calls. Before each call the directory is saved, and the call is repeated
+ * from the saved directory with power lost after every few bytes written: fwrite is wrapped to write only part of the
+ * data and nothing after it. After the simulated reboot the sessions must be as before or as after the call, and
+ * repeating the call must give the sessions after the call. The expected sessions are kept in a model by the test.
+ *
+ * Build with a small CONFIG_ZAPTEC_OFFLINE_SESSION_SEGMENT_SIZE so that the workload starts and removes segments.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <getopt.h>
+
+#include "esp_log.h"
+#include "esp_crc.h"
+#include "cJSON.h"
+#include "wpa_supplicant/base64.h"
+
+#include "offlineSession.h"
+
+#define SESSION_DIR CONFIG_ZAPTEC_OFFLINE_LOG_MOUNT_POINT
+#define SNAPSHOT_DIR CONFIG_ZAPTEC_OFFLINE_LOG_MOUNT_POINT "_snapshot"
+#define MAX_SESSIONS 100
+#define MAX_VALUES 100
+#define JSON_SIZE 320
+
+/* Stubs of the functions offlineSession.c uses from other components */
+
+bool i2cCheckSerialForDiskPartition(){
+	return false;
+}
+
+esp_err_t fat_eraseAndRemountPartition(int id, char * diagBuf, int diagBufMaxSize, int diagBufUsedLen){
+	return ESP_FAIL;
+}
+
+void zntp_format_time(char *buffer, time_t time_in){
+	sprintf(buffer, "%" PRId64, (int64_t)time_in);
+}
+
+/* Power loss and file access counters */
+
+static long write_budget = -1;
+static uint64_t bytes_written;
+static uint32_t files_opened;
+
+size_t __real_fwrite(const void * data, size_t size, size_t count, FILE * stream);
+FILE * __real_fopen(const char * path, const char * mode);
+
+size_t __wrap_fwrite(const void * data, size_t size, size_t count, FILE * stream){
+	if(stream == stdout || stream == stderr)
+		return __real_fwrite(data, size, count, stream);
+
+	size_t bytes = size * count;
+	if(write_budget >= 0 && bytes > write_budget){
+		size_t written = __real_fwrite(data, 1, write_budget, stream);
+		bytes_written += written;
+		write_budget = 0;
+		return written / size;
+	}
+
+	if(write_budget >= 0)
+		write_budget -= bytes;
+
+	bytes_written += bytes;
+	return __real_fwrite(data, size, count, stream);
+}
+
+FILE * __wrap_fopen(const char * path, const char * mode){
+	files_opened++;
+	return __real_fopen(path, mode);
+}
+
+/* Expected sessions */
+
+struct model_value{
+	char label;
+	double energy;
+};
+
+struct model_session{
+	bool used;
+	char json[JSON_SIZE];
+	int value_count;
+	struct model_value values[MAX_VALUES];
+};
+
+struct model{
+	struct model_session sessions[MAX_SESSIONS];
+};
+
+enum op_type{
+	eOP_CREATE,
+	eOP_ENERGY,
+	eOP_UPDATE,
+	eOP_DELETE_OLDEST,
+};
+
+struct op{
+	enum op_type type;
+	int session;
+	char label;
+	double energy;
+	char json[JSON_SIZE];
+};
+
+static void make_json(char * json, int session, int version, bool complete){
+	snprintf(json, JSON_SIZE, "{\"SessionId\":\"00000000-0000-0000-0000-%012d\",\"Energy\":%d.5,"
+		"\"StartDateTime\":\"2024-01-01T00:00:00,000Z\",\"EndDateTime\":\"%s\",\"ReliableClock\":true,"
+		"\"StoppedByRFID\":false,\"AuthenticationCode\":\"%d\",\"MIDSessionId\":%d}",
+		session, version, complete ? "2024-01-01T01:00:00,000Z" : "", version, session);
+}
+
+static int model_newest(const struct model * m){
+	for(int i = MAX_SESSIONS - 1; i >= 0; i--){
+		if(m->sessions[i].used)
+			return i;
+	}
+	return -1;
+}
+
+static int model_oldest(const struct model * m){
+	for(int i = 0; i < MAX_SESSIONS; i++){
+		if(m->sessions[i].used)
+			return i;
+	}
+	return -1;
+}
+
+static void model_apply(struct model * m, const struct op * op){
+	struct model_session * session = &m->sessions[op->session];
+
+	switch(op->type){
+	case eOP_CREATE:
+		session->used = true;
+		strcpy(session->json, op->json);
+		session->value_count = 0;
+		break;
+	case eOP_ENERGY:
+		if(op->label == 'B')
+			session->value_count = 0;
+		session->values[session->value_count++] = (struct model_value){.label = op->label, .energy = op->energy};
+		break;
+	case eOP_UPDATE:
+		strcpy(session->json, op->json);
+		break;
+	case eOP_DELETE_OLDEST:
+		memset(session, 0, sizeof(struct model_session));
+		break;
+	}
+}
+
+static void run_op(const struct op * op){
+	char json[JSON_SIZE];
+	strcpy(json, op->json);
+
+	switch(op->type){
+	case eOP_CREATE:
+		offlineSession_SaveSession(json);
+		break;
+	case eOP_ENERGY:
+		offlineSession_append_energy(op->label, 1700000000 + (time_t)op->energy, op->energy);
+		break;
+	case eOP_UPDATE:
+		offlineSession_UpdateSessionOnFile(json, false);
+		break;
+	case eOP_DELETE_OLDEST:
+		offlineSession_delete_session(offlineSession_FindOldestFile());
+		break;
+	}
+}
+
+/*
+ * Adds the calls of a session to ops like chargeSession.c, and deletes the oldest sessions as if they were sent.
+ */
+static size_t add_session_ops(struct op * ops, size_t count, struct model * m, int values, int keep_sessions){
+	int session = model_newest(m) + 1;
+	double energy = session * 100.0;
+
+	ops[count] = (struct op){.type = eOP_CREATE, .session = session};
+	make_json(ops[count].json, session, 1, false);
+	model_apply(m, &ops[count++]);
+
+	for(int i = 0; i < values; i++){
+		ops[count] = (struct op){.type = eOP_ENERGY, .session = session, .label = (i == 0) ? 'B' : (i == values - 1) ? 'E' : 'T',
+			.energy = energy + i * 1.25};
+		model_apply(m, &ops[count++]);
+	}
+
+	ops[count] = (struct op){.type = eOP_UPDATE, .session = session};
+	make_json(ops[count].json, session, 2, true);
+	model_apply(m, &ops[count++]);
+
+	int used = 0;
+	for(int i = 0; i < MAX_SESSIONS; i++)
+		used += m->sessions[i].used;
+
+	for(; used > keep_sessions; used--){
+		ops[count] = (struct op){.type = eOP_DELETE_OLDEST, .session = model_oldest(m)};
+		model_apply(m, &ops[count++]);
+	}
+
+	return count;
+}
+
+/* Boots as sessionHandler.c and chargeSession.c do */
+static void reboot(void){
+	write_budget = -1;
+
+	offlineSession_Init();
+	offlineSession_SetSessionFileInactive();
+
+	struct ChargeSession incomplete = {0};
+	offlineSession_CheckIfLastLessionIncomplete(&incomplete);
+}
+
+static bool state_matches(const struct model * m, const char * name, bool report){
+	int count = 0;
+	for(int i = 0; i < MAX_SESSIONS; i++)
+		count += m->sessions[i].used;
+
+	if(offlineSession_FindNrOfFiles() != count){
+		if(report)
+			fprintf(stderr, "FAIL: %s, %d sessions, expected %d\n", name, offlineSession_FindNrOfFiles(), count);
+		return false;
+	}
+
+	if(offlineSession_FindOldestFile() != model_oldest(m)){
+		if(report)
+			fprintf(stderr, "FAIL: %s, oldest session %d, expected %d\n", name, offlineSession_FindOldestFile(), model_oldest(m));
+		return false;
+	}
+
+	for(int i = 0; i < MAX_SESSIONS; i++){
+		const struct model_session * session = &m->sessions[i];
+		if(!session->used)
+			continue;
+
+		cJSON * actual = offlineSession_ReadChargeSessionFromFile(i);
+		char * actual_json = (actual != NULL) ? cJSON_PrintUnformatted(actual) : NULL;
+		bool same = actual_json != NULL && strcmp(actual_json, session->json) == 0;
+		free(actual_json);
+		cJSON_Delete(actual);
+
+		if(!same){
+			if(report)
+				fprintf(stderr, "FAIL: %s, session %d data differs\n", name, i);
+			return false;
+		}
+
+		cJSON * values = offlineSession_GetSignedSessionFromActiveFile(i);
+		same = cJSON_GetArraySize(values) == session->value_count;
+
+		for(int j = 0; same && j < session->value_count; j++){
+			cJSON * value = cJSON_GetArrayItem(values, j);
+			same = cJSON_GetObjectItem(value, "TX")->valuestring[0] == session->values[j].label
+				&& fabs(cJSON_GetObjectItem(value, "RV")->valuedouble - session->values[j].energy) < 1e-9;
+		}
+
+		cJSON_Delete(values);
+
+		if(!same){
+			if(report)
+				fprintf(stderr, "FAIL: %s, session %d energy values differ\n", name, i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void clear_dir(const char * path){
+	DIR * dir = opendir(path);
+	if(dir == NULL){
+		mkdir(path, 0755);
+		return;
+	}
+
+	struct dirent * dp;
+	char file[512];
+	while((dp = readdir(dir)) != NULL){
+		if(dp->d_type != DT_REG)
+			continue;
+
+		snprintf(file, sizeof(file), "%s/%s", path, dp->d_name);
+		remove(file);
+	}
+
+	closedir(dir);
+}
+
+static void copy_dir(const char * from, const char * to){
+	clear_dir(to);
+
+	DIR * dir = opendir(from);
+	struct dirent * dp;
+	char source[512], destination[512], buffer[4096];
+
+	while((dp = readdir(dir)) != NULL){
+		if(dp->d_type != DT_REG)
+			continue;
+
+		snprintf(source, sizeof(source), "%s/%s", from, dp->d_name);
+		snprintf(destination, sizeof(destination), "%s/%s", to, dp->d_name);
+
+		FILE * in = __real_fopen(source, "rb");
+		FILE * out = __real_fopen(destination, "wb");
+
+		size_t length;
+		while((length = fread(buffer, 1, sizeof(buffer), in)) > 0)
+			__real_fwrite(buffer, 1, length, out);
+
+		fclose(in);
+		fclose(out);
+	}
+
+	closedir(dir);
+}
+
+static int count_segments(void){
+	DIR * dir = opendir(SESSION_DIR);
+	struct dirent * dp;
+	int count = 0;
+
+	while((dp = readdir(dir)) != NULL){
+		size_t length = strlen(dp->d_name);
+		if(length > 4 && strcmp(dp->d_name + length - 4, ".ses") == 0)
+			count++;
+	}
+
+	closedir(dir);
+	return count;
+}
+
+static double now_us(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int check_crash(int sessions, int values, int stride){
+	int failures = 0;
+	uint32_t trials = 0;
+	uint32_t lost = 0;
+
+	clear_dir(SESSION_DIR);
+	reboot();
+
+	size_t max_ops = sessions * (values + 2 + MAX_SESSIONS);
+	struct op * ops = calloc(max_ops, sizeof(struct op));
+	struct model * planned = calloc(1, sizeof(struct model));
+	struct model * before = calloc(1, sizeof(struct model));
+	struct model * after = calloc(1, sizeof(struct model));
+
+	size_t op_count = 0;
+	for(int i = 0; i < sessions; i++)
+		op_count = add_session_ops(ops, op_count, planned, values, 3);
+
+	for(size_t i = 0; i < op_count && failures == 0; i++){
+		copy_dir(SESSION_DIR, SNAPSHOT_DIR);
+
+		*after = *before;
+		model_apply(after, &ops[i]);
+
+		uint64_t start = bytes_written;
+		run_op(&ops[i]);
+		long op_bytes = bytes_written - start;
+
+		for(long budget = 0; budget < op_bytes && failures == 0; budget += (budget < 64) ? 1 : stride){
+			copy_dir(SNAPSHOT_DIR, SESSION_DIR);
+			reboot();
+
+			write_budget = budget;
+			run_op(&ops[i]);
+			reboot();
+			trials++;
+
+			if(state_matches(after, "", false))
+				continue;
+
+			if(!state_matches(before, "crash", true)){
+				fprintf(stderr, "FAIL: op %zu, power lost after %ld of %ld bytes\n", i, budget, op_bytes);
+				failures++;
+				break;
+			}
+
+			lost++;
+			run_op(&ops[i]);
+			reboot();
+
+			if(!state_matches(after, "repeated op", true)){
+				fprintf(stderr, "FAIL: op %zu, repeated after power lost after %ld of %ld bytes\n", i, budget, op_bytes);
+				failures++;
+			}
+		}
+
+		copy_dir(SNAPSHOT_DIR, SESSION_DIR);
+		reboot();
+		run_op(&ops[i]);
+		*before = *after;
+
+		if(!state_matches(after, "workload", true)){
+			fprintf(stderr, "FAIL: op %zu\n", i);
+			failures++;
+		}
+	}
+
+	reboot();
+	failures += !state_matches(after, "reboot after workload", true);
+
+	/* Without manifests all segments are replayed */
+	remove(SESSION_DIR "/sessions.0");
+	remove(SESSION_DIR "/sessions.1");
+	reboot();
+	failures += !state_matches(after, "replay without manifest", true);
+
+	offlineSession_DeleteAllFiles();
+	reboot();
+	memset(after, 0, sizeof(struct model));
+	failures += !state_matches(after, "delete all", true);
+
+	if(count_segments() > 1){
+		fprintf(stderr, "FAIL: %d segments left after deleting all sessions\n", count_segments());
+		failures++;
+	}
+
+	printf("crash: %zu calls, %" PRIu32 " power losses, %" PRIu32 " calls lost and repeated, %d failures\n", op_count, trials,
+		lost, failures);
+
+	free(ops);
+	free(planned);
+	free(before);
+	free(after);
+	return failures;
+}
+
+/* Writes a session file of the layout before the log was used, and checks that it is imported with its number */
+static int check_import(void){
+	int failures = 0;
+
+	clear_dir(SESSION_DIR);
+
+	char json[JSON_SIZE];
+	make_json(json, 7, 3, true);
+
+	size_t base64_length;
+	char * base64 = base64_encode(json, strlen(json), &base64_length);
+
+	uint8_t file[1004 + 3 * 24] = {0};
+	file[0] = 2;
+	memcpy(file + 2, base64, base64_length);
+	uint32_t crc = esp_crc32_le(0, (uint8_t *)base64, base64_length);
+	memcpy(file + 996, &crc, sizeof(crc));
+	free(base64);
+
+	uint32_t count = 3;
+	memcpy(file + 1000, &count, sizeof(count));
+
+	struct model * m = calloc(1, sizeof(struct model));
+	struct model_session * session = &m->sessions[7];
+	session->used = true;
+	strcpy(session->json, json);
+
+	for(int i = 0; i < count; i++){
+		struct {
+			char label;
+			uint32_t timestamp;
+			double energy;
+			uint32_t crc;
+			uint32_t timestamp_high;
+		} element = {.label = "BTE"[i], .timestamp = 1700000000 + i, .energy = 10.0 + i};
+
+		element.crc = esp_crc32_le(0, (uint8_t *)&element, sizeof(element));
+		memcpy(file + 1004 + i * sizeof(element), &element, sizeof(element));
+
+		session->values[session->value_count++] = (struct model_value){.label = element.label, .energy = element.energy};
+	}
+
+	FILE * fp = __real_fopen(SESSION_DIR "/7.bin", "wb");
+	__real_fwrite(file, sizeof(file), 1, fp);
+	fclose(fp);
+
+	reboot();
+	failures += !state_matches(m, "import", true);
+
+	struct stat st;
+	if(stat(SESSION_DIR "/7.bin", &st) == 0){
+		fprintf(stderr, "FAIL: imported file not removed\n");
+		failures++;
+	}
+
+	if(offlineSession_FindNewFileNumber() != 8){
+		fprintf(stderr, "FAIL: new session number %d after import\n", offlineSession_FindNewFileNumber());
+		failures++;
+	}
+
+	offlineSession_DeleteAllFiles();
+	free(m);
+	return failures;
+}
+
+static int bench(int sessions, int values){
+	int failures = 0;
+
+	clear_dir(SESSION_DIR);
+	reboot();
+
+	struct model * m = calloc(1, sizeof(struct model));
+	struct op * ops = calloc(values + 2, sizeof(struct op));
+
+	double append_total = 0.0, append_max = 0.0;
+	uint32_t appends = 0;
+	uint32_t append_opens = 0;
+	uint64_t append_bytes = 0;
+
+	for(int i = 0; i < sessions; i++){
+		size_t count = add_session_ops(ops, 0, m, values, MAX_SESSIONS);
+
+		for(size_t j = 0; j < count; j++){
+			uint32_t opened = files_opened;
+			uint64_t written = bytes_written;
+			double start = now_us();
+
+			run_op(&ops[j]);
+
+			if(ops[j].type == eOP_ENERGY){
+				double duration = now_us() - start;
+				append_total += duration;
+				if(duration > append_max)
+					append_max = duration;
+
+				append_opens += files_opened - opened;
+				append_bytes += bytes_written - written;
+				appends++;
+			}
+		}
+
+		offlineSession_SetSessionFileInactive();
+	}
+
+	printf("append: %d sessions, %" PRIu32 " values, %.1f us mean, %.1f us max, %.2f files opened and %.1f bytes written per value\n",
+		sessions, appends, append_total / appends, append_max, (double)append_opens / appends, (double)append_bytes / appends);
+
+	/* The index is loaded by the first call after boot */
+	offlineSession_Init();
+	uint32_t opened = files_opened;
+	double start = now_us();
+	int found = offlineSession_FindNrOfFiles();
+	double manifest_duration = now_us() - start;
+	uint32_t manifest_opens = files_opened - opened;
+
+	opened = files_opened;
+	start = now_us();
+	offlineSession_FindOldestFile();
+	offlineSession_FindNewFileNumber();
+	offlineSession_FindNrOfFiles();
+	double find_duration = now_us() - start;
+	uint32_t find_opens = files_opened - opened;
+
+	remove(SESSION_DIR "/sessions.0");
+	remove(SESSION_DIR "/sessions.1");
+
+	offlineSession_Init();
+	opened = files_opened;
+	start = now_us();
+	offlineSession_FindNrOfFiles();
+	double replay_duration = now_us() - start;
+	uint32_t replay_opens = files_opened - opened;
+
+	printf("boot: %d sessions in %d segments, index from manifest %.0f us (%" PRIu32 " files opened), "
+		"from all segments %.0f us (%" PRIu32 " files opened)\n", found, count_segments(), manifest_duration, manifest_opens,
+		replay_duration, replay_opens);
+	printf("find oldest, new and count after boot: %.1f us, %" PRIu32 " files opened\n", find_duration, find_opens);
+
+	if(found != sessions){
+		fprintf(stderr, "FAIL: bench, %d sessions found\n", found);
+		failures++;
+	}
+
+	failures += !state_matches(m, "bench", true);
+
+	offlineSession_DeleteAllFiles();
+	free(m);
+	free(ops);
+	return failures;
+}
+
+int main(int argc, char ** argv){
+	int sessions = 100;
+	int values = 24;
+	int crash_sessions = 6;
+	int stride = 37;
+
+	int opt;
+	while((opt = getopt(argc, argv, "n:v:c:s:")) != -1){
+		switch(opt){
+		case 'n':
+			sessions = atoi(optarg);
+			break;
+		case 'v':
+			values = atoi(optarg);
+			break;
+		case 'c':
+			crash_sessions = atoi(optarg);
+			break;
+		case 's':
+			stride = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n bench sessions] [-v values per session] [-c crash sessions] [-s crash stride]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if(sessions < 1 || sessions > MAX_SESSIONS || values < 2 || values > MAX_VALUES || stride < 1){
+		fprintf(stderr, "Invalid arguments\n");
+		return 1;
+	}
+
+	esp_log_level_set("*", ESP_LOG_NONE);
+
+	mkdir(SESSION_DIR, 0755);
+	mkdir(SNAPSHOT_DIR, 0755);
+
+	int failures = check_import();
+	failures += check_crash(crash_sessions, 5, stride);
+	failures += bench(sessions, values);
+
+	clear_dir(SNAPSHOT_DIR);
+	clear_dir(SESSION_DIR);
+
+	if(failures != 0){
+		printf("%d failures\n", failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
@@ -502,6 +502,16 @@ void MakeCapabilityString()
 
 	cJSON * capaObject = cJSON_CreateCapabilities(&capabilities);
 
+#ifdef CONFIG_ZAPTEC_CLOUD_BINARY_TELEMETRY
+	/// Not in the generated schema. Tells the cloud it may enable the binary format with the TelemetryEncoding setting.
+	cJSON_AddBoolToObject(capaObject, "BinaryTelemetry", true);
+#endif
+
+#ifdef CONFIG_ZAPTEC_CLOUD_COMPRESS
+	/// Not in the generated schema. Large events may have the heatshrink content encoding.
+	cJSON_AddBoolToObject(capaObject, "CompressedEvents", true);
+#endif
+
 	capabilityString = cJSON_PrintUnformatted(capaObject);
 	/// Clean up, keep only string permanently in memory.
 	list_release(comList);
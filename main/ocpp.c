@@ -1,7 +1,9 @@
 #include <math.h>
+#include <stdatomic.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
+#include "freertos/semphr.h"
 
 #include "esp_log.h"
 #include "esp_crc.h"
@@ -25,6 +27,8 @@
 #include "ocpp_transaction.h"
 #include "ocpp_smart_charging.h"
 #include "ocpp_auth.h"
+#include "ocpp_config_registry.h"
+#include "ocpp_sampling_plan.h"
 
 #include "messages/call_messages/ocpp_call_request.h"
 #include "messages/call_messages/ocpp_call_cb.h"
@@ -224,78 +228,6 @@ float current_offered_from_pilot_state(float pilot_state){
 	return pilot_state;
 }
 
-static int populate_sample_current_import(char * phase, enum ocpp_reading_context_id context, struct ocpp_sampled_value_list * value_list_out){
-	//Because the go only has 1 connector, we can get the current in the same way regardless of connector id
-
-	struct ocpp_sampled_value new_value = {
-		.context = context,
-		.format = eOCPP_FORMAT_RAW,
-		.measurand = eOCPP_MEASURAND_CURRENT_IMPORT,
-		.phase = eOCPP_PHASE_L1,
-		.location = eOCPP_LOCATION_OUTLET,
-		.unit = eOCPP_UNIT_A
-	};
-
-	size_t new_values_count = 0;
-
-	if(phase == NULL || strcmp(phase, OCPP_PHASE_L1) == 0){
-		//Phase 1
-		sprintf(new_value.value, "%.1f", MCU_GetCurrents(0));
-		if(ocpp_sampled_list_add(value_list_out, new_value) != NULL)
-			new_values_count++;
-	}
-
-
-	if(phase == NULL || strcmp(phase, OCPP_PHASE_L2) == 0){
-		//Phase 2
-		new_value.phase = eOCPP_PHASE_L2;
-		sprintf(new_value.value, "%.1f", MCU_GetCurrents(1));
-		if(ocpp_sampled_list_add(value_list_out, new_value) != NULL)
-			new_values_count++;
-	}
-
-	if(phase == NULL || strcmp(phase, OCPP_PHASE_L3) == 0){
-		//Phase 3
-		new_value.phase = eOCPP_PHASE_L3;
-		sprintf(new_value.value, "%.1f", MCU_GetCurrents(2));
-		if(ocpp_sampled_list_add(value_list_out, new_value) != NULL)
-			new_values_count++;
-	}
-
-	return new_values_count;
-}
-
-static int populate_sample_current_offered(enum ocpp_reading_context_id context, struct ocpp_sampled_value_list * value_list_out){
-
-	struct ocpp_sampled_value new_value = {
-		.context = context,
-		.format = eOCPP_FORMAT_RAW,
-		.measurand = eOCPP_MEASURAND_CURRENT_OFFERED,
-		.unit = eOCPP_UNIT_A
-	};
-
-	sprintf(new_value.value, "%.1f", current_offered_from_pilot_state(MCU_GetInstantPilotState()));
-	if(ocpp_sampled_list_add(value_list_out, new_value) == NULL)
-		return 0;
-
-	return 1;
-}
-
-static int populate_sample_energy_active_import_register(enum ocpp_reading_context_id context, struct ocpp_sampled_value_list * value_list_out){
-	struct ocpp_sampled_value new_value = {
-		.context = context,
-		.format = eOCPP_FORMAT_RAW,
-		.measurand = eOCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER,
-		.unit = eOCPP_UNIT_WH
-	};
-
-	sprintf(new_value.value, "%.0f", get_accumulated_energy() * 1000);
-	if(ocpp_sampled_list_add(value_list_out, new_value) == NULL)
-		return 0;
-
-	return 1;
-}
-
 static time_t aligned_timestamp_begin = 0;
 static time_t aligned_timestamp_end = 0;
 static float aligned_energy_active_import_begin = 0;
@@ -306,145 +238,6 @@ static time_t sampled_timestamp_end = 0;
 static float sampled_energy_active_import_begin = 0;
 static float sampled_energy_active_import_end = 0;
 
-static int populate_sample_energy_active_import_interval(enum ocpp_reading_context_id context, struct ocpp_sampled_value_list * value_list_out){
-	struct ocpp_sampled_value new_value = {
-		.context = context,
-		.format = eOCPP_FORMAT_RAW,
-		.measurand = eOCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_INTERVAL,
-		.unit = eOCPP_UNIT_KWH
-	};
-
-	switch(context){
-	case eOCPP_CONTEXT_SAMPLE_CLOCK:
-		sprintf(new_value.value, "%.2f", aligned_energy_active_import_end - aligned_energy_active_import_begin);
-		break;
-	case eOCPP_CONTEXT_SAMPLE_PERIODIC:
-	case eOCPP_CONTEXT_TRANSACTION_END:
-		sprintf(new_value.value, "%.2f", sampled_energy_active_import_end - sampled_energy_active_import_begin);
-		break;
-	default:
-		return 0;
-	};
-
-	if(ocpp_sampled_list_add(value_list_out, new_value) == NULL)
-		return 0;
-
-	return 1;
-}
-
-static float populate_sample_power_active_import(enum ocpp_reading_context_id context, struct ocpp_sampled_value_list * value_list_out){
-	struct ocpp_sampled_value new_value = {
-		.context = context,
-		.format = eOCPP_FORMAT_RAW,
-		.measurand = eOCPP_MEASURAND_POWER_ACTIVE_IMPORT,
-		.location = eOCPP_LOCATION_OUTLET,
-		.unit = eOCPP_UNIT_W
-	};
-
-	sprintf(new_value.value, "%.1f", MCU_GetPower());
-	if(ocpp_sampled_list_add(value_list_out, new_value) == NULL)
-		return 0;
-
-	return 1;
-}
-
-static int populate_sample_temperature(char * phase, uint connector_id, enum ocpp_reading_context_id context, struct ocpp_sampled_value_list * value_list_out){
-	struct ocpp_sampled_value new_value = {
-		.context = context,
-		.format = eOCPP_FORMAT_RAW,
-		.measurand = eOCPP_MEASURAND_TEMPERATURE,
-		.location = eOCPP_LOCATION_BODY,
-		.unit = eOCPP_UNIT_CELSIUS
-	};
-
-	if(connector_id == 0 && phase == NULL){
-		// Body
-		sprintf(new_value.value, "%.1f", MCU_GetTemperaturePowerBoard(0));
-		if(ocpp_sampled_list_add(value_list_out, new_value) == NULL){
-			return 0;
-		}
-
-		sprintf(new_value.value, "%.1f", MCU_GetTemperaturePowerBoard(1));
-		if(ocpp_sampled_list_add(value_list_out, new_value) == NULL){
-			return 1;
-		}
-
-		return 2;
-	}else if(connector_id == 1){
-		new_value.location = eOCPP_LOCATION_OUTLET;
-
-		size_t new_values_count = 0;
-
-		if(phase == NULL && (MCU_GetGridType() == NETWORK_1P3W || MCU_GetGridType() == NETWORK_1P4W))
-			phase = OCPP_PHASE_L1;
-
-		if(phase == NULL || strcmp(phase, OCPP_PHASE_L1) == 0){
-			//phase 1
-			new_value.phase = eOCPP_PHASE_L1;
-			sprintf(new_value.value, "%.1f", MCU_GetEmeterTemperature(0));
-			if(ocpp_sampled_list_add(value_list_out, new_value) != NULL)
-				new_values_count++;
-		}
-
-		if(phase == NULL || strcmp(phase, OCPP_PHASE_L2) == 0){
-			//phase 2
-			new_value.phase = eOCPP_PHASE_L2;
-			sprintf(new_value.value, "%.1f", MCU_GetEmeterTemperature(1));
-			if(ocpp_sampled_list_add(value_list_out, new_value) != NULL)
-				new_values_count++;
-		}
-
-		if(phase == NULL || strcmp(phase, OCPP_PHASE_L3) == 0){
-			//phase 3
-			new_value.phase = eOCPP_PHASE_L3;
-			sprintf(new_value.value, "%.1f", MCU_GetEmeterTemperature(2));
-			if(ocpp_sampled_list_add(value_list_out, new_value) != NULL)
-				new_values_count++;
-		}
-
-		return new_values_count;
-	}else{
-		return 0;
-	}
-}
-
-static int populate_sample_voltage(char * phase, enum ocpp_reading_context_id context, struct ocpp_sampled_value_list * value_list_out){
-	struct ocpp_sampled_value new_value = {
-		.context = context,
-		.format = eOCPP_FORMAT_RAW,
-		.measurand = eOCPP_MEASURAND_VOLTAGE,
-		.phase = eOCPP_PHASE_L1,
-		.location = eOCPP_LOCATION_OUTLET,
-		.unit = eOCPP_UNIT_V
-	};
-
-	size_t new_values_count = 0;
-	if(phase == NULL || strcmp(phase, OCPP_PHASE_L1) == 0){
-		//Phase 1
-		sprintf(new_value.value, "%.1f", MCU_GetVoltages(0));
-		if(ocpp_sampled_list_add(value_list_out, new_value) != NULL)
-			new_values_count++;
-	}
-
-	if(phase == NULL || strcmp(phase, OCPP_PHASE_L2) == 0){
-		//Phase 2
-		new_value.phase = eOCPP_PHASE_L2;
-		sprintf(new_value.value, "%.1f", MCU_GetVoltages(1));
-		if(ocpp_sampled_list_add(value_list_out, new_value) != NULL)
-			new_values_count++;
-	}
-
-	if(phase == NULL || strcmp(phase, OCPP_PHASE_L3) == 0){
-		//Phase 3
-		new_value.phase = eOCPP_PHASE_L3;
-		sprintf(new_value.value, "%.1f", MCU_GetVoltages(2));
-		if(ocpp_sampled_list_add(value_list_out, new_value) != NULL)
-			new_values_count++;
-	}
-
-	return new_values_count;
-}
-
 void init_interval_measurands(enum ocpp_reading_context_id context){
 	switch(context){
 	case eOCPP_CONTEXT_SAMPLE_CLOCK:
@@ -505,38 +298,6 @@ void save_interval_measurands(enum ocpp_reading_context_id context){
 	};
 }
 
-int populate_sample(enum ocpp_measurand_id measurand, char * phase, uint connector_id, enum ocpp_reading_context_id context,
-		struct ocpp_sampled_value_list * value_list_out){
-
-	/*
-	* Default to only report on active phases on measurands that are only reported on phases
-	*/
-	if(phase == NULL && measurand != eOCPP_MEASURAND_TEMPERATURE){
-		if(MCU_GetGridType() == NETWORK_1P3W || MCU_GetGridType() == NETWORK_1P4W)
-			phase = OCPP_PHASE_L1;
-	}
-
-	switch(measurand){
-	case eOCPP_MEASURAND_CURRENT_IMPORT:
-		return populate_sample_current_import(phase, context, value_list_out);
-	case eOCPP_MEASURAND_CURRENT_OFFERED:
-		return populate_sample_current_offered(context, value_list_out);
-	case eOCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER:
-		return populate_sample_energy_active_import_register(context, value_list_out);
-	case eOCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_INTERVAL:
-		return populate_sample_energy_active_import_interval(context, value_list_out);
-	case eOCPP_MEASURAND_POWER_ACTIVE_IMPORT:
-		return populate_sample_power_active_import(context, value_list_out);
-	case eOCPP_MEASURAND_TEMPERATURE:
-		return populate_sample_temperature(phase, connector_id, context, value_list_out);
-	case eOCPP_MEASURAND_VOLTAGE:
-		return populate_sample_voltage(phase, context, value_list_out);
-	default:
-		ESP_LOGE(TAG, "Invalid measurand '%s'!!", ocpp_measurand_from_id(measurand));
-		return 0;
-	};
-}
-
 char * csl_token_get_phase_index(const char * csl_token){
 	char * phase_index = rindex(csl_token, '.');
 	if(phase_index == NULL){
@@ -552,180 +313,302 @@ char * csl_token_get_phase_index(const char * csl_token){
 	}
 }
 
-int ocpp_populate_meter_values_from_existing(uint connector_id, enum ocpp_reading_context_id context, const char * measurand_csl,
-					struct ocpp_meter_value_list * existing_list, struct ocpp_meter_value_list * meter_value_out){
-
-	if(measurand_csl == NULL || strlen(measurand_csl) == 0)
-		return 0;
+/*
+ * Measurand lists are compiled into a sampling plan per configuration key and connector the first time they are
+ * sampled after the key or the grid type changed. Sampling then only reads the sources used by the plans and formats
+ * the values.
+ *
+ * A change of a key increments its generation without taking sampling_plan_lock, so that an accepted change is never
+ * lost to a lock timeout. A cached plan compiled for an older generation is compiled again. The lock is only held
+ * while a plan is compiled or copied, not while the values are created and sent.
+ */
+enum sampling_plan_data{
+	eSAMPLING_PLAN_SAMPLED,
+	eSAMPLING_PLAN_ALIGNED,
+	eSAMPLING_PLAN_STOP_TXN_SAMPLED,
+	eSAMPLING_PLAN_STOP_TXN_ALIGNED,
+	eSAMPLING_PLAN_DATA_COUNT
+};
 
-	/**
-	 * The amount of samples to add to any ocpp meter value may depend on:
-	 * how many measurands in the measurand_csl (comma seperated list),
-	 * how many measurands are supported on the current connector_id,
-	 * how many locations a measurand can be measured,
-	 * and how many phases should be measured
-	 */
+struct cached_sampling_plan{
+	struct ocpp_sampling_plan * plan;
+	unsigned int generation; ///< Generation of the measurand list the plan was compiled from
+	bool single_phase;
+};
 
-	char * measurands = strdup(measurand_csl);
-	if(measurands == NULL){
-		ESP_LOGE(TAG, "Unable to duplicate measurands");
-		return -1;
+static struct cached_sampling_plan sampling_plans[eSAMPLING_PLAN_DATA_COUNT][CONFIG_OCPP_NUMBER_OF_CONNECTORS + 1] = {0};
+static atomic_uint sampling_plan_generations[eSAMPLING_PLAN_DATA_COUNT];
+static SemaphoreHandle_t sampling_plan_lock = NULL;
+
+static const char * sampling_plan_csl(enum sampling_plan_data data){
+	switch(data){
+	case eSAMPLING_PLAN_SAMPLED:
+		return storage_Get_ocpp_meter_values_sampled_data();
+	case eSAMPLING_PLAN_ALIGNED:
+		return storage_Get_ocpp_meter_values_aligned_data();
+	case eSAMPLING_PLAN_STOP_TXN_SAMPLED:
+		return storage_Get_ocpp_stop_txn_sampled_data();
+	case eSAMPLING_PLAN_STOP_TXN_ALIGNED:
+		return storage_Get_ocpp_stop_txn_aligned_data();
+	default:
+		return NULL;
 	}
+}
+
+static void invalidate_sampling_plans(enum sampling_plan_data data){
+	atomic_fetch_add(&sampling_plan_generations[data], 1);
+}
 
-	char * item = strtok(measurands, ",");
+/*
+ * Must be called with sampling_plan_lock taken
+ */
+static const struct ocpp_sampling_plan * get_sampling_plan(enum sampling_plan_data data, uint connector_id){
+	if(connector_id > CONFIG_OCPP_NUMBER_OF_CONNECTORS)
+		return NULL;
 
-	while(item != NULL){
-		ESP_LOGI(TAG, "Attempting to add %s to meter value", item);
+	struct cached_sampling_plan * cached = &sampling_plans[data][connector_id];
+	bool single_phase = (MCU_GetGridType() == NETWORK_1P3W || MCU_GetGridType() == NETWORK_1P4W);
 
-		bool added = false;
-		struct ocpp_meter_value_list * existing_value = existing_list;
+	// Read before the measurand list, so that a change during compilation causes the plan to be compiled again
+	unsigned int generation = atomic_load(&sampling_plan_generations[data]);
 
-		while(existing_value != NULL){
-			// This function expects each meter value in existing list to contain only one
-			// measurand, therefore we only need to check the first sample in each existing value
-			if(existing_value->value == NULL
-				|| existing_value->value->sampled_value == NULL
-				|| existing_value->value->sampled_value->value == NULL){
+	if(cached->plan != NULL && cached->generation == generation && cached->single_phase == single_phase)
+		return cached->plan;
 
-				ESP_LOGE(TAG, "Expected existing list to contain sampled value");
-			}
-			else{
-				if(ocpp_measurand_to_id(item) == existing_value->value->sampled_value->value->measurand){
-					if(ocpp_meter_list_add(meter_value_out, *existing_value->value) == NULL){
-						ESP_LOGE(TAG, "Unable to add exiting measurand");
-					}else{
-						ESP_LOGI(TAG, "Added from existing");
-						added = true;
-					}
-					break;
-				}
-			}
-			existing_value = existing_value->next;
+	if(cached->plan == NULL){
+		cached->plan = malloc(sizeof(struct ocpp_sampling_plan));
+		if(cached->plan == NULL){
+			ESP_LOGE(TAG, "Unable to allocate sampling plan");
+			return NULL;
 		}
+	}
 
-		if(added == false){
-			struct ocpp_meter_value * meter_value = malloc(sizeof(struct ocpp_meter_value));
-			if(meter_value == NULL){
-				ESP_LOGE(TAG, "Unable to create new meter_value");
-				free(measurands);
-				return -1;
-			}
+	ESP_LOGI(TAG, "Compiling sampling plan %d for connector %d", data, connector_id);
+	if(ocpp_sampling_plan_compile(cached->plan, sampling_plan_csl(data), connector_id, single_phase) != ESP_OK)
+		ESP_LOGW(TAG, "Sampling plan does not contain all configured measurands");
 
-			if(ocpp_measurand_is_interval(item)){
-				if(context == eOCPP_CONTEXT_SAMPLE_CLOCK){
-					meter_value->timestamp = aligned_timestamp_end;
+	cached->generation = generation;
+	cached->single_phase = single_phase;
 
-				}else if(context == eOCPP_CONTEXT_SAMPLE_PERIODIC || context == eOCPP_CONTEXT_TRANSACTION_END){
-					meter_value->timestamp = sampled_timestamp_end;
+	return cached->plan;
+}
 
-				}else{ // Will probably be rejected by populate_sample_<measurand>
-					meter_value->timestamp = time(NULL);
-				}
-			}else{
-				meter_value->timestamp = time(NULL);
-			}
-			meter_value->sampled_value = ocpp_create_sampled_list();
-			if(meter_value->sampled_value == NULL){
-				ESP_LOGE(TAG, "Unable to create new sample");
-				free(meter_value);
-				free(measurands);
-				return -1;
-			}
-			ESP_LOGI(TAG, "Creating %s value", item);
+/*
+ * Copies the current plan so that it can be used without sampling_plan_lock.
+ */
+static bool copy_sampling_plan(enum sampling_plan_data data, uint connector_id, struct ocpp_sampling_plan * plan_out){
+	if(sampling_plan_lock == NULL || xSemaphoreTake(sampling_plan_lock, pdMS_TO_TICKS(2000)) != pdTRUE){
+		ESP_LOGE(TAG, "Unable to take sampling plan lock");
+		return false;
+	}
 
-			char * phase_index = csl_token_get_phase_index(item);
-			if(phase_index != NULL){
-				*phase_index = '\0'; // Terminate the item at end of measurand
-				phase_index++;
-			}
+	const struct ocpp_sampling_plan * plan = get_sampling_plan(data, connector_id);
+	if(plan != NULL)
+		memcpy(plan_out, plan, sizeof(struct ocpp_sampling_plan));
 
-			int new_item_count = populate_sample(ocpp_measurand_to_id(item), phase_index, connector_id, context, meter_value->sampled_value);
+	xSemaphoreGive(sampling_plan_lock);
+	return plan != NULL;
+}
 
-			if(new_item_count < 1){
-				if(new_item_count < 0)
-					ESP_LOGE(TAG, "Failed to populate sample for measurand '%s'", item);
+#define SOURCE_USED(mask, source) (((mask) & (1u << (source))) != 0)
 
-				free(meter_value->sampled_value);
-				free(meter_value);
-			}else{
-				struct ocpp_meter_value_list * new_node = ocpp_meter_list_add_reference(meter_value_out, meter_value);
-				if(new_node == NULL){
-					ESP_LOGE(TAG, "Unable to add sample to meter value");
-					free(meter_value->sampled_value);
-					free(meter_value);
-					return -1;
-				}
-			}
+static void read_sample_snapshot(uint32_t source_mask, enum ocpp_reading_context_id context, struct ocpp_sample_snapshot * snapshot){
+	for(size_t i = 0; i < eOCPP_SAMPLE_SOURCE_COUNT; i++)
+		snapshot->value[i] = NAN;
+
+	snapshot->timestamp = time(NULL);
+	snapshot->interval_timestamp = snapshot->timestamp;
+
+	//Because the go only has 1 connector, the readings are the same regardless of connector id
+	for(size_t i = 0; i < 3; i++){
+		if(SOURCE_USED(source_mask, eOCPP_SAMPLE_SOURCE_CURRENT_L1 + i))
+			snapshot->value[eOCPP_SAMPLE_SOURCE_CURRENT_L1 + i] = MCU_GetCurrents(i);
+
+		if(SOURCE_USED(source_mask, eOCPP_SAMPLE_SOURCE_TEMPERATURE_L1 + i))
+			snapshot->value[eOCPP_SAMPLE_SOURCE_TEMPERATURE_L1 + i] = MCU_GetEmeterTemperature(i);
+
+		if(SOURCE_USED(source_mask, eOCPP_SAMPLE_SOURCE_VOLTAGE_L1 + i))
+			snapshot->value[eOCPP_SAMPLE_SOURCE_VOLTAGE_L1 + i] = MCU_GetVoltages(i);
+	}
+
+	if(SOURCE_USED(source_mask, eOCPP_SAMPLE_SOURCE_CURRENT_OFFERED))
+		snapshot->value[eOCPP_SAMPLE_SOURCE_CURRENT_OFFERED] = current_offered_from_pilot_state(MCU_GetInstantPilotState());
+
+	if(SOURCE_USED(source_mask, eOCPP_SAMPLE_SOURCE_ENERGY_REGISTER))
+		snapshot->value[eOCPP_SAMPLE_SOURCE_ENERGY_REGISTER] = get_accumulated_energy() * 1000;
+
+	if(SOURCE_USED(source_mask, eOCPP_SAMPLE_SOURCE_ENERGY_INTERVAL)){
+		switch(context){
+		case eOCPP_CONTEXT_SAMPLE_CLOCK:
+			snapshot->value[eOCPP_SAMPLE_SOURCE_ENERGY_INTERVAL] = aligned_energy_active_import_end - aligned_energy_active_import_begin;
+			snapshot->interval_timestamp = aligned_timestamp_end;
+			break;
+		case eOCPP_CONTEXT_SAMPLE_PERIODIC:
+		case eOCPP_CONTEXT_TRANSACTION_END:
+			snapshot->value[eOCPP_SAMPLE_SOURCE_ENERGY_INTERVAL] = sampled_energy_active_import_end - sampled_energy_active_import_begin;
+			snapshot->interval_timestamp = sampled_timestamp_end;
+			break;
+		default: // Interval values are not available in other contexts
+			break;
+		}
+	}
+
+	if(SOURCE_USED(source_mask, eOCPP_SAMPLE_SOURCE_POWER))
+		snapshot->value[eOCPP_SAMPLE_SOURCE_POWER] = MCU_GetPower();
+
+	if(SOURCE_USED(source_mask, eOCPP_SAMPLE_SOURCE_TEMPERATURE_BODY_1))
+		snapshot->value[eOCPP_SAMPLE_SOURCE_TEMPERATURE_BODY_1] = MCU_GetTemperaturePowerBoard(0);
+
+	if(SOURCE_USED(source_mask, eOCPP_SAMPLE_SOURCE_TEMPERATURE_BODY_2))
+		snapshot->value[eOCPP_SAMPLE_SOURCE_TEMPERATURE_BODY_2] = MCU_GetTemperaturePowerBoard(1);
+}
+
+static struct ocpp_meter_value * create_meter_value(const struct ocpp_sampled_value * values, size_t value_count, time_t timestamp){
+	struct ocpp_meter_value * meter_value = malloc(sizeof(struct ocpp_meter_value));
+	if(meter_value == NULL){
+		ESP_LOGE(TAG, "Unable to create new meter_value");
+		return NULL;
+	}
+
+	meter_value->timestamp = timestamp;
+	meter_value->sampled_value = ocpp_create_sampled_list();
+	if(meter_value->sampled_value == NULL){
+		ESP_LOGE(TAG, "Unable to create new sample");
+		goto error;
+	}
+
+	for(size_t i = 0; i < value_count; i++){
+		if(ocpp_sampled_list_add(meter_value->sampled_value, values[i]) == NULL){
+			ESP_LOGE(TAG, "Unable to add sampled value");
+			goto error;
 		}
+	}
 
-		item = strtok(NULL, ",");
+	return meter_value;
+
+error:
+	ocpp_sampled_list_delete(meter_value->sampled_value);
+	free(meter_value);
+	return NULL;
+}
+
+/*
+ * Creates one meter value per group in the plan, skipping groups without available readings.
+ */
+static int create_meter_values(const struct ocpp_sampling_plan * plan, const struct ocpp_sample_snapshot * snapshot,
+			enum ocpp_reading_context_id context, struct ocpp_meter_value_list * meter_value_out){
+
+	struct ocpp_sampled_value values[OCPP_SAMPLING_PLAN_MAX_GROUP_ITEMS];
+
+	for(size_t i = 0; i < plan->group_count; i++){
+		size_t value_count = ocpp_sampling_plan_sample_group(plan, i, snapshot, context, values);
+		if(value_count == 0)
+			continue;
+
+		struct ocpp_meter_value * meter_value = create_meter_value(values, value_count,
+									plan->groups[i].interval ? snapshot->interval_timestamp : snapshot->timestamp);
+		if(meter_value == NULL)
+			return -1;
+
+		if(ocpp_meter_list_add_reference(meter_value_out, meter_value) == NULL){
+			ESP_LOGE(TAG, "Unable to add sample to meter value");
+			ocpp_sampled_list_delete(meter_value->sampled_value);
+			free(meter_value);
+			return -1;
+		}
 	}
-	free(measurands);
 
 	return ocpp_meter_list_get_length(meter_value_out);
 }
 
 TimerHandle_t clock_aligned_handle = NULL;
 
-void handle_meter_value(enum ocpp_reading_context_id context, const char * csl, const char * stoptxn_csl,
+void handle_meter_value(enum ocpp_reading_context_id context, bool clock_aligned, bool include_stop_txn,
 			int * transaction_id, bool valid_id, uint * connectors, size_t connector_count, bool is_trigger){
 
+	struct ocpp_sampling_plan * plans = malloc(sizeof(struct ocpp_sampling_plan) * 2);
+	if(plans == NULL){
+		ESP_LOGE(TAG, "Unable to allocate sampling plans");
+		return;
+	}
+
+	enum sampling_plan_data data = clock_aligned ? eSAMPLING_PLAN_ALIGNED : eSAMPLING_PLAN_SAMPLED;
+	enum sampling_plan_data stoptxn_data = clock_aligned ? eSAMPLING_PLAN_STOP_TXN_ALIGNED : eSAMPLING_PLAN_STOP_TXN_SAMPLED;
+
 	for(size_t i = 0; i < connector_count; i++){
 		uint connector = connectors[i];
 		bool transaction_related = (transaction_id != NULL && connector == 1);
+
+		const struct ocpp_sampling_plan * plan = &plans[0];
+		const struct ocpp_sampling_plan * stoptxn_plan = NULL;
+
+		if(!copy_sampling_plan(data, connector, &plans[0]) || plan->group_count == 0)
+			continue;
+
+		if(include_stop_txn && transaction_related && copy_sampling_plan(stoptxn_data, connector, &plans[1]))
+			stoptxn_plan = &plans[1];
+
+		/*
+		 * Values for the transaction and for StopTransaction.req are created from the same snapshot. Measurands
+		 * found in both lists therefore get the same value as when they were copied between the lists.
+		 */
+		struct ocpp_sample_snapshot snapshot;
+		read_sample_snapshot(plan->source_mask | (stoptxn_plan != NULL ? stoptxn_plan->source_mask : 0), context, &snapshot);
+
+		ESP_LOGI(TAG, "Creating meter values for connector %d", connector);
 		struct ocpp_meter_value_list * meter_value_list = ocpp_create_meter_list();
+		if(meter_value_list == NULL){
+			ESP_LOGE(TAG, "Unable to create meter value list");
+			break;
+		}
 
-		if(csl != NULL && csl[0] != '\0'){
-			ESP_LOGI(TAG, "Creating meter values for connector %d", connector);
-			if(meter_value_list == NULL){
-				ESP_LOGE(TAG, "Unable to create meter value list");
-				return;
-			}
+		int length = create_meter_values(plan, &snapshot, context, meter_value_list);
 
-			int length = ocpp_populate_meter_values_from_existing(connector, context, csl, NULL, meter_value_list);
+		if(length < 0){
+			ESP_LOGW(TAG, "No meter values to send");
 
-			if(length < 0){
-				ESP_LOGW(TAG, "No meter values to send");
+		}else{
+			if(transaction_related && ocpp_transaction_enqueue_meter_value(connector, valid_id ? transaction_id : NULL, meter_value_list) == 0){
+				if(stoptxn_plan != NULL && stoptxn_plan->group_count > 0){
+					ESP_LOGI(TAG, "Creating stoptxn meter values");
 
-			}else{
-				if(transaction_related && ocpp_transaction_enqueue_meter_value(connector, valid_id ? transaction_id : NULL, meter_value_list) == 0){
-					if(stoptxn_csl != NULL && stoptxn_csl[0] != '\0'){
-						ESP_LOGI(TAG, "Creating stoptxn meter values");
+					struct ocpp_meter_value_list * stoptxn_meter_value_list = ocpp_create_meter_list();
+					if(stoptxn_meter_value_list == NULL){
+						ESP_LOGE(TAG, "Unable to create meter value list for stop transaction");
+					}else{
 
-						struct ocpp_meter_value_list * stoptxn_meter_value_list = ocpp_create_meter_list();
-						if(stoptxn_meter_value_list == NULL){
-							ESP_LOGE(TAG, "Unable to create meter value list for stop transaction");
+						int length = create_meter_values(stoptxn_plan, &snapshot, context, stoptxn_meter_value_list);
+						if(length > 0){
+							sessionHandler_OcppTransferMeterValues(connector, stoptxn_meter_value_list, length);
 						}else{
-
-							int length = ocpp_populate_meter_values_from_existing(connector, context, stoptxn_csl,
-													meter_value_list, stoptxn_meter_value_list);
-							if(length > 0){
-								sessionHandler_OcppTransferMeterValues(connector, stoptxn_meter_value_list, length);
-							}
+							ocpp_meter_list_delete(stoptxn_meter_value_list);
 						}
 					}
+				}
 
 
-				}else{
-					cJSON * request = ocpp_create_meter_values_request(connector, NULL, meter_value_list);
-					if(request == NULL){
-						ESP_LOGE(TAG, "Unable to create meter value request for %s values", ocpp_reading_context_from_id(context));
-						return;
-					}
+			}else{
+				cJSON * request = ocpp_create_meter_values_request(connector, NULL, meter_value_list);
+				if(request == NULL){
+					ESP_LOGE(TAG, "Unable to create meter value request for %s values", ocpp_reading_context_from_id(context));
+					ocpp_meter_list_delete(meter_value_list);
+					break;
+				}
 
-					ESP_LOGI(TAG, "Sending meter values");
+				ESP_LOGI(TAG, "Sending meter values");
 
-					if(is_trigger){
-						enqueue_trigger(request, NULL, NULL, "Meter value", eOCPP_CALL_GENERIC, true);
-					}else{
-						enqueue_call_immediate(request, NULL, NULL, "Meter value", eOCPP_CALL_GENERIC);
-					}
+				if(is_trigger){
+					enqueue_trigger(request, NULL, NULL, "Meter value", eOCPP_CALL_GENERIC, true);
+				}else{
+					enqueue_call_immediate(request, NULL, NULL, "Meter value", eOCPP_CALL_GENERIC);
 				}
 			}
 		}
 
 		ocpp_meter_list_delete(meter_value_list);
 	}
+
+	free(plans);
 	save_interval_measurands(context);
 }
 
@@ -741,9 +624,7 @@ static void clock_aligned_meter_values(){
 	bool valid_id;
 	int * transaction_id = sessionHandler_OcppGetTransactionId(1, &valid_id);
 
-	handle_meter_value(eOCPP_CONTEXT_SAMPLE_CLOCK,
-			storage_Get_ocpp_meter_values_aligned_data(), storage_Get_ocpp_stop_txn_aligned_data(),
-			transaction_id, valid_id, connectors, connector_count, false);
+	handle_meter_value(eOCPP_CONTEXT_SAMPLE_CLOCK, true, true, transaction_id, valid_id, connectors, connector_count, false);
 
 	free(connectors);
 }
@@ -832,42 +713,6 @@ static void stop_clock_aligned_meter_values(){
 	}
 }
 
-static int write_configuration_u8(uint8_t value, char * value_out){
-	if(value_out == NULL){
-		return -1;
-	}else{
-		snprintf(value_out, 4, "%" PRIu8, value);
-		return 0;
-	}
-}
-
-static int write_configuration_u16(uint16_t value, char * value_out){
-	if(value_out == NULL){
-		return -1;
-	}else{
-		snprintf(value_out, 8, "%" PRIu16, value);
-		return 0;
-	}
-}
-
-static int write_configuration_u32(uint32_t value, char * value_out){
-	if(value_out == NULL){
-		return -1;
-	}else{
-		snprintf(value_out, 16, "%" PRIu32, value);
-		return 0;
-	}
-}
-
-static int write_configuration_bool(bool value, char * value_out){
-	if(value_out == NULL){
-		return -1;
-	}else{
-		strcpy(value_out, value ? "true" : "false");
-		return 0;
-	}
-}
-
 static const char * convert_to_ocpp_phase(uint8_t phase_rotation){
 	switch(phase_rotation){
 	case 1:
@@ -947,1308 +792,714 @@ static uint8_t convert_from_ocpp_phase(enum ocpp_phase_rotation_id phase_rotatio
 	}
 }
 
-cJSON * create_key_value(const char * key, bool read_only, const char * value){
-	cJSON * key_value_json = cJSON_CreateObject();
-	cJSON_AddStringToObject(key_value_json, "key", key);
-	cJSON_AddBoolToObject(key_value_json, "readonly", read_only);
-	cJSON_AddStringToObject(key_value_json, "value", value);
-
-	return key_value_json;
-}
-
-static char value_buffer[500];
-
-esp_err_t add_configuration_ocpp_allow_offline_tx_for_unknown_id(cJSON * key_list){
-	if(write_configuration_bool(storage_Get_ocpp_allow_offline_tx_for_unknown_id(), value_buffer) != 0)
-		return ESP_FAIL;
-
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_ALLOW_OFFLINE_TX_FOR_UNKNOWN_ID, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_ALLOW_OFFLINE_TX_FOR_UNKNOWN_ID);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
+static void change_config_confirm(const char * unique_id, const char * configuration_status){
+	cJSON * response = ocpp_create_change_configuration_confirmation(unique_id, configuration_status);
+	if(response == NULL){
+		ESP_LOGE(TAG, "Unable to create change configuration confirmation");
+		return;
 	}else{
-		return ESP_OK;
+		send_call_reply(response);
 	}
 }
 
-esp_err_t add_configuration_ocpp_authorization_cache_enabled(cJSON * key_list){
-	if(write_configuration_bool(storage_Get_ocpp_authorization_cache_enabled(), value_buffer) != 0)
-		return ESP_FAIL;
-
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_AUTHORIZATION_CACHE_ENABLED, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_AUTHORIZATION_CACHE_ENABLED);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+static bool is_valid_interval(uint32_t sec){
+	return sec <= CONFIG_OCPP_TIMER_MAX_SEC;
 }
 
-esp_err_t add_configuration_ocpp_authorize_remote_tx_requests(cJSON * key_list){
-	if(write_configuration_bool(storage_Get_ocpp_authorize_remote_tx_requests(), value_buffer) != 0)
-		return ESP_FAIL;
-
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_AUTHORIZE_REMOTE_TX_REQUESTS, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_AUTHORIZE_REMOTE_TX_REQUESTS);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
-}
+static bool is_valid_alignment_interval(uint32_t sec){
+	if(sec == 0)
+		return true;
 
-esp_err_t add_configuration_ocpp_blink_repeat(cJSON * key_list){
-	return ESP_ERR_NOT_SUPPORTED;
+	return (86400 % sec) == 0 && is_valid_interval(sec);
 }
 
-esp_err_t add_configuration_ocpp_clock_aligned_data_interval(cJSON * key_list){
-	if(write_configuration_u32(storage_Get_ocpp_clock_aligned_data_interval(), value_buffer) != 0)
-		return ESP_FAIL;
-
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_CLOCK_ALIGNED_DATA_INTERVAL, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_CLOCK_ALIGNED_DATA_INTERVAL);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+static bool is_true(bool value){
+	return value;
 }
 
-esp_err_t add_configuration_ocpp_connection_timeout(cJSON * key_list){
-	if(write_configuration_u32(storage_Get_ocpp_connection_timeout(), value_buffer) != 0)
-		return ESP_FAIL;
-
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_CONNECTION_TIMEOUT, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_CONNECTION_TIMEOUT);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
-}
+static bool is_valid_security_profile(uint8_t security_profile){
 
-esp_err_t add_configuration_ocpp_connector_phase_rotation(cJSON * key_list){
-	char phase_rotation_str[CONFIG_OCPP_CONNECTOR_PHASE_ROTATION_MAX_LENGTH * 13 +1];
+	//If the Charge Point receives a lower or equal value then currently configured, the Charge Point SHALL Rejected the ChangeConfiguration.req
+	if(security_profile <= storage_Get_ocpp_security_profile() || security_profile > 3) // Highest defined securityProfile is 3
+		return false;
 
-	size_t offset = 0;
+	if(security_profile == 0){
+		return true;
 
-	for(size_t i = 0; i <= CONFIG_OCPP_NUMBER_OF_CONNECTORS; i++){
-		if(i > 0)
-			phase_rotation_str[offset++] = ',';
+	}else if(security_profile == 1){
+		if(storage_Get_ocpp_authorization_key()[0] == '\0')
+			return false;
 
-		offset += sprintf(phase_rotation_str + offset, "%u.%s", i, convert_to_ocpp_phase(storage_Get_PhaseRotation()));
+		return true;
 	}
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_CONNECTOR_PHASE_ROTATION, false, phase_rotation_str);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_CONNECTOR_PHASE_ROTATION);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+	return false;
 }
 
-esp_err_t add_configuration_ocpp_connector_phase_rotation_max_length(cJSON * key_list){
-	if(write_configuration_u8(CONFIG_OCPP_CONNECTOR_PHASE_ROTATION_MAX_LENGTH, value_buffer) != 0)
-		return ESP_FAIL;
+static bool is_valid_message_timeout(uint16_t message_timeout){
+	if(message_timeout < CONFIG_OCPP_MESSAGE_TIMEOUT_MINIMUM)
+		return false;
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_CONNECTOR_PHASE_ROTATION_MAX_LENGTH, true, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_CONNECTOR_PHASE_ROTATION_MAX_LENGTH);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+	return true;
+}
+
+void set_AuthenticationRequired_bool(bool newValue){
+	storage_Set_AuthenticationRequired(newValue ? 1 : 0);
 }
 
-esp_err_t add_configuration_ocpp_get_configuration_max_keys(cJSON * key_list){
-	if(write_configuration_u8(CONFIG_OCPP_GET_CONFIGURATION_MAX_KEYS, value_buffer) != 0)
-		return ESP_FAIL;
+bool csl_expect_phase(const char * option){
+	if(strcmp(option, OCPP_MEASURAND_CURRENT_IMPORT) == 0
+		|| strcmp(option, OCPP_MEASURAND_TEMPERATURE) == 0
+		|| strcmp(option, OCPP_MEASURAND_VOLTAGE) == 0
+		){
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_GET_CONFIGURATION_MAX_KEYS, true, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_GET_CONFIGURATION_MAX_KEYS);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
+		return true;
 	}else{
-		return ESP_OK;
+		return false;
 	}
 }
 
-esp_err_t add_configuration_ocpp_heartbeat_interval(cJSON * key_list){
-	if(write_configuration_u32(storage_Get_ocpp_heartbeat_interval(), value_buffer) != 0)
-		return ESP_FAIL;
+static int set_config_csl(void (*config_function)(const char *), const char * value, uint8_t max_items, size_t option_count, ...){
+	//Check if given any configurations
+	size_t len = strlen(value);
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_HEARTBEAT_INTERVAL, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_HEARTBEAT_INTERVAL);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
+	if(len == 0){
+		ESP_LOGW(TAG, "Clearing configuration");
+		config_function("");
+		return 0;
 	}
-}
 
-esp_err_t add_configuration_ocpp_light_intensity(cJSON * key_list){
-	uint8_t intensity_percentage = (uint8_t)floor(storage_Get_HmiBrightness() * 100);
+	//Remove whitespace and check for control chars
+	char * value_prepared = malloc(len +1);
+	char * config_str = NULL;
 
-	if(write_configuration_u8(intensity_percentage, value_buffer) != 0)
-		return ESP_FAIL;
+	size_t prepared_index = 0;
+	for(size_t i = 0; i < len+1; i++){
+		if(!isspace((unsigned char)value[i])){
+			if(iscntrl((unsigned char)value[i])){
+				if(value[i]== '\0'){
+					value_prepared[prepared_index++] = value[i];
+					break;
+				}else{
+					ESP_LOGW(TAG, "CSL contains unexpected control character");
+					goto error; // Dont trust input with unexpected control characters
+				}
+			}
+			value_prepared[prepared_index++] = value[i];
+		}
+	}
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_LIGHT_INTENSITY, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_LIGHT_INTENSITY);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
+	//Check if given configuration was only space
+	if(strlen(value_prepared) == 0){
+		ESP_LOGW(TAG, "CSL contained no relevant data");
+		goto error;
 	}
-}
+	size_t item_count = 1;
 
-esp_err_t add_configuration_ocpp_local_authorize_offline(cJSON * key_list){
-	if(write_configuration_bool(storage_Get_ocpp_local_authorize_offline(), value_buffer) != 0)
-		return ESP_FAIL;
+	// Check if number of items exceed max
+	char * delimiter_ptr = value_prepared;
+	for(size_t i = 0; i < max_items + 1; i++){
+		delimiter_ptr = strchr(delimiter_ptr, ',');
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_LOCAL_AUTHORIZE_OFFLINE, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_LOCAL_AUTHORIZE_OFFLINE);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
+		if(delimiter_ptr == NULL){
+			break;
+		}else{
+			delimiter_ptr++;
+			item_count++;
+		}
 	}
-}
 
-esp_err_t add_configuration_ocpp_local_pre_authorize(cJSON * key_list){
-	if(write_configuration_bool(storage_Get_ocpp_local_pre_authorize(), value_buffer) != 0)
-		return ESP_FAIL;
+	if(item_count > max_items){
+		ESP_LOGW(TAG, "CSL item count exceed maximum number of values: %zu/%" PRIu8, item_count, max_items);
+		goto error;
+	}
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_LOCAL_PRE_AUTHORIZE, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_LOCAL_PRE_AUTHORIZE);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
+	config_str = strdup(value_prepared);
+	if(config_str == NULL){
+		ESP_LOGE(TAG, "Unable to duplicat CSL");
+		goto error;
 	}
-}
 
-esp_err_t add_configuration_ocpp_max_energy_on_invalid_id(cJSON * key_list){
-	return ESP_ERR_NOT_SUPPORTED;
-}
+	char * config_position = config_str; // used to change case insensensitive input to case sensitive.
 
-esp_err_t add_configuration_ocpp_message_timeout(cJSON * key_list){
-	if(write_configuration_u16(storage_Get_ocpp_message_timeout(), value_buffer) != 0)
-		return ESP_FAIL;
+	// Check if each item is among options
+	char * token = strtok(value_prepared, ",");
+	while(token != NULL){
+		va_list argument_ptr;
+		bool is_valid = false;
+		const char * enum_value;
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_MESSAGE_TIMEOUT, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_MESSAGE_TIMEOUT);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
-}
+		va_start(argument_ptr, option_count);
+		for(int i = 0; i < option_count; i++){
+			 enum_value = va_arg(argument_ptr, const char *);
+			if(strncasecmp(token, enum_value, strlen(enum_value)) == 0){
+				is_valid = true;
 
-esp_err_t add_configuration_ocpp_meter_values_aligned_data(cJSON * key_list){
-	if(strlen(storage_Get_ocpp_meter_values_aligned_data()) > 500)
-		return ESP_FAIL;
+				strncpy(config_position, enum_value, strlen(enum_value)); // Use case sensitive version
+				config_position += strlen(enum_value);
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_METER_VALUES_ALIGNED_DATA, false, storage_Get_ocpp_meter_values_aligned_data());
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_METER_VALUES_ALIGNED_DATA);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
-}
+				break;
+			}
+		}
 
-esp_err_t add_configuration_ocpp_meter_values_aligned_data_max_length(cJSON * key_list){
-	if(write_configuration_u8(CONFIG_OCPP_METER_VALUES_ALIGNED_DATA_MAX_LENGTH, value_buffer) != 0)
-		return ESP_FAIL;
+		va_end(argument_ptr);
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_METER_VALUES_ALIGNED_DATA_MAX_LENGTH, true, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_METER_VALUES_ALIGNED_DATA_MAX_LENGTH);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
-}
+		if(!is_valid){
+			ESP_LOGW(TAG, "CSL contained invalid item: '%s'", token);
+			goto error;
+		}
 
-esp_err_t add_configuration_ocpp_meter_values_sampled_data(cJSON * key_list){
-	if(strlen(storage_Get_ocpp_meter_values_sampled_data()) > 500)
-		return ESP_FAIL;
+		char phase_buffer[6] = {0};
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_METER_VALUES_SAMPLED_DATA, false, storage_Get_ocpp_meter_values_sampled_data());
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_METER_VALUES_SAMPLED_DATA);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
-}
+		if(csl_expect_phase(enum_value)){
+			const char * phase_index = csl_token_get_phase_index(token);
+			if((phase_index != NULL && phase_index[3] != '\0')
+				|| (phase_index == NULL && token[strlen(enum_value)] != '\0')){
 
-esp_err_t add_configuration_ocpp_meter_values_sampled_data_max_length(cJSON * key_list){
-	if(write_configuration_u8(CONFIG_OCPP_METER_VALUES_SAMPLED_DATA_MAX_LENGTH, value_buffer) != 0)
-		return ESP_FAIL;
+				ESP_LOGW(TAG, "CSL item did not end after %s", (phase_buffer[0] == 0) ? "token" : "phase");
+				goto error;
+			}else if(phase_index != NULL){
+				config_position[1] = 'L'; // Make sure the 'L' in .L1, .L2 or .L3 is uppercase
+			}
+		}else{
+			if(token[strlen(enum_value)] != '\0'){
+				ESP_LOGW(TAG, "Initial part of CSL contained valid item, but contains unsupported continuation");
+				goto error;
+			}
+		}
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_METER_VALUES_SAMPLED_DATA_MAX_LENGTH, true, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_METER_VALUES_SAMPLED_DATA_MAX_LENGTH);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
+		token = strtok(NULL, ",");
+		config_position = index(config_position, ',');
+		if(config_position != NULL)
+			config_position++;
 	}
-}
-
-esp_err_t add_configuration_ocpp_meter_value_sample_interval(cJSON * key_list){
-	if(write_configuration_u32(storage_Get_ocpp_meter_value_sample_interval(), value_buffer) != 0)
-		return ESP_FAIL;
+	free(value_prepared);
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_METER_VALUE_SAMPLE_INTERVAL, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_METER_VALUE_SAMPLE_INTERVAL);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
-}
+	ESP_LOGI(TAG, "Writing CSL value: '%s'", config_str);
+	config_function(config_str);
+	free(config_str);
 
-esp_err_t add_configuration_ocpp_minimum_status_duration(cJSON * key_list){
-	if(write_configuration_u32(storage_Get_ocpp_minimum_status_duration(), value_buffer) != 0)
-		return ESP_FAIL;
+	return 0;
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_MINIMUM_STATUS_DURATION, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_MINIMUM_STATUS_DURATION);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+error:
+	free(value_prepared);
+	free(config_str);
+	return -1;
 }
 
-esp_err_t add_configuration_ocpp_number_of_connectors(cJSON * key_list){
-	if(write_configuration_u8(CONFIG_OCPP_NUMBER_OF_CONNECTORS, value_buffer) != 0)
-		return ESP_FAIL;
-
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_NUMBER_OF_CONNECTORS, true, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_NUMBER_OF_CONNECTORS);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+static int set_csl_measurands(void (*config_function)(const char *), const char * value){
+	return set_config_csl(config_function, value, DEFAULT_CSL_LENGTH, 7,
+			OCPP_MEASURAND_CURRENT_IMPORT,
+			OCPP_MEASURAND_CURRENT_OFFERED,
+			OCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER,
+			OCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_INTERVAL,
+			OCPP_MEASURAND_POWER_ACTIVE_IMPORT,
+			OCPP_MEASURAND_TEMPERATURE,
+			OCPP_MEASURAND_VOLTAGE
+			);
 }
 
-esp_err_t add_configuration_ocpp_reset_retries(cJSON * key_list){
-	if(write_configuration_u8(storage_Get_ocpp_reset_retries(), value_buffer) != 0)
-		return ESP_FAIL;
+static int set_meter_values_aligned_data(const char * value){
+	return set_csl_measurands(storage_Set_ocpp_meter_values_aligned_data, value);
+}
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_RESET_RETRIES, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_RESET_RETRIES);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+static const char * get_meter_values_aligned_data(char * buffer, size_t buffer_size){
+	return storage_Get_ocpp_meter_values_aligned_data();
 }
 
-esp_err_t add_configuration_ocpp_stop_transaction_max_meter_values(cJSON * key_list){
-	if(write_configuration_u16(CONFIG_OCPP_STOP_TRANSACTION_MAX_METER_VALUES, value_buffer) != 0)
-		return ESP_FAIL;
+static int set_meter_values_sampled_data(const char * value){
+	return set_csl_measurands(storage_Set_ocpp_meter_values_sampled_data, value);
+}
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_STOP_TRANSACTION_MAX_METER_VALUES, true, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_STOP_TRANSACTION_MAX_METER_VALUES);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+static const char * get_meter_values_sampled_data(char * buffer, size_t buffer_size){
+	return storage_Get_ocpp_meter_values_sampled_data();
 }
 
-esp_err_t add_configuration_ocpp_stop_transaction_on_ev_side_disconnect(cJSON * key_list){
-	if(write_configuration_bool(storage_Get_ocpp_stop_transaction_on_ev_side_disconnect(), value_buffer) != 0)
-		return ESP_FAIL;
+static int set_stop_txn_aligned_data(const char * value){
+	return set_csl_measurands(storage_Set_ocpp_stop_txn_aligned_data, value);
+}
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_STOP_TRANSACTION_ON_EV_SIDE_DISCONNECT, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_STOP_TRANSACTION_ON_EV_SIDE_DISCONNECT);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+static const char * get_stop_txn_aligned_data(char * buffer, size_t buffer_size){
+	return storage_Get_ocpp_stop_txn_aligned_data();
 }
 
-esp_err_t add_configuration_ocpp_stop_transaction_on_invalid_id(cJSON * key_list){
-	if(write_configuration_bool(storage_Get_ocpp_stop_transaction_on_invalid_id(), value_buffer) != 0)
-		return ESP_FAIL;
+static int set_stop_txn_sampled_data(const char * value){
+	return set_csl_measurands(storage_Set_ocpp_stop_txn_sampled_data, value);
+}
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_STOP_TRANSACTION_ON_INVALID_ID, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_STOP_TRANSACTION_ON_INVALID_ID);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+static const char * get_stop_txn_sampled_data(char * buffer, size_t buffer_size){
+	return storage_Get_ocpp_stop_txn_sampled_data();
 }
 
-esp_err_t add_configuration_ocpp_stop_txn_aligned_data(cJSON * key_list){
-	if(strlen(storage_Get_ocpp_stop_txn_aligned_data()) > 500)
-		return ESP_FAIL;
+static const char * get_connector_phase_rotation(char * buffer, size_t buffer_size){
+	size_t offset = 0;
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_STOP_TXN_ALIGNED_DATA, false, storage_Get_ocpp_stop_txn_aligned_data());
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_STOP_TXN_ALIGNED_DATA);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
+	for(size_t i = 0; i <= CONFIG_OCPP_NUMBER_OF_CONNECTORS && offset < buffer_size; i++){
+		offset += snprintf(buffer + offset, buffer_size - offset, "%s%u.%s", (i > 0) ? "," : "", i,
+				convert_to_ocpp_phase(storage_Get_PhaseRotation()));
 	}
+
+	return buffer;
 }
 
-esp_err_t add_configuration_ocpp_stop_txn_aligned_data_max_length(cJSON * key_list){
-	if(write_configuration_u16(CONFIG_OCPP_STOP_TXN_ALIGNED_DATA_MAX_LENGTH, value_buffer) != 0)
-		return ESP_FAIL;
+static int set_connector_phase_rotation(const char * value){
+	/*
+	 * The go represent connector phase rotation via wire index. OCPP uses three letters (R,S and T) representing L1, L2, L3 optionally
+	 * prefixed by the connector. Since the Go only has one connector, it has been decided that it will reject a request to set
+	 * connector 0 to a different value than connector 1, and setting either will be reported as both values updated.
+	 */
+	_Static_assert(CONFIG_OCPP_NUMBER_OF_CONNECTORS == 1, "Logic for ocpp connector phase rotation configuration is only valid with 1 connector");
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_STOP_TXN_ALIGNED_DATA_MAX_LENGTH, true, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_STOP_TXN_ALIGNED_DATA_MAX_LENGTH);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
-}
+	size_t value_count = 0; // Number of items in the CSL type (number of seperate connectors configured)
 
-esp_err_t add_configuration_ocpp_stop_txn_sampled_data(cJSON * key_list){
-	if(strlen(storage_Get_ocpp_stop_txn_sampled_data()) > 500)
-		return ESP_FAIL;
+	enum ocpp_phase_rotation_id phase_rotation_id = -1;
+	uint8_t grid_type = MCU_GetGridType();
+	size_t offset = 0;
+	uint8_t configured_connector_mask = 0;
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_STOP_TXN_SAMPLED_DATA, false, storage_Get_ocpp_stop_txn_sampled_data());
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_STOP_TXN_SAMPLED_DATA);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
-}
+	char phase_rotation_buffer[16];
 
-esp_err_t add_configuration_ocpp_stop_txn_sampled_data_max_length(cJSON * key_list){
-	if(write_configuration_u16(CONFIG_OCPP_STOP_TXN_SAMPLED_DATA_MAX_LENGTH, value_buffer) != 0)
-		return ESP_FAIL;
+	int err = 0;
+	size_t data_length = strlen(value);
+	while(data_length > 0 && isspace((unsigned char)value[data_length]))
+		data_length--;
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_STOP_TXN_SAMPLED_DATA_MAX_LENGTH, true, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_STOP_TXN_SAMPLED_DATA_MAX_LENGTH);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
-}
+	while(offset < data_length){
+		if(++value_count > CONFIG_OCPP_CONNECTOR_PHASE_ROTATION_MAX_LENGTH){
+			ESP_LOGW(TAG, "Number of CSL value in new connector phase rotation exceed max");
+			err = -1;
+			break;
+		}
 
-esp_err_t add_configuration_ocpp_supported_feature_profiles(cJSON * key_list){
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_SUPPORTED_FEATURE_PROFILES, true,
-							CONFIG_OCPP_SUPPORTED_FEATURE_PROFILES);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_SUPPORTED_FEATURE_PROFILES);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
-}
+		if(value_count > 1){
+			if(value[offset] == ','){
+				offset++;
+			}else{
+				ESP_LOGW(TAG, "Expected ',' separated list");
+			}
+		}
 
-esp_err_t add_configuration_ocpp_supported_feature_profiles_max_length(cJSON * key_list){
-	if(write_configuration_u8(CONFIG_OCPP_SUPPORTED_FEATURE_PROFILES_MAXL_ENGTH, value_buffer) != 0)
-		return ESP_FAIL;
+		while(isspace((unsigned char)value[offset]))
+			offset++;
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_SUPPORTED_FEATURE_PROFILES_MAX_LENGTH, true, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_SUPPORTED_FEATURE_PROFILES_MAX_LENGTH);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
-}
+		if(isdigit((unsigned char)value[offset])){
+			int connector = atoi(&value[offset]);
+			if(value[offset+1] == '.' && ((configured_connector_mask & 1 << connector) == 0) && connector <= CONFIG_OCPP_NUMBER_OF_CONNECTORS){
+				configured_connector_mask = configured_connector_mask | 1 << connector;
+			}else{
+				ESP_LOGW(TAG, "Invalid use of connector prefix in connector phase rotation");
+				err = -1;
+				break;
+			}
 
-esp_err_t add_configuration_ocpp_transaction_message_attempts(cJSON * key_list){
-	if(write_configuration_u8(storage_Get_ocpp_transaction_message_attempts(), value_buffer) != 0)
-		return ESP_FAIL;
+			offset += 2; //skip past connector id and the . seperating it from its rotation
+		}
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_TRANSACTION_MESSAGE_ATTEMPTS, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_TRANSACTION_MESSAGE_ATTEMPTS);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
-}
+		size_t i = 0;
+		for(; i < sizeof(phase_rotation_buffer); i++){
+			if(isalpha((unsigned char)value[offset])){
+				phase_rotation_buffer[i] = value[offset];
+				offset++;
+			}else{
+				break;
+			}
+		}
 
-esp_err_t add_configuration_ocpp_transaction_message_retry_interval(cJSON * key_list){
-	if(write_configuration_u16(storage_Get_ocpp_transaction_message_retry_interval(), value_buffer) != 0)
-		return ESP_FAIL;
+		phase_rotation_buffer[i] = '\0';
+		enum ocpp_phase_rotation_id new_phase_rotation_id = ocpp_phase_rotation_to_id(phase_rotation_buffer);
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_TRANSACTION_MESSAGE_RETRY_INTERVAL, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_TRANSACTION_MESSAGE_RETRY_INTERVAL);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
-}
+		if(phase_rotation_id == -1){
+			if(new_phase_rotation_id == -1){
+				ESP_LOGE(TAG, "Got invalid phase rotation: %s", phase_rotation_buffer);
+				err = -1;
+				break;
 
-esp_err_t add_configuration_ocpp_unlock_connector_on_ev_side_disconnect(cJSON * key_list){
-	if(write_configuration_bool(storage_Get_ocpp_unlock_connector_on_ev_side_disconnect(), value_buffer) != 0)
-		return ESP_FAIL;
+			}else{
+				if(grid_type == NETWORK_NONE){
+					ESP_LOGE(TAG, "Requested to set phase rotation, but no grid type was detected. Unable to validate or set rotation");
+					err = -1;
+					break;
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_UNLOCK_CONNECTOR_ON_EV_SIDE_DISCONNECT, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_UNLOCK_CONNECTOR_ON_EV_SIDE_DISCONNECT);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
-}
+				}else if((grid_type == NETWORK_1P3W || grid_type == NETWORK_1P4W) && (new_phase_rotation_id != eOCPP_PHASE_ROTATION_NOT_APPLICABLE && new_phase_rotation_id != eOCPP_PHASE_ROTATION_UNKNOWN)){
+					ESP_LOGE(TAG, "Got phase rotation not supported with detected single phase grid"); // All attempts to change rotation away from NotApplicable on UK OPEN should hit this
+					err = -1;
+					break;
 
-esp_err_t add_configuration_ocpp_websocket_ping_interval(cJSON * key_list){
-	uint32_t ping_interval = storage_Get_ocpp_websocket_ping_interval();
-	if(ping_interval == UINT32_MAX)
-		ping_interval = 0;
+				}else if((grid_type == NETWORK_3P3W || grid_type == NETWORK_3P4W) && new_phase_rotation_id == eOCPP_PHASE_ROTATION_NOT_APPLICABLE){
+					ESP_LOGE(TAG, "Got NotApplicable phase rotation (for single phase or DC charge point) when grid indicate three phase");
+					err = -1;
+					break;
+				}
+			}
 
-	if(write_configuration_u32(ping_interval, value_buffer) != 0)
-		return ESP_FAIL;
+			phase_rotation_id = new_phase_rotation_id;
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_WEBSOCKET_PING_INTERVAL, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_WEBSOCKET_PING_INTERVAL);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
+		}else if(phase_rotation_id != new_phase_rotation_id){
+			ESP_LOGE(TAG, "The connectors phase rotations do not match: %d != %d", phase_rotation_id, new_phase_rotation_id);
+			err = -1;
+			break;
+		}
 	}
-}
 
-esp_err_t add_configuration_ocpp_supported_file_transfer_protocols(cJSON * key_list){
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_SUPPORTED_FILE_TRANSFER_PROTOCOLS, true,
-							CONFIG_OCPP_SUPPORTED_FILE_TRANSFER_PROTOCOLS);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_SUPPORTED_FILE_TRANSFER_PROTOCOLS);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
+	if(err == 0){
+		uint8_t wire_index = convert_from_ocpp_phase(phase_rotation_id, grid_type == NETWORK_1P3W || grid_type == NETWORK_3P3W);
+		ESP_LOGI(TAG, "New phase rotation wire index is %d", wire_index);
+		storage_Set_PhaseRotation(wire_index);
 	}else{
-		return ESP_OK;
+		ESP_LOGE(TAG, "Unable to configure phase rotation");
 	}
+	return err;
 }
 
-esp_err_t add_configuration_ocpp_local_auth_list_enabled(cJSON * key_list){
-	if(write_configuration_bool(storage_Get_ocpp_local_auth_list_enabled(), value_buffer) != 0)
-		return ESP_FAIL;
+static const char * get_light_intensity(char * buffer, size_t buffer_size){
+	uint8_t intensity_percentage = (uint8_t)floor(storage_Get_HmiBrightness() * 100);
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_LOCAL_AUTH_LIST_ENABLED, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_LOCAL_AUTH_LIST_ENABLED);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+	snprintf(buffer, buffer_size, "%" PRIu8, intensity_percentage);
+	return buffer;
 }
 
-esp_err_t add_configuration_ocpp_local_auth_list_max_length(cJSON * key_list){
-	if(write_configuration_u16(CONFIG_OCPP_LOCAL_AUTH_LIST_MAX_LENGTH, value_buffer) != 0)
-		return ESP_FAIL;
+static int set_light_intensity(const char * value){
+	char * endptr;
+	long value_long = strtol(value, &endptr, 0);
+
+	if(endptr == value || endptr[0] != '\0' || value_long < 0 || value_long > 100)
+		return -1;
+
+	float intensity = value_long / 100.0f;
+
+	MessageType ret = MCU_SendFloatParameter(HmiBrightness, intensity);
+	if(ret == MsgWriteAck)
+	{
+		ESP_LOGI(TAG, "Set hmiBrightness: %f", intensity);
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_LOCAL_AUTH_LIST_MAX_LENGTH, true, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_LOCAL_AUTH_LIST_MAX_LENGTH);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
+		storage_Set_HmiBrightness(intensity);
+		return 0;
 	}else{
-		return ESP_OK;
+		ESP_LOGE(TAG, "Unable to change hmi brightness");
+		return -1;
 	}
 }
 
-esp_err_t add_configuration_ocpp_send_local_list_max_length(cJSON * key_list){
-	if(write_configuration_u8(CONFIG_OCPP_SEND_LOCAL_LIST_MAX_LENGTH, value_buffer) != 0)
-		return ESP_FAIL;
+static uint32_t get_websocket_ping_interval(){
+	uint32_t ping_interval = storage_Get_ocpp_websocket_ping_interval();
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_SEND_LOCAL_LIST_MAX_LENGTH, true, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_SEND_LOCAL_LIST_MAX_LENGTH);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+	return (ping_interval == UINT32_MAX) ? 0 : ping_interval;
 }
 
-esp_err_t add_configuration_ocpp_reserve_connector_zero_supported(cJSON * key_list){
-#ifdef CONFIG_OCPP_RESERVE_CONNECTOR_ZERO_SUPPORTED
-	if(write_configuration_bool(CONFIG_OCPP_RESERVE_CONNECTOR_ZERO_SUPPORTED, value_buffer) != 0)
-		return ESP_FAIL;
-
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_RESERVE_CONNECTOR_ZERO_SUPPORTED, true, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_RESERVE_CONNECTOR_ZERO_SUPPORTED);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
-#else
-	return ESP_FAIL_UNKONOWN;
-#endif
+static void set_websocket_ping_interval(uint32_t ping_interval){
+	if(ping_interval == 0) // ocpp treats 0 as "no ping" esp_websocket treats 0 as "default value"
+		ping_interval = UINT32_MAX; //esp_websocket does not support "no ping" instead we set it to max
+
+	storage_Set_ocpp_websocket_ping_interval(ping_interval);
 }
 
-esp_err_t add_configuration_ocpp_charge_profile_max_stack_level(cJSON * key_list){
-	if(write_configuration_u8(CONFIG_OCPP_CHARGE_PROFILE_MAX_STACK_LEVEL, value_buffer) != 0)
-		return ESP_FAIL;
+static int set_authorization_key(const char * value){
+	if(!is_ci_string_type(value, 40) || strlen(value) < 16) // Type is string not ci_string, but validation should be same
+		return -1;
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_CHARGE_PROFILE_MAX_STACK_LEVEL, true, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_CHARGE_PROFILE_MAX_STACK_LEVEL);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+	storage_Set_ocpp_authorization_key(value);
+	storage_Set_authorization_key_set_from_zaptec_ocpp(false);
+
+	return 0;
 }
 
-esp_err_t add_configuration_ocpp_charging_schedule_allowed_charging_rate_unit(cJSON * key_list){
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_CHARGING_SCHEDULE_ALLOWED_CHARGING_RATE_UNIT, true,
-							CONFIG_OCPP_CHARGING_SCHEDULE_ALLOWED_CHARGING_RATE_UNIT);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_CHARGING_SCHEDULE_ALLOWED_CHARGING_RATE_UNIT);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+static bool is_valid_default_id_token(const char * value){
+	return is_ci_string_type(value, 20);
 }
 
-esp_err_t add_configuration_ocpp_charging_schedule_max_periods(cJSON * key_list){
-	if(write_configuration_u8(CONFIG_OCPP_CHARGING_SCHEDULE_MAX_PERIODS, value_buffer) != 0)
-		return ESP_FAIL;
+static bool get_AuthenticationRequired_bool(){
+	return storage_Get_AuthenticationRequired() != 0;
+}
 
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_CHARGING_SCHEDULE_MAX_PERIODS, true, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_CHARGING_SCHEDULE_MAX_PERIODS);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+static void on_allow_offline_tx_for_unknown_id_changed(){
+	ocpp_change_allow_offline_for_unknown(storage_Get_ocpp_allow_offline_tx_for_unknown_id());
 }
 
-esp_err_t add_configuration_ocpp_connector_switch_3_to_1_phase_supported(cJSON * key_list){
-#ifdef CONFIG_OCPP_CONNECTOR_SWITCH_3_TO_1_PHASE_SUPPORTED
-	if(write_configuration_bool(CONFIG_OCPP_CONNECTOR_SWITCH_3_TO_1_PHASE_SUPPORTED, value_buffer) != 0)
-		return ESP_FAIL;
-
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_CONNECTOR_SWITCH_3_TO_1_PHASE_SUPPORTED, true, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_CONNECTOR_SWITCH_3_TO_1_PHASE_SUPPORTED);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
-#else
-	return ESP_ERR_NOT_SUPPORTED;
-#endif
+static void on_authorization_cache_enabled_changed(){
+	ocpp_change_auth_cache_enabled(storage_Get_ocpp_authorization_cache_enabled());
 }
 
-esp_err_t add_configuration_ocpp_max_charging_profiles_installed(cJSON * key_list){
-	if(write_configuration_u8(CONFIG_OCPP_MAX_CHARGING_PROFILES_INSTALLED, value_buffer) != 0)
-		return ESP_FAIL;
-
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_MAX_CHARGING_PROFILES_INSTALLED, true, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_MAX_CHARGING_PROFILES_INSTALLED);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+static void on_heartbeat_interval_changed(){
+	update_heartbeat_timer(storage_Get_ocpp_heartbeat_interval());
 }
 
-// TODO: remove unnecessary write_configuration calls for readonly configurations
-
-esp_err_t add_configuration_ocpp_additional_root_certificate_check(cJSON * key_list){
-	return ESP_ERR_NOT_SUPPORTED;
+static void on_local_authorize_offline_changed(){
+	ocpp_change_authorize_offline(storage_Get_ocpp_local_authorize_offline());
 }
 
-esp_err_t add_configuration_ocpp_certificate_signed_max_chain_size(cJSON * key_list){
-	return ESP_ERR_NOT_SUPPORTED;
+static void on_local_pre_authorize_changed(){
+	ocpp_change_local_pre_authorize(storage_Get_ocpp_local_pre_authorize());
 }
 
-esp_err_t add_configuration_ocpp_certificate_store_max_length(cJSON * key_list){
-	return ESP_ERR_NOT_SUPPORTED;
+static void on_message_timeout_changed(){
+	ocpp_change_message_timeout(storage_Get_ocpp_message_timeout());
 }
 
-esp_err_t add_configuration_ocpp_cpo_name(cJSON * key_list){
-	return ESP_ERR_NOT_SUPPORTED;
+static void on_meter_values_aligned_data_changed(){
+	invalidate_sampling_plans(eSAMPLING_PLAN_ALIGNED);
 }
 
-esp_err_t add_configuration_ocpp_security_profile(cJSON * key_list){
-	if(write_configuration_u8(storage_Get_ocpp_security_profile(), value_buffer) != 0)
-		return ESP_FAIL;
-
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_SECURITY_PROFILE, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_SECURITY_PROFILE);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+static void on_meter_values_sampled_data_changed(){
+	invalidate_sampling_plans(eSAMPLING_PLAN_SAMPLED);
 }
 
-// Non-standard configuration keys
-
-esp_err_t add_configuration_ocpp_default_id_token(cJSON * key_list){
-	if(strlen(storage_Get_ocpp_default_id_token()) > 500)
-		return ESP_FAIL;
-
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_DEFAULT_ID_TOKEN, false, storage_Get_ocpp_default_id_token());
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_DEFAULT_ID_TOKEN);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+static void on_stop_txn_aligned_data_changed(){
+	invalidate_sampling_plans(eSAMPLING_PLAN_STOP_TXN_ALIGNED);
 }
 
-esp_err_t add_configuration_ocpp_authorization_required(cJSON * key_list){
-	if(write_configuration_bool(storage_Get_AuthenticationRequired(), value_buffer) != 0)
-		return ESP_FAIL;
-
-	cJSON * key_value_json = create_key_value(OCPP_CONFIG_KEY_AUTHORIZATION_REQUIRED, false, value_buffer);
-	if(cJSON_AddItemToArray(key_list, key_value_json) != true){
-		ESP_LOGE(TAG, "Unable to add value_buffer for configuration key '%s'", OCPP_CONFIG_KEY_AUTHORIZATION_REQUIRED);
-		cJSON_Delete(key_value_json);
-		return ESP_FAIL;
-	}else{
-		return ESP_OK;
-	}
+static void on_stop_txn_sampled_data_changed(){
+	invalidate_sampling_plans(eSAMPLING_PLAN_STOP_TXN_SAMPLED);
 }
 
-static esp_err_t get_ocpp_configuration(const char * key, cJSON * configuration_out){
-
-	if(strcasecmp(key, OCPP_CONFIG_KEY_ALLOW_OFFLINE_TX_FOR_UNKNOWN_ID) == 0){
-		return add_configuration_ocpp_allow_offline_tx_for_unknown_id(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_AUTHORIZATION_CACHE_ENABLED) == 0){
-		return add_configuration_ocpp_authorization_cache_enabled(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_AUTHORIZE_REMOTE_TX_REQUESTS) == 0){
-		return add_configuration_ocpp_authorize_remote_tx_requests(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_BLINK_REPEAT) == 0){
-		return  add_configuration_ocpp_blink_repeat(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_CLOCK_ALIGNED_DATA_INTERVAL) == 0){
-		return add_configuration_ocpp_clock_aligned_data_interval(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_CONNECTION_TIMEOUT) == 0){
-		return add_configuration_ocpp_connection_timeout(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_CONNECTOR_PHASE_ROTATION) == 0){
-		return add_configuration_ocpp_connector_phase_rotation(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_CONNECTOR_PHASE_ROTATION_MAX_LENGTH) == 0){
-		return add_configuration_ocpp_connector_phase_rotation_max_length(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_GET_CONFIGURATION_MAX_KEYS) == 0){
-		return add_configuration_ocpp_get_configuration_max_keys(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_HEARTBEAT_INTERVAL) == 0){
-		return add_configuration_ocpp_heartbeat_interval(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_LIGHT_INTENSITY) == 0){
-		return add_configuration_ocpp_light_intensity(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_LOCAL_AUTHORIZE_OFFLINE) == 0){
-		return add_configuration_ocpp_local_authorize_offline(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_LOCAL_PRE_AUTHORIZE) == 0){
-		return add_configuration_ocpp_local_pre_authorize(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_MAX_ENERGY_ON_INVALID_ID) == 0){
-		return add_configuration_ocpp_max_energy_on_invalid_id(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_MESSAGE_TIMEOUT) == 0){
-		return add_configuration_ocpp_message_timeout(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_METER_VALUES_ALIGNED_DATA) == 0){
-		return add_configuration_ocpp_meter_values_aligned_data(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_METER_VALUES_ALIGNED_DATA_MAX_LENGTH) == 0){
-		return add_configuration_ocpp_meter_values_aligned_data_max_length(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_METER_VALUES_SAMPLED_DATA) == 0){
-		return add_configuration_ocpp_meter_values_sampled_data(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_METER_VALUES_SAMPLED_DATA_MAX_LENGTH) == 0){
-		return add_configuration_ocpp_meter_values_sampled_data(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_METER_VALUE_SAMPLE_INTERVAL) == 0){
-		return add_configuration_ocpp_meter_value_sample_interval(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_MINIMUM_STATUS_DURATION) == 0){
-		return add_configuration_ocpp_minimum_status_duration(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_NUMBER_OF_CONNECTORS) == 0){
-		return add_configuration_ocpp_number_of_connectors(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_RESET_RETRIES) == 0){
-		return add_configuration_ocpp_reset_retries(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_STOP_TRANSACTION_MAX_METER_VALUES) == 0){
-		return add_configuration_ocpp_stop_transaction_max_meter_values(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_STOP_TRANSACTION_ON_EV_SIDE_DISCONNECT) == 0){
-		return add_configuration_ocpp_stop_transaction_on_ev_side_disconnect(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_STOP_TRANSACTION_ON_INVALID_ID) == 0){
-		return add_configuration_ocpp_stop_transaction_on_invalid_id(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_STOP_TXN_ALIGNED_DATA) == 0){
-		return add_configuration_ocpp_stop_txn_aligned_data(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_STOP_TXN_ALIGNED_DATA_MAX_LENGTH) == 0){
-		return add_configuration_ocpp_stop_txn_aligned_data_max_length(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_STOP_TXN_SAMPLED_DATA) == 0){
-		return add_configuration_ocpp_stop_txn_sampled_data(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_STOP_TXN_SAMPLED_DATA_MAX_LENGTH) == 0){
-		return add_configuration_ocpp_stop_txn_sampled_data_max_length(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_SUPPORTED_FEATURE_PROFILES) == 0){
-		return add_configuration_ocpp_supported_feature_profiles(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_SUPPORTED_FEATURE_PROFILES_MAX_LENGTH) == 0){
-		return add_configuration_ocpp_supported_feature_profiles_max_length(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_TRANSACTION_MESSAGE_ATTEMPTS) == 0){
-		return add_configuration_ocpp_transaction_message_attempts(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_TRANSACTION_MESSAGE_RETRY_INTERVAL) == 0){
-		return add_configuration_ocpp_transaction_message_retry_interval(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_UNLOCK_CONNECTOR_ON_EV_SIDE_DISCONNECT) == 0){
-		return add_configuration_ocpp_unlock_connector_on_ev_side_disconnect(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_WEBSOCKET_PING_INTERVAL) == 0){
-		return add_configuration_ocpp_websocket_ping_interval(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_SUPPORTED_FILE_TRANSFER_PROTOCOLS) == 0){
-		return add_configuration_ocpp_supported_file_transfer_protocols(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_LOCAL_AUTH_LIST_ENABLED) == 0){
-		return add_configuration_ocpp_local_auth_list_enabled(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_LOCAL_AUTH_LIST_MAX_LENGTH) == 0){
-		return add_configuration_ocpp_local_auth_list_max_length(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_SEND_LOCAL_LIST_MAX_LENGTH) == 0){
-		return add_configuration_ocpp_send_local_list_max_length(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_RESERVE_CONNECTOR_ZERO_SUPPORTED) == 0){
-		return add_configuration_ocpp_reserve_connector_zero_supported(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_CHARGE_PROFILE_MAX_STACK_LEVEL) == 0){
-		return add_configuration_ocpp_charge_profile_max_stack_level(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_CHARGING_SCHEDULE_ALLOWED_CHARGING_RATE_UNIT) == 0){
-		return add_configuration_ocpp_charging_schedule_allowed_charging_rate_unit(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_CHARGING_SCHEDULE_MAX_PERIODS) == 0){
-		return add_configuration_ocpp_charging_schedule_max_periods(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_CONNECTOR_SWITCH_3_TO_1_PHASE_SUPPORTED) == 0){
-		return add_configuration_ocpp_connector_switch_3_to_1_phase_supported(configuration_out);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_ADDITIONAL_ROOT_CERTIFICATE_CHECK) == 0){
-		return add_configuration_ocpp_additional_root_certificate_check(configuration_out);
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_CERTIFICATE_SIGNED_MAX_CHAIN_SIZE) == 0){
-		return add_configuration_ocpp_certificate_signed_max_chain_size(configuration_out);
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_CERTIFICATE_STORE_MAX_LENGTH) == 0){
-		return add_configuration_ocpp_certificate_store_max_length(configuration_out);
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_CPO_NAME) == 0){
-		return add_configuration_ocpp_cpo_name(configuration_out);
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_SECURITY_PROFILE) == 0){
-		return add_configuration_ocpp_security_profile(configuration_out);
-
-		// Non-standard configuration keys
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_DEFAULT_ID_TOKEN) == 0){
-		return add_configuration_ocpp_default_id_token(configuration_out);
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_AUTHORIZATION_REQUIRED) == 0){
-		return add_configuration_ocpp_authorization_required(configuration_out);
-
-	}else{
-		return ESP_ERR_NOT_SUPPORTED;
-	}
-}
-
-void get_all_ocpp_configurations(cJSON * configuration_out){
-	add_configuration_ocpp_allow_offline_tx_for_unknown_id(configuration_out);
-	add_configuration_ocpp_authorization_cache_enabled(configuration_out);
-	add_configuration_ocpp_authorize_remote_tx_requests(configuration_out);
-	add_configuration_ocpp_blink_repeat(configuration_out);
-	add_configuration_ocpp_clock_aligned_data_interval(configuration_out);
-	add_configuration_ocpp_connection_timeout(configuration_out);
-	add_configuration_ocpp_connector_phase_rotation(configuration_out);
-	add_configuration_ocpp_connector_phase_rotation_max_length(configuration_out);
-	add_configuration_ocpp_get_configuration_max_keys(configuration_out);
-	add_configuration_ocpp_heartbeat_interval(configuration_out);
-	add_configuration_ocpp_light_intensity(configuration_out);
-	add_configuration_ocpp_local_authorize_offline(configuration_out);
-	add_configuration_ocpp_local_pre_authorize(configuration_out);
-	add_configuration_ocpp_max_energy_on_invalid_id(configuration_out);
-	add_configuration_ocpp_message_timeout(configuration_out);
-	add_configuration_ocpp_meter_values_aligned_data(configuration_out);
-	add_configuration_ocpp_meter_values_aligned_data_max_length(configuration_out);
-	add_configuration_ocpp_meter_values_sampled_data(configuration_out);
-	add_configuration_ocpp_meter_values_sampled_data_max_length(configuration_out);
-	add_configuration_ocpp_meter_value_sample_interval(configuration_out);
-	add_configuration_ocpp_minimum_status_duration(configuration_out);
-	add_configuration_ocpp_number_of_connectors(configuration_out);
-	add_configuration_ocpp_reset_retries(configuration_out);
-	add_configuration_ocpp_stop_transaction_max_meter_values(configuration_out);
-	add_configuration_ocpp_stop_transaction_on_ev_side_disconnect(configuration_out);
-	add_configuration_ocpp_stop_transaction_on_invalid_id(configuration_out);
-	add_configuration_ocpp_stop_txn_aligned_data(configuration_out);
-	add_configuration_ocpp_stop_txn_aligned_data_max_length(configuration_out);
-	add_configuration_ocpp_stop_txn_sampled_data(configuration_out);
-	add_configuration_ocpp_stop_txn_sampled_data_max_length(configuration_out);
-	add_configuration_ocpp_supported_feature_profiles(configuration_out);
-	add_configuration_ocpp_supported_feature_profiles_max_length(configuration_out);
-	add_configuration_ocpp_transaction_message_attempts(configuration_out);
-	add_configuration_ocpp_transaction_message_retry_interval(configuration_out);
-	add_configuration_ocpp_unlock_connector_on_ev_side_disconnect(configuration_out);
-	add_configuration_ocpp_websocket_ping_interval(configuration_out);
-	add_configuration_ocpp_supported_file_transfer_protocols(configuration_out);
-	add_configuration_ocpp_local_auth_list_enabled(configuration_out);
-	add_configuration_ocpp_local_auth_list_max_length(configuration_out);
-	add_configuration_ocpp_send_local_list_max_length(configuration_out);
-	add_configuration_ocpp_reserve_connector_zero_supported(configuration_out);
-	add_configuration_ocpp_charge_profile_max_stack_level(configuration_out);
-	add_configuration_ocpp_charging_schedule_allowed_charging_rate_unit(configuration_out);
-	add_configuration_ocpp_charging_schedule_max_periods(configuration_out);
-	add_configuration_ocpp_connector_switch_3_to_1_phase_supported(configuration_out);
-	add_configuration_ocpp_max_charging_profiles_installed(configuration_out);
-	add_configuration_ocpp_additional_root_certificate_check(configuration_out);
-	add_configuration_ocpp_certificate_signed_max_chain_size(configuration_out);
-	add_configuration_ocpp_certificate_store_max_length(configuration_out);
-	add_configuration_ocpp_cpo_name(configuration_out);
-	add_configuration_ocpp_security_profile(configuration_out);
-
-	// Non-standard configuration keys
-	add_configuration_ocpp_default_id_token(configuration_out);
-	add_configuration_ocpp_authorization_required(configuration_out);
+static void on_meter_value_sample_interval_changed(){
+	sessionHandler_OcppChangeSampleInterval(eOCPP_CONTEXT_OTHER);
 }
 
-static void get_configuration_cb(const char * unique_id, const char * action, cJSON * payload, void * cb_data){
-	ESP_LOGI(TAG, "Got request for get configuration");
-	char err_str[128];
-	enum ocppj_err_t err = eOCPPJ_NO_ERROR;
-
-	int key_length = 0;
-
-	if(cJSON_HasObjectItem(payload, "key")){
-		cJSON * key = cJSON_GetObjectItem(payload, "key");
-
-		if(!cJSON_IsArray(key)){
-			err = eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
-			sprintf(err_str, "Expected 'key' to be a valid array");
-
-			goto error;
-		}
-
-		key_length = cJSON_GetArraySize(key);
-
-		if(key_length > CONFIG_OCPP_GET_CONFIGURATION_MAX_KEYS){
-			err = eOCPPJ_ERROR_OCCURENCE_CONSTRAINT_VIOLATION;
-			snprintf(err_str, sizeof(err_str), "Length of 'key' (%d) exceed maximum lenght (%d)", key_length, CONFIG_OCPP_GET_CONFIGURATION_MAX_KEYS);
-
-			goto error;
-		}
-
-		for(size_t i = 0; i < key_length; i++){
-			cJSON * key_name = cJSON_GetArrayItem(key, i);
-			if(!cJSON_IsString(key_name) || !is_ci_string_type(key_name->valuestring, 50)){
-				err = eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
-				sprintf(err_str, "key %d is not a valid CiString50Type", i);
-
-				goto error;
-			}
-		}
-	}
-
-	cJSON * configuration_key = cJSON_CreateArray();
-	if(configuration_key == NULL){
-		err = eOCPPJ_ERROR_INTERNAL;
-		sprintf(err_str, "Unable to allocate memory for configurationKey");
-	}
-
-	size_t unknown_key_index = 0;
-	char * unknown_key[CONFIG_OCPP_GET_CONFIGURATION_MAX_KEYS] = {0};
-
-	if(key_length == 0){
-		get_all_ocpp_configurations(configuration_key);
-
-	}else if(key_length > 0){
-		cJSON * key = cJSON_GetObjectItem(payload, "key");
-
-		for(size_t i = 0; i < key_length; i++){
-			char * key_str = cJSON_GetArrayItem(key, i)->valuestring;
-			esp_err_t config_err = get_ocpp_configuration(key_str, configuration_key);
-
-			if(config_err != ESP_OK){
-				if(config_err != ESP_ERR_NOT_SUPPORTED){
-					ESP_LOGE(TAG, "Unexpected result when getting configuration: %s", esp_err_to_name(config_err));
-				}
-
-				unknown_key[unknown_key_index] = malloc(sizeof(char) * strlen(key_str) + 1);
-				if(unknown_key[unknown_key_index] == NULL){
-					ESP_LOGE(TAG, "Unable to allocate buffer for unknown key");
-				}else{
-					strcpy(unknown_key[unknown_key_index], key_str);
-					unknown_key_index++;
-				}
-			}
-		}
-	}
-
-	cJSON * response = ocpp_create_get_configuration_confirmation(unique_id, configuration_key, unknown_key_index, unknown_key);
-	for(size_t i = 0; i < unknown_key_index; i++){
-		free(unknown_key[i]);
-	}
-
-	if(response == NULL){
-		ESP_LOGE(TAG, "Unable to create configuration response");
-		goto error;
-	}else{
-		send_call_reply(response);
-	}
-
-	return;
-
-error:
-
-	if(err == ESP_OK){
-		ESP_LOGE(TAG, "get_configuration_cb reached error exit, but no error set");
-		err = eOCPPJ_ERROR_INTERNAL;
-		err_str[0] = '\0';
-	}else{
-		ESP_LOGE(TAG, "get_configuration_cb reached error exit: [%s]: '%s'", ocppj_error_code_from_id(err), err_str);
-	}
-
-	cJSON * ocpp_error = ocpp_create_call_error(unique_id, ocppj_error_code_from_id(err), err_str, NULL);
-	if(ocpp_error == NULL){
-		ESP_LOGE(TAG, "Unable to create call error for internal error");
-	}else{
-		send_call_reply(ocpp_error);
-	}
+static void on_minimum_status_duration_changed(){
+	ocpp_change_minimum_status_duration(storage_Get_ocpp_minimum_status_duration());
 }
 
-static void change_config_confirm(const char * unique_id, const char * configuration_status){
-	cJSON * response = ocpp_create_change_configuration_confirmation(unique_id, configuration_status);
-	if(response == NULL){
-		ESP_LOGE(TAG, "Unable to create change configuration confirmation");
-		return;
-	}else{
-		send_call_reply(response);
-	}
-}
-
-static bool is_valid_interval(uint32_t sec){
-	return sec <= CONFIG_OCPP_TIMER_MAX_SEC;
-}
-
-static bool is_valid_alignment_interval(uint32_t sec){
-	if(sec == 0)
-		return true;
-
-	return (86400 % sec) == 0 && is_valid_interval(sec);
-}
-
-static bool is_true(bool value){
-	return value;
-}
-
-static bool is_valid_security_profile(uint8_t security_profile){
-
-	//If the Charge Point receives a lower or equal value then currently configured, the Charge Point SHALL Rejected the ChangeConfiguration.req
-	if(security_profile <= storage_Get_ocpp_security_profile() || security_profile > 3) // Highest defined securityProfile is 3
-		return false;
-
-	if(security_profile == 0){
-		return true;
-
-	}else if(security_profile == 1){
-		if(storage_Get_ocpp_authorization_key()[0] == '\0')
-			return false;
-
-		return true;
-	}
-
-	return false;
-}
-
-static bool is_valid_message_timeout(uint16_t message_timeout){
-	if(message_timeout < CONFIG_OCPP_MESSAGE_TIMEOUT_MINIMUM)
-		return false;
-
-	return true;
+static void on_transaction_message_config_changed(){
+	update_transaction_message_related_config(
+		storage_Get_ocpp_transaction_message_attempts(),
+		storage_Get_ocpp_transaction_message_retry_interval());
 }
 
-static long validate_u(const char * value, uint32_t upper_bounds){
-	char * endptr;
-
-	errno = 0;
-	long value_long = strtol(value, &endptr, 0);
-	if(errno != 0 || endptr[0] != '\0'){
-		ESP_LOGE(TAG, "Not a valid unsigned integer: %s", strerror(errno));
-		return -1;
-	}
-
-	if(value_long < 0 || value_long > upper_bounds){
-		ESP_LOGE(TAG, "%ld Exceeds %" PRIu32, value_long, upper_bounds);
-		return -1;
+static void on_unlock_connector_on_ev_side_disconnect_changed(){
+	if(sessionHandler_OcppTransactionIsActive(0) || storage_Get_ocpp_unlock_connector_on_ev_side_disconnect()){
+		MessageType ret = MCU_SendUint8Parameter(PermanentCableLock, !storage_Get_ocpp_unlock_connector_on_ev_side_disconnect());
+		if(ret != MsgWriteAck){
+			ocpp_send_status_notification(-1, OCPP_CP_ERROR_OTHER_ERROR, "Unable to apply UnlockConnectorOnEVSideDisconnect",
+						NULL, NULL, true, false);
+			ESP_LOGE(TAG, "Unable to set UnlockConnectorOnEVSideDisconnect as a result of ChangeConfiguration.req");
+		}
 	}
-
-	return value_long;
-}
-
-void set_AuthenticationRequired_bool(bool newValue){
-	storage_Set_AuthenticationRequired(newValue ? 1 : 0);
-}
-
-static int set_config_u8(void (*config_function)(uint8_t), const char * value, bool (*additional_validation)(uint8_t)){
-	long value_long = validate_u(value, UINT8_MAX);
-
-	if(value_long == -1)
-		return -1;
-
-	if(additional_validation != NULL && additional_validation((uint8_t)value_long) == false)
-		return -1;
-
-	config_function((uint8_t)value_long);
-	return 0;
 }
 
-static int set_config_u16(void (*config_function)(uint16_t), const char * value, bool (*additional_validation)(uint16_t)){
-	long value_long = validate_u(value, UINT16_MAX);
-
-	if(value_long == -1)
-		return -1;
-
-	if(additional_validation != NULL && additional_validation((uint32_t)value_long) == false)
-		return -1;
-
-	config_function((uint16_t)value_long);
-	return 0;
-}
-
-static int set_config_u32(void (*config_function)(uint32_t), const char * value, bool (*additional_validation)(uint32_t)){
-	long value_long = validate_u(value, UINT32_MAX);
-
-	if(value_long == -1)
-		return -1;
-
-	if(additional_validation != NULL && additional_validation((uint32_t)value_long) == false)
-		return -1;
-
-	config_function((uint32_t)value_long);
-	return 0;
+static void on_websocket_ping_interval_changed(){
+	ESP_LOGI(TAG, "Setting new ping interval to: %" PRIu32, storage_Get_ocpp_websocket_ping_interval());
+	ocpp_change_websocket_ping_interval(storage_Get_ocpp_websocket_ping_interval());
 }
 
-static int set_config_bool(void (*config_function)(bool), const char * value, bool (*additional_validation)(bool)){
-	bool boolean_value;
-
-	if(strcasecmp(value, "true") == 0){
-		boolean_value = true;
-	}else if(strcasecmp(value, "false") == 0){
-		boolean_value = false;
-	}else{
-		return -1;
-	}
-
-	if(additional_validation != NULL && additional_validation(boolean_value) == false)
-		return -1;
-
-	config_function(boolean_value);
-	return 0;
+static void on_local_auth_list_enabled_changed(){
+	ocpp_change_auth_list_enabled(storage_Get_ocpp_local_auth_list_enabled());
 }
 
-bool csl_expect_phase(const char * option){
-	if(strcmp(option, OCPP_MEASURAND_CURRENT_IMPORT) == 0
-		|| strcmp(option, OCPP_MEASURAND_TEMPERATURE) == 0
-		|| strcmp(option, OCPP_MEASURAND_VOLTAGE) == 0
-		){
-
-		return true;
-	}else{
-		return false;
-	}
+static void on_security_profile_changed(){
+	// is_valid_security_profile only accepts a higher profile, so any accepted change requires a new connection
+	ocpp_end_and_reconnect(true);
 }
 
-static int set_config_csl(void (*config_function)(const char *), const char * value, uint8_t max_items, size_t option_count, ...){
-	//Check if given any configurations
-	size_t len = strlen(value);
-
-	if(len == 0){
-		ESP_LOGW(TAG, "Clearing configuration");
-		config_function("");
-		return 0;
-	}
-
-	//Remove whitespace and check for control chars
-	char * value_prepared = malloc(len +1);
-	char * config_str = NULL;
-
-	size_t prepared_index = 0;
-	for(size_t i = 0; i < len+1; i++){
-		if(!isspace((unsigned char)value[i])){
-			if(iscntrl((unsigned char)value[i])){
-				if(value[i]== '\0'){
-					value_prepared[prepared_index++] = value[i];
-					break;
-				}else{
-					ESP_LOGW(TAG, "CSL contains unexpected control character");
-					goto error; // Dont trust input with unexpected control characters
-				}
-			}
-			value_prepared[prepared_index++] = value[i];
-		}
-	}
-
-	//Check if given configuration was only space
-	if(strlen(value_prepared) == 0){
-		ESP_LOGW(TAG, "CSL contained no relevant data");
-		goto error;
-	}
-	size_t item_count = 1;
-
-	// Check if number of items exceed max
-	char * delimiter_ptr = value_prepared;
-	for(size_t i = 0; i < max_items + 1; i++){
-		delimiter_ptr = strchr(delimiter_ptr, ',');
-
-		if(delimiter_ptr == NULL){
-			break;
-		}else{
-			delimiter_ptr++;
-			item_count++;
-		}
+static void on_authorization_required_changed(){
+	MessageType ret = MCU_SendUint8Parameter(AuthenticationRequired, storage_Get_AuthenticationRequired());
+	if(ret == MsgWriteAck)
+	{
+		ESP_LOGI(TAG, "OCPP set AuthenticationRequired on dsPIC success: %" PRIu8, storage_Get_AuthenticationRequired());
 	}
+	else
+	{
+		ESP_LOGE(TAG, "OCPP set AuthenticationRequired on dsPIC failed: %" PRIu8, storage_Get_AuthenticationRequired());
+	}
+}
+
+#define CONFIG_VALUE_STR(value) #value
+#define CONFIG_VALUE(value) CONFIG_VALUE_STR(value)
+
+#define CONFIG_KEY_CONSTANT(name, value) {.key = name, .type = eOCPP_CONFIG_TYPE_CONSTANT, .read_only = true, .constant = value}
+
+/*
+ * All supported configuration keys in the order they are reported by GetConfiguration.req without keys. Keys that are
+ * known but not supported are omitted and handled by is_configuration_key.
+ */
+static const struct ocpp_config_key config_keys[] = {
+	{.key = OCPP_CONFIG_KEY_ALLOW_OFFLINE_TX_FOR_UNKNOWN_ID, .type = eOCPP_CONFIG_TYPE_BOOL,
+	 .get.boolean = storage_Get_ocpp_allow_offline_tx_for_unknown_id, .set.boolean = storage_Set_ocpp_allow_offline_tx_for_unknown_id,
+	 .on_change = on_allow_offline_tx_for_unknown_id_changed},
+	{.key = OCPP_CONFIG_KEY_AUTHORIZATION_CACHE_ENABLED, .type = eOCPP_CONFIG_TYPE_BOOL,
+	 .get.boolean = storage_Get_ocpp_authorization_cache_enabled, .set.boolean = storage_Set_ocpp_authorization_cache_enabled,
+	 .on_change = on_authorization_cache_enabled_changed},
+	{.key = OCPP_CONFIG_KEY_AUTHORIZE_REMOTE_TX_REQUESTS, .type = eOCPP_CONFIG_TYPE_BOOL,
+	 .get.boolean = storage_Get_ocpp_authorize_remote_tx_requests, .set.boolean = storage_Set_ocpp_authorize_remote_tx_requests},
+	{.key = OCPP_CONFIG_KEY_CLOCK_ALIGNED_DATA_INTERVAL, .type = eOCPP_CONFIG_TYPE_U32,
+	 .get.u32 = storage_Get_ocpp_clock_aligned_data_interval, .set.u32 = storage_Set_ocpp_clock_aligned_data_interval,
+	 .validate.u32 = is_valid_alignment_interval, .on_change = restart_clock_aligned_meter_values},
+	{.key = OCPP_CONFIG_KEY_CONNECTION_TIMEOUT, .type = eOCPP_CONFIG_TYPE_U32,
+	 .get.u32 = storage_Get_ocpp_connection_timeout, .set.u32 = storage_Set_ocpp_connection_timeout},
+	{.key = OCPP_CONFIG_KEY_CONNECTOR_PHASE_ROTATION, .type = eOCPP_CONFIG_TYPE_CUSTOM,
+	 .get.custom = get_connector_phase_rotation, .set.custom = set_connector_phase_rotation},
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_CONNECTOR_PHASE_ROTATION_MAX_LENGTH, CONFIG_VALUE(CONFIG_OCPP_CONNECTOR_PHASE_ROTATION_MAX_LENGTH)),
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_GET_CONFIGURATION_MAX_KEYS, CONFIG_VALUE(CONFIG_OCPP_GET_CONFIGURATION_MAX_KEYS)),
+	{.key = OCPP_CONFIG_KEY_HEARTBEAT_INTERVAL, .type = eOCPP_CONFIG_TYPE_U32,
+	 .get.u32 = storage_Get_ocpp_heartbeat_interval, .set.u32 = storage_Set_ocpp_heartbeat_interval,
+	 .validate.u32 = is_valid_interval, .on_change = on_heartbeat_interval_changed},
+	{.key = OCPP_CONFIG_KEY_LIGHT_INTENSITY, .type = eOCPP_CONFIG_TYPE_CUSTOM,
+	 .get.custom = get_light_intensity, .set.custom = set_light_intensity},
+	{.key = OCPP_CONFIG_KEY_LOCAL_AUTHORIZE_OFFLINE, .type = eOCPP_CONFIG_TYPE_BOOL,
+	 .get.boolean = storage_Get_ocpp_local_authorize_offline, .set.boolean = storage_Set_ocpp_local_authorize_offline,
+	 .on_change = on_local_authorize_offline_changed},
+	{.key = OCPP_CONFIG_KEY_LOCAL_PRE_AUTHORIZE, .type = eOCPP_CONFIG_TYPE_BOOL,
+	 .get.boolean = storage_Get_ocpp_local_pre_authorize, .set.boolean = storage_Set_ocpp_local_pre_authorize,
+	 .on_change = on_local_pre_authorize_changed},
+	{.key = OCPP_CONFIG_KEY_MESSAGE_TIMEOUT, .type = eOCPP_CONFIG_TYPE_U16,
+	 .get.u16 = storage_Get_ocpp_message_timeout, .set.u16 = storage_Set_ocpp_message_timeout,
+	 .validate.u16 = is_valid_message_timeout, .on_change = on_message_timeout_changed},
+	{.key = OCPP_CONFIG_KEY_METER_VALUES_ALIGNED_DATA, .type = eOCPP_CONFIG_TYPE_CUSTOM,
+	 .get.custom = get_meter_values_aligned_data, .set.custom = set_meter_values_aligned_data,
+	 .on_change = on_meter_values_aligned_data_changed},
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_METER_VALUES_ALIGNED_DATA_MAX_LENGTH, CONFIG_VALUE(CONFIG_OCPP_METER_VALUES_ALIGNED_DATA_MAX_LENGTH)),
+	{.key = OCPP_CONFIG_KEY_METER_VALUES_SAMPLED_DATA, .type = eOCPP_CONFIG_TYPE_CUSTOM,
+	 .get.custom = get_meter_values_sampled_data, .set.custom = set_meter_values_sampled_data,
+	 .on_change = on_meter_values_sampled_data_changed},
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_METER_VALUES_SAMPLED_DATA_MAX_LENGTH, CONFIG_VALUE(CONFIG_OCPP_METER_VALUES_SAMPLED_DATA_MAX_LENGTH)),
+	{.key = OCPP_CONFIG_KEY_METER_VALUE_SAMPLE_INTERVAL, .type = eOCPP_CONFIG_TYPE_U32,
+	 .get.u32 = storage_Get_ocpp_meter_value_sample_interval, .set.u32 = storage_Set_ocpp_meter_value_sample_interval,
+	 .validate.u32 = is_valid_interval, .on_change = on_meter_value_sample_interval_changed},
+	{.key = OCPP_CONFIG_KEY_MINIMUM_STATUS_DURATION, .type = eOCPP_CONFIG_TYPE_U32,
+	 .get.u32 = storage_Get_ocpp_minimum_status_duration, .set.u32 = storage_Set_ocpp_minimum_status_duration,
+	 .on_change = on_minimum_status_duration_changed},
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_NUMBER_OF_CONNECTORS, CONFIG_VALUE(CONFIG_OCPP_NUMBER_OF_CONNECTORS)),
+	{.key = OCPP_CONFIG_KEY_RESET_RETRIES, .type = eOCPP_CONFIG_TYPE_U8,
+	 .get.u8 = storage_Get_ocpp_reset_retries, .set.u8 = storage_Set_ocpp_reset_retries},
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_STOP_TRANSACTION_MAX_METER_VALUES, CONFIG_VALUE(CONFIG_OCPP_STOP_TRANSACTION_MAX_METER_VALUES)),
+	/*
+	 * NOTE: Current behaviour of mcu in regards to querying chargesession value makes it so that
+	 * StopTransactionOnEvSideDisconnect 'false' becomes complicated to implement. For now true is required.
+	 * It is still read/write as required by ocpp 1.6.
+	 */
+	{.key = OCPP_CONFIG_KEY_STOP_TRANSACTION_ON_EV_SIDE_DISCONNECT, .type = eOCPP_CONFIG_TYPE_BOOL,
+	 .get.boolean = storage_Get_ocpp_stop_transaction_on_ev_side_disconnect,
+	 .set.boolean = storage_Set_ocpp_stop_transaction_on_ev_side_disconnect, .validate.boolean = is_true},
+	{.key = OCPP_CONFIG_KEY_STOP_TRANSACTION_ON_INVALID_ID, .type = eOCPP_CONFIG_TYPE_BOOL,
+	 .get.boolean = storage_Get_ocpp_stop_transaction_on_invalid_id, .set.boolean = storage_Set_ocpp_stop_transaction_on_invalid_id},
+	{.key = OCPP_CONFIG_KEY_STOP_TXN_ALIGNED_DATA, .type = eOCPP_CONFIG_TYPE_CUSTOM,
+	 .get.custom = get_stop_txn_aligned_data, .set.custom = set_stop_txn_aligned_data,
+	 .on_change = on_stop_txn_aligned_data_changed},
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_STOP_TXN_ALIGNED_DATA_MAX_LENGTH, CONFIG_VALUE(CONFIG_OCPP_STOP_TXN_ALIGNED_DATA_MAX_LENGTH)),
+	{.key = OCPP_CONFIG_KEY_STOP_TXN_SAMPLED_DATA, .type = eOCPP_CONFIG_TYPE_CUSTOM,
+	 .get.custom = get_stop_txn_sampled_data, .set.custom = set_stop_txn_sampled_data,
+	 .on_change = on_stop_txn_sampled_data_changed},
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_STOP_TXN_SAMPLED_DATA_MAX_LENGTH, CONFIG_VALUE(CONFIG_OCPP_STOP_TXN_SAMPLED_DATA_MAX_LENGTH)),
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_SUPPORTED_FEATURE_PROFILES, CONFIG_OCPP_SUPPORTED_FEATURE_PROFILES),
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_SUPPORTED_FEATURE_PROFILES_MAX_LENGTH, CONFIG_VALUE(CONFIG_OCPP_SUPPORTED_FEATURE_PROFILES_MAXL_ENGTH)),
+	{.key = OCPP_CONFIG_KEY_TRANSACTION_MESSAGE_ATTEMPTS, .type = eOCPP_CONFIG_TYPE_U8,
+	 .get.u8 = storage_Get_ocpp_transaction_message_attempts, .set.u8 = storage_Set_ocpp_transaction_message_attempts,
+	 .on_change = on_transaction_message_config_changed},
+	{.key = OCPP_CONFIG_KEY_TRANSACTION_MESSAGE_RETRY_INTERVAL, .type = eOCPP_CONFIG_TYPE_U16,
+	 .get.u16 = storage_Get_ocpp_transaction_message_retry_interval, .set.u16 = storage_Set_ocpp_transaction_message_retry_interval,
+	 .on_change = on_transaction_message_config_changed},
+	{.key = OCPP_CONFIG_KEY_UNLOCK_CONNECTOR_ON_EV_SIDE_DISCONNECT, .type = eOCPP_CONFIG_TYPE_BOOL,
+	 .get.boolean = storage_Get_ocpp_unlock_connector_on_ev_side_disconnect,
+	 .set.boolean = storage_Set_ocpp_unlock_connector_on_ev_side_disconnect,
+	 .on_change = on_unlock_connector_on_ev_side_disconnect_changed},
+	{.key = OCPP_CONFIG_KEY_WEBSOCKET_PING_INTERVAL, .type = eOCPP_CONFIG_TYPE_U32,
+	 .get.u32 = get_websocket_ping_interval, .set.u32 = set_websocket_ping_interval,
+	 .on_change = on_websocket_ping_interval_changed},
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_SUPPORTED_FILE_TRANSFER_PROTOCOLS, CONFIG_OCPP_SUPPORTED_FILE_TRANSFER_PROTOCOLS),
+	{.key = OCPP_CONFIG_KEY_LOCAL_AUTH_LIST_ENABLED, .type = eOCPP_CONFIG_TYPE_BOOL,
+	 .get.boolean = storage_Get_ocpp_local_auth_list_enabled, .set.boolean = storage_Set_ocpp_local_auth_list_enabled,
+	 .on_change = on_local_auth_list_enabled_changed},
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_LOCAL_AUTH_LIST_MAX_LENGTH, CONFIG_VALUE(CONFIG_OCPP_LOCAL_AUTH_LIST_MAX_LENGTH)),
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_SEND_LOCAL_LIST_MAX_LENGTH, CONFIG_VALUE(CONFIG_OCPP_SEND_LOCAL_LIST_MAX_LENGTH)),
+#ifdef CONFIG_OCPP_RESERVE_CONNECTOR_ZERO_SUPPORTED
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_RESERVE_CONNECTOR_ZERO_SUPPORTED, "true"),
+#endif
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_CHARGE_PROFILE_MAX_STACK_LEVEL, CONFIG_VALUE(CONFIG_OCPP_CHARGE_PROFILE_MAX_STACK_LEVEL)),
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_CHARGING_SCHEDULE_ALLOWED_CHARGING_RATE_UNIT, CONFIG_OCPP_CHARGING_SCHEDULE_ALLOWED_CHARGING_RATE_UNIT),
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_CHARGING_SCHEDULE_MAX_PERIODS, CONFIG_VALUE(CONFIG_OCPP_CHARGING_SCHEDULE_MAX_PERIODS)),
+#ifdef CONFIG_OCPP_CONNECTOR_SWITCH_3_TO_1_PHASE_SUPPORTED
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_CONNECTOR_SWITCH_3_TO_1_PHASE_SUPPORTED, "true"),
+#endif
+	CONFIG_KEY_CONSTANT(OCPP_CONFIG_KEY_MAX_CHARGING_PROFILES_INSTALLED, CONFIG_VALUE(CONFIG_OCPP_MAX_CHARGING_PROFILES_INSTALLED)),
+	{.key = OCPP_CONFIG_KEY_SECURITY_PROFILE, .type = eOCPP_CONFIG_TYPE_U8, .cloud_setting = true,
+	 .get.u8 = storage_Get_ocpp_security_profile, .set.u8 = storage_Set_ocpp_security_profile,
+	 .validate.u8 = is_valid_security_profile, .on_change = on_security_profile_changed},
+	// Write only
+	{.key = OCPP_CONFIG_KEY_AUTHORIZATION_KEY, .type = eOCPP_CONFIG_TYPE_CUSTOM, .set.custom = set_authorization_key},
 
-	if(item_count > max_items){
-		ESP_LOGW(TAG, "CSL item count exceed maximum number of values: %zu/%" PRIu8, item_count, max_items);
-		goto error;
-	}
+	// Non-standard configuration keys
+	{.key = OCPP_CONFIG_KEY_DEFAULT_ID_TOKEN, .type = eOCPP_CONFIG_TYPE_STRING,
+	 .get.string = storage_Get_ocpp_default_id_token, .set.string = storage_Set_ocpp_default_id_token,
+	 .validate.string = is_valid_default_id_token},
+	{.key = OCPP_CONFIG_KEY_AUTHORIZATION_REQUIRED, .type = eOCPP_CONFIG_TYPE_BOOL, .cloud_setting = true,
+	 .get.boolean = get_AuthenticationRequired_bool, .set.boolean = set_AuthenticationRequired_bool,
+	 .on_change = on_authorization_required_changed},
+};
 
-	config_str = strdup(value_prepared);
-	if(config_str == NULL){
-		ESP_LOGE(TAG, "Unable to duplicat CSL");
-		goto error;
-	}
+#define CONFIG_RESPONSE_INITIAL_SIZE 1024
 
-	char * config_position = config_str; // used to change case insensensitive input to case sensitive.
+static struct ocpp_config_registry config_registry = {0};
 
-	// Check if each item is among options
-	char * token = strtok(value_prepared, ",");
-	while(token != NULL){
-		va_list argument_ptr;
-		bool is_valid = false;
-		const char * enum_value;
+static void get_configuration_cb(const char * unique_id, const char * action, cJSON * payload, void * cb_data){
+	ESP_LOGI(TAG, "Got request for get configuration");
+	char err_str[128];
+	enum ocppj_err_t err = eOCPPJ_NO_ERROR;
 
-		va_start(argument_ptr, option_count);
-		for(int i = 0; i < option_count; i++){
-			 enum_value = va_arg(argument_ptr, const char *);
-			if(strncasecmp(token, enum_value, strlen(enum_value)) == 0){
-				is_valid = true;
+	int key_length = 0;
+	const char * requested_keys[CONFIG_OCPP_GET_CONFIGURATION_MAX_KEYS];
 
-				strncpy(config_position, enum_value, strlen(enum_value)); // Use case sensitive version
-				config_position += strlen(enum_value);
+	if(cJSON_HasObjectItem(payload, "key")){
+		cJSON * key = cJSON_GetObjectItem(payload, "key");
 
-				break;
-			}
+		if(!cJSON_IsArray(key)){
+			err = eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
+			sprintf(err_str, "Expected 'key' to be a valid array");
+
+			goto error;
 		}
 
-		va_end(argument_ptr);
+		key_length = cJSON_GetArraySize(key);
+
+		if(key_length > CONFIG_OCPP_GET_CONFIGURATION_MAX_KEYS){
+			err = eOCPPJ_ERROR_OCCURENCE_CONSTRAINT_VIOLATION;
+			snprintf(err_str, sizeof(err_str), "Length of 'key' (%d) exceed maximum lenght (%d)", key_length, CONFIG_OCPP_GET_CONFIGURATION_MAX_KEYS);
 
-		if(!is_valid){
-			ESP_LOGW(TAG, "CSL contained invalid item: '%s'", token);
 			goto error;
 		}
 
-		char phase_buffer[6] = {0};
-
-		if(csl_expect_phase(enum_value)){
-			const char * phase_index = csl_token_get_phase_index(token);
-			if((phase_index != NULL && phase_index[3] != '\0')
-				|| (phase_index == NULL && token[strlen(enum_value)] != '\0')){
+		for(size_t i = 0; i < key_length; i++){
+			cJSON * key_name = cJSON_GetArrayItem(key, i);
+			if(!cJSON_IsString(key_name) || !is_ci_string_type(key_name->valuestring, 50)){
+				err = eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
+				sprintf(err_str, "key %d is not a valid CiString50Type", i);
 
-				ESP_LOGW(TAG, "CSL item did not end after %s", (phase_buffer[0] == 0) ? "token" : "phase");
-				goto error;
-			}else if(phase_index != NULL){
-				config_position[1] = 'L'; // Make sure the 'L' in .L1, .L2 or .L3 is uppercase
-			}
-		}else{
-			if(token[strlen(enum_value)] != '\0'){
-				ESP_LOGW(TAG, "Initial part of CSL contained valid item, but contains unsupported continuation");
 				goto error;
 			}
+
+			requested_keys[i] = key_name->valuestring;
 		}
+	}
 
-		token = strtok(NULL, ",");
-		config_position = index(config_position, ',');
-		if(config_position != NULL)
-			config_position++;
+	char * message = NULL;
+	size_t message_length = 0;
+
+	if(ocpp_config_registry_write_configuration(&config_registry, unique_id, requested_keys, key_length, &message, &message_length) != ESP_OK){
+		err = eOCPPJ_ERROR_INTERNAL;
+		sprintf(err_str, "Unable to allocate memory for configuration response");
+
+		goto error;
 	}
-	free(value_prepared);
 
-	ESP_LOGI(TAG, "Writing CSL value: '%s'", config_str);
-	config_function(config_str);
-	free(config_str);
+	send_call_reply_text(message, message_length);
+	free(message);
 
-	return 0;
+	return;
 
 error:
-	free(value_prepared);
-	free(config_str);
-	return -1;
+
+	if(err == ESP_OK){
+		ESP_LOGE(TAG, "get_configuration_cb reached error exit, but no error set");
+		err = eOCPPJ_ERROR_INTERNAL;
+		err_str[0] = '\0';
+	}else{
+		ESP_LOGE(TAG, "get_configuration_cb reached error exit: [%s]: '%s'", ocppj_error_code_from_id(err), err_str);
+	}
+
+	cJSON * ocpp_error = ocpp_create_call_error(unique_id, ocppj_error_code_from_id(err), err_str, NULL);
+	if(ocpp_error == NULL){
+		ESP_LOGE(TAG, "Unable to create call error for internal error");
+	}else{
+		send_call_reply(ocpp_error);
+	}
 }
 
 static void change_configuration_cb(const char * unique_id, const char * action, cJSON * payload, void * cb_data){
@@ -2289,354 +1540,123 @@ static void change_configuration_cb(const char * unique_id, const char * action,
 	}else{
 		ESP_LOGI(TAG, "Given configuration: \n\tkey: '%s'\n\tvalue: '%s'", key, value);
 	}
-
-	int err = -1;
-	bool cloud_settings_changed = false;
-
-	if(strcasecmp(key, OCPP_CONFIG_KEY_ALLOW_OFFLINE_TX_FOR_UNKNOWN_ID) == 0){
-		err = set_config_bool(storage_Set_ocpp_allow_offline_tx_for_unknown_id, value, NULL);
-		ocpp_change_allow_offline_for_unknown(storage_Get_ocpp_allow_offline_tx_for_unknown_id());
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_AUTHORIZATION_CACHE_ENABLED) == 0){
-		err = set_config_bool(storage_Set_ocpp_authorization_cache_enabled, value, NULL);
-		ocpp_change_auth_cache_enabled(storage_Get_ocpp_authorization_cache_enabled());
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_AUTHORIZE_REMOTE_TX_REQUESTS) == 0){
-		err = set_config_bool(storage_Set_ocpp_authorize_remote_tx_requests, value, NULL);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_CLOCK_ALIGNED_DATA_INTERVAL) == 0){
-		err = set_config_u32(storage_Set_ocpp_clock_aligned_data_interval, value, is_valid_alignment_interval);
-		if(err == 0)
-			restart_clock_aligned_meter_values();
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_CONNECTION_TIMEOUT) == 0){
-		err = set_config_u32(storage_Set_ocpp_connection_timeout, value, NULL);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_CONNECTOR_PHASE_ROTATION) == 0){
-		/*
-		 * The go represent connector phase rotation via wire index. OCPP uses three letters (R,S and T) representing L1, L2, L3 optionally
-		 * prefixed by the connector. Since the Go only has one connector, it has been decided that it will reject a request to set
-		 * connector 0 to a different value than connector 1, and setting either will be reported as both values updated.
-		 */
-		_Static_assert(CONFIG_OCPP_NUMBER_OF_CONNECTORS == 1, "Logic for ocpp connector phase rotation configuration is only valid with 1 connector");
-
-		size_t value_count = 0; // Number of items in the CSL type (number of seperate connectors configured)
-
-		enum ocpp_phase_rotation_id phase_rotation_id = -1;
-		uint8_t grid_type = MCU_GetGridType();
-		size_t offset = 0;
-		uint8_t configured_connector_mask = 0;
-
-		char phase_rotation_buffer[16];
-
-		err = 0;
-		size_t data_length = strlen(value);
-		while(data_length > 0 && isspace((unsigned char)value[data_length]))
-			data_length--;
-
-		while(offset < data_length){
-			if(++value_count > CONFIG_OCPP_CONNECTOR_PHASE_ROTATION_MAX_LENGTH){
-				ESP_LOGW(TAG, "Number of CSL value in new connector phase rotation exceed max");
-				err = -1;
-				break;
-			}
-
-			if(value_count > 1){
-				if(value[offset] == ','){
-					offset++;
-				}else{
-					ESP_LOGW(TAG, "Expected ',' separated list");
-				}
-			}
-
-			while(isspace((unsigned char)value[offset]))
-				offset++;
-
-			if(isdigit((unsigned char)value[offset])){
-				int connector = atoi(&value[offset]);
-				if(value[offset+1] == '.' && ((configured_connector_mask & 1 << connector) == 0) && connector <= CONFIG_OCPP_NUMBER_OF_CONNECTORS){
-					configured_connector_mask = configured_connector_mask | 1 << connector;
-				}else{
-					ESP_LOGW(TAG, "Invalid use of connector prefix in connector phase rotation");
-					err = -1;
-					break;
-				}
-
-				offset += 2; //skip past connector id and the . seperating it from its rotation
-			}
-
-			size_t i = 0;
-			for(; i < sizeof(phase_rotation_buffer); i++){
-				if(isalpha((unsigned char)value[offset])){
-					phase_rotation_buffer[i] = value[offset];
-					offset++;
-				}else{
-					break;
-				}
-			}
-
-			phase_rotation_buffer[i] = '\0';
-			enum ocpp_phase_rotation_id new_phase_rotation_id = ocpp_phase_rotation_to_id(phase_rotation_buffer);
-
-			if(phase_rotation_id == -1){
-				if(new_phase_rotation_id == -1){
-					ESP_LOGE(TAG, "Got invalid phase rotation: %s", phase_rotation_buffer);
-					err = -1;
-					break;
-
-				}else{
-					if(grid_type == NETWORK_NONE){
-						ESP_LOGE(TAG, "Requested to set phase rotation, but no grid type was detected. Unable to validate or set rotation");
-						err = -1;
-						break;
-
-					}else if((grid_type == NETWORK_1P3W || grid_type == NETWORK_1P4W) && (new_phase_rotation_id != eOCPP_PHASE_ROTATION_NOT_APPLICABLE && new_phase_rotation_id != eOCPP_PHASE_ROTATION_UNKNOWN)){
-						ESP_LOGE(TAG, "Got phase rotation not supported with detected single phase grid"); // All attempts to change rotation away from NotApplicable on UK OPEN should hit this
-						err = -1;
-						break;
-
-					}else if((grid_type == NETWORK_3P3W || grid_type == NETWORK_3P4W) && new_phase_rotation_id == eOCPP_PHASE_ROTATION_NOT_APPLICABLE){
-						ESP_LOGE(TAG, "Got NotApplicable phase rotation (for single phase or DC charge point) when grid indicate three phase");
-						err = -1;
-						break;
-					}
-				}
-
-				phase_rotation_id = new_phase_rotation_id;
-
-			}else if(phase_rotation_id != new_phase_rotation_id){
-				ESP_LOGE(TAG, "The connectors phase rotations do not match: %d != %d", phase_rotation_id, new_phase_rotation_id);
-				err = -1;
-				break;
-			}
-		}
-
-		if(err == 0){
-			uint8_t wire_index = convert_from_ocpp_phase(phase_rotation_id, grid_type == NETWORK_1P3W || grid_type == NETWORK_3P3W);
-			ESP_LOGI(TAG, "New phase rotation wire index is %d", wire_index);
-			storage_Set_PhaseRotation(wire_index);
+	const struct ocpp_config_key * entry = ocpp_config_registry_find(&config_registry, key);
+	if(entry == NULL){
+		if(is_configuration_key(key)){
+			ESP_LOGW(TAG, "Change configuration request rejected due to rejected key: '%s'", key);
+			change_config_confirm(unique_id, OCPP_CONFIGURATION_STATUS_REJECTED);
 		}else{
-			ESP_LOGE(TAG, "Unable to configure phase rotation");
+			ESP_LOGW(TAG, "Change configuration for key: '%s' is not supported", key);
+			change_config_confirm(unique_id, OCPP_CONFIGURATION_STATUS_NOT_SUPPORTED);
 		}
+		return;
+	}
 
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_HEARTBEAT_INTERVAL) == 0){
-		err = set_config_u32(storage_Set_ocpp_heartbeat_interval, value, is_valid_interval);
-		if(err == 0)
-			update_heartbeat_timer(storage_Get_ocpp_heartbeat_interval());
+	esp_err_t err = ocpp_config_registry_set_value(entry, value);
 
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_LIGHT_INTENSITY) == 0){
-		char * endptr;
-		long value_long = strtol(value, &endptr, 0);
+	if(err == ESP_OK){
+		ESP_LOGI(TAG, "Successfully configured %s", key);
+		change_config_confirm(unique_id, OCPP_CONFIGURATION_STATUS_ACCEPTED);
+		storage_SaveConfiguration();
 
-		if(endptr[0] == '0' || value_long < 0 || value_long > 100){
-			change_config_confirm(unique_id, OCPP_CONFIGURATION_STATUS_REJECTED);
-			return;
+		if(entry->cloud_setting){
+			if(publish_debug_telemetry_observation_cloud_settings() != 0){
+				ESP_LOGE(TAG, "Unable to inform cloud of updated cloud_settings");
+				cloud_publish_awaiting |= ePUBLISH_DEVICE_TWIN;
+			}
 		}
+	}else{
+		ESP_LOGW(TAG, "Unsuccessfull in configuring %s: %s", key, esp_err_to_name(err));
+		change_config_confirm(unique_id, OCPP_CONFIGURATION_STATUS_REJECTED);
+	}
 
-		float intensity = value_long / 100.0f;
+	return;
+}
 
-		MessageType ret = MCU_SendFloatParameter(HmiBrightness, intensity);
-		if(ret == MsgWriteAck)
-		{
-			ESP_LOGI(TAG, "Set hmiBrightness: %f", intensity);
+/*
+ * The localAuthorizationList may be larger than the rest of the request combined. Its elements are converted as they are
+ * parsed by the listener, so that the list is never held as a cJSON tree.
+ */
+struct local_list_stream{
+	struct ocpp_authorization_data * list;
+	size_t length;
+	size_t capacity;
+	enum ocppj_err_t err;
+	char err_str[128];
+};
 
-			storage_Set_HmiBrightness(value_long / 100.0f);
-			change_config_confirm(unique_id, OCPP_CONFIGURATION_STATUS_ACCEPTED);
-			return;
-		}else{
-			ESP_LOGE(TAG, "Unable to change hmi brightness");
-			change_config_confirm(unique_id, OCPP_CONFIGURATION_STATUS_REJECTED);
-			return;
-		}
+static struct local_list_stream local_list_stream = {0};
 
+static void free_local_list_stream(){
+	for(size_t i = 0; i < local_list_stream.length; i++)
+		free_id_tag_info(local_list_stream.list[i].id_tag_info);
 
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_LOCAL_AUTHORIZE_OFFLINE) == 0){
-		err = set_config_bool(storage_Set_ocpp_local_authorize_offline, value, NULL);
-		ocpp_change_authorize_offline(storage_Get_ocpp_local_authorize_offline());
+	free(local_list_stream.list);
 
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_LOCAL_PRE_AUTHORIZE) == 0){
-		err = set_config_bool(storage_Set_ocpp_local_pre_authorize, value, NULL);
-		ocpp_change_local_pre_authorize(storage_Get_ocpp_local_pre_authorize());
+	local_list_stream.list = NULL;
+	local_list_stream.length = 0;
+	local_list_stream.capacity = 0;
+	local_list_stream.err = eOCPPJ_NO_ERROR;
+	local_list_stream.err_str[0] = '\0';
+}
 
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_MESSAGE_TIMEOUT) == 0){
-		err = set_config_u16(storage_Set_ocpp_message_timeout, value, is_valid_message_timeout);
-		if(err == 0)
-			ocpp_change_message_timeout(storage_Get_ocpp_message_timeout());
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_METER_VALUES_ALIGNED_DATA) == 0){
-		err = set_config_csl(storage_Set_ocpp_meter_values_aligned_data, value, DEFAULT_CSL_LENGTH, 7,
-				OCPP_MEASURAND_CURRENT_IMPORT,
-				OCPP_MEASURAND_CURRENT_OFFERED,
-				OCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER,
-				OCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_INTERVAL,
-				OCPP_MEASURAND_POWER_ACTIVE_IMPORT,
-				OCPP_MEASURAND_TEMPERATURE,
-				OCPP_MEASURAND_VOLTAGE
-				);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_METER_VALUES_SAMPLED_DATA) == 0){
-		err = set_config_csl(storage_Set_ocpp_meter_values_sampled_data, value, DEFAULT_CSL_LENGTH, 7,
-				OCPP_MEASURAND_CURRENT_IMPORT,
-				OCPP_MEASURAND_CURRENT_OFFERED,
-				OCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER,
-				OCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_INTERVAL,
-				OCPP_MEASURAND_POWER_ACTIVE_IMPORT,
-				OCPP_MEASURAND_TEMPERATURE,
-				OCPP_MEASURAND_VOLTAGE
-				);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_METER_VALUE_SAMPLE_INTERVAL) == 0){
-		err = set_config_u32(storage_Set_ocpp_meter_value_sample_interval, value, is_valid_interval);
-		sessionHandler_OcppChangeSampleInterval(eOCPP_CONTEXT_OTHER);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_MINIMUM_STATUS_DURATION) == 0){
-		err = set_config_u32(storage_Set_ocpp_minimum_status_duration, value, NULL);
-		if(err == 0)
-			ocpp_change_minimum_status_duration(storage_Get_ocpp_minimum_status_duration());
-
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_RESET_RETRIES) == 0){
-		err = set_config_u8(storage_Set_ocpp_reset_retries, value, NULL);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_STOP_TRANSACTION_ON_EV_SIDE_DISCONNECT) == 0){
-		/*
-		 * NOTE: Current behaviour of mcu in regards to querying chargesession value makes it so that
-		 * StopTransactionOnEvSideDisconnect 'false' becomes complicated to implement. For now true is required.
-		 * It is still read/write as required by ocpp 1.6.
-		 */
-		err = set_config_bool(storage_Set_ocpp_stop_transaction_on_ev_side_disconnect, value, is_true);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_STOP_TRANSACTION_ON_INVALID_ID) == 0){
-		err = set_config_bool(storage_Set_ocpp_stop_transaction_on_invalid_id, value, NULL);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_STOP_TXN_ALIGNED_DATA) == 0){
-		err = set_config_csl(storage_Set_ocpp_stop_txn_aligned_data, value, DEFAULT_CSL_LENGTH, 7,
-				OCPP_MEASURAND_CURRENT_IMPORT,
-				OCPP_MEASURAND_CURRENT_OFFERED,
-				OCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER,
-				OCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_INTERVAL,
-				OCPP_MEASURAND_POWER_ACTIVE_IMPORT,
-				OCPP_MEASURAND_TEMPERATURE,
-				OCPP_MEASURAND_VOLTAGE
-				);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_STOP_TXN_SAMPLED_DATA) == 0){
-		err = set_config_csl(storage_Set_ocpp_stop_txn_sampled_data, value, DEFAULT_CSL_LENGTH, 7,
-				OCPP_MEASURAND_CURRENT_IMPORT,
-				OCPP_MEASURAND_CURRENT_OFFERED,
-				OCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER,
-				OCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_INTERVAL,
-				OCPP_MEASURAND_POWER_ACTIVE_IMPORT,
-				OCPP_MEASURAND_TEMPERATURE,
-				OCPP_MEASURAND_VOLTAGE
-				);
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_TRANSACTION_MESSAGE_ATTEMPTS) == 0){
-		err = set_config_u8(storage_Set_ocpp_transaction_message_attempts, value, NULL);
-		if(err == 0)
-			update_transaction_message_related_config(
-				storage_Get_ocpp_transaction_message_attempts(),
-				storage_Get_ocpp_transaction_message_retry_interval());
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_TRANSACTION_MESSAGE_RETRY_INTERVAL) == 0){
-		err = set_config_u16(storage_Set_ocpp_transaction_message_retry_interval, value, NULL);
-		if(err == 0)
-			update_transaction_message_related_config(
-				storage_Get_ocpp_transaction_message_attempts(),
-				storage_Get_ocpp_transaction_message_retry_interval());
-
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_UNLOCK_CONNECTOR_ON_EV_SIDE_DISCONNECT) == 0){
-		err = set_config_bool(storage_Set_ocpp_unlock_connector_on_ev_side_disconnect, value, NULL);
-		if(err == 0 && (sessionHandler_OcppTransactionIsActive(0) || storage_Get_ocpp_unlock_connector_on_ev_side_disconnect())){
-			MessageType ret = MCU_SendUint8Parameter(PermanentCableLock, !storage_Get_ocpp_unlock_connector_on_ev_side_disconnect());
-			if(ret != MsgWriteAck){
-				ocpp_send_status_notification(-1, OCPP_CP_ERROR_OTHER_ERROR, "Unable to apply UnlockConnectorOnEVSideDisconnect",
-							NULL, NULL, true, false);
-				ESP_LOGE(TAG, "Unable to set UnlockConnectorOnEVSideDisconnect as a result of ChangeConfiguration.req");
-			}
-		}
+static void local_list_stream_begin(void * cb_data){
+	free_local_list_stream();
+}
 
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_WEBSOCKET_PING_INTERVAL) == 0){
-		err = set_config_u32(storage_Set_ocpp_websocket_ping_interval, value, NULL);
-		if(err == 0){
-			if(storage_Get_ocpp_websocket_ping_interval() == 0) // ocpp treats 0 as "no ping" esp_websocket treats 0 as "default value"
-				storage_Set_ocpp_websocket_ping_interval(SIZE_MAX); //esp_websocket does not support "no ping" instead we set it to max
+static int local_list_stream_element(cJSON * element, size_t index, void * cb_data){
+	if(local_list_stream.err != eOCPPJ_NO_ERROR) // Remaining elements are ignored, the error is replied when complete
+		return 0;
 
-			ESP_LOGI(TAG, "Setting new ping interval to: %" PRIu32, storage_Get_ocpp_websocket_ping_interval());
-			ocpp_change_websocket_ping_interval(storage_Get_ocpp_websocket_ping_interval());
-		}
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_LOCAL_AUTH_LIST_ENABLED) == 0){
-		err = set_config_bool(storage_Set_ocpp_local_auth_list_enabled, value, NULL);
-		ocpp_change_auth_list_enabled(storage_Get_ocpp_local_auth_list_enabled());
+	if(local_list_stream.length >= CONFIG_OCPP_SEND_LOCAL_LIST_MAX_LENGTH){
+		local_list_stream.err = eOCPPJ_ERROR_OCCURENCE_CONSTRAINT_VIOLATION;
+		strcpy(local_list_stream.err_str, "'LocalAuthorizationlist' exceed maximum length");
+		return 0;
+	}
 
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_AUTHORIZATION_KEY) == 0){
-		if(is_ci_string_type(value, 40) && strlen(value) >= 16){ // Type is string not ci_string, but validation should be same
-			storage_Set_ocpp_authorization_key(value);
-			storage_Set_authorization_key_set_from_zaptec_ocpp(false);
+	if(local_list_stream.length == local_list_stream.capacity){
+		size_t new_capacity = local_list_stream.capacity == 0 ? 16 : local_list_stream.capacity * 2;
+		if(new_capacity > CONFIG_OCPP_SEND_LOCAL_LIST_MAX_LENGTH)
+			new_capacity = CONFIG_OCPP_SEND_LOCAL_LIST_MAX_LENGTH;
 
-			err = ESP_OK;
-		}else{
-			err = ESP_FAIL;
+		struct ocpp_authorization_data * new_list = realloc(local_list_stream.list, sizeof(struct ocpp_authorization_data) * new_capacity);
+		if(new_list == NULL){
+			local_list_stream.err = eOCPPJ_ERROR_INTERNAL;
+			strcpy(local_list_stream.err_str, "Unable to allocate memory for localAuthorisationList");
+			return 0;
 		}
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_SECURITY_PROFILE) == 0){
-		uint8_t active_security_profile = storage_Get_ocpp_security_profile();
-		err = set_config_u8(storage_Set_ocpp_security_profile, value, is_valid_security_profile);
 
-		if(active_security_profile != storage_Get_ocpp_security_profile()){
-			cloud_settings_changed = true;
-			ocpp_end_and_reconnect(true);
-		}
+		local_list_stream.list = new_list;
+		local_list_stream.capacity = new_capacity;
+	}
 
-		// Non-standard configuration keys
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_DEFAULT_ID_TOKEN) == 0){
-		if(is_ci_string_type(value, 20)){
-			storage_Set_ocpp_default_id_token(value);
-			err = ESP_OK;
-		}else{
-			err = ESP_FAIL;
-		}
-	}else if(strcasecmp(key, OCPP_CONFIG_KEY_AUTHORIZATION_REQUIRED) == 0){
-		err = set_config_bool(set_AuthenticationRequired_bool, value, NULL);
-		cloud_settings_changed = true;
+	struct ocpp_authorization_data * auth_data = &local_list_stream.list[local_list_stream.length];
+	memset(auth_data, 0, sizeof(struct ocpp_authorization_data));
 
-		MessageType ret = MCU_SendUint8Parameter(AuthenticationRequired, storage_Get_AuthenticationRequired());
-		if(ret == MsgWriteAck)
-		{
-			ESP_LOGI(TAG, "OCPP set AuthenticationRequired on dsPIC success: %" PRIu8, storage_Get_AuthenticationRequired());
-		}
-		else
-		{
-			ESP_LOGE(TAG, "OCPP set AuthenticationRequired on dsPIC failed: %" PRIu8, storage_Get_AuthenticationRequired());
+	enum ocppj_err_t err = ocpp_authorization_data_from_json(element, auth_data, local_list_stream.err_str, sizeof(local_list_stream.err_str));
+	if(err != eOCPPJ_NO_ERROR){
+		local_list_stream.err = err;
+
+		size_t err_length = strlen(local_list_stream.err_str);
+		if(err_length < sizeof(local_list_stream.err_str)){
+			snprintf(local_list_stream.err_str + err_length, sizeof(local_list_stream.err_str) - err_length, " : At index %d", index);
 		}
 
-	}else if(is_configuration_key(key)){
-		ESP_LOGW(TAG, "Change configuration request rejected due to rejected key: '%s'", key);
-		change_config_confirm(unique_id, OCPP_CONFIGURATION_STATUS_REJECTED);
-		return;
-	}else{
-		ESP_LOGW(TAG, "Change configuration for key: '%s' is not supported", key);
-		change_config_confirm(unique_id, OCPP_CONFIGURATION_STATUS_NOT_SUPPORTED);
-		return;
+		return 0;
 	}
 
-	if(err == 0){
-		ESP_LOGI(TAG, "Successfully configured %s", key);
-		change_config_confirm(unique_id, OCPP_CONFIGURATION_STATUS_ACCEPTED);
-		storage_SaveConfiguration();
+	local_list_stream.length++;
+	return 0;
+}
 
-		if(cloud_settings_changed){
-			if(publish_debug_telemetry_observation_cloud_settings() != 0){
-				ESP_LOGE(TAG, "Unable to inform cloud of updated cloud_settings");
-				cloud_publish_awaiting |= ePUBLISH_DEVICE_TWIN;
-			}
-		}
-	}else{
-		ESP_LOGW(TAG, "Unsuccessfull in configuring %s", key);
-		change_config_confirm(unique_id, OCPP_CONFIGURATION_STATUS_REJECTED);
-	}
+static const char * local_list_stream_path[] = {"localAuthorizationList"};
 
-	return;
-}
+static const struct ocpp_call_element_stream send_local_list_stream = {
+	.path = local_list_stream_path,
+	.path_length = 1,
+	.begin = local_list_stream_begin,
+	.element = local_list_stream_element,
+};
 
 static void send_local_list_cb(const char * unique_id, const char * action, cJSON * payload, void * cb_data){
 	ESP_LOGI(TAG, "Got request for local auth list update");
@@ -2672,58 +1692,37 @@ static void send_local_list_cb(const char * unique_id, const char * action, cJSO
 
 	bool is_update_full = strcmp(update_type, OCPP_UPDATE_TYPE_FULL) == 0;
 
-	struct ocpp_authorization_data * auth_list = NULL;
-	int auth_list_length = 0;
-
+	// Elements have been moved to local_list_stream by the listener, only the now empty array remains in the payload
 	if(cJSON_HasObjectItem(payload, "localAuthorizationList")){
-		cJSON * local_auth_list_json = cJSON_GetObjectItem(payload, "localAuthorizationList");
-		if(!cJSON_IsArray(local_auth_list_json)){
+		if(!cJSON_IsArray(cJSON_GetObjectItem(payload, "localAuthorizationList"))){
 			err = eOCPPJ_ERROR_TYPE_CONSTRAINT_VIOLATION;
 			strcpy(err_str, "Expected 'localAuthorizationList' field to be array of AuthorizationData");
 
 			goto error;
 		}
 
-		auth_list_length = cJSON_GetArraySize(local_auth_list_json);
-		if(auth_list_length > 0){
-			if(auth_list_length > CONFIG_OCPP_SEND_LOCAL_LIST_MAX_LENGTH){
-				err = eOCPPJ_ERROR_OCCURENCE_CONSTRAINT_VIOLATION;
-				strcpy(err_str, "'LocalAuthorizationlist' exceed maximum length");
+		if(local_list_stream.err != eOCPPJ_NO_ERROR){
+			err = local_list_stream.err;
+			strcpy(err_str, local_list_stream.err_str);
 
-				goto error;
-			}
+			goto error;
+		}
+	}
 
-			auth_list = calloc(sizeof(struct ocpp_authorization_data), auth_list_length);
-			if(auth_list == NULL){
-				err = eOCPPJ_ERROR_INTERNAL;
-				strcpy(err_str, "Unable to allocate memory for localAuthorisationList");
+	if(is_update_full){
+		for(size_t i = 0; i < local_list_stream.length; i++){
+			if(local_list_stream.list[i].id_tag_info == NULL){
+				err = eOCPPJ_ERROR_PROPERTY_CONSTRAINT_VIOLATION;
+				snprintf(err_str, sizeof(err_str), "'idTagInfo' is missing and required for Full update : At index %d", i);
 
 				goto error;
 			}
-
-			for(size_t i = 0; i < auth_list_length; i++){
-				err = ocpp_authorization_data_from_json(cJSON_GetArrayItem(local_auth_list_json, i), &auth_list[i], err_str, sizeof(err_str));
-
-				if(err == eOCPPJ_NO_ERROR && is_update_full && auth_list[i].id_tag_info == NULL){
-					err = eOCPPJ_ERROR_PROPERTY_CONSTRAINT_VIOLATION;
-					strcpy(err_str, "'idTagInfo' is missing and required for Full update");
-				}
-
-				if(err != eOCPPJ_NO_ERROR){
-					size_t err_length = strlen(err_str);
-					if(err_length > sizeof(err_str)){
-						snprintf(err_str + err_length, sizeof(err_str) - err_length, " : At index %d", i);
-					}
-
-					goto error;
-				}
-			}
 		}
 	}
 
-	enum ocpp_update_status_id update_status = ocpp_update_auth_list(list_version, is_update_full, auth_list, auth_list_length);
+	enum ocpp_update_status_id update_status = ocpp_update_auth_list(list_version, is_update_full, local_list_stream.list, local_list_stream.length);
 
-	free(auth_list);
+	free_local_list_stream();
 
 	cJSON * response = ocpp_create_send_local_list_confirmation(unique_id, ocpp_update_status_from_id(update_status));
 	if(response == NULL){
@@ -2735,6 +1734,8 @@ static void send_local_list_cb(const char * unique_id, const char * action, cJSO
 	return;
 
 error:
+	free_local_list_stream();
+
 	if(err == eOCPPJ_NO_ERROR || err == eOCPPJ_NO_VALUE){
 		ESP_LOGE(TAG, "SendLocalList.req callback reached error exit without error being set");
 		err = eOCPPJ_ERROR_INTERNAL;
@@ -2975,8 +1976,7 @@ static void trigger_message_cb(const char * unique_id, const char * action, cJSO
 			}
 		}
 
-		handle_meter_value(eOCPP_CONTEXT_TRIGGER, storage_Get_ocpp_meter_values_sampled_data(),
-				NULL, NULL, false, connector_id, connector_count, true);
+		handle_meter_value(eOCPP_CONTEXT_TRIGGER, false, false, NULL, false, connector_id, connector_count, true);
 
 		if(allocated)
 			free(connector_id);
@@ -3343,12 +2343,7 @@ cJSON * ocpp_get_diagnostics(){
 		cJSON_AddStringToObject(main_res, "stored_cbid", storage_Get_chargebox_identity_ocpp());
 		cJSON_AddItemToObject(res, "main", main_res);
 
-		cJSON * configuration_key = cJSON_CreateArray();
-		if(configuration_key != NULL){
-			get_all_ocpp_configurations(configuration_key);
-		}
-
-		cJSON_AddItemToObject(main_res, "configuration", configuration_key);
+		cJSON_AddItemToObject(main_res, "configuration", ocpp_config_registry_to_json(&config_registry));
 	}
 
 	cJSON_AddItemToObject(res, "task", ocpp_task_get_diagnostics());
@@ -3546,6 +2541,7 @@ static void ocpp_task(){
 		attach_call_cb(eOCPP_ACTION_RESET_ID, reset_cb, NULL);
 		attach_call_cb(eOCPP_ACTION_CLEAR_CACHE_ID, clear_cache_cb, NULL);
 		attach_call_cb(eOCPP_ACTION_SEND_LOCAL_LIST_ID, send_local_list_cb, NULL);
+		attach_call_element_stream(eOCPP_ACTION_SEND_LOCAL_LIST_ID, &send_local_list_stream);
 		attach_call_cb(eOCPP_ACTION_GET_LOCAL_LIST_VERSION_ID, get_local_list_version_cb, NULL);
 		attach_call_cb(eOCPP_ACTION_DATA_TRANSFER_ID, data_transfer_cb, NULL);
 		attach_call_cb(eOCPP_ACTION_TRIGGER_MESSAGE_ID, trigger_message_cb, NULL);
@@ -3970,6 +2966,15 @@ void ocpp_end_and_reconnect(bool graceful){
 }
 
 void ocpp_init(){
+	if(sampling_plan_lock == NULL){
+		sampling_plan_lock = xSemaphoreCreateMutex();
+		if(sampling_plan_lock == NULL)
+			ESP_LOGE(TAG, "Unable to create sampling plan lock");
+	}
+
+	if(config_registry.keys == NULL)
+		ocpp_config_registry_init(&config_registry, config_keys, sizeof(config_keys) / sizeof(config_keys[0]), CONFIG_RESPONSE_INITIAL_SIZE);
+
 	if(task_ocpp_handle == NULL){ // TODO: Make thread safe. NOTE: eTaskGetState returns eReady for deleted task
 		ESP_LOGI(TAG, "Creating ocpp task");
 		should_run = true;
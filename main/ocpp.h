@@ -13,7 +13,9 @@ bool ocpp_is_configured();
 int ocpp_get_stack_watermark();
 void init_interval_measurands(enum ocpp_reading_context_id context);
 void save_interval_measurands(enum ocpp_reading_context_id context);
-void handle_meter_value(enum ocpp_reading_context_id context, const char * csl, const char * stoptxn_csl,
+// Samples MeterValuesAlignedData if clock_aligned, else MeterValuesSampledData. StopTxn data of the same kind is
+// sampled for transaction related values if include_stop_txn.
+void handle_meter_value(enum ocpp_reading_context_id context, bool clock_aligned, bool include_stop_txn,
 			int * transaction_id, bool valid_id, uint * connectors, size_t connector_count, bool is_trigger);
 void ocpp_init();
 // When graceful is enabled, it will attempt to stop ongoing transactions and send any queued transaction related messages.
@@ -7,8 +7,14 @@
 #include "esp_vfs_fat.h"
 #include "esp_crc.h"
 
+#include <dirent.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "errno.h"
-#include "ff.h"
 #include "base64.h"
 #include "fat.h"
 
@@ -20,11 +26,31 @@
 #include "i2cDevices.h"
 #include "offline_log.h"
 
-static char tmp_path[] = "/files";
+static char tmp_path[32] = CONFIG_ZAPTEC_OFFLINE_LOG_MOUNT_POINT;
+
+#define OFFLINE_SESSION_MAX_SESSIONS 100
 
-static const int max_offline_session_files = 100;
+static const int max_offline_session_files = OFFLINE_SESSION_MAX_SESSIONS;
 static const int max_offline_signed_values = 100;
 
+/*
+ * Sessions are stored as records appended to segment files. A session is created with its ChargeSession JSON, updated
+ * by appending the JSON again, gets one record per signed energy value and is removed with a delete record. Segments
+ * are started when the active segment is full, and removed when they are older than the oldest session.
+ *
+ * An index in RAM has the position of the records of each session. It is saved in a manifest when sessions are created
+ * or deleted and every OFFLINE_SESSION_MANIFEST_INTERVAL records. At boot the newest valid manifest is loaded and the
+ * records written after it are replayed, so the segments are not scanned and writes do not update fixed offsets.
+ *
+ * Sessions keep the numbers they had with one file per session, and such files are imported when the index is loaded.
+ * The offsets below are only used for the import.
+ */
+#define OFFLINE_SESSION_MANIFEST_MAGIC 0x314D534F // "OSM1"
+#define OFFLINE_SESSION_MANIFEST_INTERVAL 32
+#define OFFLINE_SESSION_MAX_DATA_LENGTH 1000
+#define OFFLINE_SESSION_STAGE_SIZE 1536
+#define OFFLINE_SESSION_PATH_SIZE 48
+
 #define FILE_VERSION_ADDR_0  		0L
 #define FILE_SESSION_ADDR_2  		2L
 #define FILE_SESSION_CRC_ADDR_996	996L
@@ -34,11 +60,7 @@ static const int max_offline_signed_values = 100;
 struct LogOCMFData {
 	char label;
 
-	// Don't use directly, read and write through provided functions:
-	//
-	// offlineSession_ReadTimestamp
-	// offlineSession_SetTimestamp
-	//
+	// Don't use directly, read through offlineSession_ReadTimestamp
 	uint32_t _timestamp;
 	double energy;
 	uint32_t crc;
@@ -54,14 +76,67 @@ struct LogOCMFData {
 	uint32_t _timestampHigh;
 };
 
+enum session_record_type {
+	eSESSION_RECORD_CREATE = 1,
+	eSESSION_RECORD_UPDATE = 2,
+	eSESSION_RECORD_ENERGY = 3,
+	eSESSION_RECORD_DELETE = 4,
+};
+
+struct __attribute__((packed)) SessionRecordHeader {
+	uint8_t type;
+	uint8_t session;
+	uint16_t length; // Bytes of payload after the header
+	uint32_t crc; // Of the header with crc 0 and the payload
+};
+
+struct __attribute__((packed)) SessionEnergyRecord {
+	char label;
+	uint64_t timestamp;
+	double energy;
+};
+
+#define OFFLINE_SESSION_USED (1 << 0)
+
+struct SessionIndexEntry {
+	uint32_t first_segment; // Create record. Later records of the session are after it.
+	uint32_t first_offset;
+	uint32_t data_segment; // Newest create or update record
+	uint32_t data_offset;
+	uint16_t data_length;
+	uint8_t energy_count; // Values since the last 'B'
+	uint8_t flags;
+};
+
+struct SessionManifest {
+	uint32_t magic;
+	uint32_t sequence;
+	uint32_t segment; // End of the log when the index was saved
+	uint32_t offset;
+	struct SessionIndexEntry sessions[OFFLINE_SESSION_MAX_SESSIONS];
+	uint32_t crc;
+};
+
+static struct SessionIndexEntry sessionIndex[OFFLINE_SESSION_MAX_SESSIONS];
+static bool indexLoaded = false;
+static uint32_t manifestSequence = 0;
+static uint32_t recordsSinceManifest = 0;
+
+static uint32_t oldestSegment = 0;
+static uint32_t activeSegment = 0;
+static uint32_t activeOffset = 0;
+static FILE *activeSegmentFile = NULL;
+
+/// Records written by one call are committed together
+static uint8_t stage[OFFLINE_SESSION_STAGE_SIZE];
+static size_t stageLength = 0;
+
 static SemaphoreHandle_t offs_lock;
 static TickType_t lock_timeout = pdMS_TO_TICKS(1000*5);
 
 static bool offlineSessionOpen = false;
 
 static int activeFileNumber = -1;
-static char activePathString[32] = {0};
-static FILE *sessionFile = NULL;
 static int maxOfflineSessionsCount = 0;
 static bool disabledForCalibration = false;
 
@@ -74,9 +149,9 @@ static char sequenceDiagnostics[MAX_SEQ_DIAG_LEN] = {0};
 bool offlineSession_select_folder()
 {
 	struct stat st;
-	if(stat("/files", &st) == 0){
-		if(tmp_path[1] != 'f')
-			sprintf(tmp_path, "/files");
+	if(stat(CONFIG_ZAPTEC_OFFLINE_LOG_MOUNT_POINT, &st) == 0){
+		if(strcmp(tmp_path, CONFIG_ZAPTEC_OFFLINE_LOG_MOUNT_POINT) != 0)
+			sprintf(tmp_path, CONFIG_ZAPTEC_OFFLINE_LOG_MOUNT_POINT);
 
 		ESP_LOGI(TAG, "'%s' already mounted", tmp_path);
 		return true;
@@ -85,7 +160,7 @@ bool offlineSession_select_folder()
 	//If failing to mount, try using partition for chargers numbers below ~ZAP000150
 	if((errno == ENOENT && errno == ENODEV) && (i2cCheckSerialForDiskPartition() == true)){
 		if(stat("/disk", &st) == 0){
-			if(tmp_path[1] != 'd')
+			if(strcmp(tmp_path, "/disk") != 0)
 				sprintf(tmp_path, "/disk");
 
 			ESP_LOGI(TAG, "'%s' already mounted", tmp_path);
@@ -96,12 +171,20 @@ bool offlineSession_select_folder()
 	return false;
 }
 
+static void offlineSession_unload_index(void);
+
 void offlineSession_Init()
 {
-	offs_lock = xSemaphoreCreateMutex();
-	xSemaphoreGive(offs_lock);
+	if(offs_lock == NULL)
+	{
+		offs_lock = xSemaphoreCreateMutex();
+		xSemaphoreGive(offs_lock);
+	}
 
 	offlineSession_select_folder();
+
+	/// The index is loaded when first used, as the partition may not be mounted yet
+	offlineSession_unload_index();
 }
 
 void offlineSession_AppendLogString(char * stringToAdd)
@@ -206,16 +289,6 @@ static inline uint64_t offlineSession_ReadTimestamp(struct LogOCMFData *log, int
 	return timestamp;
 }
 
-static inline void offlineSession_SetTimestamp(struct LogOCMFData *log, int version, uint64_t timestamp) {
-	if (version == 2) {
-		log->_timestamp = timestamp & 0xffffffff;
-		log->_timestampHigh = (timestamp >> 32) & 0xffffffff;
-	} else {
-		log->_timestamp = timestamp & 0xffffffff;
-		log->_timestampHigh = 0;
-	}
-}
-
 static FILE *testFile = NULL;
 bool offlineSession_test_CreateFile()
 {
@@ -440,6 +513,9 @@ bool offlineSession_CheckAndCorrectFilesSystem()
 
 bool offlineSession_eraseAndRemountPartition()
 {
+	/// The segment must not be open while the partition is erased, and the index is rebuilt from the empty partition
+	offlineSession_unload_index();
+
 	int fileDiagLen = 0;
 	if(fileDiagnostics[0])
 		fileDiagLen = strlen(fileDiagnostics);
@@ -447,606 +523,1088 @@ bool offlineSession_eraseAndRemountPartition()
 	return fat_eraseAndRemountPartition(eFAT_ID_FILES, fileDiagnostics, FILE_DIAG_BUF_SIZE, fileDiagLen) == ESP_OK;
 }
 
+
+static void offlineSession_close_segment(void)
+{
+	if(activeSegmentFile != NULL)
+	{
+		fclose(activeSegmentFile);
+		activeSegmentFile = NULL;
+	}
+}
+
 /*
- * Find the file to use for a new session
+ * Forgets the index so that it is rebuilt from the files when next used. Used when a write failed, as the index may
+ * then describe records that are not on file, and when the partition is erased.
  */
-int offlineSession_FindNewFileNumber()
+static void offlineSession_unload_index(void)
 {
-	if (!offlineSession_is_mounted()) {
-		ESP_LOGE(TAG, "files is not mounted!");
-		return -1;
-	}
+	offlineSession_close_segment();
+	stageLength = 0;
+	indexLoaded = false;
+}
 
-	int fileNo = 0;
-	FILE *file;
-	char buf[32] = {0};
+static void offlineSession_segment_path(char * path, uint32_t segment)
+{
+	snprintf(path, OFFLINE_SESSION_PATH_SIZE, "%s/%08" PRIX32 ".ses", tmp_path, segment);
+}
 
-	ESP_LOGI(TAG, "Searching for first unused OfflineSession file...");
+static void offlineSession_manifest_path(char * path, uint32_t sequence)
+{
+	snprintf(path, OFFLINE_SESSION_PATH_SIZE, "%s/sessions.%" PRIu32, tmp_path, sequence & 1);
+}
 
-	//for (fileNo = 0; fileNo < max_offline_session_files; fileNo++)
-	for (fileNo = max_offline_session_files-1; fileNo >= 0; fileNo--)
+static bool offlineSession_record_is_valid(const struct SessionRecordHeader * header)
+{
+	switch(header->type)
 	{
-		sprintf(buf,"%s/%d.bin", tmp_path, fileNo);
-
-		file = fopen(buf, "r");
-		if(file != NULL)
-		{
-			fclose(file);
-
-			//Max file (99) is used, no available
-			if(fileNo == (max_offline_session_files - 1))
-				return -1;
-			else
-			{
-				fileNo = fileNo + 1;
-				break; //Found unused file, abort search
-			}
-		}
-		else
-		{
-			///Found 0 as first unused file
-			if(fileNo == 0)
-				break;
-		}
+	case eSESSION_RECORD_CREATE:
+	case eSESSION_RECORD_UPDATE:
+		return header->length <= OFFLINE_SESSION_MAX_DATA_LENGTH;
+	case eSESSION_RECORD_ENERGY:
+		return header->length == sizeof(struct SessionEnergyRecord);
+	case eSESSION_RECORD_DELETE:
+		return header->length == 0;
+	default:
+		return false;
 	}
+}
 
-	ESP_LOGI(TAG, "Found from top as first unused OfflineSession file: %d", fileNo);
-
-	return fileNo;
+static uint32_t offlineSession_record_crc(struct SessionRecordHeader header, const void * payload)
+{
+	header.crc = 0;
+	uint32_t crc = esp_crc32_le(0, (uint8_t *)&header, sizeof(struct SessionRecordHeader));
+	return esp_crc32_le(crc, payload, header.length);
 }
 
 /*
- * Find the oldest file to read, send, delete
+ * Reads the record at the current position of fp. payload must have room for OFFLINE_SESSION_MAX_DATA_LENGTH bytes.
+ *
+ * Returns ESP_ERR_NOT_FOUND at the end of the segment and ESP_ERR_INVALID_CRC if the record is incomplete or corrupt.
  */
-int offlineSession_FindOldestFile()
+static esp_err_t offlineSession_read_record(FILE * fp, struct SessionRecordHeader * header, uint8_t * payload)
 {
-	if (!offlineSession_is_mounted()) {
-		ESP_LOGE(TAG, "files is not mounted!");
-		return -1;
-	}
-
-	int fileNo = 0;
-	FILE *file;
-	char buf[32] = {0};
+	size_t read = fread(header, 1, sizeof(struct SessionRecordHeader), fp);
+	if(read == 0)
+		return ESP_ERR_NOT_FOUND;
 
-	for (fileNo = 0; fileNo < max_offline_session_files; fileNo++ )
-	{
-		sprintf(buf,"%s/%d.bin", tmp_path, fileNo);
+	if(read != sizeof(struct SessionRecordHeader) || !offlineSession_record_is_valid(header))
+		return ESP_ERR_INVALID_CRC;
 
-		file = fopen(buf, "r");
-		if(file != NULL)
-		{
-			fclose(file);
-			ESP_LOGI(TAG, "OfflineSession file: %d", fileNo);
-			return fileNo; ///Return the current file number
-		}
+	if(fread(payload, 1, header->length, fp) != header->length)
+		return ESP_ERR_INVALID_CRC;
 
-	}
+	if(offlineSession_record_crc(*header, payload) != header->crc)
+		return ESP_ERR_INVALID_CRC;
 
-	return -1; //No files found
+	return ESP_OK;
 }
 
-
-int offlineSession_FindNrOfFiles()
+/*
+ * Updates the index with a record written at segment and offset. Records of unused session numbers belong to deleted
+ * sessions whose create record was in a removed segment, and are ignored.
+ */
+static void offlineSession_apply_record(const struct SessionRecordHeader * header, const uint8_t * payload,
+					uint32_t segment, uint32_t offset)
 {
-	if (!offlineSession_is_mounted()) {
-		ESP_LOGE(TAG, "files is not mounted!");
-		return -1;
+	if(header->session >= OFFLINE_SESSION_MAX_SESSIONS)
+		return;
+
+	struct SessionIndexEntry * entry = &sessionIndex[header->session];
+
+	if(header->type == eSESSION_RECORD_CREATE)
+	{
+		*entry = (struct SessionIndexEntry){
+			.first_segment = segment,
+			.first_offset = offset,
+			.data_segment = segment,
+			.data_offset = offset,
+			.data_length = header->length,
+			.flags = OFFLINE_SESSION_USED,
+		};
+		return;
 	}
 
-	int fileNo = 0;
-	FILE *file;
-	char buf[32] = {0};
-	int fileCount = 0;
+	if(!(entry->flags & OFFLINE_SESSION_USED))
+		return;
 
-	for (fileNo = 0; fileNo < max_offline_session_files; fileNo++ )
+	switch(header->type)
 	{
-		sprintf(buf,"%s/%d.bin", tmp_path, fileNo);
+	case eSESSION_RECORD_UPDATE:
+		entry->data_segment = segment;
+		entry->data_offset = offset;
+		entry->data_length = header->length;
+		break;
+	case eSESSION_RECORD_ENERGY:
+		/// A new 'B' value replaces the values before it, as it was written as the first element of the session file
+		if(((const struct SessionEnergyRecord *)payload)->label == 'B')
+			entry->energy_count = 0;
+
+		if(entry->energy_count < UINT8_MAX)
+			entry->energy_count++;
+		break;
+	case eSESSION_RECORD_DELETE:
+		memset(entry, 0, sizeof(struct SessionIndexEntry));
+		break;
+	}
+}
 
-		file = fopen(buf, "r");
-		if(file != NULL)
-		{
-			fclose(file);
-			fileCount++;
-			ESP_LOGI(TAG, "OfflineSession found file: %d", fileNo);
-		}
+/*
+ * Writes the staged records with a single write and syncs the segment, so that a reset can at most lose the records of
+ * the last commit.
+ */
+static esp_err_t offlineSession_commit(void)
+{
+	if(stageLength == 0)
+		return ESP_OK;
 
+	if(activeSegmentFile == NULL
+		|| fwrite(stage, 1, stageLength, activeSegmentFile) != stageLength
+		|| fflush(activeSegmentFile) != 0
+		|| fsync(fileno(activeSegmentFile)) != 0)
+	{
+		ESP_LOGE(TAG, "Failed to write %d bytes to segment %" PRIu32 ": %s", (int)stageLength, activeSegment, strerror(errno));
+		offlineSession_AppendLogStringErr();
+		offlineSession_unload_index();
+		return ESP_FAIL;
 	}
-	ESP_LOGI(TAG, "Nr of OfflineSession files: %d", fileCount);
 
-	if(fileCount > maxOfflineSessionsCount)
-		maxOfflineSessionsCount = fileCount;
+	activeOffset += stageLength;
+	stageLength = 0;
 
-	return fileCount;
+	return ESP_OK;
 }
 
-int offlineSession_GetMaxSessionCount()
+static esp_err_t offlineSession_open_segment(void)
 {
-	int tmp = maxOfflineSessionsCount;
-	maxOfflineSessionsCount = 0;
-	return tmp;
-}
+	char path[OFFLINE_SESSION_PATH_SIZE];
+	offlineSession_segment_path(path, activeSegment);
 
-int offlineSession_CheckIfLastLessionIncomplete(struct ChargeSession *incompleteSession)
-{
-	if (!offlineSession_is_mounted()) {
-		ESP_LOGE(TAG, "files is not mounted!");
-		return -1;
+	activeSegmentFile = fopen(path, "ab");
+	if(activeSegmentFile == NULL)
+	{
+		ESP_LOGE(TAG, "Failed to open segment %s: %s", path, strerror(errno));
+		offlineSession_AppendLogString("Segment = NULL");
+		offlineSession_AppendLogStringErr();
+		return ESP_FAIL;
 	}
 
-	int fileNo = 0;
-	FILE *lastUsedFile;
-	char buf[32] = {0};
+	return ESP_OK;
+}
 
-	/// First check file 0 to see if there are any offlineSession files
-	sprintf(buf,"%s/%d.bin", tmp_path, fileNo);
-	lastUsedFile = fopen(buf, "r");
-	if(lastUsedFile == NULL)
-	{
-		/// No file nr 0 found
-		ESP_LOGI(TAG, "No offline files found during boot with car connected");
-		return -1;
-	}
-	else
+/*
+ * Adds a record to the stage and the index. The stage is committed first if the record does not fit in it or in the
+ * active segment, and a new segment is started if the active segment is full.
+ */
+static esp_err_t offlineSession_stage_record(enum session_record_type type, int session, const void * payload, size_t length)
+{
+	size_t recordLength = sizeof(struct SessionRecordHeader) + length;
+	if(recordLength > sizeof(stage))
+		return ESP_ERR_INVALID_SIZE;
+
+	if(stageLength + recordLength > sizeof(stage)
+		|| activeOffset + stageLength + recordLength > CONFIG_ZAPTEC_OFFLINE_SESSION_SEGMENT_SIZE)
 	{
-		/// File nr 0 found
-		fclose(lastUsedFile);
+		esp_err_t err = offlineSession_commit();
+		if(err != ESP_OK)
+			return err;
 	}
 
-	/// Then perform search from top to see if there are later files
-	for (fileNo = max_offline_session_files-1; fileNo >= 0; fileNo-- )
+	if(activeOffset > 0 && activeOffset + recordLength > CONFIG_ZAPTEC_OFFLINE_SESSION_SEGMENT_SIZE)
 	{
-		sprintf(buf,"%s/%d.bin", tmp_path, fileNo);
+		offlineSession_close_segment();
+		activeSegment++;
+		activeOffset = 0;
 
-		lastUsedFile = fopen(buf, "r");
-		if(lastUsedFile != NULL)
+		if(offlineSession_open_segment() != ESP_OK)
 		{
-			cJSON * lastSession = cJSON_CreateObject();
-			lastSession = offlineSession_ReadChargeSessionFromFile(fileNo);
-
-			if(cJSON_HasObjectItem(lastSession, "EndDateTime"))
-			{
-				int i = strlen(cJSON_GetObjectItem(lastSession,"EndDateTime")->valuestring);
-				if (i > 0)
-				{
-					ESP_LOGE(TAG, "EndDateTime has length %d. Session is COMPLETE", i);
-					activeFileNumber = -1;
-				}
-				else
-				{
-					ESP_LOGE(TAG, "EndDateTime has length %d. Session is IN-COMPLETE", i);
-
-					/// Read the incomplete structure from file
-					if(cJSON_HasObjectItem(lastSession, "SessionId") &&
-							cJSON_HasObjectItem(lastSession, "Energy") &&
-							cJSON_HasObjectItem(lastSession, "StartDateTime") &&
-							cJSON_HasObjectItem(lastSession, "ReliableClock") &&
-							cJSON_HasObjectItem(lastSession, "StoppedByRFID")&&
-							cJSON_HasObjectItem(lastSession, "AuthenticationCode"))
-					{
-						strncpy(incompleteSession->SessionId, 	cJSON_GetObjectItem(lastSession,"SessionId")->valuestring, 37);
-						incompleteSession->Energy = 				cJSON_GetObjectItem(lastSession,"Energy")->valuedouble;
-						strncpy(incompleteSession->StartDateTime,	cJSON_GetObjectItem(lastSession,"StartDateTime")->valuestring, 32);
-						strncpy(incompleteSession->EndDateTime,	cJSON_GetObjectItem(lastSession,"EndDateTime")->valuestring, 32);
-
-						if(cJSON_GetObjectItem(lastSession,"ReliableClock")->valueint > 0)
-							incompleteSession->ReliableClock = true;
-						else
-							incompleteSession->ReliableClock = false;
-
-						if(cJSON_GetObjectItem(lastSession,"StoppedByRFID")->valueint > 0)
-							incompleteSession->StoppedByRFID = true;
-						else
-							incompleteSession->StoppedByRFID = false;
-
-						strncpy(incompleteSession->AuthenticationCode ,cJSON_GetObjectItem(lastSession,"AuthenticationCode")->valuestring, 41);
-
-						ESP_LOGI(TAG, "SessionId=%s",incompleteSession->SessionId);
-						ESP_LOGI(TAG, "Energy=%f",incompleteSession->Energy);
-						ESP_LOGI(TAG, "StartDateTime=%s",incompleteSession->StartDateTime);
-						ESP_LOGI(TAG, "EndDateTime=%s",incompleteSession->EndDateTime);
-						ESP_LOGI(TAG, "ReliableClock=%d",incompleteSession->ReliableClock);
-						ESP_LOGI(TAG, "StoppedByRFID=%d",incompleteSession->StoppedByRFID);
-						ESP_LOGI(TAG, "AuthenticationCode=%s",incompleteSession->AuthenticationCode);
-					}
-
-					/// Must set activeFileNumber, path and offlineSessionOpen to allow new SignedValues entries
-					activeFileNumber = fileNo;
-					sprintf(activePathString,"%s/%d.bin", tmp_path, activeFileNumber);
-					offlineSessionOpen = true;
-				}
-			}
+			offlineSession_unload_index();
+			return ESP_FAIL;
+		}
+	}
 
-			cJSON_Delete(lastSession);
+	struct SessionRecordHeader header = {
+		.type = type,
+		.session = session,
+		.length = length,
+	};
+	header.crc = offlineSession_record_crc(header, payload);
 
-			/// Found the last file from top
-			fclose(lastUsedFile);
+	uint8_t * record = stage + stageLength;
+	memcpy(record, &header, sizeof(struct SessionRecordHeader));
+	if(length > 0)
+		memcpy(record + sizeof(struct SessionRecordHeader), payload, length);
 
-			ESP_LOGI(TAG, "OfflineSession found last used file from top: %d", fileNo);
+	offlineSession_apply_record(&header, record + sizeof(struct SessionRecordHeader), activeSegment, activeOffset + stageLength);
 
-			/// End loop with fileNo >= 0 if last session was Incomplete
-			break;
-		}
-	}
+	stageLength += recordLength;
+	recordsSinceManifest++;
 
-	return activeFileNumber;
+	return ESP_OK;
 }
 
-
-/// Call this function to ensure that the sessionFile is no longer accessed
-static int lastUsedFileNumber = -1;
-void offlineSession_SetSessionFileInactive()
+static bool offlineSession_read_manifest(uint32_t sequence, struct SessionManifest * manifest)
 {
-	lastUsedFileNumber = activeFileNumber;
-	activeFileNumber = -1;
-	strcpy(activePathString, "");
-}
+	char path[OFFLINE_SESSION_PATH_SIZE];
+	offlineSession_manifest_path(path, sequence);
 
-void offlineSession_DeleteLastUsedFile()
-{
-	if((activeFileNumber == -1) && (lastUsedFileNumber >= 0))
-	{
-		ESP_LOGE(TAG, "### Deleting last session because LOCAL only with energy = 0.0 ###");
-		offlineSession_delete_session(lastUsedFileNumber);
-		lastUsedFileNumber = -1;
-	}
+	FILE * fp = fopen(path, "rb");
+	if(fp == NULL)
+		return false;
+
+	size_t read = fread(manifest, sizeof(struct SessionManifest), 1, fp);
+	fclose(fp);
+
+	return read == 1 && manifest->magic == OFFLINE_SESSION_MANIFEST_MAGIC
+		&& manifest->crc == esp_crc32_le(0, (uint8_t *)manifest, offsetof(struct SessionManifest, crc));
 }
 
-int offlineSession_UpdateSessionOnFile(char *sessionData, bool createNewFile)
+/*
+ * Saves the index at the end of the log. The two manifest files are written alternately, so that the previous
+ * manifest is still valid if writing is interrupted.
+ */
+static esp_err_t offlineSession_write_manifest(void)
 {
-	ESP_LOGW(TAG, " *** UpdateSessionOnFile: %i ***", createNewFile);
+	esp_err_t err = offlineSession_commit();
+	if(err != ESP_OK)
+		return err;
+
+	struct SessionManifest * manifest = malloc(sizeof(struct SessionManifest));
+	if(manifest == NULL)
+		return ESP_ERR_NO_MEM;
+
+	manifest->magic = OFFLINE_SESSION_MANIFEST_MAGIC;
+	manifest->sequence = manifestSequence + 1;
+	manifest->segment = activeSegment;
+	manifest->offset = activeOffset;
+	memcpy(manifest->sessions, sessionIndex, sizeof(sessionIndex));
+	manifest->crc = esp_crc32_le(0, (uint8_t *)manifest, offsetof(struct SessionManifest, crc));
+
+	char path[OFFLINE_SESSION_PATH_SIZE];
+	offlineSession_manifest_path(path, manifest->sequence);
+
+	err = ESP_FAIL;
+	FILE * fp = fopen(path, "wb");
+	if(fp != NULL)
+	{
+		if(fwrite(manifest, sizeof(struct SessionManifest), 1, fp) == 1 && fflush(fp) == 0 && fsync(fileno(fp)) == 0)
+			err = ESP_OK;
 
-	if (!offlineSession_is_mounted()) {
-		ESP_LOGE(TAG, "files is not mounted!");
-		return ESP_FAIL;
+		fclose(fp);
 	}
 
-	if(activeFileNumber < 0)
-		return ESP_FAIL;
-
-
-	if( xSemaphoreTake( offs_lock, lock_timeout ) != pdTRUE )
+	if(err == ESP_OK)
 	{
-		ESP_LOGE(TAG, "failed to obtain offs lock during finalize");
-		return ESP_FAIL;
+		manifestSequence = manifest->sequence;
+		recordsSinceManifest = 0;
 	}
-
-	if(createNewFile)
-		sessionFile = fopen(activePathString, "wb+");
 	else
-		sessionFile = fopen(activePathString, "rb+");
-
-	if(sessionFile == NULL)
 	{
-		ESP_LOGE(TAG, "Could not create or open sessionFile %s (%i)", activePathString, createNewFile);
-		if(createNewFile)
-		{
-			offlineSession_AppendLogString("1 sessionFile = NULL");
-			offlineSession_AppendLogStringErr();
-		}
-		else
-		{
-			offlineSession_AppendLogString("2 Reopen sessionFile = NULL");
-			offlineSession_AppendLogStringErr();
-		}
-
-		xSemaphoreGive(offs_lock);
-		return -2;
+		ESP_LOGE(TAG, "Failed to write manifest %s: %s", path, strerror(errno));
 	}
 
-	//ESP_LOGW(TAG, "strlen: %d, path: %s", strlen(sessionData), activePathString);
+	free(manifest);
+	return err;
+}
 
-	// Write version 2 for new sessions, which support 64-bit timestamp
-	uint8_t fileVersion = 2;
-	fseek(sessionFile, FILE_VERSION_ADDR_0, SEEK_SET);
-	fwrite(&fileVersion, 1, 1, sessionFile);
+/*
+ * Removes segments before the segment of the oldest session. The records in them only belong to deleted sessions.
+ */
+static void offlineSession_remove_old_segments(void)
+{
+	uint32_t keep = activeSegment;
+	for(int i = 0; i < OFFLINE_SESSION_MAX_SESSIONS; i++)
+	{
+		if((sessionIndex[i].flags & OFFLINE_SESSION_USED) && sessionIndex[i].first_segment < keep)
+			keep = sessionIndex[i].first_segment;
+	}
 
-	int sessionDataLen = strlen(sessionData);
-	size_t outLen = 0;
-	char * base64SessionData = base64_encode(sessionData, sessionDataLen, &outLen);
-	volatile int base64SessionDataLen = strlen(base64SessionData);
+	char path[OFFLINE_SESSION_PATH_SIZE];
+	for(; oldestSegment < keep; oldestSegment++)
+	{
+		offlineSession_segment_path(path, oldestSegment);
+		if(remove(path) == 0)
+			ESP_LOGI(TAG, "Removed segment %" PRIu32, oldestSegment);
+	}
+}
 
-	ESP_LOGI(TAG,"%d: %s\n", strlen(sessionData), sessionData);
-	//ESP_LOGW(TAG,"%d: %s\n", strlen(base64SessionData), base64SessionData);
-	if(base64SessionDataLen != outLen)
+/// Writes the manifest when sessions are created or deleted, or when enough records have been added since the last
+static void offlineSession_update_manifest(bool sessionsChanged)
+{
+	if(sessionsChanged || recordsSinceManifest >= OFFLINE_SESSION_MANIFEST_INTERVAL)
 	{
-		ESP_LOGE(TAG,"##### %i != %i ######", base64SessionDataLen, outLen);
-		offlineSession_AppendLogStringWithIntInt("1 base64EncodeLen vs outLen", base64SessionDataLen, outLen);
+		if(offlineSession_write_manifest() == ESP_OK)
+			offlineSession_remove_old_segments();
 	}
-	/*else
+}
+
+/// Finds the first and last segment on file, and if there are session files to import
+static bool offlineSession_find_segments(uint32_t * first, uint32_t * last, bool * importFiles)
+{
+	*importFiles = false;
+
+	DIR * dir = opendir(tmp_path);
+	if(dir == NULL)
+		return false;
+
+	bool found = false;
+	struct dirent * dp;
+	while((dp = readdir(dir)) != NULL)
 	{
-		ESP_LOGI(TAG,"***** %i == %i ******", base64SessionDataLen, outLen);
-	}*/
+		uint32_t segment;
+		char extension[5] = {0};
+		if(sscanf(dp->d_name, "%8" SCNx32 ".%4s", &segment, extension) != 2)
+			continue;
 
-	fseek(sessionFile, FILE_SESSION_ADDR_2, SEEK_SET);
-	size_t wr1 = fwrite(base64SessionData, base64SessionDataLen, 1, sessionFile);
+		if(strcasecmp(extension, "bin") == 0 && segment < 0x100 && strlen(dp->d_name) <= 6)
+			*importFiles = true; /// Decimal number up to 99, read as hexadecimal
 
-	///Write CRC at the end of the block
-	uint32_t crcCalc = esp_crc32_le(0, (uint8_t *)base64SessionData, base64SessionDataLen);
-	fseek(sessionFile, FILE_SESSION_CRC_ADDR_996, SEEK_SET);
-	size_t wr2 = fwrite(&crcCalc, sizeof(uint32_t), 1, sessionFile);
+		if(strcasecmp(extension, "ses") != 0)
+			continue;
 
-	//ESP_LOGW(TAG, "Session CRC:: 0x%X", crcCalc);
+		if(!found || segment < *first)
+			*first = segment;
 
-	free(base64SessionData);
-	fclose(sessionFile);
+		if(!found || segment > *last)
+			*last = segment;
 
-	if(createNewFile)
-	{
-		//Added diagnostics to try and find cause of empty sessions.
-		offlineSession_AppendLogStringWithIntInt("1 sessionFile created", wr1, wr2);
+		found = true;
 	}
 
-	xSemaphoreGive(offs_lock);
-
-	return ESP_OK;
+	closedir(dir);
+	return found;
 }
 
-esp_err_t offlineSession_Diagnostics_ReadFileContent(int fileNo)
+/*
+ * Replays the records of a segment from offset. end is set to the end of the last valid record.
+ */
+static esp_err_t offlineSession_replay_segment(uint32_t segment, uint32_t offset, uint8_t * payload, uint32_t * end, uint32_t * records)
 {
-	if (!offlineSession_is_mounted()) {
-		ESP_LOGE(TAG, "files is not mounted!");
-		return -1;
-	}
+	*end = offset;
 
-	if( xSemaphoreTake( offs_lock, lock_timeout ) != pdTRUE )
-	{
-		ESP_LOGE(TAG, "failed to obtain offs lock during finalize");
-		return -1;
-	}
+	char path[OFFLINE_SESSION_PATH_SIZE];
+	offlineSession_segment_path(path, segment);
+
+	FILE * fp = fopen(path, "rb");
+	if(fp == NULL)
+		return ESP_ERR_NOT_FOUND;
 
-	char buf[32] = {0};
-	sprintf(buf,"%s/%d.bin", tmp_path, fileNo);
-	sessionFile = fopen(buf, "r");
+	fseek(fp, offset, SEEK_SET);
 
-	if(sessionFile == NULL)
+	esp_err_t err;
+	struct SessionRecordHeader header;
+	while((err = offlineSession_read_record(fp, &header, payload)) == ESP_OK)
 	{
-		xSemaphoreGive(offs_lock);
-		ESP_LOGE(TAG, "Print: sessionFile == NULL");
-		return ESP_FAIL;
+		offlineSession_apply_record(&header, payload, segment, *end);
+		*end += sizeof(struct SessionRecordHeader) + header.length;
+		(*records)++;
 	}
 
+	fclose(fp);
+
+	return (err == ESP_ERR_NOT_FOUND) ? ESP_OK : err;
+}
+
+/*
+ * Imports a session file from before the log was used. The session keeps its number. The file is removed after its
+ * records are committed, and a session left by an interrupted import is replaced when the import is repeated.
+ */
+static void offlineSession_import_file(int fileNo, const char * path, FILE * fp)
+{
 	uint8_t fileVersion = 0;
-	fread(&fileVersion, 1, 1, sessionFile);
-	ESP_LOGW(TAG, "File version: %d", fileVersion);
+	fread(&fileVersion, 1, 1, fp);
 
-	/// Read session CRC
-	fseek(sessionFile, FILE_SESSION_CRC_ADDR_996, SEEK_SET);
 	uint32_t crcRead = 0;
-	fread(&crcRead, sizeof(uint32_t), 1, sessionFile);
+	fseek(fp, FILE_SESSION_CRC_ADDR_996, SEEK_SET);
+	fread(&crcRead, sizeof(uint32_t), 1, fp);
 
-	/// Go to beginning before reading
-	fseek(sessionFile, FILE_SESSION_ADDR_2, SEEK_SET);
+	char * base64SessionData = calloc(1000-6+1, 1);
+	if(base64SessionData == NULL)
+		return;
 
+	fseek(fp, FILE_SESSION_ADDR_2, SEEK_SET);
+	fread(base64SessionData, 1000-6, 1, fp);
 
-	char * base64SessionData = calloc(1000-6, 1);
-	fread(base64SessionData, 1000-6, 1, sessionFile);
+	int base64SessionDataLen = strlen(base64SessionData);
+	size_t outLen = 0;
+	char * sessionData = NULL;
 
-	int readLen = strlen(base64SessionData);
-	uint32_t crcCalc = 0;
-	if(readLen <= 996)
-		crcCalc = esp_crc32_le(0, (uint8_t *)base64SessionData, readLen);
+	if(crcRead == esp_crc32_le(0, (uint8_t *)base64SessionData, base64SessionDataLen))
+		sessionData = (char *)base64_decode(base64SessionData, base64SessionDataLen, &outLen);
 
-	ESP_LOGW(TAG,"Session CRC read control: 0x%" PRIX32 " vs 0x%" PRIX32 ": %s", crcRead, crcCalc, (crcRead == crcCalc) ? "MATCH" : "FAIL");
+	free(base64SessionData);
 
-	if(crcRead != crcCalc)
-	{
-		free(base64SessionData);
-		xSemaphoreGive(offs_lock);
-		return ESP_ERR_INVALID_CRC;
-	}
+	/// A session that can not be read is imported without data, which is reported as before when it is sent
+	if(sessionData == NULL || outLen > OFFLINE_SESSION_MAX_DATA_LENGTH)
+		outLen = 0;
 
-	/// Find first \0 element in the array, index = length of base64 encoded CompletedSession-structure
-	int endIndex = 0;
-	for (endIndex = 0; endIndex <= 999; endIndex++)
-	{
-		if(base64SessionData[endIndex] == '\0')
-		{
-			break;
-		}
-	}
+	ESP_LOGW(TAG, "Importing session file %d, %d bytes of session data", fileNo, (int)outLen);
 
-	int base64SessionDataLen = endIndex+1;
-	size_t outLen = 0;
-	char *sessionDataCreated = (char*)base64_decode(base64SessionData, base64SessionDataLen, &outLen);
+	if(sessionIndex[fileNo].flags & OFFLINE_SESSION_USED)
+		offlineSession_stage_record(eSESSION_RECORD_DELETE, fileNo, NULL, 0);
 
-	printf("%d: %s\n", strlen(base64SessionData), base64SessionData);
-	printf("%d: %.*s\n", strlen(sessionDataCreated), outLen, sessionDataCreated);
+	esp_err_t err = offlineSession_stage_record(eSESSION_RECORD_CREATE, fileNo, sessionData, outLen);
+	free(sessionData);
 
-	struct ChargeSession chargeSessionFromFile = {0};
+	uint32_t nrOfOCMFElements = 0;
+	fseek(fp, FILE_NR_OF_OCMF_ADDR_1000, SEEK_SET);
+	fread(&nrOfOCMFElements, sizeof(uint32_t), 1, fp);
+
+	if(nrOfOCMFElements > max_offline_signed_values)
+		nrOfOCMFElements = 0;
 
-	cJSON* jsonSession = cJSON_Parse(sessionDataCreated);
+	fseek(fp, FILE_OCMF_START_ADDR_1004, SEEK_SET);
 
-	if(cJSON_HasObjectItem(jsonSession, "SessionId") &&
-			cJSON_HasObjectItem(jsonSession, "Energy") &&
-			cJSON_HasObjectItem(jsonSession, "StartDateTime") &&
-			cJSON_HasObjectItem(jsonSession, "EndDateTime") &&
-			cJSON_HasObjectItem(jsonSession, "ReliableClock") &&
-			cJSON_HasObjectItem(jsonSession, "StoppedByRFID")&&
-			cJSON_HasObjectItem(jsonSession, "AuthenticationCode"))
+	for(int i = 0; i < nrOfOCMFElements && err == ESP_OK; i++)
 	{
-		strncpy(chargeSessionFromFile.SessionId, 	cJSON_GetObjectItem(jsonSession,"SessionId")->valuestring, 37);
-		chargeSessionFromFile.Energy = 				cJSON_GetObjectItem(jsonSession,"Energy")->valuedouble;
-		strncpy(chargeSessionFromFile.StartDateTime,	cJSON_GetObjectItem(jsonSession,"StartDateTime")->valuestring, 32);
-		strncpy(chargeSessionFromFile.EndDateTime,	cJSON_GetObjectItem(jsonSession,"EndDateTime")->valuestring, 32);
+		struct LogOCMFData OCMFElement;
+		if(fread(&OCMFElement, sizeof(struct LogOCMFData), 1, fp) != 1)
+			break;
 
-		if(cJSON_GetObjectItem(jsonSession,"ReliableClock")->valueint > 0)
-			chargeSessionFromFile.ReliableClock = true;
-		else
-			chargeSessionFromFile.ReliableClock = false;
+		uint32_t packetCrc = OCMFElement.crc;
+		OCMFElement.crc = 0;
 
-		if(cJSON_GetObjectItem(jsonSession,"StoppedByRFID")->valueint > 0)
-			chargeSessionFromFile.StoppedByRFID = true;
-		else
-			chargeSessionFromFile.StoppedByRFID = false;
+		if(esp_crc32_le(0, (uint8_t *)&OCMFElement, sizeof(struct LogOCMFData)) != packetCrc)
+			continue;
 
-		strncpy(chargeSessionFromFile.AuthenticationCode ,cJSON_GetObjectItem(jsonSession,"AuthenticationCode")->valuestring, 41);
+		struct SessionEnergyRecord value = {
+			.label = OCMFElement.label,
+			.timestamp = offlineSession_ReadTimestamp(&OCMFElement, fileVersion),
+			.energy = OCMFElement.energy,
+		};
 
-		ESP_LOGI(TAG, "SessionId=%s",chargeSessionFromFile.SessionId);
-		ESP_LOGI(TAG, "Energy=%f",chargeSessionFromFile.Energy);
-		ESP_LOGI(TAG, "StartDateTime=%s",chargeSessionFromFile.StartDateTime);
-		ESP_LOGI(TAG, "EndDateTime=%s",chargeSessionFromFile.EndDateTime);
-		ESP_LOGI(TAG, "ReliableClock=%d",chargeSessionFromFile.ReliableClock);
-		ESP_LOGI(TAG, "StoppedByRFID=%d",chargeSessionFromFile.StoppedByRFID);
-		ESP_LOGI(TAG, "AuthenticationCode=%s",chargeSessionFromFile.AuthenticationCode);
+		err = offlineSession_stage_record(eSESSION_RECORD_ENERGY, fileNo, &value, sizeof(value));
 	}
 
-	if(jsonSession != NULL)
-		cJSON_Delete(jsonSession);
+	if(err == ESP_OK)
+		err = offlineSession_commit();
+
+	if(err == ESP_OK)
+		remove(path);
+}
+
+static void offlineSession_import_files(void)
+{
+	char path[OFFLINE_SESSION_PATH_SIZE];
+	for(int fileNo = 0; fileNo < max_offline_session_files && indexLoaded; fileNo++)
+	{
+		sprintf(path, "%s/%d.bin", tmp_path, fileNo);
 
+		FILE * fp = fopen(path, "rb");
+		if(fp == NULL)
+			continue;
 
-	/// Go to length index
-	fseek(sessionFile, FILE_NR_OF_OCMF_ADDR_1000, SEEK_SET);
+		offlineSession_import_file(fileNo, path, fp);
+		fclose(fp);
 
-	uint32_t nrOfOCMFElements = 0;
-	fread(&nrOfOCMFElements, sizeof(uint32_t), 1, sessionFile);
-	ESP_LOGI(TAG, "NrOfElements read: %" PRIi32 "", nrOfOCMFElements);
+		recordsSinceManifest = OFFLINE_SESSION_MANIFEST_INTERVAL;
+	}
+}
+
+/*
+ * Builds the index from the newest valid manifest and the records after it, or from all segments if no manifest
+ * matches the segments on file. An incomplete record at the end of the log is removed, so that new records are not
+ * written after it.
+ */
+static esp_err_t offlineSession_load_index(void)
+{
+	offlineSession_unload_index();
+	memset(sessionIndex, 0, sizeof(sessionIndex));
+	recordsSinceManifest = 0;
+
+	uint32_t firstSegment = 0;
+	uint32_t lastSegment = 0;
+	bool importFiles = false;
+	bool segmentsFound = offlineSession_find_segments(&firstSegment, &lastSegment, &importFiles);
+
+	struct SessionManifest * manifest = malloc(sizeof(struct SessionManifest));
+	uint8_t * payload = malloc(OFFLINE_SESSION_MAX_DATA_LENGTH);
+	if(manifest == NULL || payload == NULL)
+	{
+		free(manifest);
+		free(payload);
+		return ESP_ERR_NO_MEM;
+	}
 
-	/// Build OCMF strings for each element
-	if(nrOfOCMFElements > 0)
+	/// Use the valid manifest with the highest sequence number
+	bool manifestFound = false;
+	manifestSequence = 0;
+	for(uint32_t i = 0; i < 2; i++)
 	{
-		int i;
-		for (i = 0; i < nrOfOCMFElements; i++)
+		if(offlineSession_read_manifest(i, &manifest[0]) && (!manifestFound || manifest->sequence > manifestSequence))
 		{
-			/// Go to element position
-			int newElementPosition = (FILE_OCMF_START_ADDR_1004) + ((i) * sizeof(struct LogOCMFData));
-			fseek(sessionFile, newElementPosition, SEEK_SET);
+			manifestFound = true;
+			manifestSequence = manifest->sequence;
+		}
+	}
 
-			struct LogOCMFData OCMFElement;
-			fread(&OCMFElement, sizeof(struct LogOCMFData), 1, sessionFile);
+	if(manifestFound)
+		offlineSession_read_manifest(manifestSequence, manifest);
 
-			uint64_t timestamp = offlineSession_ReadTimestamp(&OCMFElement, fileVersion);
+	uint32_t segment = firstSegment;
+	uint32_t offset = 0;
 
-			/// Hold'n clear crc to get correct calculation for packet
-			uint32_t packetCrc = OCMFElement.crc;
-			OCMFElement.crc = 0;
+	if(manifestFound && segmentsFound && manifest->segment >= firstSegment && manifest->segment <= lastSegment)
+	{
+		char path[OFFLINE_SESSION_PATH_SIZE];
+		offlineSession_segment_path(path, manifest->segment);
 
-			uint32_t crcCalc = esp_crc32_le(0, (uint8_t *)&OCMFElement, sizeof(struct LogOCMFData));
+		struct stat st;
+		if(stat(path, &st) == 0 && st.st_size >= manifest->offset)
+		{
+			memcpy(sessionIndex, manifest->sessions, sizeof(sessionIndex));
+			segment = manifest->segment;
+			offset = manifest->offset;
+		}
+		else
+		{
+			manifestFound = false;
+		}
+	}
+	else
+	{
+		manifestFound = false;
+	}
+
+	free(manifest);
+
+	uint32_t records = 0;
+	activeSegment = segmentsFound ? lastSegment : 0;
+	activeOffset = 0;
+
+	for(; segmentsFound && segment <= lastSegment; segment++)
+	{
+		uint32_t end;
+		esp_err_t err = offlineSession_replay_segment(segment, offset, payload, &end, &records);
+		offset = 0;
 
-			ESP_LOGW(TAG, "OCMF read %i addr: %i : %c %" PRIu64 " %f 0x%" PRIX32 " %s", i, newElementPosition, OCMFElement.label, timestamp, OCMFElement.energy, packetCrc, (crcCalc == packetCrc) ? "MATCH" : "FAIL");
+		if(err == ESP_ERR_INVALID_CRC)
+		{
+			char path[OFFLINE_SESSION_PATH_SIZE];
+			offlineSession_segment_path(path, segment);
+
+			ESP_LOGW(TAG, "Incomplete record in segment %" PRIu32 " at %" PRIu32, segment, end);
+			offlineSession_AppendLogStringWithInt("Incomplete record at", end);
+
+			if(segment == lastSegment && truncate(path, end) != 0)
+			{
+				/// Records written after the invalid record could not be replayed, start a new segment instead
+				ESP_LOGE(TAG, "Failed to truncate segment: %s", strerror(errno));
+				activeSegment = lastSegment + 1;
+			}
 		}
+
+		if(segment == activeSegment)
+			activeOffset = end;
 	}
 
-	fclose(sessionFile);
+	free(payload);
 
-	free(base64SessionData);
-	free(sessionDataCreated);
+	oldestSegment = segmentsFound ? firstSegment : activeSegment;
 
-	xSemaphoreGive(offs_lock);
+	if(offlineSession_open_segment() != ESP_OK)
+		return ESP_FAIL;
 
-	return ESP_OK;
+	indexLoaded = true;
+
+	ESP_LOGI(TAG, "Loaded session index from %s, %" PRIu32 " records replayed, segments %" PRIu32 "-%" PRIu32,
+		manifestFound ? "manifest" : "segments", records, oldestSegment, activeSegment);
+
+	if(importFiles)
+		offlineSession_import_files();
+
+	if(indexLoaded)
+		offlineSession_update_manifest(!manifestFound || records > 0);
+
+	return indexLoaded ? ESP_OK : ESP_FAIL;
 }
 
-cJSON * offlineSession_ReadChargeSessionFromFile(int fileNo)
+/*
+ * Loads the index if it is not loaded. Must be called with offs_lock taken.
+ */
+static bool offlineSession_index_ready(void)
 {
-	if (!offlineSession_is_mounted()) {
-		ESP_LOGE(TAG, "files is not mounted!");
+	if(!offlineSession_is_mounted())
+		return false;
+
+	if(!indexLoaded && offlineSession_load_index() != ESP_OK)
+	{
+		ESP_LOGE(TAG, "Failed to load session index");
+		return false;
+	}
+
+	return true;
+}
+
+static bool offlineSession_session_used(int fileNo)
+{
+	return fileNo >= 0 && fileNo < OFFLINE_SESSION_MAX_SESSIONS && (sessionIndex[fileNo].flags & OFFLINE_SESSION_USED);
+}
+
+/*
+ * Reads the session data of a session as a null terminated string. Must be called with offs_lock taken.
+ */
+static char * offlineSession_read_session_data(int fileNo)
+{
+	struct SessionIndexEntry * entry = &sessionIndex[fileNo];
+
+	char path[OFFLINE_SESSION_PATH_SIZE];
+	offlineSession_segment_path(path, entry->data_segment);
+
+	FILE * fp = fopen(path, "rb");
+	if(fp == NULL)
+	{
+		offlineSession_AppendLogString("3 Read:segment == NULL");
+		offlineSession_AppendLogStringErr();
 		return NULL;
 	}
 
-	if( xSemaphoreTake( offs_lock, lock_timeout ) != pdTRUE )
+	char * sessionData = malloc(OFFLINE_SESSION_MAX_DATA_LENGTH + 1);
+	if(sessionData == NULL)
 	{
-		ESP_LOGE(TAG, "failed to obtain offs lock during finalize");
-		offlineSession_AppendLogString("3 Read:CS SEM FAIL");
+		fclose(fp);
+		offlineSession_AppendLogString("3 NULL from malloc");
 		return NULL;
 	}
 
-	char buf[32] = {0};
-	sprintf(buf,"%s/%d.bin", tmp_path, fileNo);
-	sessionFile = fopen(buf, "r");
+	fseek(fp, entry->data_offset, SEEK_SET);
 
-	if(sessionFile == NULL)
+	struct SessionRecordHeader header;
+	esp_err_t err = offlineSession_read_record(fp, &header, (uint8_t *)sessionData);
+	fclose(fp);
+
+	if(err != ESP_OK || header.session != fileNo || header.length != entry->data_length)
 	{
-		offlineSession_AppendLogString("3 Read:sessionFile == NULL");
-		offlineSession_AppendLogStringErr();
-		ESP_LOGE(TAG, "Print: sessionFile == NULL");
-		xSemaphoreGive(offs_lock);
+		ESP_LOGE(TAG, "Session %d: invalid session record in segment %" PRIu32 " at %" PRIu32, fileNo, entry->data_segment, entry->data_offset);
+		offlineSession_AppendLogStringWithInt("3 Read:CS CRC FAIL", fileNo);
+		free(sessionData);
 		return NULL;
 	}
 
-	uint8_t fileVersion = 0;
-	fread(&fileVersion, 1, 1, sessionFile);
-	ESP_LOGI(TAG, "File version: %d", fileVersion);
+	offlineSession_AppendLogStringWithInt("3 SessLen: ", header.length);
 
-	/// Read session CRC
-	fseek(sessionFile, FILE_SESSION_CRC_ADDR_996, SEEK_SET);
-	uint32_t crcRead = 0;
-	fread(&crcRead, sizeof(uint32_t), 1, sessionFile);
+	sessionData[header.length] = '\0';
+	return sessionData;
+}
 
-	/// Go to beginning before reading
-	fseek(sessionFile, FILE_SESSION_ADDR_2, SEEK_SET);
+/*
+ * Reads the energy values of a session from the segments after its create record. Returns the number of values or -1.
+ * Must be called with offs_lock taken.
+ */
+static int offlineSession_read_energy(int fileNo, struct SessionEnergyRecord * values, int maxValues)
+{
+	uint8_t * payload = malloc(OFFLINE_SESSION_MAX_DATA_LENGTH);
+	if(payload == NULL)
+		return -1;
 
-	char * base64SessionData = calloc(1000-6, 1);
-	fread(base64SessionData, 1000-6, 1, sessionFile);
+	int count = 0;
+	struct SessionIndexEntry * entry = &sessionIndex[fileNo];
 
-	int base64SessionDataLen = strlen(base64SessionData);
+	for(uint32_t segment = entry->first_segment; segment <= activeSegment; segment++)
+	{
+		char path[OFFLINE_SESSION_PATH_SIZE];
+		offlineSession_segment_path(path, segment);
 
-	uint32_t crcCalc = esp_crc32_le(0, (uint8_t *)base64SessionData, base64SessionDataLen);
+		FILE * fp = fopen(path, "rb");
+		if(fp == NULL)
+			continue;
 
-	ESP_LOGI(TAG,"Session CRC read control: 0x%" PRIX32 " vs 0x%" PRIX32 ": %s", crcRead, crcCalc, (crcRead == crcCalc) ? "MATCH" : "FAIL");
+		if(segment == entry->first_segment)
+			fseek(fp, entry->first_offset, SEEK_SET);
 
-	if(crcRead != crcCalc)
-	{
-		fclose(sessionFile);
-		free(base64SessionData);
-		xSemaphoreGive(offs_lock);
-		offlineSession_AppendLogStringWithIntInt("3 Read:CS CRC FAIL", (int)crcRead, (int)crcCalc);
-		return NULL;
+		struct SessionRecordHeader header;
+		while(offlineSession_read_record(fp, &header, payload) == ESP_OK)
+		{
+			if(header.session != fileNo || header.type != eSESSION_RECORD_ENERGY)
+				continue;
+
+			struct SessionEnergyRecord value;
+			memcpy(&value, payload, sizeof(value));
+
+			if(value.label == 'B')
+				count = 0;
+
+			if(count < maxValues)
+				values[count++] = value;
+		}
+
+		fclose(fp);
 	}
 
-	offlineSession_AppendLogStringWithIntInt("3 Read:CS CRC OK", (int)crcRead, (int)crcCalc);
+	free(payload);
+	return count;
+}
 
-	size_t outLen = 0;
-	char *sessionDataCreated = (char*)base64_decode(base64SessionData, base64SessionDataLen, &outLen);
+/*
+ * Find the file to use for a new session
+ */
+int offlineSession_FindNewFileNumber()
+{
+	if (!offlineSession_is_mounted()) {
+		ESP_LOGE(TAG, "files is not mounted!");
+		return -1;
+	}
 
-	char *sessionData = NULL;
+	if( xSemaphoreTake( offs_lock, lock_timeout ) != pdTRUE )
+	{
+		ESP_LOGE(TAG, "failed to obtain offs lock during find new");
+		return -1;
+	}
 
-	if(sessionDataCreated != NULL)
+	int fileNo = -1;
+	if(offlineSession_index_ready())
 	{
-		/// Sanity check
-		if(outLen <= 1000)
+		/// Use the number after the newest session. If the last number is used, no session can be added.
+		for (fileNo = max_offline_session_files-1; fileNo >= 0; fileNo--)
 		{
-			//int sessionLen = strlen(sessionDataCreated);
-			//printf("%d:%d: %s\n", strlen(base64SessionData), outLen, base64SessionData);
-			//printf("%d:%d %s\n", strlen(sessionDataCreated), outLen, sessionDataCreated);
+			if(offlineSession_session_used(fileNo))
+				break;
+		}
 
-			sessionData = malloc(outLen+1);//, sizeof(char));
-			if(sessionData != NULL)
-			{
-				//ESP_LOGE(TAG,"%d:%d %s\n", strlen(sessionDataCreated), outLen, sessionDataCreated);
+		fileNo = (fileNo == max_offline_session_files-1) ? -1 : fileNo + 1;
 
-				memset(sessionData, 0, outLen+1);
-				strncpy(sessionData, sessionDataCreated, outLen);
-				ESP_LOGI(TAG,"%d->%d==%d %s\n",strlen(sessionDataCreated), outLen, strlen(sessionData), sessionData);
-				offlineSession_AppendLogStringWithInt("3 SessLen: ", outLen);
-			}
-			else
+		ESP_LOGI(TAG, "Found from top as first unused OfflineSession file: %d", fileNo);
+	}
+
+	xSemaphoreGive(offs_lock);
+
+	return fileNo;
+}
+
+/*
+ * Find the oldest file to read, send, delete
+ */
+int offlineSession_FindOldestFile()
+{
+	if (!offlineSession_is_mounted()) {
+		ESP_LOGE(TAG, "files is not mounted!");
+		return -1;
+	}
+
+	if( xSemaphoreTake( offs_lock, lock_timeout ) != pdTRUE )
+	{
+		ESP_LOGE(TAG, "failed to obtain offs lock during find oldest");
+		return -1;
+	}
+
+	int oldest = -1;
+	if(offlineSession_index_ready())
+	{
+		for (int fileNo = 0; fileNo < max_offline_session_files; fileNo++ )
+		{
+			if(offlineSession_session_used(fileNo))
 			{
-				offlineSession_AppendLogString("3 NULL from malloc");
+				ESP_LOGI(TAG, "OfflineSession file: %d", fileNo);
+				oldest = fileNo;
+				break;
 			}
 		}
-		else
+	}
+
+	xSemaphoreGive(offs_lock);
+
+	return oldest; //-1 if no files found
+}
+
+
+int offlineSession_FindNrOfFiles()
+{
+	if (!offlineSession_is_mounted()) {
+		ESP_LOGE(TAG, "files is not mounted!");
+		return -1;
+	}
+
+	if( xSemaphoreTake( offs_lock, lock_timeout ) != pdTRUE )
+	{
+		ESP_LOGE(TAG, "failed to obtain offs lock during count");
+		return -1;
+	}
+
+	int fileCount = 0;
+	if(offlineSession_index_ready())
+	{
+		for (int fileNo = 0; fileNo < max_offline_session_files; fileNo++ )
 		{
-			offlineSession_AppendLogString("3 outLen > 1000");
+			if(offlineSession_session_used(fileNo))
+				fileCount++;
 		}
 	}
 	else
 	{
-		offlineSession_AppendLogString("3 NULL from base64_decode");
+		fileCount = -1;
 	}
-	//printf("%d:%d %.*s\n", strlen(sessionDataCreated), outLen, outLen, sessionDataCreated);
 
-	cJSON * jsonSession = cJSON_Parse(sessionDataCreated);
+	xSemaphoreGive(offs_lock);
+
+	ESP_LOGI(TAG, "Nr of OfflineSession files: %d", fileCount);
+
+	if(fileCount > maxOfflineSessionsCount)
+		maxOfflineSessionsCount = fileCount;
+
+	return fileCount;
+}
+
+int offlineSession_GetMaxSessionCount()
+{
+	int tmp = maxOfflineSessionsCount;
+	maxOfflineSessionsCount = 0;
+	return tmp;
+}
+
+int offlineSession_CheckIfLastLessionIncomplete(struct ChargeSession *incompleteSession)
+{
+	if (!offlineSession_is_mounted()) {
+		ESP_LOGE(TAG, "files is not mounted!");
+		return -1;
+	}
+
+	if( xSemaphoreTake( offs_lock, lock_timeout ) != pdTRUE )
+	{
+		ESP_LOGE(TAG, "failed to obtain offs lock during incomplete check");
+		return -1;
+	}
+
+	/// Find the newest session
+	int fileNo = -1;
+	if(offlineSession_index_ready())
+	{
+		for (fileNo = max_offline_session_files-1; fileNo >= 0; fileNo-- )
+		{
+			if(offlineSession_session_used(fileNo))
+				break;
+		}
+	}
+
+	xSemaphoreGive(offs_lock);
+
+	if(fileNo < 0)
+	{
+		ESP_LOGI(TAG, "No offline files found during boot with car connected");
+		return -1;
+	}
+
+	cJSON * lastSession = offlineSession_ReadChargeSessionFromFile(fileNo);
+
+	if(cJSON_HasObjectItem(lastSession, "EndDateTime"))
+	{
+		int i = strlen(cJSON_GetObjectItem(lastSession,"EndDateTime")->valuestring);
+		if (i > 0)
+		{
+			ESP_LOGE(TAG, "EndDateTime has length %d. Session is COMPLETE", i);
+			activeFileNumber = -1;
+		}
+		else
+		{
+			ESP_LOGE(TAG, "EndDateTime has length %d. Session is IN-COMPLETE", i);
+
+			/// Read the incomplete structure from file
+			if(cJSON_HasObjectItem(lastSession, "SessionId") &&
+					cJSON_HasObjectItem(lastSession, "Energy") &&
+					cJSON_HasObjectItem(lastSession, "StartDateTime") &&
+					cJSON_HasObjectItem(lastSession, "ReliableClock") &&
+					cJSON_HasObjectItem(lastSession, "StoppedByRFID")&&
+					cJSON_HasObjectItem(lastSession, "AuthenticationCode"))
+			{
+				strncpy(incompleteSession->SessionId, 	cJSON_GetObjectItem(lastSession,"SessionId")->valuestring, 37);
+				incompleteSession->Energy = 				cJSON_GetObjectItem(lastSession,"Energy")->valuedouble;
+				strncpy(incompleteSession->StartDateTime,	cJSON_GetObjectItem(lastSession,"StartDateTime")->valuestring, 32);
+				strncpy(incompleteSession->EndDateTime,	cJSON_GetObjectItem(lastSession,"EndDateTime")->valuestring, 32);
+
+				if(cJSON_GetObjectItem(lastSession,"ReliableClock")->valueint > 0)
+					incompleteSession->ReliableClock = true;
+				else
+					incompleteSession->ReliableClock = false;
+
+				if(cJSON_GetObjectItem(lastSession,"StoppedByRFID")->valueint > 0)
+					incompleteSession->StoppedByRFID = true;
+				else
+					incompleteSession->StoppedByRFID = false;
+
+				strncpy(incompleteSession->AuthenticationCode ,cJSON_GetObjectItem(lastSession,"AuthenticationCode")->valuestring, 41);
 
+				ESP_LOGI(TAG, "SessionId=%s",incompleteSession->SessionId);
+				ESP_LOGI(TAG, "Energy=%f",incompleteSession->Energy);
+				ESP_LOGI(TAG, "StartDateTime=%s",incompleteSession->StartDateTime);
+				ESP_LOGI(TAG, "EndDateTime=%s",incompleteSession->EndDateTime);
+				ESP_LOGI(TAG, "ReliableClock=%d",incompleteSession->ReliableClock);
+				ESP_LOGI(TAG, "StoppedByRFID=%d",incompleteSession->StoppedByRFID);
+				ESP_LOGI(TAG, "AuthenticationCode=%s",incompleteSession->AuthenticationCode);
+			}
+
+			/// Must set activeFileNumber and offlineSessionOpen to allow new SignedValues entries
+			activeFileNumber = fileNo;
+			offlineSessionOpen = true;
+		}
+	}
+
+	cJSON_Delete(lastSession);
+
+	ESP_LOGI(TAG, "OfflineSession found last used file from top: %d", fileNo);
+
+	return activeFileNumber;
+}
+
+
+/// Call this function to ensure that the session is no longer written to
+static int lastUsedFileNumber = -1;
+void offlineSession_SetSessionFileInactive()
+{
+	lastUsedFileNumber = activeFileNumber;
+	activeFileNumber = -1;
+}
+
+void offlineSession_DeleteLastUsedFile()
+{
+	if((activeFileNumber == -1) && (lastUsedFileNumber >= 0))
+	{
+		ESP_LOGE(TAG, "### Deleting last session because LOCAL only with energy = 0.0 ###");
+		offlineSession_delete_session(lastUsedFileNumber);
+		lastUsedFileNumber = -1;
+	}
+}
+
+int offlineSession_UpdateSessionOnFile(char *sessionData, bool createNewFile)
+{
+	ESP_LOGW(TAG, " *** UpdateSessionOnFile: %i ***", createNewFile);
+
+	if (!offlineSession_is_mounted()) {
+		ESP_LOGE(TAG, "files is not mounted!");
+		return ESP_FAIL;
+	}
+
+	if(activeFileNumber < 0)
+		return ESP_FAIL;
+
+
+	if( xSemaphoreTake( offs_lock, lock_timeout ) != pdTRUE )
+	{
+		ESP_LOGE(TAG, "failed to obtain offs lock during finalize");
+		return ESP_FAIL;
+	}
+
+	if(!offlineSession_index_ready())
+	{
+		offlineSession_AppendLogString(createNewFile ? "1 index not ready" : "2 index not ready");
+		xSemaphoreGive(offs_lock);
+		return -2;
+	}
+
+	int sessionDataLen = strlen(sessionData);
+	ESP_LOGI(TAG,"%d: %s\n", sessionDataLen, sessionData);
+
+	esp_err_t err = ESP_ERR_INVALID_STATE;
+	if(createNewFile)
+		err = offlineSession_stage_record(eSESSION_RECORD_CREATE, activeFileNumber, sessionData, sessionDataLen);
+	else if(offlineSession_session_used(activeFileNumber))
+		err = offlineSession_stage_record(eSESSION_RECORD_UPDATE, activeFileNumber, sessionData, sessionDataLen);
+
+	if(err == ESP_OK)
+		err = offlineSession_commit();
+
+	if(err != ESP_OK)
+	{
+		ESP_LOGE(TAG, "Could not write session %d (%i): %s", activeFileNumber, createNewFile, esp_err_to_name(err));
+		offlineSession_AppendLogStringWithIntInt(createNewFile ? "1 session write failed" : "2 session write failed", activeFileNumber, err);
+		xSemaphoreGive(offs_lock);
+		return -2;
+	}
+
+	if(createNewFile)
+	{
+		//Added diagnostics to try and find cause of empty sessions.
+		offlineSession_AppendLogStringWithIntInt("1 session created", activeFileNumber, sessionDataLen);
+	}
+
+	offlineSession_update_manifest(createNewFile);
+
+	xSemaphoreGive(offs_lock);
+
+	return ESP_OK;
+}
+
+esp_err_t offlineSession_Diagnostics_ReadFileContent(int fileNo)
+{
+	if (!offlineSession_is_mounted()) {
+		ESP_LOGE(TAG, "files is not mounted!");
+		return -1;
+	}
+
+	if( xSemaphoreTake( offs_lock, lock_timeout ) != pdTRUE )
+	{
+		ESP_LOGE(TAG, "failed to obtain offs lock during finalize");
+		return -1;
+	}
+
+	if(!offlineSession_index_ready() || !offlineSession_session_used(fileNo))
+	{
+		xSemaphoreGive(offs_lock);
+		ESP_LOGE(TAG, "Print: session %d not found", fileNo);
+		return ESP_FAIL;
+	}
+
+	struct SessionIndexEntry * entry = &sessionIndex[fileNo];
+	ESP_LOGW(TAG, "Session %d: created in segment %" PRIu32 " at %" PRIu32 ", data in segment %" PRIu32 " at %" PRIu32 ", %d energy values",
+		fileNo, entry->first_segment, entry->first_offset, entry->data_segment, entry->data_offset, entry->energy_count);
+
+	char * sessionData = offlineSession_read_session_data(fileNo);
+	if(sessionData == NULL)
+	{
+		xSemaphoreGive(offs_lock);
+		return ESP_ERR_INVALID_CRC;
+	}
+
+	printf("%d: %s\n", (int)strlen(sessionData), sessionData);
 	free(sessionData);
 
-	fclose(sessionFile);
+	struct SessionEnergyRecord * values = malloc(max_offline_signed_values * sizeof(struct SessionEnergyRecord));
+	int count = (values != NULL) ? offlineSession_read_energy(fileNo, values, max_offline_signed_values) : -1;
 
-	free(base64SessionData);
-	free(sessionDataCreated);
+	ESP_LOGI(TAG, "NrOfElements read: %d", count);
+
+	for (int i = 0; i < count; i++)
+		ESP_LOGW(TAG, "OCMF read %i: %c %" PRIu64 " %f", i, values[i].label, values[i].timestamp, values[i].energy);
+
+	free(values);
+
+	xSemaphoreGive(offs_lock);
+
+	return ESP_OK;
+}
+
+cJSON * offlineSession_ReadChargeSessionFromFile(int fileNo)
+{
+	if (!offlineSession_is_mounted()) {
+		ESP_LOGE(TAG, "files is not mounted!");
+		return NULL;
+	}
+
+	if( xSemaphoreTake( offs_lock, lock_timeout ) != pdTRUE )
+	{
+		ESP_LOGE(TAG, "failed to obtain offs lock during finalize");
+		offlineSession_AppendLogString("3 Read:CS SEM FAIL");
+		return NULL;
+	}
+
+	if(!offlineSession_index_ready() || !offlineSession_session_used(fileNo))
+	{
+		offlineSession_AppendLogStringWithInt("3 Read:session not found", fileNo);
+		ESP_LOGE(TAG, "Print: session %d not found", fileNo);
+		xSemaphoreGive(offs_lock);
+		return NULL;
+	}
+
+	char * sessionData = offlineSession_read_session_data(fileNo);
 
 	xSemaphoreGive(offs_lock);
 
+	if(sessionData == NULL)
+		return NULL;
+
+	offlineSession_AppendLogString("3 Read:CS CRC OK");
+
+	cJSON * jsonSession = cJSON_Parse(sessionData);
+	free(sessionData);
+
 	return jsonSession;
 }
 
@@ -1078,90 +1636,57 @@ cJSON* offlineSession_GetSignedSessionFromActiveFile(int fileNo)
 		return NULL;
 	}
 
-	char buf[32] = {0};
-	sprintf(buf,"%s/%d.bin", tmp_path, fileNo);
-	sessionFile = fopen(buf, "r");
-
-	if(sessionFile == NULL)
+	if(!offlineSession_index_ready() || !offlineSession_session_used(fileNo))
 	{
-		ESP_LOGE(TAG, "Print: sessionFile == NULL");
+		ESP_LOGE(TAG, "Print: session %d not found", fileNo);
 		xSemaphoreGive(offs_lock);
 		return NULL;
 	}
 
-	cJSON * entryArray = cJSON_CreateArray();
-
-	uint8_t fileVersion = 0;
-	fread(&fileVersion, 1, 1, sessionFile);
-	ESP_LOGI(TAG, "File version: %d", fileVersion);
-
-
-
-	/// Go to SignedSession length index
-	fseek(sessionFile, FILE_NR_OF_OCMF_ADDR_1000, SEEK_SET);
-
-	uint32_t nrOfOCMFElements = 0;
-	fread(&nrOfOCMFElements, sizeof(uint32_t), 1, sessionFile);
-	ESP_LOGI(TAG, "NrOfElements read: %" PRIi32 "", nrOfOCMFElements);
-
-	/// Build OCMF strings for each element, Should never be more than maxElements
-	if((nrOfOCMFElements > 0) && (nrOfOCMFElements <= max_offline_signed_values))
+	struct SessionEnergyRecord * values = malloc(max_offline_signed_values * sizeof(struct SessionEnergyRecord));
+	if(values == NULL)
 	{
-		int i;
-		for (i = 0; i < nrOfOCMFElements; i++)
-		{
-			/// Go to element position
-			int newElementPosition = (FILE_OCMF_START_ADDR_1004) + ((i) * sizeof(struct LogOCMFData));
-			fseek(sessionFile, newElementPosition, SEEK_SET);
+		xSemaphoreGive(offs_lock);
+		return NULL;
+	}
 
-			struct LogOCMFData OCMFElement;
-			fread(&OCMFElement, sizeof(struct LogOCMFData), 1, sessionFile);
+	int nrOfOCMFElements = offlineSession_read_energy(fileNo, values, max_offline_signed_values);
 
-			uint64_t timestamp = offlineSession_ReadTimestamp(&OCMFElement, fileVersion);
+	xSemaphoreGive(offs_lock);
 
-			/// Hold'n clear crc got get correct calculation for packet
-			uint32_t packetCrc = OCMFElement.crc;
-			OCMFElement.crc = 0;
+	ESP_LOGI(TAG, "NrOfElements read: %d", nrOfOCMFElements);
 
-			uint32_t crcCalc = esp_crc32_le(0, (uint8_t *)&OCMFElement, sizeof(struct LogOCMFData));
+	cJSON * entryArray = cJSON_CreateArray();
 
-			ESP_LOGI(TAG, "OCMF read %i addr: %i : %c %" PRIu64 " %f 0x%" PRIX32 " %s", i, newElementPosition, OCMFElement.label, timestamp, OCMFElement.energy, packetCrc, (crcCalc == packetCrc) ? "MATCH" : "FAIL");
+	for (int i = 0; i < nrOfOCMFElements; i++)
+	{
+		ESP_LOGI(TAG, "OCMF read %i: %c %" PRIu64 " %f", i, values[i].label, values[i].timestamp, values[i].energy);
 
-			if((crcCalc == packetCrc))
-			{
-				if(OCMFElement.label == 'B')
-					startEnergy = OCMFElement.energy;
+		if(values[i].label == 'B')
+			startEnergy = values[i].energy;
 
-				if(OCMFElement.label == 'E')
-					stopEnergy = OCMFElement.energy;
+		if(values[i].label == 'E')
+			stopEnergy = values[i].energy;
 
-				cJSON * logArrayElement = cJSON_CreateObject();
-				char timeBuffer[50] = {0};
-				zntp_format_time(timeBuffer, timestamp);
+		cJSON * logArrayElement = cJSON_CreateObject();
+		char timeBuffer[50] = {0};
+		zntp_format_time(timeBuffer, values[i].timestamp);
 
-				///Convert char to string for Json use. must have \0 ending.
-				char tx[2] = {OCMFElement.label, 0};
+		///Convert char to string for Json use. must have \0 ending.
+		char tx[2] = {values[i].label, 0};
 
-				cJSON_AddStringToObject(logArrayElement, "TM", timeBuffer);	//TimeAndSyncState
-				cJSON_AddStringToObject(logArrayElement, "TX", tx);	//Message status (B, T, E)
-				cJSON_AddNumberToObject(logArrayElement, "RV", OCMFElement.energy);//get_accumulated_energy());	//ReadingValue
-				cJSON_AddStringToObject(logArrayElement, "RI", "1-0:1.8.0");	//ReadingIdentification(OBIS-code)
-				cJSON_AddStringToObject(logArrayElement, "RU", "kWh");			//ReadingUnit
-				cJSON_AddStringToObject(logArrayElement, "RT", "AC");			//ReadingCurrentType
-				cJSON_AddStringToObject(logArrayElement, "ST", "G");			//MeterState
+		cJSON_AddStringToObject(logArrayElement, "TM", timeBuffer);	//TimeAndSyncState
+		cJSON_AddStringToObject(logArrayElement, "TX", tx);	//Message status (B, T, E)
+		cJSON_AddNumberToObject(logArrayElement, "RV", values[i].energy);//get_accumulated_energy());	//ReadingValue
+		cJSON_AddStringToObject(logArrayElement, "RI", "1-0:1.8.0");	//ReadingIdentification(OBIS-code)
+		cJSON_AddStringToObject(logArrayElement, "RU", "kWh");			//ReadingUnit
+		cJSON_AddStringToObject(logArrayElement, "RT", "AC");			//ReadingCurrentType
+		cJSON_AddStringToObject(logArrayElement, "ST", "G");			//MeterState
 
-				cJSON_AddItemToArray(entryArray, logArrayElement);
-			}
-			else
-			{
-				offlineSession_AppendLogStringWithIntInt("3 Read:CSH CRC FAIL", (int)crcCalc, (int)packetCrc);
-			}
-		}
+		cJSON_AddItemToArray(entryArray, logArrayElement);
 	}
 
-	fclose(sessionFile);
-
-	xSemaphoreGive(offs_lock);
+	free(values);
 
 	return entryArray;
 }
@@ -1185,8 +1710,6 @@ esp_err_t offlineSession_SaveSession(char * sessionData)
 		return ESP_FAIL;
 	}
 
-	sprintf(activePathString,"%s/%d.bin", tmp_path, activeFileNumber);
-
 	//Save the session structure to the file including the start 'B' message
 	ret = offlineSession_UpdateSessionOnFile(sessionData, true);
 
@@ -1210,135 +1733,120 @@ void offlineSession_append_energy(char label, time_t timestamp, double energy)
 		return;
 	}
 
-	sessionFile = fopen(activePathString, "rb+");
-	uint32_t nrOfOCMFElements = 0;
-	if(sessionFile != NULL)
+	if(!offlineSession_index_ready() || !offlineSession_session_used(activeFileNumber))
 	{
-		uint8_t fileVersion = 0;
-		fread(&fileVersion, 1, 1, sessionFile);
-		ESP_LOGI(TAG, "File version: %d", fileVersion);
-
-		/// Find end of file to get size
-		fseek(sessionFile, 0L, SEEK_END);
-		size_t readSize = ftell(sessionFile);
-		ESP_LOGI(TAG, "FileNo %d: %c, filesize: %d", activeFileNumber, label, readSize);
+		ESP_LOGE(TAG, "FileNo %d: session not found (%c)", activeFileNumber, label);
+		xSemaphoreGive(offs_lock);
+		return;
+	}
 
-		fseek(sessionFile, FILE_NR_OF_OCMF_ADDR_1000, SEEK_SET);
+	uint32_t nrOfOCMFElements = sessionIndex[activeFileNumber].energy_count;
 
-		/// Nr of elements is known for B, but not for T and E.
-		if(label == 'B')
+	/// Nr of elements is known for B, but not for T and E.
+	if(label == 'B')
+	{
+		/// Set first element
+		nrOfOCMFElements = 0;
+		offlineSessionOpen = true;
+	}
+	else
+	{
+		/// Make sure no attempts to write energy occurs until the Begin label is set
+		if(offlineSessionOpen == false)
 		{
-			/// Set first element
-			nrOfOCMFElements = 0;
-			offlineSessionOpen = true;
+			ESP_LOGE(TAG, "Tried appending energy with unopened offlinesession: %c", label);
+			xSemaphoreGive(offs_lock);
+			return;
 		}
-		else
-		{
-			/// Make sure no attempts to write energy occurs until the Begin label is set
-			if(offlineSessionOpen == false)
-			{
-				ESP_LOGE(TAG, "Tried appending energy with unopened offlinesession: %c", label);
-				fclose(sessionFile);
-				xSemaphoreGive(offs_lock);
-				return;
-			}
 
-			/// Make sure no attempts to write energy occurs after the End label is set
-			if(label == 'E')
-				offlineSessionOpen = false;
+		/// Make sure no attempts to write energy occurs after the End label is set
+		if(label == 'E')
+			offlineSessionOpen = false;
 
+		/// Should at least be one element 'B'
+		if(nrOfOCMFElements == 0)
+		{
+			if(label == 'T')
+				offlineSession_AppendLogString("2 T:nrOfOCMFElements == 0");
+			else if(label == 'E')
+				offlineSession_AppendLogString("3 E:nrOfOCMFElements == 0");
+			else
+				offlineSession_AppendLogString("nrOfOCMFElements == 0");
 
-			/// Get nr of elements...
-			fread(&nrOfOCMFElements, sizeof(uint32_t), 1, sessionFile);
-
-			/// Should at least be one element 'B'
-			if(nrOfOCMFElements == 0)
-			{
-				if(label == 'T')
-					offlineSession_AppendLogString("2 T:nrOfOCMFElements == 0");
-				else if(label == 'E')
-					offlineSession_AppendLogString("3 E:nrOfOCMFElements == 0");
-				else
-					offlineSession_AppendLogString("nrOfOCMFElements == 0");
-
-				ESP_LOGE(TAG, "FileNo %d: Invalid nr of OCMF elements: %" PRId32 " (%c)", activeFileNumber, nrOfOCMFElements, label);
-				fclose(sessionFile);
-				xSemaphoreGive(offs_lock);
-				return;
-			}
+			ESP_LOGE(TAG, "FileNo %d: Invalid nr of OCMF elements: %" PRId32 " (%c)", activeFileNumber, nrOfOCMFElements, label);
+			xSemaphoreGive(offs_lock);
+			return;
+		}
 
-			///100 elements, leave room for last element with 'E'
-			if((label == 'T') && (nrOfOCMFElements >= (max_offline_signed_values-1)))
-			{
-				ESP_LOGE(TAG, "FileNo %d: Invalid nr of OCMF elements: %" PRId32 " (%c)", activeFileNumber, nrOfOCMFElements, label);
-				fclose(sessionFile);
-				xSemaphoreGive(offs_lock);
-				return;
-			}
+		///100 elements, leave room for last element with 'E'
+		if((label == 'T') && (nrOfOCMFElements >= (max_offline_signed_values-1)))
+		{
+			ESP_LOGE(TAG, "FileNo %d: Invalid nr of OCMF elements: %" PRId32 " (%c)", activeFileNumber, nrOfOCMFElements, label);
+			xSemaphoreGive(offs_lock);
+			return;
+		}
 
-			///Max 100 elements check if room for 'e'
-			if((label == 'E') && (nrOfOCMFElements >= max_offline_signed_values))
-			{
-				ESP_LOGE(TAG, "FileNo %d: Invalid nr of OCMF elements: %" PRId32 " (%c)", activeFileNumber, nrOfOCMFElements, label);
-				fclose(sessionFile);
-				xSemaphoreGive(offs_lock);
-				return;
-			}
+		///Max 100 elements check if room for 'e'
+		if((label == 'E') && (nrOfOCMFElements >= max_offline_signed_values))
+		{
+			ESP_LOGE(TAG, "FileNo %d: Invalid nr of OCMF elements: %" PRId32 " (%c)", activeFileNumber, nrOfOCMFElements, label);
+			xSemaphoreGive(offs_lock);
+			return;
 		}
+	}
 
-		ESP_LOGI(TAG, "FileNo %d: &1000: Nr of OCMF elements: %c: %" PRId32 "", activeFileNumber, label, nrOfOCMFElements);
+	struct SessionEnergyRecord value = {.label = label, .timestamp = timestamp, .energy = energy};
 
-		/// And add 1.
+	ESP_LOGI(TAG, "OCMF Write %" PRIi32 " : %c %" PRIu64 " %f", nrOfOCMFElements, label, value.timestamp, energy);
 
-		/// Prepare struct with crc
-		struct LogOCMFData line = {.label = label, .energy = energy, .crc = 0};
-		offlineSession_SetTimestamp(&line, fileVersion, timestamp);
+	esp_err_t err = offlineSession_stage_record(eSESSION_RECORD_ENERGY, activeFileNumber, &value, sizeof(value));
+	if(err == ESP_OK)
+		err = offlineSession_commit();
 
-		uint64_t timestamp = offlineSession_ReadTimestamp(&line, fileVersion);
+	/// Added for diagnostics of empty session
+	if(label == 'B')
+		offlineSession_AppendLogStringWithInt("1 B: err", err);
 
-		uint32_t crc = esp_crc32_le(0, (uint8_t *)&line, sizeof(struct LogOCMFData));
-		line.crc = crc;
+	if(err == ESP_OK)
+		offlineSession_update_manifest(false);
 
-		//ESP_LOGW(TAG, "FileNo %d: writing to OFFS-file with crc=%u", activeFileNumber, line.crc);
+	xSemaphoreGive(offs_lock);
+}
 
-		int newElementPosition = (FILE_OCMF_START_ADDR_1004) + (nrOfOCMFElements * sizeof(struct LogOCMFData));
-		ESP_LOGI(TAG, "FileNo %d: New element position: #%" PRId32 ": %d", activeFileNumber, nrOfOCMFElements, newElementPosition);
-		ESP_LOGI(TAG, "OCMF Write %" PRIi32 " addr: %i : %c %" PRIu64 " %f 0x%" PRIX32 "", nrOfOCMFElements, newElementPosition, line.label, timestamp, line.energy, line.crc);
+void offlineSession_DeleteAllFiles()
+{
+	ESP_LOGW(TAG, "Deleting all files");
 
-		/// Write new element
-		fseek(sessionFile, newElementPosition, SEEK_SET);
-		size_t wrc = fwrite(&line, sizeof(struct LogOCMFData), 1, sessionFile);
+	if(!offlineSession_is_mounted()){
+		ESP_LOGE(TAG, "failed to mount /tmp, offline log will not work");
+		return;
+	}
 
-		/// Added for diagnostics of empty session
-		if(label == 'B')
-			offlineSession_AppendLogStringWithInt("1 B: wrc", wrc);
+	if( xSemaphoreTake( offs_lock, lock_timeout ) != pdTRUE )
+	{
+		ESP_LOGE(TAG, "failed to obtain offs lock during delete all");
+		return;
+	}
 
-		/// Update nr of elements @1000
-		fseek(sessionFile, FILE_NR_OF_OCMF_ADDR_1000, SEEK_SET);
-		nrOfOCMFElements += 1;
-		fwrite(&nrOfOCMFElements, sizeof(uint32_t), 1, sessionFile);
+	if(offlineSession_index_ready())
+	{
+		esp_err_t err = ESP_OK;
+		for (int fileNo = 0; fileNo < max_offline_session_files && err == ESP_OK; fileNo++)
+		{
+			if(offlineSession_session_used(fileNo))
+				err = offlineSession_stage_record(eSESSION_RECORD_DELETE, fileNo, NULL, 0);
+		}
 
-		fseek(sessionFile, FILE_NR_OF_OCMF_ADDR_1000, SEEK_SET);
+		if(err == ESP_OK)
+			err = offlineSession_commit();
 
-		nrOfOCMFElements = 99;
-		fread(&nrOfOCMFElements, sizeof(uint32_t), 1, sessionFile);
-		ESP_LOGI(TAG, "FileNo %d: Nr elements: #%" PRId32 "", activeFileNumber, nrOfOCMFElements);
-		fclose(sessionFile);
+		if(err == ESP_OK)
+			offlineSession_update_manifest(true);
 	}
 
 	xSemaphoreGive(offs_lock);
 }
 
-void offlineSession_DeleteAllFiles()
-{
-	ESP_LOGW(TAG, "Deleting all files");
-	int fileNo;
-	for (fileNo = 0; fileNo < max_offline_session_files; fileNo++)
-	{
-		offlineSession_delete_session(fileNo);
-	}
-}
-
 int offlineSession_delete_session(int fileNo)
 {
 	int ret = 0;
@@ -1354,37 +1862,29 @@ int offlineSession_delete_session(int fileNo)
 		return -1;
 	}
 
-	char buf[32] = {0};
-	sprintf(buf,"%s/%d.bin", tmp_path, fileNo);
-
-	FILE *fp = fopen(buf, "r");
-	if(fp==NULL)
+	if(!offlineSession_index_ready() || !offlineSession_session_used(fileNo))
 	{
-		ESP_LOGE(TAG, "File %d: Before remove: logfile can't be opened ", fileNo);
+		ESP_LOGE(TAG, "File %d: Before remove: session not found", fileNo);
 		xSemaphoreGive(offs_lock);
 		return 0;
 	}
-	else
-		ESP_LOGI(TAG, "File %d: Before remove: logfile can be opened ", fileNo);
-
-	fclose(fp);
 
-	remove(buf);
+	esp_err_t err = offlineSession_stage_record(eSESSION_RECORD_DELETE, fileNo, NULL, 0);
+	if(err == ESP_OK)
+		err = offlineSession_commit();
 
-	fp = fopen(buf, "r");
-	if(fp==NULL)
+	if(err == ESP_OK)
 	{
-		ESP_LOGI(TAG, "File %d: After remove: logfile deleted SUCCEEDED", fileNo);
+		ESP_LOGI(TAG, "File %d: After remove: session deleted SUCCEEDED", fileNo);
+		offlineSession_update_manifest(true);
 		ret = 1;
 	}
 	else
 	{
-		ESP_LOGE(TAG, "File %d: After remove: logfile delete FAILED ", fileNo);
+		ESP_LOGE(TAG, "File %d: After remove: session delete FAILED ", fileNo);
 		ret = 2;
 	}
 
-	fclose(fp);
-
 	xSemaphoreGive(offs_lock);
 
 	return ret;
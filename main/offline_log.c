@@ -8,15 +8,28 @@
 #include "esp_vfs.h"
 #include "esp_vfs_fat.h"
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+
 #include "errno.h"
 
 #include "OCMF.h"
+#include "zaptec_cloud_listener.h"
 #include "zaptec_cloud_observations.h"
 #include "zaptec_protocol_serialisation.h"
 
 #define OFFLINE_LOG_MAX_ITEMS 1000
 #define OFFLINE_LOG_FLAG_64BIT (1 << 0)
 
+#define OFFLINE_LOG_OCMF_SIZE 200
+
+/* Time to wait for the oldest message in flight, as for each line when lines were published blocking */
+#define OFFLINE_LOG_ACK_TIMEOUT_MS 2000
+
+/* Acks of other messages published while the log is sent are also reported, so the queue is longer than the window */
+#define OFFLINE_LOG_ACK_QUEUE_LENGTH 16
+
 struct LogFile {
 	SemaphoreHandle_t lock;
 	const char *mount;
@@ -45,8 +58,8 @@ struct LogLine {
 
 static struct LogFile log = {
 	.lock = NULL,
-	.mount = "/files",
-	.path = "/files/log64.bin",
+	.mount = CONFIG_ZAPTEC_OFFLINE_LOG_MOUNT_POINT,
+	.path = CONFIG_ZAPTEC_OFFLINE_LOG_MOUNT_POINT "/log64.bin",
 	.flags = OFFLINE_LOG_FLAG_64BIT,
 	.entry_size = sizeof(struct LogLine),
 };
@@ -59,7 +72,7 @@ int update_header(FILE *fp, int start, int end) {
 	ESP_LOGI(TAG, "file error %d eof %d", ferror(fp), feof(fp));
 	int write_result = fwrite(&new_header, 1, sizeof(new_header), fp);
 	ESP_LOGI(TAG, "file error %d eof %d", ferror(fp), feof(fp));
-	ESP_LOGI(TAG, "writing header %d %d %" PRIu32 " (s:%d, res:%d)    <<<<   ",
+	ESP_LOGI(TAG, "writing header %d %d %" PRIu32 " (s:%zu, res:%d)    <<<<   ",
 			 new_header.start, new_header.end, new_header.crc,
 			 sizeof(new_header), write_result);
 
@@ -75,7 +88,7 @@ int ensure_valid_header(FILE *fp, int *start_out, int *end_out) {
 	fseek(fp, 0, SEEK_SET);
 	ESP_LOGI(TAG, "file error %d eof %d", ferror(fp), feof(fp));
 	int read_result = fread(&head_in_file, 1, sizeof(head_in_file), fp);
-	ESP_LOGI(TAG, "header on disk %d %d %" PRIu32 " (s:%d, res:%d)    <<<   ",
+	ESP_LOGI(TAG, "header on disk %d %d %" PRIu32 " (s:%zu, res:%d)    <<<   ",
 			 head_in_file.start, head_in_file.end, head_in_file.crc,
 			 sizeof(head_in_file), read_result);
 	ESP_LOGI(TAG, "file error %d eof %d", ferror(fp), feof(fp));
@@ -149,7 +162,7 @@ FILE *init_and_lock_log(const struct LogFile *file, int *start, int *end) {
 		xSemaphoreGive(file->lock);
 		return NULL;
 	}
-	ESP_LOGI(TAG, "expanded log to %d(%d)", log_size, seek_res);
+	ESP_LOGI(TAG, "expanded log to %zu(%d)", log_size, seek_res);
 
 	fseek(fp, 0, SEEK_SET);
 
@@ -225,6 +238,99 @@ void offline_log_append_energy(time_t timestamp, double energy) {
 	release_log(&log, fp);
 }
 
+static QueueHandle_t ack_queue = NULL;
+
+/*
+ * Lines are published CONFIG_ZAPTEC_OFFLINE_LOG_BATCH at a time, with up to CONFIG_ZAPTEC_OFFLINE_LOG_IN_FLIGHT messages
+ * waiting for acknowledgement. Acks may arrive in any order, but the header is only moved past a batch when it and all
+ * batches before it are acknowledged, so a line is never skipped. Lines in unacknowledged batches may be published again.
+ */
+struct LogBatch {
+	int message_id; // 0 if there is nothing to wait for
+	int end; // index after the last line in the batch
+	bool acknowledged;
+};
+
+/*
+ * Reads the line at index and creates its OCMF message.
+ * Returns false if the line is corrupt.
+ */
+static bool read_line_as_ocmf(struct LogFile *file, FILE *fp, int index, char *ocmf_text) {
+	struct LogLine line;
+	int start_of_line = sizeof(struct LogHeader) + (sizeof(line) * index);
+
+	fseek(fp, start_of_line, SEEK_SET);
+	int read_result = fread(&line, 1, sizeof(line), fp);
+
+	uint32_t crc_on_file = line.crc;
+	line.crc = 0;
+	uint32_t calculated_crc = esp_crc32_le(0, (uint8_t *)&line, sizeof(line));
+
+#ifdef CONFIG_ZAPTEC_GO_PLUS
+	uint32_t mid_id = line.pos;
+
+	ESP_LOGD(TAG,
+			 "LogLine%d@%d>%d: P=%" PRIu32 " crc=%" PRId32
+			 ", valid=%d, read=%d",
+			 (file->flags & OFFLINE_LOG_FLAG_64BIT) ? 64 : 32, index,
+			 start_of_line, mid_id, crc_on_file,
+			 crc_on_file == calculated_crc, read_result);
+#else
+	double energy = line.energy;
+	time_t timestamp = line.timestamp;
+
+	ESP_LOGD(TAG,
+			 "LogLine%d@%d>%d: E=%f, t=%lld, crc=%" PRId32
+			 ", valid=%d, read=%d",
+			 (file->flags & OFFLINE_LOG_FLAG_64BIT) ? 64 : 32, index,
+			 start_of_line, energy, (long long)timestamp, crc_on_file,
+			 crc_on_file == calculated_crc, read_result);
+#endif
+
+	if (read_result != sizeof(line) || crc_on_file != calculated_crc) {
+		ESP_LOGI(TAG, "skipped corrupt line %d", index);
+		return false;
+	}
+
+#ifdef CONFIG_ZAPTEC_GO_PLUS
+	OCMF_SignedMeterValue_CreateMessageFromMID(ocmf_text, OFFLINE_LOG_OCMF_SIZE, mid_id, false);
+#else
+	OCMF_SignedMeterValue_CreateMessageFromLog(ocmf_text, timestamp, energy);
+#endif
+
+	return true;
+}
+
+/*
+ * Publishes the lines from *next up to CONFIG_ZAPTEC_OFFLINE_LOG_BATCH valid lines, and advances *next past them.
+ * Returns the message id, 0 if all lines were corrupt or nothing was published, or negative on failure.
+ */
+static int publish_batch(struct LogFile *file, FILE *fp, int *next, int log_end, char (*ocmf_texts)[OFFLINE_LOG_OCMF_SIZE]) {
+	const char *values[CONFIG_ZAPTEC_OFFLINE_LOG_BATCH];
+	size_t count = 0;
+	int index = *next;
+
+	while (count < CONFIG_ZAPTEC_OFFLINE_LOG_BATCH && index != log_end) {
+		if (read_line_as_ocmf(file, fp, index, ocmf_texts[count])) {
+			values[count] = ocmf_texts[count];
+			count++;
+		}
+
+		index = (index + 1) % OFFLINE_LOG_MAX_ITEMS;
+	}
+
+	int message_id = 0;
+	if (count > 0)
+		message_id = publish_string_observations_tracked(SignedMeterValue, values, count);
+
+	if (message_id >= 0) {
+		ESP_LOGI(TAG, "published lines %d-%d as message %d", *next, index, message_id);
+		*next = index;
+	}
+
+	return message_id;
+}
+
 int _offline_log_attempt_send(struct LogFile *file) {
 	ESP_LOGI(TAG, "log data (%s):", file->path);
 
@@ -237,72 +343,95 @@ int _offline_log_attempt_send(struct LogFile *file) {
 	if (fp == NULL)
 		return 0;
 
-	char ocmf_text[200] = { 0 };
+	char (*ocmf_texts)[OFFLINE_LOG_OCMF_SIZE] = NULL;
+	if (log_start != log_end) {
+		ocmf_texts = calloc(CONFIG_ZAPTEC_OFFLINE_LOG_BATCH, OFFLINE_LOG_OCMF_SIZE);
 
-	while (log_start != log_end) {
-		int read_result, start_of_line;
-		uint32_t crc_on_file, calculated_crc;
+		if (ocmf_texts == NULL || ack_queue == NULL) {
+			ESP_LOGE(TAG, "Unable to send log, no memory for batch or ack queue");
+			free(ocmf_texts);
+			release_log(file, fp);
+			return -1;
+		}
 
-		struct LogLine line;
-		start_of_line = sizeof(struct LogHeader) + (sizeof(line) * log_start);
+		xQueueReset(ack_queue);
+		if (publish_iothub_add_ack_queue(ack_queue) != 0) {
+			ESP_LOGE(TAG, "Unable to send log, ack queue not added");
+			free(ocmf_texts);
+			release_log(file, fp);
+			return -1;
+		}
+	}
 
-		fseek(fp, start_of_line, SEEK_SET);
-		read_result = fread(&line, 1, sizeof(line), fp);
+	struct LogBatch batches[CONFIG_ZAPTEC_OFFLINE_LOG_IN_FLIGHT];
+	size_t batch_count = 0;
+	int next = log_start;
+	bool publish_failed = false;
 
-		crc_on_file = line.crc;
-		line.crc = 0;
-		calculated_crc = esp_crc32_le(0, (uint8_t *)&line, sizeof(line));
+	while (log_start != log_end) {
+		while (!publish_failed && batch_count < CONFIG_ZAPTEC_OFFLINE_LOG_IN_FLIGHT && next != log_end) {
+			int message_id = publish_batch(file, fp, &next, log_end, ocmf_texts);
 
-#ifdef CONFIG_ZAPTEC_GO_PLUS
-		uint32_t mid_id = line.pos;
-
-		ESP_LOGI(TAG,
-				 "LogLine%d@%d>%d: P=%" PRIu32 " crc=%" PRId32
-				 ", valid=%d, read=%d",
-				 (file->flags & OFFLINE_LOG_FLAG_64BIT) ? 64 : 32, log_start,
-				 start_of_line, mid_id, crc_on_file,
-				 crc_on_file == calculated_crc, read_result);
-#else
-		double energy = line.energy;
-		time_t timestamp = line.timestamp;
-
-		ESP_LOGI(TAG,
-				 "LogLine%d@%d>%d: E=%f, t=%lld, crc=%" PRId32
-				 ", valid=%d, read=%d",
-				 (file->flags & OFFLINE_LOG_FLAG_64BIT) ? 64 : 32, log_start,
-				 start_of_line, energy, timestamp, crc_on_file,
-				 crc_on_file == calculated_crc, read_result);
-#endif
+			if (message_id < 0) {
+				/* Batches already in flight are still committed when acknowledged */
+				ESP_LOGI(TAG, "publishing lines failed, aborting log dump");
+				publish_failed = true;
+				break;
+			}
 
-		if (crc_on_file == calculated_crc) {
+			batches[batch_count++] = (struct LogBatch){
+				.message_id = message_id,
+				.end = next,
+				.acknowledged = (message_id == 0),
+			};
+		}
 
-#ifdef CONFIG_ZAPTEC_GO_PLUS
-			OCMF_SignedMeterValue_CreateMessageFromMID(ocmf_text, sizeof (ocmf_text), mid_id, false);
-#else
-			OCMF_SignedMeterValue_CreateMessageFromLog(ocmf_text, timestamp,
-													   energy);
-#endif
+		if (batch_count == 0)
+			break;
 
-			int publish_result = publish_string_observation_blocked(
-				SignedMeterValue, ocmf_text, 2000);
+		size_t done = 0;
+		while (done < batch_count && batches[done].acknowledged)
+			done++;
 
-			if (publish_result < 0) {
-				ESP_LOGI(TAG, "publishing line failed, aborting log dump");
-				break;
+		if (done > 0) {
+			log_start = batches[done - 1].end;
+			batch_count -= done;
+			memmove(batches, batches + done, batch_count * sizeof(struct LogBatch));
+
+			/* The header is written once per acknowledged batch instead of once per line */
+			if (log_start == log_end) {
+				log_start = log_end = next = 0;
 			}
 
-			int new_log_start = (log_start + 1) % OFFLINE_LOG_MAX_ITEMS;
-			update_header(fp, new_log_start, log_end);
+			update_header(fp, log_start, log_end);
 			fflush(fp);
+			continue;
+		}
 
-			ESP_LOGI(TAG, "line published");
-		} else {
-			ESP_LOGI(TAG, "skipped corrupt line");
+		struct publish_ack ack;
+		if (xQueueReceive(ack_queue, &ack, pdMS_TO_TICKS(OFFLINE_LOG_ACK_TIMEOUT_MS)) != pdTRUE) {
+			ESP_LOGW(TAG, "timeout waiting for message %d, aborting log dump", batches[0].message_id);
+			break;
 		}
 
-		log_start = (log_start + 1) % OFFLINE_LOG_MAX_ITEMS;
+		size_t i = 0;
+		while (i < batch_count && batches[i].message_id != ack.message_id)
+			i++;
+
+		if (i == batch_count)
+			continue;
+
+		if (!ack.published) {
+			ESP_LOGW(TAG, "message %d deleted by client, aborting log dump", ack.message_id);
+			break;
+		}
+
+		batches[i].acknowledged = true;
 	}
 
+	publish_iothub_remove_ack_queue(ack_queue);
+	free(ocmf_texts);
+
 	if (log_start == log_end) {
 		result = 0;
 		if (log_start != 0)
@@ -364,6 +493,7 @@ int offline_log_delete(void) {
 		ret = 2;
 	}
 
+	xSemaphoreGive(log.lock);
 	return ret;
 }
 
@@ -373,4 +503,8 @@ void offline_log_init(void) {
 		ESP_LOGE(TAG, "Failed to create mutex for offline log");
 		return;
 	}
+
+	ack_queue = xQueueCreate(OFFLINE_LOG_ACK_QUEUE_LENGTH, sizeof(struct publish_ack));
+	if (ack_queue == NULL)
+		ESP_LOGE(TAG, "Failed to create ack queue for offline log");
 }
@@ -963,8 +963,7 @@ static void sample_meter_values(){
 	ESP_LOGI(TAG, "Starting periodic meter values");
 
 	uint connector = 1;
-	handle_meter_value(eOCPP_CONTEXT_SAMPLE_PERIODIC,
-			storage_Get_ocpp_meter_values_sampled_data(), storage_Get_ocpp_stop_txn_sampled_data(),
+	handle_meter_value(eOCPP_CONTEXT_SAMPLE_PERIODIC, false, true,
 			transaction_id, transaction_id_is_valid, &connector, 1, false);
 }
 
@@ -997,8 +996,7 @@ static void _stop_sample_interval(){
 	sample_handle = NULL;
 
 	uint connector = 1;
-	handle_meter_value(eOCPP_CONTEXT_TRANSACTION_END,
-			storage_Get_ocpp_meter_values_sampled_data(), storage_Get_ocpp_stop_txn_sampled_data(),
+	handle_meter_value(eOCPP_CONTEXT_TRANSACTION_END, false, true,
 			transaction_id, transaction_id_is_valid, &connector, 1, false);
 }
 
@@ -1146,8 +1144,7 @@ void start_transaction(){
 		sessionHandler_OcppChangeSampleInterval(eOCPP_CONTEXT_TRANSACTION_BEGIN);
 
 		uint connector = 1;
-		handle_meter_value(eOCPP_CONTEXT_TRANSACTION_BEGIN,
-				storage_Get_ocpp_meter_values_sampled_data(), storage_Get_ocpp_stop_txn_sampled_data(),
+		handle_meter_value(eOCPP_CONTEXT_TRANSACTION_BEGIN, false, true,
 				transaction_id, transaction_id_is_valid, &connector, 1, false);
 
 	}
@@ -3184,7 +3181,12 @@ static void sessionHandler_task()
 		{
 			//Allow disabling send on change in standalone when TransmitInterval is 0
 			if(!((storage_Get_TransmitInterval() == 0) && storage_Get_Standalone()))
+			{
 				publish_telemetry_observation_on_change();
+
+				/// Values recorded while offline are sent in batches after the current values
+				publish_offline_telemetry();
+			}
 			else
 				ESP_LOGE(TAG, "TransmitInterval = 0 in Standalone");
 
@@ -3240,6 +3242,10 @@ static void sessionHandler_task()
 		}
 		else	//Mqtt not connected or PingReply == PING_REPLY_OFFLINE
 		{
+			/// Keep measured values on file to send when online again
+			if(!((storage_Get_TransmitInterval() == 0) && storage_Get_Standalone()))
+				record_telemetry_observation_offline();
+
 			if(storage_Get_Standalone() == false)
 			{
 				offlineTime++;
@@ -267,9 +267,74 @@ async def smart_charging_extended_with_rapid_meter_values(cp):
         itteration+=1
         logging.info(f"Smart charging itteration {itteration} Expected count: {expected_value_count}, Almost count: {almost_value_count}, Unexpected count {unexpected_value_count}")
 
+async def offline_transaction_backlog_drain(cp, offline_duration = 600):
+    logging.info("Starting offline transaction backlog drain test")
+
+    preconfig_res = await ensure_configuration(cp, {ConfigurationKey.local_pre_authorize: "false",
+                                                    ConfigurationKey.authorize_remote_tx_requests: "false",
+                                                    ConfigurationKey.heartbeat_interval: "0",
+                                                    ConfigurationKey.clock_aligned_data_interval: "0",
+                                                    ConfigurationKey.meter_value_sample_interval: "1",
+                                                    ConfigurationKey.meter_values_sampled_data: f'{Measurand.energy_active_import_register.value},{Measurand.current_import.value},{Measurand.voltage.value}',
+                                                    "MessageTimeout": "30",
+                                                    "AuthorizationRequired": "false"})
+
+    if preconfig_res != 0:
+        logging.error("Unable to prepare for offline backlog drain test")
+        return False
+
+    drain = dict(reconnect_time = None, first_backlog = None, last_backlog = None, request_count = 0, value_count = 0)
+
+    async def on_meter_values(self, call_unique_id, connector_id, meter_value, **kwargs):
+        if drain['reconnect_time'] is not None and drain['last_backlog'] is None:
+            newest = max(dateutil.parser.isoparse(value['timestamp']).replace(tzinfo=None) for value in meter_value)
+            if newest < drain['reconnect_time']:
+                if drain['first_backlog'] is None:
+                    drain['first_backlog'] = time.monotonic()
+
+                drain['request_count'] += 1
+                drain['value_count'] += len(meter_value)
+            else:
+                drain['last_backlog'] = time.monotonic()
+
+        return call_result.MeterValuesPayload()
+
+    cp.route_map[Action.MeterValues]["_on_action"] = types.MethodType(on_meter_values, cp)
+
+    while(cp.connector1_status != ChargePointStatus.charging and cp.connector1_status != ChargePointStatus.suspended_ev):
+        logging.warning(f"Waiting for status charging...({cp.connector1_status})")
+        await asyncio.sleep(3)
+
+    logging.info(f'Going offline for {offline_duration} sec to create transaction backlog')
+    cp.reject_connections = True
+    await cp._connection.close()
+    await asyncio.sleep(offline_duration)
+
+    drain['reconnect_time'] = datetime.utcnow()
+    cp.reject_connections = False
+    logging.info("Accepting connections. Awaiting backlog drain")
+
+    i = 0
+    while drain['last_backlog'] is None:
+        i += 1
+        if i > offline_duration:
+            logging.error(f"Backlog not drained. Got {drain['value_count']} meter values in {drain['request_count']} requests")
+            return False
+        await asyncio.sleep(1)
+
+    if drain['request_count'] == 0:
+        logging.error("No stored meter values received after reconnect")
+        return False
+
+    drain_time = drain['last_backlog'] - drain['first_backlog']
+    logging.info(f"Backlog of {drain['value_count']} meter values in {drain['request_count']} requests "
+                 f"({drain['value_count'] / drain['request_count']:.1f} values per request) drained in {drain_time:.1f} sec "
+                 f"({drain['value_count'] / max(drain_time, 0.001):.1f} values per sec)")
+    return True
+
 async def endurance_tests(cp):
     loop = asyncio.get_event_loop()
-    response = await loop.run_in_executor(None, input, 'Input sub id [B]oot repeat/[S]smart charging extended')
+    response = await loop.run_in_executor(None, input, 'Input sub id [B]oot repeat/[S]smart charging extended/[D]rain offline transaction backlog')
 
     if response == "B":
         await boot_repeat(cp)
@@ -277,5 +342,8 @@ async def endurance_tests(cp):
     if response == "S":
         await smart_charging_extended_with_rapid_meter_values(cp)
 
+    if response == "D":
+        await offline_transaction_backlog_drain(cp)
+
 
     logging.error("Endurance test exited")
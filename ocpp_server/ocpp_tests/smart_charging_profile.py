@@ -30,7 +30,10 @@ from ocpp.v16.datatypes import(
     ChargingSchedulePeriod
 )
 from ocpp.exceptions import GenericError
-from ocpp_tests.test_utils import ensure_configuration
+from ocpp.messages import MessageType
+from ocpp.charge_point import snake_to_camel_case, remove_nones
+from dataclasses import asdict
+from ocpp_tests.test_utils import ensure_configuration, call_without_validation
 
 tx_id = 345
 auth_tag = "test"
@@ -264,6 +267,40 @@ async def test_tx_profile_overcurrent(cp):
 
     return True
 
+""" Payloads are validated against the OCPP 1.6 schemas: field names are case sensitive, limits must be a multiple of 0.1
+and required fields must be present.
+
+:param cp: chargepoint
+
+:return true if test completes with expected results. false otherwise.
+"""
+async def test_set_charging_profile_schema_violations(cp):
+    profile = remove_nones(snake_to_camel_case(asdict(create_charging_profile(purpose = ChargingProfilePurposeType.tx_default_profile))))
+
+    wrong_case = {"ConnectorId": 1, "csChargingProfiles": profile}
+
+    invalid_limit = {"connectorId": 1, "csChargingProfiles": profile.copy()}
+    invalid_limit["csChargingProfiles"]["chargingSchedule"] = dict(profile["chargingSchedule"])
+    invalid_limit["csChargingProfiles"]["chargingSchedule"]["chargingSchedulePeriod"] = [
+        {"startPeriod": 0, "limit": 16.05, "numberPhases": 3}
+    ]
+
+    missing_profile = {"connectorId": 1}
+
+    for description, payload, expected_error in [("wrong case field name", wrong_case, "FormationViolation"),
+                                                 ("limit not a multiple of 0.1", invalid_limit, "PropertyConstraintViolation"),
+                                                 ("missing csChargingProfiles", missing_profile, "FormationViolation")]:
+
+        result = await call_without_validation(cp, Action.SetChargingProfile, payload)
+
+        if result.message_type_id != MessageType.CallError or result.error_code != expected_error:
+            logging.error(f'Expected {expected_error} for {description}, got: {result}')
+            return False
+
+        logging.info(f'Got {expected_error} for {description}')
+
+    return True
+
 async def test_smart_charging_profile(cp, include_manual_tests = True):
     logging.info('Setting up smart charging profile test')
     preconfig_res = await ensure_configuration(cp, {ConfigurationKey.local_pre_authorize: "false",
@@ -283,6 +320,9 @@ async def test_smart_charging_profile(cp, include_manual_tests = True):
         logging.error('Unable to clear charging profiles to prepare for smart charging tests')
         return False
 
+    if await test_set_charging_profile_schema_violations(cp) != True:
+        return False
+
     def on_start_transaction(self, connector_id, id_tag, meter_start, timestamp, **kwargs):
         logging.info(f"Testing got start transaction with id {id_tag}")
         info=dict(parentIdTag='fd65bbe2-edc8-4940-9', status='Accepted')
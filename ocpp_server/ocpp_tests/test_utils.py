@@ -11,6 +11,7 @@ from ocpp.routing import on
 from ocpp.v16.enums import ConfigurationStatus, Action
 from ocpp.v16 import ChargePoint as cp
 from ocpp.v16 import call
+from ocpp.messages import Call
 
 class OperationState(Enum):
     disconnected = "A"
@@ -169,3 +170,16 @@ async def wait_for_cp_status(cp, states: list, timeout: Optional[int] = None):
             break
 
     return cp.connector1_status
+
+async def call_without_validation(cp, action: Action, payload: dict):
+    """ Sends a request that the ocpp library would refuse to send, to test how the charge point handles invalid requests.
+
+    :param payload: the request payload with camel case field names as sent on the wire.
+
+    :return the CallResult or CallError received as reply.
+    """
+    request = Call(unique_id = str(cp._unique_id_generator()), action = action, payload = payload)
+
+    async with cp._call_lock:
+        await cp._send(request.to_json())
+        return await cp._get_specific_response(request.unique_id, cp._response_timeout)
@@ -48,6 +48,30 @@ new_exipry_date = datetime.utcnow() + timedelta(days=1)
 zap_in = None
 zap_out = None
 
+latency_ms = 0
+latency_jitter_ms = 0
+
+class LatencyConnection:
+    """ Wraps a websocket and delays every message sent to the charge point to emulate a slow link.
+
+    """
+    def __init__(self, websocket):
+        self._websocket = websocket
+
+    async def send(self, message):
+        delay = latency_ms + random.uniform(-latency_jitter_ms, latency_jitter_ms)
+        if delay > 0:
+            await asyncio.sleep(delay / 1000)
+        await self._websocket.send(message)
+
+    def __getattr__(self, name):
+        return getattr(self._websocket, name)
+
+def wrap_connection(websocket):
+    if latency_ms > 0 or latency_jitter_ms > 0:
+        return LatencyConnection(websocket)
+    return websocket
+
 async def init_zap_client(path):
     loop = asyncio.get_event_loop()
 
@@ -161,6 +185,9 @@ class ChargePoint(cp):
 
         self.action_events = dict()
 
+        #Connection related
+        self.reject_connections = False
+
 
     @on(Action.BootNotification)
     def on_boot_notitication(self, charge_point_vendor, charge_point_model, **kwargs):
@@ -294,8 +321,13 @@ async def on_connect(websocket, path):
 
     charge_point_id = path.strip('/')
     if charge_point_id in charge_points:
+        if charge_points[charge_point_id].reject_connections:
+            logging.warning(f"Rejecting connection from {charge_point_id}")
+            await websocket.close()
+            return
+
         logging.warning(f"Chargepoint with id {charge_point_id} reconnected")
-        charge_points[charge_point_id]._connection = websocket
+        charge_points[charge_point_id]._connection = wrap_connection(websocket)
 
         try:
             await charge_points[charge_point_id].start()
@@ -303,7 +335,7 @@ async def on_connect(websocket, path):
             logging.error(f"Chargepoint raised exception: {e}")
         return
     else:
-        charge_points[charge_point_id] = ChargePoint(charge_point_id, websocket)
+        charge_points[charge_point_id] = ChargePoint(charge_point_id, wrap_connection(websocket))
 
         logging.info("Starting tests")
 
@@ -327,8 +359,18 @@ async def main():
 
     parser = argparse.ArgumentParser()
     parser.add_argument("-z", "--zap_cli_path", help="Path to serial device for communication with MCU. Example -z /dev/ttyUSB1")
+    parser.add_argument("-l", "--latency", type=int, default=0, help="Delay in ms added to every message sent to the charge point")
+    parser.add_argument("-j", "--jitter", type=int, default=0, help="Random variation in ms of the added delay")
     args = parser.parse_args()
 
+    global latency_ms
+    global latency_jitter_ms
+    latency_ms = args.latency
+    latency_jitter_ms = args.jitter
+
+    if latency_ms > 0 or latency_jitter_ms > 0:
+        logging.info(f'Adding {latency_ms} +/- {latency_jitter_ms} ms latency to sent messages')
+
     if args.zap_cli_path:
         await init_zap_client(args.zap_cli_path)
 